@@ -23,4 +23,4 @@ INCLUDE_DIRECTORIES(
 
 LINK_DIRECTORIES(${GSTREAMER_ROOT_ANDROID}/${GSTREAMER_ABI}/lib)
 
-SET(GST_LIBRARIES -lgio-2.0 -lgstapp-1.0 -lgstbase-1.0 -lgstreamer-1.0 -lgobject-2.0 -lgmodule-2.0 -lglib-2.0 -liconv -lintl -lffi)
+SET(GST_LIBRARIES -lgio-2.0 -lgstapp-1.0 -lgstrtp-1.0 -lgstbase-1.0 -lgstreamer-1.0 -lgobject-2.0 -lgmodule-2.0 -lglib-2.0 -liconv -lintl -lffi)
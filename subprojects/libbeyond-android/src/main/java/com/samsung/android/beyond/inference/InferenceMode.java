@@ -18,11 +18,9 @@ package com.samsung.android.beyond.inference;
 
 public enum InferenceMode {
     LOCAL("local"),
-    REMOTE("remote");
-    /** TODO: Enable following modes after libbeyond is expanded.
+    REMOTE("remote"),
     EDGE("edge"),
     DISTRIBUTE("distribute");
-    **/
 
     String modeName = null;
     InferenceMode(String modeName) {
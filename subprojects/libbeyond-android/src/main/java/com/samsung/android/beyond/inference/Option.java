@@ -24,11 +24,21 @@ public final class Option {
 
     public static final String REMOTE = "remote";
 
+    public static final String EDGE = "edge";
+
+    public static final String DISTRIBUTE = "distribute";
+
+    public static final String AUTO_SPLIT = "--split";
+
     public static final String FRAMEWORK = "--framework";
 
-    // TODO: The following options is not implemented yet
-    //
-    // public static final String AUTO_SPLIT = "--split";
-    // public static final String EDGE = "edge";
-    // public static final String DISTRIBUTE = "distribute";
+    public static final String FANOUT = "--fanout";
+
+    public static final String HEDGE = "--hedge";
+
+    public static final String BALANCE = "--balance";
+
+    public static final String MAX_INFLIGHT = "--max-inflight";
+
+    public static final String ORDERED = "--ordered";
 }
@@ -19,6 +19,7 @@
 
 #include <string>
 #include <memory>
+#include <mutex>
 
 #include <openssl/evp.h>
 #include <openssl/x509v3.h>
@@ -55,12 +56,15 @@ public: // Authenticator interface
     int Decrypt(beyond_authenticator_key_id id, const void *data, int size, const void *iv = nullptr, int ivsize = 0) override;
     int GetResult(void *&outData, int &outSize) override;
     int GetKey(beyond_authenticator_key_id id, void *&key, int &size) override;
+    int CreateCipher(CipherInterface *&cipher, const void *key = nullptr, int keySize = 0, const void *salt = nullptr, int saltSize = 0) override;
+    int GenerateRandom(void *buffer, int size) override;
 
     int VerifySignature(unsigned char *signedData, int signedDataSize, const unsigned char *original, int originalSize, bool &authentic) override;
     int GenerateSignature(const unsigned char *data, int dataSize, unsigned char *&encoded, int &encodedSize) override;
 
 private:
     class EventObject;
+    class Cipher;
 
     enum CRYPTO_OP {
         ENCRYPT = 0,
@@ -138,6 +142,7 @@ private:
     int CryptoSymmetric(int opid, beyond_authenticator_key_id id, const void *in, size_t inlen, void *&out, size_t &outlen, const void *iv, size_t ivsize);
     int CryptoAsymmetric(int opid, beyond_authenticator_key_id id, const void *in, size_t inlen, void *&out, size_t &outlen);
     int Crypto(int opid, beyond_authenticator_key_id id, const void *data, int size, const void *iv, int ivsize);
+    void ResetCryptoContext(void);
     int GetPrivateKey(void *&key, int &size);
     int GetPublicKey(void *&key, int &size);
     int GetCertificate(void *&key, int &size);
@@ -190,6 +195,17 @@ private: // SSL
         std::string secretKey;
     } sslContext;
 
+    // NOTE:
+    // The contexts of the Encrypt() and the Decrypt() are kept until the keys are changed.
+    // The asymmetric contexts are indexed by the CRYPTO_OP and the key (0: private key, 1: public key),
+    // the symmetric contexts are indexed by the CRYPTO_OP and they are initialized by the symmetricKey.
+    struct CryptoContext {
+        std::mutex lock;
+        EVP_PKEY_CTX *asymmetric[2][2] = {};
+        EVP_CIPHER_CTX *symmetric[2] = {};
+        std::string symmetricKey;
+    } cryptoCtx;
+
 private: // Asynchronous mode
     struct AsyncContext {
         beyond::EventLoop *eventLoop;
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BEYOND_AUTHENTICATOR_SSL_AUTHENTICATOR_CIPHER_H__
+#define __BEYOND_AUTHENTICATOR_SSL_AUTHENTICATOR_CIPHER_H__
+
+#include <mutex>
+#include <vector>
+
+#include <openssl/evp.h>
+
+// NOTE:
+// AES-256-GCM, the AES-NI is used by the EVP if the CPU has it.
+// The contexts are initialized by the key once, only the IV is set for each data.
+// The released contexts are kept for the next data, so there are as many contexts as the threads which use the cipher at the same time.
+class Authenticator::Cipher final : public beyond::AuthenticatorInterface::CipherInterface {
+public:
+    static constexpr int KEY_SIZE = 32;     // AES-256
+    static constexpr int MAX_CONTEXTS = 16; // released contexts which are kept for each operation
+    static constexpr const char *KEY_INFO = "beyond-cipher"; // the context of the derived key
+
+public:
+    // NOTE:
+    // The key is used as it is if it is KEY_SIZE bytes and there is no salt,
+    // or the key of the cipher is derived from the key and the salt by the HKDF (SHA-256).
+    static Cipher *Create(const void *key, int keySize, const void *salt = nullptr, int saltSize = 0);
+    void Destroy(void) override;
+
+    int Encrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, void *tag) override;
+    int Decrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, const void *tag) override;
+
+    int Begin(bool encrypt, const void *iv, const void *aad, int aadSize, Stream *&stream) override;
+    int Update(Stream *stream, const void *in, int size, void *out) override;
+    int End(Stream *stream, void *tag) override;
+
+private:
+    Cipher(void);
+    virtual ~Cipher(void);
+
+    int DeriveKey(const void *key, int keySize, const void *salt, int saltSize);
+
+    EVP_CIPHER_CTX *Acquire(int opid);
+    void Release(int opid, EVP_CIPHER_CTX *ctx);
+    int Start(EVP_CIPHER_CTX *ctx, const void *iv, const void *aad, int aadSize);
+
+private:
+    std::mutex lock;
+    unsigned char key[KEY_SIZE];
+    std::vector<EVP_CIPHER_CTX *> contexts[2]; // released contexts by the CRYPTO_OP
+};
+
+#endif // __BEYOND_AUTHENTICATOR_SSL_AUTHENTICATOR_CIPHER_H__
@@ -16,6 +16,7 @@
 
 #include "authenticator.h"
 #include "authenticator_event_object.h"
+#include "authenticator_cipher.h"
 
 #include "beyond/plugin/authenticator_ssl_plugin.h"
 
@@ -30,6 +31,7 @@
 #include <string>
 #include <exception>
 #include <memory>
+#include <mutex>
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -686,6 +688,10 @@ int Authenticator::CommandGenerate(Authenticator *inst, void *data)
 {
     int ret;
 
+    // NOTE:
+    // The keys are going to be changed
+    inst->ResetCryptoContext();
+
     if (inst->sslConfig.privateKey.empty() == true && inst->sslConfig.certificate.empty() == true) {
         ret = inst->GenerateKey();
         if (ret == 0) {
@@ -857,6 +863,8 @@ int Authenticator::Prepare(void)
 
 int Authenticator::CommandCleanup(Authenticator *inst, void *data)
 {
+    inst->ResetCryptoContext();
+
     EVP_PKEY_free(inst->sslContext.keypair);
     inst->sslContext.keypair = nullptr;
 
@@ -902,57 +910,67 @@ int Authenticator::CryptoAsymmetric(int opid, beyond_authenticator_key_id id, co
     };
 
     int ret;
+    int keyIdx = (id == BEYOND_AUTHENTICATOR_KEY_ID_PRIVATE_KEY) ? 0 : 1;
 
-    EVP_PKEY *key;
-    EVP_PKEY *_key = nullptr;
+    std::lock_guard<std::mutex> guard(cryptoCtx.lock);
 
-    if (id == BEYOND_AUTHENTICATOR_KEY_ID_PRIVATE_KEY) {
-        if (sslContext.keypair == nullptr) {
-            ErrPrint("Private key is not found");
-            return -EINVAL;
-        }
+    EVP_PKEY_CTX *ctx = cryptoCtx.asymmetric[opid][keyIdx];
+    if (ctx == nullptr) {
+        EVP_PKEY *key;
+        EVP_PKEY *_key = nullptr;
 
-        key = sslContext.keypair;
-    } else if (id == BEYOND_AUTHENTICATOR_KEY_ID_PUBLIC_KEY) {
-        if (sslContext.x509 == nullptr) {
-            ErrPrint("x509 certificate is not found");
-            return -EINVAL;
-        }
+        if (id == BEYOND_AUTHENTICATOR_KEY_ID_PRIVATE_KEY) {
+            if (sslContext.keypair == nullptr) {
+                ErrPrint("Private key is not found");
+                return -EINVAL;
+            }
 
-        key = X509_get_pubkey(sslContext.x509);
-        if (key == nullptr) {
-            SSLErrPrint("X509_get_pubkey");
-            return -EFAULT;
-        }
+            key = sslContext.keypair;
+        } else if (id == BEYOND_AUTHENTICATOR_KEY_ID_PUBLIC_KEY) {
+            if (sslContext.x509 == nullptr) {
+                ErrPrint("x509 certificate is not found");
+                return -EINVAL;
+            }
 
-        _key = key;
-    } else {
-        ErrPrint("Invalid key id");
-        return -EINVAL;
-    }
+            key = X509_get_pubkey(sslContext.x509);
+            if (key == nullptr) {
+                SSLErrPrint("X509_get_pubkey");
+                return -EFAULT;
+            }
 
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key, nullptr);
-    if (ctx == nullptr) {
-        SSLErrPrint("EVP_PKEY_CTX_new");
+            _key = key;
+        } else {
+            ErrPrint("Invalid key id");
+            return -EINVAL;
+        }
+
+        // NOTE:
+        // The context takes a reference of the key
+        ctx = EVP_PKEY_CTX_new(key, nullptr);
         EVP_PKEY_free(_key);
         _key = nullptr;
-        return -EFAULT;
-    }
+        if (ctx == nullptr) {
+            SSLErrPrint("EVP_PKEY_CTX_new");
+            return -EFAULT;
+        }
 
-    ret = 0;
-    do {
         if ((init[opid])(ctx) <= 0) {
             SSLErrPrint("EVP_PKEY_encrypt_init");
-            ret = -EFAULT;
-            break;
+            EVP_PKEY_CTX_free(ctx);
+            return -EFAULT;
         }
 
         if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) <= 0) {
             SSLErrPrint("EVP_PKEY_CTX_set_rsa_padding");
-            ret = -EFAULT;
-            break;
+            EVP_PKEY_CTX_free(ctx);
+            return -EFAULT;
         }
 
+        cryptoCtx.asymmetric[opid][keyIdx] = ctx;
+    }
+
+    ret = 0;
+    do {
         ret = (operation[opid])(ctx, nullptr, &outlen, static_cast<const unsigned char *>(in), inlen);
         if (ret == -2) {
             ErrPrint("Not supported");
@@ -966,10 +984,10 @@ int Authenticator::CryptoAsymmetric(int opid, beyond_authenticator_key_id id, co
 
         ret = 0;
 
-        out = calloc(1, outlen);
+        out = malloc(outlen);
         if (out == nullptr) {
             ret = -errno;
-            ErrPrintCode(errno, "calloc");
+            ErrPrintCode(errno, "malloc");
             break;
         }
 
@@ -982,11 +1000,6 @@ int Authenticator::CryptoAsymmetric(int opid, beyond_authenticator_key_id id, co
         }
     } while (0);
 
-    EVP_PKEY_CTX_free(ctx);
-    ctx = nullptr;
-    EVP_PKEY_free(_key);
-    _key = nullptr;
-
     return ret;
 }
 
@@ -1009,49 +1022,67 @@ int Authenticator::CryptoSymmetric(int opid, beyond_authenticator_key_id id, con
 
     int ret;
 
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (ctx == nullptr) {
-        return -EFAULT;
+    std::lock_guard<std::mutex> guard(cryptoCtx.lock);
+
+    if (cryptoCtx.symmetricKey != sslContext.secretKey) {
+        for (auto &ctx : cryptoCtx.symmetric) {
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = nullptr;
+        }
+        cryptoCtx.symmetricKey = sslContext.secretKey;
     }
 
-    ret = (init[opid])(ctx, EVP_aes_256_cbc(), nullptr, reinterpret_cast<const unsigned char *>(sslContext.secretKey.c_str()), static_cast<const unsigned char *>(iv));
-    if (ret != 1) {
-        SSLErrPrint("init");
-        EVP_CIPHER_CTX_free(ctx);
-        ctx = nullptr;
-        return -EFAULT;
+    // NOTE:
+    // The key schedule is prepared once, only the IV is set for the next data
+    EVP_CIPHER_CTX *ctx = cryptoCtx.symmetric[opid];
+    if (ctx == nullptr) {
+        ctx = EVP_CIPHER_CTX_new();
+        if (ctx == nullptr) {
+            return -EFAULT;
+        }
+
+        ret = (init[opid])(ctx, EVP_aes_256_cbc(), nullptr, reinterpret_cast<const unsigned char *>(cryptoCtx.symmetricKey.c_str()), static_cast<const unsigned char *>(iv));
+        if (ret != 1) {
+            SSLErrPrint("init");
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = nullptr;
+            return -EFAULT;
+        }
+
+        cryptoCtx.symmetric[opid] = ctx;
+    } else {
+        ret = (init[opid])(ctx, nullptr, nullptr, nullptr, static_cast<const unsigned char *>(iv));
+        if (ret != 1) {
+            SSLErrPrint("init");
+            EVP_CIPHER_CTX_free(ctx);
+            cryptoCtx.symmetric[opid] = nullptr;
+            return -EFAULT;
+        }
     }
 
     // Enable padding: default
     ret = EVP_CIPHER_CTX_set_padding(ctx, 1);
     if (ret != 1) {
         SSLErrPrint("set_padding");
-        EVP_CIPHER_CTX_free(ctx);
-        ctx = nullptr;
         return -EFAULT;
     }
 
+    // NOTE:
+    // The padding is always added by the encryption, a full block if the input is aligned to the block size.
+    // The output of the decryption is not larger than the input, but the EVP requires the room for a block.
     size_t blockSize = EVP_CIPHER_block_size(EVP_aes_256_cbc());
-    int paddingSize = inlen % blockSize;
-    paddingSize = (paddingSize == 0) ? 0 : (blockSize - paddingSize);
-    outlen = inlen + paddingSize;
-
-    out = calloc(1, outlen);
+    out = malloc(inlen + blockSize);
     if (out == nullptr) {
-        ErrPrintCode(errno, "calloc");
-        EVP_CIPHER_CTX_free(ctx);
-        ctx = nullptr;
+        ErrPrintCode(errno, "malloc");
         return -ENOMEM;
     }
 
-    int _outlen = outlen;
+    int _outlen = 0;
     ret = (operation[opid])(ctx, static_cast<unsigned char *>(out), &_outlen, static_cast<const unsigned char *>(in), inlen);
     if (ret != 1) {
         SSLErrPrint("operation");
         free(out);
         out = nullptr;
-        EVP_CIPHER_CTX_free(ctx);
-        ctx = nullptr;
         return -EFAULT;
     }
 
@@ -1061,26 +1092,31 @@ int Authenticator::CryptoSymmetric(int opid, beyond_authenticator_key_id id, con
         SSLErrPrint("finalize");
         free(out);
         out = nullptr;
-        EVP_CIPHER_CTX_free(ctx);
-        ctx = nullptr;
         return -EFAULT;
     }
 
-    _outlen += tmplen;
-    if (_outlen < static_cast<int>(outlen)) {
-        void *_out = realloc(out, _outlen);
-        if (_out == nullptr) {
-            ErrPrintCode(errno, "realloc, go ahead");
-        } else {
-            out = _out;
+    outlen = _outlen + tmplen;
+    return 0;
+}
+
+void Authenticator::ResetCryptoContext(void)
+{
+    std::lock_guard<std::mutex> guard(cryptoCtx.lock);
+
+    for (auto &contexts : cryptoCtx.asymmetric) {
+        for (auto &ctx : contexts) {
+            EVP_PKEY_CTX_free(ctx);
+            ctx = nullptr;
         }
+    }
 
-        outlen = _outlen;
+    for (auto &ctx : cryptoCtx.symmetric) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = nullptr;
     }
 
-    EVP_CIPHER_CTX_free(ctx);
-    ctx = nullptr;
-    return 0;
+    OPENSSL_cleanse(&cryptoCtx.symmetricKey[0], cryptoCtx.symmetricKey.size());
+    cryptoCtx.symmetricKey.clear();
 }
 
 // NOTE:
@@ -1588,6 +1624,56 @@ int Authenticator::GetKey(beyond_authenticator_key_id id, void *&key, int &size)
     return ret;
 }
 
+int Authenticator::CreateCipher(CipherInterface *&cipher, const void *key, int keySize, const void *salt, int saltSize)
+{
+    std::string secretKey;
+
+    if (key == nullptr) {
+        // NOTE:
+        // The secret key is copied to the cipher, the cipher is not changed by the new secret key
+        secretKey = sslContext.secretKey;
+        if (secretKey.empty() == true) {
+            ErrPrint("Secret key is not prepared");
+            return -EINVAL;
+        }
+
+        key = secretKey.c_str();
+        keySize = static_cast<int>(secretKey.size());
+    } else if (keySize <= 0) {
+        ErrPrint("Invalid key size");
+        return -EINVAL;
+    }
+
+    if (salt != nullptr && saltSize <= 0) {
+        ErrPrint("Invalid salt size");
+        return -EINVAL;
+    }
+
+    Cipher *_cipher = Cipher::Create(key, keySize, salt, saltSize);
+    OPENSSL_cleanse(&secretKey[0], secretKey.size());
+    if (_cipher == nullptr) {
+        return -EFAULT;
+    }
+
+    cipher = _cipher;
+    return 0;
+}
+
+int Authenticator::GenerateRandom(void *buffer, int size)
+{
+    if (buffer == nullptr || size <= 0) {
+        ErrPrint("Invalid arguments");
+        return -EINVAL;
+    }
+
+    if (RAND_bytes(static_cast<unsigned char *>(buffer), size) != 1) {
+        SSLErrPrint("RAND_bytes");
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
 int Authenticator::GenerateSignature(const unsigned char *data, int dataSize, unsigned char *&encoded, int &encodedSize)
 {
     if (asyncCtx.eventLoop != nullptr) {
@@ -1914,6 +2000,7 @@ Authenticator::Authenticator(void)
 
 Authenticator::~Authenticator(void)
 {
+    ResetCryptoContext();
 }
 
 /* Add extension using V3 code: we can set the config file as NULL
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "authenticator.h"
+#include "authenticator_cipher.h"
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <exception>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+
+#define DEFAULT_MSG_BUFSZ 256
+
+#define SSLErrPrint(name)                                      \
+    do {                                                       \
+        char msg[DEFAULT_MSG_BUFSZ];                           \
+        ERR_error_string_n(ERR_get_error(), msg, sizeof(msg)); \
+        ErrPrint(name ": %s", msg);                            \
+    } while (0)
+
+struct beyond::AuthenticatorInterface::CipherInterface::Stream {
+    EVP_CIPHER_CTX *ctx;
+    int opid;
+};
+
+Authenticator::Cipher *Authenticator::Cipher::Create(const void *key, int keySize, const void *salt, int saltSize)
+{
+    if (key == nullptr || keySize <= 0) {
+        ErrPrint("Invalid key");
+        return nullptr;
+    }
+
+    Authenticator::Cipher *impl;
+
+    try {
+        impl = new Authenticator::Cipher();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    if (keySize == KEY_SIZE && salt == nullptr) {
+        memcpy(impl->key, key, KEY_SIZE);
+    } else if (impl->DeriveKey(key, keySize, salt, saltSize) < 0) {
+        delete impl;
+        impl = nullptr;
+        return nullptr;
+    }
+
+    return impl;
+}
+
+// NOTE:
+// The HKDF extracts the pseudorandom key from the key and the salt, and expands it to the KEY_SIZE,
+// the key which is not uniformly random (e.g. a password or a shared secret) is not used directly.
+// Without the salt, the extraction uses the zero filled salt (RFC 5869).
+int Authenticator::Cipher::DeriveKey(const void *key, int keySize, const void *salt, int saltSize)
+{
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    if (ctx == nullptr) {
+        SSLErrPrint("EVP_PKEY_CTX_new_id");
+        return -EFAULT;
+    }
+
+    int ret = -EFAULT;
+    size_t size = KEY_SIZE;
+
+    do {
+        if (EVP_PKEY_derive_init(ctx) <= 0) {
+            SSLErrPrint("EVP_PKEY_derive_init");
+            break;
+        }
+
+        if (EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) <= 0) {
+            SSLErrPrint("EVP_PKEY_CTX_set_hkdf_md");
+            break;
+        }
+
+        if (salt != nullptr && EVP_PKEY_CTX_set1_hkdf_salt(ctx, static_cast<const unsigned char *>(salt), saltSize) <= 0) {
+            SSLErrPrint("EVP_PKEY_CTX_set1_hkdf_salt");
+            break;
+        }
+
+        if (EVP_PKEY_CTX_set1_hkdf_key(ctx, static_cast<const unsigned char *>(key), keySize) <= 0) {
+            SSLErrPrint("EVP_PKEY_CTX_set1_hkdf_key");
+            break;
+        }
+
+        if (EVP_PKEY_CTX_add1_hkdf_info(ctx, reinterpret_cast<const unsigned char *>(KEY_INFO), static_cast<int>(strlen(KEY_INFO))) <= 0) {
+            SSLErrPrint("EVP_PKEY_CTX_add1_hkdf_info");
+            break;
+        }
+
+        if (EVP_PKEY_derive(ctx, this->key, &size) <= 0 || size != KEY_SIZE) {
+            SSLErrPrint("EVP_PKEY_derive");
+            break;
+        }
+
+        ret = 0;
+    } while (0);
+
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+void Authenticator::Cipher::Destroy(void)
+{
+    delete this;
+}
+
+EVP_CIPHER_CTX *Authenticator::Cipher::Acquire(int opid)
+{
+    EVP_CIPHER_CTX *ctx = nullptr;
+
+    lock.lock();
+    if (contexts[opid].empty() == false) {
+        ctx = contexts[opid].back();
+        contexts[opid].pop_back();
+    }
+    lock.unlock();
+
+    if (ctx != nullptr) {
+        return ctx;
+    }
+
+    ctx = EVP_CIPHER_CTX_new();
+    if (ctx == nullptr) {
+        SSLErrPrint("EVP_CIPHER_CTX_new");
+        return nullptr;
+    }
+
+    // NOTE:
+    // The key schedule is prepared once for the context, the default IV length of the GCM is the IV_SIZE
+    if (EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), nullptr, key, nullptr, opid == CRYPTO_OP::ENCRYPT ? 1 : 0) != 1) {
+        SSLErrPrint("EVP_CipherInit_ex");
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = nullptr;
+        return nullptr;
+    }
+
+    return ctx;
+}
+
+void Authenticator::Cipher::Release(int opid, EVP_CIPHER_CTX *ctx)
+{
+    lock.lock();
+    if (contexts[opid].size() < static_cast<size_t>(MAX_CONTEXTS)) {
+        try {
+            contexts[opid].push_back(ctx);
+            ctx = nullptr;
+        } catch (std::exception &e) {
+            ErrPrint("push_back: %s", e.what());
+        }
+    }
+    lock.unlock();
+
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+int Authenticator::Cipher::Start(EVP_CIPHER_CTX *ctx, const void *iv, const void *aad, int aadSize)
+{
+    if (EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, static_cast<const unsigned char *>(iv), -1) != 1) {
+        SSLErrPrint("EVP_CipherInit_ex");
+        return -EFAULT;
+    }
+
+    if (aad != nullptr && aadSize > 0) {
+        int len = 0;
+        if (EVP_CipherUpdate(ctx, nullptr, &len, static_cast<const unsigned char *>(aad), aadSize) != 1) {
+            SSLErrPrint("EVP_CipherUpdate");
+            return -EFAULT;
+        }
+    }
+
+    return 0;
+}
+
+int Authenticator::Cipher::Encrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, void *tag)
+{
+    if (iv == nullptr || tag == nullptr || size < 0 || (size > 0 && (in == nullptr || out == nullptr))) {
+        ErrPrint("Invalid argument");
+        return -EINVAL;
+    }
+
+    EVP_CIPHER_CTX *ctx = Acquire(CRYPTO_OP::ENCRYPT);
+    if (ctx == nullptr) {
+        return -EFAULT;
+    }
+
+    int ret = Start(ctx, iv, aad, aadSize);
+    if (ret < 0) {
+        EVP_CIPHER_CTX_free(ctx);
+        return ret;
+    }
+
+    int len = 0;
+    if (size > 0 && EVP_EncryptUpdate(ctx, static_cast<unsigned char *>(out), &len, static_cast<const unsigned char *>(in), size) != 1) {
+        SSLErrPrint("EVP_EncryptUpdate");
+        EVP_CIPHER_CTX_free(ctx);
+        return -EFAULT;
+    }
+
+    // NOTE:
+    // The GCM is a stream cipher, there is no output on finalizing
+    int tmplen = 0;
+    if (EVP_EncryptFinal_ex(ctx, static_cast<unsigned char *>(out) + len, &tmplen) != 1) {
+        SSLErrPrint("EVP_EncryptFinal_ex");
+        EVP_CIPHER_CTX_free(ctx);
+        return -EFAULT;
+    }
+
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_SIZE, tag) != 1) {
+        SSLErrPrint("EVP_CIPHER_CTX_ctrl");
+        EVP_CIPHER_CTX_free(ctx);
+        return -EFAULT;
+    }
+
+    Release(CRYPTO_OP::ENCRYPT, ctx);
+    return 0;
+}
+
+int Authenticator::Cipher::Decrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, const void *tag)
+{
+    if (iv == nullptr || tag == nullptr || size < 0 || (size > 0 && (in == nullptr || out == nullptr))) {
+        ErrPrint("Invalid argument");
+        return -EINVAL;
+    }
+
+    EVP_CIPHER_CTX *ctx = Acquire(CRYPTO_OP::DECRYPT);
+    if (ctx == nullptr) {
+        return -EFAULT;
+    }
+
+    int ret = Start(ctx, iv, aad, aadSize);
+    if (ret < 0) {
+        EVP_CIPHER_CTX_free(ctx);
+        return ret;
+    }
+
+    int len = 0;
+    if (size > 0 && EVP_DecryptUpdate(ctx, static_cast<unsigned char *>(out), &len, static_cast<const unsigned char *>(in), size) != 1) {
+        SSLErrPrint("EVP_DecryptUpdate");
+        EVP_CIPHER_CTX_free(ctx);
+        return -EFAULT;
+    }
+
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, const_cast<void *>(tag)) != 1) {
+        SSLErrPrint("EVP_CIPHER_CTX_ctrl");
+        EVP_CIPHER_CTX_free(ctx);
+        return -EFAULT;
+    }
+
+    int tmplen = 0;
+    ret = EVP_DecryptFinal_ex(ctx, static_cast<unsigned char *>(out) + len, &tmplen);
+    Release(CRYPTO_OP::DECRYPT, ctx);
+
+    if (ret <= 0) {
+        // NOTE:
+        // The decrypted data must not be used if it is not authentic
+        ErrPrint("Not authentic");
+        if (size > 0) {
+            OPENSSL_cleanse(out, size);
+        }
+        return -EBADMSG;
+    }
+
+    return 0;
+}
+
+int Authenticator::Cipher::Begin(bool encrypt, const void *iv, const void *aad, int aadSize, Stream *&stream)
+{
+    if (iv == nullptr) {
+        ErrPrint("Invalid argument");
+        return -EINVAL;
+    }
+
+    Stream *_stream;
+    try {
+        _stream = new Stream();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return -ENOMEM;
+    }
+
+    _stream->opid = encrypt == true ? CRYPTO_OP::ENCRYPT : CRYPTO_OP::DECRYPT;
+    _stream->ctx = Acquire(_stream->opid);
+    if (_stream->ctx == nullptr) {
+        delete _stream;
+        _stream = nullptr;
+        return -EFAULT;
+    }
+
+    int ret = Start(_stream->ctx, iv, aad, aadSize);
+    if (ret < 0) {
+        EVP_CIPHER_CTX_free(_stream->ctx);
+        delete _stream;
+        _stream = nullptr;
+        return ret;
+    }
+
+    stream = _stream;
+    return 0;
+}
+
+int Authenticator::Cipher::Update(Stream *stream, const void *in, int size, void *out)
+{
+    if (stream == nullptr || size < 0 || (size > 0 && (in == nullptr || out == nullptr))) {
+        ErrPrint("Invalid argument");
+        return -EINVAL;
+    }
+
+    if (size == 0) {
+        return 0;
+    }
+
+    int len = 0;
+    if (EVP_CipherUpdate(stream->ctx, static_cast<unsigned char *>(out), &len, static_cast<const unsigned char *>(in), size) != 1) {
+        SSLErrPrint("EVP_CipherUpdate");
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int Authenticator::Cipher::End(Stream *stream, void *tag)
+{
+    if (stream == nullptr) {
+        ErrPrint("Invalid argument");
+        return -EINVAL;
+    }
+
+    int ret = 0;
+    int tmplen = 0;
+    unsigned char dummy[EVP_MAX_BLOCK_LENGTH];
+
+    if (tag == nullptr) {
+        ErrPrint("Invalid argument");
+        ret = -EINVAL;
+    } else if (stream->opid == CRYPTO_OP::ENCRYPT) {
+        if (EVP_EncryptFinal_ex(stream->ctx, dummy, &tmplen) != 1) {
+            SSLErrPrint("EVP_EncryptFinal_ex");
+            ret = -EFAULT;
+        } else if (EVP_CIPHER_CTX_ctrl(stream->ctx, EVP_CTRL_GCM_GET_TAG, TAG_SIZE, tag) != 1) {
+            SSLErrPrint("EVP_CIPHER_CTX_ctrl");
+            ret = -EFAULT;
+        }
+    } else {
+        if (EVP_CIPHER_CTX_ctrl(stream->ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, tag) != 1) {
+            SSLErrPrint("EVP_CIPHER_CTX_ctrl");
+            ret = -EFAULT;
+        } else if (EVP_DecryptFinal_ex(stream->ctx, dummy, &tmplen) <= 0) {
+            // NOTE:
+            // The data which is given by the Update() must be discarded
+            ErrPrint("Not authentic");
+            ret = -EBADMSG;
+        }
+    }
+
+    // NOTE:
+    // The context is initialized again by the Start(), it can be used by the next data
+    Release(stream->opid, stream->ctx);
+    delete stream;
+    return ret;
+}
+
+Authenticator::Cipher::Cipher(void)
+{
+}
+
+Authenticator::Cipher::~Cipher(void)
+{
+    for (auto &_contexts : contexts) {
+        for (auto ctx : _contexts) {
+            EVP_CIPHER_CTX_free(ctx);
+        }
+        _contexts.clear();
+    }
+
+    OPENSSL_cleanse(key, sizeof(key));
+}
@@ -2619,3 +2619,177 @@ TEST_F(AuthenticatorTest, PositiveDecrypt_Symmetric_Async)
 
     authenticator->Destroy();
 }
+
+TEST_F(AuthenticatorTest, PositiveCipher)
+{
+    char *argv[] = {
+        const_cast<char *>(::Authenticator::NAME),
+    };
+    int argc = sizeof(argv) / sizeof(char *);
+
+    optind = 0;
+    opterr = 0;
+    beyond::AuthenticatorInterface *authenticator = reinterpret_cast<beyond::AuthenticatorInterface *>(entry(argc, argv));
+    ASSERT_NE(authenticator, nullptr);
+
+    beyond_config options = {
+        .type = BEYOND_PLUGIN_AUTHENTICATOR_SSL_CONFIG_SSL,
+        .object = static_cast<void *>(&sslConfigNoCert),
+    };
+    int ret = authenticator->Configure(&options);
+    EXPECT_EQ(ret, 0);
+
+    ret = authenticator->Activate();
+    EXPECT_EQ(ret, 0);
+
+    ret = authenticator->Prepare();
+    EXPECT_EQ(ret, 0);
+
+    beyond::AuthenticatorInterface::CipherInterface *cipher = nullptr;
+    ret = authenticator->CreateCipher(cipher);
+    EXPECT_EQ(ret, 0);
+    ASSERT_NE(cipher, nullptr);
+
+    unsigned char iv[beyond::AuthenticatorInterface::CipherInterface::IV_SIZE] = { 1, 2, 3 };
+    unsigned char tag[beyond::AuthenticatorInterface::CipherInterface::TAG_SIZE];
+    unsigned char streamTag[beyond::AuthenticatorInterface::CipherInterface::TAG_SIZE];
+    char data[] = "hello world, hello tensors";
+    char streamData[sizeof(data)];
+
+    // In-place
+    ret = cipher->Encrypt(iv, "aad", 3, data, sizeof(data), data, tag);
+    EXPECT_EQ(ret, 0);
+    EXPECT_STRNE(data, "hello world, hello tensors");
+
+    beyond::AuthenticatorInterface::CipherInterface::Stream *stream = nullptr;
+    ret = cipher->Begin(true, iv, "aad", 3, stream);
+    EXPECT_EQ(ret, 0);
+    ret = cipher->Update(stream, "hello world, ", 13, streamData);
+    EXPECT_EQ(ret, 0);
+    ret = cipher->Update(stream, "hello tensors", sizeof("hello tensors"), streamData + 13);
+    EXPECT_EQ(ret, 0);
+    ret = cipher->End(stream, streamTag);
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(memcmp(data, streamData, sizeof(data)), 0);
+    EXPECT_EQ(memcmp(tag, streamTag, sizeof(tag)), 0);
+
+    ret = cipher->Decrypt(iv, "aad", 3, data, sizeof(data), data, tag);
+    EXPECT_EQ(ret, 0);
+    EXPECT_STREQ(data, "hello world, hello tensors");
+
+    cipher->Destroy();
+
+    ret = authenticator->Deactivate();
+    EXPECT_EQ(ret, 0);
+
+    authenticator->Destroy();
+}
+
+TEST_F(AuthenticatorTest, NegativeCipher_NotAuthentic)
+{
+    char *argv[] = {
+        const_cast<char *>(::Authenticator::NAME),
+    };
+    int argc = sizeof(argv) / sizeof(char *);
+
+    optind = 0;
+    opterr = 0;
+    beyond::AuthenticatorInterface *authenticator = reinterpret_cast<beyond::AuthenticatorInterface *>(entry(argc, argv));
+    ASSERT_NE(authenticator, nullptr);
+
+    const char sessionKey[] = "session key which is exchanged";
+    beyond::AuthenticatorInterface::CipherInterface *cipher = nullptr;
+    int ret = authenticator->CreateCipher(cipher, sessionKey, sizeof(sessionKey));
+    EXPECT_EQ(ret, 0);
+    ASSERT_NE(cipher, nullptr);
+
+    unsigned char iv[beyond::AuthenticatorInterface::CipherInterface::IV_SIZE] = { 1, 2, 3 };
+    unsigned char tag[beyond::AuthenticatorInterface::CipherInterface::TAG_SIZE];
+    char data[] = "hello world";
+    char out[sizeof(data)];
+
+    ret = cipher->Encrypt(iv, nullptr, 0, data, sizeof(data), out, tag);
+    EXPECT_EQ(ret, 0);
+
+    out[0] ^= 0x01;
+    ret = cipher->Decrypt(iv, nullptr, 0, out, sizeof(out), out, tag);
+    EXPECT_EQ(ret, -EBADMSG);
+
+    ret = cipher->Encrypt(iv, "aad", 3, data, sizeof(data), out, tag);
+    EXPECT_EQ(ret, 0);
+
+    ret = cipher->Decrypt(iv, "add", 3, out, sizeof(out), out, tag);
+    EXPECT_EQ(ret, -EBADMSG);
+
+    cipher->Destroy();
+
+    ret = authenticator->CreateCipher(cipher, sessionKey, 0);
+    EXPECT_EQ(ret, -EINVAL);
+
+    authenticator->Destroy();
+}
+
+TEST_F(AuthenticatorTest, PositiveCipher_Salt)
+{
+    char *argv[] = {
+        const_cast<char *>(::Authenticator::NAME),
+    };
+    int argc = sizeof(argv) / sizeof(char *);
+
+    optind = 0;
+    opterr = 0;
+    beyond::AuthenticatorInterface *authenticator = reinterpret_cast<beyond::AuthenticatorInterface *>(entry(argc, argv));
+    ASSERT_NE(authenticator, nullptr);
+
+    unsigned char salt[2][32] = {};
+    int ret = authenticator->GenerateRandom(salt[0], sizeof(salt[0]));
+    EXPECT_EQ(ret, 0);
+    ret = authenticator->GenerateRandom(salt[1], sizeof(salt[1]));
+    EXPECT_EQ(ret, 0);
+    EXPECT_NE(memcmp(salt[0], salt[1], sizeof(salt[0])), 0);
+
+    ret = authenticator->GenerateRandom(nullptr, sizeof(salt[0]));
+    EXPECT_EQ(ret, -EINVAL);
+
+    // NOTE:
+    // The ciphers of the same key and the same salt have the same key,
+    // the different salt derives the different key.
+    const char sessionKey[] = "session key which is exchanged";
+    beyond::AuthenticatorInterface::CipherInterface *cipher[3] = {};
+    ret = authenticator->CreateCipher(cipher[0], sessionKey, sizeof(sessionKey), salt[0], sizeof(salt[0]));
+    EXPECT_EQ(ret, 0);
+    ret = authenticator->CreateCipher(cipher[1], sessionKey, sizeof(sessionKey), salt[0], sizeof(salt[0]));
+    EXPECT_EQ(ret, 0);
+    ret = authenticator->CreateCipher(cipher[2], sessionKey, sizeof(sessionKey), salt[1], sizeof(salt[1]));
+    EXPECT_EQ(ret, 0);
+    ASSERT_NE(cipher[0], nullptr);
+    ASSERT_NE(cipher[1], nullptr);
+    ASSERT_NE(cipher[2], nullptr);
+
+    unsigned char iv[beyond::AuthenticatorInterface::CipherInterface::IV_SIZE] = { 1, 2, 3 };
+    unsigned char tag[beyond::AuthenticatorInterface::CipherInterface::TAG_SIZE];
+    char data[] = "hello world";
+    char out[sizeof(data)];
+
+    ret = cipher[0]->Encrypt(iv, nullptr, 0, data, sizeof(data), out, tag);
+    EXPECT_EQ(ret, 0);
+
+    char decrypted[sizeof(data)];
+    ret = cipher[1]->Decrypt(iv, nullptr, 0, out, sizeof(out), decrypted, tag);
+    EXPECT_EQ(ret, 0);
+    EXPECT_STREQ(decrypted, data);
+
+    ret = cipher[2]->Decrypt(iv, nullptr, 0, out, sizeof(out), decrypted, tag);
+    EXPECT_EQ(ret, -EBADMSG);
+
+    for (auto &_cipher : cipher) {
+        _cipher->Destroy();
+    }
+
+    beyond::AuthenticatorInterface::CipherInterface *invalid = nullptr;
+    ret = authenticator->CreateCipher(invalid, sessionKey, sizeof(sessionKey), salt[0], 0);
+    EXPECT_EQ(ret, -EINVAL);
+    EXPECT_EQ(invalid, nullptr);
+
+    authenticator->Destroy();
+}
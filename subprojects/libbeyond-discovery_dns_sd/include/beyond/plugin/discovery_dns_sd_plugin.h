@@ -27,6 +27,18 @@ extern "C" {
 #define BEYOND_PLUGIN_DISCOVERY_DNS_SD_ARGUMENT_NAME "--name"
 #define BEYOND_PLUGIN_DISCOVERY_DNS_SD_ARGUMENT_PORT "--port"
 
+// NOTE:
+// The TXT keys of the service which are given to the beyond_peer_info of the discovered peer.
+// The values are the strings, and they should be short because a TXT record is sent as a single packet.
+// The server sets them by the SetItem() and updates them at any time, the record is refreshed periodically.
+// The free memory is published by the discovery server itself.
+#define BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_UUID "uuid"
+#define BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_QUEUE "q"       // requests which are waiting or running on the server (decimal)
+#define BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_LATENCY "p50"   // recent median inference latency in usec (decimal)
+#define BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MEMORY "mem"    // free memory in KiB (decimal)
+#define BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_RUNTIMES "rt"   // runtimes and their devices, "tensorflow-lite:cpu,gpu;snpe:dsp"
+#define BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MODELS "md"     // digests (or their prefixes) of the loaded models, "digest,digest"
+
 #if defined(__cplusplus)
 }
 #endif
@@ -16,6 +16,9 @@
 #include "discovery_client.h"
 
 #include <fcntl.h>
+#include <limits.h>
+#include <cstdlib>
+#include <string>
 
 DiscoveryClient::DiscoveryClient()
 {
@@ -101,39 +104,76 @@ void DiscoveryClient::Destroy(void)
 
 int DiscoveryClient::Activate(void)
 {
-    return nsd.discoverServices(std::bind(&DiscoveryClient::onServiceDiscovered, this,
-                                          std::placeholders::_1, std::placeholders::_2));
+    return nsd.discoverServices(std::bind(&DiscoveryClient::onServicesDiscovered, this, std::placeholders::_1));
 }
 
-void DiscoveryClient::onServiceDiscovered(beyond_event_type event, DiscoveryInfo &info)
+// NOTE:
+// The events of a batch are written at once, a write which is not larger than the PIPE_BUF is atomic.
+// The events which cannot be written are dropped.
+void DiscoveryClient::onServicesDiscovered(std::vector<NsdManager::Event> &events)
 {
-    EventData *eventData = newEventData();
-    if (eventData == nullptr)
-        return;
+    static constexpr size_t MAX_WRITE = PIPE_BUF / sizeof(EventData *);
+    EventData *eventData[MAX_WRITE];
+
+    size_t idx = 0;
+    while (idx < events.size()) {
+        size_t count = 0;
+        while (idx < events.size() && count < MAX_WRITE) {
+            eventData[count] = newEventData(events[idx++]);
+            if (eventData[count] != nullptr) {
+                count++;
+            }
+        }
 
-    eventData->type = event;
-        auto *clientData = static_cast<client_event_data *>(eventData->data);
-        clientData->name = strdup(info.name.c_str());
-    switch (eventData->type) {
-    case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED:
-        memcpy(&(clientData->address), static_cast<const void *>(info.address), sizeof(struct sockaddr));
-        clientData->port = info.port;
-        snprintf(clientData->uuid, sizeof(clientData->uuid), "%s", info.uuid.c_str());
-        break;
-    case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_REMOVED:
-        // Do nothing
-        break;
-    default:
-        break;
+        if (count == 0) {
+            continue;
+        }
+
+        int ret = write(eventPipe[1], eventData, sizeof(EventData *) * count);
+        if (ret < 0) {
+            ErrPrintCode(errno, "write() Fail");
+            for (size_t i = 0; i < count; i++) {
+                EventObjectInterface::EventData *data = eventData[i];
+                DestroyEventData(data);
+            }
+        }
     }
+}
 
-    int ret = write(eventPipe[1], &eventData, sizeof(eventData));
-    if (ret < 0) {
-        ErrPrintCode(errno, "write() Fail");
+// NOTE:
+// The load which is published by the server, the malformed or missing values are left as 0 (unknown)
+void DiscoveryClient::fillLoad(client_event_data *clientData, const DiscoveryInfo &info)
+{
+    std::string value;
+
+    if (info.getValue(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_QUEUE, value) == true) {
+        clientData->queue_depth = static_cast<int>(strtol(value.c_str(), nullptr, 10));
+    }
+
+    if (info.getValue(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_LATENCY, value) == true) {
+        clientData->latency = static_cast<unsigned int>(strtoul(value.c_str(), nullptr, 10));
+    }
+
+    if (info.getValue(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MEMORY, value) == true) {
+        clientData->free_memory = strtoull(value.c_str(), nullptr, 10) * 1024llu;
+    }
+
+    if (info.getValue(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_RUNTIMES, value) == true && value.empty() == false) {
+        clientData->runtimes = strdup(value.c_str());
+        if (clientData->runtimes == nullptr) {
+            ErrPrintCode(errno, "strdup");
+        }
+    }
+
+    if (info.getValue(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MODELS, value) == true && value.empty() == false) {
+        clientData->models = strdup(value.c_str());
+        if (clientData->models == nullptr) {
+            ErrPrintCode(errno, "strdup");
+        }
     }
 }
 
-DiscoveryClient::EventData *DiscoveryClient::newEventData()
+DiscoveryClient::EventData *DiscoveryClient::newEventData(const NsdManager::Event &event)
 {
     EventData *eventData = nullptr;
     try {
@@ -144,6 +184,24 @@ DiscoveryClient::EventData *DiscoveryClient::newEventData()
         delete eventData;
         return nullptr;
     }
+
+    eventData->type = event.type;
+    auto *clientData = static_cast<client_event_data *>(eventData->data);
+    clientData->name = strdup(event.info.name.c_str());
+    switch (eventData->type) {
+    case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED:
+        memcpy(&(clientData->address), &(event.info.address), sizeof(clientData->address));
+        clientData->port = event.info.port;
+        snprintf(clientData->uuid, sizeof(clientData->uuid), "%s", event.info.uuid.c_str());
+        fillLoad(clientData, event.info);
+        break;
+    case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_REMOVED:
+        // Do nothing
+        break;
+    default:
+        break;
+    }
+
     return eventData;
 }
 
@@ -187,13 +245,18 @@ int DiscoveryClient::DestroyEventData(EventObjectInterface::EventData *&data)
     case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED: {
         auto clientData = static_cast<client_event_data *>(data->data);
         free(clientData->name);
+        free(clientData->runtimes);
+        free(clientData->models);
         delete clientData;
     } break;
     case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_REMOVED:
+    default: {
+        // NOTE:
+        // The error event has the name only, as the removed event
         auto clientData = static_cast<client_event_data *>(data->data);
         free(clientData->name);
         delete clientData;
-        break;
+    } break;
     }
 
     delete data;
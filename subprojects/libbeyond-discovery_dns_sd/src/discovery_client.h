@@ -18,6 +18,8 @@
 #include "discovery.h"
 #include "nsdmanager.h"
 
+#include <vector>
+
 class DiscoveryClient : public Discovery {
 public:
     DiscoveryClient();
@@ -38,8 +40,9 @@ public:
     int GetHandle(void) const override;
 
 private:
-    void onServiceDiscovered(beyond_event_type event, DiscoveryInfo &info);
-    EventData *newEventData();
+    void onServicesDiscovered(std::vector<NsdManager::Event> &events);
+    EventData *newEventData(const NsdManager::Event &event);
+    static void fillLoad(client_event_data *clientData, const DiscoveryInfo &info);
 
     int eventPipe[2];
     NsdManager nsd;
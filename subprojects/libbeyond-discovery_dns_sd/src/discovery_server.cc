@@ -19,6 +19,8 @@
 #include <cstring>
 
 DiscoveryServer::DiscoveryServer(const std::string name, uint16_t port)
+    : dirty(false)
+    , publishedMemory(0)
 {
     int err = pipe(eventPipe);
     if (err < 0) {
@@ -97,15 +99,66 @@ void DiscoveryServer::Destroy(void)
 
 int DiscoveryServer::Activate(void)
 {
-    return nsd.registerService(info, std::bind(&DiscoveryServer::onServiceRegistered, this, std::placeholders::_1));
+    std::unique_lock<std::mutex> guard(lock);
+    updateMemory();
+    dirty = false;
+    guard.unlock();
+
+    // NOTE:
+    // The info is not touched by the NsdManager after it is registered, the refresh gives a copy of it
+    return nsd.registerService(info, std::bind(&DiscoveryServer::onServiceRegistered, this, std::placeholders::_1),
+                               std::bind(&DiscoveryServer::onServiceRefresh, this, std::placeholders::_1));
+}
+
+// NOTE:
+// Must be called with the lock
+void DiscoveryServer::updateMemory()
+{
+    beyond_peer_info resource = {};
+    std::string storagePath;
+    beyond::ResourceInfoCollector collector(storagePath);
+    collector.collectResourceInfo(&resource);
+
+    unsigned long long memory = resource.free_memory / 1024llu;
+    unsigned long long delta = memory > publishedMemory ? memory - publishedMemory : publishedMemory - memory;
+    if (publishedMemory > 0 && delta <= publishedMemory / MEMORY_THRESHOLD) {
+        return;
+    }
+
+    std::string value = std::to_string(memory);
+    info.valueMap.erase(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MEMORY);
+    if (info.setValue(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MEMORY, DiscoveryInfo::Value(value.c_str(), value.size())) == 0) {
+        publishedMemory = memory;
+        dirty = true;
+    }
+}
+
+// NOTE:
+// This is invoked on the event loop of the NsdManager
+bool DiscoveryServer::onServiceRefresh(DiscoveryInfo &refreshed)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    updateMemory();
+    if (dirty == false) {
+        return false;
+    }
+
+    for (auto &element : info.valueMap) {
+        refreshed.valueMap.emplace(element.first, element.second);
+    }
+
+    dirty = false;
+    return true;
 }
 
 void DiscoveryServer::onServiceRegistered(std::string serviceName)
 {
+    std::unique_lock<std::mutex> guard(lock);
     if (serviceName != info.name) {
         DbgPrint("%s is renamed as %s", info.name.c_str(), serviceName.c_str());
         info.name = serviceName;
     }
+    guard.unlock();
 
     EventObjectInterface::EventData *eventData = newEventData();
     if (eventData == nullptr)
@@ -113,7 +166,7 @@ void DiscoveryServer::onServiceRegistered(std::string serviceName)
 
     eventData->type = beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_REGISTERED;
     auto *serverData = static_cast<server_event_data *>(eventData->data);
-    serverData->name = strdup(info.name.c_str());
+    serverData->name = strdup(serviceName.c_str());
 
     int ret = write(eventPipe[1], &eventData, sizeof(eventData));
     if (ret < 0) {
@@ -149,7 +202,13 @@ int DiscoveryServer::SetItem(const char *key, const void *value, uint8_t valueSi
         return -EINVAL;
     }
 
-    return info.setValue(key, DiscoveryInfo::Value(value, valueSize));
+    std::lock_guard<std::mutex> guard(lock);
+    int ret = info.setValue(key, DiscoveryInfo::Value(value, valueSize));
+    if (ret == 0) {
+        dirty = true;
+    }
+
+    return ret;
 }
 
 int DiscoveryServer::RemoveItem(const char *key)
@@ -160,7 +219,13 @@ int DiscoveryServer::RemoveItem(const char *key)
         return -EINVAL;
     }
 
-    return info.removeValue(key);
+    std::lock_guard<std::mutex> guard(lock);
+    int ret = info.removeValue(key);
+    if (ret == 0) {
+        dirty = true;
+    }
+
+    return ret;
 }
 
 int DiscoveryServer::FetchEventData(EventObjectInterface::EventData *&data)
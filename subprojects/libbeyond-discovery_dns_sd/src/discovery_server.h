@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <mutex>
 #include <string>
 #include "discovery.h"
 #include "nsdmanager.h"
@@ -30,6 +31,9 @@ public:
     int Activate(void) override;
     int Deactivate(void) override;
 
+    // NOTE:
+    // The items can be changed after the activation, the TXT record is refreshed by the next REFRESH_INTERVAL.
+    // An existing item is updated by removing it and setting it again.
     int SetItem(const char *key, const void *value, uint8_t valueSize) override;
     int RemoveItem(const char *key) override;
 
@@ -39,10 +43,21 @@ public:
     int GetHandle(void) const override;
 
 private:
+    // NOTE:
+    // The free memory is republished if it is changed more than 1/MEMORY_THRESHOLD of the published one
+    static constexpr int MEMORY_THRESHOLD = 16;
+
     void onServiceRegistered(std::string serviceName);
+    bool onServiceRefresh(DiscoveryInfo &refreshed);
+    void updateMemory();
     EventData *newEventData();
 
     int eventPipe[2];
     NsdManager nsd;
+    // NOTE:
+    // The info is updated by the SetItem() and the RemoveItem() while it is published on the event loop
+    std::mutex lock;
     DiscoveryInfo info;
+    bool dirty;
+    unsigned long long publishedMemory; // KiB
 };
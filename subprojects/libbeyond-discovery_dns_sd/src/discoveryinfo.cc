@@ -19,10 +19,11 @@
 #include <beyond/private/beyond_private.h>
 
 DiscoveryInfo::DiscoveryInfo()
-    : address(nullptr)
+    : address()
     , name("BeyonD")
     , port(3000)
 {
+    address.ss_family = AF_UNSPEC;
 }
 
 int DiscoveryInfo::setValue(const std::string &key, Value val)
@@ -48,6 +49,17 @@ int DiscoveryInfo::removeValue(const std::string &key)
     return 0;
 }
 
+bool DiscoveryInfo::getValue(const std::string &key, std::string &val) const
+{
+    auto result = valueMap.find(key);
+    if (result == valueMap.end()) {
+        return false;
+    }
+
+    val = std::string(static_cast<const char *>(result->second.value), result->second.size);
+    return true;
+}
+
 DiscoveryInfo::Value::Value(const void *val, int len)
     : size(len)
 {
@@ -62,6 +74,21 @@ DiscoveryInfo::Value::Value(const Value &val)
     memcpy(value, val.value, size);
 }
 
+DiscoveryInfo::Value &DiscoveryInfo::Value::operator=(const Value &val)
+{
+    if (this == &val) {
+        return *this;
+    }
+
+    char *_value = new char[val.size];
+    memcpy(_value, val.value, val.size);
+
+    delete[] static_cast<char *>(value);
+    value = _value;
+    size = val.size;
+    return *this;
+}
+
 DiscoveryInfo::Value::~Value()
 {
     delete[] static_cast<char*>(value);
@@ -26,6 +26,8 @@ public:
         Value(const Value &val);
         ~Value();
 
+        Value &operator=(const Value &val);
+
         void *value;
         int size;
     };
@@ -34,8 +36,11 @@ public:
 
     int setValue(const std::string &key, Value val);
     int removeValue(const std::string &key);
+    bool getValue(const std::string &key, std::string &val) const;
 
-    const struct sockaddr *address;
+    // NOTE:
+    // AF_INET or AF_INET6, it is kept by the value because the resolved info is cached
+    struct sockaddr_storage address;
     std::string name;
     uint16_t port;
     std::string uuid;
@@ -90,17 +90,20 @@ void NsdEventLoop::run()
     loop = std::thread([this]() {
         bool isLoopRun = true;
         while (isLoopRun) {
-            struct epoll_event events[2];
-            int event_count = epoll_pwait(epoll_fd, events, 1, -1, nullptr);
+            struct epoll_event events[MAX_EVENTS];
+            int event_count = epoll_pwait(epoll_fd, events, MAX_EVENTS, -1, nullptr);
             if (event_count > 0) {
                 for (int i = 0; i < event_count; i++) {
                     if (events[i].data.fd == looprun_fd) {
                         isLoopRun = false;
                         break;
                     } else {
+                        // NOTE:
+                        // The watch can be removed by a callback of the previous event of the same batch
                         auto result = callbackMap.find(events[i].data.fd);
                         if (result == callbackMap.end()) {
-                            ErrPrint("Invalid fd(%d), not found", events[i].data.fd);
+                            DbgPrint("fd(%d) is not watched anymore", events[i].data.fd);
+                            continue;
                         }
                         result->second();
                     }
@@ -26,6 +26,10 @@ public:
 
     typedef std::function<void()> eventCallback;
 
+    // NOTE:
+    // The number of the events which are handled at once, the results of many services arrive together
+    static constexpr int MAX_EVENTS = 32;
+
     void addWatch(int fd, eventCallback cb);
     void delWatch(int fd);
     void run();
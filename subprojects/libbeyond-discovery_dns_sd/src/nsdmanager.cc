@@ -16,22 +16,29 @@
 #include "nsdmanager.h"
 
 #include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <cstring>
 #include <functional>
 
 NsdManager::NsdManager()
     : svc(nullptr)
     , callbackData(nullptr)
+    , refreshFd(-1)
+    , moreComing(false)
 {
 }
 
 NsdManager::~NsdManager()
 {
     if (svc) {
-        DNSServiceRefDeallocate(svc);
+        stopService();
     }
+
+    delete callbackData;
 }
 
-int NsdManager::discoverServices(CallbackWithInfo cb)
+int NsdManager::discoverServices(CallbackWithEvents cb)
 {
     InfoPrint("discoverServices");
     if (svc) {
@@ -39,12 +46,22 @@ int NsdManager::discoverServices(CallbackWithInfo cb)
         return -EALREADY;
     }
 
-    auto *cbData = new NsdDiscoverData(this, cb);
-    auto err = DNSServiceBrowse(&svc, 0, kDNSServiceInterfaceIndexAny,
-                                REGTYPE, DOMAIN_LOCAL, discover_reply, cbData);
+    auto err = DNSServiceCreateConnection(&svc);
     if (err != kDNSServiceErr_NoError || svc == nullptr) {
+        ErrPrint("DNSServiceCreateConnection() Fail(%d)", err);
+        svc = nullptr;
+        return -EFAULT;
+    }
+
+    auto *cbData = new NsdDiscoverData(this, cb);
+    DNSServiceRef browseSvc = svc;
+    err = DNSServiceBrowse(&browseSvc, kDNSServiceFlagsShareConnection, kDNSServiceInterfaceIndexAny,
+                           REGTYPE, DOMAIN_LOCAL, discover_reply, cbData);
+    if (err != kDNSServiceErr_NoError) {
         ErrPrint("DNSServiceBrowse failed");
         delete cbData;
+        DNSServiceRefDeallocate(svc);
+        svc = nullptr;
         return -EFAULT;
     }
 
@@ -52,7 +69,7 @@ int NsdManager::discoverServices(CallbackWithInfo cb)
     callbackData = cbData;
 
     try {
-        eventLoop.addWatch(DNSServiceRefSockFD(svc), std::bind(&process_result, svc));
+        eventLoop.addWatch(DNSServiceRefSockFD(svc), std::bind(&process_results, this));
         eventLoop.run();
     } catch (NsdLoopException &e) {
         stopServiceDiscovery();
@@ -73,47 +90,76 @@ void NsdManager::discover_reply(DNSServiceRef sdRef, DNSServiceFlags flags,
         return;
     }
 
+    NsdManager *nsd = cbData->nsd;
+    nsd->moreComing = (flags & kDNSServiceFlagsMoreComing) != 0;
+
+    if (errorCode != kDNSServiceErr_NoError) {
+        ErrPrint("DNSServiceBrowse() Fail(%d)", errorCode);
+        return;
+    }
+
+    // NOTE:
+    // The service is given for each interface which it is found on,
+    // it is discovered on the first one and removed on the last one.
     if (flags & kDNSServiceFlagsAdd) {
-        InfoPrint("%s added", serviceName);
-        int ret = cbData->nsd->resolveService(serviceName, cbData->discovered);
-        if (ret < 0 && cbData->discovered) {
-            DiscoveryInfo info;
-            info.name = serviceName;
-            info.port = 0;
-            cbData->discovered(beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR, info);
+        InfoPrint("%s added (interface: %u)", serviceName, interfaceIndex);
+        if (nsd->services[serviceName]++ > 0) {
+            return;
+        }
+
+        int ret = nsd->resolveService(serviceName);
+        if (ret < 0) {
+            Event event;
+            event.type = beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR;
+            event.info.name = serviceName;
+            event.info.port = 0;
+            nsd->pending.push_back(event);
         }
     } else {
-        InfoPrint("%s removed", serviceName);
-        DiscoveryInfo info;
-        info.name = serviceName;
-        cbData->discovered(beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_REMOVED, info);
+        InfoPrint("%s removed (interface: %u)", serviceName, interfaceIndex);
+        auto it = nsd->services.find(serviceName);
+        if (it == nsd->services.end()) {
+            DbgPrint("%s is not discovered", serviceName);
+            return;
+        }
+
+        if (--it->second > 0) {
+            return;
+        }
+        nsd->services.erase(it);
+
+        nsd->cancelResolve(serviceName);
+        nsd->cache.erase(serviceName);
+
+        Event event;
+        event.type = beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_REMOVED;
+        event.info.name = serviceName;
+        nsd->pending.push_back(event);
     }
 }
 
-int NsdManager::resolveService(std::string serviceName, CallbackWithInfo cb)
+int NsdManager::resolveService(const std::string &serviceName)
 {
     InfoPrint("resolveService");
-    auto *cbData = new NsdManager::NsdResolveData(this, cb);
-    cbData->info.name = serviceName;
-
-    int ret;
-    DNSServiceRef extraSvc;
-    ret = DNSServiceResolve(&extraSvc, 0, kDNSServiceInterfaceIndexAny, serviceName.c_str(),
-                            REGTYPE, DOMAIN_LOCAL, resolve_reply, cbData);
-    if (ret != kDNSServiceErr_NoError) {
-        ErrPrint("DNSServiceResolve() Fail(%d)", ret);
-        delete cbData;
-        return -EFAULT;
+
+    if (resolving.find(serviceName) != resolving.end()) {
+        DbgPrint("%s is being resolved", serviceName.c_str());
+        return 0;
     }
 
-    try {
-        eventLoop.addWatch(DNSServiceRefSockFD(extraSvc), std::bind(&process_result, extraSvc));
-    } catch (NsdLoopException &e) {
-        ErrPrintCode(errno, "addWatch() Fail(%d)", e.returnValue);
+    auto *cbData = new NsdManager::NsdResolveData(this, serviceName);
+
+    DNSServiceRef resolveSvc = svc;
+    auto err = DNSServiceResolve(&resolveSvc, kDNSServiceFlagsShareConnection, kDNSServiceInterfaceIndexAny, serviceName.c_str(),
+                                 REGTYPE, DOMAIN_LOCAL, resolve_reply, cbData);
+    if (err != kDNSServiceErr_NoError) {
+        ErrPrint("DNSServiceResolve() Fail(%d)", err);
         delete cbData;
         return -EFAULT;
     }
 
+    cbData->resolveRef = resolveSvc;
+    resolving.emplace(serviceName, cbData);
     return 0;
 }
 
@@ -124,34 +170,85 @@ void NsdManager::resolve_reply(DNSServiceRef sdref, const DNSServiceFlags flags,
 {
     DbgPrint("resolve_reply");
     auto *cbData = static_cast<NsdResolveData *>(context);
-    if (cbData == nullptr || cbData->nsd == nullptr || cbData->resolved == nullptr) {
+    if (cbData == nullptr || cbData->nsd == nullptr) {
         ErrPrint("Invalid Callback Data");
         return;
     }
 
+    NsdManager *nsd = cbData->nsd;
+    nsd->moreComing = (flags & kDNSServiceFlagsMoreComing) != 0;
+
+    // NOTE:
+    // The first result is enough, the resolve is stopped and the address of the host is looked up.
+    DNSServiceRefDeallocate(cbData->resolveRef);
+    cbData->resolveRef = nullptr;
+
+    if (errorCode != kDNSServiceErr_NoError) {
+        ErrPrint("DNSServiceResolve() Fail(%d)", errorCode);
+        nsd->finishResolve(cbData, beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR);
+        return;
+    }
+
     uint8_t valueLen = 0;
     auto value = TXTRecordGetValuePtr(txtLen, txtRecord, "uuid", &valueLen);
     if (value)
         cbData->info.uuid = std::string(static_cast<const char *>(value), valueLen);
     cbData->info.port = ntohs(opaqueport);
 
-    DNSServiceRef extraSvc;
-    auto err = DNSServiceGetAddrInfo(&extraSvc, 0, kDNSServiceInterfaceIndexAny, kDNSServiceProtocol_IPv4, hosttarget, addrinfo_reply, cbData);
+    // NOTE:
+    // Every item of the TXT record is kept, the load of the server is given by them
+    uint16_t count = TXTRecordGetCount(txtLen, txtRecord);
+    for (uint16_t i = 0; i < count; i++) {
+        char key[256];
+        const void *itemValue = nullptr;
+        uint8_t itemLen = 0;
+        if (TXTRecordGetItemAtIndex(txtLen, txtRecord, i, sizeof(key), key, &itemLen, &itemValue) != kDNSServiceErr_NoError) {
+            continue;
+        }
+
+        if (itemValue == nullptr) {
+            continue;
+        }
+
+        cbData->info.valueMap.erase(key);
+        cbData->info.setValue(key, DiscoveryInfo::Value(itemValue, itemLen));
+    }
+
+    cbData->host = std::string(hosttarget != nullptr ? hosttarget : "");
+
+    auto cached = nsd->cache.find(cbData->info.name);
+    if (cached != nsd->cache.end()) {
+        if (cached->second.expiry > std::chrono::steady_clock::now() && cached->second.host == cbData->host) {
+            // NOTE:
+            // The service is delivered when the results of the batch are flushed, the cache entry is kept as it is
+            DbgPrint("Address of %s is cached", cbData->info.name.c_str());
+            memcpy(&cbData->info.address, &cached->second.address, sizeof(cbData->info.address));
+            return;
+        }
+
+        nsd->cache.erase(cached);
+    }
+
+    // NOTE:
+    // The address is looked up on the interface which the service is resolved on,
+    // so the scope of a link-local IPv6 address is valid.
+    DNSServiceRef addrInfoSvc = nsd->svc;
+    auto err = DNSServiceGetAddrInfo(&addrInfoSvc, kDNSServiceFlagsShareConnection, ifIndex,
+                                     kDNSServiceProtocol_IPv4 | kDNSServiceProtocol_IPv6,
+                                     hosttarget, addrinfo_reply, cbData);
     if (err != kDNSServiceErr_NoError) {
         ErrPrint("DNSServiceGetAddrInfo failed");
-        cbData->resolved(beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR, cbData->info);
-        delete cbData;
+        nsd->finishResolve(cbData, beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR);
         return;
     }
-    try {
-        cbData->nsd->eventLoop.addWatch(DNSServiceRefSockFD(extraSvc), std::bind(&NsdManager::process_result, extraSvc));
-    } catch (NsdLoopException &e) {
-        ErrPrintCode(errno, "addWatch() Fail(%d)", e.returnValue);
-        cbData->resolved(beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR, cbData->info);
-        delete cbData;
-    }
+
+    cbData->addrInfoRef = addrInfoSvc;
 }
 
+// NOTE:
+// The address is not delivered here, but when the results of the batch are flushed.
+// The peers are serving on both IPv4 and IPv6, the IPv4 address is preferred because it does not need a scope,
+// the IPv6 address is replaced by the IPv4 address if it is given in the same batch.
 void NsdManager::addrinfo_reply(DNSServiceRef sdref, const DNSServiceFlags flags,
                                 uint32_t interfaceIndex, DNSServiceErrorType errorCode,
                                 const char *hostname, const struct sockaddr *address,
@@ -159,20 +256,114 @@ void NsdManager::addrinfo_reply(DNSServiceRef sdref, const DNSServiceFlags flags
 {
     DbgPrint("addrinfo_reply");
     auto *cbData = static_cast<NsdResolveData *>(context);
-    if (cbData == nullptr || cbData->nsd == nullptr || cbData->resolved == nullptr) {
+    if (cbData == nullptr || cbData->nsd == nullptr) {
         ErrPrint("No Callback Data");
         return;
     }
 
-    cbData->nsd->eventLoop.delWatch(DNSServiceRefSockFD(sdref));
-    DNSServiceRefDeallocate(sdref);
+    NsdManager *nsd = cbData->nsd;
+    nsd->moreComing = (flags & kDNSServiceFlagsMoreComing) != 0;
+
+    if (errorCode != kDNSServiceErr_NoError) {
+        ErrPrint("DNSServiceGetAddrInfo() Fail(%d)", errorCode);
+        if (cbData->info.address.ss_family == AF_UNSPEC) {
+            nsd->finishResolve(cbData, beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_ERROR);
+        }
+        return;
+    }
+
+    if ((flags & kDNSServiceFlagsAdd) == 0 || address == nullptr) {
+        return;
+    }
+
+    if (address->sa_family == AF_INET) {
+        memcpy(&cbData->info.address, address, sizeof(struct sockaddr_in));
+        cbData->ttl = ttl;
+    } else if (address->sa_family == AF_INET6 && cbData->info.address.ss_family == AF_UNSPEC) {
+        memcpy(&cbData->info.address, address, sizeof(struct sockaddr_in6));
+        cbData->ttl = ttl;
+    }
+}
+
+void NsdManager::finishResolve(NsdResolveData *cbData, beyond_event_type event)
+{
+    if (cbData->resolveRef != nullptr) {
+        DNSServiceRefDeallocate(cbData->resolveRef);
+        cbData->resolveRef = nullptr;
+    }
+
+    if (cbData->addrInfoRef != nullptr) {
+        DNSServiceRefDeallocate(cbData->addrInfoRef);
+        cbData->addrInfoRef = nullptr;
+    }
+
+    if (event == beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED && cbData->ttl > 0) {
+        cache.erase(cbData->info.name);
+        cache.emplace(cbData->info.name, CacheEntry{ cbData->host, cbData->info.address, std::chrono::steady_clock::now() + std::chrono::seconds(cbData->ttl) });
+    }
+
+    pending.push_back(Event{ event, cbData->info });
+
+    resolving.erase(cbData->info.name);
+    delete cbData;
+}
+
+void NsdManager::cancelResolve(const std::string &serviceName)
+{
+    auto it = resolving.find(serviceName);
+    if (it == resolving.end()) {
+        return;
+    }
+
+    NsdResolveData *cbData = it->second;
+    resolving.erase(it);
+
+    if (cbData->resolveRef != nullptr) {
+        DNSServiceRefDeallocate(cbData->resolveRef);
+    }
 
-    cbData->info.address = address;
-    cbData->resolved(beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED, cbData->info);
+    if (cbData->addrInfoRef != nullptr) {
+        DNSServiceRefDeallocate(cbData->addrInfoRef);
+    }
 
     delete cbData;
 }
 
+// NOTE:
+// Must be called after the event loop is stopped, and before the connection is deallocated
+void NsdManager::clearResolving()
+{
+    while (resolving.empty() == false) {
+        cancelResolve(resolving.begin()->first);
+    }
+
+    services.clear();
+    pending.clear();
+}
+
+void NsdManager::flushEvents()
+{
+    for (auto it = resolving.begin(); it != resolving.end();) {
+        NsdResolveData *cbData = it->second;
+        ++it;
+
+        if (cbData->info.address.ss_family != AF_UNSPEC) {
+            finishResolve(cbData, beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED);
+        }
+    }
+
+    if (pending.empty() == true) {
+        return;
+    }
+
+    auto *cbData = static_cast<NsdDiscoverData *>(callbackData);
+    if (cbData != nullptr && cbData->discovered) {
+        cbData->discovered(pending);
+    }
+
+    pending.clear();
+}
+
 int NsdManager::stopServiceDiscovery()
 {
     InfoPrint("DiscoveryClient Deactivate");
@@ -185,18 +376,8 @@ int NsdManager::stopServiceDiscovery()
     return ret;
 }
 
-int NsdManager::registerService(DiscoveryInfo &info, CallbackWithString cb)
+int NsdManager::buildTxtRecord(DiscoveryInfo &info, TXTRecordRef &txtRecord)
 {
-    InfoPrint("Request Register(name:%s, port:%u)", info.name.c_str(), info.port);
-
-    if (svc) {
-        ErrPrint("Register is already running");
-        return -EALREADY;
-    }
-
-    auto *cbData = new NsdRegisterData(this, cb);
-
-    TXTRecordRef txtRecord;
     TXTRecordCreate(&txtRecord, 0, nullptr);
     for (auto &element : info.valueMap) {
         const std::string &key = element.first;
@@ -209,10 +390,31 @@ int NsdManager::registerService(DiscoveryInfo &info, CallbackWithString cb)
         }
     }
 
+    return 0;
+}
+
+int NsdManager::registerService(DiscoveryInfo &info, CallbackWithString cb, CallbackWithRefresh refresh)
+{
+    InfoPrint("Request Register(name:%s, port:%u)", info.name.c_str(), info.port);
+
+    if (svc) {
+        ErrPrint("Register is already running");
+        return -EALREADY;
+    }
+
+    auto *cbData = new NsdRegisterData(this, cb);
+
+    TXTRecordRef txtRecord;
+    if (buildTxtRecord(info, txtRecord) < 0) {
+        delete cbData;
+        return -1;
+    }
+
     auto err = DNSServiceRegister(&svc, 0, kDNSServiceInterfaceIndexAny, info.name.c_str(),
                                   REGTYPE, DOMAIN_LOCAL, NULL, htons(info.port),
                                   TXTRecordGetLength(&txtRecord),
                                   TXTRecordGetBytesPtr(&txtRecord), register_reply, cbData);
+    TXTRecordDeallocate(&txtRecord);
     if (err != kDNSServiceErr_NoError || svc == nullptr) {
         ErrPrint("DNSServiceRegister() Fail(%d)", err);
         return -1;
@@ -220,6 +422,9 @@ int NsdManager::registerService(DiscoveryInfo &info, CallbackWithString cb)
 
     try {
         eventLoop.addWatch(DNSServiceRefSockFD(svc), std::bind(&process_result, svc));
+        if (refresh != nullptr && startRefresh(refresh) < 0) {
+            ErrPrint("The TXT record is not going to be refreshed");
+        }
         eventLoop.run();
     } catch (NsdLoopException &e) {
         unregisterService();
@@ -229,6 +434,90 @@ int NsdManager::registerService(DiscoveryInfo &info, CallbackWithString cb)
     return 0;
 }
 
+int NsdManager::startRefresh(CallbackWithRefresh refresh)
+{
+    refreshFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (refreshFd < 0) {
+        ErrPrintCode(errno, "timerfd_create");
+        return -errno;
+    }
+
+    struct itimerspec spec = {
+        .it_interval = { .tv_sec = REFRESH_INTERVAL, .tv_nsec = 0 },
+        .it_value = { .tv_sec = REFRESH_INTERVAL, .tv_nsec = 0 },
+    };
+    if (timerfd_settime(refreshFd, 0, &spec, nullptr) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "timerfd_settime");
+        close(refreshFd);
+        refreshFd = -1;
+        return ret;
+    }
+
+    try {
+        eventLoop.addWatch(refreshFd, std::bind(&refresh_timer, this));
+    } catch (NsdLoopException &e) {
+        close(refreshFd);
+        refreshFd = -1;
+        return e.returnValue;
+    }
+
+    refreshed = refresh;
+    return 0;
+}
+
+void NsdManager::stopRefresh()
+{
+    if (refreshFd < 0)
+        return;
+
+    try {
+        eventLoop.delWatch(refreshFd);
+    } catch (NsdLoopException &e) {
+        ErrPrint("delWatch() Fail(%d)", e.returnValue);
+    }
+
+    if (close(refreshFd) < 0) {
+        ErrPrintCode(errno, "close");
+    }
+    refreshFd = -1;
+    refreshed = nullptr;
+}
+
+// NOTE:
+// This is invoked on the event loop, the same thread which processes the results of the svc.
+// The record is updated only if the info is changed, mDNS announces the record on every update.
+void NsdManager::refresh_timer(NsdManager *nsd)
+{
+    uint64_t expirations;
+    if (read(nsd->refreshFd, &expirations, sizeof(expirations)) < 0) {
+        if (errno != EAGAIN) {
+            ErrPrintCode(errno, "read");
+        }
+        return;
+    }
+
+    if (nsd->svc == nullptr || nsd->refreshed == nullptr) {
+        return;
+    }
+
+    DiscoveryInfo info;
+    if (nsd->refreshed(info) == false) {
+        return;
+    }
+
+    TXTRecordRef txtRecord;
+    if (buildTxtRecord(info, txtRecord) < 0) {
+        return;
+    }
+
+    auto err = DNSServiceUpdateRecord(nsd->svc, nullptr, 0, TXTRecordGetLength(&txtRecord), TXTRecordGetBytesPtr(&txtRecord), 0);
+    if (err != kDNSServiceErr_NoError) {
+        ErrPrint("DNSServiceUpdateRecord() Fail(%d)", err);
+    }
+    TXTRecordDeallocate(&txtRecord);
+}
+
 void NsdManager::register_reply(DNSServiceRef sdref, const DNSServiceFlags flags,
                                 DNSServiceErrorType errorCode, const char *name,
                                 const char *regtype, const char *domain, void *context)
@@ -264,6 +553,9 @@ int NsdManager::stopService()
         ret = e.returnValue;
     }
 
+    stopRefresh();
+    clearResolving();
+
     DNSServiceRefDeallocate(svc);
     svc = nullptr;
 
@@ -275,16 +567,37 @@ void NsdManager::process_result(DNSServiceRef sdRef)
     DNSServiceProcessResult(sdRef);
 }
 
-inline NsdManager::NsdDiscoverData::NsdDiscoverData(NsdManager *obj, CallbackWithInfo cb)
+// NOTE:
+// The results which are already received are processed at once (kDNSServiceFlagsMoreComing),
+// and their events are delivered together.
+void NsdManager::process_results(NsdManager *nsd)
+{
+    int count = 0;
+    do {
+        nsd->moreComing = false;
+        auto err = DNSServiceProcessResult(nsd->svc);
+        if (err != kDNSServiceErr_NoError) {
+            ErrPrint("DNSServiceProcessResult() Fail(%d)", err);
+            break;
+        }
+    } while (nsd->moreComing == true && ++count < MAX_RESULTS);
+
+    nsd->flushEvents();
+}
+
+inline NsdManager::NsdDiscoverData::NsdDiscoverData(NsdManager *obj, CallbackWithEvents cb)
     : discovered(cb)
 {
     nsd = obj;
 }
 
-inline NsdManager::NsdResolveData::NsdResolveData(NsdManager *obj, CallbackWithInfo cb)
-    : resolved(cb)
+inline NsdManager::NsdResolveData::NsdResolveData(NsdManager *obj, const std::string &serviceName)
+    : resolveRef(nullptr)
+    , addrInfoRef(nullptr)
+    , ttl(0)
 {
     nsd = obj;
+    info.name = serviceName;
 }
 
 inline NsdManager::NsdRegisterData::NsdRegisterData(NsdManager *obj, CallbackWithString cb)
@@ -15,7 +15,11 @@
  */
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <map>
+#include <string>
+#include <vector>
 #include <dns_sd.h>
 #include <beyond/platform/beyond_platform.h>
 #include <beyond/private/beyond_private.h>
@@ -24,15 +28,33 @@
 
 class NsdManager {
 public:
+    struct Event {
+        beyond_event_type type;
+        DiscoveryInfo info;
+    };
+
     typedef std::function<void(std::string)> CallbackWithString;
-    typedef std::function<void(beyond_event_type, DiscoveryInfo &)> CallbackWithInfo;
+    // NOTE:
+    // The events are delivered in a batch, all of them are given by the results which are read at once
+    typedef std::function<void(std::vector<Event> &)> CallbackWithEvents;
+    // Fills the info and returns true if the TXT record of the registered service has to be updated
+    typedef std::function<bool(DiscoveryInfo &)> CallbackWithRefresh;
+
+    static constexpr int REFRESH_INTERVAL = 2; // sec
+    static constexpr int MAX_RESULTS = 64;     // results which are processed at once
 
     NsdManager();
     ~NsdManager();
 
-    int discoverServices(CallbackWithInfo cb);
+    // NOTE:
+    // The browse, the resolves and the address lookups share a connection to the daemon,
+    // so the services are resolved concurrently without a socket for each of them.
+    int discoverServices(CallbackWithEvents cb);
     int stopServiceDiscovery();
-    int registerService(DiscoveryInfo &serviceInfo, CallbackWithString cb);
+    // NOTE:
+    // If the refresh is given, it is invoked on the event loop every REFRESH_INTERVAL,
+    // so the TXT record can be updated while the service is registered.
+    int registerService(DiscoveryInfo &serviceInfo, CallbackWithString cb, CallbackWithRefresh refresh = nullptr);
     int unregisterService();
 
 private:
@@ -41,13 +63,27 @@ private:
         NsdManager *nsd;
     };
     struct NsdDiscoverData : public NsdCallbackData {
-        NsdDiscoverData(NsdManager *obj, CallbackWithInfo cb);
-        CallbackWithInfo discovered;
+        NsdDiscoverData(NsdManager *obj, CallbackWithEvents cb);
+        CallbackWithEvents discovered;
     };
     struct NsdResolveData : public NsdCallbackData {
-        NsdResolveData(NsdManager *obj, CallbackWithInfo cb);
+        NsdResolveData(NsdManager *obj, const std::string &serviceName);
         DiscoveryInfo info;
-        CallbackWithInfo resolved;
+        std::string host; // target host of the service
+        DNSServiceRef resolveRef;
+        DNSServiceRef addrInfoRef;
+        uint32_t ttl; // of the address
+    };
+    // NOTE:
+    // The address of the resolved host is kept for its TTL,
+    // a service which is browsed again (e.g. re-activating the discovery) is resolved without looking up the address.
+    // The port and the TXT record are always resolved again, the load of the server in the TXT record changes
+    // much more often than the address.
+    // It is dropped if the service is removed.
+    struct CacheEntry {
+        std::string host;
+        struct sockaddr_storage address;
+        std::chrono::steady_clock::time_point expiry;
     };
     struct NsdRegisterData : public NsdCallbackData {
         NsdRegisterData(NsdManager *obj, CallbackWithString cb);
@@ -69,7 +105,16 @@ private:
                                DNSServiceErrorType errorCode, const char *name,
                                const char *regtype, const char *domain, void *context);
     static void process_result(DNSServiceRef sdRef);
-    int resolveService(std::string serviceName, CallbackWithInfo cb);
+    static void process_results(NsdManager *nsd);
+    static void refresh_timer(NsdManager *nsd);
+    static int buildTxtRecord(DiscoveryInfo &info, TXTRecordRef &txtRecord);
+    int startRefresh(CallbackWithRefresh refresh);
+    void stopRefresh();
+    int resolveService(const std::string &serviceName);
+    void cancelResolve(const std::string &serviceName);
+    void finishResolve(NsdResolveData *cbData, beyond_event_type event);
+    void clearResolving();
+    void flushEvents();
     int stopService();
 
     static constexpr const char *REGTYPE = "_beyond._tcp";
@@ -78,4 +123,14 @@ private:
     DNSServiceRef svc;
     NsdEventLoop eventLoop;
     NsdCallbackData *callbackData;
+    CallbackWithRefresh refreshed;
+    int refreshFd;
+
+    // NOTE:
+    // They are only touched on the event loop, or after the event loop is stopped
+    std::map<std::string, int> services; // count of the interfaces which the service is found on
+    std::map<std::string, NsdResolveData *> resolving;
+    std::map<std::string, CacheEntry> cache;
+    std::vector<Event> pending;
+    bool moreComing;
 };
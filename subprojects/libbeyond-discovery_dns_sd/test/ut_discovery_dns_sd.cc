@@ -19,6 +19,7 @@
 #include <cstring>
 #include <cstdio>
 #include <arpa/inet.h>
+#include <netdb.h>
 #include <beyond/plugin/discovery_dns_sd_plugin.h>
 #include "discovery.h"
 #include "../src/discovery_client.h"
@@ -208,9 +209,8 @@ TEST_F(DiscoveryBasicTest, FetchEventData)
             ret = -EAGAIN;
             continue;
         }
-        auto addr_in = reinterpret_cast<struct sockaddr_in *>(&(data->address));
-        char b[32] = "";
-        inet_ntop(data->address.sa_family, &(addr_in->sin_addr), b, sizeof(b));
+        char b[64] = "";
+        getnameinfo(reinterpret_cast<struct sockaddr *>(&(data->address)), sizeof(data->address), b, sizeof(b), nullptr, 0, NI_NUMERICHOST);
         printf("b: %s\n", b);
         EXPECT_STRNE(b, "");
         if (strcmp(data->uuid, "testuuid") != STR_EQ) {
@@ -256,3 +256,73 @@ TEST_F(DiscoveryBasicTest, FetchEventData)
 
     client->Deactivate();
 }
+
+TEST_F(DiscoveryBasicTest, FetchEventDataWithLoad)
+{
+    EXPECT_EQ(server->SetItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_UUID, "testuuid", 8), 0);
+    EXPECT_EQ(server->SetItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_QUEUE, "3", 1), 0);
+    EXPECT_EQ(server->SetItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_LATENCY, "1500", 4), 0);
+    EXPECT_EQ(server->SetItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_RUNTIMES, "tensorflow-lite:cpu", 19), 0);
+    EXPECT_EQ(server->SetItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MODELS, "abc,def", 7), 0);
+    ASSERT_EQ(server->Activate(), 0);
+
+    // NOTE:
+    // An item can be updated after the activation
+    EXPECT_EQ(server->RemoveItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_QUEUE), 0);
+    EXPECT_EQ(server->SetItem(BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_QUEUE, "3", 1), 0);
+
+    beyond::EventObjectInterface::EventData *evtData = nullptr;
+
+    int ret;
+    for (int i = 0; i < 10; i++) {
+        ret = server->FetchEventData(evtData);
+        if (ret == -EAGAIN) {
+            usleep(100000);
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    EXPECT_EQ(ret, 0);
+    ASSERT_NE(evtData, nullptr);
+    server->DestroyEventData(evtData);
+
+    EXPECT_EQ(client->Activate(), 0);
+
+    for (int i = 0; i < 10; i++) {
+        ret = client->FetchEventData(evtData);
+        if (ret == -EAGAIN) {
+            usleep(100000);
+            continue;
+        }
+
+        ASSERT_EQ(ret, 0);
+        ASSERT_NE(evtData, nullptr);
+        ASSERT_EQ(static_cast<beyond_event_type>(evtData->type), beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED);
+
+        auto data = static_cast<struct beyond::DiscoveryInterface::RuntimeInterface::client_event_data *>(evtData->data);
+        if (strcmp(data->name, serverName) != STR_EQ) {
+            printf("data->name(%s) is not matched with serverName(%s). try again\n", data->name, serverName);
+            client->DestroyEventData(evtData);
+            ret = -EAGAIN;
+            continue;
+        }
+
+        EXPECT_EQ(data->queue_depth, 3);
+        EXPECT_EQ(data->latency, 1500u);
+        EXPECT_GT(data->free_memory, 0llu);
+        ASSERT_NE(data->runtimes, nullptr);
+        EXPECT_STREQ(data->runtimes, "tensorflow-lite:cpu");
+        ASSERT_NE(data->models, nullptr);
+        EXPECT_STREQ(data->models, "abc,def");
+
+        client->DestroyEventData(evtData);
+        break;
+    }
+
+    ASSERT_EQ(ret, 0);
+
+    server->Deactivate();
+    client->Deactivate();
+}
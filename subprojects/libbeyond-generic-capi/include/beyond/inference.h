@@ -49,6 +49,10 @@ API beyond_tensor_h beyond_inference_unref_tensor(beyond_tensor_h ptr);
 API int beyond_inference_prepare(beyond_inference_h handle);
 
 API int beyond_inference_do(beyond_inference_h handle, const beyond_tensor_h tensor, const void *context);
+// NOTE:
+// The output tensor could refer the buffers of the runtime directly (e.g. runtime_tflite --output-view).
+// It stays valid until it is released using beyond_inference_unref_tensor(), the next inference writes to another set of the buffers.
+// Release it as soon as it is consumed, the runtime reuses the released buffers instead of allocating the new ones.
 API int beyond_inference_get_output(beyond_inference_h handle, beyond_tensor_h *tensor, int *size);
 // TODO: will be removed in the next PR
 API int beyond_inference_get_input(beyond_inference_h handle, struct beyond_tensor **tensor, int *size);
@@ -18,6 +18,8 @@
 #include <cstring>
 #include <cerrno>
 
+#include <atomic>
+
 #include "beyond/platform/beyond_platform.h"
 #include "beyond/private/log_private.h"
 #include "beyond/common.h"
@@ -42,8 +44,38 @@ struct beyond_inference {
 
     void (*output)(beyond_inference_h handle, struct beyond_event_info *event, void *data);
     void *data;
+
+    // NOTE:
+    // A container is taken for every output, keep the released one to reuse it for the next output
+    std::atomic<beyond_tensor_container *> spareContainer;
 };
 
+static beyond_tensor_container *tensor_container_new(beyond_inference *handle)
+{
+    beyond_tensor_container *container = handle->spareContainer.exchange(nullptr);
+    if (container == nullptr) {
+        container = static_cast<beyond_tensor_container *>(malloc(sizeof(beyond_tensor_container)));
+        if (container == nullptr) {
+            ErrPrintCode(errno, "malloc");
+            return nullptr;
+        }
+    }
+
+    container->tensor = nullptr;
+    container->size = 0;
+    container->refcnt = 1;
+    container->handle = handle;
+    return container;
+}
+
+static void tensor_container_delete(beyond_tensor_container *container)
+{
+    beyond_inference *handle = static_cast<beyond_inference *>(container->handle);
+
+    container = handle->spareContainer.exchange(container);
+    free(container);
+}
+
 static beyond_tensor_container *tensor_container_ref(beyond_tensor_container *container)
 {
     ++container->refcnt;
@@ -60,10 +92,13 @@ static beyond_tensor_container *tensor_container_unref(beyond_tensor_container *
         if (beyond_generic_handle_get_handle<beyond::InferenceInterface>(_handle, inference) < 0 || inference == nullptr) {
             assert("inference handle is not valid");
         } else {
+            // NOTE:
+            // The output tensor could be a view of the runtime buffers (e.g. runtime_tflite --output-view),
+            // releasing the last reference gives the buffers back to the runtime.
             inference->FreeTensor(container->tensor, container->size);
             container->size = 0;
             container->tensor = nullptr; // tensor ptr will be reset to nullptr by FreeTensor() but for the readability
-            free(container);
+            tensor_container_delete(container);
             container = nullptr;
         }
     }
@@ -108,6 +143,7 @@ beyond_inference_h beyond_inference_create(beyond_session_h session, struct beyo
 
     handle->output = nullptr;
     handle->data = nullptr;
+    handle->spareContainer = nullptr;
 
     beyond_generic_handle_init(handle);
     beyond_generic_handle_set_handle(handle, inference);
@@ -277,20 +313,17 @@ beyond_tensor_h beyond_inference_allocate_tensor(beyond_inference_h handle, cons
         return nullptr;
     }
 
-    beyond_tensor_container *container = static_cast<beyond_tensor_container *>(malloc(sizeof(beyond_tensor_container)));
+    beyond_tensor_container *container = tensor_container_new(static_cast<beyond_inference *>(handle));
     if (container == nullptr) {
-        ErrPrintCode(errno, "malloc");
         return nullptr;
     }
 
-    container->refcnt = 1;
     container->size = size;
-    container->handle = handle;
 
     int ret = inference->AllocateTensor(info, container->size, container->tensor);
     if (ret < 0) {
         ErrPrint("Failed to allocate tensor");
-        free(container);
+        tensor_container_delete(container);
         container = nullptr;
         return nullptr;
     }
@@ -377,21 +410,14 @@ int beyond_inference_get_output(beyond_inference_h handle, beyond_tensor_h *ptr,
     if (beyond_generic_handle_get_handle<beyond::InferenceInterface>(handle, inference) < 0 || inference == nullptr) {
         return -EINVAL;
     }
-    beyond_tensor_container *container;
-
-    container = static_cast<beyond_tensor_container *>(malloc(sizeof(beyond_tensor_container)));
+    beyond_tensor_container *container = tensor_container_new(static_cast<beyond_inference *>(handle));
     if (container == nullptr) {
-        int ret = -errno;
-        ErrPrintCode(errno, "malloc");
-        return ret;
+        return -ENOMEM;
     }
 
-    container->refcnt = 1;
-    container->handle = handle;
-
     int ret = inference->GetOutput(container->tensor, container->size);
     if (ret < 0) {
-        free(container);
+        tensor_container_delete(container);
         container = nullptr;
         return ret;
     }
@@ -538,6 +564,8 @@ void beyond_inference_destroy(beyond_inference_h handle)
     beyond_generic_handle_set_handle(handle, nullptr);
     beyond_generic_handle_deinit(handle);
 
+    free(_handle->spareContainer.exchange(nullptr));
+
     delete _handle;
     _handle = nullptr;
 }
@@ -20,14 +20,42 @@
 #define BEYOND_PLUGIN_PEER_NN_NAME "peer_nn"
 #define BEYOND_PLUGIN_PEER_NN_ARGUMENT_SERVER "--server"
 #define BEYOND_PLUGIN_PEER_NN_ARGUMENT_STORAGE_PATH "--path"
+#define BEYOND_PLUGIN_PEER_NN_ARGUMENT_BATCH_SIZE "--batch-size"
+#define BEYOND_PLUGIN_PEER_NN_ARGUMENT_BATCH_TIMEOUT "--batch-timeout"
+#define BEYOND_PLUGIN_PEER_NN_ARGUMENT_MODEL_BUDGET "--model-budget"
+#define BEYOND_PLUGIN_PEER_NN_ARGUMENT_MODEL_CACHE "--model-cache"
+#define BEYOND_PLUGIN_PEER_NN_ARGUMENT_CREDITS "--credits"
+#define BEYOND_PLUGIN_PEER_NN_ARGUMENT_WORKERS "--workers"
 #define BEYOND_PLUGIN_PEER_NN_CONFIG_PIPELINE ('N')
 #define BEYOND_PLUGIN_PEER_NN_CONFIG_CA_AUTHENTICATOR (char)(0xca)
+// The server publishes its load (queue depth, median latency, runtimes and loaded models)
+// to the TXT record of the given discovery (beyond_discovery_h) periodically.
+#define BEYOND_PLUGIN_PEER_NN_CONFIG_DISCOVERY (char)(0xd5)
+
+// Policy of the client when the in-flight requests reach the limit
+enum beyond_plugin_peer_nn_drop_policy {
+    BEYOND_PLUGIN_PEER_NN_DROP_POLICY_DROP_OLDEST = 0, // The waiting request is canceled by the new one (default)
+    BEYOND_PLUGIN_PEER_NN_DROP_POLICY_DROP_NEWEST = 1, // The new request is canceled if there is a waiting request
+    BEYOND_PLUGIN_PEER_NN_DROP_POLICY_BLOCK = 2,       // The caller is blocked until a request is completed (-ETIMEDOUT after 10 sec)
+};
+
+// Data plane of the client which exchanges the tensors with the server
+enum beyond_plugin_peer_nn_transport {
+    BEYOND_PLUGIN_PEER_NN_TRANSPORT_CHANNEL = 0, // The tensor channel (TCP), or the RTP if the input is configured (default)
+    BEYOND_PLUGIN_PEER_NN_TRANSPORT_GRPC = 1,    // The streaming Infer RPC on the gRPC channel, only for the raw tensors
+};
 
 struct beyond_plugin_peer_nn_config {
     struct client_description {
         int input_type;
         char *preprocessing;
         char *postprocessing;
+        int max_inflight;   // Maximum in-flight requests, the server can lower it by its credits (0: unlimited)
+        int drop_policy;    // beyond_plugin_peer_nn_drop_policy
+        int transport;      // beyond_plugin_peer_nn_transport
+        int trace;          // Collects the per-stage latency of the requests, it is logged on deactivating (0: disabled)
+        char *trace_output; // Chrome trace (JSON) file of the requests which is written on deactivating (nullptr: not written)
+        int result_pool;    // Released output buffers which are kept for the next results (0: not kept)
     } client;
 
     struct server_description {
@@ -26,11 +26,22 @@
 #include "beyond/plugin/peer_nn_plugin.h"
 
 #define MASTER_KEY_SIZE 30
+// NOTE:
+// The requestId of a frame which is sent via the RTP is carried by the one-byte header extension of this id (64 bits, BE)
+#define RTP_REQUEST_EXTENSION_ID 1
 
 class Peer final : public beyond::InferenceInterface::PeerInterface {
 public:
     static constexpr const char *NAME = BEYOND_PLUGIN_PEER_NN_NAME;
-    static Peer *Create(bool isServer = false, const char *framework = nullptr, const char *accel = nullptr, const char *storagePath = nullptr);
+    // NOTE:
+    // The clients which are using the same model share a loaded model, the server multiplexes their requests.
+    // If the batchSize is greater than 1, the server batches those requests as well.
+    // The batchTimeout (usec) is the time window to collect the requests of a batch.
+    // The modelBudget (bytes) is the size of the models which the server keeps loaded after their clients are gone.
+    // The credits is the maximum in-flight requests of a client, it is given to the clients on preparing.
+    // The workers is the number of threads which run the pipelines of the clients (0: the number of the CPUs).
+    // The modelCache (bytes) is the size of the uploaded models which the server keeps in its storage (0: the default).
+    static Peer *Create(bool isServer = false, const char *framework = nullptr, const char *accel = nullptr, const char *storagePath = nullptr, int batchSize = 0, int batchTimeout = 0, size_t modelBudget = 0, int credits = 0, int workers = 0, size_t modelCache = 0);
 
 public: // module interface
     const char *GetModuleName(void) const override;
@@ -75,14 +86,30 @@ private:
     class GrpcClient;
     class GrpcServer;
     class Model;
+    class TensorChannel;
+    class Trace;
+    class ResultPool;
+
+    // NOTE:
+    // The unit tests reach the internal classes through them
+    friend class ResultPoolTest;
+    friend class TensorChannelTest;
+    friend class RegistryTest;
 
     struct ServerContext {
         Peer::GrpcServer *grpc;
         std::string storagePath;
+        int batchSize;
+        int batchTimeout;
+        size_t modelBudget;
+        int credits;
+        int workers;
+        size_t modelCache;
     };
 
     struct ClientContext {
         Peer::GrpcClient *grpc;
+        Peer::ResultPool *pool; // The output tensors which are given by the GetOutput()
         std::string framework;
         std::string accel;
     };
@@ -101,6 +128,8 @@ private:
     int ConfigureInput(const beyond_config *options);
     int ConfigureAuthenticator(const beyond_config *options);
     int ConfigureCAAuthenticator(const beyond_config *options);
+    int ConfigureDiscovery(const beyond_config *options);
+    int LoadModelWithDigest(const char *model, const std::string &digest, uint64_t size);
 
     static void ConfigureImageInput(beyond_input_config *config, std::ostringstream &client_format, std::ostringstream &server_format);
     static void ConfigureVideoInput(beyond_input_config *config, std::ostringstream &client_format, std::ostringstream &server_format);
@@ -120,6 +149,7 @@ private:
     beyond_plugin_peer_nn_config *reservedConfiguration;
     beyond::AuthenticatorInterface *authenticator;
     beyond::AuthenticatorInterface *caAuthenticator;
+    beyond::DiscoveryInterface *discovery; // The server publishes its load via this
 };
 
 #endif // __BEYOND_PEER_NN_PEER_H__
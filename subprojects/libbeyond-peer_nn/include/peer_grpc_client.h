@@ -30,7 +30,9 @@
 
 class Peer::GrpcClient {
 public:
-    constexpr static const int CHUNK_SIZE = 4096;
+    constexpr static const int CHUNK_SIZE = 64 * 1024;
+    constexpr static const int CONTROL_TIMEOUT = 10; // sec
+    constexpr static const int UPLOAD_TIMEOUT = 600; // sec
 
 public:
     class Gst;
@@ -43,7 +45,11 @@ public:
     int ExchangeKey(void);
 
     int LoadModel(const char *model);
-    int UploadModel(const char *model);
+    // NOTE:
+    // If the digest is given, the server keeps the model in its cache
+    // and the upload can be resumed from the offset which is given by the HasModel().
+    int HasModel(const char *model, const std::string &digest, uint64_t size, uint64_t &offset);
+    int UploadModel(const char *model, const std::string &digest = std::string(), uint64_t size = 0, uint64_t offset = 0);
 
     int GetInfo(beyond_peer_info *info);
 
@@ -52,7 +58,7 @@ public:
     int GetOutputTensorInfo(const beyond_tensor_info *&info, int &size);
     int SetOutputTensorInfo(const beyond_tensor_info *info, int size);
 
-    int Prepare(int &request_port, int &response_port);
+    int Prepare(int &request_port, int &response_port, int &credits, std::string &local_channel);
 
     int Stop(void);
 
@@ -66,6 +72,8 @@ private:
     virtual ~GrpcClient(void);
 
     uint64_t GetRandom();
+    void SetDeadline(::grpc::ClientContext &context, int timeout);
+    int ConvertStatus(const ::grpc::Status &status);
     void ResetTensorInfo(beyond_tensor_info *&info, int &size);
     int GetTensorInfoFromResponse(::peer_nn::TensorInfos &tensorInfos, beyond_tensor_info *&info, int &size);
     int SetRequest(::peer_nn::TensorInfos &request, const beyond_tensor_info *info, int size);
@@ -19,10 +19,13 @@
 
 #include "peer_grpc_client.h"
 #include "peer_model.h"
+#include "peer_tensor_channel.h"
+#include "peer_trace.h"
 
 #include <string>
 #include <memory>
-#include <queue>
+#include <map>
+#include <deque>
 
 #include <glib.h>
 #include <pthread.h>
@@ -32,15 +35,26 @@
 #include "beyond/plugin/peer_nn_plugin.h"
 
 #define SRCX_NAME "srcx"
-#define SINKX_NAME "sinkx"
+#define QUEUE_NAME "requestQueue"
+#define PAYLOADER_NAME "requestPayloader"
+#define BACKLOG_SIZE 1
+#define REQUEST_TIMEOUT 10000 // msec, the in-flight request without its result is considered as lost
+#define REQUEST_EXPIRE_INTERVAL 1000 // msec
 
 class Peer::GrpcClient::Gst final {
+public:
+    static constexpr uint64_t REQUEST_ID_NONE = UINT64_MAX;
+
 public:
     static Gst *Create(std::string &peerId, Peer::GrpcClient *grpcClient);
     void Destroy(void);
 
     int Configure(const beyond_plugin_peer_nn_config::client_description *options);
-    int Prepare(const char *host, int requestPort, int responsePort);
+    // NOTE:
+    // The credits is the maximum in-flight requests which is given by the server (0: unlimited)
+    // The localChannel is the name of the local channel of the server, it is used instead of the TCP port
+    // if the server is on the same host.
+    int Prepare(const char *host, int requestPort, int responsePort, int credits, const char *localChannel);
     int Invoke(const beyond_tensor *input, int size, const void *context);
     int GetOutput(beyond_tensor *&tensor, int &size);
     int Stop(void);
@@ -48,10 +62,13 @@ public:
     std::shared_ptr<Peer::Model> GetModel(void) const;
     unsigned long GetNonce(void) const;
     void SetNonce(unsigned long nonce = 0);
+    void GetStatistics(unsigned long long &dropped, unsigned long long &canceled);
+    bool IsTracing(void) const;
 
 private:
     class Source;
     class Sink;
+    class Stream;
     // There is a new thread for integrating the nnstreamer (gst_X) to the glib main loop.
     // The glib main loop is created on a newly created thread.
     // In order to control the nnstreamer thread, this command structure would be used.
@@ -76,6 +93,8 @@ private:
         GMainLoop *loop;
         Peer::GrpcClient::Gst::Source *gstSource;
         Peer::GrpcClient::Gst::Sink *gstSink;
+        Peer::GrpcClient::Gst::Stream *stream;
+        Peer::TensorChannel *channel;
         const CommandHandler cmdTable[Command::IdLast];
         std::unique_ptr<beyond::CommandObject> command;
         std::unique_ptr<beyond::CommandObject> output;
@@ -89,18 +108,31 @@ private:
         static gboolean CommandPrepare(GSource *source, gint *timeout);
         static gboolean CommandCheck(GSource *source);
         static gboolean CommandHandle(GSource *source, GSourceFunc callback, gpointer user_data);
+        static gboolean ExpireHandler(gpointer user_data);
         static void *Main(void *arg);
     };
 
+    // NOTE:
+    // If the request is nullptr, the raw tensors are sent via the tensor channel.
+    // The results are given via the tensor channel which is connected to the host:port.
+    // If the stream is true, the tensors and the results are exchanged via the Infer RPC instead of the channel.
+    // If the local is not nullptr, the local channel is tried first.
     struct PrepareData {
         gchar *request;
-        gchar *response;
+        gchar *host;
+        gchar *local;
+        int port;
+        bool stream;
     };
 
     struct InvokeData {
         const beyond_tensor *tensor;
         int size;
         const void *context;
+        uint64_t requestId;
+        bool sent; // The request passed the lossy queue of the request pipeline
+        uint64_t deadline; // usec (monotonic), the request is canceled if its result is not given until this
+        Peer::Trace::Record record; // Only if the tracing is enabled
     };
 
     struct RtpConfig {
@@ -113,12 +145,51 @@ private:
     Gst(void);
     virtual ~Gst(void);
 
-    static int TensorInfoToDesc(const beyond_tensor_info *info, int size, char *&strbuf, int &len);
+    void PushRequest(InvokeData *invokeData);
+    InvokeData *PopRequest(uint64_t requestId);
+    InvokeData *PopResult(uint64_t requestId);
+    // NOTE:
+    // Returns the requestId which passed the queue, or REQUEST_ID_NONE if it is unknown
+    uint64_t SentRequest(uint64_t requestId);
+    // NOTE:
+    // The result has the timestamps of receiving the result and the timing of the server if the tracing is enabled
+    void DeliverResult(uint64_t requestId, beyond_tensor *tensor, int size, const Peer::Trace::Record *result = nullptr);
+    void CancelResult(uint64_t requestId);
+    void CancelRequest(InvokeData *invokeData);
+    void CancelRequests(void);
+    void ExpireRequests(void);
+
+    int Dispatch(InvokeData *invokeData);
+    void DispatchBacklog(void);
+    bool HasCredit(void) const;
+
+    // NOTE:
+    // The result which is not delivered to the caller is released to the result pool of the peer
+    void FreeTensor(beyond_tensor *&tensor, int size);
 
 private:
     Peer::GrpcClient *grpcClient;
     unsigned long nonce;
-    pthread_mutex_t requestQueueMutex;
+    // NOTE:
+    // The pending requests are kept by their requestId until their results or cancellations are given.
+    // The requestId is carried by the header extension of the RTP packets (RTP_REQUEST_EXTENSION_ID),
+    // the results via the RTP are in order, the older requests which are sent already were lost.
+    pthread_mutex_t requestMutex;
+    std::map<uint64_t, InvokeData *> requestMap;
+    // NOTE:
+    // The in-flight requests (requestMap) are limited by the credits,
+    // which is the smaller one of the maxInflight of the client and the credits of the server.
+    // The requests over the limit block the caller or wait in the backlog, by the dropPolicy.
+    // The backlog is only touched on the gst thread, but it is guarded by the requestMutex
+    // because the blocked callers are counting it.
+    int maxInflight;
+    int dropPolicy;
+    int transport;
+    int credits;
+    pthread_cond_t creditCond;
+    std::deque<InvokeData *> backlog;
+    unsigned long long countOfDropped;
+    unsigned long long countOfCanceled;
     std::unique_ptr<beyond::CommandObject> command;
     std::unique_ptr<beyond::CommandObject> output;
     Thread threadCtx;
@@ -129,11 +200,13 @@ private:
     std::string preprocessing;
     std::string postprocessing;
     std::string secretKey;
-    std::queue<InvokeData *> requestQueue;
     std::string peerId;
+    uint64_t nextRequestId;
+    Peer::Trace *trace;
 };
 
 #include "peer_grpc_client_gst_sink.h"
 #include "peer_grpc_client_gst_source.h"
+#include "peer_grpc_client_gst_stream.h"
 
 #endif // __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_H__
@@ -18,29 +18,29 @@
 #define __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_SINK_H__
 
 #include <glib.h>
-#include <gst/gst.h>
 
 #include "peer_grpc_client_gst.h"
+#include "peer_tensor_channel.h"
 
+// NOTE:
+// The sink receives the results from the tensor channel,
+// the payloads are read into the output tensors directly.
 class Peer::GrpcClient::Gst::Sink final {
 public:
-    static Sink *Create(Peer::GrpcClient::Gst *gstClient, const gchar *pipelineDesc);
+    static Sink *Create(Peer::GrpcClient::Gst *gstClient, Peer::TensorChannel *channel);
     void Destroy(void);
 
     int Stop(void);
 
-    static void BusHandler(GstBus *bus, GstMessage *message, gpointer user_data);
-    static void NewDataHandler(GstElement *element, GstBuffer *buffer, gpointer user_data);
-    static void ParseCaps(GstCaps *caps);
+    static gboolean RecvHandler(gint fd, GIOCondition condition, gpointer user_data);
 
 private:
     Sink(void);
     ~Sink(void);
 
     Peer::GrpcClient::Gst *gstClient;
-    GstElement *pipeline;
-    GstElement *element;
-    GstBus *bus;
+    Peer::TensorChannel *channel;
+    GSource *source;
 };
 
 #endif // __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_SINK_H__
@@ -18,6 +18,7 @@
 #define __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_SOURCE_H__
 
 #include "peer_grpc_client_gst.h"
+#include "peer_tensor_channel.h"
 
 #include <glib.h>
 #include <gst/gst.h>
@@ -25,6 +26,12 @@
 class Peer::GrpcClient::Gst::Source final {
 public:
     static Source *Create(Peer::GrpcClient::Gst *gstClient, const gchar *pipelineDesc);
+    // NOTE:
+    // The raw tensors are sent via the tensor channel without the gst pipeline
+    static Source *Create(Peer::GrpcClient::Gst *gstClient, Peer::TensorChannel *channel);
+    // NOTE:
+    // The raw tensors are sent via the Infer RPC
+    static Source *Create(Peer::GrpcClient::Gst *gstClient, Peer::GrpcClient::Gst::Stream *stream);
     void Destroy(void);
 
     int Stop(void);
@@ -34,15 +41,30 @@ public:
     static void BusHandler(GstBus *bus, GstMessage *message, gpointer user_data);
     static void StartFeedHandler(GstElement *pipeline, guint size, gpointer user_data);
     static void StopFeedHandler(GstElement *pipeline, gpointer user_data);
+    static GstPadProbeReturn QueueProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+    static GstPadProbeReturn PayloaderProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+    static gboolean StampRequest(GstBuffer **buffer, guint idx, gpointer user_data);
 
 private:
     Source(void);
     ~Source(void);
 
+    int Send(Peer::GrpcClient::Gst::InvokeData *invokeData);
+
     Peer::GrpcClient::Gst *gstClient;
+    Peer::TensorChannel *channel;
+    Peer::GrpcClient::Gst::Stream *stream;
     GstElement *pipeline;
     GstElement *element;
     GstBus *bus;
+    // NOTE:
+    // The requestId is attached to the buffer as a reference timestamp meta of this caps,
+    // it is used to find out the requests which are dropped by the lossy queue.
+    GstCaps *requestCaps;
+    // NOTE:
+    // The requestId which passed the queue last, the payloader puts it to the RTP packets of the request.
+    // The queue and the payloader are running on the same streaming thread, it is not guarded.
+    uint64_t sendingId;
 };
 
 #endif // __BEYOND_PEER_NN_PEER_GST_CLIENT_SOURCE_H__
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_STREAM_H__
+#define __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_STREAM_H__
+
+#include <glib.h>
+#include <pthread.h>
+
+#include <memory>
+
+#include "peer_grpc_client_gst.h"
+#include "peer_nn.grpc.pb.h"
+
+// NOTE:
+// The stream exchanges the raw tensors and the results via the Infer RPC on the gRPC channel.
+// The requests are written on the gst thread, the results are read on the reader thread,
+// and they are handed over to the gst thread in order to be delivered like the results of the channel.
+class Peer::GrpcClient::Gst::Stream final {
+public:
+    static Stream *Create(Peer::GrpcClient::Gst *gstClient);
+    void Destroy(void);
+
+    int Send(Peer::GrpcClient::Gst::InvokeData *invokeData);
+    int Stop(void);
+
+private:
+    struct Result {
+        Peer::GrpcClient::Gst::Stream *stream;
+        ::peer_nn::InferResponse response;
+        bool closed;
+        uint64_t received; // Only if the tracing is enabled
+    };
+
+    Stream(void);
+    ~Stream(void);
+
+    static void *Main(void *arg);
+    static gboolean ResultHandler(gpointer user_data);
+    static void ResultDestroy(gpointer user_data);
+    static void ReleaseView(void *data);
+
+    Peer::GrpcClient::Gst *gstClient;
+    GMainContext *context;
+    std::unique_ptr<::grpc::ClientContext> clientContext;
+    std::unique_ptr<::grpc::ClientReaderWriter<::peer_nn::InferRequest, ::peer_nn::InferResponse>> stream;
+    pthread_t threadId;
+    bool threadCreated;
+    bool writesDone;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_GRPC_CLIENT_GST_STREAM_H__
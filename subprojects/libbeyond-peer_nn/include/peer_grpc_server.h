@@ -22,11 +22,20 @@
 
 #include <memory>
 #include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <pthread.h>
 
 class Peer::GrpcServer final : public ::peer_nn::RPC::Service {
 public:
+    static constexpr size_t DEFAULT_MODEL_CACHE = 1024 * 1024 * 1024; // bytes
+    static constexpr int MODEL_CACHE_GRACE = 600;                       // sec, a model is not removed while it is being used
+    static constexpr int PUBLISH_INTERVAL = 2;                          // sec, the load is published via the discovery
+    static constexpr size_t LATENCY_WINDOW = 256;                       // recent results of which the median latency is published
+    static constexpr size_t DIGEST_PREFIX = 16;                         // hex digits of a published digest, the TXT value is short
+
     static GrpcServer *Create(Peer *peer, const char *address, const char *certificate = nullptr, const char *privateKey = nullptr, const char *rootCert = nullptr);
     virtual void Destroy(void);
 
@@ -34,17 +43,24 @@ public:
     ::grpc::Status ExchangeKey(::grpc::ServerContext *context, const ::peer_nn::ExchangeKeyRequest *request, ::peer_nn::ExchangeKeyResponse *response) override;
     ::grpc::Status LoadModel(::grpc::ServerContext *context, const ::peer_nn::Model *request, ::peer_nn::Response *response) override;
     ::grpc::Status UploadModel(::grpc::ServerContext *context, ::grpc::ServerReader<::peer_nn::ModelFile> *reader, ::peer_nn::Response *response) override;
+    ::grpc::Status HasModel(::grpc::ServerContext *context, const ::peer_nn::ModelDigest *request, ::peer_nn::ModelStatus *response) override;
     ::grpc::Status GetInputTensorInfo(::grpc::ServerContext *context, const ::peer_nn::Empty *request, ::peer_nn::TensorInfos *response) override;
     ::grpc::Status SetInputTensorInfo(::grpc::ServerContext *context, const ::peer_nn::TensorInfos *request, ::peer_nn::Response *response) override;
     ::grpc::Status GetOutputTensorInfo(::grpc::ServerContext *context, const ::peer_nn::Empty *request, ::peer_nn::TensorInfos *response) override;
     ::grpc::Status SetOutputTensorInfo(::grpc::ServerContext *context, const ::peer_nn::TensorInfos *request, ::peer_nn::Response *response) override;
     ::grpc::Status Prepare(::grpc::ServerContext *context, const ::peer_nn::Empty *request, ::peer_nn::PreparedResponse *response) override;
+    ::grpc::Status Infer(::grpc::ServerContext *context, ::grpc::ServerReaderWriter<::peer_nn::InferResponse, ::peer_nn::InferRequest> *stream) override;
     ::grpc::Status Stop(::grpc::ServerContext *context, const ::peer_nn::Empty *request, ::peer_nn::Response *response) override;
     ::grpc::Status GetInfo(::grpc::ServerContext *context, const ::peer_nn::Empty *request, ::peer_nn::Info *response) override;
 
 private:
     class Auth;
     class Gst;
+    class Batcher;
+    class Registry;
+    class Pool;
+
+    friend class RegistryTest;
 
 private:
     GrpcServer(void);
@@ -53,13 +69,48 @@ private:
     int InfoToResponse(const beyond_tensor_info *info, int size, ::peer_nn::TensorInfos *response);
     int RequestToInfo(const ::peer_nn::TensorInfos *request, beyond_tensor_info *&info);
 
+    // NOTE:
+    // The model cache keeps the uploaded models named by their digest in the "models" directory of the storage path.
+    // The partially uploaded model has the ".part" suffix, the next upload resumes from its size.
+    int GetModelCacheDir(std::string &dir);
+    int GetModelCachePath(const std::string &digest, std::string &path);
+    // NOTE:
+    // Remove the least recently used models (access time) until the cache fits to its size.
+    // HasModel() updates the access time of the model which is hit. Must be called with the uploadLock.
+    void TrimModelCache(void);
+    int ReceiveModel(Peer::GrpcServer::Gst *gst, ::grpc::ServerReader<::peer_nn::ModelFile> *reader, ::peer_nn::ModelFile &fileContents);
+    int WriteModel(Peer::GrpcServer::Gst *gst, ::grpc::ServerReader<::peer_nn::ModelFile> *reader, ::peer_nn::ModelFile &fileContents);
+
+    // NOTE:
+    // The load of the server is published to the TXT record of the discovery which is configured to the peer.
+    // The item is set only if its value is changed, the discovery refreshes the record by itself.
+    // The latency (usec) is from the arrival of a request to its result, it is given by the workers.
+    void AddLatency(uint64_t latency);
+    void CollectLoad(std::map<std::string, std::string> &items);
+    void PublishLoad(void);
+    static void *PublishMain(void *ptr);
+
     static void *Main(void *ptr);
 
     pthread_t threadId;
     std::unique_ptr<::grpc::Server> server;
     Peer *peer;
     unsigned long nextPeerId;
+    pthread_mutex_t clientLock; // clientMap, it is visited by the publisher
     std::map<std::string, Peer::GrpcServer::Gst *> clientMap;
+    Peer::GrpcServer::Registry *registry;
+    Peer::GrpcServer::Pool *pool;
+
+    pthread_mutex_t uploadLock;
+    std::set<std::string> uploadSet; // Digests of the models which are being uploaded
+
+    pthread_t publishId;
+    pthread_mutex_t publishLock;
+    pthread_cond_t publishCond;
+    bool publishing;
+    std::vector<uint64_t> latencies; // The recent latencies (ring), guarded by the publishLock
+    size_t nextLatency;
+    std::map<std::string, std::string> publishedItems; // touched only by the publisher
 };
 
 #endif // __BEYOND_PEER_NN_PEER_GRPC_SERVER_H__
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PEER_NN_PEER_GRPC_SERVER_BATCHER_H__
+#define __BEYOND_PEER_NN_PEER_GRPC_SERVER_BATCHER_H__
+
+#include "peer_grpc_server.h"
+
+#include <list>
+#include <string>
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <pthread.h>
+
+// NOTE:
+// The batcher collects the requests from the clients which are using the same model,
+// and runs them as a single batched invocation of its own tensor_filter pipeline.
+// The results are scattered back to the response pipeline of each client.
+// The client pipeline feeds the tensors via its appsink ("batchSink"),
+// and gets the result of its own via its appsrc ("batchSource").
+// A buffer without memories is pushed to the appsrc if the request is failed,
+// it is the cancel of the request which is given by the offset of the buffer.
+class Peer::GrpcServer::Batcher final {
+public:
+    static constexpr int DEFAULT_TIMEOUT = 5000;        // usec
+    static constexpr int PULL_TIMEOUT = 5 * 1000 * 1000; // usec
+
+    // NOTE:
+    // inputInfo and outputInfo describe a single request,
+    // the batcher multiplies their outermost dimension by the batchSize.
+    static Batcher *Create(const char *framework, const char *model, const char *accel,
+                           const beyond_tensor_info *inputInfo, int inputSize,
+                           const beyond_tensor_info *outputInfo, int outputSize,
+                           int batchSize, int timeout);
+    void Destroy(void);
+
+    int Attach(GstElement *clientSink, GstElement *clientSource);
+    void Detach(GstElement *clientSink);
+
+    static std::string TensorInfoToDims(const beyond_tensor_info *info, int size, int batchSize = 1);
+    static std::string TensorInfoToTypes(const beyond_tensor_info *info, int size);
+
+private:
+    struct Client {
+        Batcher *batcher;
+        GstElement *sink;
+        GstElement *source;
+    };
+
+    struct Request {
+        GstElement *source;
+        GstBuffer *buffer;
+        gint64 arrival; // usec, monotonic
+    };
+
+private:
+    Batcher(void);
+    ~Batcher(void);
+
+    static GstFlowReturn NewSampleHandler(GstAppSink *sink, gpointer user_data);
+    static void *Main(void *arg);
+    static GstCaps *CreateCaps(const beyond_tensor_info *info, int size, int batchSize);
+
+    int Enqueue(GstElement *source, GstBuffer *buffer);
+    int Invoke(std::list<Request> &requests);
+    void Scatter(GstBuffer *output, std::list<Request> &requests);
+    void Cancel(Request &request);
+
+private:
+    GstElement *pipeline;
+    GstElement *source;
+    GstElement *sink;
+    GstCaps *outputCaps;
+
+    int batchSize;
+    int timeout;
+    size_t *inputSize;
+    int inputCount;
+    guint64 nextBatchId; // Offset of the next batch buffer, the result is matched with it
+
+    pthread_t threadId;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool exit;
+
+    std::list<Request> queue;
+    std::list<Client *> clients;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_GRPC_SERVER_BATCHER_H__
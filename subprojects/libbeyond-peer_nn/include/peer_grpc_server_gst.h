@@ -19,39 +19,64 @@
 
 #include "peer_grpc_server.h"
 #include "peer_model.h"
+#include "peer_tensor_channel.h"
 
 #include <string>
+#include <set>
+#include <map>
 
 #include <glib.h>
 #include <gst/gst.h>
+#include <gst/app/gstappsink.h>
 #include <pthread.h>
 
 #include <beyond/platform/beyond_platform.h>
 #include <beyond/private/beyond_private.h>
 
+#define STREAM_DRAIN_TIMEOUT 1000 // msec
+#define DEPAYLOADER_NAME "serverDepayloader"
+#define RTP_MAX_SKIPPED 64
+
 class Peer::GrpcServer::Gst final {
 public:
     static Gst *Create(std::string &peerId, Peer::GrpcServer *grpcServer);
     void Destroy(void);
 
     int Configure(const beyond_plugin_peer_nn_config::server_description *config);
-    int Prepare(int &reqPort, int &resPort);
+    // NOTE:
+    // The localChannel is the name of the local channel for the client on the same host (empty if it is not available)
+    int Prepare(int &reqPort, int &resPort, std::string &localChannel);
     int Stop(void);
     void SetSecret(std::string &secret);
     std::shared_ptr<Peer::Model> GetModel(void) const;
     unsigned long GetNonce(void) const;
     void SetNonce(unsigned long nonce = 0);
+    // NOTE:
+    // If the client traces its requests, the timing of the server is given with every result.
+    // It must be set before preparing.
+    void SetTrace(bool enable);
+    // NOTE:
+    // The requests in the pipeline and the digest of the prepared model (empty if it is not known)
+    void GetLoad(size_t &queueDepth, std::string &digest);
+
+    // NOTE:
+    // The streaming inference (Infer RPC) is the alternative of the tensor channel.
+    // While the stream is attached, the requests are read from it on the gRPC thread,
+    // and the results are written to it instead of the channel.
+    typedef ::grpc::ServerReaderWriter<::peer_nn::InferResponse, ::peer_nn::InferRequest> InferStream;
+    int AttachStream(InferStream *stream);
+    int PushRequest(::peer_nn::InferRequest &request);
+    void DetachStream(bool drain);
 
 private:
-    // There is a new thread for integrating the nnstreamer (gst_X) to the glib main loop.
-    // The glib main loop is created on a newly created thread.
-    // In order to control the nnstreamer thread, this command structure would be used.
+    // The nnstreamer (gst_X) of the client is integrated to the glib main loop of a worker of the pool.
+    // The worker is shared with the other clients, it is assigned on preparing.
+    // In order to control the nnstreamer on the worker, this command structure would be used.
     enum Command : int {
-        IdReady = 0x00,
-        IdPrepare = 0x01,
-        IdStop = 0x02,
-        IdExit = 0x03,
-        IdLast = 0x04,
+        IdPrepare = 0x00,
+        IdStop = 0x01,
+        IdExit = 0x02,
+        IdLast = 0x03,
     };
 
     struct Thread {
@@ -63,15 +88,23 @@ private:
             GPollFD fd;
         };
 
-        GMainLoop *loop;
+        // NOTE:
+        // The sources are attached to the context of the worker,
+        // they are destroyed on the worker when the client exits.
+        GMainContext *context;
+        GSource *commandSource;
+        GSource *busSource;
+        GSource *recvSource;
         GstElement *pipeline;
         GstBus *bus;
         const CommandHandler cmdTable[Command::IdLast];
         std::unique_ptr<beyond::CommandObject> command;
 
         static void BusHandler(GstBus *bus, GstMessage *message, gpointer user_data);
+        static gboolean AcceptHandler(gint fd, GIOCondition condition, gpointer user_data);
+        static gboolean HandshakeHandler(gint fd, GIOCondition condition, gpointer user_data);
+        static gboolean RecvHandler(gint fd, GIOCondition condition, gpointer user_data);
 
-        static int CommandHandlerReady(Peer::GrpcServer::Gst *impls, void *data);
         static int CommandHandlerPrepare(Peer::GrpcServer::Gst *impls, void *data);
         static int CommandHandlerStop(Peer::GrpcServer::Gst *impls, void *data);
         static int CommandHandlerExit(Peer::GrpcServer::Gst *impls, void *data);
@@ -79,7 +112,7 @@ private:
         static gboolean CommandPrepare(GSource *source, gint *timeout);
         static gboolean CommandCheck(GSource *source);
         static gboolean CommandHandle(GSource *source, GSourceFunc callback, gpointer user_data);
-        static void *Main(void *arg);
+        static void DestroySource(GSource *&source);
     };
 
     union PrepareData {
@@ -91,6 +124,28 @@ private:
         } port;
     };
 
+    // NOTE:
+    // The timestamps (usec, monotonic) of a request on the server, it is used for the timing of the result
+    struct Timestamp {
+        uint64_t received;
+        uint64_t pushed;
+        uint64_t filterIn;
+        uint64_t filterOut;
+    };
+
+    // NOTE:
+    // The frame which is being received from the channel, it is kept between the RecvHandler() calls
+    // until its payloads are completed. The buffer is nullptr if the header of the next frame is not given yet.
+    struct Incoming {
+        Peer::TensorChannel::Header header;
+        Peer::TensorChannel::Descriptor desc[Peer::TensorChannel::MAX_TENSORS];
+        GstBuffer *buffer;
+        GstMemory *memory[Peer::TensorChannel::MAX_TENSORS];
+        GstMapInfo mapInfo[Peer::TensorChannel::MAX_TENSORS];
+        struct iovec iov[Peer::TensorChannel::MAX_TENSORS];
+        uint64_t received;
+    };
+
     typedef int (*DimsParser_t)(const char *, int *);
 
     struct RtpConfig {
@@ -109,6 +164,31 @@ private:
     static int DimsParser4(const char *str, int *values);
     static int ExtractTensorInfo(GstElement *element, const char *type, beyond_tensor_info *&info, int &size);
     static std::string TensorInfoToProperties(const char *type, const beyond_tensor_info *info, int size);
+    static GstCaps *DescriptorToCaps(const Peer::TensorChannel::Descriptor *desc, int count);
+    static GstFlowReturn NewSampleHandler(GstAppSink *sink, gpointer user_data);
+    static GstPadProbeReturn FilterInProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+    static GstPadProbeReturn FilterOutProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+    static GstPadProbeReturn DepayloaderInProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+    static GstPadProbeReturn DepayloaderOutProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+    static uint64_t GetRtpRequestId(GstBuffer *buffer);
+    static void ReleaseData(gpointer data);
+
+    int Attach(const std::string &key);
+    int Listen(void);
+    void CloseListen(void);
+    int AttachChannel(Peer::TensorChannel *channel);
+    int PushBuffer(uint64_t requestId, GstBuffer *buffer, const Peer::TensorChannel::Descriptor *desc, int count, uint64_t received);
+    int ValidateRequest(const Peer::TensorChannel::Descriptor *desc, int count);
+    int SendResult(uint64_t requestId, const Peer::TensorChannel::Descriptor *desc, struct iovec *iov, int count, const Peer::TensorChannel::Timing *timing);
+    int SendCancel(uint64_t requestId);
+    void CancelRequest(uint64_t requestId);
+    void CloseChannel(void);
+    int BeginIncoming(void);
+    void ReleaseIncoming(void);
+    void AddTraceProbes(GstElement *filter);
+    void AddDepayloaderProbes(void);
+    void StampFilter(GstBuffer *buffer, bool in);
+    uint64_t GetTiming(uint64_t requestId, Peer::TensorChannel::Timing &timing);
 
 private:
     Peer::GrpcServer *grpc;
@@ -116,7 +196,7 @@ private:
     std::string accel;
     std::unique_ptr<beyond::CommandObject> command;
     Thread threadCtx;
-    pthread_t threadId;
+    std::string workerKey;
     unsigned long nonce;
 
     RtpConfig rtpConfig;
@@ -126,6 +206,57 @@ private:
     std::shared_ptr<Peer::Model> model;
     std::string peerId;
 
+    // NOTE:
+    // If the batcher is not nullptr, the client pipeline does not have its own tensor_filter,
+    // its batchSink feeds the batcher, and the batcher pushes the results to its batchSource.
+    Peer::GrpcServer::Batcher *batcher;
+    std::string batcherKey;
+    GstElement *batchSink;
+
+    // NOTE:
+    // The raw tensors are exchanged via the tensor channel.
+    // The channel feeds the appsrc ("serverSource") of the pipeline if the input is not configured,
+    // and the results are sent from the appsink ("serverSink") of the pipeline.
+    // The requestId is kept in the offset of the gst buffer through the pipeline, and is given back with its result.
+    // The pendingIds are the requests in the pipeline, the older ones than the result were dropped by the pipeline,
+    // they are canceled explicitly.
+    // The stream replaces the channel while the Infer RPC is running.
+    // The client on the same host connects to the local channel (localFd) instead of the TCP port (listenFd),
+    // only one of them is accepted.
+    // The local channel is pending (handshakeChannel) until the client completes the handshake on its handle.
+    int listenFd;
+    int localFd;
+    GSource *listenSource;
+    GSource *localSource;
+    GSource *handshakeSource;
+    Peer::TensorChannel *handshakeChannel;
+    int channelPort;
+    std::string localChannel;
+    Peer::TensorChannel *channel;
+    Incoming incoming; // touched only on the worker, or after the sources of the worker are gone
+    GstElement *serverSource;
+    bool serverSourceCaps;
+    pthread_mutex_t channelLock;
+    pthread_cond_t pendingCond;
+    InferStream *stream;
+    std::set<uint64_t> pendingIds;
+    uint64_t nextRequestId;
+    std::string modelDigest; // The digest of the prepared model, it is guarded by the channelLock
+
+    // NOTE:
+    // The requests via the RTP carry their requestId in the header extension of the RTP packets.
+    // The depayloader puts it to the offset of the frame, and the frame is added to the pendingIds.
+    // The ids which are skipped by the stream were dropped by the client or lost, they are canceled.
+    // These are touched only on the streaming thread of the udpsrc.
+    uint64_t rtpRequestId;
+    uint64_t lastRtpRequestId;
+
+    // NOTE:
+    // The timestamps of the pending requests, the latency of a result is given to the server for its load.
+    // The timing is sent with the result only if the tracing is enabled, the filter is stamped only in that case.
+    bool trace;
+    std::map<uint64_t, Timestamp> timestamps;
+
     static DimsParser_t dimsParsers[4];
 };
 
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PEER_NN_PEER_GRPC_SERVER_POOL_H__
+#define __BEYOND_PEER_NN_PEER_GRPC_SERVER_POOL_H__
+
+#include "peer_grpc_server.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <pthread.h>
+
+// NOTE:
+// The pool runs the glib main loops of the client pipelines on a fixed number of worker threads.
+// A client attaches its sources (command, bus watch, tensor channel) to the context of a worker,
+// instead of having its own thread and main loop.
+// The clients of the same model are assigned to the same worker (affinity),
+// unless the worker is overloaded compared to the others.
+// The elements of the client pipelines still have their own streaming threads, they are not pooled:
+// the appsrc (serverSource) of each client and the appsrc (batchSource) which the batcher feeds if it is shared,
+// so a client costs one or two threads in addition to the workers, the number of the clients is bounded by them.
+class Peer::GrpcServer::Pool final {
+public:
+    static constexpr int AFFINITY_LOAD_FACTOR = 2;
+
+public:
+    // NOTE:
+    // If the size is not positive, the number of the available CPUs is used
+    static Pool *Create(int size);
+    void Destroy(void);
+
+    GMainContext *Acquire(const std::string &key);
+    void Release(GMainContext *context, const std::string &key);
+
+private:
+    struct Worker {
+        Pool *pool;
+        pthread_t threadId;
+        GMainContext *context;
+        GMainLoop *loop;
+        int count; // clients which are attached to the worker
+        bool started;
+    };
+
+    struct Affinity {
+        int worker;
+        int refcount;
+    };
+
+private:
+    Pool(void);
+    ~Pool(void);
+
+    static void *Main(void *arg);
+    static gboolean QuitHandler(gpointer user_data);
+
+private:
+    pthread_mutex_t lock;
+    std::vector<Worker> workers;
+    std::map<std::string, Affinity> affinityMap;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_GRPC_SERVER_POOL_H__
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PEER_NN_PEER_GRPC_SERVER_REGISTRY_H__
+#define __BEYOND_PEER_NN_PEER_GRPC_SERVER_REGISTRY_H__
+
+#include "peer_grpc_server.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include <ctime>
+#include <pthread.h>
+#include <sys/types.h>
+
+// NOTE:
+// The registry keeps the loaded models of the server.
+// The clients which are using the same model (the same contents, not the same path) share a loaded model,
+// the batcher of the model multiplexes the requests of the clients.
+// The models which are not used by any client are kept loaded within the budget,
+// and they are unloaded in the least recently used order.
+// Loading and unloading a model take time, they are done without the lock,
+// the entry is reserved while its model is being loaded (the batcher is nullptr).
+class Peer::GrpcServer::Registry final {
+public:
+    static Registry *Create(size_t budget);
+    void Destroy(void);
+
+    // NOTE:
+    // The digest (SHA-256, hex string) is cached by the path, size and mtime of the model file
+    int GetDigest(const char *modelPath, std::string &digest, size_t &size);
+    // NOTE:
+    // Register the digest which is already known (e.g. verified on the upload)
+    void PutDigest(const char *modelPath, const std::string &digest);
+
+    // NOTE:
+    // The clients share a loaded model if they have the same key.
+    // The key begins with the digest of the model, the model path is not a part of it.
+    static std::string MakeKey(const std::string &digest, const std::string &framework, const std::string &accel,
+                               const std::string &inputProps, const std::string &outputProps);
+
+    Peer::GrpcServer::Batcher *Acquire(const std::string &key, size_t size,
+                                       const char *framework, const char *model, const char *accel,
+                                       const beyond_tensor_info *inputInfo, int inputSize,
+                                       const beyond_tensor_info *outputInfo, int outputSize,
+                                       int batchSize, int timeout);
+    void Release(const std::string &key);
+
+    // NOTE:
+    // The digests of the loaded models, including the idle ones (not the ones which are being loaded)
+    void GetDigests(std::set<std::string> &digests);
+
+private:
+    struct Entry {
+        Peer::GrpcServer::Batcher *batcher; // nullptr while it is being loaded
+        int refcount;
+        size_t size;
+        std::list<std::string>::iterator idle; // valid only if the refcount is 0
+    };
+
+    struct Digest {
+        off_t size;
+        timespec mtime;
+        std::string digest;
+    };
+
+private:
+    Registry(void);
+    ~Registry(void);
+
+    void Evict(size_t required, std::list<Peer::GrpcServer::Batcher *> &victims);
+
+private:
+    pthread_mutex_t lock;
+    pthread_cond_t loadCond; // Broadcast when a reserved entry is loaded or dropped
+    size_t budget;
+    size_t usage;
+
+    std::map<std::string, Entry> entries;
+    std::list<std::string> idleList; // The least recently used one is at the front
+    std::map<std::string, Digest> digestMap;
+
+    friend class RegistryTest;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_GRPC_SERVER_REGISTRY_H__
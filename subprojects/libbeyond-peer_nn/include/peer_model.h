@@ -19,7 +19,12 @@
 
 #include "peer.h"
 
+#include <string>
+
 class Peer::Model final {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
 public:
     Model(void);
     virtual ~Model(void);
@@ -35,6 +40,10 @@ public:
     static void FreeTensorInfo(beyond_tensor_info *&info, int &size);
     static int DupTensorInfo(beyond_tensor_info *&dest, const beyond_tensor_info *src, int size);
 
+    // NOTE:
+    // SHA-256 of the model contents (hex string), it identifies the model on the model cache of the server
+    static int ComputeDigest(const char *modelPath, std::string &digest);
+
 private:
     beyond_tensor_info *inputTensorInfo;
     beyond_tensor_info *outputTensorInfo;
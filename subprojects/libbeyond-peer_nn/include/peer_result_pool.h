@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BEYOND_PEER_NN_PEER_RESULT_POOL_H__
+#define __BEYOND_PEER_NN_PEER_RESULT_POOL_H__
+
+#include "peer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+#include <pthread.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+// NOTE:
+// The result pool hands out the output tensors of the client, and takes them back from the Peer::FreeTensor().
+// There are two kinds of the results:
+//
+//  - A block: the tensor array and the buffers of the tensors are allocated at once.
+//    The payloads of the tensor channel are read into it directly, and the released block is kept
+//    for the next results if the capacity allows it.
+//  - A view: the buffers belong to another object (e.g. the Infer response of the stream),
+//    the tensors refer them without copying, and the object is released with the tensors.
+class Peer::ResultPool final {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    typedef void (*ReleaseHandler)(void *data);
+
+public:
+    // NOTE:
+    // The capacity is the number of the released blocks which are kept for reusing (0: not kept)
+    static ResultPool *Create(int capacity = 0);
+    void Destroy(void);
+
+    void SetCapacity(int capacity);
+
+    // NOTE:
+    // The data and the size of the tensors are filled by the sizes, the caller fills their types.
+    int Allocate(const uint64_t *sizes, int count, beyond_tensor *&tensor);
+
+    // NOTE:
+    // The caller fills the tensors by the buffers of the data,
+    // the release is invoked with the data when the tensors are released.
+    int Wrap(int count, ReleaseHandler release, void *data, beyond_tensor *&tensor);
+
+    // NOTE:
+    // Thread safe, it returns -ENOENT if the tensor is not given by the pool
+    int Release(beyond_tensor *tensor);
+
+private:
+    struct Entry {
+        size_t capacity; // 0 for a view
+        ReleaseHandler release;
+        void *data;
+    };
+
+private:
+    ResultPool(void);
+    ~ResultPool(void);
+
+    static size_t Align(size_t size);
+    void Trim(void);
+
+private:
+    pthread_mutex_t lock;
+    int capacity;
+    std::unordered_map<beyond_tensor *, Entry> results; // not released yet
+    std::multimap<size_t, void *> blocks;               // released blocks by their capacity
+    unsigned long long countOfReused;
+    unsigned long long countOfAllocated;
+
+    friend class ResultPoolTest;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_RESULT_POOL_H__
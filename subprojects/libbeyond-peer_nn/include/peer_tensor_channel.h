@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PEER_NN_PEER_TENSOR_CHANNEL_H__
+#define __BEYOND_PEER_NN_PEER_TENSOR_CHANNEL_H__
+
+#include "peer.h"
+
+#include <cstdint>
+#include <string>
+
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+// NOTE:
+// The tensor channel carries the raw tensors between the client and the server
+// without the gst serialization (gdppay, tensor_decoder mode=flatbuf).
+// A frame is the fixed sized header, the descriptors of the tensors and their payloads in order:
+//
+//   +--------+--------------+-----+----------------+-----------+-----+-------------+
+//   | Header | Descriptor 0 | ... | Descriptor N-1 | Payload 0 | ... | Payload N-1 |
+//   +--------+--------------+-----+----------------+-----------+-----+-------------+
+//
+// The fields are in the host byte order, the same as the tensor payloads.
+// A frame without tensors (count == 0) notifies that the request of the requestId is canceled.
+// If the tracing is negotiated on preparing, every result frame of the server has the timing after its descriptors.
+//
+// When the client and the server are on the same host, the frames are carried by the local channel instead of TCP.
+// The client creates a memfd which has two rings (client to server, server to client) and the eventfds,
+// and passes them to the server via the abstract UNIX socket which is advertised by the server.
+// The frames are copied into the ring as a byte stream, the eventfd wakes up the peer only if it is waiting
+// for the data (or the space), and the UNIX socket is kept open to detect the peer closing.
+//
+// If the session key is set, the TCP frames are sealed by the AES-GCM cipher of the authenticator:
+//
+//   +------+--------+-------------+--------+------------------------------+-----+
+//   | Salt | Header | Descriptors | Timing | Payloads (encrypted)         | Tag |
+//   +------+--------+-------------+--------+------------------------------+-----+
+//
+// The client sends the random salt once before its first frame, and the key of the channel is derived
+// from the session key and the salt, so the key is not shared with the other channels of the session.
+// The header, the descriptors and the timing are sent as they are but authenticated with the payloads.
+// The IV is the direction and the sequence number of the frame, both sides count the frames,
+// so the IV is not sent, and a frame which is replayed, reordered or dropped is not authentic.
+class Peer::TensorChannel final {
+public:
+    static constexpr uint32_t MAGIC = 0x544E5942; // "BYNT"
+    static constexpr uint16_t VERSION = 1;
+    static constexpr int MAX_TENSORS = 16;
+    static constexpr int MAX_RANK = 4;
+    static constexpr uint64_t MAX_PAYLOAD = 256 * 1024 * 1024;
+    static constexpr uint64_t LOCAL_RING_SIZE = 8 * 1024 * 1024; // per direction, must be a power of 2
+    static constexpr uint64_t LOCAL_HEADER_SIZE = 4096;
+    static constexpr int LOCAL_HANDSHAKE_TIMEOUT = 1000; // msec
+    static constexpr int SALT_SIZE = 32;
+    static constexpr size_t SEAL_CHUNK_SIZE = 256 * 1024; // payloads are encrypted into the scratch buffer by this size
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count;
+        uint64_t requestId;
+    };
+
+    struct Descriptor {
+        int32_t type; // beyond_tensor_type
+        int32_t rank;
+        int32_t dims[MAX_RANK]; // NHWC, the same order of the beyond_tensor_info
+        uint64_t size;
+    };
+
+    // NOTE:
+    // The time (usec) which the server spent on each stage of a request, they are durations
+    // so the clocks of the client and the server do not need to be synchronized.
+    struct Timing {
+        uint32_t recv;    // reading the tensors
+        uint32_t convert; // appsrc to the tensor_filter (or the batcher)
+        uint32_t filter;  // the tensor_filter (or the batcher)
+        uint32_t post;    // the tensor_filter to the appsink
+    };
+
+    static_assert(sizeof(Header) == 16, "Header must not be padded");
+    static_assert(sizeof(Descriptor) == 32, "Descriptor must not be padded");
+    static_assert(sizeof(Timing) == 16, "Timing must not be padded");
+
+public:
+    // NOTE:
+    // The channel takes the ownership of the fd
+    static TensorChannel *Create(int fd);
+    void Destroy(void);
+
+    static int Listen(int &fd, int &port);
+    // NOTE:
+    // The wildcard address to bind the sockets of the pipelines, "::" (dual-stack) if the host supports IPv6
+    static const char *GetAnyAddress(void);
+    static int Accept(int listenFd, int &fd);
+    static int Connect(const char *host, int port, int &fd);
+
+    // NOTE:
+    // The name of the local channel is an abstract UNIX socket, it is reachable only from the same host.
+    // AcceptLocal() and ConnectLocal() exchange the shared memory and create the channel.
+    // AcceptLocal() refuses the peer of another user, and it returns the channel before the handshake,
+    // TryHandshake() completes it without blocking when the handle gets readable, it returns -EAGAIN until then.
+    static int ListenLocal(int &fd, std::string &name);
+    static TensorChannel *AcceptLocal(int listenFd);
+    static TensorChannel *ConnectLocal(const char *name);
+    int TryHandshake(void);
+
+    // NOTE:
+    // Seal the frames by the session key, the client (initiator) sends the salt with its first frame
+    // and the server derives the key when it receives the salt.
+    // The local channel is not sealed, the client and the server do not use it if the session key is exchanged.
+    int SetSecret(beyond::AuthenticatorInterface *auth, const std::string &secret, bool initiator);
+
+    // NOTE:
+    // Cap the frames which are received by the tensor information of the model,
+    // RecvHeader() and TryRecvHeader() reject the frame which has more tensors or a larger tensor
+    // before the caller allocates the buffers by its descriptors.
+    // The tensor whose size is not given (e.g. dynamic) is capped by the MAX_PAYLOAD.
+    int SetLimit(const beyond_tensor_info *info, int size);
+
+    static void FillDescriptor(Descriptor &desc, beyond_tensor_type type, uint64_t size, const beyond_tensor_info *info);
+
+    // NOTE:
+    // Check the descriptors of a frame against the tensor information of the model before allocating its buffers.
+    // The count, the type and the size must be the same, and the dims as well if they are given (rank > 0).
+    static int ValidateDescriptor(const Descriptor *desc, int count, const beyond_tensor_info *info, int size);
+
+    // NOTE:
+    // The handle is readable when a frame is ready or the peer is closed.
+    // For the local channel, RecvHeader() returns -EAGAIN if the readiness was spurious.
+    int GetHandle(void) const;
+    bool IsLocal(void) const;
+
+    // NOTE:
+    // The header, the descriptors and the payloads are gathered by a single sendmsg(),
+    // the payloads are sent from the given buffers without copying them.
+    // For the local channel, they are copied into the ring directly.
+    // If the timing is given, it follows the descriptors.
+    int Send(uint64_t requestId, const Descriptor *desc, const struct iovec *payload, int count, const Timing *timing = nullptr);
+    int Cancel(uint64_t requestId);
+
+    // NOTE:
+    // RecvHeader() gets the header and the descriptors of the next frame,
+    // the caller prepares the buffers by the descriptors, and RecvPayload() reads the payloads into them directly.
+    // If the timing is given, it is read after the descriptors of a frame which has tensors.
+    // For the sealed channel, the header and the descriptors are not authentic until RecvPayload() succeeds,
+    // and RecvPayload() returns -EBADMSG if the frame is not authentic.
+    int RecvHeader(Header &header, Descriptor *desc, Timing *timing = nullptr);
+    int RecvPayload(const struct iovec *payload, int count);
+
+    // NOTE:
+    // The non-blocking versions of the RecvHeader() and the RecvPayload() for the server, the timing is not given.
+    // They read what is available and return -EAGAIN until the part of the frame is completed,
+    // the channel keeps the progress between the calls, so a peer which sends a frame slowly does not block the caller.
+    // The payloads must be the same buffers until the TryRecvPayload() completes the frame.
+    // For the local channel, they read what the ring has, and the writer signals the handle for the rest.
+    // Do not mix them with the blocking ones on the same channel.
+    int TryRecvHeader(Header &header, Descriptor *desc);
+    int TryRecvPayload(const struct iovec *payload, int count);
+
+private:
+    enum LocalRing : int {
+        RingRequest = 0, // client to server
+        RingResponse = 1, // server to client
+        RingLast = 2,
+    };
+
+    enum LocalEvent : int {
+        EventData = 0,
+        EventSpace = 1,
+        EventLast = RingLast * 2,
+    };
+
+    struct Shared;
+
+    // NOTE:
+    // The part of the frame which is being received by the TryRecvHeader() and the TryRecvPayload()
+    enum RecvPart : int {
+        PartHeader = 0, // and the salt, if it is not received yet
+        PartDescriptor = 1,
+        PartPayload = 2, // and the tag of the sealed frame
+        PartTag = 3, // the tag of the sealed frame which is canceled
+    };
+
+private:
+    TensorChannel(void);
+    ~TensorChannel(void);
+
+    static int SetNoDelay(int fd);
+    static int SetLocalAddress(struct sockaddr_un &addr, const char *name, socklen_t &len);
+    static bool HasIPv6(void);
+    static TensorChannel *CreateLocal(int fd, int memFd, const int *eventFd, bool server);
+    int InitLocal(int memFd, const int *eventFd, bool server);
+    int SendAll(struct iovec *iov, int iovcnt);
+    int RecvAll(struct iovec *iov, int iovcnt);
+    int RecvPartial(const struct iovec *iov, int iovcnt, size_t &offset);
+    int CheckDescriptor(const Descriptor *desc, int count) const;
+
+    int CreateCipher(void);
+    void MakeIV(uint32_t direction, uint64_t sequence, uint8_t *iv);
+    int SendSealed(struct iovec *iov, int aadcnt, int iovcnt);
+    int OpenSealed(const Header &header, const Descriptor *desc, const Timing *timing);
+    int RecvSealed(const struct iovec *payload, int count);
+    int UpdateSealed(const struct iovec *payload, int count, size_t from, size_t to);
+
+    int RingWrite(struct iovec *iov, int iovcnt);
+    int RingRead(struct iovec *iov, int iovcnt);
+    int RingReadPartial(const struct iovec *iov, int iovcnt, size_t &offset);
+    int PollLocal(void);
+    int WaitLocal(int eventFd);
+    void Signal(int eventFd);
+    bool Drain(int eventFd);
+
+private:
+    int fd;
+
+    // NOTE:
+    // The local channel, the fd is the UNIX socket
+    // The handshaking is true until the TryHandshake() maps the shared memory of the accepted channel.
+    Shared *shared;
+    bool handshaking;
+    uint8_t *sendData;
+    uint8_t *recvData;
+    int sendRing;
+    int recvRing;
+    int eventFd[EventLast]; // data and space of the rings in order
+    int pollFd;
+
+    // NOTE:
+    // The sealed channel, the secret is kept until the cipher is created
+    beyond::AuthenticatorInterface *auth;
+    std::string secret;
+    beyond::AuthenticatorInterface::CipherInterface *cipher;
+    beyond::AuthenticatorInterface::CipherInterface::Stream *recvStream; // opened by the RecvHeader()
+    uint8_t salt[SALT_SIZE];
+    bool saltPending; // the salt is not sent (initiator) or not received yet
+    bool initiator;
+    uint64_t sendSequence;
+    uint64_t recvSequence;
+    uint8_t *sealBuffer;
+
+    // NOTE:
+    // The limits of the received frames, they are the MAX_TENSORS and the MAX_PAYLOAD until SetLimit()
+    int limitCount;
+    uint64_t limitSize[MAX_TENSORS];
+
+    // NOTE:
+    // The progress of the incremental receiving, the recvOffset is the bytes of the recvPart which are received
+    int recvPart;
+    size_t recvOffset;
+    Header recvHeader;
+    Descriptor recvDesc[MAX_TENSORS];
+    uint8_t recvTag[beyond::AuthenticatorInterface::CipherInterface::TAG_SIZE];
+
+    friend class TensorChannelTest;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_TENSOR_CHANNEL_H__
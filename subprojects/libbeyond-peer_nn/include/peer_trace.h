@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PEER_NN_PEER_TRACE_H__
+#define __BEYOND_PEER_NN_PEER_TRACE_H__
+
+#include "peer.h"
+#include "peer_tensor_channel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+// NOTE:
+// The trace collects the timestamps of every request on the client, merges the timing which is given
+// by the server with its result, and keeps the per-stage latency as the histograms.
+// The histograms are logged when the trace is destroyed, and the requests are written as
+// the Chrome trace (JSON) file if the output is given, it can be opened by chrome://tracing or the Perfetto UI.
+class Peer::Trace final {
+public:
+    static constexpr int BUCKETS = 32;               // log2 buckets of usec
+    static constexpr size_t MAX_RECORDS = 64 * 1024; // requests which are kept for the Chrome trace
+
+    enum Stage : int {
+        StageQueue = 0,         // Invoke() to the dispatch on the gst thread, including the backlog
+        StageSend = 1,          // appsrc push, the channel write or the stream write
+        StageNetwork = 2,       // the round trip which is not spent on the server
+        StageServerRecv = 3,    // the server stages are given by the Peer::TensorChannel::Timing
+        StageServerConvert = 4,
+        StageServerFilter = 5,
+        StageServerPost = 6,
+        StageRecv = 7,          // reading the result into the output tensors
+        StageDeliver = 8,       // publishing the result event
+        StageTotal = 9,         // Invoke() to the result event
+        StageLast = 10,
+    };
+
+    // NOTE:
+    // The timestamps (usec, monotonic) of a request on the client.
+    // The stage which is not passed by the request is left as 0.
+    struct Record {
+        uint64_t requestId;
+        uint64_t invoked;
+        uint64_t dispatched;
+        uint64_t sent;
+        uint64_t received;
+        uint64_t copied;
+        uint64_t delivered;
+        Peer::TensorChannel::Timing server;
+    };
+
+public:
+    // NOTE:
+    // The output is the path of the Chrome trace file (nullptr: not written)
+    static Trace *Create(const char *output = nullptr);
+    void Destroy(void);
+
+    static uint64_t Now(void);
+
+    // NOTE:
+    // Thread safe, it is invoked on the gst thread when the result is delivered
+    void Update(const Record &record);
+    void Dump(void);
+
+private:
+    struct Histogram {
+        uint64_t buckets[BUCKETS];
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+    };
+
+private:
+    Trace(void);
+    ~Trace(void);
+
+    static const char *GetStageName(int stage);
+    static uint64_t GetPercentile(const Histogram &histogram, int percentile);
+    void Add(int stage, uint64_t value);
+    int Write(const char *path);
+
+private:
+    pthread_mutex_t lock;
+    Histogram histograms[StageLast];
+    std::vector<Record> records;
+    std::string output;
+};
+
+#endif // __BEYOND_PEER_NN_PEER_TRACE_H__
@@ -72,8 +72,50 @@ API void *_main(int argc, char *argv[])
             .flag = nullptr,
             .val = 'a',
         },
+        {
+            .name = "batch-size", // Server batches the requests of the same model
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'b',
+        },
+        {
+            .name = "batch-timeout", // Time window (usec) to collect the requests of a batch
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 't',
+        },
+        {
+            .name = "model-budget", // Size (MiB) of the unused models which the server keeps loaded
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'm',
+        },
+        {
+            .name = "credits", // Maximum in-flight requests of a client
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'c',
+        },
+        {
+            .name = "workers", // Number of the threads which run the pipelines of the clients
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'w',
+        },
+        {
+            .name = "model-cache", // Size (MiB) of the uploaded models which the server keeps in its storage
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'M',
+        },
         // TODO:
         // Add more options
+        {
+            .name = nullptr,
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 0,
+        },
     };
 
     static bool gst_initialized = false;
@@ -89,7 +131,13 @@ API void *_main(int argc, char *argv[])
     char *storagePath = nullptr;
     char *framework = nullptr;
     char *accel = nullptr;
-    while ((c = getopt_long(argc, argv, "-:sp:f:a:", opts, &idx)) != -1) {
+    int batchSize = 0;
+    int batchTimeout = 0;
+    size_t modelBudget = 0;
+    int credits = 0;
+    int workers = 0;
+    size_t modelCache = 0;
+    while ((c = getopt_long(argc, argv, "-:sp:f:a:b:t:m:c:w:M:", opts, &idx)) != -1) {
         switch (c) {
         case 's':
             isServer = true;
@@ -103,12 +151,30 @@ API void *_main(int argc, char *argv[])
         case 'a':
             dup_opt(accel, optarg);
             break;
+        case 'b':
+            batchSize = atoi(optarg);
+            break;
+        case 't':
+            batchTimeout = atoi(optarg);
+            break;
+        case 'm':
+            modelBudget = strtoul(optarg, nullptr, 10) * 1024 * 1024;
+            break;
+        case 'c':
+            credits = atoi(optarg);
+            break;
+        case 'w':
+            workers = atoi(optarg);
+            break;
+        case 'M':
+            modelCache = strtoul(optarg, nullptr, 10) * 1024 * 1024;
+            break;
         default:
             break;
         }
     }
 
-    Peer *peer = Peer::Create(isServer, framework, accel, storagePath);
+    Peer *peer = Peer::Create(isServer, framework, accel, storagePath, batchSize, batchTimeout, modelBudget, credits, workers, modelCache);
     free(framework);
     framework = nullptr;
     free(accel);
@@ -22,7 +22,10 @@
 #include "peer_event_object.h"
 #include "peer_grpc_client_gst.h"
 #include "peer_grpc_server_gst.h"
+#include "peer_model.h"
+#include "peer_result_pool.h"
 
+#include <algorithm>
 #include <exception>
 #include <sstream>
 
@@ -31,12 +34,18 @@
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
+#include <cinttypes>
+#include <ctime>
 
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #define DEFAULT_FRAMEWORK "tensorflow-lite"
+#define UPLOAD_POLL_DELAY 100000      // usec
+#define UPLOAD_POLL_MAX_DELAY 1000000 // usec
 
-Peer *Peer::Create(bool isServer, const char *framework, const char *accel, const char *storagePath)
+Peer *Peer::Create(bool isServer, const char *framework, const char *accel, const char *storagePath, int batchSize, int batchTimeout, size_t modelBudget, int credits, int workers, size_t modelCache)
 {
     Peer *peer;
 
@@ -60,9 +69,26 @@ Peer *Peer::Create(bool isServer, const char *framework, const char *accel, cons
         if (storagePath != nullptr) {
             peer->serverCtx->storagePath = std::string(storagePath);
         }
+
+        peer->serverCtx->batchSize = batchSize;
+        peer->serverCtx->batchTimeout = batchTimeout;
+        peer->serverCtx->modelBudget = modelBudget;
+        peer->serverCtx->credits = credits > 0 ? credits : 0;
+        peer->serverCtx->workers = workers > 0 ? workers : 0;
+        peer->serverCtx->modelCache = modelCache;
     } else {
         peer->clientCtx = std::make_unique<Peer::ClientContext>();
 
+        peer->clientCtx->pool = Peer::ResultPool::Create();
+        if (peer->clientCtx->pool == nullptr) {
+            peer->eventObject->Destroy();
+            peer->eventObject = nullptr;
+
+            delete peer;
+            peer = nullptr;
+            return nullptr;
+        }
+
         if (framework != nullptr) {
             peer->clientCtx->framework = std::string(framework);
             if (accel != nullptr) {
@@ -334,6 +360,17 @@ int Peer::ConfigureCAAuthenticator(const beyond_config *options)
     return 0;
 }
 
+int Peer::ConfigureDiscovery(const beyond_config *options)
+{
+    if (serverCtx == nullptr) {
+        ErrPrint("Only the server publishes its load");
+        return -EINVAL;
+    }
+
+    discovery = static_cast<beyond::DiscoveryInterface *>(options->object);
+    return 0;
+}
+
 int Peer::Configure(const beyond_config *options)
 {
     if (options == nullptr) {
@@ -348,6 +385,8 @@ int Peer::Configure(const beyond_config *options)
         return ConfigureAuthenticator(options);
     } else if (options->type == BEYOND_PLUGIN_PEER_NN_CONFIG_CA_AUTHENTICATOR) {
         return ConfigureCAAuthenticator(options);
+    } else if (options->type == BEYOND_PLUGIN_PEER_NN_CONFIG_DISCOVERY) {
+        return ConfigureDiscovery(options);
     }
 
     return ConfigureInput(options);
@@ -367,6 +406,18 @@ int Peer::LoadModel(const char *model)
         return -EILSEQ;
     }
 
+    std::string digest;
+    struct stat st;
+    if (stat(model, &st) == 0 && Peer::Model::ComputeDigest(model, digest) == 0) {
+        int ret = LoadModelWithDigest(model, digest, static_cast<uint64_t>(st.st_size));
+        if (ret != -ENOTSUP) {
+            return ret;
+        }
+    }
+
+    // NOTE:
+    // The server does not support the model cache or the digest is not available,
+    // fallback to the legacy way, upload the whole model.
     int ret = clientCtx->grpc->LoadModel(model);
     if (ret == -ENOENT) {
         ret = clientCtx->grpc->UploadModel(model);
@@ -375,6 +426,57 @@ int Peer::LoadModel(const char *model)
     return ret;
 }
 
+int Peer::LoadModelWithDigest(const char *model, const std::string &digest, uint64_t size)
+{
+    int ret;
+    useconds_t delay = UPLOAD_POLL_DELAY;
+    struct timespec deadline;
+
+    // NOTE:
+    // Another client could be uploading the same model, it takes until the upload timeout at most
+    if (clock_gettime(CLOCK_MONOTONIC, &deadline) < 0) {
+        ret = -errno;
+        ErrPrintCode(errno, "clock_gettime");
+        return ret;
+    }
+    deadline.tv_sec += Peer::GrpcClient::UPLOAD_TIMEOUT;
+
+    while (true) {
+        uint64_t offset = 0;
+
+        ret = clientCtx->grpc->HasModel(model, digest, size, offset);
+        if (ret == -ENOENT) {
+            DbgPrint("Upload the model from %" PRIu64 "/%" PRIu64, offset, size);
+            ret = clientCtx->grpc->UploadModel(model, digest, size, offset);
+        }
+
+        if (ret != -EBUSY && ret != -EAGAIN) {
+            break;
+        }
+
+        struct timespec now;
+        if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "clock_gettime");
+            break;
+        }
+
+        if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) {
+            ErrPrint("Model is not available until the upload timeout: %s", digest.c_str());
+            ret = -ETIMEDOUT;
+            break;
+        }
+
+        // NOTE:
+        // Another client is uploading the same model or the upload is interrupted,
+        // poll the cache again, backing off up to the max delay.
+        usleep(delay);
+        delay = std::min(delay * 2, static_cast<useconds_t>(UPLOAD_POLL_MAX_DELAY));
+    }
+
+    return ret;
+}
+
 int Peer::GetInputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
     if (clientCtx == nullptr) {
@@ -512,7 +614,18 @@ void Peer::FreeTensor(beyond_tensor *&tensor, int size)
         return;
     }
 
-    if (tensor == nullptr || size <= 0) {
+    if (tensor == nullptr) {
+        return;
+    }
+
+    // NOTE:
+    // The output tensors are given by the result pool, they are released to it
+    if (clientCtx->pool->Release(tensor) == 0) {
+        tensor = nullptr;
+        return;
+    }
+
+    if (size <= 0) {
         return;
     }
 
@@ -537,13 +650,24 @@ int Peer::Prepare(void)
 
     int reqPort = 0;
     int resPort = 0;
-    int ret = clientCtx->grpc->Prepare(reqPort, resPort);
+    int credits = 0;
+    std::string localChannel;
+    int ret = clientCtx->grpc->Prepare(reqPort, resPort, credits, localChannel);
     if (ret < 0) {
         ErrPrint("GRPC prepare: %d", ret);
         return ret;
     }
 
-    ret = clientCtx->grpc->GetGst()->Prepare(info->host, reqPort, resPort);
+    // NOTE:
+    // The output of the model is negotiated before the tensor channel is connected,
+    // the channel caps the results by it. The output which is not known (e.g. configured pipeline) is not capped.
+    const beyond_tensor_info *outputInfo = nullptr;
+    int outputSize = 0;
+    if (clientCtx->grpc->GetOutputTensorInfo(outputInfo, outputSize) < 0) {
+        DbgPrint("Output tensor info is not known, the results are not capped");
+    }
+
+    ret = clientCtx->grpc->GetGst()->Prepare(info->host, reqPort, resPort, credits, localChannel.c_str());
     if (ret < 0) {
         // TODO:
         // Handling the prepared grpc
@@ -631,6 +755,11 @@ int Peer::Activate(void)
     }
 
     std::string address = info->host;
+    if (address.find(':') != std::string::npos) {
+        // NOTE:
+        // IPv6 address, it could be given by the discovery
+        address = "[" + address + "]";
+    }
     address = address + ":" + std::to_string(info->port[0]);
 
     void *privateKey = nullptr;
@@ -800,6 +929,10 @@ int Peer::GetInfo(const beyond_peer_info *&info)
 {
     if (clientCtx != nullptr && clientCtx->grpc != nullptr) {
         clientCtx->grpc->GetInfo(this->info);
+
+        if (this->info != nullptr && clientCtx->grpc->GetGst() != nullptr) {
+            clientCtx->grpc->GetGst()->GetStatistics(this->info->count_of_dropped, this->info->count_of_canceled);
+        }
     }
 
     info = const_cast<const beyond_peer_info *>(this->info);
@@ -821,6 +954,11 @@ beyond_plugin_peer_nn_config *Peer::DuplicateConfig(const beyond_plugin_peer_nn_
     }
 
     _config->client.input_type = _config->server.input_type = config->client.input_type;
+    _config->client.max_inflight = config->client.max_inflight;
+    _config->client.drop_policy = config->client.drop_policy;
+    _config->client.transport = config->client.transport;
+    _config->client.trace = config->client.trace;
+    _config->client.result_pool = config->client.result_pool;
 
     if (config->client.preprocessing != nullptr) {
         _config->client.preprocessing = strdup(config->client.preprocessing);
@@ -840,6 +978,15 @@ beyond_plugin_peer_nn_config *Peer::DuplicateConfig(const beyond_plugin_peer_nn_
         }
     }
 
+    if (config->client.trace_output != nullptr) {
+        _config->client.trace_output = strdup(config->client.trace_output);
+        if (_config->client.trace_output == nullptr) {
+            ErrPrintCode(errno, "strdup");
+            FreeConfig(_config);
+            return nullptr;
+        }
+    }
+
     if (config->server.preprocessing != nullptr) {
         _config->server.preprocessing = strdup(config->server.preprocessing);
         if (_config->server.preprocessing == nullptr) {
@@ -893,6 +1040,8 @@ void Peer::FreeConfig(beyond_plugin_peer_nn_config *&config)
     config->client.preprocessing = nullptr;
     free(config->client.postprocessing);
     config->client.postprocessing = nullptr;
+    free(config->client.trace_output);
+    config->client.trace_output = nullptr;
     free(config->server.framework);
     config->server.framework = nullptr;
     free(config->server.accel);
@@ -930,6 +1079,13 @@ void Peer::ResetInfo(beyond_peer_info *&info)
     ResetRuntime(info->runtimes, info->count_of_runtimes);
     info->count_of_runtimes = 0;
 
+    for (int i = 0; info->models != nullptr && i < info->count_of_models; i++) {
+        free(info->models[i]);
+    }
+    free(info->models);
+    info->models = nullptr;
+    info->count_of_models = 0;
+
     free(info->host);
     info->host = nullptr;
 
@@ -1008,6 +1164,12 @@ int Peer::SetInfo(beyond_peer_info *info)
                 return -ENOMEM;
             }
 
+            // NOTE:
+            // The runtime which is given by the discovery could have no devices
+            if (info->runtimes[i].count_of_devices <= 0) {
+                continue;
+            }
+
             newInfo->runtimes[i].devices = static_cast<beyond_peer_info_device *>(calloc(info->runtimes[i].count_of_devices, sizeof(beyond_peer_info_device)));
             if (newInfo->runtimes[i].devices == nullptr) {
                 ResetInfo(newInfo);
@@ -1028,6 +1190,25 @@ int Peer::SetInfo(beyond_peer_info *info)
 
     newInfo->free_memory = info->free_memory;
     newInfo->free_storage = info->free_storage;
+    newInfo->queue_depth = info->queue_depth;
+    newInfo->latency = info->latency;
+
+    if (info->count_of_models > 0 && info->models != nullptr) {
+        newInfo->models = static_cast<char **>(calloc(info->count_of_models, sizeof(char *)));
+        if (newInfo->models == nullptr) {
+            ResetInfo(newInfo);
+            return -ENOMEM;
+        }
+
+        for (int i = 0; i < info->count_of_models; i++) {
+            newInfo->models[i] = strdup(info->models[i]);
+            if (newInfo->models[i] == nullptr) {
+                ResetInfo(newInfo);
+                return -ENOMEM;
+            }
+            newInfo->count_of_models++;
+        }
+    }
 
     ResetInfo(this->info);
 
@@ -1047,9 +1228,14 @@ Peer::Peer(void)
     , reservedConfiguration(nullptr)
     , authenticator(nullptr)
     , caAuthenticator(nullptr)
+    , discovery(nullptr)
 {
 }
 
 Peer::~Peer(void)
 {
+    if (clientCtx != nullptr && clientCtx->pool != nullptr) {
+        clientCtx->pool->Destroy();
+        clientCtx->pool = nullptr;
+    }
 }
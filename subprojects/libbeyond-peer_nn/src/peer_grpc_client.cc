@@ -24,7 +24,9 @@
 #include <cstdlib>
 #include <cerrno>
 #include <ctime>
+#include <cinttypes>
 
+#include <chrono>
 #include <exception>
 #include <memory>
 
@@ -100,12 +102,32 @@ void Peer::GrpcClient::Destroy(void)
     delete this;
 }
 
+void Peer::GrpcClient::SetDeadline(::grpc::ClientContext &context, int timeout)
+{
+    // NOTE:
+    // An unreachable or stalled peer must not block the caller forever,
+    // every control call fails with -ETIMEDOUT once its deadline is passed.
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(timeout));
+}
+
+int Peer::GrpcClient::ConvertStatus(const ::grpc::Status &status)
+{
+    ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
+
+    if (status.error_code() == ::grpc::StatusCode::DEADLINE_EXCEEDED) {
+        return -ETIMEDOUT;
+    }
+
+    return -EFAULT;
+}
+
 int Peer::GrpcClient::Configure(const beyond_plugin_peer_nn_config::server_description *server)
 {
     ::peer_nn::Configuration request;
     ::peer_nn::Response response;
     ::grpc::ClientContext context;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
     request.set_input_type(server->input_type);
@@ -128,8 +150,7 @@ int Peer::GrpcClient::Configure(const beyond_plugin_peer_nn_config::server_descr
 
     grpc::Status status = stub->Configure(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     return static_cast<int>(response.status());
@@ -252,10 +273,10 @@ int Peer::GrpcClient::ExchangeKey(void)
         request.set_key(std::string("insecure"));
     }
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     grpc::Status status = stub->ExchangeKey(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     if (response.status() == 0) {
@@ -281,13 +302,13 @@ int Peer::GrpcClient::LoadModel(const char *modelFilename)
     ::peer_nn::Response response;
     ::grpc::ClientContext context;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
     request.set_filename(modelFilename);
     grpc::Status status = stub->LoadModel(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     // NOTE:
@@ -298,15 +319,48 @@ int Peer::GrpcClient::LoadModel(const char *modelFilename)
     return static_cast<int>(response.status());
 }
 
-int Peer::GrpcClient::UploadModel(const char *modelFilename)
+int Peer::GrpcClient::HasModel(const char *modelFilename, const std::string &digest, uint64_t size, uint64_t &offset)
 {
-    ::peer_nn::Response response;
+    ::peer_nn::ModelDigest request;
+    ::peer_nn::ModelStatus response;
     ::grpc::ClientContext context;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
-    std::unique_ptr<::grpc::ClientWriter<::peer_nn::ModelFile>> writer(stub->UploadModel(&context, &response));
-    ::peer_nn::ModelFile file;
+    std::string filename(modelFilename);
+    request.set_filename(filename.substr(filename.find_last_of("/\\") + 1));
+    request.set_digest(digest);
+    request.set_size(size);
+
+    grpc::Status status = stub->HasModel(&context, request, &response);
+    if (status.ok() == false) {
+        if (status.error_code() == ::grpc::StatusCode::UNIMPLEMENTED) {
+            // NOTE:
+            // The server does not support the model cache
+            DbgPrint("HasModel is not implemented");
+            return -ENOTSUP;
+        }
+
+        return ConvertStatus(status);
+    }
+
+    // NOTE:
+    // Reset cached model information
+    gst->GetModel()->SetInputTensorInfo(nullptr, 0);
+    gst->GetModel()->SetOutputTensorInfo(nullptr, 0);
+
+    offset = response.offset();
+    return static_cast<int>(response.status());
+}
+
+int Peer::GrpcClient::UploadModel(const char *modelFilename, const std::string &digest, uint64_t size, uint64_t offset)
+{
+    ::peer_nn::Response response;
+    ::grpc::ClientContext context;
+
+    SetDeadline(context, Peer::GrpcClient::UPLOAD_TIMEOUT);
+    context.AddMetadata("id", peerId);
 
     FILE *fp;
     char *buffer = static_cast<char *>(malloc(Peer::GrpcClient::CHUNK_SIZE));
@@ -325,10 +379,49 @@ int Peer::GrpcClient::UploadModel(const char *modelFilename)
         return ret;
     }
 
+    if (offset > 0 && fseeko(fp, static_cast<off_t>(offset), SEEK_SET) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "fseeko: %" PRIu64, offset);
+        if (fclose(fp) < 0) {
+            ErrPrintCode(errno, "fclose");
+        }
+        free(buffer);
+        buffer = nullptr;
+        return ret;
+    }
+
+    std::unique_ptr<::grpc::ClientWriter<::peer_nn::ModelFile>> writer(stub->UploadModel(&context, &response));
+    ::peer_nn::ModelFile file;
+
+    // NOTE:
+    // The first message carries the digest, offset and size of the model,
+    // it is sent even if there is no more contents to upload.
+    if (digest.empty() == false) {
+        file.set_digest(digest);
+        file.set_offset(offset);
+        file.set_size(size);
+    }
+
     size_t sz;
-    while ((sz = fread(buffer, 1, Peer::GrpcClient::CHUNK_SIZE, fp)) > 0) {
+    bool first = true;
+    while ((sz = fread(buffer, 1, Peer::GrpcClient::CHUNK_SIZE, fp)) > 0 || first == true) {
         file.set_content(buffer, sz);
-        writer->Write(file);
+        if (writer->Write(file) == false) {
+            // NOTE:
+            // The stream is closed, the status is going to be gotten from the Finish()
+            break;
+        }
+
+        if (first == true) {
+            file.clear_digest();
+            file.clear_offset();
+            file.clear_size();
+            first = false;
+        }
+
+        if (sz == 0) {
+            break;
+        }
     }
 
     if (ferror(fp) != 0) {
@@ -346,8 +439,11 @@ int Peer::GrpcClient::UploadModel(const char *modelFilename)
 
     ::grpc::Status status = writer->Finish();
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
+    }
+
+    if (digest.empty() == false) {
+        return static_cast<int>(response.status());
     }
 
     return 0;
@@ -417,12 +513,12 @@ int Peer::GrpcClient::GetInputTensorInfo(const beyond_tensor_info *&info, int &s
     ::peer_nn::Empty request;
     ::peer_nn::TensorInfos tensorInfos;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
     ::grpc::Status status = stub->GetInputTensorInfo(&context, request, &tensorInfos);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     beyond_tensor_info *__info = nullptr;
@@ -480,10 +576,10 @@ int Peer::GrpcClient::SetInputTensorInfo(const beyond_tensor_info *info, int siz
         return ret;
     }
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     ::grpc::Status status = stub->SetInputTensorInfo(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     beyond_tensor_info *_info;
@@ -516,12 +612,12 @@ int Peer::GrpcClient::GetOutputTensorInfo(const beyond_tensor_info *&info, int &
     ::peer_nn::Empty request;
     ::peer_nn::TensorInfos tensorInfos;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
     ::grpc::Status status = stub->GetOutputTensorInfo(&context, request, &tensorInfos);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     beyond_tensor_info *__info = nullptr;
@@ -556,10 +652,10 @@ int Peer::GrpcClient::SetOutputTensorInfo(const beyond_tensor_info *info, int si
         return ret;
     }
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     ::grpc::Status status = stub->SetOutputTensorInfo(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     beyond_tensor_info *_info;
@@ -577,18 +673,21 @@ int Peer::GrpcClient::SetOutputTensorInfo(const beyond_tensor_info *info, int si
     return response.status();
 }
 
-int Peer::GrpcClient::Prepare(int &requestPort, int &responsePort)
+int Peer::GrpcClient::Prepare(int &requestPort, int &responsePort, int &credits, std::string &localChannel)
 {
     ::grpc::ClientContext context;
     ::peer_nn::Empty request;
     ::peer_nn::PreparedResponse response;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
+    if (gst != nullptr && gst->IsTracing() == true) {
+        context.AddMetadata("trace", "1");
+    }
 
     ::grpc::Status status = stub->Prepare(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     int ret = response.status();
@@ -599,6 +698,8 @@ int Peer::GrpcClient::Prepare(int &requestPort, int &responsePort)
 
     requestPort = response.request_port();
     responsePort = response.response_port();
+    credits = response.credits();
+    localChannel = response.local_channel();
 
     return ret;
 }
@@ -609,12 +710,12 @@ int Peer::GrpcClient::Stop(void)
     ::peer_nn::Empty request;
     ::peer_nn::Response response;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
     ::grpc::Status status = stub->Stop(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     return response.status();
@@ -626,12 +727,12 @@ int Peer::GrpcClient::GetInfo(beyond_peer_info *info)
     ::peer_nn::Empty request;
     ::peer_nn::Info response;
 
+    SetDeadline(context, Peer::GrpcClient::CONTROL_TIMEOUT);
     context.AddMetadata("id", peerId);
 
     ::grpc::Status status = stub->GetInfo(&context, request, &response);
     if (status.ok() == false) {
-        ErrPrint("Error: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
-        return -EFAULT;
+        return ConvertStatus(status);
     }
 
     beyond_peer_info_runtime *runtimes = nullptr;
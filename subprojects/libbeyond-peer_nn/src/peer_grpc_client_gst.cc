@@ -19,13 +19,18 @@
 #endif
 
 #include "peer_grpc_client_gst.h"
+#include "peer_event_object.h"
 #include "peer_model.h"
+#include "peer_result_pool.h"
 
 #include <cstdio>
 #include <cerrno>
+#include <cstdlib>
+#include <ctime>
 
 #include <exception>
 #include <memory>
+#include <vector>
 
 #include <pthread.h>
 
@@ -40,6 +45,30 @@
 
 #include "beyond/plugin/peer_nn_plugin.h"
 
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+#define COND_BROADCAST(v)                                \
+    do {                                                 \
+        int ret = pthread_cond_broadcast(v);             \
+        if (ret != 0) {                                  \
+            ErrPrintCode(ret, "pthread_cond_broadcast"); \
+        }                                                \
+    } while (0)
+
 int Peer::GrpcClient::Gst::Thread::CommandHandlerReady(Peer::GrpcClient::Gst *impls, void *data)
 {
     return 0;
@@ -51,25 +80,109 @@ int Peer::GrpcClient::Gst::Thread::CommandHandlerPrepare(Peer::GrpcClient::Gst *
     int ret = 0;
 
     do {
-        impls->threadCtx.gstSource = Peer::GrpcClient::Gst::Source::Create(impls, prepareData->request);
+        if (prepareData->stream == true) {
+            impls->threadCtx.stream = Peer::GrpcClient::Gst::Stream::Create(impls);
+            if (impls->threadCtx.stream == nullptr) {
+                ErrPrint("Failed to open the stream");
+                ret = -EFAULT;
+                break;
+            }
+
+            impls->threadCtx.gstSource = Peer::GrpcClient::Gst::Source::Create(impls, impls->threadCtx.stream);
+            if (impls->threadCtx.gstSource == nullptr) {
+                ErrPrint("Failed to create the source");
+                impls->threadCtx.stream->Destroy();
+                impls->threadCtx.stream = nullptr;
+                ret = -EFAULT;
+            }
+            break;
+        }
+
+        Peer::TensorChannel *channel = nullptr;
+        if (prepareData->local != nullptr && impls->secretKey.empty() == true) {
+            // NOTE:
+            // The local channel is reachable only if the server is on the same host.
+            // It is not sealed, so it is not used if the session key is exchanged.
+            channel = Peer::TensorChannel::ConnectLocal(prepareData->local);
+        }
+
+        if (channel == nullptr) {
+            int fd = -1;
+            ret = Peer::TensorChannel::Connect(prepareData->host, prepareData->port, fd);
+            if (ret < 0) {
+                ErrPrint("Failed to connect the tensor channel: %s:%d", prepareData->host, prepareData->port);
+                break;
+            }
+
+            channel = Peer::TensorChannel::Create(fd);
+            if (channel == nullptr) {
+                if (close(fd) < 0) {
+                    ErrPrintCode(errno, "close");
+                }
+                ret = -ENOMEM;
+                break;
+            }
+
+            if (impls->secretKey.empty() == false) {
+                // NOTE:
+                // The same authenticator which exchanged the session key
+                Peer *peer = impls->grpcClient->peer;
+                beyond::AuthenticatorInterface *auth = peer->caAuthenticator != nullptr ? peer->caAuthenticator : peer->authenticator;
+                ret = auth != nullptr ? channel->SetSecret(auth, impls->secretKey, true) : -EINVAL;
+                if (ret < 0) {
+                    ErrPrint("Failed to seal the tensor channel: %d", ret);
+                    channel->Destroy();
+                    channel = nullptr;
+                    break;
+                }
+            }
+        }
+
+        // NOTE:
+        // The result buffers are allocated by the descriptors which are given by the server,
+        // cap them by the output of the model if it is negotiated.
+        const beyond_tensor_info *info = nullptr;
+        int size = 0;
+        if (impls->GetModel()->GetOutputTensorInfo(info, size) == 0 && info != nullptr && size > 0) {
+            ret = channel->SetLimit(info, size);
+            if (ret < 0) {
+                ErrPrint("Unable to limit the tensor channel: %d tensors", size);
+                channel->Destroy();
+                channel = nullptr;
+                break;
+            }
+        }
+
+        impls->threadCtx.channel = channel;
+
+        if (prepareData->request != nullptr) {
+            impls->threadCtx.gstSource = Peer::GrpcClient::Gst::Source::Create(impls, prepareData->request);
+        } else {
+            impls->threadCtx.gstSource = Peer::GrpcClient::Gst::Source::Create(impls, impls->threadCtx.channel);
+        }
         if (impls->threadCtx.gstSource == nullptr) {
             ErrPrint("Failed to build the gst pipeline");
+            impls->threadCtx.channel->Destroy();
+            impls->threadCtx.channel = nullptr;
             ret = -EFAULT;
             break;
         }
 
-        impls->threadCtx.gstSink = Peer::GrpcClient::Gst::Sink::Create(impls, prepareData->response);
+        impls->threadCtx.gstSink = Peer::GrpcClient::Gst::Sink::Create(impls, impls->threadCtx.channel);
         if (impls->threadCtx.gstSink == nullptr) {
-            ErrPrint("Failed to build the gst pipeline");
+            ErrPrint("Failed to create the sink");
             impls->threadCtx.gstSource->Destroy();
             impls->threadCtx.gstSource = nullptr;
+            impls->threadCtx.channel->Destroy();
+            impls->threadCtx.channel = nullptr;
             ret = -EFAULT;
             break;
         }
     } while (0);
 
     g_free(prepareData->request);
-    g_free(prepareData->response);
+    g_free(prepareData->host);
+    g_free(prepareData->local);
 
     delete prepareData;
     prepareData = nullptr;
@@ -87,7 +200,7 @@ int Peer::GrpcClient::Gst::Thread::CommandHandlerInvoke(Peer::GrpcClient::Gst *i
 {
     InvokeData *invokeData = static_cast<InvokeData *>(data);
 
-    int ret = impls->threadCtx.gstSource->Invoke(invokeData);
+    int ret = impls->Dispatch(invokeData);
     if (ret < 0) {
         ErrPrint("Failed to run invoke");
     }
@@ -104,7 +217,14 @@ int Peer::GrpcClient::Gst::Thread::CommandHandlerInvoke(Peer::GrpcClient::Gst *i
 int Peer::GrpcClient::Gst::Thread::CommandHandlerStop(Peer::GrpcClient::Gst *impls, void *data)
 {
     impls->threadCtx.gstSource->Stop();
-    impls->threadCtx.gstSink->Stop();
+
+    if (impls->threadCtx.gstSink != nullptr) {
+        impls->threadCtx.gstSink->Stop();
+    }
+
+    if (impls->threadCtx.stream != nullptr) {
+        impls->threadCtx.stream->Stop();
+    }
     return 0;
 }
 
@@ -171,6 +291,396 @@ gboolean Peer::GrpcClient::Gst::Thread::CommandHandle(GSource *source, GSourceFu
     return TRUE;
 }
 
+void Peer::GrpcClient::Gst::PushRequest(InvokeData *invokeData)
+{
+    invokeData->deadline = Peer::Trace::Now() + REQUEST_TIMEOUT * 1000llu;
+
+    MUTEX_LOCK(&requestMutex);
+    requestMap[invokeData->requestId] = invokeData;
+    MUTEX_UNLOCK(&requestMutex);
+}
+
+Peer::GrpcClient::Gst::InvokeData *Peer::GrpcClient::Gst::PopRequest(uint64_t requestId)
+{
+    InvokeData *invokeData = nullptr;
+
+    MUTEX_LOCK(&requestMutex);
+    auto it = requestMap.find(requestId);
+    if (it != requestMap.end()) {
+        invokeData = it->second;
+        requestMap.erase(it);
+        COND_BROADCAST(&creditCond);
+    }
+    MUTEX_UNLOCK(&requestMutex);
+
+    return invokeData;
+}
+
+// NOTE:
+// The results of the requests which are sent via the RTP are given in order,
+// the older requests which were sent already are lost (by the network or the pipeline of the server), they are canceled.
+Peer::GrpcClient::Gst::InvokeData *Peer::GrpcClient::Gst::PopResult(uint64_t requestId)
+{
+    if (preprocessing.empty() == false) {
+        std::vector<InvokeData *> lost;
+
+        MUTEX_LOCK(&requestMutex);
+        auto it = requestMap.begin();
+        while (it != requestMap.end() && it->first < requestId) {
+            if (it->second->sent == false) {
+                ++it;
+                continue;
+            }
+
+            lost.push_back(it->second);
+            it = requestMap.erase(it);
+        }
+
+        if (lost.empty() == false) {
+            countOfCanceled += lost.size();
+            COND_BROADCAST(&creditCond);
+        }
+        MUTEX_UNLOCK(&requestMutex);
+
+        for (InvokeData *invokeData : lost) {
+            CancelRequest(invokeData);
+        }
+    }
+
+    InvokeData *invokeData = PopRequest(requestId);
+    if (invokeData == nullptr) {
+        ErrPrint("Unknown request: %llu", static_cast<unsigned long long>(requestId));
+    }
+
+    return invokeData;
+}
+
+// NOTE:
+// This is invoked on the streaming thread when the request passes the lossy queue of the request pipeline.
+// The older requests which did not pass the queue were dropped, they are canceled.
+// If the requestId is REQUEST_ID_NONE, the oldest one which is not sent yet is considered as passed.
+uint64_t Peer::GrpcClient::Gst::SentRequest(uint64_t requestId)
+{
+    std::vector<InvokeData *> dropped;
+
+    MUTEX_LOCK(&requestMutex);
+    auto it = requestMap.begin();
+    while (it != requestMap.end()) {
+        if (it->second->sent == true) {
+            ++it;
+            continue;
+        }
+
+        if (requestId == REQUEST_ID_NONE) {
+            requestId = it->first;
+        }
+
+        if (it->first >= requestId) {
+            break;
+        }
+
+        dropped.push_back(it->second);
+        it = requestMap.erase(it);
+    }
+
+    it = requestMap.find(requestId);
+    if (it != requestMap.end()) {
+        it->second->sent = true;
+    } else {
+        ErrPrint("Unknown request: %llu", static_cast<unsigned long long>(requestId));
+        requestId = REQUEST_ID_NONE;
+    }
+
+    if (dropped.empty() == false) {
+        countOfDropped += dropped.size();
+        COND_BROADCAST(&creditCond);
+    }
+    MUTEX_UNLOCK(&requestMutex);
+
+    for (InvokeData *invokeData : dropped) {
+        CancelRequest(invokeData);
+    }
+
+    return requestId;
+}
+
+void Peer::GrpcClient::Gst::FreeTensor(beyond_tensor *&tensor, int size)
+{
+    if (tensor == nullptr) {
+        return;
+    }
+
+    if (grpcClient->peer->clientCtx->pool->Release(tensor) == 0) {
+        tensor = nullptr;
+        return;
+    }
+
+    for (int i = 0; i < size; i++) {
+        free(tensor[i].data);
+        tensor[i].data = nullptr;
+    }
+
+    free(tensor);
+    tensor = nullptr;
+}
+
+// NOTE:
+// This is invoked on the gst thread when a result is given from the channel or the stream.
+// The tensor is given to the caller of the GetOutput(), or it is released here.
+void Peer::GrpcClient::Gst::DeliverResult(uint64_t requestId, beyond_tensor *tensor, int size, const Peer::Trace::Record *result)
+{
+    Peer *peer = grpcClient->peer;
+
+    InvokeData *inferenceData = PopResult(requestId);
+    if (inferenceData == nullptr) {
+        // NOTE:
+        // The request is already canceled, the late result is discarded
+        FreeTensor(tensor, size);
+        return;
+    }
+
+    const beyond_tensor_info *tensorInfo = nullptr;
+    int infoSize = 0;
+    for (int i = 0; i < size; i++) {
+        if (tensor[i].type != BEYOND_TENSOR_TYPE_UNSUPPORTED) {
+            continue;
+        }
+
+        if (tensorInfo == nullptr && grpcClient->GetOutputTensorInfo(tensorInfo, infoSize) < 0) {
+            tensorInfo = nullptr;
+            infoSize = 0;
+        }
+
+        if (tensorInfo != nullptr && i < infoSize) {
+            tensor[i].type = tensorInfo[i].type;
+        } else {
+            DbgPrint("Warning: Tensor type is not determined");
+        }
+    }
+
+    // Update the tensor and its count
+    inferenceData->tensor = tensor;
+    inferenceData->size = size;
+
+    Peer::Trace::Record record = inferenceData->record;
+    if (result != nullptr) {
+        record.received = result->received;
+        record.copied = result->copied;
+        record.server = result->server;
+    }
+
+    // NOTE:
+    // Separate userContext from the inferenceData.
+    void *context = const_cast<void *>(inferenceData->context);
+    inferenceData->context = nullptr;
+
+    int ret = threadCtx.output->Send(Peer::GrpcClient::Gst::Command::IdInvoke, static_cast<void *>(inferenceData));
+    if (ret < 0) {
+        if (peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR, context) < 0) {
+            ErrPrint("Unable to publish the event");
+            // Go ahead, there is nothing to do for this anymore.
+        }
+
+        FreeTensor(tensor, size);
+        inferenceData->tensor = nullptr;
+        delete inferenceData;
+        inferenceData = nullptr;
+    } else {
+        // After sending the inferenceData,
+        // Do not access the inferenceData afterwards.
+        if (peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_SUCCESS, context) < 0) {
+            ErrPrint("Unable to publish the event");
+            // Go ahead, there is nothing to do for this anymore.
+        }
+
+        if (trace != nullptr) {
+            record.delivered = Peer::Trace::Now();
+            trace->Update(record);
+        }
+    }
+
+    // NOTE:
+    // A credit is released, the waiting request can be sent now
+    DispatchBacklog();
+}
+
+void Peer::GrpcClient::Gst::CancelResult(uint64_t requestId)
+{
+    InvokeData *invokeData = PopResult(requestId);
+    if (invokeData == nullptr) {
+        return;
+    }
+
+    MUTEX_LOCK(&requestMutex);
+    countOfCanceled++;
+    MUTEX_UNLOCK(&requestMutex);
+
+    CancelRequest(invokeData);
+
+    // NOTE:
+    // The credit of the canceled request is released as well
+    DispatchBacklog();
+}
+
+// NOTE:
+// This is invoked on the gst thread periodically.
+// The result or the cancellation of a request could be lost (e.g. the RTP packets, the server is gone),
+// such requests are canceled after the REQUEST_TIMEOUT, otherwise they hold the credits forever.
+void Peer::GrpcClient::Gst::ExpireRequests(void)
+{
+    std::vector<InvokeData *> expired;
+    uint64_t now = Peer::Trace::Now();
+
+    MUTEX_LOCK(&requestMutex);
+    auto it = requestMap.begin();
+    while (it != requestMap.end()) {
+        if (it->second->deadline > now) {
+            ++it;
+            continue;
+        }
+
+        expired.push_back(it->second);
+        it = requestMap.erase(it);
+    }
+
+    if (expired.empty() == false) {
+        countOfCanceled += expired.size();
+        COND_BROADCAST(&creditCond);
+    }
+    MUTEX_UNLOCK(&requestMutex);
+
+    for (InvokeData *invokeData : expired) {
+        ErrPrint("Request %llu is expired", static_cast<unsigned long long>(invokeData->requestId));
+        CancelRequest(invokeData);
+    }
+
+    if (expired.empty() == false) {
+        DispatchBacklog();
+    }
+}
+
+gboolean Peer::GrpcClient::Gst::Thread::ExpireHandler(gpointer user_data)
+{
+    Peer::GrpcClient::Gst *impls = static_cast<Peer::GrpcClient::Gst *>(user_data);
+    impls->ExpireRequests();
+    return G_SOURCE_CONTINUE;
+}
+
+void Peer::GrpcClient::Gst::CancelRequest(InvokeData *invokeData)
+{
+    DbgPrint("Request %llu is canceled", static_cast<unsigned long long>(invokeData->requestId));
+
+    int ret = grpcClient->peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_CANCELED, const_cast<void *>(invokeData->context));
+    if (ret < 0) {
+        ErrPrint("Unable to publish the event");
+    }
+
+    delete invokeData;
+}
+
+void Peer::GrpcClient::Gst::CancelRequests(void)
+{
+    std::map<uint64_t, InvokeData *> canceled;
+    std::deque<InvokeData *> waiting;
+
+    MUTEX_LOCK(&requestMutex);
+    canceled.swap(requestMap);
+    waiting.swap(backlog);
+    COND_BROADCAST(&creditCond);
+    MUTEX_UNLOCK(&requestMutex);
+
+    for (auto &it : canceled) {
+        CancelRequest(it.second);
+    }
+
+    for (InvokeData *invokeData : waiting) {
+        CancelRequest(invokeData);
+    }
+}
+
+// NOTE:
+// Must be called with the requestMutex
+bool Peer::GrpcClient::Gst::HasCredit(void) const
+{
+    return credits <= 0 || static_cast<int>(requestMap.size()) < credits;
+}
+
+// NOTE:
+// This is invoked on the gst thread.
+// If there is no credit, the request waits in the backlog or one of them is dropped by the dropPolicy.
+int Peer::GrpcClient::Gst::Dispatch(InvokeData *invokeData)
+{
+    InvokeData *dropped = nullptr;
+
+    MUTEX_LOCK(&requestMutex);
+    if (backlog.empty() == true && HasCredit() == true) {
+        MUTEX_UNLOCK(&requestMutex);
+        return threadCtx.gstSource->Invoke(invokeData);
+    }
+
+    if (dropPolicy == BEYOND_PLUGIN_PEER_NN_DROP_POLICY_BLOCK || static_cast<int>(backlog.size()) < BACKLOG_SIZE) {
+        // NOTE:
+        // The blocking policy does not use the backlog in general,
+        // the caller waits for the credit before sending the request to here.
+        backlog.push_back(invokeData);
+    } else if (dropPolicy == BEYOND_PLUGIN_PEER_NN_DROP_POLICY_DROP_NEWEST) {
+        dropped = invokeData;
+        countOfDropped++;
+    } else {
+        dropped = backlog.front();
+        backlog.pop_front();
+        backlog.push_back(invokeData);
+        countOfDropped++;
+    }
+    MUTEX_UNLOCK(&requestMutex);
+
+    if (dropped != nullptr) {
+        CancelRequest(dropped);
+    }
+
+    return 0;
+}
+
+// NOTE:
+// This is invoked on the gst thread when the in-flight requests are completed.
+void Peer::GrpcClient::Gst::DispatchBacklog(void)
+{
+    while (threadCtx.gstSource != nullptr) {
+        MUTEX_LOCK(&requestMutex);
+        if (backlog.empty() == true || HasCredit() == false) {
+            MUTEX_UNLOCK(&requestMutex);
+            break;
+        }
+
+        InvokeData *invokeData = backlog.front();
+        backlog.pop_front();
+        MUTEX_UNLOCK(&requestMutex);
+
+        // NOTE:
+        // The source releases the invokeData if it fails to send it
+        void *context = const_cast<void *>(invokeData->context);
+        if (threadCtx.gstSource->Invoke(invokeData) < 0) {
+            int ret = grpcClient->peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR, context);
+            if (ret < 0) {
+                ErrPrint("Unable to publish the event");
+            }
+        }
+    }
+}
+
+void Peer::GrpcClient::Gst::GetStatistics(unsigned long long &dropped, unsigned long long &canceled)
+{
+    MUTEX_LOCK(&requestMutex);
+    dropped = countOfDropped;
+    canceled = countOfCanceled;
+    MUTEX_UNLOCK(&requestMutex);
+}
+
+bool Peer::GrpcClient::Gst::IsTracing(void) const
+{
+    return trace != nullptr;
+}
+
 std::shared_ptr<Peer::Model> Peer::GrpcClient::Gst::GetModel(void) const
 {
     return model;
@@ -301,11 +811,58 @@ void Peer::GrpcClient::Gst::Destroy(void)
         threadCtx.gstSink = nullptr;
     }
 
+    if (threadCtx.stream != nullptr) {
+        threadCtx.stream->Destroy();
+        threadCtx.stream = nullptr;
+    }
+
+    if (threadCtx.channel != nullptr) {
+        threadCtx.channel->Destroy();
+        threadCtx.channel = nullptr;
+    }
+
+    if (trace != nullptr) {
+        trace->Destroy();
+        trace = nullptr;
+    }
+
     delete this;
 }
 
 int Peer::GrpcClient::Gst::Configure(const beyond_plugin_peer_nn_config::client_description *client)
 {
+    if (client->max_inflight < 0) {
+        ErrPrint("Invalid max inflight: %d", client->max_inflight);
+        return -EINVAL;
+    }
+
+    if (client->drop_policy < BEYOND_PLUGIN_PEER_NN_DROP_POLICY_DROP_OLDEST || client->drop_policy > BEYOND_PLUGIN_PEER_NN_DROP_POLICY_BLOCK) {
+        ErrPrint("Invalid drop policy: %d", client->drop_policy);
+        return -EINVAL;
+    }
+
+    if (client->transport < BEYOND_PLUGIN_PEER_NN_TRANSPORT_CHANNEL || client->transport > BEYOND_PLUGIN_PEER_NN_TRANSPORT_GRPC) {
+        ErrPrint("Invalid transport: %d", client->transport);
+        return -EINVAL;
+    }
+
+    if (client->result_pool < 0) {
+        ErrPrint("Invalid result pool: %d", client->result_pool);
+        return -EINVAL;
+    }
+
+    maxInflight = client->max_inflight;
+    dropPolicy = client->drop_policy;
+    transport = client->transport;
+    grpcClient->peer->clientCtx->pool->SetCapacity(client->result_pool);
+
+    if (client->trace != 0 && trace == nullptr) {
+        trace = Peer::Trace::Create(client->trace_output);
+        if (trace == nullptr) {
+            return -ENOMEM;
+        }
+    }
+
     beyond_input_type input_type = static_cast<beyond_input_type>(client->input_type);
     if (input_type == BEYOND_INPUT_TYPE_IMAGE) {
         rtpConfig = {
@@ -331,114 +888,56 @@ int Peer::GrpcClient::Gst::Configure(const beyond_plugin_peer_nn_config::client_
     return 0;
 }
 
-int Peer::GrpcClient::Gst::TensorInfoToDesc(const beyond_tensor_info *info, int size, char *&strbuf, int &len)
+int Peer::GrpcClient::Gst::Prepare(const char *host, int requestPort, int responsePort, int credits, const char *localChannel)
 {
-    std::string desc;
-
-    desc = std::string("other/tensors,num_tensors=") + std::to_string(size) + ",framerate=(fraction)0/1";
-
-    for (int i = 0; i < size; i++) {
-        if (i > 0) {
-            desc += std::string(",");
-        }
+    PrepareData *desc;
 
-        // NOTE:
-        // NHWC (tflite)
-        // nnstreamer reverses the dimension for the CAPS negotiation its internal uses.
-        desc += std::string(",types=(string)") + std::string(beyond::Inference::TensorTypeToString(info[i].type)) + std::string(",dimensions=(string)");
-        switch (info[i].dims->size) {
-        case 4:
-            desc += std::to_string(info[i].dims->data[3]) + std::string(":");
-            FALLTHROUGH;
-        case 3:
-            desc += std::to_string(info[i].dims->data[2]) + std::string(":");
-            FALLTHROUGH;
-        case 2:
-            desc += std::to_string(info[i].dims->data[1]) + std::string(":");
-            FALLTHROUGH;
-        case 1:
-            desc += std::to_string(info[i].dims->data[0]);
-            FALLTHROUGH;
-        default:
-            switch (info[i].dims->size) {
-            case 1:
-                desc += std::string(":1");
-                FALLTHROUGH;
-            case 2:
-                desc += std::string(":1");
-                FALLTHROUGH;
-            case 3:
-                desc += std::string(":1");
-                FALLTHROUGH;
-            default:
-                break;
-            }
-            break;
-        }
+    if (credits < 0) {
+        credits = 0;
     }
 
-    char *_strbuf = strdup(desc.c_str());
-    if (_strbuf == nullptr) {
-        int ret = -errno;
-        ErrPrintCode(errno, "strdup");
-        return ret;
+    if (maxInflight > 0 && (credits == 0 || maxInflight < credits)) {
+        credits = maxInflight;
     }
 
-    strbuf = _strbuf;
-    len = desc.size();
-    return 0;
-}
-
-int Peer::GrpcClient::Gst::Prepare(const char *host, int requestPort, int responsePort)
-{
-    char *infoString;
-
-    if (preprocessing.empty() == true) {
-        const beyond_tensor_info *info;
-        int size;
-
-        int len;
-
-        int ret = grpcClient->GetInputTensorInfo(info, size);
-        if (ret < 0) {
-            ErrPrint("Unable to get the input tensorInfo");
-            return ret;
-        }
-
-        ret = TensorInfoToDesc(info, size, infoString, len);
-        if (ret < 0) {
-            ErrPrint("Failed to build the pipeline description for the tensor information");
-            return ret;
-        }
-    } else {
-        infoString = strdup(preprocessing.c_str());
-        if (infoString == nullptr) {
-            int ret = -errno;
-            ErrPrintCode(errno, "strdup");
-            return ret;
-        }
-    }
-
-    PrepareData *desc;
+    DbgPrint("Credits: %d (client: %d), drop policy: %d", credits, maxInflight, dropPolicy);
+    this->credits = credits;
 
     try {
         desc = new PrepareData();
     } catch (std::exception &e) {
         ErrPrint("new failed: %s", e.what());
-        free(infoString);
-        infoString = nullptr;
         return -ENOMEM;
     }
 
-    gchar *postPipeline = nullptr;
+    desc->request = nullptr;
+    desc->host = g_strdup(host);
+    desc->local = nullptr;
+    desc->port = responsePort;
+    desc->stream = false;
+    if (desc->host == nullptr) {
+        ErrPrint("g_strdup failed");
+        delete desc;
+        desc = nullptr;
+        return -ENOMEM;
+    }
+
     if (preprocessing.empty() == true) {
         // NOTE
-        // When input_config is not set, use tcp + gdp payloder
-        // TODO: need to handle secured channel maybe by using RTSP over tcp + tls
-
-        // Otherwise, need to find general format of rtp payloder for raw tensor
-        postPipeline = g_strdup_printf("gdppay ! tcpclientsink host=%s port=%d", host, requestPort);
+        // When input_config is not set, the raw tensors are sent via the tensor channel,
+        // the server gives the same port for the request and the response.
+        // If the session key is exchanged, the TCP frames are sealed by it.
+        if (transport == BEYOND_PLUGIN_PEER_NN_TRANSPORT_GRPC) {
+            DbgPrint("The tensors are exchanged via the Infer RPC, the tensor channel(%d) is not used", responsePort);
+            desc->stream = true;
+        } else if (requestPort != responsePort) {
+            DbgPrint("Request port(%d) is ignored, the tensor channel(%d) is used", requestPort, responsePort);
+        }
     } else {
+        gchar *postPipeline = nullptr;
+
+        // NOTE:
+        // The host is quoted, it could be an IPv6 address with its scope (e.g. "fe80::1%eth0")
         if (secretKey.empty() == false) {
             // NOTE
             // In this case, the input config must build a jpegenc caps
@@ -460,9 +959,9 @@ int Peer::GrpcClient::Gst::Prepare(const char *host, int requestPort, int respon
             // as type of the buffer.
             DbgPrint("GST SecretKey found: %s", secretKey.c_str());
             postPipeline = g_strdup_printf(
-                "%s ! application/x-rtp,encoding-name=%s,payload=%d,ssrc=(uint)%s ! "
+                "%s name=" PAYLOADER_NAME " ! application/x-rtp,encoding-name=%s,payload=%d,ssrc=(uint)%s ! "
                 "srtpenc key=%s ! "
-                "udpsink host=%s port=%d",
+                "udpsink host=\"%s\" port=%d",
                 rtpConfig.payloader.c_str(),
                 rtpConfig.encodingName.c_str(),
                 rtpConfig.payload,
@@ -471,45 +970,44 @@ int Peer::GrpcClient::Gst::Prepare(const char *host, int requestPort, int respon
                 host, requestPort);
         } else {
             postPipeline = g_strdup_printf(
-                "%s ! application/x-rtp,encoding-name=%s,payload=%d ! "
-                "udpsink host=%s port=%d",
+                "%s name=" PAYLOADER_NAME " ! application/x-rtp,encoding-name=%s,payload=%d ! "
+                "udpsink host=\"%s\" port=%d",
                 rtpConfig.payloader.c_str(),
                 rtpConfig.encodingName.c_str(),
                 rtpConfig.payload,
                 host, requestPort);
         }
-    }
 
-    if (postPipeline == nullptr) {
-        ErrPrint("g_strdup_printf failed");
-        free(infoString);
-        infoString = nullptr;
-        delete desc;
-        desc = nullptr;
-        return -EFAULT;
-    }
+        if (postPipeline == nullptr) {
+            ErrPrint("g_strdup_printf failed");
+            g_free(desc->host);
+            desc->host = nullptr;
+            delete desc;
+            desc = nullptr;
+            return -EFAULT;
+        }
 
-    desc->request = g_strdup_printf("appsrc name=" SRCX_NAME " ! %s ! queue leaky=2 max-size-buffers=1 ! %s", infoString, postPipeline);
-    g_free(postPipeline);
-    postPipeline = nullptr;
-    free(infoString);
-    infoString = nullptr;
-    if (desc->request == nullptr) {
-        ErrPrint("g_strdup_printf failed");
-        delete desc;
-        desc = nullptr;
-        return -EFAULT;
+        // NOTE:
+        // The in-flight requests never exceed the credits,
+        // therefore the lossy queue does not drop the request if the credits is given.
+        desc->request = g_strdup_printf("appsrc name=" SRCX_NAME " ! %s ! queue name=" QUEUE_NAME " leaky=2 max-size-buffers=%d ! %s",
+                                        preprocessing.c_str(), credits > 0 ? credits : 1, postPipeline);
+        g_free(postPipeline);
+        postPipeline = nullptr;
+        if (desc->request == nullptr) {
+            ErrPrint("g_strdup_printf failed");
+            g_free(desc->host);
+            desc->host = nullptr;
+            delete desc;
+            desc = nullptr;
+            return -EFAULT;
+        }
     }
 
-    desc->response = g_strdup_printf("tcpclientsrc host=%s port=%d ! gdpdepay ! other/flatbuf-tensor,framerate=0/1 ! tensor_converter ! tensor_sink name=" SINKX_NAME, host, responsePort);
-    if (desc->response == nullptr) {
-        ErrPrint("g_strdup_printf failed");
-        g_free(desc->request);
-        desc->request = nullptr;
-
-        delete desc;
-        desc = nullptr;
-        return -EFAULT;
+    if (desc->stream == false && localChannel != nullptr && localChannel[0] != '\0') {
+        // NOTE:
+        // If it fails, the TCP port is used
+        desc->local = g_strdup(localChannel);
     }
 
     int ret = command->Send(Command::IdPrepare, static_cast<void *>(desc));
@@ -517,8 +1015,11 @@ int Peer::GrpcClient::Gst::Prepare(const char *host, int requestPort, int respon
         g_free(desc->request);
         desc->request = nullptr;
 
-        g_free(desc->response);
-        desc->response = nullptr;
+        g_free(desc->host);
+        desc->host = nullptr;
+
+        g_free(desc->local);
+        desc->local = nullptr;
 
         delete desc;
         desc = nullptr;
@@ -539,6 +1040,7 @@ int Peer::GrpcClient::Gst::Prepare(const char *host, int requestPort, int respon
 int Peer::GrpcClient::Gst::Invoke(const beyond_tensor *input, int size, const void *context)
 {
     InvokeData *invokeData;
+    int ret = 0;
 
     try {
         invokeData = new InvokeData();
@@ -550,8 +1052,56 @@ int Peer::GrpcClient::Gst::Invoke(const beyond_tensor *input, int size, const vo
     invokeData->tensor = input;
     invokeData->size = size;
     invokeData->context = context;
+    invokeData->requestId = nextRequestId++;
+    invokeData->sent = false;
+    invokeData->deadline = 0;
+    if (trace != nullptr) {
+        invokeData->record.requestId = invokeData->requestId;
+        invokeData->record.invoked = Peer::Trace::Now();
+    }
+
+    if (dropPolicy == BEYOND_PLUGIN_PEER_NN_DROP_POLICY_BLOCK) {
+        // NOTE:
+        // The results are given on the gst thread, they release the credits while the caller is blocked.
+        // The lost requests are expired on the gst thread, the caller does not wait longer than the REQUEST_TIMEOUT.
+        struct timespec ts;
+        if (clock_gettime(CLOCK_REALTIME, &ts) < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "clock_gettime");
+            delete invokeData;
+            invokeData = nullptr;
+            return ret;
+        }
+
+        ts.tv_sec += REQUEST_TIMEOUT / 1000;
+        ts.tv_nsec += (REQUEST_TIMEOUT % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+
+        MUTEX_LOCK(&requestMutex);
+        while (credits > 0 && static_cast<int>(requestMap.size() + backlog.size()) >= credits) {
+            int status = pthread_cond_timedwait(&creditCond, &requestMutex, &ts);
+            if (status == ETIMEDOUT) {
+                ret = -ETIMEDOUT;
+                break;
+            } else if (status != 0) {
+                ErrPrintCode(status, "pthread_cond_timedwait");
+                break;
+            }
+        }
+        MUTEX_UNLOCK(&requestMutex);
+
+        if (ret == -ETIMEDOUT) {
+            ErrPrint("No credit is released in %d msec", REQUEST_TIMEOUT);
+            delete invokeData;
+            invokeData = nullptr;
+            return ret;
+        }
+    }
 
-    int ret = command->Send(Command::IdInvoke, static_cast<void *>(invokeData));
+    ret = command->Send(Command::IdInvoke, static_cast<void *>(invokeData));
     if (ret < 0) {
         delete invokeData;
         invokeData = nullptr;
@@ -598,13 +1148,22 @@ int Peer::GrpcClient::Gst::Stop(void)
 Peer::GrpcClient::Gst::Gst(void)
     : grpcClient(nullptr)
     , nonce(0)
-    , requestQueueMutex(PTHREAD_MUTEX_INITIALIZER)
+    , requestMutex(PTHREAD_MUTEX_INITIALIZER)
+    , maxInflight(0)
+    , dropPolicy(BEYOND_PLUGIN_PEER_NN_DROP_POLICY_DROP_OLDEST)
+    , transport(BEYOND_PLUGIN_PEER_NN_TRANSPORT_CHANNEL)
+    , credits(0)
+    , creditCond(PTHREAD_COND_INITIALIZER)
+    , countOfDropped(0llu)
+    , countOfCanceled(0llu)
     , command(nullptr)
     , output(nullptr)
     , threadCtx{
         .loop = nullptr,
         .gstSource = nullptr,
         .gstSink = nullptr,
+        .stream = nullptr,
+        .channel = nullptr,
         .cmdTable = {
             Peer::GrpcClient::Gst::Thread::CommandHandlerReady,
             Peer::GrpcClient::Gst::Thread::CommandHandlerPrepare,
@@ -613,12 +1172,29 @@ Peer::GrpcClient::Gst::Gst(void)
             Peer::GrpcClient::Gst::Thread::CommandHandlerExit,
         },
     }
+    , nextRequestId(0)
+    , trace(nullptr)
 {
 }
 
 Peer::GrpcClient::Gst::~Gst(void)
 {
-    int ret = pthread_mutex_destroy(&requestQueueMutex);
+    for (auto &it : requestMap) {
+        delete it.second;
+    }
+    requestMap.clear();
+
+    for (InvokeData *invokeData : backlog) {
+        delete invokeData;
+    }
+    backlog.clear();
+
+    int ret = pthread_cond_destroy(&creditCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_destroy");
+    }
+
+    ret = pthread_mutex_destroy(&requestMutex);
     if (ret != 0) {
         ErrPrintCode(ret, "pthread_mutex_destroy");
     }
@@ -665,7 +1241,21 @@ void *Peer::GrpcClient::Gst::Thread::Main(void *arg)
         return nullptr;
     }
 
+    GSource *expireSource = g_timeout_source_new(REQUEST_EXPIRE_INTERVAL);
+    if (expireSource != nullptr) {
+        g_source_set_callback(expireSource, Peer::GrpcClient::Gst::Thread::ExpireHandler, static_cast<gpointer>(impls), nullptr);
+        g_source_attach(expireSource, ctx);
+        g_source_unref(expireSource);
+    } else {
+        ErrPrint("Failed to create a timer, the lost requests are not expired");
+    }
+
     if (impls->threadCtx.command->Send(Command::IdReady) < 0) {
+        if (expireSource != nullptr) {
+            g_source_destroy(expireSource);
+            expireSource = nullptr;
+        }
+
         g_source_destroy(source);
         source = nullptr;
 
@@ -677,6 +1267,11 @@ void *Peer::GrpcClient::Gst::Thread::Main(void *arg)
 
     g_main_loop_run(impls->threadCtx.loop);
 
+    if (expireSource != nullptr) {
+        g_source_destroy(expireSource);
+        expireSource = nullptr;
+    }
+
     g_source_destroy(source);
     source = nullptr;
 
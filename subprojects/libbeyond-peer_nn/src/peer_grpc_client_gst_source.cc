@@ -19,10 +19,14 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
+
+#include <sys/uio.h>
 
 #include <glib.h>
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
+#include <gst/rtp/gstrtpbuffer.h>
 
 void Peer::GrpcClient::Gst::Source::BusHandler(GstBus *bus, GstMessage *message, gpointer user_data)
 {
@@ -100,6 +104,70 @@ void Peer::GrpcClient::Gst::Source::StopFeedHandler(GstElement *pipeline, gpoint
     }
 }
 
+GstPadProbeReturn Peer::GrpcClient::Gst::Source::QueueProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    Peer::GrpcClient::Gst::Source *impls = static_cast<Peer::GrpcClient::Gst::Source *>(user_data);
+    if (impls == nullptr) {
+        assert(impls != nullptr && "source cannot be nullptr");
+        ErrPrint("source cannot be nullptr");
+        return GST_PAD_PROBE_OK;
+    }
+
+    uint64_t requestId = Peer::GrpcClient::Gst::REQUEST_ID_NONE;
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (buffer != nullptr) {
+        GstReferenceTimestampMeta *meta = gst_buffer_get_reference_timestamp_meta(buffer, impls->requestCaps);
+        if (meta != nullptr) {
+            requestId = static_cast<uint64_t>(meta->timestamp);
+        }
+    }
+
+    impls->sendingId = impls->gstClient->SentRequest(requestId);
+    return GST_PAD_PROBE_OK;
+}
+
+gboolean Peer::GrpcClient::Gst::Source::StampRequest(GstBuffer **buffer, guint idx, gpointer user_data)
+{
+    Peer::GrpcClient::Gst::Source *impls = static_cast<Peer::GrpcClient::Gst::Source *>(user_data);
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+    *buffer = gst_buffer_make_writable(*buffer);
+    if (gst_rtp_buffer_map(*buffer, GST_MAP_READWRITE, &rtp) == FALSE) {
+        ErrPrint("Failed to map the RTP buffer");
+        return TRUE;
+    }
+
+    uint64_t requestId = GUINT64_TO_BE(impls->sendingId);
+    if (gst_rtp_buffer_add_extension_onebyte_header(&rtp, RTP_REQUEST_EXTENSION_ID, &requestId, sizeof(requestId)) == FALSE) {
+        ErrPrint("Failed to add the requestId to the RTP packet");
+    }
+
+    gst_rtp_buffer_unmap(&rtp);
+    return TRUE;
+}
+
+// NOTE:
+// Every RTP packet of a request has the requestId, the server gets it from the last packet of the frame.
+GstPadProbeReturn Peer::GrpcClient::Gst::Source::PayloaderProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    Peer::GrpcClient::Gst::Source *impls = static_cast<Peer::GrpcClient::Gst::Source *>(user_data);
+    if (impls->sendingId == Peer::GrpcClient::Gst::REQUEST_ID_NONE) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if ((GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) == GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList *list = gst_buffer_list_make_writable(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+        gst_buffer_list_foreach(list, Peer::GrpcClient::Gst::Source::StampRequest, user_data);
+        GST_PAD_PROBE_INFO_DATA(info) = list;
+    } else {
+        GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+        Peer::GrpcClient::Gst::Source::StampRequest(&buffer, 0, user_data);
+        GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
 Peer::GrpcClient::Gst::Source *Peer::GrpcClient::Gst::Source::Create(Peer::GrpcClient::Gst *gstClient, const gchar *pipelineDesc)
 {
     Peer::GrpcClient::Gst::Source *impls;
@@ -139,6 +207,59 @@ Peer::GrpcClient::Gst::Source *Peer::GrpcClient::Gst::Source::Create(Peer::GrpcC
         return nullptr;
     }
 
+    impls->requestCaps = gst_caps_new_empty_simple("timestamp/x-beyond-request");
+    if (impls->requestCaps == nullptr) {
+        ErrPrint("Failed to create caps for the request meta");
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    GstElement *queue = gst_bin_get_by_name(GST_BIN(impls->pipeline), QUEUE_NAME);
+    if (queue == nullptr) {
+        ErrPrint("Failed to get " QUEUE_NAME " element");
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    GstPad *pad = gst_element_get_static_pad(queue, "src");
+    gst_object_unref(queue);
+    queue = nullptr;
+    if (pad == nullptr) {
+        ErrPrint("Failed to get the src pad of " QUEUE_NAME);
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, Peer::GrpcClient::Gst::Source::QueueProbe, static_cast<gpointer>(impls), nullptr);
+    gst_object_unref(pad);
+    pad = nullptr;
+
+    GstElement *payloader = gst_bin_get_by_name(GST_BIN(impls->pipeline), PAYLOADER_NAME);
+    if (payloader == nullptr) {
+        ErrPrint("Failed to get " PAYLOADER_NAME " element");
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    pad = gst_element_get_static_pad(payloader, "src");
+    gst_object_unref(payloader);
+    payloader = nullptr;
+    if (pad == nullptr) {
+        ErrPrint("Failed to get the src pad of " PAYLOADER_NAME);
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                      Peer::GrpcClient::Gst::Source::PayloaderProbe, static_cast<gpointer>(impls), nullptr);
+    gst_object_unref(pad);
+    pad = nullptr;
+
     GSource *source = gst_bus_create_watch(impls->bus);
     if (source == nullptr) {
         ErrPrint("Failed to create a watch for bus");
@@ -175,11 +296,93 @@ Peer::GrpcClient::Gst::Source *Peer::GrpcClient::Gst::Source::Create(Peer::GrpcC
     return impls;
 }
 
+Peer::GrpcClient::Gst::Source *Peer::GrpcClient::Gst::Source::Create(Peer::GrpcClient::Gst *gstClient, Peer::TensorChannel *channel)
+{
+    Peer::GrpcClient::Gst::Source *impls;
+
+    try {
+        impls = new Peer::GrpcClient::Gst::Source();
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        return nullptr;
+    }
+
+    impls->gstClient = gstClient;
+    impls->channel = channel;
+    return impls;
+}
+
+Peer::GrpcClient::Gst::Source *Peer::GrpcClient::Gst::Source::Create(Peer::GrpcClient::Gst *gstClient, Peer::GrpcClient::Gst::Stream *stream)
+{
+    Peer::GrpcClient::Gst::Source *impls;
+
+    try {
+        impls = new Peer::GrpcClient::Gst::Source();
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        return nullptr;
+    }
+
+    impls->gstClient = gstClient;
+    impls->stream = stream;
+    return impls;
+}
+
+int Peer::GrpcClient::Gst::Source::Send(Peer::GrpcClient::Gst::InvokeData *invokeData)
+{
+    if (invokeData->size <= 0 || invokeData->size > Peer::TensorChannel::MAX_TENSORS) {
+        ErrPrint("Invalid count of tensors: %d", invokeData->size);
+        return -EINVAL;
+    }
+
+    const beyond_tensor_info *info = nullptr;
+    int size = 0;
+    int ret = gstClient->grpcClient->GetInputTensorInfo(info, size);
+    if (ret < 0) {
+        ErrPrint("Unable to get the input tensorInfo");
+        return ret;
+    }
+
+    Peer::TensorChannel::Descriptor desc[Peer::TensorChannel::MAX_TENSORS];
+    struct iovec iov[Peer::TensorChannel::MAX_TENSORS];
+    for (int i = 0; i < invokeData->size; i++) {
+        Peer::TensorChannel::FillDescriptor(desc[i],
+                                            invokeData->tensor[i].type,
+                                            invokeData->tensor[i].size,
+                                            (info != nullptr && i < size) ? info + i : nullptr);
+        iov[i].iov_base = invokeData->tensor[i].data;
+        iov[i].iov_len = invokeData->tensor[i].size;
+    }
+
+    // NOTE:
+    // The tensors are sent from the buffers of the caller directly
+    return channel->Send(invokeData->requestId, desc, iov, invokeData->size);
+}
+
 int Peer::GrpcClient::Gst::Source::Invoke(Peer::GrpcClient::Gst::InvokeData *invokeData)
 {
     int ret = 0;
 
+    // NOTE:
+    // The request must be kept before sending it, its result can be given before returning from here.
+    // The result is delivered on this thread, the record is not touched by the others while sending it.
+    if (gstClient->trace != nullptr) {
+        invokeData->record.dispatched = Peer::Trace::Now();
+    }
+
+    gstClient->PushRequest(invokeData);
+
     do {
+        if (channel != nullptr) {
+            ret = Send(invokeData);
+            break;
+        }
+
+        if (stream != nullptr) {
+            ret = stream->Send(invokeData);
+            break;
+        }
+
         // CHECKME:
         // Pipeline preroll must be done first
         // Otherwise the first input tensor is going to be used for prerolling the pipeline!
@@ -205,27 +408,25 @@ int Peer::GrpcClient::Gst::Source::Invoke(Peer::GrpcClient::Gst::InvokeData *inv
             gst_buffer_append_memory(buffer, mem);
         }
 
-        gst_app_src_push_buffer(GST_APP_SRC(element), buffer);
-    } while (0);
-
-    if (ret == 0) {
-        int status = pthread_mutex_lock(&gstClient->requestQueueMutex);
-        if (status != 0) {
-            ErrPrintCode(status, "pthread_mutex_lock");
+        if (ret < 0) {
+            break;
         }
 
-        // TODO:
-        // This requestQueue must be sync'd to the lossy queue element of the pipeline
-        // If there is a dropped tensor, the requestQueue also drops the related invokeData.
-        gstClient->requestQueue.push(invokeData);
+        gst_buffer_add_reference_timestamp_meta(buffer, requestCaps, static_cast<GstClockTime>(invokeData->requestId), GST_CLOCK_TIME_NONE);
 
-        status = pthread_mutex_unlock(&gstClient->requestQueueMutex);
-        if (status != 0) {
-            ErrPrintCode(status, "pthread_mutex_unlock");
+        GstFlowReturn flowRet = gst_app_src_push_buffer(GST_APP_SRC(element), buffer);
+        if (flowRet != GST_FLOW_OK) {
+            ErrPrint("Unable to push the buffer: %d", static_cast<int>(flowRet));
+            ret = -EFAULT;
         }
-    } else if (ret < 0) {
+    } while (0);
+
+    if (ret < 0) {
+        (void)gstClient->PopRequest(invokeData->requestId);
         delete invokeData;
         invokeData = nullptr;
+    } else if (gstClient->trace != nullptr) {
+        invokeData->record.sent = Peer::Trace::Now();
     }
 
     return ret;
@@ -238,6 +439,10 @@ void Peer::GrpcClient::Gst::Source::Destroy(void)
 
 int Peer::GrpcClient::Gst::Source::Stop(void)
 {
+    if (pipeline == nullptr) {
+        return 0;
+    }
+
     GstStateChangeReturn scret = gst_element_set_state(pipeline, GST_STATE_PAUSED);
     if (scret == GST_STATE_CHANGE_FAILURE) {
         ErrPrint("set PAUSED failed");
@@ -247,9 +452,14 @@ int Peer::GrpcClient::Gst::Source::Stop(void)
 }
 
 Peer::GrpcClient::Gst::Source::Source(void)
-    : pipeline(nullptr)
+    : gstClient(nullptr)
+    , channel(nullptr)
+    , stream(nullptr)
+    , pipeline(nullptr)
     , element(nullptr)
     , bus(nullptr)
+    , requestCaps(nullptr)
+    , sendingId(Peer::GrpcClient::Gst::REQUEST_ID_NONE)
 {
 }
 
@@ -269,4 +479,9 @@ Peer::GrpcClient::Gst::Source::~Source(void)
         gst_object_unref(pipeline);
         pipeline = nullptr;
     }
+
+    if (requestCaps != nullptr) {
+        gst_caps_unref(requestCaps);
+        requestCaps = nullptr;
+    }
 }
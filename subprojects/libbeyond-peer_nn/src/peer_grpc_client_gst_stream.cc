@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "peer_grpc_client_gst_stream.h"
+#include "peer_event_object.h"
+#include "peer_result_pool.h"
+#include "peer_tensor_channel.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <exception>
+#include <memory>
+
+#include <pthread.h>
+
+#include <glib.h>
+
+// NOTE:
+// This is invoked on the reader thread
+void *Peer::GrpcClient::Gst::Stream::Main(void *arg)
+{
+    Peer::GrpcClient::Gst::Stream *impls = static_cast<Peer::GrpcClient::Gst::Stream *>(arg);
+    bool closed = false;
+
+    while (closed == false) {
+        Result *result;
+
+        try {
+            result = new Result();
+        } catch (std::exception &e) {
+            ErrPrint("new: %s", e.what());
+            // NOTE:
+            // The stream cannot be read anymore, the client gets the closed stream
+            impls->clientContext->TryCancel();
+            break;
+        }
+
+        result->stream = impls;
+        result->closed = (impls->stream->Read(&result->response) == false);
+        result->received = impls->gstClient->trace != nullptr ? Peer::Trace::Now() : 0;
+        closed = result->closed;
+
+        // NOTE:
+        // Deliver the result on the gst thread, the result is released by the ResultDestroy()
+        // even if the main loop of the gst thread is not going to be run anymore.
+        g_main_context_invoke_full(impls->context, G_PRIORITY_DEFAULT,
+                                   Peer::GrpcClient::Gst::Stream::ResultHandler,
+                                   static_cast<gpointer>(result),
+                                   Peer::GrpcClient::Gst::Stream::ResultDestroy);
+    }
+
+    ::grpc::Status status = impls->stream->Finish();
+    if (status.ok() == false) {
+        DbgPrint("Stream is finished: %d, message: %s", static_cast<int>(status.error_code()), status.error_message().c_str());
+    }
+
+    return nullptr;
+}
+
+void Peer::GrpcClient::Gst::Stream::ResultDestroy(gpointer user_data)
+{
+    Result *result = static_cast<Result *>(user_data);
+    delete result;
+}
+
+// NOTE:
+// This is invoked by the result pool when the caller releases the output tensors
+void Peer::GrpcClient::Gst::Stream::ReleaseView(void *data)
+{
+    ::peer_nn::InferResponse *view = static_cast<::peer_nn::InferResponse *>(data);
+    delete view;
+}
+
+// NOTE:
+// This is invoked on the gst thread
+gboolean Peer::GrpcClient::Gst::Stream::ResultHandler(gpointer user_data)
+{
+    Result *result = static_cast<Result *>(user_data);
+    Peer::GrpcClient::Gst::Stream *impls = result->stream;
+    Peer::GrpcClient::Gst *gstClient = impls->gstClient;
+    Peer *peer = gstClient->grpcClient->peer;
+
+    if (result->closed == true) {
+        if (impls->writesDone == false) {
+            ErrPrint("Stream is closed");
+            if (peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR) < 0) {
+                ErrPrint("Unable to publish event");
+            }
+        }
+
+        // NOTE:
+        // There will be no result for the pending requests anymore
+        gstClient->CancelRequests();
+        return G_SOURCE_REMOVE;
+    }
+
+    ::peer_nn::InferResponse &response = result->response;
+    int size = response.tensors_size();
+    if (size == 0) {
+        // NOTE:
+        // The server dropped the request
+        gstClient->CancelResult(response.request_id());
+        gstClient->DispatchBacklog();
+        return G_SOURCE_REMOVE;
+    }
+
+    // NOTE:
+    // The output tensors refer the data of the response without copying them,
+    // the response is taken from the result and it is released when the caller releases the tensors.
+    ::peer_nn::InferResponse *view;
+    try {
+        view = new ::peer_nn::InferResponse();
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        gstClient->CancelResult(response.request_id());
+        gstClient->DispatchBacklog();
+        return G_SOURCE_REMOVE;
+    }
+    view->Swap(&response);
+
+    beyond_tensor *tensor = nullptr;
+    int ret = peer->clientCtx->pool->Wrap(size, Peer::GrpcClient::Gst::Stream::ReleaseView, static_cast<void *>(view), tensor);
+    if (ret < 0) {
+        gstClient->CancelResult(view->request_id());
+        gstClient->DispatchBacklog();
+        delete view;
+        view = nullptr;
+        return G_SOURCE_REMOVE;
+    }
+
+    for (int i = 0; i < size; i++) {
+        ::peer_nn::Tensor *_tensor = view->mutable_tensors(i);
+
+        tensor[i].type = static_cast<beyond_tensor_type>(_tensor->info().type());
+        tensor[i].size = static_cast<int>(_tensor->data().size());
+        tensor[i].data = static_cast<void *>(&(*_tensor->mutable_data())[0]);
+    }
+
+    if (gstClient->trace != nullptr) {
+        const ::peer_nn::Timing &timing = view->timing();
+        Peer::Trace::Record record = {};
+
+        record.received = result->received;
+        record.copied = Peer::Trace::Now();
+        record.server.recv = timing.recv();
+        record.server.convert = timing.convert();
+        record.server.filter = timing.filter();
+        record.server.post = timing.post();
+        gstClient->DeliverResult(view->request_id(), tensor, size, &record);
+        return G_SOURCE_REMOVE;
+    }
+
+    gstClient->DeliverResult(view->request_id(), tensor, size);
+    return G_SOURCE_REMOVE;
+}
+
+Peer::GrpcClient::Gst::Stream *Peer::GrpcClient::Gst::Stream::Create(Peer::GrpcClient::Gst *gstClient)
+{
+    Peer::GrpcClient::Gst::Stream *impls = nullptr;
+
+    try {
+        impls = new Peer::GrpcClient::Gst::Stream();
+        impls->clientContext = std::make_unique<::grpc::ClientContext>();
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        delete impls;
+        return nullptr;
+    }
+
+    impls->gstClient = gstClient;
+    impls->context = g_main_context_ref_thread_default();
+    impls->clientContext->AddMetadata("id", gstClient->grpcClient->peerId);
+
+    impls->stream = gstClient->grpcClient->stub->Infer(impls->clientContext.get());
+    if (impls->stream == nullptr) {
+        ErrPrint("Failed to open the stream");
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    int ret = pthread_create(&impls->threadId, nullptr, Peer::GrpcClient::Gst::Stream::Main, static_cast<void *>(impls));
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_create");
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+    impls->threadCreated = true;
+
+    return impls;
+}
+
+void Peer::GrpcClient::Gst::Stream::Destroy(void)
+{
+    delete this;
+}
+
+// NOTE:
+// This is invoked on the gst thread.
+// The tensors are copied to the request message, the gRPC serializes it before returning from the Write().
+// The Write() blocks while the flow control window of the HTTP/2 stream is exhausted.
+int Peer::GrpcClient::Gst::Stream::Send(Peer::GrpcClient::Gst::InvokeData *invokeData)
+{
+    if (writesDone == true) {
+        ErrPrint("Stream is already stopped");
+        return -EILSEQ;
+    }
+
+    if (invokeData->size <= 0 || invokeData->size > Peer::TensorChannel::MAX_TENSORS) {
+        ErrPrint("Invalid count of tensors: %d", invokeData->size);
+        return -EINVAL;
+    }
+
+    const beyond_tensor_info *info = nullptr;
+    int size = 0;
+    int ret = gstClient->grpcClient->GetInputTensorInfo(info, size);
+    if (ret < 0) {
+        ErrPrint("Unable to get the input tensorInfo");
+        return ret;
+    }
+
+    ::peer_nn::InferRequest request;
+    request.set_request_id(invokeData->requestId);
+    for (int i = 0; i < invokeData->size; i++) {
+        ::peer_nn::Tensor *tensor = request.add_tensors();
+        ::peer_nn::TensorInfo *tensorInfo = tensor->mutable_info();
+
+        tensorInfo->set_type(static_cast<::peer_nn::TensorType>(invokeData->tensor[i].type));
+        tensorInfo->set_size(invokeData->tensor[i].size);
+        if (info != nullptr && i < size && info[i].dims != nullptr) {
+            for (int j = 0; j < info[i].dims->size; j++) {
+                tensorInfo->mutable_dims()->add_data(info[i].dims->data[j]);
+            }
+        }
+
+        tensor->set_data(invokeData->tensor[i].data, invokeData->tensor[i].size);
+    }
+
+    if (stream->Write(request) == false) {
+        ErrPrint("Stream is closed");
+        return -EPIPE;
+    }
+
+    return 0;
+}
+
+// NOTE:
+// This is invoked on the gst thread.
+// The server finishes the stream after sending the results of the requests which are already sent,
+// but they are not going to be delivered, the pending requests are canceled here.
+int Peer::GrpcClient::Gst::Stream::Stop(void)
+{
+    if (writesDone == false) {
+        writesDone = true;
+        if (stream->WritesDone() == false) {
+            DbgPrint("Stream is already closed");
+        }
+    }
+
+    gstClient->CancelRequests();
+
+    Peer *peer = gstClient->grpcClient->peer;
+    int ret = peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_STOPPED);
+    if (ret < 0) {
+        DbgPrint("Unable to publish stopped event: %d", ret);
+    }
+
+    return 0;
+}
+
+Peer::GrpcClient::Gst::Stream::Stream(void)
+    : gstClient(nullptr)
+    , context(nullptr)
+    , threadCreated(false)
+    , writesDone(false)
+{
+}
+
+Peer::GrpcClient::Gst::Stream::~Stream(void)
+{
+    if (threadCreated == true) {
+        // NOTE:
+        // Cancel the RPC in order to wake up the reader thread
+        clientContext->TryCancel();
+
+        int ret = pthread_join(threadId, nullptr);
+        if (ret != 0) {
+            ErrPrintCode(ret, "pthread_join");
+        }
+        threadCreated = false;
+    } else if (stream != nullptr) {
+        clientContext->TryCancel();
+        ::grpc::Status status = stream->Finish();
+        if (status.ok() == false) {
+            DbgPrint("Stream is finished: %d", static_cast<int>(status.error_code()));
+        }
+    }
+
+    stream.reset();
+    clientContext.reset();
+
+    if (context != nullptr) {
+        g_main_context_unref(context);
+        context = nullptr;
+    }
+}
@@ -18,17 +18,31 @@
 #include "peer_nn.grpc.pb.h"
 #include "peer_grpc_server_auth.h"
 #include "peer_grpc_server_gst.h"
+#include "peer_grpc_server_registry.h"
+#include "peer_grpc_server_pool.h"
 #include "peer_model.h"
 
 #include <cstdio>
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
+#include <cinttypes>
+#include <ctime>
 
+#include <algorithm>
 #include <exception>
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
 #include <vector>
 
+#include <dirent.h>
 #include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <pthread.h>
 #include <grpc++/grpc++.h>
 #include <glib.h>
@@ -37,16 +51,75 @@
 #include <beyond/private/beyond_private.h>
 
 #include "beyond/plugin/peer_nn_plugin.h"
+#include "beyond/plugin/discovery_dns_sd_plugin.h"
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
 
 Peer::GrpcServer::GrpcServer(void)
     : server(nullptr)
     , peer(nullptr)
     , nextPeerId(0)
+    , registry(nullptr)
+    , pool(nullptr)
+    , publishing(false)
+    , nextLatency(0)
 {
+    int status = pthread_mutex_init(&uploadLock, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_init");
+    }
+
+    status = pthread_mutex_init(&clientLock, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_init");
+    }
+
+    status = pthread_mutex_init(&publishLock, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_init");
+    }
+
+    status = pthread_cond_init(&publishCond, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_init");
+    }
 }
 
 Peer::GrpcServer::~GrpcServer(void)
 {
+    int status = pthread_cond_destroy(&publishCond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_destroy");
+    }
+
+    status = pthread_mutex_destroy(&publishLock);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_destroy");
+    }
+
+    status = pthread_mutex_destroy(&clientLock);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_destroy");
+    }
+
+    status = pthread_mutex_destroy(&uploadLock);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_destroy");
+    }
 }
 
 Peer::GrpcServer *Peer::GrpcServer::Create(Peer *peer, const char *address, const char *certificate, const char *privateKey, const char *rootCert)
@@ -72,6 +145,21 @@ Peer::GrpcServer *Peer::GrpcServer::Create(Peer *peer, const char *address, cons
 
     impls->peer = peer;
 
+    impls->registry = Peer::GrpcServer::Registry::Create(peer->serverCtx->modelBudget);
+    if (impls->registry == nullptr) {
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
+    impls->pool = Peer::GrpcServer::Pool::Create(peer->serverCtx->workers);
+    if (impls->pool == nullptr) {
+        impls->registry->Destroy();
+        delete impls;
+        impls = nullptr;
+        return nullptr;
+    }
+
     int boundPort = 0;
     ::grpc::ServerBuilder builder;
 
@@ -101,6 +189,8 @@ Peer::GrpcServer *Peer::GrpcServer::Create(Peer *peer, const char *address, cons
     impls->server = builder.BuildAndStart();
     if (impls->server == nullptr) {
         ErrPrint("Failed to start a server");
+        impls->pool->Destroy();
+        impls->registry->Destroy();
         delete impls;
         impls = nullptr;
         return nullptr;
@@ -116,11 +206,22 @@ Peer::GrpcServer *Peer::GrpcServer::Create(Peer *peer, const char *address, cons
         ErrPrintCode(status, "pthread_create");
         impls->server->Shutdown();
 
+        impls->pool->Destroy();
+        impls->registry->Destroy();
         delete impls;
         impls = nullptr;
         return nullptr;
     }
 
+    // NOTE:
+    // The server works without the publisher, the load is not published in that case
+    impls->publishing = true;
+    status = pthread_create(&impls->publishId, nullptr, Peer::GrpcServer::PublishMain, impls);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_create");
+        impls->publishing = false;
+    }
+
     return impls;
 }
 
@@ -129,6 +230,19 @@ void Peer::GrpcServer::Destroy(void)
     void *ret;
     int status;
 
+    MUTEX_LOCK(&publishLock);
+    bool published = publishing;
+    publishing = false;
+    pthread_cond_signal(&publishCond);
+    MUTEX_UNLOCK(&publishLock);
+
+    if (published == true) {
+        status = pthread_join(publishId, &ret);
+        if (status != 0) {
+            ErrPrintCode(status, "pthread_join");
+        }
+    }
+
     server->Shutdown();
 
     status = pthread_join(threadId, &ret);
@@ -141,6 +255,14 @@ void Peer::GrpcServer::Destroy(void)
         it->second->Destroy();
     }
 
+    // NOTE:
+    // The clients are detached from the workers already
+    pool->Destroy();
+    pool = nullptr;
+
+    registry->Destroy();
+    registry = nullptr;
+
     delete this;
 }
 
@@ -160,7 +282,10 @@ int Peer::GrpcServer::GetGst(::grpc::ServerContext *context, Peer::GrpcServer::G
         return -ENOENT;
     }
 
-    gst = clientMap[peerId];
+    MUTEX_LOCK(&clientLock);
+    auto gstIt = clientMap.find(peerId);
+    gst = gstIt != clientMap.end() ? gstIt->second : nullptr;
+    MUTEX_UNLOCK(&clientLock);
     return 0;
 }
 
@@ -247,7 +372,9 @@ int Peer::GrpcServer::GetGst(::grpc::ServerContext *context, Peer::GrpcServer::G
                     gst->SetSecret(secretKey);
                     gst->SetNonce(cred->nonce);
 
+                    MUTEX_LOCK(&clientLock);
                     clientMap[id] = gst;
+                    MUTEX_UNLOCK(&clientLock);
                     response->set_id(id);
                     ret = 0;
                     ++nextPeerId;
@@ -268,7 +395,9 @@ int Peer::GrpcServer::GetGst(::grpc::ServerContext *context, Peer::GrpcServer::G
             std::string secretKey;
             gst->SetSecret(secretKey); // empty string
 
+            MUTEX_LOCK(&clientLock);
             clientMap[id] = gst;
+            MUTEX_UNLOCK(&clientLock);
             response->set_id(id);
             ret = 0;
             ++nextPeerId;
@@ -324,20 +453,42 @@ int Peer::GrpcServer::GetGst(::grpc::ServerContext *context, Peer::GrpcServer::G
         return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Not Found");
     }
 
-    // NOTE:
-    // Stream... filename must be gotten from LoadModel
-    // If there is no invocation of the LoadModel, this function must get failed
-    if (gst->GetModel()->GetModelPath() == nullptr) {
-        ErrPrint("LoadModel was not invoked properly");
-        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "Failed precondition");
+    ::peer_nn::ModelFile fileContents;
+    if (reader->Read(&fileContents) == false) {
+        // NOTE:
+        // Empty stream, there is nothing to write
+        fileContents.Clear();
+    }
+
+    int ret;
+    if (fileContents.digest().empty() == false) {
+        ret = ReceiveModel(gst, reader, fileContents);
+    } else {
+        // NOTE:
+        // Stream... filename must be gotten from LoadModel
+        // If there is no invocation of the LoadModel, this function must get failed
+        if (gst->GetModel()->GetModelPath() == nullptr) {
+            ErrPrint("LoadModel was not invoked properly");
+            return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "Failed precondition");
+        }
+
+        ret = WriteModel(gst, reader, fileContents);
     }
 
+    response->set_status(ret);
+    return ::grpc::Status(::grpc::StatusCode::OK, "OK");
+}
+
+int Peer::GrpcServer::WriteModel(Peer::GrpcServer::Gst *gst, ::grpc::ServerReader<::peer_nn::ModelFile> *reader, ::peer_nn::ModelFile &fileContents)
+{
     int ret = 0;
     FILE *fp = fopen(gst->GetModel()->GetModelPath(), "w+");
     if (fp != nullptr) {
-        ::peer_nn::ModelFile fileContents;
+        do {
+            if (fileContents.content().empty() == true) {
+                continue;
+            }
 
-        while (reader->Read(&fileContents) == true) {
             int sz = fwrite(fileContents.content().c_str(), 1, fileContents.content().size(), fp);
             if (sz <= 0 || static_cast<unsigned int>(sz) != fileContents.content().size()) {
                 ret = ferror(fp);
@@ -346,7 +497,7 @@ int Peer::GrpcServer::GetGst(::grpc::ServerContext *context, Peer::GrpcServer::G
                 ret = -ret;
                 break;
             }
-        }
+        } while (reader->Read(&fileContents) == true);
 
         if (fclose(fp) < 0) {
             ErrPrintCode(errno, "fclose");
@@ -356,7 +507,320 @@ int Peer::GrpcServer::GetGst(::grpc::ServerContext *context, Peer::GrpcServer::G
         ErrPrintCode(errno, "fopen, %s", gst->GetModel()->GetModelPath());
     }
 
-    response->set_status(ret);
+    return ret;
+}
+
+int Peer::GrpcServer::GetModelCacheDir(std::string &dir)
+{
+    std::string _dir = peer->serverCtx->storagePath.empty() == true ? std::string(".") : peer->serverCtx->storagePath;
+    if (_dir[_dir.size() - 1] != '/') {
+        _dir += "/";
+    }
+    _dir += "models";
+
+    if (mkdir(_dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        int ret = -errno;
+        ErrPrintCode(errno, "mkdir: %s", _dir.c_str());
+        return ret;
+    }
+
+    dir = _dir;
+    return 0;
+}
+
+int Peer::GrpcServer::GetModelCachePath(const std::string &digest, std::string &path)
+{
+    // NOTE:
+    // The digest becomes a part of the path, do not allow anything but the hex string
+    if (digest.size() != 64 || digest.find_first_not_of("0123456789abcdef") != std::string::npos) {
+        ErrPrint("Invalid digest: %s", digest.c_str());
+        return -EINVAL;
+    }
+
+    std::string dir;
+    int ret = GetModelCacheDir(dir);
+    if (ret < 0) {
+        return ret;
+    }
+
+    path = dir + std::string("/") + digest;
+    return 0;
+}
+
+void Peer::GrpcServer::TrimModelCache(void)
+{
+    struct CacheFile {
+        std::string name;
+        off_t size;
+        time_t accessed;
+    };
+
+    std::string dir;
+    if (GetModelCacheDir(dir) < 0) {
+        return;
+    }
+
+    DIR *dp = opendir(dir.c_str());
+    if (dp == nullptr) {
+        ErrPrintCode(errno, "opendir: %s", dir.c_str());
+        return;
+    }
+
+    std::vector<CacheFile> files;
+    uint64_t usage = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dp)) != nullptr) {
+        // NOTE:
+        // The cache has the models and the partially uploaded ones (".part") only,
+        // the name is the 64 bytes digest.
+        std::string name(ent->d_name);
+        std::string digest = name.substr(0, 64);
+        if (digest.size() != 64 || digest.find_first_not_of("0123456789abcdef") != std::string::npos ||
+            (name.size() > 64 && name.compare(64, std::string::npos, ".part") != 0)) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(dirfd(dp), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0 || S_ISREG(st.st_mode) == false) {
+            continue;
+        }
+
+        usage += st.st_size;
+
+        // NOTE:
+        // The model which is being uploaded is not a candidate
+        if (uploadSet.find(digest) != uploadSet.end()) {
+            continue;
+        }
+
+        try {
+            files.push_back(CacheFile{
+                .name = name,
+                .size = st.st_size,
+                .accessed = std::max(st.st_atim.tv_sec, st.st_mtim.tv_sec),
+            });
+        } catch (std::exception &e) {
+            ErrPrint("push_back: %s", e.what());
+            break;
+        }
+    }
+
+    size_t limit = peer->serverCtx->modelCache > 0 ? peer->serverCtx->modelCache : DEFAULT_MODEL_CACHE;
+    if (usage <= limit) {
+        closedir(dp);
+        return;
+    }
+
+    std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) -> bool {
+        return a.accessed < b.accessed;
+    });
+
+    // NOTE:
+    // A client could be loading the model which was hit by the HasModel() recently, keep it
+    time_t grace = time(nullptr) - MODEL_CACHE_GRACE;
+    for (const CacheFile &file : files) {
+        if (usage <= limit || file.accessed > grace) {
+            break;
+        }
+
+        if (unlinkat(dirfd(dp), file.name.c_str(), 0) < 0) {
+            ErrPrintCode(errno, "unlink: %s", file.name.c_str());
+            continue;
+        }
+
+        DbgPrint("Remove the cached model: %s (%lld bytes)", file.name.c_str(), static_cast<long long>(file.size));
+        usage -= file.size;
+    }
+
+    if (usage > limit) {
+        DbgPrint("Model cache exceeds its size: %" PRIu64 " > %zu", usage, limit);
+    }
+
+    closedir(dp);
+}
+
+int Peer::GrpcServer::ReceiveModel(Peer::GrpcServer::Gst *gst, ::grpc::ServerReader<::peer_nn::ModelFile> *reader, ::peer_nn::ModelFile &fileContents)
+{
+    std::string digest = fileContents.digest();
+    uint64_t offset = fileContents.offset();
+    uint64_t size = fileContents.size();
+    std::string path;
+
+    int ret = GetModelCachePath(digest, path);
+    if (ret < 0) {
+        return ret;
+    }
+
+    MUTEX_LOCK(&uploadLock);
+    if (uploadSet.find(digest) != uploadSet.end()) {
+        MUTEX_UNLOCK(&uploadLock);
+        DbgPrint("Model is being uploaded by another client: %s", digest.c_str());
+        return -EBUSY;
+    }
+    uploadSet.insert(digest);
+    MUTEX_UNLOCK(&uploadLock);
+
+    std::string partPath = path + std::string(".part");
+    uint64_t written = offset;
+
+    do {
+        int fd = open(partPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "open: %s", partPath.c_str());
+            break;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "fstat");
+            close(fd);
+            break;
+        }
+
+        // NOTE:
+        // The client resumes from the offset which is given by the HasModel(),
+        // the contents after the offset are discarded.
+        if (static_cast<uint64_t>(st.st_size) < offset || offset > size) {
+            ErrPrint("Invalid offset: %" PRIu64 " (uploaded: %lld, size: %" PRIu64 ")", offset, static_cast<long long>(st.st_size), size);
+            ret = -ESPIPE;
+            close(fd);
+            break;
+        }
+
+        if (ftruncate(fd, offset) < 0 || lseek(fd, offset, SEEK_SET) < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "ftruncate/lseek");
+            close(fd);
+            break;
+        }
+
+        do {
+            const char *ptr = fileContents.content().c_str();
+            size_t remains = fileContents.content().size();
+
+            if (written + remains > size) {
+                ErrPrint("Model is bigger than its size: %" PRIu64, size);
+                ret = -EFBIG;
+                break;
+            }
+
+            while (remains > 0) {
+                ssize_t sz = write(fd, ptr, remains);
+                if (sz < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    ret = -errno;
+                    ErrPrintCode(errno, "write");
+                    break;
+                }
+                ptr += sz;
+                remains -= sz;
+                written += sz;
+            }
+        } while (ret == 0 && reader->Read(&fileContents) == true);
+
+        if (close(fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+    } while (0);
+
+    if (ret == 0) {
+        if (written < size) {
+            // NOTE:
+            // The stream is finished before getting the whole contents,
+            // keep the partial model, the client is able to resume it.
+            DbgPrint("Partially uploaded: %" PRIu64 "/%" PRIu64, written, size);
+            ret = -EAGAIN;
+        } else {
+            std::string _digest;
+            ret = Peer::Model::ComputeDigest(partPath.c_str(), _digest);
+            if (ret == 0 && _digest != digest) {
+                ErrPrint("Digest mismatched: %s != %s", _digest.c_str(), digest.c_str());
+                ret = -EBADMSG;
+            }
+
+            if (ret == 0 && rename(partPath.c_str(), path.c_str()) < 0) {
+                ret = -errno;
+                ErrPrintCode(errno, "rename: %s", path.c_str());
+            }
+
+            if (ret < 0) {
+                if (unlink(partPath.c_str()) < 0) {
+                    ErrPrintCode(errno, "unlink: %s", partPath.c_str());
+                }
+            } else {
+                ret = gst->GetModel()->SetModelPath(path.c_str());
+                registry->PutDigest(path.c_str(), digest);
+            }
+        }
+    }
+
+    MUTEX_LOCK(&uploadLock);
+    uploadSet.erase(digest);
+    TrimModelCache();
+    MUTEX_UNLOCK(&uploadLock);
+
+    return ret;
+}
+
+::grpc::Status Peer::GrpcServer::HasModel(::grpc::ServerContext *context, const ::peer_nn::ModelDigest *request, ::peer_nn::ModelStatus *response)
+{
+    Peer::GrpcServer::Gst *gst = nullptr;
+
+    if (GetGst(context, gst) < 0) {
+        response->set_status(-ENOENT);
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Not Found");
+    }
+
+    std::string path;
+    int ret = GetModelCachePath(request->digest(), path);
+    if (ret < 0) {
+        response->set_status(ret);
+        return ::grpc::Status(::grpc::StatusCode::OK, "OK");
+    }
+
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_size) == request->size()) {
+        // NOTE:
+        // The access time is the recency of the model cache, the mtime is kept for the digest cache of the registry
+        const struct timespec times[2] = {
+            { .tv_sec = 0, .tv_nsec = UTIME_NOW },
+            { .tv_sec = 0, .tv_nsec = UTIME_OMIT },
+        };
+        if (utimensat(AT_FDCWD, path.c_str(), times, 0) < 0) {
+            ErrPrintCode(errno, "utimensat: %s", path.c_str());
+        }
+
+        ret = gst->GetModel()->SetModelPath(path.c_str());
+        if (ret == 0) {
+            registry->PutDigest(path.c_str(), request->digest());
+        }
+
+        response->set_status(ret);
+        return ::grpc::Status(::grpc::StatusCode::OK, "OK");
+    }
+
+    MUTEX_LOCK(&uploadLock);
+    bool uploading = (uploadSet.find(request->digest()) != uploadSet.end());
+    MUTEX_UNLOCK(&uploadLock);
+
+    if (uploading == true) {
+        response->set_status(-EBUSY);
+        return ::grpc::Status(::grpc::StatusCode::OK, "OK");
+    }
+
+    uint64_t offset = 0;
+    std::string partPath = path + std::string(".part");
+    if (stat(partPath.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_size) <= request->size()) {
+        offset = st.st_size;
+    }
+
+    DbgPrint("Model is not cached: %s (uploaded: %" PRIu64 ")", request->digest().c_str(), offset);
+    response->set_offset(offset);
+    response->set_status(-ENOENT);
     return ::grpc::Status(::grpc::StatusCode::OK, "OK");
 }
 
@@ -537,14 +1001,52 @@ int Peer::GrpcServer::RequestToInfo(const ::peer_nn::TensorInfos *request, beyon
         return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Not Found");
     }
 
+    // NOTE:
+    // The client which traces its requests asks the timing of the server with the results
+    std::multimap<grpc::string_ref, grpc::string_ref>::const_iterator it;
+    it = context->client_metadata().find("trace");
+    gst->SetTrace(it != context->client_metadata().end() && it->second == "1");
+
     // NOTE:
     // Prepare the gst pipeline in order to get the tensor shape from the model
     int requestPort = 0;
     int responsePort = 0;
-    int ret = gst->Prepare(requestPort, responsePort);
+    std::string localChannel;
+    int ret = gst->Prepare(requestPort, responsePort, localChannel);
     response->set_status(ret);
     response->set_request_port(requestPort);
     response->set_response_port(responsePort);
+    response->set_credits(peer->serverCtx->credits);
+    response->set_local_channel(localChannel);
+    return ::grpc::Status(::grpc::StatusCode::OK, "OK");
+}
+
+// NOTE:
+// The stream occupies a thread of the server while the client keeps it,
+// the requests are read on this thread, and the results are written on the streaming thread of the pipeline.
+::grpc::Status Peer::GrpcServer::Infer(::grpc::ServerContext *context, ::grpc::ServerReaderWriter<::peer_nn::InferResponse, ::peer_nn::InferRequest> *stream)
+{
+    Peer::GrpcServer::Gst *gst = nullptr;
+
+    if (GetGst(context, gst) < 0 || gst == nullptr) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Not Found");
+    }
+
+    int ret = gst->AttachStream(stream);
+    if (ret == -EBUSY) {
+        return ::grpc::Status(::grpc::StatusCode::ALREADY_EXISTS, "Already Exists");
+    } else if (ret < 0) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "Not Prepared");
+    }
+
+    ::peer_nn::InferRequest request;
+    while (stream->Read(&request) == true) {
+        // NOTE:
+        // The failed request is canceled by the gst, go ahead
+        (void)gst->PushRequest(request);
+    }
+
+    gst->DetachStream(context->IsCancelled() == false);
     return ::grpc::Status(::grpc::StatusCode::OK, "OK");
 }
 
@@ -595,6 +1097,163 @@ int Peer::GrpcServer::RequestToInfo(const ::peer_nn::TensorInfos *request, beyon
     return ::grpc::Status(::grpc::StatusCode::OK, "OK");
 }
 
+void Peer::GrpcServer::AddLatency(uint64_t latency)
+{
+    MUTEX_LOCK(&publishLock);
+    if (latencies.size() < LATENCY_WINDOW) {
+        latencies.push_back(latency);
+    } else {
+        latencies[nextLatency] = latency;
+    }
+    nextLatency = (nextLatency + 1) % LATENCY_WINDOW;
+    MUTEX_UNLOCK(&publishLock);
+}
+
+void Peer::GrpcServer::CollectLoad(std::map<std::string, std::string> &items)
+{
+    size_t queueDepth = 0;
+    std::set<std::string> digests;
+
+    MUTEX_LOCK(&clientLock);
+    for (auto it = clientMap.begin(); it != clientMap.end(); ++it) {
+        size_t depth = 0;
+        std::string digest;
+
+        it->second->GetLoad(depth, digest);
+        queueDepth += depth;
+        if (digest.empty() == false) {
+            digests.insert(digest);
+        }
+    }
+    MUTEX_UNLOCK(&clientLock);
+
+    // NOTE:
+    // The idle models which are kept loaded by the registry are also ready for the new clients
+    registry->GetDigests(digests);
+
+    items[BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_QUEUE] = std::to_string(queueDepth);
+
+    std::vector<uint64_t> samples;
+    MUTEX_LOCK(&publishLock);
+    samples = latencies;
+    MUTEX_UNLOCK(&publishLock);
+
+    if (samples.empty() == false) {
+        auto median = samples.begin() + samples.size() / 2;
+        std::nth_element(samples.begin(), median, samples.end());
+        items[BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_LATENCY] = std::to_string(*median);
+    }
+
+    // NOTE:
+    // The value of an item is limited to 255 bytes, the digests which do not fit are not published
+    std::string models;
+    for (const std::string &digest : digests) {
+        std::string prefix = digest.substr(0, DIGEST_PREFIX);
+        if (models.size() + prefix.size() + 1 > UINT8_MAX) {
+            break;
+        }
+
+        if (models.empty() == false) {
+            models += ",";
+        }
+        models += prefix;
+    }
+    items[BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_MODELS] = models;
+
+    if (peer->info != nullptr && peer->info->count_of_runtimes > 0) {
+        std::string runtimes;
+        for (int i = 0; i < peer->info->count_of_runtimes; i++) {
+            if (peer->info->runtimes[i].name == nullptr) {
+                continue;
+            }
+
+            if (runtimes.empty() == false) {
+                runtimes += ";";
+            }
+            runtimes += peer->info->runtimes[i].name;
+
+            for (int j = 0; j < peer->info->runtimes[i].count_of_devices; j++) {
+                runtimes += (j == 0) ? ":" : ",";
+                runtimes += peer->info->runtimes[i].devices[j].name;
+            }
+        }
+
+        if (runtimes.size() <= UINT8_MAX) {
+            items[BEYOND_PLUGIN_DISCOVERY_DNS_SD_KEY_RUNTIMES] = runtimes;
+        }
+    }
+}
+
+void Peer::GrpcServer::PublishLoad(void)
+{
+    beyond::DiscoveryInterface *discovery = peer->discovery;
+    if (discovery == nullptr) {
+        return;
+    }
+
+    std::map<std::string, std::string> items;
+    CollectLoad(items);
+
+    for (auto it = items.begin(); it != items.end(); ++it) {
+        auto published = publishedItems.find(it->first);
+        if (published != publishedItems.end()) {
+            if (published->second == it->second) {
+                continue;
+            }
+
+            // NOTE:
+            // The discovery does not overwrite an item, the previous one is removed first
+            int ret = discovery->RemoveItem(it->first.c_str());
+            if (ret < 0) {
+                ErrPrint("Failed to remove the item %s: %d", it->first.c_str(), ret);
+                continue;
+            }
+            publishedItems.erase(published);
+        }
+
+        // NOTE:
+        // The empty value is also published, it replaces the previous one (e.g. no model is loaded anymore)
+        int ret = discovery->SetItem(it->first.c_str(), it->second.c_str(), static_cast<uint8_t>(it->second.size()));
+        if (ret < 0) {
+            ErrPrint("Failed to publish the item %s: %d", it->first.c_str(), ret);
+            continue;
+        }
+
+        publishedItems[it->first] = it->second;
+    }
+}
+
+void *Peer::GrpcServer::PublishMain(void *ptr)
+{
+    GrpcServer *service = static_cast<GrpcServer *>(ptr);
+
+    MUTEX_LOCK(&service->publishLock);
+    while (service->publishing == true) {
+        struct timespec ts;
+        if (clock_gettime(CLOCK_REALTIME, &ts) < 0) {
+            ErrPrintCode(errno, "clock_gettime");
+            break;
+        }
+        ts.tv_sec += PUBLISH_INTERVAL;
+
+        int ret = pthread_cond_timedwait(&service->publishCond, &service->publishLock, &ts);
+        if (ret != 0 && ret != ETIMEDOUT) {
+            ErrPrintCode(ret, "pthread_cond_timedwait");
+        }
+
+        if (service->publishing == false) {
+            break;
+        }
+
+        MUTEX_UNLOCK(&service->publishLock);
+        service->PublishLoad();
+        MUTEX_LOCK(&service->publishLock);
+    }
+    MUTEX_UNLOCK(&service->publishLock);
+
+    return nullptr;
+}
+
 void *Peer::GrpcServer::Main(void *ptr)
 {
     GrpcServer *service = static_cast<GrpcServer *>(ptr);
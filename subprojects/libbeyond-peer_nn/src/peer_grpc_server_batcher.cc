@@ -0,0 +1,723 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "peer_grpc_server_batcher.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <list>
+#include <string>
+
+#include <pthread.h>
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#define MAX_RANK 4
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+// NOTE:
+// NNStreamer uses the reversed order of the dimension and fills unused part with 1.
+// The outermost dimension of the tensor (data[0]) is the batch.
+std::string Peer::GrpcServer::Batcher::TensorInfoToDims(const beyond_tensor_info *info, int size, int batchSize)
+{
+    std::string dimsString;
+
+    for (int i = 0; i < size; i++) {
+        int dims[MAX_RANK] = { 1, 1, 1, 1 };
+        int rank = info[i].dims->size;
+
+        if (rank > MAX_RANK || rank <= 0) {
+            ErrPrint("Unsupported rank: %d", rank);
+            return std::string();
+        }
+
+        for (int j = 0; j < rank; j++) {
+            dims[rank - j - 1] = info[i].dims->data[j];
+        }
+        dims[rank - 1] *= batchSize;
+
+        if (i > 0) {
+            dimsString += ",";
+        }
+
+        for (int j = 0; j < MAX_RANK; j++) {
+            if (j > 0) {
+                dimsString += ":";
+            }
+            dimsString += std::to_string(dims[j]);
+        }
+    }
+
+    return dimsString;
+}
+
+std::string Peer::GrpcServer::Batcher::TensorInfoToTypes(const beyond_tensor_info *info, int size)
+{
+    std::string typesString;
+
+    for (int i = 0; i < size; i++) {
+        if (i > 0) {
+            typesString += ",";
+        }
+        typesString += beyond::Inference::TensorTypeToString(info[i].type);
+    }
+
+    return typesString;
+}
+
+GstCaps *Peer::GrpcServer::Batcher::CreateCaps(const beyond_tensor_info *info, int size, int batchSize)
+{
+    std::string dims = TensorInfoToDims(info, size, batchSize);
+    if (dims.empty() == true) {
+        return nullptr;
+    }
+
+    std::string types = TensorInfoToTypes(info, size);
+
+    gchar *capsString = g_strdup_printf(
+        "other/tensors,format=static,num_tensors=%d,dimensions=(string)\"%s\",types=(string)\"%s\",framerate=(fraction)0/1",
+        size, dims.c_str(), types.c_str());
+    if (capsString == nullptr) {
+        ErrPrint("Failed to build a caps description");
+        return nullptr;
+    }
+
+    GstCaps *caps = gst_caps_from_string(capsString);
+    if (caps == nullptr) {
+        ErrPrint("Invalid caps: %s", capsString);
+    }
+
+    g_free(capsString);
+    return caps;
+}
+
+Peer::GrpcServer::Batcher *Peer::GrpcServer::Batcher::Create(const char *framework, const char *model, const char *accel,
+                                                             const beyond_tensor_info *inputInfo, int inputSize,
+                                                             const beyond_tensor_info *outputInfo, int outputSize,
+                                                             int batchSize, int timeout)
+{
+    if (framework == nullptr || model == nullptr || inputInfo == nullptr || inputSize <= 0 || outputInfo == nullptr || outputSize <= 0 || batchSize <= 0) {
+        ErrPrint("Invalid arguments");
+        return nullptr;
+    }
+
+    Batcher *batcher;
+
+    try {
+        batcher = new Batcher();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    batcher->batchSize = batchSize;
+    batcher->timeout = timeout > 0 ? timeout : DEFAULT_TIMEOUT;
+
+    batcher->inputSize = static_cast<size_t *>(malloc(sizeof(size_t) * inputSize));
+    if (batcher->inputSize == nullptr) {
+        ErrPrintCode(errno, "malloc");
+        delete batcher;
+        return nullptr;
+    }
+
+    for (int i = 0; i < inputSize; i++) {
+        batcher->inputSize[i] = inputInfo[i].size;
+    }
+    batcher->inputCount = inputSize;
+
+    GstCaps *inputCaps = CreateCaps(inputInfo, inputSize, batchSize);
+    if (inputCaps == nullptr) {
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    batcher->outputCaps = CreateCaps(outputInfo, outputSize, 1);
+    if (batcher->outputCaps == nullptr) {
+        gst_caps_unref(inputCaps);
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    std::string props = std::string(" inputtype=") + TensorInfoToTypes(inputInfo, inputSize) +
+                        std::string(" input=") + TensorInfoToDims(inputInfo, inputSize, batchSize) +
+                        std::string(" outputtype=") + TensorInfoToTypes(outputInfo, outputSize) +
+                        std::string(" output=") + TensorInfoToDims(outputInfo, outputSize, batchSize);
+
+    gchar *pipelineDescription = g_strdup_printf(
+        "appsrc name=batchSource is-live=true format=time ! "
+        "tensor_filter name=tensorFilter framework=%s model=%s %s %s ! "
+        "appsink name=batchSink sync=false",
+        framework, model, accel != nullptr ? accel : "", props.c_str());
+    if (pipelineDescription == nullptr) {
+        ErrPrint("Failed to build a pipeline description");
+        gst_caps_unref(inputCaps);
+        gst_caps_unref(batcher->outputCaps);
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    DbgPrint("Batch pipeline[%s]", pipelineDescription);
+
+    GError *error = nullptr;
+    batcher->pipeline = gst_parse_launch(pipelineDescription, &error);
+    g_free(pipelineDescription);
+    pipelineDescription = nullptr;
+    if (error != nullptr || batcher->pipeline == nullptr) {
+        if (error != nullptr) {
+            ErrPrint("%s", error->message);
+            g_error_free(error);
+        }
+        if (batcher->pipeline != nullptr) {
+            gst_object_unref(batcher->pipeline);
+        }
+        gst_caps_unref(inputCaps);
+        gst_caps_unref(batcher->outputCaps);
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    batcher->source = gst_bin_get_by_name(GST_BIN(batcher->pipeline), "batchSource");
+    batcher->sink = gst_bin_get_by_name(GST_BIN(batcher->pipeline), "batchSink");
+    if (batcher->source == nullptr || batcher->sink == nullptr) {
+        ErrPrint("Failed to get the batch elements");
+        if (batcher->source != nullptr) {
+            gst_object_unref(batcher->source);
+        }
+        if (batcher->sink != nullptr) {
+            gst_object_unref(batcher->sink);
+        }
+        gst_object_unref(batcher->pipeline);
+        gst_caps_unref(inputCaps);
+        gst_caps_unref(batcher->outputCaps);
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    g_object_set(G_OBJECT(batcher->source), "caps", inputCaps, nullptr);
+    gst_caps_unref(inputCaps);
+    inputCaps = nullptr;
+
+    if (gst_element_set_state(batcher->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        ErrPrint("set PLAYING failed");
+        gst_object_unref(batcher->source);
+        gst_object_unref(batcher->sink);
+        gst_object_unref(batcher->pipeline);
+        gst_caps_unref(batcher->outputCaps);
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    int status = pthread_create(&batcher->threadId, nullptr, Main, static_cast<void *>(batcher));
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_create");
+        gst_element_set_state(batcher->pipeline, GST_STATE_NULL);
+        gst_object_unref(batcher->source);
+        gst_object_unref(batcher->sink);
+        gst_object_unref(batcher->pipeline);
+        gst_caps_unref(batcher->outputCaps);
+        free(batcher->inputSize);
+        delete batcher;
+        return nullptr;
+    }
+
+    return batcher;
+}
+
+void Peer::GrpcServer::Batcher::Destroy(void)
+{
+    MUTEX_LOCK(&lock);
+    exit = true;
+    pthread_cond_signal(&cond);
+    MUTEX_UNLOCK(&lock);
+
+    void *retval;
+    int status = pthread_join(threadId, &retval);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_join");
+    }
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(source);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    gst_caps_unref(outputCaps);
+    free(inputSize);
+
+    for (Client *client : clients) {
+        gst_object_unref(client->sink);
+        gst_object_unref(client->source);
+        delete client;
+    }
+    clients.clear();
+
+    delete this;
+}
+
+int Peer::GrpcServer::Batcher::Attach(GstElement *clientSink, GstElement *clientSource)
+{
+    Client *client;
+
+    try {
+        client = new Client();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return -ENOMEM;
+    }
+
+    client->batcher = this;
+    client->sink = GST_ELEMENT(gst_object_ref(clientSink));
+    client->source = GST_ELEMENT(gst_object_ref(clientSource));
+
+    g_object_set(G_OBJECT(clientSource), "caps", outputCaps, "format", GST_FORMAT_TIME, nullptr);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = NewSampleHandler;
+    gst_app_sink_set_callbacks(GST_APP_SINK(clientSink), &callbacks, static_cast<gpointer>(client), nullptr);
+
+    MUTEX_LOCK(&lock);
+    clients.push_back(client);
+    MUTEX_UNLOCK(&lock);
+    return 0;
+}
+
+// NOTE:
+// The client pipeline must be stopped before detaching it,
+// the streaming thread of the pipeline refers the client in the NewSampleHandler()
+void Peer::GrpcServer::Batcher::Detach(GstElement *clientSink)
+{
+    Client *client = nullptr;
+
+    MUTEX_LOCK(&lock);
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+        if ((*it)->sink == clientSink) {
+            client = *it;
+            clients.erase(it);
+            break;
+        }
+    }
+
+    if (client != nullptr) {
+        // NOTE:
+        // Drop the pending requests of the client, the requests which are already in the batch
+        // hold the reference of the client source, they are going to be pushed to the flushing source.
+        auto it = queue.begin();
+        while (it != queue.end()) {
+            if (it->source == client->source) {
+                gst_buffer_unref(it->buffer);
+                gst_object_unref(it->source);
+                it = queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (client == nullptr) {
+        ErrPrint("Client is not attached");
+        return;
+    }
+
+    GstAppSinkCallbacks callbacks = {};
+    gst_app_sink_set_callbacks(GST_APP_SINK(client->sink), &callbacks, nullptr, nullptr);
+
+    gst_object_unref(client->sink);
+    gst_object_unref(client->source);
+    delete client;
+}
+
+GstFlowReturn Peer::GrpcServer::Batcher::NewSampleHandler(GstAppSink *sink, gpointer user_data)
+{
+    Client *client = static_cast<Client *>(user_data);
+
+    GstSample *sample = gst_app_sink_pull_sample(sink);
+    if (sample == nullptr) {
+        ErrPrint("Failed to pull a sample");
+        return GST_FLOW_EOS;
+    }
+
+    GstBuffer *buffer = gst_sample_get_buffer(sample);
+    if (buffer == nullptr) {
+        ErrPrint("Sample has no buffer");
+        gst_sample_unref(sample);
+        return GST_FLOW_OK;
+    }
+
+    gst_buffer_ref(buffer);
+    gst_sample_unref(sample);
+
+    if (client->batcher->Enqueue(client->source, buffer) < 0) {
+        gst_buffer_unref(buffer);
+    }
+
+    return GST_FLOW_OK;
+}
+
+int Peer::GrpcServer::Batcher::Enqueue(GstElement *clientSource, GstBuffer *buffer)
+{
+    Request request = {
+        .source = clientSource,
+        .buffer = buffer,
+        .arrival = g_get_monotonic_time(),
+    };
+
+    MUTEX_LOCK(&lock);
+    if (exit == true) {
+        MUTEX_UNLOCK(&lock);
+        return -ESHUTDOWN;
+    }
+
+    gst_object_ref(clientSource);
+
+    try {
+        queue.push_back(request);
+    } catch (std::exception &e) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("push_back: %s", e.what());
+        gst_object_unref(clientSource);
+        return -ENOMEM;
+    }
+
+    // NOTE:
+    // Wake up the batcher if the batch is full, or to start the time window of a new batch
+    if (static_cast<int>(queue.size()) >= batchSize || queue.size() == 1) {
+        pthread_cond_signal(&cond);
+    }
+    MUTEX_UNLOCK(&lock);
+    return 0;
+}
+
+void *Peer::GrpcServer::Batcher::Main(void *arg)
+{
+    Batcher *batcher = static_cast<Batcher *>(arg);
+    std::list<Request> requests;
+
+    MUTEX_LOCK(&batcher->lock);
+    while (batcher->exit == false) {
+        if (batcher->queue.empty() == true) {
+            pthread_cond_wait(&batcher->cond, &batcher->lock);
+            continue;
+        }
+
+        if (static_cast<int>(batcher->queue.size()) < batcher->batchSize) {
+            // NOTE:
+            // The time window starts when the oldest request arrives
+            gint64 deadline = batcher->queue.front().arrival + batcher->timeout;
+            if (g_get_monotonic_time() < deadline) {
+                timespec ts = {
+                    .tv_sec = static_cast<time_t>(deadline / G_USEC_PER_SEC),
+                    .tv_nsec = static_cast<long>((deadline % G_USEC_PER_SEC) * 1000),
+                };
+
+                int ret = pthread_cond_timedwait(&batcher->cond, &batcher->lock, &ts);
+                if (ret != 0 && ret != ETIMEDOUT) {
+                    ErrPrintCode(ret, "pthread_cond_timedwait");
+                }
+                continue;
+            }
+        }
+
+        auto last = batcher->queue.begin();
+        std::advance(last, std::min(static_cast<int>(batcher->queue.size()), batcher->batchSize));
+        requests.splice(requests.begin(), batcher->queue, batcher->queue.begin(), last);
+        MUTEX_UNLOCK(&batcher->lock);
+
+        int ret = batcher->Invoke(requests);
+        if (ret < 0) {
+            ErrPrint("Failed to invoke a batch of %zu requests: %d", requests.size(), ret);
+            for (Request &request : requests) {
+                batcher->Cancel(request);
+            }
+        }
+
+        for (Request &request : requests) {
+            gst_buffer_unref(request.buffer);
+            gst_object_unref(request.source);
+        }
+        requests.clear();
+
+        MUTEX_LOCK(&batcher->lock);
+    }
+
+    for (Request &request : batcher->queue) {
+        gst_buffer_unref(request.buffer);
+        gst_object_unref(request.source);
+    }
+    batcher->queue.clear();
+    MUTEX_UNLOCK(&batcher->lock);
+
+    return nullptr;
+}
+
+int Peer::GrpcServer::Batcher::Invoke(std::list<Request> &requests)
+{
+    // NOTE:
+    // Drop the requests which do not fit to the batch
+    auto it = requests.begin();
+    while (it != requests.end()) {
+        bool valid = (gst_buffer_n_memory(it->buffer) == static_cast<guint>(inputCount));
+        for (int i = 0; valid == true && i < inputCount; i++) {
+            valid = (gst_memory_get_sizes(gst_buffer_peek_memory(it->buffer, i), nullptr, nullptr) == inputSize[i]);
+        }
+
+        if (valid == false) {
+            ErrPrint("Tensor size mismatched, drop the request");
+            Cancel(*it);
+            gst_buffer_unref(it->buffer);
+            gst_object_unref(it->source);
+            it = requests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (requests.empty() == true) {
+        return -EINVAL;
+    }
+
+    GstBuffer *batch = gst_buffer_new();
+    if (batch == nullptr) {
+        ErrPrint("Failed to create a buffer");
+        return -ENOMEM;
+    }
+
+    for (int i = 0; i < inputCount; i++) {
+        GstMemory *memory = gst_allocator_alloc(nullptr, inputSize[i] * batchSize, nullptr);
+        if (memory == nullptr) {
+            ErrPrint("Failed to allocate a memory");
+            gst_buffer_unref(batch);
+            return -ENOMEM;
+        }
+
+        GstMapInfo map;
+        if (gst_memory_map(memory, &map, GST_MAP_WRITE) == FALSE) {
+            ErrPrint("Failed to map a memory");
+            gst_memory_unref(memory);
+            gst_buffer_unref(batch);
+            return -EFAULT;
+        }
+
+        guint8 *ptr = map.data;
+        for (Request &request : requests) {
+            GstMapInfo inMap;
+            GstMemory *inMemory = gst_buffer_peek_memory(request.buffer, i);
+            if (gst_memory_map(inMemory, &inMap, GST_MAP_READ) == TRUE) {
+                memcpy(ptr, inMap.data, inputSize[i]);
+                gst_memory_unmap(inMemory, &inMap);
+            } else {
+                ErrPrint("Failed to map a memory");
+                memset(ptr, 0, inputSize[i]);
+            }
+            ptr += inputSize[i];
+        }
+
+        // NOTE:
+        // The model runs with a fixed batch size, pad the empty slots
+        memset(ptr, 0, map.data + map.size - ptr);
+
+        gst_memory_unmap(memory, &map);
+        gst_buffer_append_memory(batch, memory);
+    }
+
+    // NOTE:
+    // The offset of the batch is kept by the tensor_filter (GST_BUFFER_COPY_TIMESTAMPS),
+    // the result is matched with the batch by it.
+    guint64 batchId = nextBatchId++;
+    GST_BUFFER_PTS(batch) = GST_BUFFER_PTS(requests.front().buffer);
+    GST_BUFFER_OFFSET(batch) = batchId;
+
+    GstFlowReturn flowRet = gst_app_src_push_buffer(GST_APP_SRC(source), batch);
+    if (flowRet != GST_FLOW_OK) {
+        ErrPrint("Failed to push a batch: %d", static_cast<int>(flowRet));
+        return -EFAULT;
+    }
+
+    gint64 deadline = g_get_monotonic_time() + PULL_TIMEOUT;
+    while (true) {
+        gint64 remaining = deadline - g_get_monotonic_time();
+        GstSample *sample = nullptr;
+        if (remaining > 0) {
+            sample = gst_app_sink_try_pull_sample(GST_APP_SINK(sink), remaining * GST_USECOND);
+        }
+
+        if (sample == nullptr) {
+            ErrPrint("Failed to get the result of the batch %llu", static_cast<unsigned long long>(batchId));
+            return -ETIMEDOUT;
+        }
+
+        GstBuffer *output = gst_sample_get_buffer(sample);
+        guint64 offset = output != nullptr ? GST_BUFFER_OFFSET(output) : GST_BUFFER_OFFSET_NONE;
+        if (output != nullptr && (offset == batchId || offset == GST_BUFFER_OFFSET_NONE)) {
+            // NOTE:
+            // If the offset is not kept by the pipeline, the batches are processed one at a time
+            // and the result is the one of the batch which was just pushed.
+            Scatter(output, requests);
+            gst_sample_unref(sample);
+            break;
+        }
+
+        // NOTE:
+        // The late result of a batch which was timed out, its requests are already canceled
+        DbgPrint("Drop the result of the batch %llu", static_cast<unsigned long long>(offset));
+        gst_sample_unref(sample);
+    }
+
+    return 0;
+}
+
+// NOTE:
+// The buffer without memories is the cancel of the request,
+// the offset (requestId) of the request is kept with the timestamps.
+void Peer::GrpcServer::Batcher::Cancel(Request &request)
+{
+    GstBuffer *cancel = gst_buffer_new();
+    if (cancel == nullptr) {
+        ErrPrint("Failed to create a buffer");
+        return;
+    }
+
+    gst_buffer_copy_into(cancel, request.buffer, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+    GstFlowReturn flowRet = gst_app_src_push_buffer(GST_APP_SRC(request.source), cancel);
+    if (flowRet != GST_FLOW_OK) {
+        DbgPrint("Failed to push a cancel: %d", static_cast<int>(flowRet));
+    }
+}
+
+void Peer::GrpcServer::Batcher::Scatter(GstBuffer *output, std::list<Request> &requests)
+{
+    guint count = gst_buffer_n_memory(output);
+    int idx = 0;
+
+    for (Request &request : requests) {
+        GstBuffer *result = gst_buffer_new();
+        if (result == nullptr) {
+            ErrPrint("Failed to create a buffer");
+            break;
+        }
+
+        for (guint i = 0; i < count; i++) {
+            GstMemory *memory = gst_buffer_peek_memory(output, i);
+            gsize itemSize = gst_memory_get_sizes(memory, nullptr, nullptr) / batchSize;
+            gssize offset = itemSize * idx;
+
+            // NOTE:
+            // Share the slice of the batch output instead of copying it if it is possible
+            GstMemory *slice;
+            if (GST_MEMORY_FLAG_IS_SET(memory, GST_MEMORY_FLAG_NO_SHARE)) {
+                slice = gst_memory_copy(memory, offset, itemSize);
+            } else {
+                slice = gst_memory_share(memory, offset, itemSize);
+            }
+
+            if (slice == nullptr) {
+                ErrPrint("Failed to get the slice of the output");
+                continue;
+            }
+
+            gst_buffer_append_memory(result, slice);
+        }
+
+        gst_buffer_copy_into(result, request.buffer, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+        GstFlowReturn flowRet = gst_app_src_push_buffer(GST_APP_SRC(request.source), result);
+        if (flowRet != GST_FLOW_OK) {
+            DbgPrint("Failed to push a result: %d", static_cast<int>(flowRet));
+        }
+
+        idx++;
+    }
+}
+
+Peer::GrpcServer::Batcher::Batcher(void)
+    : pipeline(nullptr)
+    , source(nullptr)
+    , sink(nullptr)
+    , outputCaps(nullptr)
+    , batchSize(1)
+    , timeout(DEFAULT_TIMEOUT)
+    , inputSize(nullptr)
+    , inputCount(0)
+    , nextBatchId(0)
+    , exit(false)
+{
+    int status;
+
+    status = pthread_mutex_init(&lock, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_init");
+    }
+
+    // NOTE:
+    // The time window is measured with the monotonic clock (g_get_monotonic_time)
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    status = pthread_cond_init(&cond, &attr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_init");
+    }
+    pthread_condattr_destroy(&attr);
+}
+
+Peer::GrpcServer::Batcher::~Batcher(void)
+{
+    int status;
+
+    status = pthread_cond_destroy(&cond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_destroy");
+    }
+
+    status = pthread_mutex_destroy(&lock);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_destroy");
+    }
+}
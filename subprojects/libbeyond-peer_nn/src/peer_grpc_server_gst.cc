@@ -15,12 +15,19 @@
  */
 
 #include "peer_grpc_server_gst.h"
+#include "peer_grpc_server_batcher.h"
+#include "peer_grpc_server_registry.h"
+#include "peer_grpc_server_pool.h"
 #include "peer_event_object.h"
 #include "peer_model.h"
+#include "peer_trace.h"
 
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
+#include <ctime>
 
+#include <algorithm>
 #include <exception>
 #include <memory>
 #include <string>
@@ -28,9 +35,15 @@
 #include <pthread.h>
 #include <sys/types.h> /* See NOTES */
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include <glib.h>
+#include <glib-unix.h>
 #include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#include <gst/rtp/gstrtpbuffer.h>
 
 #include <beyond/platform/beyond_platform.h>
 #include <beyond/private/beyond_private.h>
@@ -38,6 +51,31 @@
 #include "beyond/plugin/peer_nn_plugin.h"
 
 #define RANK_MAX_SIZE 3
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+#define COND_BROADCAST(v)                                \
+    do {                                                 \
+        int ret = pthread_cond_broadcast(v);             \
+        if (ret != 0) {                                  \
+            ErrPrintCode(ret, "pthread_cond_broadcast"); \
+        }                                                \
+    } while (0)
+
 #define DIMS_PARSER(str, size, values) (Peer::GrpcServer::Gst::dimsParsers[((size)-1)](str, values))
 
 Peer::GrpcServer::Gst::DimsParser_t Peer::GrpcServer::Gst::dimsParsers[] = {
@@ -262,107 +300,1154 @@ int Peer::GrpcServer::Gst::ExtractTensorInfo(GstElement *element, const char *ty
             rank = rankVector[i];
         }
 
-        // NOTE:
-        // NNStreamer always allocate 4 dimensions (its maximum size)
-        // and fills unused part with 1
-        beyond_tensor_info::dimensions *dims = static_cast<beyond_tensor_info::dimensions *>(malloc(sizeof(beyond_tensor_info::dimensions) + sizeof(int) * (rank + 1)));
-        if (dims == nullptr) {
-            ret = -errno;
-            ErrPrintCode(errno, "malloc");
-            Peer::Model::FreeTensorInfo(tensorInfo, i);
-            return ret;
-        }
+        // NOTE:
+        // NNStreamer always allocate 4 dimensions (its maximum size)
+        // and fills unused part with 1
+        beyond_tensor_info::dimensions *dims = static_cast<beyond_tensor_info::dimensions *>(malloc(sizeof(beyond_tensor_info::dimensions) + sizeof(int) * (rank + 1)));
+        if (dims == nullptr) {
+            ret = -errno;
+            ErrPrintCode(errno, "malloc");
+            Peer::Model::FreeTensorInfo(tensorInfo, i);
+            return ret;
+        }
+
+        dims->size = rank + 1;
+
+        ret = DIMS_PARSER(dimsVector[i].c_str(), rank, dims->data);
+        if (ret < 0) {
+            ErrPrint("Failed to parse the dims");
+            free(dims);
+            dims = nullptr;
+            Peer::Model::FreeTensorInfo(tensorInfo, i);
+            return ret;
+        }
+
+        tensorInfo[i].size = beyond::Inference::TensorTypeToSize(typeVector[i]) * ret;
+        tensorInfo[i].type = typeVector[i];
+        tensorInfo[i].name = nullptr;
+        tensorInfo[i].dims = dims;
+    }
+
+    info = tensorInfo;
+    size = typeVector.size();
+    return 0;
+}
+
+void Peer::GrpcServer::Gst::Thread::BusHandler(GstBus *bus, GstMessage *message, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    if (impls == nullptr) {
+        assert(!"Peer cannot be nullptr");
+        ErrPrint("Peer cannot be nullptr");
+        return;
+    }
+
+    if (message == nullptr) {
+        assert(!"message cannot be nullptr");
+        ErrPrint("message cannot be nullptr");
+        return;
+    }
+
+    gchar *debug = nullptr;
+    GError *error = nullptr;
+    Peer *peer = impls->grpc->peer;
+
+    switch (GST_MESSAGE_TYPE(message)) {
+    case GST_MESSAGE_ERROR:
+        gst_message_parse_error(message, &error, &debug);
+        ErrPrint("%s: %s", gst_message_type_get_name(GST_MESSAGE_TYPE(message)), error->message);
+        g_error_free(error);
+        error = nullptr;
+
+        g_free(static_cast<gpointer>(debug));
+        debug = nullptr;
+
+        // TODO:
+        // Need to get the current inference data
+        if (peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR) < 0) {
+            ErrPrint("Unable to publish event");
+        }
+        break;
+    case GST_MESSAGE_WARNING:
+        gst_message_parse_warning(message, &error, &debug);
+        DbgPrint("%s: %s", gst_message_type_get_name(GST_MESSAGE_TYPE(message)), error->message);
+        g_error_free(error);
+        error = nullptr;
+
+        g_free(static_cast<gpointer>(debug));
+        debug = nullptr;
+
+        // TODO:
+        // What should we do?
+        break;
+    case GST_MESSAGE_STATE_CHANGED: {
+        GstState newstate, oldstate;
+        gst_message_parse_state_changed(message, &oldstate, &newstate, nullptr);
+
+        if (oldstate == GST_STATE_PLAYING && newstate == GST_STATE_PAUSED) {
+            int ret = peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_STOPPED);
+            if (ret < 0) {
+                DbgPrint("Unable to publish stopped event: %d", ret);
+            }
+        }
+        break;
+    }
+    default:
+        DbgPrint("%s", gst_message_type_get_name(GST_MESSAGE_TYPE(message)));
+        break;
+    }
+}
+
+gboolean Peer::GrpcServer::Gst::Thread::AcceptHandler(gint fd, GIOCondition condition, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    Peer::TensorChannel *channel;
+
+    if (fd == impls->localFd) {
+        channel = Peer::TensorChannel::AcceptLocal(fd);
+        if (channel == nullptr) {
+            return G_SOURCE_CONTINUE;
+        }
+
+        GSource *source = g_unix_fd_source_new(channel->GetHandle(), static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR));
+        if (source == nullptr) {
+            ErrPrint("Failed to create a source for the handshake");
+            channel->Destroy();
+            return G_SOURCE_CONTINUE;
+        }
+
+        // NOTE:
+        // The handshake of the previous client is not completed, it is replaced by the new one,
+        // so a client which never sends the handshake does not hold the local channel.
+        Peer::GrpcServer::Gst::Thread::DestroySource(impls->handshakeSource);
+        if (impls->handshakeChannel != nullptr) {
+            DbgPrint("Pending handshake is replaced");
+            impls->handshakeChannel->Destroy();
+        }
+
+        g_source_set_callback(source,
+                              (GSourceFunc)Peer::GrpcServer::Gst::Thread::HandshakeHandler,
+                              static_cast<gpointer>(impls), nullptr);
+        g_source_attach(source, g_main_context_get_thread_default());
+        impls->handshakeSource = source;
+        impls->handshakeChannel = channel;
+        return G_SOURCE_CONTINUE;
+    } else {
+        int channelFd = -1;
+
+        if (Peer::TensorChannel::Accept(fd, channelFd) < 0) {
+            return G_SOURCE_CONTINUE;
+        }
+
+        channel = Peer::TensorChannel::Create(channelFd);
+        if (channel == nullptr) {
+            if (close(channelFd) < 0) {
+                ErrPrintCode(errno, "close");
+            }
+            return G_SOURCE_CONTINUE;
+        }
+
+        if (impls->secretKey.empty() == false) {
+            Peer *peer = impls->grpc->peer;
+            beyond::AuthenticatorInterface *auth = peer->caAuthenticator != nullptr ? peer->caAuthenticator : peer->authenticator;
+            int ret = auth != nullptr ? channel->SetSecret(auth, impls->secretKey, false) : -EINVAL;
+            if (ret < 0) {
+                ErrPrint("Failed to seal the tensor channel: %d", ret);
+                channel->Destroy();
+                return G_SOURCE_CONTINUE;
+            }
+        }
+    }
+
+    if (impls->AttachChannel(channel) < 0) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+// NOTE:
+// The accepted local channel is attached once its handshake is completed,
+// the handler is invoked again if the client has not sent it yet.
+gboolean Peer::GrpcServer::Gst::Thread::HandshakeHandler(gint fd, GIOCondition condition, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    Peer::TensorChannel *channel = impls->handshakeChannel;
+
+    int ret = channel->TryHandshake();
+    if (ret == -EAGAIN) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    // NOTE:
+    // The source is being dispatched, it is destroyed here and removed by returning G_SOURCE_REMOVE
+    Peer::GrpcServer::Gst::Thread::DestroySource(impls->handshakeSource);
+    impls->handshakeChannel = nullptr;
+
+    if (ret < 0) {
+        ErrPrint("Local handshake is failed: %d", ret);
+        channel->Destroy();
+        return G_SOURCE_REMOVE;
+    }
+
+    (void)impls->AttachChannel(channel);
+    return G_SOURCE_REMOVE;
+}
+
+// NOTE:
+// The payloads are read into the memories of the gst buffer directly,
+// and the buffer is pushed to the serverSource without any conversion.
+// The frame is received incrementally as its bytes arrive, the handler never waits for the rest of the frame,
+// so a client which sends a frame slowly does not delay the other clients of the same worker.
+gboolean Peer::GrpcServer::Gst::Thread::RecvHandler(gint fd, GIOCondition condition, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    Incoming &incoming = impls->incoming;
+
+    if ((condition & G_IO_IN) != G_IO_IN) {
+        DbgPrint("Channel is closed: 0x%X", static_cast<unsigned int>(condition));
+        impls->CloseChannel();
+        return G_SOURCE_REMOVE;
+    }
+
+    int ret;
+
+    if (incoming.buffer == nullptr) {
+        ret = impls->channel->TryRecvHeader(incoming.header, incoming.desc);
+        if (ret == -EAGAIN) {
+            return G_SOURCE_CONTINUE;
+        } else if (ret < 0) {
+            impls->CloseChannel();
+            return G_SOURCE_REMOVE;
+        }
+
+        incoming.received = Peer::Trace::Now();
+
+        if (incoming.header.count == 0) {
+            DbgPrint("Empty request %llu is ignored", static_cast<unsigned long long>(incoming.header.requestId));
+            return G_SOURCE_CONTINUE;
+        }
+
+        // NOTE:
+        // The buffers are allocated by the sizes which are given by the client, check them first.
+        // The payloads of the rejected frame are not read, the stream cannot be continued.
+        ret = impls->ValidateRequest(incoming.desc, incoming.header.count);
+        if (ret < 0) {
+            impls->CancelRequest(incoming.header.requestId);
+            impls->CloseChannel();
+            return G_SOURCE_REMOVE;
+        }
+
+        ret = impls->BeginIncoming();
+        if (ret < 0) {
+            impls->CloseChannel();
+            return G_SOURCE_REMOVE;
+        }
+    }
+
+    ret = impls->channel->TryRecvPayload(incoming.iov, incoming.header.count);
+    if (ret == -EAGAIN) {
+        return G_SOURCE_CONTINUE;
+    } else if (ret < 0) {
+        // NOTE:
+        // The stream cannot be recovered if the payloads are not read properly
+        impls->CloseChannel();
+        return G_SOURCE_REMOVE;
+    }
+
+    for (int i = 0; i < incoming.header.count; i++) {
+        gst_memory_unmap(incoming.memory[i], &incoming.mapInfo[i]);
+    }
+
+    GstBuffer *buffer = incoming.buffer;
+    incoming.buffer = nullptr;
+    (void)impls->PushBuffer(incoming.header.requestId, buffer, incoming.desc, incoming.header.count, incoming.received);
+    return G_SOURCE_CONTINUE;
+}
+
+// NOTE:
+// Allocate and map the memories of the incoming frame by its descriptors
+int Peer::GrpcServer::Gst::BeginIncoming(void)
+{
+    GstBuffer *buffer = gst_buffer_new();
+    if (buffer == nullptr) {
+        ErrPrint("Unable to create a gst buffer");
+        return -ENOMEM;
+    }
+
+    int count;
+    for (count = 0; count < incoming.header.count; count++) {
+        incoming.memory[count] = gst_allocator_alloc(nullptr, incoming.desc[count].size, nullptr);
+        if (incoming.memory[count] == nullptr) {
+            ErrPrint("Failed to allocate a memory: %llu", static_cast<unsigned long long>(incoming.desc[count].size));
+            break;
+        }
+
+        if (gst_memory_map(incoming.memory[count], &incoming.mapInfo[count], GST_MAP_WRITE) == FALSE) {
+            ErrPrint("Failed to map a memory");
+            gst_memory_unref(incoming.memory[count]);
+            break;
+        }
+
+        incoming.iov[count].iov_base = incoming.mapInfo[count].data;
+        incoming.iov[count].iov_len = incoming.mapInfo[count].size;
+        gst_buffer_append_memory(buffer, incoming.memory[count]);
+    }
+
+    if (count < incoming.header.count) {
+        for (int i = 0; i < count; i++) {
+            gst_memory_unmap(incoming.memory[i], &incoming.mapInfo[i]);
+        }
+        gst_buffer_unref(buffer);
+        return -ENOMEM;
+    }
+
+    incoming.buffer = buffer;
+    return 0;
+}
+
+void Peer::GrpcServer::Gst::ReleaseIncoming(void)
+{
+    if (incoming.buffer == nullptr) {
+        return;
+    }
+
+    for (int i = 0; i < incoming.header.count; i++) {
+        gst_memory_unmap(incoming.memory[i], &incoming.mapInfo[i]);
+    }
+
+    gst_buffer_unref(incoming.buffer);
+    incoming.buffer = nullptr;
+}
+
+// NOTE:
+// The buffer is consumed, the request is canceled if it cannot be pushed.
+// This is invoked on the gst thread for the channel, and on the gRPC thread for the stream.
+int Peer::GrpcServer::Gst::PushBuffer(uint64_t requestId, GstBuffer *buffer, const Peer::TensorChannel::Descriptor *desc, int count, uint64_t received)
+{
+    if (serverSource == nullptr) {
+        ErrPrint("The input is configured, the tensors are not acceptable");
+        gst_buffer_unref(buffer);
+        CancelRequest(requestId);
+        return -EINVAL;
+    }
+
+    MUTEX_LOCK(&channelLock);
+    if (serverSourceCaps == false) {
+        GstCaps *caps = Peer::GrpcServer::Gst::DescriptorToCaps(desc, count);
+        if (caps == nullptr) {
+            MUTEX_UNLOCK(&channelLock);
+            gst_buffer_unref(buffer);
+            CancelRequest(requestId);
+            return -EINVAL;
+        }
+
+        g_object_set(G_OBJECT(serverSource), "caps", caps, nullptr);
+        gst_caps_unref(caps);
+        serverSourceCaps = true;
+    }
+
+    pendingIds.insert(requestId);
+    timestamps[requestId] = {
+        .received = received,
+        .pushed = Peer::Trace::Now(),
+        .filterIn = 0,
+        .filterOut = 0,
+    };
+    MUTEX_UNLOCK(&channelLock);
+
+    // NOTE:
+    // The offset of the buffer is kept by the tensor_filter and the batcher (GST_BUFFER_COPY_TIMESTAMPS)
+    GST_BUFFER_OFFSET(buffer) = requestId;
+
+    GstFlowReturn flowRet = gst_app_src_push_buffer(GST_APP_SRC(serverSource), buffer);
+    if (flowRet != GST_FLOW_OK) {
+        ErrPrint("Failed to push a request: %d", static_cast<int>(flowRet));
+        CancelRequest(requestId);
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+void Peer::GrpcServer::Gst::ReleaseData(gpointer data)
+{
+    std::string *_data = static_cast<std::string *>(data);
+    delete _data;
+}
+
+// NOTE:
+// The tensor data is taken from the request, and it is wrapped by the gst memory without copying.
+int Peer::GrpcServer::Gst::PushRequest(::peer_nn::InferRequest &request)
+{
+    uint64_t received = Peer::Trace::Now();
+    uint64_t requestId = request.request_id();
+    int count = request.tensors_size();
+
+    if (count <= 0 || count > Peer::TensorChannel::MAX_TENSORS) {
+        ErrPrint("Invalid count of tensors: %d", count);
+        CancelRequest(requestId);
+        return -EINVAL;
+    }
+
+    GstBuffer *buffer = gst_buffer_new();
+    if (buffer == nullptr) {
+        ErrPrint("Unable to create a gst buffer");
+        CancelRequest(requestId);
+        return -ENOMEM;
+    }
+
+    Peer::TensorChannel::Descriptor desc[Peer::TensorChannel::MAX_TENSORS];
+    for (int i = 0; i < count; i++) {
+        ::peer_nn::Tensor *tensor = request.mutable_tensors(i);
+        const ::peer_nn::TensorInfo &info = tensor->info();
+
+        memset(&desc[i], 0, sizeof(desc[i]));
+        desc[i].type = static_cast<int32_t>(info.type());
+        desc[i].size = tensor->data().size();
+        if (info.dims().data_size() > 0 && info.dims().data_size() <= Peer::TensorChannel::MAX_RANK) {
+            desc[i].rank = info.dims().data_size();
+            for (int j = 0; j < desc[i].rank; j++) {
+                desc[i].dims[j] = info.dims().data(j);
+            }
+        }
+
+        std::string *data = tensor->release_data();
+        if (data == nullptr || data->empty() == true) {
+            ErrPrint("Empty tensor: %d", i);
+            delete data;
+            gst_buffer_unref(buffer);
+            CancelRequest(requestId);
+            return -EINVAL;
+        }
+
+        GstMemory *memory = gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY, &(*data)[0], data->size(), 0, data->size(),
+                                                   static_cast<gpointer>(data), Peer::GrpcServer::Gst::ReleaseData);
+        if (memory == nullptr) {
+            ErrPrint("Failed to wrap the gst memory");
+            delete data;
+            gst_buffer_unref(buffer);
+            CancelRequest(requestId);
+            return -ENOMEM;
+        }
+
+        gst_buffer_append_memory(buffer, memory);
+    }
+
+    if (ValidateRequest(desc, count) < 0) {
+        gst_buffer_unref(buffer);
+        CancelRequest(requestId);
+        return -EINVAL;
+    }
+
+    return PushBuffer(requestId, buffer, desc, count, received);
+}
+
+// NOTE:
+// If the model does not have the input tensor information (e.g. the pipeline is configured),
+// the frame is bounded by the limits of the channel only.
+int Peer::GrpcServer::Gst::ValidateRequest(const Peer::TensorChannel::Descriptor *desc, int count)
+{
+    const beyond_tensor_info *info = nullptr;
+    int size = 0;
+
+    if (model->GetInputTensorInfo(info, size) < 0 || info == nullptr || size <= 0) {
+        return 0;
+    }
+
+    return Peer::TensorChannel::ValidateDescriptor(desc, count, info, size);
+}
+
+int Peer::GrpcServer::Gst::AttachStream(InferStream *stream)
+{
+    if (serverSource == nullptr) {
+        ErrPrint("The input is configured, the tensors are not acceptable");
+        return -EINVAL;
+    }
+
+    int ret = 0;
+    MUTEX_LOCK(&channelLock);
+    if (this->stream != nullptr) {
+        ErrPrint("A stream is already attached");
+        ret = -EBUSY;
+    } else {
+        this->stream = stream;
+    }
+    MUTEX_UNLOCK(&channelLock);
+
+    return ret;
+}
+
+// NOTE:
+// The stream is not available after returning from the Infer RPC,
+// wait for the results of the pending requests if the client finished its requests normally.
+void Peer::GrpcServer::Gst::DetachStream(bool drain)
+{
+    MUTEX_LOCK(&channelLock);
+    if (drain == true) {
+        struct timespec ts;
+        if (clock_gettime(CLOCK_REALTIME, &ts) < 0) {
+            ErrPrintCode(errno, "clock_gettime");
+        } else {
+            ts.tv_sec += STREAM_DRAIN_TIMEOUT / 1000;
+            ts.tv_nsec += (STREAM_DRAIN_TIMEOUT % 1000) * 1000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+
+            while (pendingIds.empty() == false) {
+                int ret = pthread_cond_timedwait(&pendingCond, &channelLock, &ts);
+                if (ret != 0) {
+                    if (ret != ETIMEDOUT) {
+                        ErrPrintCode(ret, "pthread_cond_timedwait");
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    if (pendingIds.empty() == false) {
+        DbgPrint("%zu requests are discarded", pendingIds.size());
+    }
+
+    stream = nullptr;
+    pendingIds.clear();
+    timestamps.clear();
+    MUTEX_UNLOCK(&channelLock);
+}
+
+// NOTE:
+// Must be called with the channelLock
+int Peer::GrpcServer::Gst::SendResult(uint64_t requestId, const Peer::TensorChannel::Descriptor *desc, struct iovec *iov, int count, const Peer::TensorChannel::Timing *timing)
+{
+    if (channel != nullptr) {
+        return channel->Send(requestId, desc, iov, count, timing);
+    }
+
+    if (stream == nullptr) {
+        DbgPrint("Channel is not connected, drop the result");
+        return 0;
+    }
+
+    ::peer_nn::InferResponse response;
+    response.set_request_id(requestId);
+    response.set_status(0);
+    for (int i = 0; i < count; i++) {
+        ::peer_nn::Tensor *tensor = response.add_tensors();
+        ::peer_nn::TensorInfo *info = tensor->mutable_info();
+
+        info->set_type(static_cast<::peer_nn::TensorType>(desc[i].type));
+        info->set_size(static_cast<int32_t>(desc[i].size));
+        for (int j = 0; j < desc[i].rank; j++) {
+            info->mutable_dims()->add_data(desc[i].dims[j]);
+        }
+
+        tensor->set_data(iov[i].iov_base, iov[i].iov_len);
+    }
+
+    if (timing != nullptr) {
+        ::peer_nn::Timing *_timing = response.mutable_timing();
+        _timing->set_recv(timing->recv);
+        _timing->set_convert(timing->convert);
+        _timing->set_filter(timing->filter);
+        _timing->set_post(timing->post);
+    }
+
+    if (stream->Write(response) == false) {
+        ErrPrint("Stream is closed");
+        return -EPIPE;
+    }
+
+    return 0;
+}
+
+// NOTE:
+// Must be called with the channelLock
+int Peer::GrpcServer::Gst::SendCancel(uint64_t requestId)
+{
+    if (channel != nullptr) {
+        return channel->Cancel(requestId);
+    }
+
+    if (stream == nullptr) {
+        return 0;
+    }
+
+    ::peer_nn::InferResponse response;
+    response.set_request_id(requestId);
+    response.set_status(-ECANCELED);
+    if (stream->Write(response) == false) {
+        ErrPrint("Stream is closed");
+        return -EPIPE;
+    }
+
+    return 0;
+}
+
+GstFlowReturn Peer::GrpcServer::Gst::NewSampleHandler(GstAppSink *sink, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+
+    GstSample *sample = gst_app_sink_pull_sample(sink);
+    if (sample == nullptr) {
+        ErrPrint("Failed to pull a sample");
+        return GST_FLOW_OK;
+    }
+
+    GstBuffer *buffer = gst_sample_get_buffer(sample);
+    guint count = buffer != nullptr ? gst_buffer_n_memory(buffer) : 0;
+    if (count == 0 && buffer != nullptr && GST_BUFFER_OFFSET(buffer) != GST_BUFFER_OFFSET_NONE) {
+        // NOTE:
+        // The batcher gives a buffer without memories if the batch of the request is failed
+        uint64_t requestId = GST_BUFFER_OFFSET(buffer);
+        gst_sample_unref(sample);
+        impls->CancelRequest(requestId);
+        return GST_FLOW_OK;
+    }
+
+    if (count == 0 || count > static_cast<guint>(Peer::TensorChannel::MAX_TENSORS)) {
+        ErrPrint("Invalid count of the output tensors: %u", count);
+        gst_sample_unref(sample);
+        return GST_FLOW_OK;
+    }
+
+    const beyond_tensor_info *info = nullptr;
+    int size = 0;
+    if (impls->model->GetOutputTensorInfo(info, size) < 0) {
+        info = nullptr;
+        size = 0;
+    }
+
+    GstMemory *memory[Peer::TensorChannel::MAX_TENSORS];
+    GstMapInfo mapInfo[Peer::TensorChannel::MAX_TENSORS];
+    Peer::TensorChannel::Descriptor desc[Peer::TensorChannel::MAX_TENSORS];
+    struct iovec iov[Peer::TensorChannel::MAX_TENSORS];
+    guint mapped;
+
+    for (mapped = 0; mapped < count; mapped++) {
+        memory[mapped] = gst_buffer_peek_memory(buffer, mapped);
+        if (memory[mapped] == nullptr || gst_memory_map(memory[mapped], &mapInfo[mapped], GST_MAP_READ) == FALSE) {
+            ErrPrint("Failed to map a memory");
+            break;
+        }
+
+        bool hasInfo = (info != nullptr && static_cast<int>(mapped) < size);
+        Peer::TensorChannel::FillDescriptor(desc[mapped],
+                                            hasInfo ? info[mapped].type : BEYOND_TENSOR_TYPE_UNSUPPORTED,
+                                            mapInfo[mapped].size,
+                                            hasInfo ? info + mapped : nullptr);
+        iov[mapped].iov_base = mapInfo[mapped].data;
+        iov[mapped].iov_len = mapInfo[mapped].size;
+    }
+
+    // NOTE:
+    // The timing is zero if the request is not timestamped (e.g. RTP),
+    // but it is given anyway, the client expects it with every result while tracing.
+    Peer::TensorChannel::Timing timing = {};
+    uint64_t latency = 0;
+
+    MUTEX_LOCK(&impls->channelLock);
+    uint64_t requestId = GST_BUFFER_OFFSET(buffer);
+    if (requestId == GST_BUFFER_OFFSET_NONE && impls->pendingIds.empty() == false) {
+        // NOTE:
+        // The offset is not kept by the pipeline, the results are in order of the requests
+        requestId = *impls->pendingIds.begin();
+    }
+
+    if (requestId == GST_BUFFER_OFFSET_NONE) {
+        // NOTE:
+        // The RTP packets of the client do not have the requestId extension, number the results by itself
+        requestId = impls->nextRequestId++;
+    } else {
+        // NOTE:
+        // The pipeline does not reorder the requests, the older ones were dropped
+        auto it = impls->pendingIds.begin();
+        while (it != impls->pendingIds.end() && *it < requestId) {
+            DbgPrint("Request %llu was dropped", static_cast<unsigned long long>(*it));
+            if (impls->SendCancel(*it) < 0) {
+                ErrPrint("Failed to cancel the request %llu", static_cast<unsigned long long>(*it));
+            }
+            impls->timestamps.erase(*it);
+            it = impls->pendingIds.erase(it);
+        }
+        impls->pendingIds.erase(requestId);
+        latency = impls->GetTiming(requestId, timing);
+        if (impls->pendingIds.empty() == true) {
+            COND_BROADCAST(&impls->pendingCond);
+        }
+    }
+
+    if (mapped == count) {
+        // NOTE:
+        // The results are sent from the memories of the gst buffer directly
+        if (impls->SendResult(requestId, desc, iov, count, impls->trace == true ? &timing : nullptr) < 0) {
+            ErrPrint("Failed to send the result of the request %llu", static_cast<unsigned long long>(requestId));
+        }
+    } else {
+        latency = 0;
+        if (impls->SendCancel(requestId) < 0) {
+            ErrPrint("Failed to cancel the request %llu", static_cast<unsigned long long>(requestId));
+        }
+    }
+    MUTEX_UNLOCK(&impls->channelLock);
+
+    if (latency > 0) {
+        impls->grpc->AddLatency(latency);
+    }
+
+    for (guint i = 0; i < mapped; i++) {
+        gst_memory_unmap(memory[i], &mapInfo[i]);
+    }
+
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+// NOTE:
+// The requests are timestamped when they enter and leave the tensor_filter,
+// or the batcher if the model is shared, the offset of the buffer is the requestId.
+void Peer::GrpcServer::Gst::AddTraceProbes(GstElement *filter)
+{
+    GstElement *in = nullptr;
+    GstElement *out = nullptr;
+
+    if (batcher != nullptr) {
+        in = gst_bin_get_by_name(GST_BIN(threadCtx.pipeline), "batchSink");
+        out = gst_bin_get_by_name(GST_BIN(threadCtx.pipeline), "batchSource");
+    } else if (filter != nullptr) {
+        in = GST_ELEMENT(gst_object_ref(filter));
+        out = GST_ELEMENT(gst_object_ref(filter));
+    }
+
+    if (in != nullptr) {
+        GstPad *pad = gst_element_get_static_pad(in, "sink");
+        if (pad != nullptr) {
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, Peer::GrpcServer::Gst::FilterInProbe, static_cast<gpointer>(this), nullptr);
+            gst_object_unref(pad);
+        }
+        gst_object_unref(in);
+    }
+
+    if (out != nullptr) {
+        GstPad *pad = gst_element_get_static_pad(out, "src");
+        if (pad != nullptr) {
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, Peer::GrpcServer::Gst::FilterOutProbe, static_cast<gpointer>(this), nullptr);
+            gst_object_unref(pad);
+        }
+        gst_object_unref(out);
+    }
+}
+
+// NOTE:
+// The probes are invoked on the streaming thread of the udpsrc,
+// the depayloader gives the frame after it receives its last packet.
+void Peer::GrpcServer::Gst::AddDepayloaderProbes(void)
+{
+    GstElement *depayloader = gst_bin_get_by_name(GST_BIN(threadCtx.pipeline), DEPAYLOADER_NAME);
+    if (depayloader == nullptr) {
+        ErrPrint("Failed to get " DEPAYLOADER_NAME " element");
+        return;
+    }
+
+    GstPad *pad = gst_element_get_static_pad(depayloader, "sink");
+    if (pad != nullptr) {
+        gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                          Peer::GrpcServer::Gst::DepayloaderInProbe, static_cast<gpointer>(this), nullptr);
+        gst_object_unref(pad);
+    }
+
+    pad = gst_element_get_static_pad(depayloader, "src");
+    if (pad != nullptr) {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, Peer::GrpcServer::Gst::DepayloaderOutProbe, static_cast<gpointer>(this), nullptr);
+        gst_object_unref(pad);
+    }
+
+    gst_object_unref(depayloader);
+}
+
+uint64_t Peer::GrpcServer::Gst::GetRtpRequestId(GstBuffer *buffer)
+{
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    uint64_t requestId = GST_BUFFER_OFFSET_NONE;
+
+    if (buffer == nullptr || gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp) == FALSE) {
+        return requestId;
+    }
+
+    gpointer data = nullptr;
+    guint size = 0;
+    if (gst_rtp_buffer_get_extension_onebyte_header(&rtp, RTP_REQUEST_EXTENSION_ID, 0, &data, &size) == TRUE && size == sizeof(requestId)) {
+        memcpy(&requestId, data, sizeof(requestId));
+        requestId = GUINT64_FROM_BE(requestId);
+    }
+
+    gst_rtp_buffer_unmap(&rtp);
+    return requestId;
+}
+
+GstPadProbeReturn Peer::GrpcServer::Gst::DepayloaderInProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    GstBuffer *buffer;
+
+    if ((GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) == GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+        guint length = list != nullptr ? gst_buffer_list_length(list) : 0;
+        buffer = length > 0 ? gst_buffer_list_get(list, length - 1) : nullptr;
+    } else {
+        buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    }
+
+    uint64_t requestId = Peer::GrpcServer::Gst::GetRtpRequestId(buffer);
+    if (requestId != GST_BUFFER_OFFSET_NONE) {
+        impls->rtpRequestId = requestId;
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn Peer::GrpcServer::Gst::DepayloaderOutProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    uint64_t requestId = impls->rtpRequestId;
+
+    if (requestId == GST_BUFFER_OFFSET_NONE) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (buffer == nullptr) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    buffer = gst_buffer_make_writable(buffer);
+    GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    GST_BUFFER_OFFSET(buffer) = requestId;
+
+    if (impls->lastRtpRequestId != GST_BUFFER_OFFSET_NONE && requestId <= impls->lastRtpRequestId) {
+        // NOTE:
+        // The frame of the same request (or a reordered one) was given already
+        return GST_PAD_PROBE_OK;
+    }
+
+    MUTEX_LOCK(&impls->channelLock);
+    if (impls->lastRtpRequestId != GST_BUFFER_OFFSET_NONE) {
+        uint64_t skipped = requestId - impls->lastRtpRequestId - 1;
+        if (skipped > RTP_MAX_SKIPPED) {
+            // NOTE:
+            // The client cancels the older requests anyway when it receives the later result
+            DbgPrint("%llu requests are skipped", static_cast<unsigned long long>(skipped));
+            skipped = RTP_MAX_SKIPPED;
+        }
+
+        for (uint64_t id = requestId - skipped; id < requestId; id++) {
+            if (impls->SendCancel(id) < 0) {
+                ErrPrint("Failed to cancel the request %llu", static_cast<unsigned long long>(id));
+            }
+        }
+    }
+    uint64_t now = Peer::Trace::Now();
+    impls->pendingIds.insert(requestId);
+    impls->timestamps[requestId] = {
+        .received = now,
+        .pushed = now,
+        .filterIn = 0,
+        .filterOut = 0,
+    };
+    MUTEX_UNLOCK(&impls->channelLock);
+
+    impls->lastRtpRequestId = requestId;
+    return GST_PAD_PROBE_OK;
+}
+
+void Peer::GrpcServer::Gst::StampFilter(GstBuffer *buffer, bool in)
+{
+    if (buffer == nullptr || GST_BUFFER_OFFSET(buffer) == GST_BUFFER_OFFSET_NONE) {
+        return;
+    }
+
+    uint64_t now = Peer::Trace::Now();
+
+    MUTEX_LOCK(&channelLock);
+    auto it = timestamps.find(GST_BUFFER_OFFSET(buffer));
+    if (it != timestamps.end()) {
+        if (in == true) {
+            it->second.filterIn = now;
+        } else {
+            it->second.filterOut = now;
+        }
+    }
+    MUTEX_UNLOCK(&channelLock);
+}
+
+GstPadProbeReturn Peer::GrpcServer::Gst::FilterInProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    impls->StampFilter(GST_PAD_PROBE_INFO_BUFFER(info), true);
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn Peer::GrpcServer::Gst::FilterOutProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
+    impls->StampFilter(GST_PAD_PROBE_INFO_BUFFER(info), false);
+    return GST_PAD_PROBE_OK;
+}
+
+// NOTE:
+// Must be called with the channelLock
+// The timestamps of the request are released here.
+// Returns the latency (usec) of the request on the server, 0 if it is not timestamped.
+uint64_t Peer::GrpcServer::Gst::GetTiming(uint64_t requestId, Peer::TensorChannel::Timing &timing)
+{
+    auto it = timestamps.find(requestId);
+    if (it == timestamps.end()) {
+        return 0;
+    }
+
+    const Timestamp &ts = it->second;
+    uint64_t now = Peer::Trace::Now();
+    uint64_t filterIn = ts.filterIn > 0 ? ts.filterIn : ts.pushed;
+    uint64_t filterOut = ts.filterOut > 0 ? ts.filterOut : filterIn;
+
+    timing.recv = static_cast<uint32_t>(ts.pushed > ts.received ? ts.pushed - ts.received : 0);
+    timing.convert = static_cast<uint32_t>(filterIn > ts.pushed ? filterIn - ts.pushed : 0);
+    timing.filter = static_cast<uint32_t>(filterOut > filterIn ? filterOut - filterIn : 0);
+    timing.post = static_cast<uint32_t>(now > filterOut ? now - filterOut : 0);
+
+    uint64_t latency = now > ts.received ? now - ts.received : 0;
+    timestamps.erase(it);
+    return latency;
+}
+
+GstCaps *Peer::GrpcServer::Gst::DescriptorToCaps(const Peer::TensorChannel::Descriptor *desc, int count)
+{
+    std::string dims;
+    std::string types;
+
+    for (int i = 0; i < count; i++) {
+        int _dims[Peer::TensorChannel::MAX_RANK] = { 1, 1, 1, 1 };
+        int rank = desc[i].rank;
+
+        if (rank <= 0 || rank > Peer::TensorChannel::MAX_RANK) {
+            ErrPrint("Unsupported rank: %d", rank);
+            return nullptr;
+        }
+
+        const char *type = beyond::Inference::TensorTypeToString(static_cast<beyond_tensor_type>(desc[i].type));
+        if (type == nullptr) {
+            ErrPrint("Unsupported type: %d", desc[i].type);
+            return nullptr;
+        }
+
+        // NOTE:
+        // NHWC (tflite)
+        // nnstreamer reverses the dimension for the CAPS negotiation its internal uses.
+        for (int j = 0; j < rank; j++) {
+            _dims[rank - j - 1] = desc[i].dims[j];
+        }
+
+        if (i > 0) {
+            dims += ",";
+            types += ",";
+        }
+
+        for (int j = 0; j < Peer::TensorChannel::MAX_RANK; j++) {
+            if (j > 0) {
+                dims += ":";
+            }
+            dims += std::to_string(_dims[j]);
+        }
+
+        types += type;
+    }
+
+    gchar *capsString = g_strdup_printf(
+        "other/tensors,format=static,num_tensors=%d,dimensions=(string)\"%s\",types=(string)\"%s\",framerate=(fraction)0/1",
+        count, dims.c_str(), types.c_str());
+    if (capsString == nullptr) {
+        ErrPrint("Failed to build a caps description");
+        return nullptr;
+    }
+
+    GstCaps *caps = gst_caps_from_string(capsString);
+    if (caps == nullptr) {
+        ErrPrint("Invalid caps: %s", capsString);
+    }
+
+    g_free(capsString);
+    return caps;
+}
+
+int Peer::GrpcServer::Gst::Listen(void)
+{
+    if (listenFd >= 0 || channel != nullptr) {
+        // NOTE:
+        // The channel is kept even if the pipeline is prepared again
+        return 0;
+    }
+
+    int ret = Peer::TensorChannel::Listen(listenFd, channelPort);
+    if (ret < 0) {
+        return ret;
+    }
+
+    listenSource = g_unix_fd_source_new(listenFd, G_IO_IN);
+    if (listenSource == nullptr) {
+        ErrPrint("Failed to create a source for the channel");
+        CloseListen();
+        return -EFAULT;
+    }
 
-        dims->size = rank + 1;
+    g_source_set_callback(listenSource,
+                          (GSourceFunc)Peer::GrpcServer::Gst::Thread::AcceptHandler,
+                          static_cast<gpointer>(this), nullptr);
+    g_source_attach(listenSource, g_main_context_get_thread_default());
+
+    // NOTE:
+    // The local channel is optional, the TCP port is used if it is not available.
+    // The local channel is not sealed, it is not advertised if the session key is exchanged,
+    // so the frames of the authenticated client are always sealed.
+    if (secretKey.empty() == false) {
+        DbgPrint("Local channel is not used for the sealed channel");
+        return 0;
+    }
 
-        ret = DIMS_PARSER(dimsVector[i].c_str(), rank, dims->data);
-        if (ret < 0) {
-            ErrPrint("Failed to parse the dims");
-            free(dims);
-            dims = nullptr;
-            Peer::Model::FreeTensorInfo(tensorInfo, i);
-            return ret;
-        }
+    if (Peer::TensorChannel::ListenLocal(localFd, localChannel) < 0) {
+        ErrPrint("Local channel is not available");
+        return 0;
+    }
 
-        tensorInfo[i].size = beyond::Inference::TensorTypeToSize(typeVector[i]) * ret;
-        tensorInfo[i].type = typeVector[i];
-        tensorInfo[i].name = nullptr;
-        tensorInfo[i].dims = dims;
+    localSource = g_unix_fd_source_new(localFd, G_IO_IN);
+    if (localSource == nullptr) {
+        ErrPrint("Failed to create a source for the local channel");
+        if (close(localFd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        localFd = -1;
+        localChannel.clear();
+        return 0;
     }
 
-    info = tensorInfo;
-    size = typeVector.size();
+    g_source_set_callback(localSource,
+                          (GSourceFunc)Peer::GrpcServer::Gst::Thread::AcceptHandler,
+                          static_cast<gpointer>(this), nullptr);
+    g_source_attach(localSource, g_main_context_get_thread_default());
     return 0;
 }
 
-void Peer::GrpcServer::Gst::Thread::BusHandler(GstBus *bus, GstMessage *message, gpointer user_data)
+// NOTE:
+// The channel is destroyed if it fails to be attached, the listening sockets are kept for the next client then.
+int Peer::GrpcServer::Gst::AttachChannel(Peer::TensorChannel *_channel)
 {
-    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(user_data);
-    if (impls == nullptr) {
-        assert(!"Peer cannot be nullptr");
-        ErrPrint("Peer cannot be nullptr");
-        return;
+    // NOTE:
+    // The buffers of a request are allocated by its descriptors,
+    // the channel caps them by the input of the model before the RecvHandler() validates them.
+    const beyond_tensor_info *info = nullptr;
+    int size = 0;
+    if (model->GetInputTensorInfo(info, size) == 0 && info != nullptr && size > 0 && _channel->SetLimit(info, size) < 0) {
+        ErrPrint("Unable to limit the tensor channel: %d tensors", size);
+        _channel->Destroy();
+        return -EINVAL;
     }
 
-    if (message == nullptr) {
-        assert(!"message cannot be nullptr");
-        ErrPrint("message cannot be nullptr");
-        return;
+    GSource *source = g_unix_fd_source_new(_channel->GetHandle(), static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR));
+    if (source == nullptr) {
+        ErrPrint("Failed to create a source for the channel");
+        _channel->Destroy();
+        return -EFAULT;
     }
 
-    gchar *debug = nullptr;
-    GError *error = nullptr;
-    Peer *peer = impls->grpc->peer;
+    g_source_set_callback(source,
+                          (GSourceFunc)Peer::GrpcServer::Gst::Thread::RecvHandler,
+                          static_cast<gpointer>(this), nullptr);
+    g_source_attach(source, g_main_context_get_thread_default());
+    Peer::GrpcServer::Gst::Thread::DestroySource(threadCtx.recvSource);
+    threadCtx.recvSource = source;
+    source = nullptr;
 
-    switch (GST_MESSAGE_TYPE(message)) {
-    case GST_MESSAGE_ERROR:
-        gst_message_parse_error(message, &error, &debug);
-        ErrPrint("%s: %s", gst_message_type_get_name(GST_MESSAGE_TYPE(message)), error->message);
-        g_error_free(error);
-        error = nullptr;
+    MUTEX_LOCK(&channelLock);
+    channel = _channel;
+    MUTEX_UNLOCK(&channelLock);
 
-        g_free(static_cast<gpointer>(debug));
-        debug = nullptr;
+    // NOTE:
+    // A client has only one channel, do not accept anymore
+    CloseListen();
+    return 0;
+}
 
-        // TODO:
-        // Need to get the current inference data
-        if (peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR) < 0) {
-            ErrPrint("Unable to publish event");
-        }
-        break;
-    case GST_MESSAGE_WARNING:
-        gst_message_parse_warning(message, &error, &debug);
-        DbgPrint("%s: %s", gst_message_type_get_name(GST_MESSAGE_TYPE(message)), error->message);
-        g_error_free(error);
-        error = nullptr;
+void Peer::GrpcServer::Gst::CloseListen(void)
+{
+    Peer::GrpcServer::Gst::Thread::DestroySource(handshakeSource);
+    if (handshakeChannel != nullptr) {
+        handshakeChannel->Destroy();
+        handshakeChannel = nullptr;
+    }
 
-        g_free(static_cast<gpointer>(debug));
-        debug = nullptr;
+    if (listenSource != nullptr) {
+        g_source_destroy(listenSource);
+        g_source_unref(listenSource);
+        listenSource = nullptr;
+    }
 
-        // TODO:
-        // What should we do?
-        break;
-    case GST_MESSAGE_STATE_CHANGED: {
-        GstState newstate, oldstate;
-        gst_message_parse_state_changed(message, &oldstate, &newstate, nullptr);
+    if (localSource != nullptr) {
+        g_source_destroy(localSource);
+        g_source_unref(localSource);
+        localSource = nullptr;
+    }
 
-        if (oldstate == GST_STATE_PLAYING && newstate == GST_STATE_PAUSED) {
-            int ret = peer->eventObject->PublishEventData(beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_STOPPED);
-            if (ret < 0) {
-                DbgPrint("Unable to publish stopped event: %d", ret);
-            }
+    if (listenFd >= 0) {
+        if (close(listenFd) < 0) {
+            ErrPrintCode(errno, "close");
         }
-        break;
+        listenFd = -1;
     }
-    default:
-        DbgPrint("%s", gst_message_type_get_name(GST_MESSAGE_TYPE(message)));
-        break;
+
+    if (localFd >= 0) {
+        if (close(localFd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        localFd = -1;
     }
+
+    localChannel.clear();
 }
 
-int Peer::GrpcServer::Gst::Thread::CommandHandlerReady(Peer::GrpcServer::Gst *impls, void *data)
+void Peer::GrpcServer::Gst::CancelRequest(uint64_t requestId)
 {
-    return 0;
+    MUTEX_LOCK(&channelLock);
+    pendingIds.erase(requestId);
+    timestamps.erase(requestId);
+    if (pendingIds.empty() == true) {
+        COND_BROADCAST(&pendingCond);
+    }
+    if (SendCancel(requestId) < 0) {
+        ErrPrint("Failed to cancel the request %llu", static_cast<unsigned long long>(requestId));
+    }
+    MUTEX_UNLOCK(&channelLock);
+}
+
+void Peer::GrpcServer::Gst::CloseChannel(void)
+{
+    // NOTE:
+    // The frame which is not completed is discarded with its channel
+    ReleaseIncoming();
+
+    MUTEX_LOCK(&channelLock);
+    Peer::TensorChannel *_channel = channel;
+    channel = nullptr;
+    if (stream == nullptr) {
+        pendingIds.clear();
+        timestamps.clear();
+        COND_BROADCAST(&pendingCond);
+    }
+    MUTEX_UNLOCK(&channelLock);
+
+    if (_channel != nullptr) {
+        _channel->Destroy();
+    }
 }
 
 int Peer::GrpcServer::Gst::Thread::CommandHandlerPrepare(Peer::GrpcServer::Gst *impls, void *data)
@@ -439,30 +1524,80 @@ int Peer::GrpcServer::Gst::Thread::CommandHandlerPrepare(Peer::GrpcServer::Gst *
             break;
         }
 
-        tensorFilter = gst_bin_get_by_name(GST_BIN(impls->threadCtx.pipeline), "tensorFilter");
-        if (tensorFilter == nullptr) {
-            ErrPrint("Failed to get serverSink element");
-            g_object_unref(source);
-            source = nullptr;
-            g_object_unref(impls->threadCtx.pipeline);
-            impls->threadCtx.pipeline = nullptr;
-            g_object_unref(impls->threadCtx.bus);
-            impls->threadCtx.bus = nullptr;
-            ret = -EFAULT;
-            break;
+        if (impls->batcher != nullptr) {
+            GstElement *batchSink = gst_bin_get_by_name(GST_BIN(impls->threadCtx.pipeline), "batchSink");
+            GstElement *batchSource = gst_bin_get_by_name(GST_BIN(impls->threadCtx.pipeline), "batchSource");
+            if (batchSink == nullptr || batchSource == nullptr || impls->batcher->Attach(batchSink, batchSource) < 0) {
+                ErrPrint("Failed to attach the batcher");
+                if (batchSink != nullptr) {
+                    gst_object_unref(batchSink);
+                }
+                if (batchSource != nullptr) {
+                    gst_object_unref(batchSource);
+                }
+                g_object_unref(source);
+                source = nullptr;
+                g_object_unref(impls->threadCtx.pipeline);
+                impls->threadCtx.pipeline = nullptr;
+                g_object_unref(impls->threadCtx.bus);
+                impls->threadCtx.bus = nullptr;
+                ret = -EFAULT;
+                break;
+            }
+
+            gst_object_unref(batchSource);
+            impls->batchSink = batchSink;
+        } else {
+            tensorFilter = gst_bin_get_by_name(GST_BIN(impls->threadCtx.pipeline), "tensorFilter");
+            if (tensorFilter == nullptr) {
+                ErrPrint("Failed to get serverSink element");
+                g_object_unref(source);
+                source = nullptr;
+                g_object_unref(impls->threadCtx.pipeline);
+                impls->threadCtx.pipeline = nullptr;
+                g_object_unref(impls->threadCtx.bus);
+                impls->threadCtx.bus = nullptr;
+                ret = -EFAULT;
+                break;
+            }
         }
 
         g_source_set_callback(source,
                               (GSourceFunc)Peer::GrpcServer::Gst::Thread::BusHandler,
                               static_cast<gpointer>(impls), nullptr);
         g_source_attach(source, g_main_context_get_thread_default());
-        g_source_unref(source);
+        Peer::GrpcServer::Gst::Thread::DestroySource(impls->threadCtx.busSource);
+        impls->threadCtx.busSource = source;
         source = nullptr;
+
+        GstAppSinkCallbacks callbacks = {};
+        callbacks.new_sample = Peer::GrpcServer::Gst::NewSampleHandler;
+        gst_app_sink_set_callbacks(GST_APP_SINK(serverSink), &callbacks, static_cast<gpointer>(impls), nullptr);
+
+        if (impls->trace == true) {
+            impls->AddTraceProbes(tensorFilter);
+        }
+
+        if (impls->preprocessing.empty() == false) {
+            impls->AddDepayloaderProbes();
+        }
+
+        if (impls->preprocessing.empty() == true) {
+            if (impls->serverSource != nullptr) {
+                gst_object_unref(impls->serverSource);
+            }
+            impls->serverSource = GST_ELEMENT(gst_object_ref(serverSource));
+            impls->serverSourceCaps = false;
+        }
     } while (0);
 
     g_free(prepareData->pipelineDescription);
     prepareData->pipelineDescription = nullptr;
 
+    if (ret == 0) {
+        ret = impls->Listen();
+    }
+
     if (ret == 0) {
         GstStateChangeReturn scret = gst_element_set_state(impls->threadCtx.pipeline, GST_STATE_PLAYING);
         if (scret == GST_STATE_CHANGE_FAILURE) {
@@ -472,27 +1607,22 @@ int Peer::GrpcServer::Gst::Thread::CommandHandlerPrepare(Peer::GrpcServer::Gst *
             gint port = -1;
 
             if (impls->preprocessing.empty() == true) {
-                // NOTE: we are using TCP when the input is not configured
-                // tcpserversrc property name
-                g_object_get(G_OBJECT(serverSource), "current-port", &port, nullptr);
-                prepareData->port.request = port;
+                // NOTE: the raw tensors are sent via the tensor channel when the input is not configured
+                prepareData->port.request = impls->channelPort;
             } else {
                 // udpsrc property name
                 g_object_get(G_OBJECT(serverSource), "port", &port, nullptr);
                 prepareData->port.request = port;
             }
 
-            port = -1;
-            // tcpservrsink property name
-            g_object_get(G_OBJECT(serverSink), "current-port", &port, nullptr);
-            prepareData->port.response = port;
+            prepareData->port.response = impls->channelPort;
 
             const beyond_tensor_info *info = nullptr;
             int size = 0;
             int tensorinfo_status;
 
             tensorinfo_status = impls->model->GetInputTensorInfo(info, size);
-            if (tensorinfo_status != 0 || info == nullptr || size <= 0) {
+            if (tensorFilter != nullptr && (tensorinfo_status != 0 || info == nullptr || size <= 0)) {
                 beyond_tensor_info *_info;
                 if (Peer::GrpcServer::Gst::ExtractTensorInfo(tensorFilter, "input", _info, size) == 0) {
                     impls->model->SetInputTensorInfo(_info, size);
@@ -502,7 +1632,7 @@ int Peer::GrpcServer::Gst::Thread::CommandHandlerPrepare(Peer::GrpcServer::Gst *
             info = nullptr;
             size = 0;
             tensorinfo_status = impls->model->GetOutputTensorInfo(info, size);
-            if (tensorinfo_status != 0 || info == nullptr || size <= 0) {
+            if (tensorFilter != nullptr && (tensorinfo_status != 0 || info == nullptr || size <= 0)) {
                 beyond_tensor_info *_info;
                 if (Peer::GrpcServer::Gst::ExtractTensorInfo(tensorFilter, "output", _info, size) == 0) {
                     impls->model->SetOutputTensorInfo(_info, size);
@@ -528,10 +1658,31 @@ int Peer::GrpcServer::Gst::Thread::CommandHandlerStop(Peer::GrpcServer::Gst *imp
     return 0;
 }
 
+// NOTE:
+// The worker keeps running for the other clients, remove the sources of this client only.
+// The client is destroyed after this reply, no handler of it is invoked on the worker anymore.
 int Peer::GrpcServer::Gst::Thread::CommandHandlerExit(Peer::GrpcServer::Gst *impls, void *data)
 {
-    g_main_loop_quit(impls->threadCtx.loop);
-    return 0;
+    impls->CloseListen();
+    DestroySource(impls->threadCtx.recvSource);
+    DestroySource(impls->threadCtx.busSource);
+    g_source_destroy(impls->threadCtx.commandSource);
+
+    int ret = impls->threadCtx.command->Send(Command::IdExit);
+    if (ret < 0) {
+        ErrPrint("Failed to send a command");
+    }
+
+    return ret;
+}
+
+void Peer::GrpcServer::Gst::Thread::DestroySource(GSource *&source)
+{
+    if (source != nullptr) {
+        g_source_destroy(source);
+        g_source_unref(source);
+        source = nullptr;
+    }
 }
 
 gboolean Peer::GrpcServer::Gst::Thread::CommandPrepare(GSource *source, gint *timeout)
@@ -573,7 +1724,7 @@ gboolean Peer::GrpcServer::Gst::Thread::CommandHandle(GSource *source, GSourceFu
         return FALSE;
     }
 
-    if (id >= Command::IdReady && id < Command::IdLast && impls->threadCtx.cmdTable[id] != nullptr) {
+    if (id >= Command::IdPrepare && id < Command::IdLast && impls->threadCtx.cmdTable[id] != nullptr) {
         int ret = impls->threadCtx.cmdTable[id](impls, data);
         if (ret < 0) {
             ErrPrint("command handler returns %d", ret);
@@ -583,7 +1734,7 @@ gboolean Peer::GrpcServer::Gst::Thread::CommandHandle(GSource *source, GSourceFu
             return TRUE;
         }
     } else {
-        assert(id >= Command::IdReady && id < Command::IdLast);
+        assert(id >= Command::IdPrepare && id < Command::IdLast);
         assert(impls->threadCtx.cmdTable[id] != nullptr);
         ErrPrint("Handler was not mapped or invalid id");
     }
@@ -622,49 +1773,67 @@ Peer::GrpcServer::Gst *Peer::GrpcServer::Gst::Create(std::string &peerId, Peer::
     impls->command = std::make_unique<beyond::CommandObject>(spfd[0]);
     impls->threadCtx.command = std::make_unique<beyond::CommandObject>(spfd[1]);
 
-    int status = pthread_create(&impls->threadId, nullptr, Peer::GrpcServer::Gst::Thread::Main, static_cast<void *>(impls));
-    if (status != 0) {
-        ErrPrintCode(status, "pthread_create");
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        delete impls;
-        impls = nullptr;
-        return nullptr;
+    // NOTE:
+    // The client is attached to a worker on preparing, the model is known at that moment
+    return impls;
+}
+
+int Peer::GrpcServer::Gst::Attach(const std::string &key)
+{
+    static GSourceFuncs srcs = {
+        Peer::GrpcServer::Gst::Thread::CommandPrepare,
+        Peer::GrpcServer::Gst::Thread::CommandCheck,
+        Peer::GrpcServer::Gst::Thread::CommandHandle,
+        nullptr,
+    };
+
+    GMainContext *context = grpc->pool->Acquire(key);
+    if (context == nullptr) {
+        return -EFAULT;
     }
 
-    // Wait for the g_main_loop ready
-    int cmdId = Command::IdLast;
-    if (impls->command->Recv(cmdId) < 0 || cmdId != Command::IdReady) {
-        ErrPrint("CommandId: 0x%.8X", cmdId);
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        delete impls;
-        impls = nullptr;
-        return nullptr;
+    GSource *source = g_source_new(&srcs, sizeof(Thread::EventUserData));
+    if (source == nullptr) {
+        ErrPrint("Failed to create a source for the command");
+        grpc->pool->Release(context, key);
+        return -EFAULT;
     }
 
-    return impls;
+    Thread::EventUserData *ud = reinterpret_cast<Thread::EventUserData *>(source);
+    ud->impls = this;
+    ud->fd.fd = threadCtx.command->GetHandle();
+    ud->fd.events = G_IO_IN | G_IO_ERR;
+    g_source_add_poll(source, &ud->fd);
+    if (g_source_attach(source, context) == 0) {
+        ErrPrint("Failed to attach the source for the command");
+        g_source_unref(source);
+        grpc->pool->Release(context, key);
+        return -EFAULT;
+    }
+
+    threadCtx.context = context;
+    threadCtx.commandSource = source;
+    workerKey = key;
+    return 0;
 }
 
 void Peer::GrpcServer::Gst::Destroy(void)
 {
-    void *retval;
+    if (threadCtx.commandSource != nullptr) {
+        // NOTE:
+        // Wait for the worker to remove the sources of this client
+        int cmdId = Command::IdLast;
+        if (command->Send(Command::IdExit) < 0) {
+            ErrPrint("Failed to send Exit command");
+        } else if (command->Recv(cmdId) < 0 || cmdId != Command::IdExit) {
+            ErrPrint("CommandId: 0x%.8X", cmdId);
+        }
 
-    if (command->Send(Command::IdExit) < 0) {
-        ErrPrint("Failed to send Exit command");
-    }
+        g_source_unref(threadCtx.commandSource);
+        threadCtx.commandSource = nullptr;
 
-    int status = pthread_join(threadId, &retval);
-    if (status != 0) {
-        ErrPrintCode(status, "pthread_join");
+        grpc->pool->Release(threadCtx.context, workerKey);
+        threadCtx.context = nullptr;
     }
 
     if (close(command->GetHandle()) < 0) {
@@ -675,6 +1844,32 @@ void Peer::GrpcServer::Gst::Destroy(void)
         ErrPrintCode(errno, "close");
     }
 
+    // NOTE:
+    // The streaming thread of the pipeline feeds the batcher and sends the results via the channel,
+    // stop the pipeline before detaching it from the batcher and closing the channel.
+    if (threadCtx.pipeline != nullptr) {
+        gst_element_set_state(threadCtx.pipeline, GST_STATE_NULL);
+    }
+
+    CloseChannel();
+    CloseListen();
+
+    if (serverSource != nullptr) {
+        gst_object_unref(serverSource);
+        serverSource = nullptr;
+    }
+
+    if (batcher != nullptr) {
+        if (batchSink != nullptr) {
+            batcher->Detach(batchSink);
+            gst_object_unref(batchSink);
+            batchSink = nullptr;
+        }
+
+        grpc->registry->Release(batcherKey);
+        batcher = nullptr;
+    }
+
     delete this;
 }
 
@@ -718,7 +1913,7 @@ int Peer::GrpcServer::Gst::Configure(const beyond_plugin_peer_nn_config::server_
     return 0;
 }
 
-int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
+int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort, std::string &localChannel)
 {
     const char *modelPath = model->GetModelPath();
     if (modelPath == nullptr) {
@@ -726,6 +1921,14 @@ int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
         return -EILSEQ;
     }
 
+    if (batchSink != nullptr) {
+        // NOTE:
+        // The client pipeline is attached to the batcher already,
+        // it cannot be replaced while the batcher is feeding it.
+        ErrPrint("Already prepared");
+        return -EALREADY;
+    }
+
     PrepareData *prepareData;
 
     try {
@@ -749,17 +1952,57 @@ int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
         outputProps = Peer::GrpcServer::Gst::TensorInfoToProperties("output", info, size);
     }
 
+    // NOTE:
+    // The digest is cached by the registry, the uploaded models are registered already.
+    // It is published as a loaded model of the server.
+    std::string digest;
+    size_t modelSize = 0;
+    if (grpc->registry->GetDigest(modelPath, digest, modelSize) < 0) {
+        digest.clear();
+    }
+
+    // NOTE:
+    // Share the loaded model with the other clients which are using the same model (contents),
+    // the requests are multiplexed by the batcher of the model, and batched if the batchSize is greater than 1.
+    // Without batching, the batcher runs each request as soon as it arrives.
+    // The batcher builds its tensor_filter from the tensor information, so it must be known at this moment.
+    // Otherwise, the client keeps its own tensor_filter.
+    if (batcher == nullptr) {
+        const beyond_tensor_info *inputInfo = nullptr;
+        const beyond_tensor_info *outputInfo = nullptr;
+        int inputSize = 0;
+        int outputSize = 0;
+
+        if (model->GetInputTensorInfo(inputInfo, inputSize) == 0 && inputInfo != nullptr && inputSize > 0 &&
+            model->GetOutputTensorInfo(outputInfo, outputSize) == 0 && outputInfo != nullptr && outputSize > 0 &&
+            digest.empty() == false) {
+            int batchSize = grpc->peer->serverCtx->batchSize > 1 ? grpc->peer->serverCtx->batchSize : 1;
+
+            batcherKey = Peer::GrpcServer::Registry::MakeKey(digest, framework, accel, inputProps, outputProps);
+            batcher = grpc->registry->Acquire(batcherKey, modelSize,
+                                              framework.c_str(), modelPath, accel.c_str(),
+                                              inputInfo, inputSize, outputInfo, outputSize,
+                                              batchSize, grpc->peer->serverCtx->batchTimeout);
+            if (batcher == nullptr) {
+                ErrPrint("Failed to get a shared model, fallback to the client pipeline");
+            }
+        } else {
+            InfoPrint("Tensor information is not available, the model is not going to be shared");
+        }
+    }
+
     gchar *prePipeline = nullptr;
     if (preprocessing.empty() == true) {
         // NOTE
-        // When input_config is not set, use tcp + gdp payloder
-        // TODO: need to handle secured channel maybe by using RTSP over tcp + tls
-
-        // Otherwise, need to find general format of rtp payloder for raw tensor
-        prePipeline = g_strdup_printf("tcpserversrc name=serverSource host=0.0.0.0 port=0 ! gdpdepay");
+        // When input_config is not set, the raw tensors are given via the tensor channel,
+        // it is sealed by the session key if the key is exchanged.
+        prePipeline = g_strdup_printf("appsrc name=serverSource is-live=true format=time");
     } else {
         // TODO: we may get media type from the Configure and than,
         // need to break down Rx decoder and its payload
+        // NOTE:
+        // The socket of the udpsrc which is bound to "::" is dual-stack (GSocket turns the IPV6_V6ONLY off),
+        // so the client can send the packets over either IPv4 or IPv6.
         if (secretKey.empty() == false) {
             // Now, we have to build the srtp pipeline using the secretKey
             DbgPrint("GST SecretKey found: %s", secretKey.c_str());
@@ -771,19 +2014,21 @@ int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
                 _secretKey += std::string(hex);
             }
             prePipeline = g_strdup_printf(
-                "udpsrc name=serverSource address=0.0.0.0 port=0 "
+                "udpsrc name=serverSource address=\"%s\" port=0 "
                 "caps=\"application/x-srtp, encoding-name=%s, payload=%d, ssrc=(uint)%s, roc=(uint)0, "
                 "srtp-key=(buffer)%s, srtp-cipher=(string)aes-128-icm, srtp-auth=(string)hmac-sha1-80, "
-                "srtcp-cipher=(string)aes-128-icm, srtcp-auth=(string)hmac-sha1-80\" ! srtpdec ! %s",
+                "srtcp-cipher=(string)aes-128-icm, srtcp-auth=(string)hmac-sha1-80\" ! srtpdec ! %s name=" DEPAYLOADER_NAME,
+                Peer::TensorChannel::GetAnyAddress(),
                 rtpConfig.encodingName.c_str(),
                 rtpConfig.payload,
                 peerId.c_str(), _secretKey.c_str(),
                 rtpConfig.depayloader.c_str());
         } else {
             prePipeline = g_strdup_printf(
-                "udpsrc name=serverSource address=0.0.0.0 port=0 "
+                "udpsrc name=serverSource address=\"%s\" port=0 "
                 "caps=\"application/x-rtp, encoding-name=%s, payload=%d\" ! "
-                "%s",
+                "%s name=" DEPAYLOADER_NAME,
+                Peer::TensorChannel::GetAnyAddress(),
                 rtpConfig.encodingName.c_str(),
                 rtpConfig.payload,
                 rtpConfig.depayloader.c_str());
@@ -797,12 +2042,22 @@ int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
         return -ENOMEM;
     }
 
-    prepareData->pipelineDescription = g_strdup_printf(
-        "%s ! %s "
-        "tensor_filter name=tensorFilter framework=%s model=%s %s %s %s ! tensor_decoder mode=flatbuf ! gdppay ! "
-        "tcpserversink name=serverSink host=0.0.0.0 port=0",
-        prePipeline,
-        preprocessing.c_str(), framework.c_str(), modelPath, accel.c_str(), inputProps.c_str(), outputProps.c_str());
+    if (batcher != nullptr) {
+        prepareData->pipelineDescription = g_strdup_printf(
+            "%s ! %s "
+            "appsink name=batchSink sync=false "
+            "appsrc name=batchSource is-live=true format=time ! "
+            "appsink name=serverSink sync=false",
+            prePipeline,
+            preprocessing.c_str());
+    } else {
+        prepareData->pipelineDescription = g_strdup_printf(
+            "%s ! %s "
+            "tensor_filter name=tensorFilter framework=%s model=%s %s %s %s ! "
+            "appsink name=serverSink sync=false",
+            prePipeline,
+            preprocessing.c_str(), framework.c_str(), modelPath, accel.c_str(), inputProps.c_str(), outputProps.c_str());
+    }
     g_free(prePipeline);
     prePipeline = nullptr;
     if (prepareData->pipelineDescription == nullptr) {
@@ -812,6 +2067,19 @@ int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
         return -ENOMEM;
     }
 
+    if (threadCtx.commandSource == nullptr) {
+        // NOTE:
+        // The clients of the same model are run on the same worker
+        ret = Attach(batcherKey.empty() == false ? batcherKey : std::string(modelPath));
+        if (ret < 0) {
+            g_free(prepareData->pipelineDescription);
+            prepareData->pipelineDescription = nullptr;
+            delete prepareData;
+            prepareData = nullptr;
+            return ret;
+        }
+    }
+
     ret = command->Send(Command::IdPrepare, static_cast<void *>(prepareData));
     if (ret < 0) {
         g_free(prepareData->pipelineDescription);
@@ -834,15 +2102,36 @@ int Peer::GrpcServer::Gst::Prepare(int &reqPort, int &resPort)
     reqPort = prepareData->port.request;
     resPort = prepareData->port.response;
     ret = prepareData->port.status;
+    // NOTE:
+    // The local channel is updated on the gst thread before the response of the command
+    localChannel = this->localChannel;
 
     delete prepareData;
     prepareData = nullptr;
 
+    if (ret == 0) {
+        MUTEX_LOCK(&channelLock);
+        modelDigest = digest;
+        MUTEX_UNLOCK(&channelLock);
+    }
+
     return ret;
 }
 
+void Peer::GrpcServer::Gst::GetLoad(size_t &queueDepth, std::string &digest)
+{
+    MUTEX_LOCK(&channelLock);
+    queueDepth = pendingIds.size();
+    digest = modelDigest;
+    MUTEX_UNLOCK(&channelLock);
+}
+
 int Peer::GrpcServer::Gst::Stop(void)
 {
+    MUTEX_LOCK(&channelLock);
+    modelDigest.clear();
+    MUTEX_UNLOCK(&channelLock);
+
     return command->Send(Command::IdStop);
 }
 
@@ -855,87 +2144,57 @@ Peer::GrpcServer::Gst::Gst(void)
     : grpc(nullptr)
     , framework("tensorflow-lite")
     , threadCtx{
-        .loop = nullptr,
+        .context = nullptr,
+        .commandSource = nullptr,
+        .busSource = nullptr,
+        .recvSource = nullptr,
         .pipeline = nullptr,
         .bus = nullptr,
         .cmdTable = {
-            Peer::GrpcServer::Gst::Thread::CommandHandlerReady,
             Peer::GrpcServer::Gst::Thread::CommandHandlerPrepare,
             Peer::GrpcServer::Gst::Thread::CommandHandlerStop,
             Peer::GrpcServer::Gst::Thread::CommandHandlerExit,
         },
     }
+    , batcher(nullptr)
+    , batchSink(nullptr)
+    , listenFd(-1)
+    , localFd(-1)
+    , listenSource(nullptr)
+    , localSource(nullptr)
+    , handshakeSource(nullptr)
+    , handshakeChannel(nullptr)
+    , channelPort(-1)
+    , channel(nullptr)
+    , incoming{}
+    , serverSource(nullptr)
+    , serverSourceCaps(false)
+    , channelLock(PTHREAD_MUTEX_INITIALIZER)
+    , pendingCond(PTHREAD_COND_INITIALIZER)
+    , stream(nullptr)
+    , nextRequestId(0)
+    , rtpRequestId(GST_BUFFER_OFFSET_NONE)
+    , lastRtpRequestId(GST_BUFFER_OFFSET_NONE)
+    , trace(false)
 {
 }
 
 Peer::GrpcServer::Gst::~Gst(void)
 {
-}
-
-void *Peer::GrpcServer::Gst::Thread::Main(void *arg)
-{
-    Peer::GrpcServer::Gst *impls = static_cast<Peer::GrpcServer::Gst *>(arg);
-
-    GMainContext *ctx = g_main_context_new();
-    if (ctx == nullptr) {
-        ErrPrint("Failed to create a new context");
-        return nullptr;
-    }
-    g_main_context_push_thread_default(ctx);
-
-    impls->threadCtx.loop = g_main_loop_new(ctx, FALSE);
-    if (impls->threadCtx.loop == nullptr) {
-        ErrPrint("Failed to create a new main loop");
-        g_main_context_pop_thread_default(ctx);
-        g_main_context_unref(ctx);
-        ctx = nullptr;
-        return nullptr;
-    }
-
-    GSourceFuncs srcs = {
-        Peer::GrpcServer::Gst::Thread::CommandPrepare,
-        Peer::GrpcServer::Gst::Thread::CommandCheck,
-        Peer::GrpcServer::Gst::Thread::CommandHandle,
-        nullptr,
-    };
-
-    GSource *source = g_source_new(&srcs, sizeof(Thread::EventUserData));
-    Thread::EventUserData *ud = reinterpret_cast<Thread::EventUserData *>(source);
-    ud->impls = impls;
-    ud->fd.fd = impls->threadCtx.command->GetHandle();
-    ud->fd.events = G_IO_IN | G_IO_ERR;
-    g_source_add_poll(source, &ud->fd);
-    guint id = g_source_attach(source, ctx);
-    g_source_unref(source);
-    if (id == 0) {
-        g_main_context_pop_thread_default(ctx);
-        g_main_context_unref(ctx);
-        ctx = nullptr;
-        return nullptr;
+    int ret = pthread_cond_destroy(&pendingCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_destroy");
     }
 
-    if (impls->threadCtx.command->Send(Command::IdReady) < 0) {
-        g_source_destroy(source);
-        source = nullptr;
-
-        g_main_context_pop_thread_default(ctx);
-        g_main_context_unref(ctx);
-        ctx = nullptr;
-        return nullptr;
+    ret = pthread_mutex_destroy(&channelLock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
     }
+}
 
-    g_main_loop_run(impls->threadCtx.loop);
-
-    g_source_destroy(source);
-    source = nullptr;
-
-    g_main_loop_unref(impls->threadCtx.loop);
-    impls->threadCtx.loop = nullptr;
-
-    g_main_context_pop_thread_default(ctx);
-    g_main_context_unref(ctx);
-    ctx = nullptr;
-    return nullptr;
+void Peer::GrpcServer::Gst::SetTrace(bool enable)
+{
+    trace = enable;
 }
 
 void Peer::GrpcServer::Gst::SetNonce(unsigned long _nonce)
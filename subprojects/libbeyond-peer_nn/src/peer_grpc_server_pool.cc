@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "peer_grpc_server_pool.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+Peer::GrpcServer::Pool *Peer::GrpcServer::Pool::Create(int size)
+{
+    if (size <= 0) {
+        cpu_set_t cpuset;
+
+        CPU_ZERO(&cpuset);
+        if (sched_getaffinity(0, sizeof(cpuset), &cpuset) < 0) {
+            ErrPrintCode(errno, "sched_getaffinity");
+            size = 1;
+        } else {
+            size = CPU_COUNT(&cpuset);
+        }
+
+        if (size <= 0) {
+            size = 1;
+        }
+    }
+
+    Pool *pool;
+
+    try {
+        pool = new Pool();
+        pool->workers.resize(size);
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    for (Worker &worker : pool->workers) {
+        worker.pool = pool;
+        worker.context = nullptr;
+        worker.loop = nullptr;
+        worker.count = 0;
+        worker.started = false;
+    }
+
+    for (Worker &worker : pool->workers) {
+        worker.context = g_main_context_new();
+        if (worker.context == nullptr) {
+            ErrPrint("Failed to create a new context");
+            pool->Destroy();
+            return nullptr;
+        }
+
+        worker.loop = g_main_loop_new(worker.context, FALSE);
+        if (worker.loop == nullptr) {
+            ErrPrint("Failed to create a new main loop");
+            pool->Destroy();
+            return nullptr;
+        }
+
+        int status = pthread_create(&worker.threadId, nullptr, Main, static_cast<void *>(&worker));
+        if (status != 0) {
+            ErrPrintCode(status, "pthread_create");
+            pool->Destroy();
+            return nullptr;
+        }
+        worker.started = true;
+    }
+
+    DbgPrint("%d workers are created", size);
+    return pool;
+}
+
+void Peer::GrpcServer::Pool::Destroy(void)
+{
+    for (Worker &worker : workers) {
+        if (worker.started == true) {
+            // NOTE:
+            // Quit the loop on its own thread, the loop might not be running yet
+            g_main_context_invoke_full(worker.context, G_PRIORITY_DEFAULT, QuitHandler, static_cast<gpointer>(worker.loop), nullptr);
+
+            void *retval;
+            int status = pthread_join(worker.threadId, &retval);
+            if (status != 0) {
+                ErrPrintCode(status, "pthread_join");
+            }
+            worker.started = false;
+        }
+
+        if (worker.count > 0) {
+            ErrPrint("Worker still has %d clients", worker.count);
+        }
+
+        if (worker.loop != nullptr) {
+            g_main_loop_unref(worker.loop);
+            worker.loop = nullptr;
+        }
+
+        if (worker.context != nullptr) {
+            g_main_context_unref(worker.context);
+            worker.context = nullptr;
+        }
+    }
+
+    delete this;
+}
+
+GMainContext *Peer::GrpcServer::Pool::Acquire(const std::string &key)
+{
+    MUTEX_LOCK(&lock);
+    size_t least = 0;
+    for (size_t i = 1; i < workers.size(); i++) {
+        if (workers[i].count < workers[least].count) {
+            least = i;
+        }
+    }
+
+    size_t selected = least;
+    if (key.empty() == false) {
+        auto it = affinityMap.find(key);
+        if (it == affinityMap.end()) {
+            affinityMap[key] = Affinity{
+                .worker = static_cast<int>(least),
+                .refcount = 1,
+            };
+        } else {
+            // NOTE:
+            // Keep the affinity unless the worker of the model is overloaded
+            const Worker &affine = workers[it->second.worker];
+            if (affine.count <= workers[least].count * AFFINITY_LOAD_FACTOR + 1) {
+                selected = it->second.worker;
+            }
+            it->second.refcount++;
+        }
+    }
+
+    workers[selected].count++;
+    GMainContext *context = workers[selected].context;
+    DbgPrint("Worker %zu is selected (%d clients)", selected, workers[selected].count);
+    MUTEX_UNLOCK(&lock);
+
+    return context;
+}
+
+void Peer::GrpcServer::Pool::Release(GMainContext *context, const std::string &key)
+{
+    MUTEX_LOCK(&lock);
+    for (Worker &worker : workers) {
+        if (worker.context == context) {
+            worker.count--;
+            break;
+        }
+    }
+
+    if (key.empty() == false) {
+        auto it = affinityMap.find(key);
+        if (it != affinityMap.end() && --it->second.refcount <= 0) {
+            affinityMap.erase(it);
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+}
+
+gboolean Peer::GrpcServer::Pool::QuitHandler(gpointer user_data)
+{
+    g_main_loop_quit(static_cast<GMainLoop *>(user_data));
+    return G_SOURCE_REMOVE;
+}
+
+void *Peer::GrpcServer::Pool::Main(void *arg)
+{
+    Worker *worker = static_cast<Worker *>(arg);
+
+    g_main_context_push_thread_default(worker->context);
+    g_main_loop_run(worker->loop);
+    g_main_context_pop_thread_default(worker->context);
+    return nullptr;
+}
+
+Peer::GrpcServer::Pool::Pool(void)
+{
+    int status = pthread_mutex_init(&lock, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_init");
+    }
+}
+
+Peer::GrpcServer::Pool::~Pool(void)
+{
+    int status = pthread_mutex_destroy(&lock);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_destroy");
+    }
+}
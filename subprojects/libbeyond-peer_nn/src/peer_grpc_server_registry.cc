@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "peer_grpc_server_registry.h"
+#include "peer_grpc_server_batcher.h"
+#include "peer_model.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <exception>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+Peer::GrpcServer::Registry *Peer::GrpcServer::Registry::Create(size_t budget)
+{
+    Registry *registry;
+
+    try {
+        registry = new Registry();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    registry->budget = budget;
+    return registry;
+}
+
+void Peer::GrpcServer::Registry::Destroy(void)
+{
+    for (auto &it : entries) {
+        if (it.second.refcount > 0) {
+            ErrPrint("Model is still referenced: %s (%d)", it.first.c_str(), it.second.refcount);
+        }
+        if (it.second.batcher != nullptr) {
+            it.second.batcher->Destroy();
+        }
+    }
+    entries.clear();
+    idleList.clear();
+
+    delete this;
+}
+
+int Peer::GrpcServer::Registry::GetDigest(const char *modelPath, std::string &digest, size_t &size)
+{
+    struct stat st;
+
+    if (stat(modelPath, &st) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "stat: %s", modelPath);
+        return ret;
+    }
+
+    MUTEX_LOCK(&lock);
+    auto it = digestMap.find(modelPath);
+    if (it != digestMap.end() &&
+        it->second.size == st.st_size &&
+        it->second.mtime.tv_sec == st.st_mtim.tv_sec &&
+        it->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        digest = it->second.digest;
+        size = st.st_size;
+        MUTEX_UNLOCK(&lock);
+        return 0;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    // NOTE:
+    // Hashing a large model takes time, do not block the others
+    std::string _digest;
+    int ret = Peer::Model::ComputeDigest(modelPath, _digest);
+    if (ret < 0) {
+        return ret;
+    }
+
+    MUTEX_LOCK(&lock);
+    digestMap[modelPath] = Digest{
+        .size = st.st_size,
+        .mtime = st.st_mtim,
+        .digest = _digest,
+    };
+    MUTEX_UNLOCK(&lock);
+
+    digest = _digest;
+    size = st.st_size;
+    return 0;
+}
+
+void Peer::GrpcServer::Registry::PutDigest(const char *modelPath, const std::string &digest)
+{
+    struct stat st;
+
+    if (stat(modelPath, &st) < 0) {
+        ErrPrintCode(errno, "stat: %s", modelPath);
+        return;
+    }
+
+    MUTEX_LOCK(&lock);
+    digestMap[modelPath] = Digest{
+        .size = st.st_size,
+        .mtime = st.st_mtim,
+        .digest = digest,
+    };
+    MUTEX_UNLOCK(&lock);
+}
+
+std::string Peer::GrpcServer::Registry::MakeKey(const std::string &digest, const std::string &framework, const std::string &accel,
+                                                const std::string &inputProps, const std::string &outputProps)
+{
+    return digest + std::string("|") + framework + std::string("|") + accel + inputProps + outputProps;
+}
+
+// NOTE:
+// Unregister the idle models in the least recently used order until the required size fits to the budget.
+// The models which are used by the clients are never unloaded, the usage could exceed the budget in that case.
+// Must be called with the lock, the victims are destroyed by the caller after releasing the lock.
+void Peer::GrpcServer::Registry::Evict(size_t required, std::list<Peer::GrpcServer::Batcher *> &victims)
+{
+    while (usage + required > budget && idleList.empty() == false) {
+        std::string key = idleList.front();
+        idleList.pop_front();
+
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            assert(!"Idle model is not registered");
+            continue;
+        }
+
+        DbgPrint("Unload the model: %s (%zu bytes)", key.c_str(), it->second.size);
+        usage -= it->second.size;
+        victims.push_back(it->second.batcher);
+        entries.erase(it);
+    }
+
+    if (usage + required > budget) {
+        DbgPrint("Loaded models exceed the budget: %zu + %zu > %zu", usage, required, budget);
+    }
+}
+
+Peer::GrpcServer::Batcher *Peer::GrpcServer::Registry::Acquire(const std::string &key, size_t size,
+                                                               const char *framework, const char *model, const char *accel,
+                                                               const beyond_tensor_info *inputInfo, int inputSize,
+                                                               const beyond_tensor_info *outputInfo, int outputSize,
+                                                               int batchSize, int timeout)
+{
+    Peer::GrpcServer::Batcher *batcher = nullptr;
+    std::list<Peer::GrpcServer::Batcher *> victims;
+
+    MUTEX_LOCK(&lock);
+    auto it = entries.find(key);
+    while (it != entries.end()) {
+        if (it->second.batcher == nullptr) {
+            // NOTE:
+            // Another client is loading the model, wait for it.
+            // The entry is dropped if it is failed to load, then try to load it again.
+            int ret = pthread_cond_wait(&loadCond, &lock);
+            if (ret != 0) {
+                ErrPrintCode(ret, "pthread_cond_wait");
+            }
+            it = entries.find(key);
+            continue;
+        }
+
+        if (it->second.refcount == 0) {
+            idleList.erase(it->second.idle);
+        }
+        it->second.refcount++;
+        batcher = it->second.batcher;
+        MUTEX_UNLOCK(&lock);
+        return batcher;
+    }
+
+    Evict(size, victims);
+
+    try {
+        entries[key] = Entry{
+            .batcher = nullptr,
+            .refcount = 1,
+            .size = size,
+            .idle = idleList.end(),
+        };
+    } catch (std::exception &e) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("new failed: %s", e.what());
+        for (Peer::GrpcServer::Batcher *victim : victims) {
+            victim->Destroy();
+        }
+        return nullptr;
+    }
+    usage += size;
+    MUTEX_UNLOCK(&lock);
+
+    for (Peer::GrpcServer::Batcher *victim : victims) {
+        victim->Destroy();
+    }
+
+    batcher = Peer::GrpcServer::Batcher::Create(framework, model, accel,
+                                                inputInfo, inputSize,
+                                                outputInfo, outputSize,
+                                                batchSize, timeout);
+
+    MUTEX_LOCK(&lock);
+    it = entries.find(key);
+    if (it == entries.end()) {
+        assert(!"Reserved model is not registered");
+    } else if (batcher == nullptr) {
+        usage -= it->second.size;
+        entries.erase(it);
+    } else {
+        it->second.batcher = batcher;
+    }
+    pthread_cond_broadcast(&loadCond);
+    MUTEX_UNLOCK(&lock);
+
+    return batcher;
+}
+
+void Peer::GrpcServer::Registry::Release(const std::string &key)
+{
+    std::list<Peer::GrpcServer::Batcher *> victims;
+
+    MUTEX_LOCK(&lock);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("Model is not registered: %s", key.c_str());
+        return;
+    }
+
+    it->second.refcount--;
+    if (it->second.refcount == 0) {
+        // NOTE:
+        // Keep the model loaded for the next client, it is unloaded if the budget is exceeded
+        it->second.idle = idleList.insert(idleList.end(), key);
+        Evict(0, victims);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    for (Peer::GrpcServer::Batcher *victim : victims) {
+        victim->Destroy();
+    }
+}
+
+void Peer::GrpcServer::Registry::GetDigests(std::set<std::string> &digests)
+{
+    MUTEX_LOCK(&lock);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->second.batcher == nullptr) {
+            continue;
+        }
+
+        // NOTE:
+        // The key begins with the digest of the model, the rest is the framework and its properties
+        digests.insert(it->first.substr(0, it->first.find('|')));
+    }
+    MUTEX_UNLOCK(&lock);
+}
+
+Peer::GrpcServer::Registry::Registry(void)
+    : budget(0)
+    , usage(0)
+{
+    int status = pthread_mutex_init(&lock, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_init");
+    }
+
+    status = pthread_cond_init(&loadCond, nullptr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_init");
+    }
+}
+
+Peer::GrpcServer::Registry::~Registry(void)
+{
+    int status = pthread_cond_destroy(&loadCond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_destroy");
+    }
+
+    status = pthread_mutex_destroy(&lock);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_mutex_destroy");
+    }
+}
@@ -20,6 +20,9 @@
 #include <cerrno>
 
 #include <memory>
+#include <string>
+
+#include <glib.h>
 
 #include <beyond/platform/beyond_platform.h>
 #include <beyond/private/beyond_private.h>
@@ -156,3 +159,50 @@ int Peer::Model::DupTensorInfo(beyond_tensor_info *&dest, const beyond_tensor_in
     dest = _dest;
     return 0;
 }
+
+int Peer::Model::ComputeDigest(const char *modelPath, std::string &digest)
+{
+    FILE *fp = fopen(modelPath, "rb");
+    if (fp == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "fopen: %s", modelPath);
+        return ret;
+    }
+
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    if (checksum == nullptr) {
+        ErrPrint("Failed to create a checksum");
+        fclose(fp);
+        return -EFAULT;
+    }
+
+    guchar *buffer = static_cast<guchar *>(malloc(CHUNK_SIZE));
+    if (buffer == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "malloc");
+        g_checksum_free(checksum);
+        fclose(fp);
+        return ret;
+    }
+
+    int ret = 0;
+    size_t sz;
+    while ((sz = fread(buffer, 1, CHUNK_SIZE, fp)) > 0) {
+        g_checksum_update(checksum, buffer, sz);
+    }
+
+    if (ferror(fp) != 0) {
+        ErrPrint("Failed to read the model: %s", modelPath);
+        ret = -EIO;
+    } else {
+        digest = std::string(g_checksum_get_string(checksum));
+    }
+
+    free(buffer);
+    g_checksum_free(checksum);
+    if (fclose(fp) < 0) {
+        ErrPrintCode(errno, "fclose");
+    }
+
+    return ret;
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "peer_result_pool.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+
+#include <exception>
+
+#include <pthread.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+Peer::ResultPool *Peer::ResultPool::Create(int capacity)
+{
+    Peer::ResultPool *impls;
+
+    try {
+        impls = new Peer::ResultPool();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    impls->capacity = capacity > 0 ? capacity : 0;
+    return impls;
+}
+
+void Peer::ResultPool::Destroy(void)
+{
+    MUTEX_LOCK(&lock);
+    capacity = 0;
+    Trim();
+
+    if (results.empty() == false) {
+        // NOTE:
+        // The caller still has them, they cannot be released without the caller.
+        ErrPrint("%zu results are not released", results.size());
+    }
+    MUTEX_UNLOCK(&lock);
+
+    DbgPrint("Result blocks: %llu allocated, %llu reused", countOfAllocated, countOfReused);
+    delete this;
+}
+
+void Peer::ResultPool::SetCapacity(int capacity)
+{
+    MUTEX_LOCK(&lock);
+    this->capacity = capacity > 0 ? capacity : 0;
+    Trim();
+    MUTEX_UNLOCK(&lock);
+}
+
+size_t Peer::ResultPool::Align(size_t size)
+{
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// NOTE:
+// Must be called with the lock
+void Peer::ResultPool::Trim(void)
+{
+    while (blocks.size() > static_cast<size_t>(capacity)) {
+        // NOTE:
+        // The larger blocks can take more results, the smallest one is released first
+        auto it = blocks.begin();
+        free(it->second);
+        blocks.erase(it);
+    }
+}
+
+// NOTE:
+// The block is laid out as the tensor array and the buffers of the tensors in order,
+// each of them is aligned to the ALIGNMENT.
+int Peer::ResultPool::Allocate(const uint64_t *sizes, int count, beyond_tensor *&tensor)
+{
+    if (sizes == nullptr || count <= 0) {
+        return -EINVAL;
+    }
+
+    size_t required = Align(sizeof(beyond_tensor) * count);
+    for (int i = 0; i < count; i++) {
+        required += Align(sizes[i]);
+    }
+
+    void *block = nullptr;
+    size_t blockSize = required;
+    bool reused = false;
+
+    MUTEX_LOCK(&lock);
+    auto it = blocks.lower_bound(required);
+    // NOTE:
+    // Do not waste a block which is much larger than the required size
+    if (it != blocks.end() && it->first / 2 <= required) {
+        block = it->second;
+        blockSize = it->first;
+        blocks.erase(it);
+        reused = true;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (block == nullptr) {
+        int ret = posix_memalign(&block, ALIGNMENT, blockSize);
+        if (ret != 0) {
+            ErrPrintCode(ret, "posix_memalign");
+            return -ret;
+        }
+    }
+
+    beyond_tensor *_tensor = static_cast<beyond_tensor *>(block);
+    uint8_t *data = static_cast<uint8_t *>(block) + Align(sizeof(beyond_tensor) * count);
+    for (int i = 0; i < count; i++) {
+        _tensor[i].type = BEYOND_TENSOR_TYPE_UNSUPPORTED;
+        _tensor[i].size = static_cast<int>(sizes[i]);
+        _tensor[i].data = data;
+        data += Align(sizes[i]);
+    }
+
+    MUTEX_LOCK(&lock);
+    try {
+        results[_tensor] = Entry{ blockSize, nullptr, nullptr };
+    } catch (std::exception &e) {
+        ErrPrint("results: %s", e.what());
+        MUTEX_UNLOCK(&lock);
+        free(block);
+        return -ENOMEM;
+    }
+    if (reused == true) {
+        countOfReused++;
+    } else {
+        countOfAllocated++;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    tensor = _tensor;
+    return 0;
+}
+
+int Peer::ResultPool::Wrap(int count, ReleaseHandler release, void *data, beyond_tensor *&tensor)
+{
+    if (count <= 0 || release == nullptr) {
+        return -EINVAL;
+    }
+
+    beyond_tensor *_tensor = static_cast<beyond_tensor *>(calloc(count, sizeof(beyond_tensor)));
+    if (_tensor == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "calloc");
+        return ret;
+    }
+
+    MUTEX_LOCK(&lock);
+    try {
+        results[_tensor] = Entry{ 0, release, data };
+    } catch (std::exception &e) {
+        ErrPrint("results: %s", e.what());
+        MUTEX_UNLOCK(&lock);
+        free(_tensor);
+        return -ENOMEM;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    tensor = _tensor;
+    return 0;
+}
+
+int Peer::ResultPool::Release(beyond_tensor *tensor)
+{
+    if (tensor == nullptr) {
+        return -EINVAL;
+    }
+
+    MUTEX_LOCK(&lock);
+    auto it = results.find(tensor);
+    if (it == results.end()) {
+        MUTEX_UNLOCK(&lock);
+        return -ENOENT;
+    }
+
+    Entry entry = it->second;
+    results.erase(it);
+
+    if (entry.capacity > 0 && blocks.size() < static_cast<size_t>(capacity)) {
+        try {
+            blocks.emplace(entry.capacity, static_cast<void *>(tensor));
+            tensor = nullptr;
+        } catch (std::exception &e) {
+            ErrPrint("blocks: %s", e.what());
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (entry.release != nullptr) {
+        entry.release(entry.data);
+    }
+
+    // NOTE:
+    // The tensor array of a view, or the block which is not kept
+    free(tensor);
+    return 0;
+}
+
+Peer::ResultPool::ResultPool(void)
+    : lock(PTHREAD_MUTEX_INITIALIZER)
+    , capacity(0)
+    , countOfReused(0)
+    , countOfAllocated(0)
+{
+}
+
+Peer::ResultPool::~ResultPool(void)
+{
+    int ret = pthread_mutex_destroy(&lock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
+}
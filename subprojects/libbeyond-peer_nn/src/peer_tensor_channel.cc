@@ -0,0 +1,1912 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "peer_tensor_channel.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <new>
+#include <random>
+#include <string>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+// NOTE:
+// The control block of the local channel, it is placed at the beginning of the shared memory,
+// the rings follow it. The head and the tail are the accumulated positions of the byte stream.
+struct Peer::TensorChannel::Shared {
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head; // advanced by the producer
+        std::atomic<uint32_t> readerWaiting;
+        alignas(64) std::atomic<uint64_t> tail; // advanced by the consumer
+        std::atomic<uint32_t> writerWaiting;
+    };
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t ringSize;
+    Ring ring[RingLast];
+
+    static_assert((LOCAL_RING_SIZE & (LOCAL_RING_SIZE - 1)) == 0, "Ring size must be a power of 2");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free == true, "Shared atomics must be lock free");
+};
+
+Peer::TensorChannel *Peer::TensorChannel::Create(int fd)
+{
+    if (fd < 0) {
+        ErrPrint("Invalid fd");
+        return nullptr;
+    }
+
+    TensorChannel *channel;
+
+    try {
+        channel = new TensorChannel();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    channel->fd = fd;
+    return channel;
+}
+
+void Peer::TensorChannel::Destroy(void)
+{
+    delete this;
+}
+
+int Peer::TensorChannel::SetNoDelay(int fd)
+{
+    // NOTE:
+    // A frame is written by a single sendmsg(), do not wait for the next one.
+    int flag = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "setsockopt");
+        return ret;
+    }
+
+    return 0;
+}
+
+bool Peer::TensorChannel::HasIPv6(void)
+{
+    int fd = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (close(fd) < 0) {
+        ErrPrintCode(errno, "close");
+    }
+
+    return true;
+}
+
+const char *Peer::TensorChannel::GetAnyAddress(void)
+{
+    return HasIPv6() == true ? "::" : "0.0.0.0";
+}
+
+// NOTE:
+// The socket is dual-stack (IPV6_V6ONLY is off), the IPv4 clients are accepted by their mapped address.
+// It falls back to IPv4 if the host does not support IPv6.
+int Peer::TensorChannel::Listen(int &fd, int &port)
+{
+    int family = AF_INET6;
+    int _fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_fd < 0 && (errno == EAFNOSUPPORT || errno == EPROTONOSUPPORT)) {
+        family = AF_INET;
+        _fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+
+    if (_fd < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "socket");
+        return ret;
+    }
+
+    int flag = 1;
+    if (setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag)) < 0) {
+        ErrPrintCode(errno, "setsockopt");
+    }
+
+    struct sockaddr_storage addr;
+    socklen_t len;
+    memset(&addr, 0, sizeof(addr));
+    if (family == AF_INET6) {
+        int v6only = 0;
+        if (setsockopt(_fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) < 0) {
+            ErrPrintCode(errno, "setsockopt");
+        }
+
+        struct sockaddr_in6 *addr6 = reinterpret_cast<struct sockaddr_in6 *>(&addr);
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_addr = in6addr_any;
+        addr6->sin6_port = 0;
+        len = sizeof(struct sockaddr_in6);
+    } else {
+        struct sockaddr_in *addr4 = reinterpret_cast<struct sockaddr_in *>(&addr);
+        addr4->sin_family = AF_INET;
+        addr4->sin_addr.s_addr = htonl(INADDR_ANY);
+        addr4->sin_port = 0;
+        len = sizeof(struct sockaddr_in);
+    }
+
+    if (bind(_fd, reinterpret_cast<struct sockaddr *>(&addr), len) < 0 ||
+        listen(_fd, 1) < 0 ||
+        getsockname(_fd, reinterpret_cast<struct sockaddr *>(&addr), &len) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "bind/listen/getsockname");
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return ret;
+    }
+
+    fd = _fd;
+    if (family == AF_INET6) {
+        port = ntohs(reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_port);
+    } else {
+        port = ntohs(reinterpret_cast<struct sockaddr_in *>(&addr)->sin_port);
+    }
+    return 0;
+}
+
+int Peer::TensorChannel::Accept(int listenFd, int &fd)
+{
+    int _fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (_fd < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "accept4");
+        return ret;
+    }
+
+    (void)SetNoDelay(_fd);
+    fd = _fd;
+    return 0;
+}
+
+int Peer::TensorChannel::Connect(const char *host, int port, int &fd)
+{
+    struct addrinfo hints;
+    struct addrinfo *result = nullptr;
+
+    if (host == nullptr) {
+        ErrPrint("Invalid host");
+        return -EINVAL;
+    }
+
+    // NOTE:
+    // The host could be an IPv6 address with its scope (e.g. "fe80::1%eth0"), or in the brackets of the URL form
+    std::string _host = host;
+    if (_host.size() > 2 && _host.front() == '[' && _host.back() == ']') {
+        _host = _host.substr(1, _host.size() - 2);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    std::string service = std::to_string(port);
+    int status = getaddrinfo(_host.c_str(), service.c_str(), &hints, &result);
+    if (status != 0) {
+        ErrPrint("getaddrinfo: %s", gai_strerror(status));
+        return -EHOSTUNREACH;
+    }
+
+    int ret = -ECONNREFUSED;
+    for (struct addrinfo *ai = result; ai != nullptr; ai = ai->ai_next) {
+        int _fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (_fd < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "socket");
+            continue;
+        }
+
+        if (connect(_fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            ret = -errno;
+            ErrPrintCode(errno, "connect");
+            if (close(_fd) < 0) {
+                ErrPrintCode(errno, "close");
+            }
+            continue;
+        }
+
+        (void)SetNoDelay(_fd);
+        fd = _fd;
+        ret = 0;
+        break;
+    }
+
+    freeaddrinfo(result);
+    return ret;
+}
+
+int Peer::TensorChannel::SetLocalAddress(struct sockaddr_un &addr, const char *name, socklen_t &len)
+{
+    size_t nameLen = strlen(name);
+    if (nameLen == 0 || nameLen >= sizeof(addr.sun_path) - 1) {
+        ErrPrint("Invalid name of the local channel");
+        return -EINVAL;
+    }
+
+    // NOTE:
+    // Abstract namespace, the leading null byte is followed by the name
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path + 1, name, nameLen);
+    len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + nameLen);
+    return 0;
+}
+
+int Peer::TensorChannel::ListenLocal(int &fd, std::string &name)
+{
+    char _name[64];
+
+    try {
+        std::random_device rd;
+        // NOTE:
+        // The random part prevents a remote server which has the same pid from being taken as a local one
+        snprintf(_name, sizeof(_name), "beyond-peer_nn-%d-%.8x%.8x", getpid(), rd(), rd());
+    } catch (std::exception &e) {
+        ErrPrint("random_device: %s", e.what());
+        return -EFAULT;
+    }
+
+    struct sockaddr_un addr;
+    socklen_t len;
+    int ret = SetLocalAddress(addr, _name, len);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int _fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (_fd < 0) {
+        ret = -errno;
+        ErrPrintCode(errno, "socket");
+        return ret;
+    }
+
+    if (bind(_fd, reinterpret_cast<struct sockaddr *>(&addr), len) < 0 || listen(_fd, 1) < 0) {
+        ret = -errno;
+        ErrPrintCode(errno, "bind/listen");
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return ret;
+    }
+
+    fd = _fd;
+    name = _name;
+    return 0;
+}
+
+// NOTE:
+// The peer must be the same user, the shared memory and the eventfds are trusted once they are mapped.
+// The channel is returned before the handshake, the caller completes it by the TryHandshake()
+// when the handle gets readable, so a peer which does not send the handshake does not block the caller.
+Peer::TensorChannel *Peer::TensorChannel::AcceptLocal(int listenFd)
+{
+    int _fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (_fd < 0) {
+        ErrPrintCode(errno, "accept4");
+        return nullptr;
+    }
+
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(_fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 || len != sizeof(cred)) {
+        ErrPrintCode(errno, "getsockopt");
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    if (cred.uid != getuid()) {
+        ErrPrint("Local channel is refused: pid(%d) uid(%u)", cred.pid, cred.uid);
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    TensorChannel *channel;
+
+    try {
+        channel = new TensorChannel();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    channel->fd = _fd;
+    channel->handshaking = true;
+    return channel;
+}
+
+// NOTE:
+// The client sends the memfd and the eventfds with the magic,
+// and the server replies the status after mapping the shared memory.
+// The handshake is a single packet of the SOCK_SEQPACKET, it is received at once or not at all.
+int Peer::TensorChannel::TryHandshake(void)
+{
+    if (handshaking == false) {
+        ErrPrint("Handshake is done already");
+        return -EALREADY;
+    }
+
+    uint32_t magic = 0;
+    struct iovec iov = {
+        .iov_base = &magic,
+        .iov_len = sizeof(magic),
+    };
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * (EventLast + 1))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    ssize_t sz;
+    do {
+        sz = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    } while (sz < 0 && errno == EINTR);
+
+    if (sz < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return -EAGAIN;
+        }
+
+        int ret = -errno;
+        ErrPrintCode(errno, "recvmsg");
+        return ret;
+    } else if (sz == 0) {
+        DbgPrint("Channel is closed");
+        return -ECONNRESET;
+    }
+
+    int fds[EventLast + 1];
+    int count = 0;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            count = static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * std::min(count, EventLast + 1));
+            break;
+        }
+    }
+
+    int memFd = -1;
+    int ret = -EPROTO;
+    if (sz != static_cast<ssize_t>(sizeof(magic)) || magic != MAGIC || count != EventLast + 1 ||
+        (msg.msg_flags & MSG_CTRUNC) == MSG_CTRUNC) {
+        ErrPrint("Invalid handshake: size(%zd) magic(0x%.8X) fds(%d)", sz, magic, count);
+    } else {
+        memFd = fds[0];
+        int seals = fcntl(memFd, F_GET_SEALS);
+        struct stat st;
+        // NOTE:
+        // The shared memory must not be shrunk by the client while it is mapped
+        if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_SEAL)) != (F_SEAL_SHRINK | F_SEAL_SEAL)) {
+            ErrPrint("Shared memory is not sealed");
+        } else if (fstat(memFd, &st) < 0 || static_cast<uint64_t>(st.st_size) != LOCAL_HEADER_SIZE + LOCAL_RING_SIZE * RingLast) {
+            ErrPrint("Invalid size of the shared memory");
+        } else {
+            ret = 0;
+        }
+    }
+
+    if (ret < 0) {
+        for (int i = 0; i < std::min(count, EventLast + 1); i++) {
+            if (close(fds[i]) < 0) {
+                ErrPrintCode(errno, "close");
+            }
+        }
+        return ret;
+    }
+
+    ret = InitLocal(memFd, fds + 1, true);
+    if (close(memFd) < 0) {
+        ErrPrintCode(errno, "close");
+    }
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    int32_t status = 0;
+    do {
+        sz = send(fd, &status, sizeof(status), MSG_NOSIGNAL);
+    } while (sz < 0 && errno == EINTR);
+
+    if (sz != static_cast<ssize_t>(sizeof(status))) {
+        ret = sz < 0 ? -errno : -EPROTO;
+        ErrPrintCode(errno, "send");
+        return ret;
+    }
+
+    handshaking = false;
+    DbgPrint("Local channel is accepted");
+    return 0;
+}
+
+Peer::TensorChannel *Peer::TensorChannel::ConnectLocal(const char *name)
+{
+    struct sockaddr_un addr;
+    socklen_t len;
+    if (name == nullptr || SetLocalAddress(addr, name, len) < 0) {
+        return nullptr;
+    }
+
+    int _fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (_fd < 0) {
+        ErrPrintCode(errno, "socket");
+        return nullptr;
+    }
+
+    if (connect(_fd, reinterpret_cast<struct sockaddr *>(&addr), len) < 0) {
+        // NOTE:
+        // The server is not on this host
+        DbgPrint("Local channel is not reachable: %s (%d)", name, errno);
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    int memFd = memfd_create("beyond-peer_nn", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memFd < 0) {
+        ErrPrintCode(errno, "memfd_create");
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    if (ftruncate(memFd, LOCAL_HEADER_SIZE + LOCAL_RING_SIZE * RingLast) < 0 ||
+        fcntl(memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        ErrPrintCode(errno, "ftruncate/fcntl");
+        if (close(memFd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    int fds[EventLast + 1];
+    int i;
+
+    fds[0] = memFd;
+    for (i = 0; i < EventLast; i++) {
+        fds[i + 1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (fds[i + 1] < 0) {
+            ErrPrintCode(errno, "eventfd");
+            break;
+        }
+    }
+
+    if (i < EventLast) {
+        for (int j = 0; j <= i; j++) {
+            if (fds[j] >= 0 && close(fds[j]) < 0) {
+                ErrPrintCode(errno, "close");
+            }
+        }
+        if (close(_fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    // NOTE:
+    // The channel takes the socket and the eventfds, the memfd is closed after sending it
+    TensorChannel *channel = CreateLocal(_fd, memFd, fds + 1, false);
+    if (channel == nullptr) {
+        if (close(memFd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        return nullptr;
+    }
+
+    uint32_t magic = MAGIC;
+    struct iovec iov = {
+        .iov_base = &magic,
+        .iov_len = sizeof(magic),
+    };
+    union {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+
+    memset(&control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t sz;
+    do {
+        sz = sendmsg(channel->fd, &msg, MSG_NOSIGNAL);
+    } while (sz < 0 && errno == EINTR);
+
+    if (close(memFd) < 0) {
+        ErrPrintCode(errno, "close");
+    }
+
+    if (sz != static_cast<ssize_t>(sizeof(magic))) {
+        ErrPrintCode(errno, "sendmsg");
+        channel->Destroy();
+        return nullptr;
+    }
+
+    struct pollfd pfd = {
+        .fd = channel->fd,
+        .events = POLLIN,
+        .revents = 0,
+    };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, LOCAL_HANDSHAKE_TIMEOUT);
+    } while (ret < 0 && errno == EINTR);
+
+    int32_t status = -ETIMEDOUT;
+    if (ret > 0) {
+        sz = recv(channel->fd, &status, sizeof(status), MSG_DONTWAIT);
+        if (sz != static_cast<ssize_t>(sizeof(status))) {
+            status = -ECONNRESET;
+        }
+    }
+
+    if (status < 0) {
+        ErrPrint("Local channel is refused: %d", status);
+        channel->Destroy();
+        return nullptr;
+    }
+
+    DbgPrint("Local channel is connected: %s", name);
+    return channel;
+}
+
+// NOTE:
+// The channel takes the ownership of the fd and the eventfds even if it fails,
+// the memFd is kept by the caller.
+Peer::TensorChannel *Peer::TensorChannel::CreateLocal(int fd, int memFd, const int *eventFd, bool server)
+{
+    TensorChannel *channel;
+
+    try {
+        channel = new TensorChannel();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        if (close(fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        for (int i = 0; i < EventLast; i++) {
+            if (close(eventFd[i]) < 0) {
+                ErrPrintCode(errno, "close");
+            }
+        }
+        return nullptr;
+    }
+
+    channel->fd = fd;
+    if (channel->InitLocal(memFd, eventFd, server) < 0) {
+        channel->Destroy();
+        return nullptr;
+    }
+
+    return channel;
+}
+
+// NOTE:
+// The channel takes the ownership of the eventfds even if it fails, they are released by the Destroy()
+int Peer::TensorChannel::InitLocal(int memFd, const int *_eventFd, bool server)
+{
+    for (int i = 0; i < EventLast; i++) {
+        eventFd[i] = _eventFd[i];
+    }
+
+    void *addr = mmap(nullptr, LOCAL_HEADER_SIZE + LOCAL_RING_SIZE * RingLast, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (addr == MAP_FAILED) {
+        int ret = -errno;
+        ErrPrintCode(errno, "mmap");
+        return ret;
+    }
+
+    if (server == true) {
+        shared = static_cast<Shared *>(addr);
+        if (shared->magic != MAGIC || shared->version != VERSION || shared->ringSize != LOCAL_RING_SIZE) {
+            ErrPrint("Invalid shared memory: magic(0x%.8X) version(%u)", shared->magic, shared->version);
+            return -EPROTO;
+        }
+        sendRing = RingResponse;
+        recvRing = RingRequest;
+    } else {
+        shared = new (addr) Shared();
+        shared->magic = MAGIC;
+        shared->version = VERSION;
+        shared->ringSize = LOCAL_RING_SIZE;
+        // NOTE:
+        // The consumers are waiting for the first frame
+        for (int i = 0; i < RingLast; i++) {
+            shared->ring[i].readerWaiting.store(1);
+        }
+        sendRing = RingRequest;
+        recvRing = RingResponse;
+    }
+
+    uint8_t *base = static_cast<uint8_t *>(addr) + LOCAL_HEADER_SIZE;
+    sendData = base + LOCAL_RING_SIZE * sendRing;
+    recvData = base + LOCAL_RING_SIZE * recvRing;
+
+    // NOTE:
+    // The handle gets readable when the data is given or the peer is closed (the UNIX socket gets EOF)
+    pollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (pollFd < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "epoll_create1");
+        return ret;
+    }
+
+    int handles[] = { eventFd[recvRing * 2 + EventData], fd };
+    for (int handle : handles) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = handle;
+        if (epoll_ctl(pollFd, EPOLL_CTL_ADD, handle, &ev) < 0) {
+            int ret = -errno;
+            ErrPrintCode(errno, "epoll_ctl");
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::SetLimit(const beyond_tensor_info *info, int size)
+{
+    if (info == nullptr || size <= 0 || size > MAX_TENSORS) {
+        ErrPrint("Invalid arguments");
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < MAX_TENSORS; i++) {
+        limitSize[i] = (i < size && info[i].size > 0) ? std::min(static_cast<uint64_t>(info[i].size), MAX_PAYLOAD) : MAX_PAYLOAD;
+    }
+
+    limitCount = size;
+    return 0;
+}
+
+int Peer::TensorChannel::CheckDescriptor(const Descriptor *desc, int count) const
+{
+    for (int i = 0; i < count; i++) {
+        if (desc[i].rank < 0 || desc[i].rank > MAX_RANK || desc[i].size > limitSize[i]) {
+            ErrPrint("Invalid descriptor[%d]: rank(%d) size(%llu), limit(%llu)", i, desc[i].rank,
+                     static_cast<unsigned long long>(desc[i].size), static_cast<unsigned long long>(limitSize[i]));
+            return -EPROTO;
+        }
+    }
+
+    return 0;
+}
+
+void Peer::TensorChannel::FillDescriptor(Descriptor &desc, beyond_tensor_type type, uint64_t size, const beyond_tensor_info *info)
+{
+    memset(&desc, 0, sizeof(desc));
+    desc.type = static_cast<int32_t>(type);
+    desc.size = size;
+
+    if (info != nullptr && info->dims != nullptr && info->dims->size > 0 && info->dims->size <= MAX_RANK) {
+        desc.rank = info->dims->size;
+        for (int i = 0; i < desc.rank; i++) {
+            desc.dims[i] = info->dims->data[i];
+        }
+    }
+}
+
+int Peer::TensorChannel::ValidateDescriptor(const Descriptor *desc, int count, const beyond_tensor_info *info, int size)
+{
+    if (desc == nullptr || info == nullptr) {
+        ErrPrint("Invalid arguments");
+        return -EPROTO;
+    }
+
+    if (count != size) {
+        ErrPrint("Count of tensors mismatched: %d != %d", count, size);
+        return -EPROTO;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (desc[i].type != static_cast<int32_t>(info[i].type) || desc[i].size != static_cast<uint64_t>(info[i].size)) {
+            ErrPrint("Tensor[%d] mismatched: type(%d != %d) size(%llu != %d)",
+                     i, desc[i].type, static_cast<int>(info[i].type),
+                     static_cast<unsigned long long>(desc[i].size), info[i].size);
+            return -EPROTO;
+        }
+
+        if (desc[i].rank == 0 || info[i].dims == nullptr) {
+            continue;
+        }
+
+        if (desc[i].rank != info[i].dims->size) {
+            ErrPrint("Tensor[%d] rank mismatched: %d != %d", i, desc[i].rank, info[i].dims->size);
+            return -EPROTO;
+        }
+
+        for (int j = 0; j < desc[i].rank; j++) {
+            if (desc[i].dims[j] != info[i].dims->data[j]) {
+                ErrPrint("Tensor[%d] dims[%d] mismatched: %d != %d", i, j, desc[i].dims[j], info[i].dims->data[j]);
+                return -EPROTO;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::GetHandle(void) const
+{
+    return shared != nullptr ? pollFd : fd;
+}
+
+bool Peer::TensorChannel::IsLocal(void) const
+{
+    return shared != nullptr;
+}
+
+void Peer::TensorChannel::Signal(int eventFd)
+{
+    uint64_t value = 1;
+    if (write(eventFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        ErrPrintCode(errno, "write");
+    }
+}
+
+bool Peer::TensorChannel::Drain(int eventFd)
+{
+    uint64_t value;
+    if (read(eventFd, &value, sizeof(value)) < 0) {
+        if (errno != EAGAIN) {
+            ErrPrintCode(errno, "read");
+        }
+        return false;
+    }
+
+    return true;
+}
+
+// NOTE:
+// Wait for the signal of the peer, the UNIX socket has nothing to read after the handshake,
+// it is readable only if the peer is closed.
+int Peer::TensorChannel::WaitLocal(int eventFd)
+{
+    struct pollfd pfd[2] = {
+        { .fd = eventFd, .events = POLLIN, .revents = 0 },
+        { .fd = fd, .events = POLLIN, .revents = 0 },
+    };
+
+    int ret;
+    do {
+        ret = poll(pfd, 2, -1);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        ret = -errno;
+        ErrPrintCode(errno, "poll");
+        return ret;
+    }
+
+    if (pfd[1].revents != 0) {
+        DbgPrint("Channel is closed");
+        return -ECONNRESET;
+    }
+
+    (void)Drain(eventFd);
+    return 0;
+}
+
+int Peer::TensorChannel::RingWrite(struct iovec *iov, int iovcnt)
+{
+    Shared::Ring &ring = shared->ring[sendRing];
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+    while (iovcnt > 0) {
+        uint64_t used = head - ring.tail.load(std::memory_order_acquire);
+        if (used > LOCAL_RING_SIZE) {
+            ErrPrint("Ring is corrupted");
+            return -EPROTO;
+        }
+
+        if (used == LOCAL_RING_SIZE) {
+            // NOTE:
+            // Let the consumer know that the producer is waiting, and check again,
+            // the consumer might take the data before seeing the flag.
+            ring.writerWaiting.store(1);
+            if (head - ring.tail.load() < LOCAL_RING_SIZE) {
+                continue;
+            }
+
+            int ret = WaitLocal(eventFd[sendRing * 2 + EventSpace]);
+            if (ret < 0) {
+                return ret;
+            }
+            continue;
+        }
+
+        size_t len = std::min(static_cast<size_t>(LOCAL_RING_SIZE - used), iov->iov_len);
+        size_t offset = static_cast<size_t>(head & (LOCAL_RING_SIZE - 1));
+        size_t first = std::min(len, static_cast<size_t>(LOCAL_RING_SIZE) - offset);
+        memcpy(sendData + offset, iov->iov_base, first);
+        memcpy(sendData, static_cast<const uint8_t *>(iov->iov_base) + first, len - first);
+
+        head += len;
+        ring.head.store(head);
+        if (ring.readerWaiting.load() != 0 && ring.readerWaiting.exchange(0) != 0) {
+            Signal(eventFd[sendRing * 2 + EventData]);
+        }
+
+        if (len == iov->iov_len) {
+            iov++;
+            iovcnt--;
+        } else {
+            iov->iov_base = static_cast<uint8_t *>(iov->iov_base) + len;
+            iov->iov_len -= len;
+        }
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::RingRead(struct iovec *iov, int iovcnt)
+{
+    Shared::Ring &ring = shared->ring[recvRing];
+    int dataFd = eventFd[recvRing * 2 + EventData];
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    bool drained = false;
+
+    while (iovcnt > 0) {
+        uint64_t used = ring.head.load(std::memory_order_acquire) - tail;
+        if (used > LOCAL_RING_SIZE) {
+            ErrPrint("Ring is corrupted");
+            return -EPROTO;
+        }
+
+        if (used == 0) {
+            ring.readerWaiting.store(1);
+            if (ring.head.load() != tail) {
+                continue;
+            }
+
+            int ret = WaitLocal(dataFd);
+            if (ret < 0) {
+                return ret;
+            }
+            drained = true;
+            continue;
+        }
+
+        size_t len = std::min(static_cast<size_t>(used), iov->iov_len);
+        size_t offset = static_cast<size_t>(tail & (LOCAL_RING_SIZE - 1));
+        size_t first = std::min(len, static_cast<size_t>(LOCAL_RING_SIZE) - offset);
+        memcpy(iov->iov_base, recvData + offset, first);
+        memcpy(static_cast<uint8_t *>(iov->iov_base) + first, recvData, len - first);
+
+        tail += len;
+        ring.tail.store(tail);
+        if (ring.writerWaiting.load() != 0 && ring.writerWaiting.exchange(0) != 0) {
+            Signal(eventFd[recvRing * 2 + EventSpace]);
+        }
+
+        if (len == iov->iov_len) {
+            iov++;
+            iovcnt--;
+        } else {
+            iov->iov_base = static_cast<uint8_t *>(iov->iov_base) + len;
+            iov->iov_len -= len;
+        }
+    }
+
+    // NOTE:
+    // The eventfd keeps the handle readable while the ring has the data.
+    // If the ring is empty, drain it here rather than waking up the main loop spuriously,
+    // and if it was drained while waiting, signal it again for the next frame.
+    if (ring.head.load() == tail) {
+        ring.readerWaiting.store(1);
+        Drain(dataFd);
+        if (ring.head.load() != tail) {
+            Signal(dataFd);
+        }
+    } else if (drained == true) {
+        Signal(dataFd);
+    }
+
+    return 0;
+}
+
+// NOTE:
+// Read the iovecs from the offset as much as the ring has without waiting for the writer,
+// the offset is advanced by the read bytes as the RecvPartial() does.
+int Peer::TensorChannel::RingReadPartial(const struct iovec *iov, int iovcnt, size_t &offset)
+{
+    Shared::Ring &ring = shared->ring[recvRing];
+    int dataFd = eventFd[recvRing * 2 + EventData];
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    size_t skip = offset;
+
+    for (int i = 0; i < iovcnt; i++) {
+        if (skip >= iov[i].iov_len) {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+
+        while (skip < iov[i].iov_len) {
+            uint64_t used = ring.head.load(std::memory_order_acquire) - tail;
+            if (used > LOCAL_RING_SIZE) {
+                ErrPrint("Ring is corrupted");
+                return -EPROTO;
+            }
+
+            if (used == 0) {
+                // NOTE:
+                // The PollLocal() arms the readerWaiting, the writer signals the handle for the rest of the frame
+                int ret = PollLocal();
+                if (ret < 0) {
+                    return ret;
+                }
+                tail = ring.tail.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            size_t len = std::min(static_cast<size_t>(used), iov[i].iov_len - skip);
+            size_t pos = static_cast<size_t>(tail & (LOCAL_RING_SIZE - 1));
+            size_t first = std::min(len, static_cast<size_t>(LOCAL_RING_SIZE) - pos);
+            uint8_t *dest = static_cast<uint8_t *>(iov[i].iov_base) + skip;
+            memcpy(dest, recvData + pos, first);
+            memcpy(dest + first, recvData, len - first);
+
+            tail += len;
+            ring.tail.store(tail);
+            if (ring.writerWaiting.load() != 0 && ring.writerWaiting.exchange(0) != 0) {
+                Signal(eventFd[recvRing * 2 + EventSpace]);
+            }
+
+            skip += len;
+            offset += len;
+        }
+
+        skip = 0;
+    }
+
+    // NOTE:
+    // Drain the handle if the ring is empty, as the RingRead() does
+    if (ring.head.load() == tail) {
+        ring.readerWaiting.store(1);
+        Drain(dataFd);
+        if (ring.head.load() != tail) {
+            Signal(dataFd);
+        }
+    }
+
+    return 0;
+}
+
+// NOTE:
+// The consumer drains the eventfd only if the ring is empty,
+// so the handle is kept readable until all the frames are read.
+int Peer::TensorChannel::PollLocal(void)
+{
+    Shared::Ring &ring = shared->ring[recvRing];
+    int dataFd = eventFd[recvRing * 2 + EventData];
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+
+    if (ring.head.load(std::memory_order_acquire) != tail) {
+        return 0;
+    }
+
+    ring.readerWaiting.store(1);
+    bool signaled = Drain(dataFd);
+    if (ring.head.load() != tail) {
+        Signal(dataFd);
+        return 0;
+    }
+
+    if (signaled == true) {
+        return -EAGAIN;
+    }
+
+    char ch;
+    ssize_t sz = recv(fd, &ch, sizeof(ch), MSG_PEEK | MSG_DONTWAIT);
+    if (sz == 0 || (sz < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        DbgPrint("Channel is closed");
+        return -ECONNRESET;
+    }
+
+    return -EAGAIN;
+}
+
+int Peer::TensorChannel::SendAll(struct iovec *iov, int iovcnt)
+{
+    if (shared != nullptr) {
+        return RingWrite(iov, iovcnt);
+    }
+
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t sz = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sz < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            int ret = -errno;
+            ErrPrintCode(errno, "sendmsg");
+            return ret;
+        }
+
+        // NOTE:
+        // Partially sent, skip the iovecs which are sent already
+        while (msg.msg_iovlen > 0 && static_cast<size_t>(sz) >= msg.msg_iov->iov_len) {
+            sz -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<char *>(msg.msg_iov->iov_base) + sz;
+            msg.msg_iov->iov_len -= sz;
+        }
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::RecvAll(struct iovec *iov, int iovcnt)
+{
+    if (shared != nullptr) {
+        return RingRead(iov, iovcnt);
+    }
+
+    while (iovcnt > 0) {
+        ssize_t sz = readv(fd, iov, iovcnt);
+        if (sz < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            int ret = -errno;
+            ErrPrintCode(errno, "readv");
+            return ret;
+        } else if (sz == 0) {
+            DbgPrint("Channel is closed");
+            return -ECONNRESET;
+        }
+
+        while (iovcnt > 0 && static_cast<size_t>(sz) >= iov->iov_len) {
+            sz -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + sz;
+            iov->iov_len -= sz;
+        }
+    }
+
+    return 0;
+}
+
+// NOTE:
+// Read the iovecs from the offset as much as available without blocking,
+// the offset is advanced by the received bytes, it is not reset even if all of them are received.
+int Peer::TensorChannel::RecvPartial(const struct iovec *iov, int iovcnt, size_t &offset)
+{
+    if (shared != nullptr) {
+        return RingReadPartial(iov, iovcnt, offset);
+    }
+
+    struct iovec pending[MAX_TENSORS + 1];
+    size_t skip = offset;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = pending;
+    for (int i = 0; i < iovcnt; i++) {
+        if (skip >= iov[i].iov_len) {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+
+        pending[msg.msg_iovlen].iov_base = static_cast<uint8_t *>(iov[i].iov_base) + skip;
+        pending[msg.msg_iovlen].iov_len = iov[i].iov_len - skip;
+        msg.msg_iovlen++;
+        skip = 0;
+    }
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t sz = recvmsg(fd, &msg, MSG_DONTWAIT);
+        if (sz < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return -EAGAIN;
+            }
+
+            int ret = -errno;
+            ErrPrintCode(errno, "recvmsg");
+            return ret;
+        } else if (sz == 0) {
+            DbgPrint("Channel is closed");
+            return -ECONNRESET;
+        }
+
+        offset += sz;
+        while (msg.msg_iovlen > 0 && static_cast<size_t>(sz) >= msg.msg_iov->iov_len) {
+            sz -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<char *>(msg.msg_iov->iov_base) + sz;
+            msg.msg_iov->iov_len -= sz;
+        }
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::SetSecret(beyond::AuthenticatorInterface *auth, const std::string &secret, bool initiator)
+{
+    if (auth == nullptr || secret.empty() == true) {
+        ErrPrint("Invalid arguments");
+        return -EINVAL;
+    }
+
+    if (shared != nullptr) {
+        DbgPrint("Local channel is not sealed");
+        return 0;
+    }
+
+    if (this->secret.empty() == false || cipher != nullptr) {
+        ErrPrint("Channel is sealed already");
+        return -EALREADY;
+    }
+
+    try {
+        sealBuffer = new uint8_t[SEAL_CHUNK_SIZE];
+        this->secret = secret;
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        delete[] sealBuffer;
+        sealBuffer = nullptr;
+        return -ENOMEM;
+    }
+
+    this->auth = auth;
+    this->initiator = initiator;
+    saltPending = true;
+
+    if (initiator == false) {
+        return 0;
+    }
+
+    int ret = auth->GenerateRandom(salt, sizeof(salt));
+    if (ret < 0) {
+        ErrPrint("Unable to generate the salt: %d", ret);
+        return ret;
+    }
+
+    return CreateCipher();
+}
+
+// NOTE:
+// The authenticator derives the key of the channel from the session key and the salt (HKDF)
+int Peer::TensorChannel::CreateCipher(void)
+{
+    int ret = auth->CreateCipher(cipher, secret.data(), static_cast<int>(secret.size()), salt, sizeof(salt));
+    if (ret < 0) {
+        ErrPrint("Unable to create the cipher: %d", ret);
+        cipher = nullptr;
+        return ret;
+    }
+
+    std::fill(secret.begin(), secret.end(), '\0');
+    secret.clear();
+    auth = nullptr;
+    return 0;
+}
+
+void Peer::TensorChannel::MakeIV(uint32_t direction, uint64_t sequence, uint8_t *iv)
+{
+    static_assert(beyond::AuthenticatorInterface::CipherInterface::IV_SIZE == sizeof(direction) + sizeof(sequence), "IV must be the direction and the sequence");
+    memcpy(iv, &direction, sizeof(direction));
+    memcpy(iv + sizeof(direction), &sequence, sizeof(sequence));
+}
+
+// NOTE:
+// The plain parts (aadcnt) are authenticated, the payloads are encrypted into the scratch buffer by the chunk
+// and each chunk is sent with the pending parts, the tag is sent with the last chunk.
+int Peer::TensorChannel::SendSealed(struct iovec *iov, int aadcnt, int iovcnt)
+{
+    using CipherInterface = beyond::AuthenticatorInterface::CipherInterface;
+
+    if (cipher == nullptr) {
+        ErrPrint("Salt is not received yet");
+        return -ENOTCONN;
+    }
+
+    uint8_t aad[sizeof(Header) + sizeof(Descriptor) * MAX_TENSORS + sizeof(Timing)];
+    size_t aadSize = 0;
+    for (int i = 0; i < aadcnt; i++) {
+        memcpy(aad + aadSize, iov[i].iov_base, iov[i].iov_len);
+        aadSize += iov[i].iov_len;
+    }
+
+    // NOTE:
+    // The sequence is consumed even if the frame is not sent, the IV must not be used again
+    uint8_t iv[CipherInterface::IV_SIZE];
+    MakeIV(initiator == true ? RingRequest : RingResponse, sendSequence++, iv);
+
+    CipherInterface::Stream *stream = nullptr;
+    int ret = cipher->Begin(true, iv, aad, static_cast<int>(aadSize), stream);
+    if (ret < 0) {
+        return ret;
+    }
+
+    struct iovec out[MAX_TENSORS + 6];
+    int outcnt = 0;
+    if (saltPending == true) {
+        out[outcnt].iov_base = salt;
+        out[outcnt].iov_len = sizeof(salt);
+        outcnt++;
+        saltPending = false;
+    }
+
+    for (int i = 0; i < aadcnt; i++) {
+        out[outcnt++] = iov[i];
+    }
+
+    uint8_t tag[CipherInterface::TAG_SIZE];
+    int idx = aadcnt;
+    size_t offset = 0;
+
+    while (true) {
+        size_t used = 0;
+        while (idx < iovcnt && used < SEAL_CHUNK_SIZE) {
+            size_t len = std::min(iov[idx].iov_len - offset, SEAL_CHUNK_SIZE - used);
+            ret = cipher->Update(stream, static_cast<const uint8_t *>(iov[idx].iov_base) + offset, static_cast<int>(len), sealBuffer + used);
+            if (ret < 0) {
+                break;
+            }
+
+            used += len;
+            offset += len;
+            if (offset == iov[idx].iov_len) {
+                idx++;
+                offset = 0;
+            }
+        }
+
+        if (ret < 0) {
+            (void)cipher->End(stream, tag);
+            return ret;
+        }
+
+        if (used > 0) {
+            out[outcnt].iov_base = sealBuffer;
+            out[outcnt].iov_len = used;
+            outcnt++;
+        }
+
+        if (idx == iovcnt) {
+            break;
+        }
+
+        ret = SendAll(out, outcnt);
+        if (ret < 0) {
+            (void)cipher->End(stream, tag);
+            return ret;
+        }
+        outcnt = 0;
+    }
+
+    ret = cipher->End(stream, tag);
+    if (ret < 0) {
+        return ret;
+    }
+
+    out[outcnt].iov_base = tag;
+    out[outcnt].iov_len = sizeof(tag);
+    outcnt++;
+    return SendAll(out, outcnt);
+}
+
+int Peer::TensorChannel::OpenSealed(const Header &header, const Descriptor *desc, const Timing *timing)
+{
+    using CipherInterface = beyond::AuthenticatorInterface::CipherInterface;
+
+    uint8_t aad[sizeof(Header) + sizeof(Descriptor) * MAX_TENSORS + sizeof(Timing)];
+    size_t aadSize = 0;
+
+    memcpy(aad, &header, sizeof(header));
+    aadSize += sizeof(header);
+    if (desc != nullptr) {
+        memcpy(aad + aadSize, desc, sizeof(Descriptor) * header.count);
+        aadSize += sizeof(Descriptor) * header.count;
+    }
+    if (timing != nullptr) {
+        memcpy(aad + aadSize, timing, sizeof(Timing));
+        aadSize += sizeof(Timing);
+    }
+
+    if (recvStream != nullptr) {
+        // NOTE:
+        // The payloads of the previous frame were not read, the stream cannot be recovered
+        ErrPrint("Previous frame is not finished");
+        return -EPROTO;
+    }
+
+    uint8_t iv[CipherInterface::IV_SIZE];
+    MakeIV(initiator == true ? RingResponse : RingRequest, recvSequence++, iv);
+    return cipher->Begin(false, iv, aad, static_cast<int>(aadSize), recvStream);
+}
+
+// NOTE:
+// The payloads are read by the chunk and decrypted in place while they are in the cache
+int Peer::TensorChannel::RecvSealed(const struct iovec *payload, int count)
+{
+    using CipherInterface = beyond::AuthenticatorInterface::CipherInterface;
+
+    if (recvStream == nullptr) {
+        ErrPrint("Header is not received");
+        return -EPROTO;
+    }
+
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; i++) {
+        for (size_t offset = 0; offset < payload[i].iov_len; offset += SEAL_CHUNK_SIZE) {
+            uint8_t *data = static_cast<uint8_t *>(payload[i].iov_base) + offset;
+            size_t len = std::min(payload[i].iov_len - offset, SEAL_CHUNK_SIZE);
+            struct iovec iov = {
+                .iov_base = data,
+                .iov_len = len,
+            };
+
+            ret = RecvAll(&iov, 1);
+            if (ret < 0) {
+                break;
+            }
+
+            ret = cipher->Update(recvStream, data, static_cast<int>(len), data);
+            if (ret < 0) {
+                break;
+            }
+        }
+    }
+
+    uint8_t tag[CipherInterface::TAG_SIZE] = {};
+    if (ret == 0) {
+        struct iovec iov = {
+            .iov_base = tag,
+            .iov_len = sizeof(tag),
+        };
+        ret = RecvAll(&iov, 1);
+    }
+
+    int status = cipher->End(recvStream, tag);
+    recvStream = nullptr;
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (status < 0) {
+        ErrPrint("Frame is not authentic: %d", status);
+    }
+    return status;
+}
+
+// NOTE:
+// Decrypt the payloads in place from the offset to the offset (exclusive) of the concatenated payloads
+int Peer::TensorChannel::UpdateSealed(const struct iovec *payload, int count, size_t from, size_t to)
+{
+    size_t base = 0;
+
+    for (int i = 0; i < count && from < to; i++) {
+        size_t end = base + payload[i].iov_len;
+        if (from < end) {
+            uint8_t *data = static_cast<uint8_t *>(payload[i].iov_base) + (from - base);
+            size_t len = std::min(end, to) - from;
+            int ret = cipher->Update(recvStream, data, static_cast<int>(len), data);
+            if (ret < 0) {
+                return ret;
+            }
+            from += len;
+        }
+        base = end;
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::Send(uint64_t requestId, const Descriptor *desc, const struct iovec *payload, int count, const Timing *timing)
+{
+    if (count < 0 || count > MAX_TENSORS || (count > 0 && (desc == nullptr || payload == nullptr))) {
+        ErrPrint("Invalid arguments");
+        return -EINVAL;
+    }
+
+    Header header = {
+        .magic = MAGIC,
+        .version = VERSION,
+        .count = static_cast<uint16_t>(count),
+        .requestId = requestId,
+    };
+
+    struct iovec iov[MAX_TENSORS + 3];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+
+    int iovcnt = 1;
+    if (count > 0) {
+        iov[iovcnt].iov_base = const_cast<Descriptor *>(desc);
+        iov[iovcnt].iov_len = sizeof(Descriptor) * count;
+        iovcnt++;
+
+        if (timing != nullptr) {
+            iov[iovcnt].iov_base = const_cast<Timing *>(timing);
+            iov[iovcnt].iov_len = sizeof(Timing);
+            iovcnt++;
+        }
+    }
+
+    int aadcnt = iovcnt;
+    for (int i = 0; i < count; i++) {
+        if (payload[i].iov_len != desc[i].size) {
+            ErrPrint("Size mismatched: %zu != %llu", payload[i].iov_len, static_cast<unsigned long long>(desc[i].size));
+            return -EINVAL;
+        }
+
+        if (payload[i].iov_len > 0) {
+            iov[iovcnt++] = payload[i];
+        }
+    }
+
+    if (secret.empty() == false || cipher != nullptr) {
+        return SendSealed(iov, aadcnt, iovcnt);
+    }
+
+    return SendAll(iov, iovcnt);
+}
+
+int Peer::TensorChannel::Cancel(uint64_t requestId)
+{
+    return Send(requestId, nullptr, nullptr, 0);
+}
+
+int Peer::TensorChannel::RecvHeader(Header &header, Descriptor *desc, Timing *timing)
+{
+    struct iovec iov;
+
+    if (shared != nullptr) {
+        int ret = PollLocal();
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    if (saltPending == true && initiator == false) {
+        iov.iov_base = salt;
+        iov.iov_len = sizeof(salt);
+        int ret = RecvAll(&iov, 1);
+        if (ret < 0) {
+            return ret;
+        }
+
+        ret = CreateCipher();
+        if (ret < 0) {
+            return ret;
+        }
+        saltPending = false;
+    }
+
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+    int ret = RecvAll(&iov, 1);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (header.magic != MAGIC || header.version != VERSION) {
+        ErrPrint("Invalid frame: magic(0x%.8X) version(%u)", header.magic, header.version);
+        return -EPROTO;
+    }
+
+    if (header.count > limitCount) {
+        ErrPrint("Invalid count of tensors: %u", header.count);
+        return -EPROTO;
+    }
+
+    if (header.count == 0) {
+        if (cipher == nullptr) {
+            return 0;
+        }
+
+        // NOTE:
+        // The canceled frame has the tag right after the header
+        ret = OpenSealed(header, nullptr, nullptr);
+        if (ret < 0) {
+            return ret;
+        }
+        return RecvSealed(nullptr, 0);
+    }
+
+    struct iovec descIov[2];
+    int iovcnt = 1;
+    descIov[0].iov_base = desc;
+    descIov[0].iov_len = sizeof(Descriptor) * header.count;
+    if (timing != nullptr) {
+        descIov[1].iov_base = timing;
+        descIov[1].iov_len = sizeof(Timing);
+        iovcnt++;
+    }
+
+    ret = RecvAll(descIov, iovcnt);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = CheckDescriptor(desc, header.count);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (cipher != nullptr) {
+        return OpenSealed(header, desc, timing);
+    }
+
+    return 0;
+}
+
+int Peer::TensorChannel::RecvPayload(const struct iovec *payload, int count)
+{
+    if (count <= 0 || count > MAX_TENSORS || payload == nullptr) {
+        ErrPrint("Invalid arguments");
+        return -EINVAL;
+    }
+
+    if (cipher != nullptr) {
+        return RecvSealed(payload, count);
+    }
+
+    struct iovec iov[MAX_TENSORS];
+    int iovcnt = 0;
+    for (int i = 0; i < count; i++) {
+        if (payload[i].iov_len > 0) {
+            iov[iovcnt++] = payload[i];
+        }
+    }
+
+    if (iovcnt == 0) {
+        return 0;
+    }
+
+    return RecvAll(iov, iovcnt);
+}
+
+int Peer::TensorChannel::TryRecvHeader(Header &header, Descriptor *desc)
+{
+    int ret;
+
+    while (true) {
+        struct iovec iov;
+
+        switch (recvPart) {
+        case PartHeader:
+            if (saltPending == true && initiator == false) {
+                iov.iov_base = salt;
+                iov.iov_len = sizeof(salt);
+                ret = RecvPartial(&iov, 1, recvOffset);
+                if (ret < 0) {
+                    return ret;
+                }
+                recvOffset = 0;
+
+                ret = CreateCipher();
+                if (ret < 0) {
+                    return ret;
+                }
+                saltPending = false;
+            }
+
+            iov.iov_base = &recvHeader;
+            iov.iov_len = sizeof(recvHeader);
+            ret = RecvPartial(&iov, 1, recvOffset);
+            if (ret < 0) {
+                return ret;
+            }
+            recvOffset = 0;
+
+            if (recvHeader.magic != MAGIC || recvHeader.version != VERSION) {
+                ErrPrint("Invalid frame: magic(0x%.8X) version(%u)", recvHeader.magic, recvHeader.version);
+                return -EPROTO;
+            }
+
+            if (recvHeader.count > limitCount) {
+                ErrPrint("Invalid count of tensors: %u", recvHeader.count);
+                return -EPROTO;
+            }
+
+            if (recvHeader.count > 0) {
+                recvPart = PartDescriptor;
+                break;
+            }
+
+            if (cipher == nullptr) {
+                header = recvHeader;
+                return 0;
+            }
+
+            // NOTE:
+            // The canceled frame has the tag right after the header
+            ret = OpenSealed(recvHeader, nullptr, nullptr);
+            if (ret < 0) {
+                return ret;
+            }
+            recvPart = PartTag;
+            break;
+        case PartDescriptor:
+            iov.iov_base = recvDesc;
+            iov.iov_len = sizeof(Descriptor) * recvHeader.count;
+            ret = RecvPartial(&iov, 1, recvOffset);
+            if (ret < 0) {
+                return ret;
+            }
+            recvOffset = 0;
+
+            ret = CheckDescriptor(recvDesc, recvHeader.count);
+            if (ret < 0) {
+                return ret;
+            }
+
+            if (cipher != nullptr) {
+                ret = OpenSealed(recvHeader, recvDesc, nullptr);
+                if (ret < 0) {
+                    return ret;
+                }
+            }
+
+            header = recvHeader;
+            memcpy(desc, recvDesc, sizeof(Descriptor) * recvHeader.count);
+            recvPart = PartPayload;
+            return 0;
+        case PartTag:
+            iov.iov_base = recvTag;
+            iov.iov_len = sizeof(recvTag);
+            ret = RecvPartial(&iov, 1, recvOffset);
+            if (ret < 0) {
+                return ret;
+            }
+            recvOffset = 0;
+            recvPart = PartHeader;
+
+            ret = cipher->End(recvStream, recvTag);
+            recvStream = nullptr;
+            if (ret < 0) {
+                ErrPrint("Frame is not authentic: %d", ret);
+                return ret;
+            }
+
+            header = recvHeader;
+            return 0;
+        default:
+            ErrPrint("Payloads of the previous frame are not received");
+            return -EPROTO;
+        }
+    }
+}
+
+int Peer::TensorChannel::TryRecvPayload(const struct iovec *payload, int count)
+{
+    if (recvPart != PartPayload || count != recvHeader.count || payload == nullptr) {
+        ErrPrint("Invalid arguments");
+        return -EINVAL;
+    }
+
+    struct iovec iov[MAX_TENSORS + 1];
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        iov[i] = payload[i];
+        total += payload[i].iov_len;
+    }
+
+    int iovcnt = count;
+    if (cipher != nullptr) {
+        iov[iovcnt].iov_base = recvTag;
+        iov[iovcnt].iov_len = sizeof(recvTag);
+        iovcnt++;
+    }
+
+    size_t from = recvOffset;
+    int ret = RecvPartial(iov, iovcnt, recvOffset);
+    if (ret < 0 && ret != -EAGAIN) {
+        return ret;
+    }
+
+    // NOTE:
+    // The payloads are decrypted as they arrive, they are not authentic until the tag is verified
+    if (cipher != nullptr && from < total) {
+        int status = UpdateSealed(payload, count, from, std::min(recvOffset, total));
+        if (status < 0) {
+            return status;
+        }
+    }
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    recvOffset = 0;
+    recvPart = PartHeader;
+    if (cipher == nullptr) {
+        return 0;
+    }
+
+    ret = cipher->End(recvStream, recvTag);
+    recvStream = nullptr;
+    if (ret < 0) {
+        ErrPrint("Frame is not authentic: %d", ret);
+    }
+    return ret;
+}
+
+Peer::TensorChannel::TensorChannel(void)
+    : fd(-1)
+    , shared(nullptr)
+    , handshaking(false)
+    , sendData(nullptr)
+    , recvData(nullptr)
+    , sendRing(RingRequest)
+    , recvRing(RingResponse)
+    , eventFd{ -1, -1, -1, -1 }
+    , pollFd(-1)
+    , auth(nullptr)
+    , cipher(nullptr)
+    , recvStream(nullptr)
+    , salt{}
+    , saltPending(false)
+    , initiator(false)
+    , sendSequence(0)
+    , recvSequence(0)
+    , sealBuffer(nullptr)
+    , limitCount(MAX_TENSORS)
+    , limitSize{}
+    , recvPart(PartHeader)
+    , recvOffset(0)
+    , recvHeader{}
+    , recvDesc{}
+    , recvTag{}
+{
+    std::fill(limitSize, limitSize + MAX_TENSORS, MAX_PAYLOAD);
+}
+
+Peer::TensorChannel::~TensorChannel(void)
+{
+    if (recvStream != nullptr) {
+        // NOTE:
+        // The payloads of the last frame were not read, the stream is closed to release its context
+        uint8_t tag[beyond::AuthenticatorInterface::CipherInterface::TAG_SIZE] = {};
+        (void)cipher->End(recvStream, tag);
+        recvStream = nullptr;
+    }
+
+    if (cipher != nullptr) {
+        cipher->Destroy();
+        cipher = nullptr;
+    }
+
+    std::fill(secret.begin(), secret.end(), '\0');
+    delete[] sealBuffer;
+    sealBuffer = nullptr;
+
+    if (shared != nullptr) {
+        if (munmap(shared, LOCAL_HEADER_SIZE + LOCAL_RING_SIZE * RingLast) < 0) {
+            ErrPrintCode(errno, "munmap");
+        }
+        shared = nullptr;
+    }
+
+    if (pollFd >= 0) {
+        if (close(pollFd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        pollFd = -1;
+    }
+
+    for (int i = 0; i < EventLast; i++) {
+        if (eventFd[i] >= 0) {
+            if (close(eventFd[i]) < 0) {
+                ErrPrintCode(errno, "close");
+            }
+            eventFd[i] = -1;
+        }
+    }
+
+    if (fd >= 0) {
+        if (close(fd) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        fd = -1;
+    }
+}
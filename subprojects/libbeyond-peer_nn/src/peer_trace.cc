@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "peer_trace.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cinttypes>
+#include <ctime>
+
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+// NOTE:
+// Duration between two timestamps, 0 if one of them is not recorded
+#define ELAPSED(from, to) (((from) > 0 && (to) > (from)) ? ((to) - (from)) : 0)
+
+Peer::Trace *Peer::Trace::Create(const char *output)
+{
+    Peer::Trace *impls;
+
+    try {
+        impls = new Peer::Trace();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return nullptr;
+    }
+
+    if (output != nullptr) {
+        impls->output = std::string(output);
+    }
+
+    return impls;
+}
+
+void Peer::Trace::Destroy(void)
+{
+    Dump();
+
+    if (output.empty() == false && Write(output.c_str()) < 0) {
+        ErrPrint("Failed to write the trace: %s", output.c_str());
+    }
+
+    delete this;
+}
+
+uint64_t Peer::Trace::Now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        ErrPrintCode(errno, "clock_gettime");
+        return 0;
+    }
+
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000llu + static_cast<uint64_t>(ts.tv_nsec) / 1000llu;
+}
+
+const char *Peer::Trace::GetStageName(int stage)
+{
+    static const char *names[StageLast] = {
+        "queue",
+        "send",
+        "network",
+        "server.recv",
+        "server.convert",
+        "server.filter",
+        "server.post",
+        "recv",
+        "deliver",
+        "total",
+    };
+
+    return (stage >= 0 && stage < StageLast) ? names[stage] : "unknown";
+}
+
+// NOTE:
+// Must be called with the lock
+void Peer::Trace::Add(int stage, uint64_t value)
+{
+    Histogram &histogram = histograms[stage];
+    int bucket = 0;
+
+    while (bucket < BUCKETS - 1 && (1llu << bucket) <= value) {
+        bucket++;
+    }
+
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.sum += value;
+    if (histogram.max < value) {
+        histogram.max = value;
+    }
+}
+
+// NOTE:
+// The upper bound of the bucket which has the percentile, the bucket i has the values less than 2^i
+uint64_t Peer::Trace::GetPercentile(const Histogram &histogram, int percentile)
+{
+    uint64_t rank = (histogram.count * percentile + 99) / 100;
+    uint64_t count = 0;
+
+    for (int i = 0; i < BUCKETS; i++) {
+        count += histogram.buckets[i];
+        if (count >= rank) {
+            return (i < BUCKETS - 1 && (1llu << i) < histogram.max) ? (1llu << i) : histogram.max;
+        }
+    }
+
+    return histogram.max;
+}
+
+void Peer::Trace::Update(const Record &record)
+{
+    uint64_t server = static_cast<uint64_t>(record.server.recv) + record.server.convert + record.server.filter + record.server.post;
+    uint64_t roundTrip = ELAPSED(record.sent, record.received);
+
+    MUTEX_LOCK(&lock);
+    Add(StageQueue, ELAPSED(record.invoked, record.dispatched));
+    Add(StageSend, ELAPSED(record.dispatched, record.sent));
+    Add(StageNetwork, roundTrip > server ? roundTrip - server : 0);
+    Add(StageServerRecv, record.server.recv);
+    Add(StageServerConvert, record.server.convert);
+    Add(StageServerFilter, record.server.filter);
+    Add(StageServerPost, record.server.post);
+    Add(StageRecv, ELAPSED(record.received, record.copied));
+    Add(StageDeliver, ELAPSED(record.copied, record.delivered));
+    Add(StageTotal, ELAPSED(record.invoked, record.delivered));
+
+    if (output.empty() == false && records.size() < MAX_RECORDS) {
+        records.push_back(record);
+    }
+    MUTEX_UNLOCK(&lock);
+}
+
+void Peer::Trace::Dump(void)
+{
+    MUTEX_LOCK(&lock);
+    InfoPrint("%-16s %10s %10s %10s %10s %10s (usec)", "stage", "count", "avg", "p50", "p99", "max");
+    for (int i = 0; i < StageLast; i++) {
+        const Histogram &histogram = histograms[i];
+        if (histogram.count == 0) {
+            continue;
+        }
+
+        InfoPrint("%-16s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64,
+                  GetStageName(i),
+                  histogram.count,
+                  histogram.sum / histogram.count,
+                  GetPercentile(histogram, 50),
+                  GetPercentile(histogram, 99),
+                  histogram.max);
+    }
+    MUTEX_UNLOCK(&lock);
+}
+
+// NOTE:
+// Every request is a nestable async event which has its stages,
+// the server stages are placed at the middle of the round trip, because only their durations are known.
+int Peer::Trace::Write(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "fopen: %s", path);
+        return ret;
+    }
+
+    MUTEX_LOCK(&lock);
+    uint64_t base = UINT64_MAX;
+    for (const Record &record : records) {
+        if (record.invoked > 0 && record.invoked < base) {
+            base = record.invoked;
+        }
+    }
+
+    bool first = true;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (const Record &record : records) {
+        if (record.invoked == 0 || record.delivered < record.invoked) {
+            continue;
+        }
+
+        uint64_t duration[StageLast] = {};
+        uint64_t server = static_cast<uint64_t>(record.server.recv) + record.server.convert + record.server.filter + record.server.post;
+        uint64_t roundTrip = ELAPSED(record.sent, record.received);
+        uint64_t network = roundTrip > server ? roundTrip - server : 0;
+
+        duration[StageQueue] = ELAPSED(record.invoked, record.dispatched);
+        duration[StageSend] = ELAPSED(record.dispatched, record.sent);
+        duration[StageNetwork] = network / 2;
+        duration[StageServerRecv] = record.server.recv;
+        duration[StageServerConvert] = record.server.convert;
+        duration[StageServerFilter] = record.server.filter;
+        duration[StageServerPost] = record.server.post;
+        duration[StageRecv] = ELAPSED(record.received, record.copied);
+        duration[StageDeliver] = ELAPSED(record.copied, record.delivered);
+
+        uint64_t ts = record.invoked - base;
+        fprintf(fp, "%s\n{\"name\":\"request\",\"cat\":\"peer_nn\",\"ph\":\"b\",\"id\":%" PRIu64 ",\"pid\":1,\"tid\":1,\"ts\":%" PRIu64 "}",
+                first == true ? "" : ",", record.requestId, ts);
+        first = false;
+
+        for (int i = StageQueue; i < StageTotal; i++) {
+            if (i == StageRecv && record.received > 0) {
+                // NOTE:
+                // The rest of the network stage is the return path
+                ts = record.received - base;
+            }
+
+            if (duration[i] == 0) {
+                continue;
+            }
+
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"peer_nn\",\"ph\":\"b\",\"id\":%" PRIu64 ",\"pid\":1,\"tid\":1,\"ts\":%" PRIu64 "}",
+                    GetStageName(i), record.requestId, ts);
+            ts += duration[i];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"peer_nn\",\"ph\":\"e\",\"id\":%" PRIu64 ",\"pid\":1,\"tid\":1,\"ts\":%" PRIu64 "}",
+                    GetStageName(i), record.requestId, ts);
+        }
+
+        fprintf(fp, ",\n{\"name\":\"request\",\"cat\":\"peer_nn\",\"ph\":\"e\",\"id\":%" PRIu64 ",\"pid\":1,\"tid\":1,\"ts\":%" PRIu64 "}",
+                record.requestId, record.delivered - base);
+    }
+    fprintf(fp, "\n]}\n");
+    MUTEX_UNLOCK(&lock);
+
+    if (fclose(fp) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "fclose");
+        return ret;
+    }
+
+    return 0;
+}
+
+Peer::Trace::Trace(void)
+    : lock(PTHREAD_MUTEX_INITIALIZER)
+    , histograms{}
+{
+}
+
+Peer::Trace::~Trace(void)
+{
+    int ret = pthread_mutex_destroy(&lock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
+}
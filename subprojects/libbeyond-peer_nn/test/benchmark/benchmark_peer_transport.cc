@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// NOTE:
+// Loopback benchmark of the data planes of the peer_nn.
+// The server and the client run in this process, the client sends the raw tensors of the model
+// via the tensor channel and via the "Infer" RPC in turn, and the throughput and the latency of each one are printed.
+// It is a manual tool, it is not registered to the ctest.
+//
+// $ benchmark_peer_transport --model mobilenet_v1_1.0_224_quant.tflite --count 1000 --window 4
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <poll.h>
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+
+#include "beyond/plugin/peer_nn_plugin.h"
+
+#define MODULE_FILENAME "libbeyond-" BEYOND_PLUGIN_PEER_NN_NAME ".so"
+#define DEFAULT_MODEL "subprojects/libbeyond-peer_nn/test/mobilenet_v1_1.0_224_quant.tflite"
+#define DEFAULT_PORT 50100
+#define DEFAULT_COUNT 1000
+#define DEFAULT_WINDOW 4
+#define WARMUP_COUNT 20
+
+struct Result {
+    const char *name;
+    int count;
+    double elapsed;       // sec
+    long long bytes;      // input and output bytes
+    std::vector<double> latency; // msec, sorted
+};
+
+static double GetTime(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        ErrPrintCode(errno, "clock_gettime");
+        return 0.0;
+    }
+
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1000000000.0;
+}
+
+static double GetPercentile(const std::vector<double> &sorted, int percentile)
+{
+    if (sorted.empty() == true) {
+        return 0.0;
+    }
+
+    size_t idx = (sorted.size() * percentile + 99) / 100;
+    return sorted[idx > 0 ? idx - 1 : 0];
+}
+
+// NOTE:
+// The peer publishes an event for every result, they are not consumed by this tool.
+// Drain them not to fill the pipe of the event object.
+static void DrainEvents(beyond::InferenceInterface::PeerInterface *peer)
+{
+    struct pollfd pfd = {
+        .fd = peer->GetHandle(),
+        .events = POLLIN,
+        .revents = 0,
+    };
+
+    while (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN) == POLLIN) {
+        beyond::EventObjectInterface::EventData *evtData = nullptr;
+        if (peer->FetchEventData(evtData) < 0) {
+            break;
+        }
+        peer->DestroyEventData(evtData);
+    }
+}
+
+static beyond::InferenceInterface::PeerInterface *CreatePeer(beyond::ModuleInterface::EntryPoint entry, bool server)
+{
+    int argc = 1;
+    char *argv[4];
+    argv[0] = const_cast<char *>(BEYOND_PLUGIN_PEER_NN_NAME);
+    if (server == true) {
+        argv[argc++] = const_cast<char *>(BEYOND_PLUGIN_PEER_NN_ARGUMENT_SERVER);
+        argv[argc++] = const_cast<char *>(BEYOND_PLUGIN_PEER_NN_ARGUMENT_STORAGE_PATH);
+        argv[argc++] = const_cast<char *>("/tmp/");
+    }
+
+    optind = 0;
+    opterr = 0;
+    return reinterpret_cast<beyond::InferenceInterface::PeerInterface *>(entry(argc, argv));
+}
+
+static int Run(beyond::InferenceInterface::PeerInterface *peer, int count, int window, Result &result)
+{
+    const beyond_tensor_info *info;
+    int size;
+
+    int ret = peer->GetInputTensorInfo(info, size);
+    if (ret < 0) {
+        ErrPrint("Failed to get the input tensor info: %d", ret);
+        return ret;
+    }
+
+    beyond_tensor *tensor;
+    ret = peer->AllocateTensor(info, size, tensor);
+    if (ret < 0) {
+        ErrPrint("Failed to allocate the input tensor: %d", ret);
+        return ret;
+    }
+
+    long long inputBytes = 0;
+    for (int i = 0; i < size; i++) {
+        memset(tensor[i].data, i + 1, tensor[i].size);
+        inputBytes += tensor[i].size;
+    }
+
+    // NOTE:
+    // The results come in the order of the requests, the sent time is matched in FIFO order.
+    // The input tensor is not modified, it is shared by the requests in flight.
+    std::queue<double> sentQueue;
+    int sent = 0;
+    int received = 0;
+    int total = count + WARMUP_COUNT;
+    double startedAt = 0.0;
+
+    result.latency.clear();
+    result.bytes = 0;
+
+    while (received < total) {
+        while (sent < total && sent - received < window) {
+            ret = peer->Invoke(tensor, size, nullptr);
+            if (ret < 0) {
+                ErrPrint("Failed to invoke: %d", ret);
+                peer->FreeTensor(tensor, size);
+                return ret;
+            }
+            sentQueue.push(GetTime());
+            sent++;
+        }
+
+        beyond_tensor *output;
+        int outputSize;
+        ret = peer->GetOutput(output, outputSize);
+        if (ret < 0) {
+            ErrPrint("Failed to get the output: %d", ret);
+            peer->FreeTensor(tensor, size);
+            return ret;
+        }
+
+        double now = GetTime();
+        double sentAt = sentQueue.front();
+        sentQueue.pop();
+        received++;
+
+        if (received == WARMUP_COUNT) {
+            // NOTE:
+            // The pipelines and the connections are warmed up, start measuring
+            startedAt = now;
+        } else if (received > WARMUP_COUNT) {
+            result.latency.push_back((now - sentAt) * 1000.0);
+            result.bytes += inputBytes;
+            for (int i = 0; i < outputSize; i++) {
+                result.bytes += output[i].size;
+            }
+        }
+
+        peer->FreeTensor(output, outputSize);
+        DrainEvents(peer);
+    }
+
+    result.elapsed = GetTime() - startedAt;
+    result.count = count;
+    std::sort(result.latency.begin(), result.latency.end());
+
+    peer->FreeTensor(tensor, size);
+    return 0;
+}
+
+static int Measure(beyond::ModuleInterface::EntryPoint entry, beyond_peer_info *info, const char *model, int transport, int count, int window, Result &result)
+{
+    beyond::InferenceInterface::PeerInterface *peer = CreatePeer(entry, false);
+    if (peer == nullptr) {
+        ErrPrint("Failed to create the client");
+        return -EFAULT;
+    }
+
+    int ret = peer->SetInfo(info);
+    if (ret == 0) {
+        ret = peer->Activate();
+    }
+
+    if (ret < 0) {
+        ErrPrint("Failed to activate the client: %d", ret);
+        peer->Destroy();
+        return ret;
+    }
+
+    beyond_plugin_peer_nn_config options;
+    memset(&options, 0, sizeof(options));
+    options.client.transport = transport;
+    beyond_config config = {
+        .type = BEYOND_PLUGIN_PEER_NN_CONFIG_PIPELINE,
+        .object = static_cast<void *>(&options),
+    };
+
+    ret = peer->LoadModel(model);
+    if (ret == 0) {
+        ret = peer->Configure(&config);
+    }
+    if (ret == 0) {
+        ret = peer->Prepare();
+    }
+    if (ret == 0) {
+        ret = Run(peer, count, window, result);
+    }
+
+    if (ret < 0) {
+        ErrPrint("Failed to measure the transport(%d): %d", transport, ret);
+    }
+
+    peer->Deactivate();
+    peer->Destroy();
+    return ret;
+}
+
+static void Print(const Result &result)
+{
+    double throughput = result.elapsed > 0.0 ? result.count / result.elapsed : 0.0;
+    double bandwidth = result.elapsed > 0.0 ? result.bytes / result.elapsed / 1048576.0 : 0.0;
+
+    printf("%-8s %8d %10.3lf %10.1lf %10.1lf %8.3lf %8.3lf %8.3lf\n",
+           result.name, result.count, result.elapsed, throughput, bandwidth,
+           GetPercentile(result.latency, 50), GetPercentile(result.latency, 99),
+           result.latency.empty() == false ? result.latency.back() : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    const option opts[] = {
+        {
+            .name = "model",
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'm',
+        },
+        {
+            .name = "port", // Port of the server on the loopback
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'p',
+        },
+        {
+            .name = "count", // Number of the measured requests of each transport
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'n',
+        },
+        {
+            .name = "window", // Number of the requests in flight
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'w',
+        },
+        {
+            .name = nullptr,
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 0,
+        },
+    };
+
+    std::string model;
+    int port = DEFAULT_PORT;
+    int count = DEFAULT_COUNT;
+    int window = DEFAULT_WINDOW;
+    int c;
+    int idx;
+
+    const char *basedir = getenv("TEST_BASEDIR");
+    model = std::string(basedir != nullptr ? basedir : "") + std::string(DEFAULT_MODEL);
+
+    while ((c = getopt_long(argc, argv, "m:p:n:w:", opts, &idx)) != -1) {
+        switch (c) {
+        case 'm':
+            model = std::string(optarg);
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'w':
+            window = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [--model path] [--port port] [--count requests] [--window requests]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (port <= 0 || count <= 0 || window <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return EXIT_FAILURE;
+    }
+
+    void *handle = dlopen(MODULE_FILENAME, RTLD_LAZY);
+    if (handle == nullptr) {
+        fprintf(stderr, "dlopen: %s\n", dlerror());
+        return EXIT_FAILURE;
+    }
+
+    beyond::ModuleInterface::EntryPoint entry = reinterpret_cast<beyond::ModuleInterface::EntryPoint>(dlsym(handle, beyond::ModuleInterface::EntryPointSymbol));
+    if (entry == nullptr) {
+        fprintf(stderr, "dlsym: %s\n", dlerror());
+        dlclose(handle);
+        return EXIT_FAILURE;
+    }
+
+    beyond_peer_info serverInfo = {
+        .name = const_cast<char *>("edge"),
+        .host = const_cast<char *>("0.0.0.0"),
+        .port = { static_cast<unsigned short>(port) },
+        .free_memory = 0llu,
+        .free_storage = 0llu,
+    };
+
+    beyond_peer_info clientInfo = {
+        .name = const_cast<char *>("edge"),
+        .host = const_cast<char *>("127.0.0.1"),
+        .port = { static_cast<unsigned short>(port) },
+        .free_memory = 0llu,
+        .free_storage = 0llu,
+    };
+
+    beyond::InferenceInterface::PeerInterface *server = CreatePeer(entry, true);
+    if (server == nullptr || server->SetInfo(&serverInfo) < 0 || server->Activate() < 0) {
+        fprintf(stderr, "Failed to start the server on the port %d\n", port);
+        if (server != nullptr) {
+            server->Destroy();
+        }
+        dlclose(handle);
+        return EXIT_FAILURE;
+    }
+
+    // NOTE:
+    // On the loopback, the tensor channel is carried by the local channel (memfd rings)
+    // unless the session key is exchanged, the TCP is used in that case.
+    Result results[] = {
+        { .name = "channel", .count = 0, .elapsed = 0.0, .bytes = 0, .latency = {} },
+        { .name = "grpc", .count = 0, .elapsed = 0.0, .bytes = 0, .latency = {} },
+    };
+    const int transports[] = {
+        BEYOND_PLUGIN_PEER_NN_TRANSPORT_CHANNEL,
+        BEYOND_PLUGIN_PEER_NN_TRANSPORT_GRPC,
+    };
+
+    int status = EXIT_SUCCESS;
+    printf("model: %s, requests: %d, window: %d\n", model.c_str(), count, window);
+    printf("%-8s %8s %10s %10s %10s %8s %8s %8s\n", "plane", "requests", "sec", "req/s", "MiB/s", "p50(ms)", "p99(ms)", "max(ms)");
+    for (size_t i = 0; i < sizeof(transports) / sizeof(transports[0]); i++) {
+        if (Measure(entry, &clientInfo, model.c_str(), transports[i], count, window, results[i]) < 0) {
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        Print(results[i]);
+    }
+
+    server->Deactivate();
+    server->Destroy();
+    dlclose(handle);
+    return status;
+}
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "peer_grpc_server_registry.h"
+#include "peer_grpc_server_batcher.h"
+#include "peer_model.h"
+
+// NOTE:
+// The registry is a private nested class of the server,
+// the tests check its entries through the fixture which is a friend of it.
+class RegistryTest : public testing::Test {
+public:
+    using Registry = Peer::GrpcServer::Registry;
+    using Batcher = Peer::GrpcServer::Batcher;
+
+    static pthread_mutex_t *GetLock(Registry *registry)
+    {
+        return &registry->lock;
+    }
+
+protected:
+    void SetUp(void) override;
+
+    Batcher *Acquire(Registry *registry, const std::string &key, size_t size, const char *framework = "fake")
+    {
+        return registry->Acquire(key, size, framework, key.c_str(), nullptr, nullptr, 0, nullptr, 0, 2, 0);
+    }
+
+    static size_t GetUsage(Registry *registry)
+    {
+        return registry->usage;
+    }
+
+    static size_t GetEntryCount(Registry *registry)
+    {
+        return registry->entries.size();
+    }
+
+    static bool HasEntry(Registry *registry, const std::string &key)
+    {
+        return registry->entries.count(key) > 0;
+    }
+
+    static int GetRefcount(Registry *registry, const std::string &key)
+    {
+        std::map<std::string, Registry::Entry>::iterator it = registry->entries.find(key);
+        return it != registry->entries.end() ? it->second.refcount : -1;
+    }
+
+    static std::list<std::string> GetIdleList(Registry *registry)
+    {
+        return registry->idleList;
+    }
+};
+
+using Registry = RegistryTest::Registry;
+using Batcher = RegistryTest::Batcher;
+
+// NOTE:
+// The batcher runs a gst pipeline, it is replaced with a fake one.
+// The fake checks that the registry does not hold its lock while a batcher is created or destroyed.
+static Registry *currentRegistry;
+static int createdCount;
+static int destroyedCount;
+static int lockedCount;
+static int lastBatchSize;
+static pthread_mutex_t gateLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gateCond = PTHREAD_COND_INITIALIZER;
+static bool gateClosed;
+static bool gateEntered;
+
+static void CheckUnlocked(void)
+{
+    if (currentRegistry == nullptr) {
+        return;
+    }
+
+    pthread_mutex_t *lock = RegistryTest::GetLock(currentRegistry);
+    if (pthread_mutex_trylock(lock) != 0) {
+        lockedCount++;
+        return;
+    }
+
+    pthread_mutex_unlock(lock);
+}
+
+Batcher *Batcher::Create(const char *framework, const char *model, const char *accel,
+                         const beyond_tensor_info *inputInfo, int inputSize,
+                         const beyond_tensor_info *outputInfo, int outputSize,
+                         int batchSize, int timeout)
+{
+    CheckUnlocked();
+    lastBatchSize = batchSize;
+
+    if (strcmp(framework, "gate") == 0) {
+        pthread_mutex_lock(&gateLock);
+        gateEntered = true;
+        pthread_cond_broadcast(&gateCond);
+        while (gateClosed == true) {
+            pthread_cond_wait(&gateCond, &gateLock);
+        }
+        pthread_mutex_unlock(&gateLock);
+    }
+
+    if (strcmp(framework, "fail") == 0) {
+        return nullptr;
+    }
+
+    Batcher *batcher;
+    try {
+        batcher = new Batcher();
+    } catch (std::exception &e) {
+        return nullptr;
+    }
+
+    createdCount++;
+    return batcher;
+}
+
+void Batcher::Destroy(void)
+{
+    CheckUnlocked();
+    destroyedCount++;
+    delete this;
+}
+
+Batcher::Batcher(void)
+{
+}
+
+Batcher::~Batcher(void)
+{
+}
+
+int Peer::Model::ComputeDigest(const char *modelPath, std::string &digest)
+{
+    digest = std::string(modelPath);
+    return 0;
+}
+
+void RegistryTest::SetUp(void)
+{
+    currentRegistry = nullptr;
+    createdCount = 0;
+    destroyedCount = 0;
+    lockedCount = 0;
+    lastBatchSize = 0;
+    gateClosed = false;
+    gateEntered = false;
+}
+
+TEST_F(RegistryTest, PositiveShare)
+{
+    Registry *registry = Registry::Create(0);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    Batcher *first = Acquire(registry, "a", 10);
+    Batcher *second = Acquire(registry, "a", 10);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(createdCount, 1);
+    EXPECT_EQ(GetRefcount(registry, "a"), 2);
+    EXPECT_EQ(GetUsage(registry), 10u);
+
+    // NOTE:
+    // The budget is 0, the model is unloaded as soon as its last client is gone
+    registry->Release("a");
+    EXPECT_EQ(destroyedCount, 0);
+    registry->Release("a");
+    EXPECT_EQ(destroyedCount, 1);
+    EXPECT_EQ(GetEntryCount(registry), 0u);
+    EXPECT_EQ(GetUsage(registry), 0u);
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+}
+
+TEST_F(RegistryTest, PositiveShareWithoutBatching)
+{
+    Registry *registry = Registry::Create(0);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    // NOTE:
+    // Two clients upload the same model to their own paths, the key only depends on the contents
+    std::string first = Registry::MakeKey("digest", "fake", "cpu", " input=1:3", " output=1:10");
+    std::string second = Registry::MakeKey("digest", "fake", "cpu", " input=1:3", " output=1:10");
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, Registry::MakeKey("digest", "fake", "gpu", " input=1:3", " output=1:10"));
+
+    Batcher *a = registry->Acquire(first, 10, "fake", "/tmp/client_a/model.tflite", "cpu", nullptr, 0, nullptr, 0, 1, 0);
+    Batcher *b = registry->Acquire(second, 10, "fake", "/tmp/client_b/model.tflite", "cpu", nullptr, 0, nullptr, 0, 1, 0);
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(createdCount, 1);
+    EXPECT_EQ(lastBatchSize, 1);
+    EXPECT_EQ(GetRefcount(registry, first), 2);
+    EXPECT_EQ(GetUsage(registry), 10u);
+
+    registry->Release(first);
+    registry->Release(second);
+    EXPECT_EQ(destroyedCount, 1);
+    EXPECT_EQ(GetEntryCount(registry), 0u);
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+}
+
+TEST_F(RegistryTest, PositiveLeastRecentlyUsed)
+{
+    Registry *registry = Registry::Create(100);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    Batcher *a = Acquire(registry, "a", 40);
+    Batcher *b = Acquire(registry, "b", 40);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+
+    // NOTE:
+    // Both are idle and kept loaded within the budget, "a" is the least recently used one
+    registry->Release("a");
+    registry->Release("b");
+    EXPECT_EQ(destroyedCount, 0);
+    EXPECT_EQ(GetIdleList(registry).size(), 2u);
+    EXPECT_EQ(GetIdleList(registry).front(), "a");
+
+    Batcher *c = Acquire(registry, "c", 40);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(destroyedCount, 1);
+    EXPECT_FALSE(HasEntry(registry, "a"));
+    EXPECT_TRUE(HasEntry(registry, "b"));
+    EXPECT_EQ(GetUsage(registry), 80u);
+
+    // NOTE:
+    // The idle model is reused without loading it again
+    EXPECT_EQ(Acquire(registry, "b", 40), b);
+    EXPECT_EQ(createdCount, 3);
+    EXPECT_TRUE(GetIdleList(registry).empty());
+
+    registry->Release("b");
+    registry->Release("c");
+    EXPECT_EQ(GetIdleList(registry).back(), "c");
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+    EXPECT_EQ(destroyedCount, 3);
+}
+
+TEST_F(RegistryTest, PositiveInUseNotEvicted)
+{
+    Registry *registry = Registry::Create(50);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    ASSERT_NE(Acquire(registry, "a", 40), nullptr);
+    ASSERT_NE(Acquire(registry, "b", 40), nullptr);
+
+    // NOTE:
+    // The usage exceeds the budget, but the models which are used by the clients are kept
+    EXPECT_EQ(destroyedCount, 0);
+    EXPECT_EQ(GetUsage(registry), 80u);
+
+    registry->Release("a");
+    EXPECT_EQ(destroyedCount, 1);
+    EXPECT_EQ(GetUsage(registry), 40u);
+
+    registry->Release("b");
+    EXPECT_EQ(destroyedCount, 1);
+    EXPECT_EQ(GetIdleList(registry).size(), 1u);
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+}
+
+TEST_F(RegistryTest, NegativeCreate)
+{
+    Registry *registry = Registry::Create(100);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    EXPECT_EQ(Acquire(registry, "a", 40, "fail"), nullptr);
+    EXPECT_EQ(GetEntryCount(registry), 0u);
+    EXPECT_EQ(GetUsage(registry), 0u);
+
+    // NOTE:
+    // The failed one is not reserved anymore, it could be loaded again
+    EXPECT_NE(Acquire(registry, "a", 40), nullptr);
+    registry->Release("a");
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+}
+
+TEST_F(RegistryTest, PositiveDigests)
+{
+    Registry *registry = Registry::Create(100);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    ASSERT_NE(Acquire(registry, "a|fake|cpu", 40), nullptr);
+    ASSERT_NE(Acquire(registry, "b|fake|gpu", 40), nullptr);
+
+    // NOTE:
+    // The idle model is still loaded, only the digest part of the key is given
+    registry->Release("b|fake|gpu");
+
+    std::set<std::string> digests;
+    registry->GetDigests(digests);
+    EXPECT_EQ(digests.size(), 2u);
+    EXPECT_EQ(digests.count("a"), 1u);
+    EXPECT_EQ(digests.count("b"), 1u);
+
+    registry->Release("a|fake|cpu");
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+
+    digests.clear();
+    registry = Registry::Create(0);
+    ASSERT_NE(registry, nullptr);
+    registry->GetDigests(digests);
+    EXPECT_TRUE(digests.empty());
+    registry->Destroy();
+}
+
+struct Acquirer {
+    Registry *registry;
+    Batcher *batcher;
+};
+
+static void *AcquireMain(void *arg)
+{
+    Acquirer *acquirer = static_cast<Acquirer *>(arg);
+    acquirer->batcher = acquirer->registry->Acquire("a", 10, "gate", "a", nullptr, nullptr, 0, nullptr, 0, 2, 0);
+    return nullptr;
+}
+
+TEST_F(RegistryTest, PositiveConcurrentAcquire)
+{
+    Registry *registry = Registry::Create(0);
+    ASSERT_NE(registry, nullptr);
+    currentRegistry = registry;
+
+    gateClosed = true;
+
+    Acquirer loader = { registry, nullptr };
+    pthread_t loaderId;
+    ASSERT_EQ(pthread_create(&loaderId, nullptr, AcquireMain, static_cast<void *>(&loader)), 0);
+
+    pthread_mutex_lock(&gateLock);
+    while (gateEntered == false) {
+        pthread_cond_wait(&gateCond, &gateLock);
+    }
+    pthread_mutex_unlock(&gateLock);
+
+    // NOTE:
+    // The model is being loaded, the other models are still accessible
+    Batcher *b = Acquire(registry, "b", 10);
+    EXPECT_NE(b, nullptr);
+    registry->Release("b");
+
+    // NOTE:
+    // The second client of the same model waits for the first one
+    Acquirer waiter = { registry, nullptr };
+    pthread_t waiterId;
+    ASSERT_EQ(pthread_create(&waiterId, nullptr, AcquireMain, static_cast<void *>(&waiter)), 0);
+    usleep(10000);
+
+    pthread_mutex_lock(&gateLock);
+    gateClosed = false;
+    pthread_cond_broadcast(&gateCond);
+    pthread_mutex_unlock(&gateLock);
+
+    EXPECT_EQ(pthread_join(loaderId, nullptr), 0);
+    EXPECT_EQ(pthread_join(waiterId, nullptr), 0);
+
+    ASSERT_NE(loader.batcher, nullptr);
+    EXPECT_EQ(waiter.batcher, loader.batcher);
+    EXPECT_EQ(createdCount, 2);
+    EXPECT_EQ(GetRefcount(registry, "a"), 2);
+
+    registry->Release("a");
+    registry->Release("a");
+    EXPECT_EQ(GetEntryCount(registry), 0u);
+
+    EXPECT_EQ(lockedCount, 0);
+    currentRegistry = nullptr;
+    registry->Destroy();
+}
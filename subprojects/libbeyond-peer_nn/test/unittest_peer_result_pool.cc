@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "peer_result_pool.h"
+
+// NOTE:
+// The pool is a private nested class of the peer, the tests check its counters through this hook
+class ResultPoolTest {
+public:
+    using ResultPool = Peer::ResultPool;
+
+    static unsigned long long GetCountOfAllocated(ResultPool *pool)
+    {
+        return pool->countOfAllocated;
+    }
+
+    static unsigned long long GetCountOfReused(ResultPool *pool)
+    {
+        return pool->countOfReused;
+    }
+
+    static size_t GetCountOfBlocks(ResultPool *pool)
+    {
+        return pool->blocks.size();
+    }
+};
+
+using ResultPool = ResultPoolTest::ResultPool;
+
+static void ReleaseView(void *data)
+{
+    int *released = static_cast<int *>(data);
+    (*released)++;
+}
+
+TEST(ResultPool, NegativeAllocate)
+{
+    ResultPool *pool = ResultPool::Create();
+    ASSERT_NE(pool, nullptr);
+
+    uint64_t sizes[] = { 16 };
+    beyond_tensor *tensor = nullptr;
+    EXPECT_EQ(pool->Allocate(nullptr, 1, tensor), -EINVAL);
+    EXPECT_EQ(pool->Allocate(sizes, 0, tensor), -EINVAL);
+    EXPECT_EQ(tensor, nullptr);
+
+    pool->Destroy();
+}
+
+TEST(ResultPool, PositiveAllocate)
+{
+    ResultPool *pool = ResultPool::Create();
+    ASSERT_NE(pool, nullptr);
+
+    uint64_t sizes[] = { 3, 100, 0, 64 };
+    beyond_tensor *tensor = nullptr;
+    ASSERT_EQ(pool->Allocate(sizes, 4, tensor), 0);
+    ASSERT_NE(tensor, nullptr);
+
+    // NOTE:
+    // The buffers are aligned and do not overlap
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(tensor[i].size, static_cast<int>(sizes[i]));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(tensor[i].data) % ResultPool::ALIGNMENT, 0u);
+        EXPECT_GE(static_cast<uint8_t *>(tensor[i].data), reinterpret_cast<uint8_t *>(tensor + 4));
+        memset(tensor[i].data, i, sizes[i]);
+        if (i > 0) {
+            EXPECT_GE(static_cast<uint8_t *>(tensor[i].data), static_cast<uint8_t *>(tensor[i - 1].data) + sizes[i - 1]);
+        }
+    }
+
+    EXPECT_EQ(pool->Release(tensor), 0);
+    EXPECT_EQ(ResultPoolTest::GetCountOfAllocated(pool), 1u);
+
+    pool->Destroy();
+}
+
+TEST(ResultPool, PositiveReuse)
+{
+    ResultPool *pool = ResultPool::Create(2);
+    ASSERT_NE(pool, nullptr);
+
+    uint64_t sizes[] = { 4096 };
+    beyond_tensor *first = nullptr;
+    ASSERT_EQ(pool->Allocate(sizes, 1, first), 0);
+    EXPECT_EQ(pool->Release(first), 0);
+    EXPECT_EQ(ResultPoolTest::GetCountOfBlocks(pool), 1u);
+
+    // NOTE:
+    // The released block is handed out again for the same size
+    beyond_tensor *second = nullptr;
+    ASSERT_EQ(pool->Allocate(sizes, 1, second), 0);
+    EXPECT_EQ(second, first);
+    EXPECT_EQ(ResultPoolTest::GetCountOfBlocks(pool), 0u);
+    EXPECT_EQ(ResultPoolTest::GetCountOfAllocated(pool), 1u);
+    EXPECT_EQ(ResultPoolTest::GetCountOfReused(pool), 1u);
+
+    // NOTE:
+    // A block which is much larger than the required size is not used
+    EXPECT_EQ(pool->Release(second), 0);
+    uint64_t small[] = { 16 };
+    beyond_tensor *third = nullptr;
+    ASSERT_EQ(pool->Allocate(small, 1, third), 0);
+    EXPECT_NE(third, first);
+    EXPECT_EQ(ResultPoolTest::GetCountOfAllocated(pool), 2u);
+    EXPECT_EQ(ResultPoolTest::GetCountOfBlocks(pool), 1u);
+    EXPECT_EQ(pool->Release(third), 0);
+
+    pool->Destroy();
+}
+
+TEST(ResultPool, PositiveCapacity)
+{
+    ResultPool *pool = ResultPool::Create(1);
+    ASSERT_NE(pool, nullptr);
+
+    uint64_t sizes[] = { 256 };
+    beyond_tensor *tensor[3];
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(pool->Allocate(sizes, 1, tensor[i]), 0);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(pool->Release(tensor[i]), 0);
+    }
+    EXPECT_EQ(ResultPoolTest::GetCountOfBlocks(pool), 1u);
+
+    pool->SetCapacity(0);
+    EXPECT_EQ(ResultPoolTest::GetCountOfBlocks(pool), 0u);
+
+    pool->Destroy();
+}
+
+TEST(ResultPool, PositiveWrap)
+{
+    ResultPool *pool = ResultPool::Create(4);
+    ASSERT_NE(pool, nullptr);
+
+    int released = 0;
+    beyond_tensor *tensor = nullptr;
+    EXPECT_EQ(pool->Wrap(2, nullptr, &released, tensor), -EINVAL);
+    EXPECT_EQ(pool->Wrap(0, ReleaseView, &released, tensor), -EINVAL);
+
+    ASSERT_EQ(pool->Wrap(2, ReleaseView, &released, tensor), 0);
+    ASSERT_NE(tensor, nullptr);
+    EXPECT_EQ(released, 0);
+
+    // NOTE:
+    // The view is not kept for reusing, its owner is released with it
+    EXPECT_EQ(pool->Release(tensor), 0);
+    EXPECT_EQ(released, 1);
+    EXPECT_EQ(ResultPoolTest::GetCountOfBlocks(pool), 0u);
+
+    pool->Destroy();
+}
+
+TEST(ResultPool, NegativeRelease)
+{
+    ResultPool *pool = ResultPool::Create(1);
+    ASSERT_NE(pool, nullptr);
+
+    beyond_tensor unknown = {};
+    EXPECT_EQ(pool->Release(nullptr), -EINVAL);
+    EXPECT_EQ(pool->Release(&unknown), -ENOENT);
+
+    // NOTE:
+    // The second release of the same tensor must not be accepted
+    uint64_t sizes[] = { 32 };
+    beyond_tensor *tensor = nullptr;
+    ASSERT_EQ(pool->Allocate(sizes, 1, tensor), 0);
+    EXPECT_EQ(pool->Release(tensor), 0);
+    EXPECT_EQ(pool->Release(tensor), -ENOENT);
+
+    pool->Destroy();
+}
@@ -0,0 +1,1466 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "peer_tensor_channel.h"
+
+// NOTE:
+// The channel is a private nested class of the peer, the tests reach it through this hook
+class TensorChannelTest {
+public:
+    using TensorChannel = Peer::TensorChannel;
+
+    static bool HasIPv6(void)
+    {
+        return TensorChannel::HasIPv6();
+    }
+
+    static int SetLocalAddress(struct sockaddr_un &addr, const char *name, socklen_t &len)
+    {
+        return TensorChannel::SetLocalAddress(addr, name, len);
+    }
+
+    static int RingWrite(TensorChannel *channel, const void *data, size_t size)
+    {
+        struct iovec iov = {
+            .iov_base = const_cast<void *>(data),
+            .iov_len = size,
+        };
+        return channel->RingWrite(&iov, 1);
+    }
+};
+
+using TensorChannel = TensorChannelTest::TensorChannel;
+using CipherInterface = beyond::AuthenticatorInterface::CipherInterface;
+
+// NOTE:
+// The channel is sealed by the AES-GCM of the authenticator plugin, which is not loaded by this test.
+// The fake cipher is a keyed xorshift stream with a keyed checksum as the tag, it is not secure,
+// but it authenticates the iv, the aad and the data as the channel expects from the real one.
+class FakeCipher final : public CipherInterface {
+public:
+    explicit FakeCipher(uint64_t key)
+        : key(key)
+    {
+    }
+
+    void Destroy(void) override
+    {
+        delete this;
+    }
+
+    int Encrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, void *tag) override
+    {
+        Stream *stream = nullptr;
+        Begin(true, iv, aad, aadSize, stream);
+        Update(stream, in, size, out);
+        return End(stream, tag);
+    }
+
+    int Decrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, const void *tag) override
+    {
+        Stream *stream = nullptr;
+        Begin(false, iv, aad, aadSize, stream);
+        Update(stream, in, size, out);
+        return End(stream, const_cast<void *>(tag));
+    }
+
+    int Begin(bool encrypt, const void *iv, const void *aad, int aadSize, Stream *&stream) override
+    {
+        State *state = new State();
+        state->encrypt = encrypt;
+        state->keystream = Mix(key, iv, IV_SIZE) | 1;
+        state->mac = Mix(state->keystream ^ key, aad, aadSize);
+        state->size = 0;
+        stream = reinterpret_cast<Stream *>(state);
+        return 0;
+    }
+
+    int Update(Stream *stream, const void *in, int size, void *out) override
+    {
+        State *state = reinterpret_cast<State *>(stream);
+        const uint8_t *src = static_cast<const uint8_t *>(in);
+        uint8_t *dst = static_cast<uint8_t *>(out);
+
+        for (int i = 0; i < size; i++) {
+            state->keystream ^= state->keystream << 13;
+            state->keystream ^= state->keystream >> 7;
+            state->keystream ^= state->keystream << 17;
+
+            uint8_t byte = src[i];
+            dst[i] = byte ^ static_cast<uint8_t>(state->keystream);
+            state->mac = Mix(state->mac, state->encrypt == true ? &dst[i] : &byte, 1);
+        }
+
+        state->size += size;
+        return 0;
+    }
+
+    int End(Stream *stream, void *tag) override
+    {
+        State *state = reinterpret_cast<State *>(stream);
+        uint64_t expected[2];
+        expected[0] = Mix(state->mac, &state->size, sizeof(state->size));
+        expected[1] = Mix(expected[0] ^ key, &state->size, sizeof(state->size));
+        bool encrypt = state->encrypt;
+        delete state;
+
+        if (encrypt == true) {
+            memcpy(tag, expected, TAG_SIZE);
+            return 0;
+        }
+
+        return memcmp(tag, expected, TAG_SIZE) == 0 ? 0 : -EBADMSG;
+    }
+
+    static uint64_t Mix(uint64_t seed, const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        uint64_t hash = seed ^ 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+private:
+    struct State {
+        bool encrypt;
+        uint64_t keystream;
+        uint64_t mac;
+        uint64_t size;
+    };
+
+    static_assert(TAG_SIZE == sizeof(uint64_t) * 2, "Tag must be two words");
+
+    uint64_t key;
+};
+
+class FakeAuthenticator final : public beyond::AuthenticatorInterface {
+public:
+    FakeAuthenticator(void) = default;
+    ~FakeAuthenticator(void) override = default;
+
+public: // ModuleInterface
+    void Destroy(void) override
+    {
+    }
+
+    const char *GetModuleName(void) const override
+    {
+        return "fake";
+    }
+
+    const char *GetModuleType(void) const override
+    {
+        return "authenticator";
+    }
+
+public: // EventObjectInterface
+    int GetHandle(void) const override
+    {
+        return -1;
+    }
+
+    int AddHandler(beyond_event_handler_t handler, int type, void *data) override
+    {
+        return -ENOTSUP;
+    }
+
+    int RemoveHandler(beyond_event_handler_t handler, int type, void *data) override
+    {
+        return -ENOTSUP;
+    }
+
+    int FetchEventData(beyond::EventObjectInterface::EventData *&data) override
+    {
+        return -ENOTSUP;
+    }
+
+    int DestroyEventData(beyond::EventObjectInterface::EventData *&data) override
+    {
+        return -ENOTSUP;
+    }
+
+public: // AuthenticatorInterface
+    int Configure(const beyond_config *options) override
+    {
+        return 0;
+    }
+
+    int Activate(void) override
+    {
+        return 0;
+    }
+
+    int Prepare(void) override
+    {
+        return 0;
+    }
+
+    int Deactivate(void) override
+    {
+        return 0;
+    }
+
+    int Encrypt(beyond_authenticator_key_id id, const void *data, int size, const void *iv, int ivsize) override
+    {
+        return -ENOTSUP;
+    }
+
+    int Decrypt(beyond_authenticator_key_id id, const void *data, int size, const void *iv, int ivsize) override
+    {
+        return -ENOTSUP;
+    }
+
+    int GetResult(void *&outData, int &outSize) override
+    {
+        return -ENOTSUP;
+    }
+
+    int GetKey(beyond_authenticator_key_id id, void *&key, int &size) override
+    {
+        return -ENOTSUP;
+    }
+
+    int CreateCipher(CipherInterface *&cipher, const void *key, int keySize, const void *salt, int saltSize) override
+    {
+        cipher = new FakeCipher(FakeCipher::Mix(FakeCipher::Mix(0, key, keySize), salt, saltSize));
+        return 0;
+    }
+
+    int GenerateRandom(void *buffer, int size) override
+    {
+        uint8_t *bytes = static_cast<uint8_t *>(buffer);
+        for (int i = 0; i < size; i++) {
+            bytes[i] = static_cast<uint8_t>(random());
+        }
+        return 0;
+    }
+
+    int GenerateSignature(const unsigned char *data, int dataSize, unsigned char *&encoded, int &encodedSize) override
+    {
+        return -ENOTSUP;
+    }
+
+    int VerifySignature(unsigned char *signedData, int signedDataSize, const unsigned char *original, int originalSize, bool &authentic) override
+    {
+        return -ENOTSUP;
+    }
+
+private:
+    std::mt19937 random;
+};
+
+struct LocalConnect {
+    std::string name;
+    TensorChannel *channel;
+};
+
+static void *ConnectLocalMain(void *arg)
+{
+    LocalConnect *connect = static_cast<LocalConnect *>(arg);
+    connect->channel = TensorChannel::ConnectLocal(connect->name.c_str());
+    return nullptr;
+}
+
+// NOTE:
+// The accepted local channel completes its handshake when its handle gets readable
+static int Handshake(TensorChannel *channel)
+{
+    int ret;
+
+    do {
+        struct pollfd pfd = {
+            .fd = channel->GetHandle(),
+            .events = POLLIN,
+            .revents = 0,
+        };
+
+        if (poll(&pfd, 1, 5000) != 1) {
+            return -ETIMEDOUT;
+        }
+
+        ret = channel->TryHandshake();
+    } while (ret == -EAGAIN);
+
+    return ret;
+}
+
+static void CreateLocalPair(TensorChannel *&client, TensorChannel *&server)
+{
+    int listenFd = -1;
+    LocalConnect connect = {};
+    pthread_t thid;
+
+    client = nullptr;
+    server = nullptr;
+
+    ASSERT_EQ(TensorChannel::ListenLocal(listenFd, connect.name), 0);
+    ASSERT_EQ(pthread_create(&thid, nullptr, ConnectLocalMain, static_cast<void *>(&connect)), 0);
+    server = TensorChannel::AcceptLocal(listenFd);
+    int ret = server != nullptr ? Handshake(server) : -EFAULT;
+    ASSERT_EQ(pthread_join(thid, nullptr), 0);
+    close(listenFd);
+
+    client = connect.channel;
+    ASSERT_NE(client, nullptr);
+    ASSERT_NE(server, nullptr);
+    ASSERT_EQ(ret, 0);
+    EXPECT_EQ(server->TryHandshake(), -EALREADY);
+    EXPECT_TRUE(client->IsLocal());
+    EXPECT_TRUE(server->IsLocal());
+}
+
+static std::vector<uint8_t> MakePayload(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    return payload;
+}
+
+// NOTE:
+// The local channel returns -EAGAIN if the handle was readable spuriously
+static int RecvHeader(TensorChannel *channel, TensorChannel::Header &header, TensorChannel::Descriptor *desc)
+{
+    int ret;
+
+    do {
+        struct pollfd pfd = {
+            .fd = channel->GetHandle(),
+            .events = POLLIN,
+            .revents = 0,
+        };
+
+        if (poll(&pfd, 1, 5000) != 1) {
+            return -ETIMEDOUT;
+        }
+
+        ret = channel->RecvHeader(header, desc);
+    } while (ret == -EAGAIN);
+
+    return ret;
+}
+
+static int RecvFrame(TensorChannel *channel, uint64_t &requestId, std::vector<std::vector<uint8_t>> &payloads)
+{
+    TensorChannel::Header header;
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    struct iovec iov[TensorChannel::MAX_TENSORS];
+
+    int ret = RecvHeader(channel, header, desc);
+    if (ret < 0) {
+        return ret;
+    }
+
+    requestId = header.requestId;
+    payloads.resize(header.count);
+    for (int i = 0; i < header.count; i++) {
+        payloads[i].resize(desc[i].size);
+        iov[i].iov_base = payloads[i].data();
+        iov[i].iov_len = payloads[i].size();
+    }
+
+    if (header.count == 0) {
+        return 0;
+    }
+
+    return channel->RecvPayload(iov, header.count);
+}
+
+struct Sender {
+    TensorChannel *channel;
+    const std::vector<std::vector<uint8_t>> *payloads;
+    int frames;
+    int failed;
+};
+
+static void *SendMain(void *arg)
+{
+    Sender *sender = static_cast<Sender *>(arg);
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    struct iovec iov[TensorChannel::MAX_TENSORS];
+    int count = static_cast<int>(sender->payloads->size());
+
+    for (int i = 0; i < count; i++) {
+        const std::vector<uint8_t> &payload = (*sender->payloads)[i];
+        TensorChannel::FillDescriptor(desc[i], BEYOND_TENSOR_TYPE_UINT8, payload.size(), nullptr);
+        iov[i].iov_base = const_cast<uint8_t *>(payload.data());
+        iov[i].iov_len = payload.size();
+    }
+
+    for (int i = 0; i < sender->frames; i++) {
+        if (sender->channel->Send(i, desc, iov, count) < 0) {
+            sender->failed++;
+        }
+    }
+
+    return nullptr;
+}
+
+TEST(TensorChannel, PositiveDualStack)
+{
+    int listenFd = -1;
+    int port = 0;
+
+    ASSERT_EQ(TensorChannel::Listen(listenFd, port), 0);
+    EXPECT_GT(port, 0);
+
+    // NOTE:
+    // The IPv4 client is accepted by the dual-stack socket, and the IPv6 host can be given in the brackets
+    std::vector<std::string> hosts = { "127.0.0.1", "localhost" };
+    if (TensorChannelTest::HasIPv6() == true) {
+        EXPECT_STREQ(TensorChannel::GetAnyAddress(), "::");
+        hosts.push_back("::1");
+        hosts.push_back("[::1]");
+    } else {
+        EXPECT_STREQ(TensorChannel::GetAnyAddress(), "0.0.0.0");
+    }
+
+    for (const std::string &host : hosts) {
+        int fd = -1;
+        int acceptedFd = -1;
+
+        ASSERT_EQ(TensorChannel::Connect(host.c_str(), port, fd), 0) << host;
+        ASSERT_EQ(TensorChannel::Accept(listenFd, acceptedFd), 0) << host;
+        close(acceptedFd);
+        close(fd);
+    }
+
+    close(listenFd);
+}
+
+TEST(TensorChannel, NegativeConnect)
+{
+    int fd = -1;
+    EXPECT_EQ(TensorChannel::Connect(nullptr, 1, fd), -EINVAL);
+    EXPECT_EQ(fd, -1);
+}
+
+TEST(TensorChannel, PositiveLocalRoundTrip)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+
+    CreateLocalPair(client, server);
+    ASSERT_FALSE(HasFatalFailure());
+
+    std::vector<uint8_t> payload = MakePayload(1000, 1);
+    TensorChannel::Descriptor desc;
+    struct iovec iov = {
+        .iov_base = payload.data(),
+        .iov_len = payload.size(),
+    };
+    TensorChannel::FillDescriptor(desc, BEYOND_TENSOR_TYPE_UINT8, payload.size(), nullptr);
+
+    uint64_t requestId = 0;
+    std::vector<std::vector<uint8_t>> received;
+
+    EXPECT_EQ(client->Send(7, &desc, &iov, 1), 0);
+    EXPECT_EQ(RecvFrame(server, requestId, received), 0);
+    EXPECT_EQ(requestId, 7u);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], payload);
+
+    EXPECT_EQ(server->Send(8, &desc, &iov, 1), 0);
+    EXPECT_EQ(RecvFrame(client, requestId, received), 0);
+    EXPECT_EQ(requestId, 8u);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], payload);
+
+    // NOTE:
+    // A frame without tensors is the cancel
+    EXPECT_EQ(client->Cancel(9), 0);
+    EXPECT_EQ(RecvFrame(server, requestId, received), 0);
+    EXPECT_EQ(requestId, 9u);
+    EXPECT_TRUE(received.empty());
+
+    client->Destroy();
+    server->Destroy();
+}
+
+TEST(TensorChannel, PositiveLocalWrapAround)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+
+    CreateLocalPair(client, server);
+    ASSERT_FALSE(HasFatalFailure());
+
+    // NOTE:
+    // The odd sizes make the frames cross the end of the ring at the different offsets,
+    // including the middle of the header and the descriptors.
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(TensorChannel::LOCAL_RING_SIZE / 3 + 13, 2));
+    payloads.push_back(MakePayload(7, 3));
+    payloads.push_back(MakePayload(0, 4));
+
+    Sender sender = {
+        .channel = client,
+        .payloads = &payloads,
+        .frames = 16,
+        .failed = 0,
+    };
+
+    pthread_t thid;
+    ASSERT_EQ(pthread_create(&thid, nullptr, SendMain, static_cast<void *>(&sender)), 0);
+
+    for (int i = 0; i < sender.frames; i++) {
+        uint64_t requestId = 0;
+        std::vector<std::vector<uint8_t>> received;
+
+        ASSERT_EQ(RecvFrame(server, requestId, received), 0);
+        EXPECT_EQ(requestId, static_cast<uint64_t>(i));
+        EXPECT_TRUE(received == payloads);
+    }
+
+    EXPECT_EQ(pthread_join(thid, nullptr), 0);
+    EXPECT_EQ(sender.failed, 0);
+
+    // NOTE:
+    // The stream went around the ring several times
+    EXPECT_GT(payloads[0].size() * sender.frames, TensorChannel::LOCAL_RING_SIZE * 2);
+
+    client->Destroy();
+    server->Destroy();
+}
+
+TEST(TensorChannel, PositiveLocalLargerThanRing)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+
+    CreateLocalPair(client, server);
+    ASSERT_FALSE(HasFatalFailure());
+
+    // NOTE:
+    // The writer waits for the space while the reader drains the ring
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(TensorChannel::LOCAL_RING_SIZE * 2 + 5, 5));
+
+    Sender sender = {
+        .channel = server,
+        .payloads = &payloads,
+        .frames = 2,
+        .failed = 0,
+    };
+
+    pthread_t thid;
+    ASSERT_EQ(pthread_create(&thid, nullptr, SendMain, static_cast<void *>(&sender)), 0);
+
+    for (int i = 0; i < sender.frames; i++) {
+        uint64_t requestId = 0;
+        std::vector<std::vector<uint8_t>> received;
+
+        ASSERT_EQ(RecvFrame(client, requestId, received), 0);
+        EXPECT_EQ(requestId, static_cast<uint64_t>(i));
+        EXPECT_TRUE(received == payloads);
+    }
+
+    EXPECT_EQ(pthread_join(thid, nullptr), 0);
+    EXPECT_EQ(sender.failed, 0);
+
+    client->Destroy();
+    server->Destroy();
+}
+
+TEST(TensorChannel, NegativeLocalPeerClosed)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+
+    CreateLocalPair(client, server);
+    ASSERT_FALSE(HasFatalFailure());
+
+    client->Destroy();
+
+    TensorChannel::Header header;
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    EXPECT_LT(RecvHeader(server, header, desc), 0);
+
+    server->Destroy();
+}
+
+TEST(TensorChannel, NegativeLocalHandshake)
+{
+    int listenFd = -1;
+    std::string name;
+
+    ASSERT_EQ(TensorChannel::ListenLocal(listenFd, name), 0);
+
+    struct sockaddr_un addr;
+    socklen_t len;
+    ASSERT_EQ(TensorChannelTest::SetLocalAddress(addr, name.c_str(), len), 0);
+
+    // NOTE:
+    // The handshake is not sent yet, the accepted channel does not block the caller
+    int raw = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    ASSERT_GE(raw, 0);
+    ASSERT_EQ(connect(raw, reinterpret_cast<struct sockaddr *>(&addr), len), 0);
+
+    TensorChannel *server = TensorChannel::AcceptLocal(listenFd);
+    ASSERT_NE(server, nullptr);
+    EXPECT_FALSE(server->IsLocal());
+    EXPECT_EQ(server->TryHandshake(), -EAGAIN);
+
+    // NOTE:
+    // The magic without the shared memory is refused
+    uint32_t magic = TensorChannel::MAGIC;
+    ASSERT_EQ(send(raw, &magic, sizeof(magic), 0), static_cast<ssize_t>(sizeof(magic)));
+    EXPECT_EQ(server->TryHandshake(), -EPROTO);
+    server->Destroy();
+    close(raw);
+
+    // NOTE:
+    // The peer is closed before the handshake
+    raw = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    ASSERT_GE(raw, 0);
+    ASSERT_EQ(connect(raw, reinterpret_cast<struct sockaddr *>(&addr), len), 0);
+
+    server = TensorChannel::AcceptLocal(listenFd);
+    ASSERT_NE(server, nullptr);
+    close(raw);
+    EXPECT_EQ(server->TryHandshake(), -ECONNRESET);
+    server->Destroy();
+
+    close(listenFd);
+}
+
+TEST(TensorChannel, PositiveLocalIncremental)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+
+    CreateLocalPair(client, server);
+    ASSERT_FALSE(HasFatalFailure());
+
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(1000, 12));
+    payloads.push_back(MakePayload(0, 13));
+    payloads.push_back(MakePayload(77, 14));
+
+    // NOTE:
+    // The frame is written into the ring a few bytes at a time, the server never waits for the rest of it
+    TensorChannel::Header header = {
+        .magic = TensorChannel::MAGIC,
+        .version = TensorChannel::VERSION,
+        .count = static_cast<uint16_t>(payloads.size()),
+        .requestId = 31,
+    };
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    std::vector<uint8_t> bytes(reinterpret_cast<uint8_t *>(&header), reinterpret_cast<uint8_t *>(&header) + sizeof(header));
+    for (size_t i = 0; i < payloads.size(); i++) {
+        TensorChannel::FillDescriptor(desc[i], BEYOND_TENSOR_TYPE_UINT8, payloads[i].size(), nullptr);
+        bytes.insert(bytes.end(), reinterpret_cast<uint8_t *>(&desc[i]), reinterpret_cast<uint8_t *>(&desc[i] + 1));
+    }
+    for (const std::vector<uint8_t> &payload : payloads) {
+        bytes.insert(bytes.end(), payload.begin(), payload.end());
+    }
+
+    TensorChannel::Header received = {};
+    TensorChannel::Descriptor receivedDesc[TensorChannel::MAX_TENSORS];
+    std::vector<std::vector<uint8_t>> buffers;
+    struct iovec recvIov[TensorChannel::MAX_TENSORS];
+    bool payloadPending = false;
+    int frames = 0;
+
+    EXPECT_EQ(server->TryRecvHeader(received, receivedDesc), -EAGAIN);
+
+    for (size_t offset = 0; offset < bytes.size(); offset += 7) {
+        size_t len = std::min(static_cast<size_t>(7), bytes.size() - offset);
+        ASSERT_EQ(TensorChannelTest::RingWrite(client, bytes.data() + offset, len), 0);
+
+        int ret;
+        if (payloadPending == false) {
+            ret = server->TryRecvHeader(received, receivedDesc);
+            if (ret == -EAGAIN) {
+                continue;
+            }
+            ASSERT_EQ(ret, 0);
+            EXPECT_EQ(received.requestId, 31u);
+            ASSERT_EQ(received.count, payloads.size());
+
+            buffers.resize(received.count);
+            for (int i = 0; i < received.count; i++) {
+                buffers[i].resize(receivedDesc[i].size);
+                recvIov[i].iov_base = buffers[i].data();
+                recvIov[i].iov_len = buffers[i].size();
+            }
+            payloadPending = true;
+        }
+
+        ret = server->TryRecvPayload(recvIov, received.count);
+        if (ret == -EAGAIN) {
+            continue;
+        }
+        ASSERT_EQ(ret, 0);
+        EXPECT_TRUE(buffers == payloads);
+        payloadPending = false;
+        frames++;
+    }
+
+    EXPECT_EQ(frames, 1);
+    EXPECT_FALSE(payloadPending);
+    EXPECT_EQ(server->TryRecvHeader(received, receivedDesc), -EAGAIN);
+
+    // NOTE:
+    // The peer is closed in the middle of a frame
+    ASSERT_EQ(TensorChannelTest::RingWrite(client, bytes.data(), 3), 0);
+    client->Destroy();
+    EXPECT_EQ(server->TryRecvHeader(received, receivedDesc), -EAGAIN);
+    EXPECT_EQ(server->TryRecvHeader(received, receivedDesc), -ECONNRESET);
+
+    server->Destroy();
+}
+
+static void CreateStreamPair(TensorChannel *&client, TensorChannel *&server, int &raw)
+{
+    int sv[2];
+
+    client = nullptr;
+    server = nullptr;
+    raw = -1;
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    server = TensorChannel::Create(sv[0]);
+    ASSERT_NE(server, nullptr);
+
+    // NOTE:
+    // The tests for the rejection write the broken frames directly
+    raw = dup(sv[1]);
+    ASSERT_GE(raw, 0);
+    client = TensorChannel::Create(sv[1]);
+    ASSERT_NE(client, nullptr);
+    EXPECT_FALSE(client->IsLocal());
+}
+
+TEST(TensorChannel, PositiveStreamRoundTrip)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+    int raw;
+
+    CreateStreamPair(client, server, raw);
+    ASSERT_FALSE(HasFatalFailure());
+
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(4096 + 3, 6));
+    payloads.push_back(MakePayload(1, 7));
+    payloads.push_back(MakePayload(0, 8));
+
+    Sender sender = {
+        .channel = client,
+        .payloads = &payloads,
+        .frames = 8,
+        .failed = 0,
+    };
+
+    pthread_t thid;
+    ASSERT_EQ(pthread_create(&thid, nullptr, SendMain, static_cast<void *>(&sender)), 0);
+
+    for (int i = 0; i < sender.frames; i++) {
+        uint64_t requestId = 0;
+        std::vector<std::vector<uint8_t>> received;
+
+        ASSERT_EQ(RecvFrame(server, requestId, received), 0);
+        EXPECT_EQ(requestId, static_cast<uint64_t>(i));
+        EXPECT_TRUE(received == payloads);
+    }
+
+    EXPECT_EQ(pthread_join(thid, nullptr), 0);
+    EXPECT_EQ(sender.failed, 0);
+
+    uint64_t requestId = 0;
+    std::vector<std::vector<uint8_t>> received;
+    EXPECT_EQ(client->Cancel(100), 0);
+    EXPECT_EQ(RecvFrame(server, requestId, received), 0);
+    EXPECT_EQ(requestId, 100u);
+    EXPECT_TRUE(received.empty());
+
+    close(raw);
+    client->Destroy();
+    server->Destroy();
+}
+
+TEST(TensorChannel, NegativeStreamInvalidHeader)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+    int raw;
+
+    CreateStreamPair(client, server, raw);
+    ASSERT_FALSE(HasFatalFailure());
+
+    TensorChannel::Header header = {
+        .magic = 0xDEADBEEF,
+        .version = TensorChannel::VERSION,
+        .count = 1,
+        .requestId = 1,
+    };
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+
+    EXPECT_EQ(write(raw, &header, sizeof(header)), static_cast<ssize_t>(sizeof(header)));
+    EXPECT_EQ(RecvHeader(server, header, desc), -EPROTO);
+
+    close(raw);
+    client->Destroy();
+    server->Destroy();
+}
+
+TEST(TensorChannel, NegativeStreamInvalidDescriptor)
+{
+    struct Case {
+        uint16_t count;
+        int32_t rank;
+        uint64_t size;
+    } cases[] = {
+        { TensorChannel::MAX_TENSORS + 1, 0, 16 },
+        { 1, TensorChannel::MAX_RANK + 1, 16 },
+        { 1, -1, 16 },
+        { 1, 0, TensorChannel::MAX_PAYLOAD + 1 },
+    };
+
+    for (const Case &c : cases) {
+        TensorChannel *client;
+        TensorChannel *server;
+        int raw;
+
+        CreateStreamPair(client, server, raw);
+        ASSERT_FALSE(HasFatalFailure());
+
+        TensorChannel::Header header = {
+            .magic = TensorChannel::MAGIC,
+            .version = TensorChannel::VERSION,
+            .count = c.count,
+            .requestId = 1,
+        };
+        TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS + 1];
+        memset(desc, 0, sizeof(desc));
+        desc[0].type = BEYOND_TENSOR_TYPE_UINT8;
+        desc[0].rank = c.rank;
+        desc[0].size = c.size;
+
+        // NOTE:
+        // The receiver must not trust the frame before it reads the payloads
+        EXPECT_EQ(write(raw, &header, sizeof(header)), static_cast<ssize_t>(sizeof(header)));
+        EXPECT_EQ(write(raw, desc, sizeof(desc[0])), static_cast<ssize_t>(sizeof(desc[0])));
+        EXPECT_EQ(RecvHeader(server, header, desc), -EPROTO);
+
+        close(raw);
+        client->Destroy();
+        server->Destroy();
+    }
+}
+
+TEST(TensorChannel, NegativeStreamLimit)
+{
+    beyond_tensor_info info = {
+        .type = BEYOND_TENSOR_TYPE_UINT8,
+        .size = 16,
+        .name = nullptr,
+        .dims = nullptr,
+    };
+
+    struct Case {
+        uint16_t count;
+        uint64_t size;
+        bool incremental;
+        int expected;
+    } cases[] = {
+        { 1, 16, false, 0 },
+        { 1, 8, true, 0 },
+        { 2, 16, false, -EPROTO },
+        { 2, 16, true, -EPROTO },
+        { 1, 17, false, -EPROTO },
+        { 1, 17, true, -EPROTO },
+    };
+
+    for (const Case &c : cases) {
+        TensorChannel *client;
+        TensorChannel *server;
+        int raw;
+
+        CreateStreamPair(client, server, raw);
+        ASSERT_FALSE(HasFatalFailure());
+
+        EXPECT_EQ(server->SetLimit(nullptr, 1), -EINVAL);
+        EXPECT_EQ(server->SetLimit(&info, TensorChannel::MAX_TENSORS + 1), -EINVAL);
+        ASSERT_EQ(server->SetLimit(&info, 1), 0);
+
+        TensorChannel::Header header = {
+            .magic = TensorChannel::MAGIC,
+            .version = TensorChannel::VERSION,
+            .count = c.count,
+            .requestId = 1,
+        };
+        TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+        memset(desc, 0, sizeof(desc));
+        desc[0].type = BEYOND_TENSOR_TYPE_UINT8;
+        desc[0].size = c.size;
+        desc[1] = desc[0];
+
+        // NOTE:
+        // The frame is rejected by the limit before the buffers are allocated by its descriptors
+        EXPECT_EQ(write(raw, &header, sizeof(header)), static_cast<ssize_t>(sizeof(header)));
+        EXPECT_EQ(write(raw, desc, sizeof(desc[0]) * c.count), static_cast<ssize_t>(sizeof(desc[0]) * c.count));
+        if (c.incremental == true) {
+            int ret;
+            do {
+                ret = server->TryRecvHeader(header, desc);
+            } while (ret == -EAGAIN);
+            EXPECT_EQ(ret, c.expected);
+        } else {
+            EXPECT_EQ(RecvHeader(server, header, desc), c.expected);
+        }
+
+        close(raw);
+        client->Destroy();
+        server->Destroy();
+    }
+}
+
+TEST(TensorChannel, NegativeValidateDescriptor)
+{
+    int dimsBuffer[sizeof(beyond_tensor_info::dimensions) / sizeof(int) + 3];
+    beyond_tensor_info::dimensions *dims = reinterpret_cast<beyond_tensor_info::dimensions *>(dimsBuffer);
+    dims->size = 4;
+    dims->data[0] = 1;
+    dims->data[1] = 2;
+    dims->data[2] = 2;
+    dims->data[3] = 3;
+
+    beyond_tensor_info info = {
+        .type = BEYOND_TENSOR_TYPE_UINT8,
+        .size = 12,
+        .name = nullptr,
+        .dims = dims,
+    };
+
+    TensorChannel::Descriptor desc[2];
+    TensorChannel::FillDescriptor(desc[0], BEYOND_TENSOR_TYPE_UINT8, 12, &info);
+    TensorChannel::FillDescriptor(desc[1], BEYOND_TENSOR_TYPE_UINT8, 12, nullptr);
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(desc, 1, &info, 1), 0);
+
+    // NOTE:
+    // The dims are not sent by every client, the size is enough for them
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(&desc[1], 1, &info, 1), 0);
+
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(desc, 2, &info, 1), -EPROTO);
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(desc, 1, nullptr, 0), -EPROTO);
+
+    TensorChannel::Descriptor broken = desc[0];
+    broken.type = BEYOND_TENSOR_TYPE_FLOAT32;
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(&broken, 1, &info, 1), -EPROTO);
+
+    broken = desc[0];
+    broken.size = 1024 * 1024;
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(&broken, 1, &info, 1), -EPROTO);
+
+    broken = desc[0];
+    broken.rank = 3;
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(&broken, 1, &info, 1), -EPROTO);
+
+    broken = desc[0];
+    broken.dims[2] = 4;
+    EXPECT_EQ(TensorChannel::ValidateDescriptor(&broken, 1, &info, 1), -EPROTO);
+}
+
+static void RecvRaw(int fd, std::vector<uint8_t> &bytes)
+{
+    struct pollfd pfd = {
+        .fd = fd,
+        .events = POLLIN,
+        .revents = 0,
+    };
+
+    bytes.clear();
+    while (poll(&pfd, 1, 100) == 1) {
+        uint8_t chunk[4096];
+        ssize_t sz = read(fd, chunk, sizeof(chunk));
+        if (sz <= 0) {
+            break;
+        }
+        bytes.insert(bytes.end(), chunk, chunk + sz);
+    }
+}
+
+TEST(TensorChannel, PositiveStreamIncremental)
+{
+    TensorChannel *client;
+    TensorChannel *server;
+    int raw;
+
+    // NOTE:
+    // The frames are captured from another pair, and they are fed to the server a few bytes at a time
+    TensorChannel *capture;
+    TensorChannel *unused;
+    int captured;
+
+    CreateStreamPair(client, server, raw);
+    ASSERT_FALSE(HasFatalFailure());
+    CreateStreamPair(capture, unused, captured);
+    ASSERT_FALSE(HasFatalFailure());
+
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(1000, 9));
+    payloads.push_back(MakePayload(0, 10));
+    payloads.push_back(MakePayload(77, 11));
+
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    struct iovec iov[TensorChannel::MAX_TENSORS];
+    for (size_t i = 0; i < payloads.size(); i++) {
+        TensorChannel::FillDescriptor(desc[i], BEYOND_TENSOR_TYPE_UINT8, payloads[i].size(), nullptr);
+        iov[i].iov_base = payloads[i].data();
+        iov[i].iov_len = payloads[i].size();
+    }
+
+    ASSERT_EQ(capture->Send(21, desc, iov, static_cast<int>(payloads.size())), 0);
+    ASSERT_EQ(capture->Cancel(22), 0);
+
+    std::vector<uint8_t> bytes;
+    RecvRaw(unused->GetHandle(), bytes);
+    ASSERT_GT(bytes.size(), sizeof(TensorChannel::Header));
+
+    TensorChannel::Header header = {};
+    TensorChannel::Descriptor received[TensorChannel::MAX_TENSORS];
+    std::vector<std::vector<uint8_t>> buffers;
+    struct iovec recvIov[TensorChannel::MAX_TENSORS];
+    int frames = 0;
+    bool payloadPending = false;
+
+    for (size_t offset = 0; offset < bytes.size(); offset += 7) {
+        size_t len = std::min(static_cast<size_t>(7), bytes.size() - offset);
+        ASSERT_EQ(write(raw, bytes.data() + offset, len), static_cast<ssize_t>(len));
+
+        while (true) {
+            int ret;
+
+            if (payloadPending == false) {
+                ret = server->TryRecvHeader(header, received);
+                if (ret == -EAGAIN) {
+                    break;
+                }
+                ASSERT_EQ(ret, 0);
+
+                if (header.count == 0) {
+                    EXPECT_EQ(header.requestId, 22u);
+                    frames++;
+                    continue;
+                }
+
+                EXPECT_EQ(header.requestId, 21u);
+                ASSERT_EQ(header.count, payloads.size());
+                buffers.resize(header.count);
+                for (int i = 0; i < header.count; i++) {
+                    buffers[i].resize(received[i].size);
+                    recvIov[i].iov_base = buffers[i].data();
+                    recvIov[i].iov_len = buffers[i].size();
+                }
+                payloadPending = true;
+            }
+
+            ret = server->TryRecvPayload(recvIov, header.count);
+            if (ret == -EAGAIN) {
+                break;
+            }
+            ASSERT_EQ(ret, 0);
+            EXPECT_TRUE(buffers == payloads);
+            payloadPending = false;
+            frames++;
+        }
+    }
+
+    EXPECT_EQ(frames, 2);
+    EXPECT_FALSE(payloadPending);
+    EXPECT_EQ(server->TryRecvHeader(header, received), -EAGAIN);
+
+    // NOTE:
+    // The peer is closed in the middle of a frame
+    ASSERT_EQ(write(raw, bytes.data(), 3), 3);
+    close(raw);
+    client->Destroy();
+    EXPECT_EQ(server->TryRecvHeader(header, received), -ECONNRESET);
+
+    close(captured);
+    capture->Destroy();
+    unused->Destroy();
+    server->Destroy();
+}
+
+// NOTE:
+// Receive a frame which is written to the server already, by the blocking or the incremental calls
+static int RecvWritten(TensorChannel *server, bool incremental, uint64_t &requestId, std::vector<std::vector<uint8_t>> &payloads)
+{
+    if (incremental == false) {
+        return RecvFrame(server, requestId, payloads);
+    }
+
+    TensorChannel::Header header;
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    struct iovec iov[TensorChannel::MAX_TENSORS];
+    int ret;
+
+    do {
+        ret = server->TryRecvHeader(header, desc);
+    } while (ret == -EAGAIN);
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    requestId = header.requestId;
+    payloads.resize(header.count);
+    for (int i = 0; i < header.count; i++) {
+        payloads[i].resize(desc[i].size);
+        iov[i].iov_base = payloads[i].data();
+        iov[i].iov_len = payloads[i].size();
+    }
+
+    if (header.count == 0) {
+        return 0;
+    }
+
+    do {
+        ret = server->TryRecvPayload(iov, header.count);
+    } while (ret == -EAGAIN);
+
+    return ret;
+}
+
+// NOTE:
+// The bytes of the sealed frames which are sent by the client (initiator), the salt comes first.
+// The frames have the requestId from 0, and the canceled frame of the requestId 100 follows them if it is given.
+static void CaptureSealed(FakeAuthenticator &auth, const std::vector<std::vector<uint8_t>> &payloads, int frames, bool cancel, std::vector<uint8_t> &bytes)
+{
+    TensorChannel *capture;
+    TensorChannel *unused;
+    int captured;
+
+    CreateStreamPair(capture, unused, captured);
+    ASSERT_FALSE(::testing::Test::HasFatalFailure());
+    ASSERT_EQ(capture->SetSecret(&auth, "session key", true), 0);
+
+    TensorChannel::Descriptor desc[TensorChannel::MAX_TENSORS];
+    struct iovec iov[TensorChannel::MAX_TENSORS];
+    for (size_t i = 0; i < payloads.size(); i++) {
+        TensorChannel::FillDescriptor(desc[i], BEYOND_TENSOR_TYPE_UINT8, payloads[i].size(), nullptr);
+        iov[i].iov_base = const_cast<uint8_t *>(payloads[i].data());
+        iov[i].iov_len = payloads[i].size();
+    }
+
+    for (int i = 0; i < frames; i++) {
+        ASSERT_EQ(capture->Send(i, desc, iov, static_cast<int>(payloads.size())), 0);
+    }
+
+    if (cancel == true) {
+        ASSERT_EQ(capture->Cancel(100), 0);
+    }
+
+    RecvRaw(unused->GetHandle(), bytes);
+
+    close(captured);
+    capture->Destroy();
+    unused->Destroy();
+}
+
+static size_t GetSealedFrameSize(const std::vector<std::vector<uint8_t>> &payloads)
+{
+    size_t size = sizeof(TensorChannel::Header) + sizeof(TensorChannel::Descriptor) * payloads.size() + CipherInterface::TAG_SIZE;
+    for (const std::vector<uint8_t> &payload : payloads) {
+        size += payload.size();
+    }
+    return size;
+}
+
+TEST(TensorChannel, PositiveSealedRoundTrip)
+{
+    FakeAuthenticator auth;
+    TensorChannel *client;
+    TensorChannel *server;
+    int raw;
+
+    CreateStreamPair(client, server, raw);
+    ASSERT_FALSE(HasFatalFailure());
+
+    EXPECT_EQ(client->SetSecret(nullptr, "session key", true), -EINVAL);
+    EXPECT_EQ(client->SetSecret(&auth, "", true), -EINVAL);
+    ASSERT_EQ(client->SetSecret(&auth, "session key", true), 0);
+    ASSERT_EQ(server->SetSecret(&auth, "session key", false), 0);
+    EXPECT_EQ(server->SetSecret(&auth, "session key", false), -EALREADY);
+
+    // NOTE:
+    // The payload which is larger than the SEAL_CHUNK_SIZE is sealed by chunks
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(TensorChannel::SEAL_CHUNK_SIZE + 4096 + 3, 15));
+    payloads.push_back(MakePayload(1, 16));
+    payloads.push_back(MakePayload(0, 17));
+
+    Sender sender = {
+        .channel = client,
+        .payloads = &payloads,
+        .frames = 4,
+        .failed = 0,
+    };
+
+    pthread_t thid;
+    ASSERT_EQ(pthread_create(&thid, nullptr, SendMain, static_cast<void *>(&sender)), 0);
+
+    for (int i = 0; i < sender.frames; i++) {
+        uint64_t requestId = 0;
+        std::vector<std::vector<uint8_t>> received;
+
+        ASSERT_EQ(RecvFrame(server, requestId, received), 0);
+        EXPECT_EQ(requestId, static_cast<uint64_t>(i));
+        EXPECT_TRUE(received == payloads);
+    }
+
+    EXPECT_EQ(pthread_join(thid, nullptr), 0);
+    EXPECT_EQ(sender.failed, 0);
+
+    // NOTE:
+    // The results are sealed by the other direction of the same key
+    TensorChannel::Descriptor desc;
+    std::vector<uint8_t> result = MakePayload(1000, 18);
+    struct iovec iov = {
+        .iov_base = result.data(),
+        .iov_len = result.size(),
+    };
+    TensorChannel::FillDescriptor(desc, BEYOND_TENSOR_TYPE_UINT8, result.size(), nullptr);
+    ASSERT_EQ(server->Send(7, &desc, &iov, 1), 0);
+    ASSERT_EQ(server->Cancel(8), 0);
+
+    uint64_t requestId = 0;
+    std::vector<std::vector<uint8_t>> received;
+    ASSERT_EQ(RecvFrame(client, requestId, received), 0);
+    EXPECT_EQ(requestId, 7u);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_TRUE(received[0] == result);
+
+    ASSERT_EQ(RecvFrame(client, requestId, received), 0);
+    EXPECT_EQ(requestId, 8u);
+    EXPECT_TRUE(received.empty());
+
+    close(raw);
+    client->Destroy();
+    server->Destroy();
+
+    // NOTE:
+    // The payloads are not on the wire as they are
+    std::vector<uint8_t> bytes;
+    payloads.clear();
+    payloads.push_back(MakePayload(1000, 19));
+    CaptureSealed(auth, payloads, 1, false, bytes);
+    ASSERT_FALSE(HasFatalFailure());
+    ASSERT_EQ(bytes.size(), TensorChannel::SALT_SIZE + GetSealedFrameSize(payloads));
+    EXPECT_EQ(std::search(bytes.begin(), bytes.end(), payloads[0].begin(), payloads[0].begin() + 64), bytes.end());
+}
+
+TEST(TensorChannel, NegativeSealedTampered)
+{
+    FakeAuthenticator auth;
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(1000, 20));
+    payloads.push_back(MakePayload(77, 21));
+
+    std::vector<uint8_t> bytes;
+    CaptureSealed(auth, payloads, 1, false, bytes);
+    ASSERT_FALSE(HasFatalFailure());
+    ASSERT_EQ(bytes.size(), TensorChannel::SALT_SIZE + GetSealedFrameSize(payloads));
+
+    size_t header = TensorChannel::SALT_SIZE;
+    size_t payload = header + sizeof(TensorChannel::Header) + sizeof(TensorChannel::Descriptor) * payloads.size();
+    size_t positions[] = {
+        header + offsetof(TensorChannel::Header, requestId), // the header is authenticated
+        payload + 500, // the payload
+        bytes.size() - 1, // the tag
+    };
+
+    for (bool incremental : { false, true }) {
+        for (size_t position : positions) {
+            TensorChannel *client;
+            TensorChannel *server;
+            int raw;
+
+            CreateStreamPair(client, server, raw);
+            ASSERT_FALSE(HasFatalFailure());
+            ASSERT_EQ(server->SetSecret(&auth, "session key", false), 0);
+
+            std::vector<uint8_t> tampered = bytes;
+            tampered[position] ^= 0x01;
+            ASSERT_EQ(write(raw, tampered.data(), tampered.size()), static_cast<ssize_t>(tampered.size()));
+
+            uint64_t requestId = 0;
+            std::vector<std::vector<uint8_t>> received;
+            EXPECT_EQ(RecvWritten(server, incremental, requestId, received), -EBADMSG) << position;
+
+            close(raw);
+            client->Destroy();
+            server->Destroy();
+        }
+    }
+}
+
+TEST(TensorChannel, NegativeSealedReplay)
+{
+    FakeAuthenticator auth;
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(300, 22));
+
+    std::vector<uint8_t> bytes;
+    CaptureSealed(auth, payloads, 2, false, bytes);
+    ASSERT_FALSE(HasFatalFailure());
+
+    size_t frameSize = GetSealedFrameSize(payloads);
+    ASSERT_EQ(bytes.size(), TensorChannel::SALT_SIZE + frameSize * 2);
+
+    std::vector<uint8_t> salt(bytes.begin(), bytes.begin() + TensorChannel::SALT_SIZE);
+    std::vector<uint8_t> first(bytes.begin() + TensorChannel::SALT_SIZE, bytes.begin() + TensorChannel::SALT_SIZE + frameSize);
+    std::vector<uint8_t> second(bytes.begin() + TensorChannel::SALT_SIZE + frameSize, bytes.end());
+
+    for (bool incremental : { false, true }) {
+        // NOTE:
+        // The first frame is replayed, and the second one is given before the first one
+        std::vector<std::vector<uint8_t>> streams[] = {
+            { salt, first, first },
+            { salt, second },
+        };
+        int authentic[] = { 1, 0 };
+
+        for (int i = 0; i < 2; i++) {
+            TensorChannel *client;
+            TensorChannel *server;
+            int raw;
+
+            CreateStreamPair(client, server, raw);
+            ASSERT_FALSE(HasFatalFailure());
+            ASSERT_EQ(server->SetSecret(&auth, "session key", false), 0);
+
+            for (const std::vector<uint8_t> &part : streams[i]) {
+                ASSERT_EQ(write(raw, part.data(), part.size()), static_cast<ssize_t>(part.size()));
+            }
+
+            uint64_t requestId = 0;
+            std::vector<std::vector<uint8_t>> received;
+            for (int j = 0; j < authentic[i]; j++) {
+                EXPECT_EQ(RecvWritten(server, incremental, requestId, received), 0);
+                EXPECT_EQ(requestId, static_cast<uint64_t>(j));
+                EXPECT_TRUE(received == payloads);
+            }
+            EXPECT_EQ(RecvWritten(server, incremental, requestId, received), -EBADMSG);
+
+            close(raw);
+            client->Destroy();
+            server->Destroy();
+        }
+    }
+}
+
+TEST(TensorChannel, PositiveSealedIncremental)
+{
+    FakeAuthenticator auth;
+    TensorChannel *client;
+    TensorChannel *server;
+    int raw;
+
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.push_back(MakePayload(1000, 23));
+    payloads.push_back(MakePayload(0, 24));
+    payloads.push_back(MakePayload(77, 25));
+
+    std::vector<uint8_t> bytes;
+    CaptureSealed(auth, payloads, 1, true, bytes);
+    ASSERT_FALSE(HasFatalFailure());
+    ASSERT_EQ(bytes.size(), TensorChannel::SALT_SIZE + GetSealedFrameSize(payloads) + sizeof(TensorChannel::Header) + CipherInterface::TAG_SIZE);
+
+    CreateStreamPair(client, server, raw);
+    ASSERT_FALSE(HasFatalFailure());
+    ASSERT_EQ(server->SetSecret(&auth, "session key", false), 0);
+
+    // NOTE:
+    // The salt, the frame and the canceled frame are fed a few bytes at a time
+    TensorChannel::Header header = {};
+    TensorChannel::Descriptor received[TensorChannel::MAX_TENSORS];
+    std::vector<std::vector<uint8_t>> buffers;
+    struct iovec recvIov[TensorChannel::MAX_TENSORS];
+    int frames = 0;
+    bool payloadPending = false;
+
+    for (size_t offset = 0; offset < bytes.size(); offset += 7) {
+        size_t len = std::min(static_cast<size_t>(7), bytes.size() - offset);
+        ASSERT_EQ(write(raw, bytes.data() + offset, len), static_cast<ssize_t>(len));
+
+        while (true) {
+            int ret;
+
+            if (payloadPending == false) {
+                ret = server->TryRecvHeader(header, received);
+                if (ret == -EAGAIN) {
+                    break;
+                }
+                ASSERT_EQ(ret, 0);
+
+                if (header.count == 0) {
+                    EXPECT_EQ(header.requestId, 100u);
+                    frames++;
+                    continue;
+                }
+
+                EXPECT_EQ(header.requestId, 0u);
+                ASSERT_EQ(header.count, payloads.size());
+                buffers.resize(header.count);
+                for (int i = 0; i < header.count; i++) {
+                    buffers[i].resize(received[i].size);
+                    recvIov[i].iov_base = buffers[i].data();
+                    recvIov[i].iov_len = buffers[i].size();
+                }
+                payloadPending = true;
+            }
+
+            ret = server->TryRecvPayload(recvIov, header.count);
+            if (ret == -EAGAIN) {
+                break;
+            }
+            ASSERT_EQ(ret, 0);
+            EXPECT_TRUE(buffers == payloads);
+            payloadPending = false;
+            frames++;
+        }
+    }
+
+    EXPECT_EQ(frames, 2);
+    EXPECT_FALSE(payloadPending);
+    EXPECT_EQ(server->TryRecvHeader(header, received), -EAGAIN);
+
+    close(raw);
+    client->Destroy();
+    server->Destroy();
+}
@@ -17,16 +17,50 @@
 #ifndef __BEYOND_RUNTIME_TFLITE_H__
 #define __BEYOND_RUNTIME_TFLITE_H__
 
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
+#include <sched.h>
 #include "tensorflow/lite/model.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/builtin_op_data.h"
 #include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/schema/schema_generated.h"
 
 class Runtime final : public beyond::InferenceInterface::RuntimeInterface {
 public:
     static constexpr const char *NAME = "runtime_tflite";
-    static Runtime *Create(void);
+
+    // NOTE:
+    // Maximum number of the split candidates which are generated by the SplitModel().
+    // The edge mode uploads the tail of each candidate to the peer for measuring it.
+    static constexpr int SPLIT_MAX_CANDIDATES = 4;
+
+    // NOTE:
+    // Alignment of the buffers which are bound to the interpreter without copying them,
+    // it is the kDefaultTensorAlignment of the tflite.
+    static constexpr size_t TENSOR_ALIGNMENT = 64;
+
+    // NOTE:
+    // If the outputView is true, GetOutput() returns the buffers which the interpreter has written the outputs to
+    // instead of copying them. The view is valid until it is released by the FreeTensor(),
+    // the next Invoke() writes to another set of the buffers meanwhile.
+    //
+    // The accelerator selects the delegate which is applied to the interpreter.
+    // The GPU and the NNAPI delegates are only available if the tensorflow-lite is built with them,
+    // otherwise the interpreter falls back to the CPU.
+    enum Accelerator {
+        ACCEL_NONE = 0, // Builtin CPU kernels
+        ACCEL_XNNPACK,  // XNNPACK delegate, the CPU accelerator
+        ACCEL_GPU,      // GPU delegate
+        ACCEL_NNAPI,    // NNAPI delegate, the NPU accelerator of the Android
+    };
+
+    // NOTE:
+    // The numThreads and the accelerator are the defaults of the interpreter options,
+    // they can be overridden by the Configure() with a JSON configuration.
+    static Runtime *Create(bool outputView = false, int numThreads = -1, Accelerator accelerator = ACCEL_NONE);
 
 public: // module interface
     const char *GetModuleName(void) const override;
@@ -58,11 +92,37 @@ public: // inference interface
 
     int Stop(void) override;
 
+public: // runtime interface
+    int SplitModel(const char *model, std::vector<std::string> &models) override;
+
 private:
     Runtime(void) = default;
     ~Runtime(void) = default;
 
     static beyond_tensor_type ConvertType(int type);
+    static int GetElementSize(tflite::TensorType type);
+
+    int ConfigureJSON(void *object);
+    int BuildInterpreter(void);
+    int ApplyInterpreterOptions(void);
+    int CreateDelegate(void);
+    void DeleteDelegate(void);
+    void PinThread(void);
+    void UnpinThread(void);
+
+    static int ReadModelFile(const char *path, std::vector<uint8_t> &buffer);
+    static void FindSplitBoundaries(const tflite::ModelT &model, std::vector<std::pair<int, int>> &boundaries);
+    static int WriteSplitModel(const std::vector<uint8_t> &buffer, int boundary, int tensor, bool head, std::string &path);
+
+    int PrepareInputBinding(void);
+    int BindInput(int idx, const beyond_tensor &input);
+    void ReleaseInputBinding(void);
+
+    int PrepareOutputBinding(void);
+    int BindOutputView(void);
+    int AllocateView(beyond_tensor *&view);
+    void ReleaseOutputBinding(void);
+    int GetOutputView(beyond_tensor *&tensor, int &size);
     //    static bool IsCancelled(void *data);
 
     std::unique_ptr<tflite::FlatBufferModel> model;
@@ -75,7 +135,51 @@ private:
     beyond_tensor_info *outputTensorInfo;
     int outputTensorInfoSize;
 
+    // NOTE:
+    // The input tensors of the interpreter are bound to the buffers of the caller by the custom allocations.
+    // An input which is not aligned is copied to the staging buffer of this runtime, and it is bound instead.
+    // The staging buffers are bound when the model is loaded, they must outlive the interpreter.
+    bool inputBinding;
+    std::vector<void *> boundInputs;
+    std::vector<void *> stagingInputs;
+
+    // NOTE:
+    // The output tensors of the interpreter are bound to a view by the custom allocations.
+    // A view is a single block of the tensor array and its aligned buffers, the free() releases it at once.
+    // Once the GetOutput() hands the bound view out, the next Invoke() binds another one from the viewPool,
+    // so the interpreter never writes to the view which is held by the caller.
+    // The views which are made for the previous model are not reused, the viewGeneration tells them.
+    bool outputView;
+    bool outputBinding;
+    beyond_tensor *boundView;                          // The view which the next Invoke() writes to
+    std::vector<beyond_tensor *> viewPool;             // Released views, they are bound again
+    std::map<beyond_tensor *, unsigned int> heldViews; // Views which are held by the caller, and their generation
+    unsigned int viewGeneration;
+
+    // NOTE:
+    // Interpreter options, they are applied when a model is loaded.
+    int numThreads;           // -1 lets the tflite decide it
+    Accelerator accelerator;  // Delegate which is applied to the interpreter
+    bool affinity;            // Pin the interpreter threads to the affinityMask
+#if !defined(__APPLE__)
+    cpu_set_t affinityMask;
+#endif
+    TfLiteDelegate *delegate;
+    Accelerator delegateAccel; // Accelerator of the delegate which is currently created
+
+    // NOTE:
+    // The affinity which is applied to the interpreter that is currently loaded.
+    // The caller's own affinity is kept in the callerMask while it builds the interpreter.
+    bool pinning;
+    bool callerPinned;
+#if !defined(__APPLE__)
+    cpu_set_t pinningMask;
+    cpu_set_t callerMask;
+#endif
+
     bool stop;
+
+    std::vector<std::string> splitFiles; // Models which are generated by the SplitModel(), they are removed on the Destroy()
 };
 
 #endif // __BEYOND_RUNTIME_TFLITE_H__
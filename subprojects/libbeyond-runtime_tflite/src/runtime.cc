@@ -15,8 +15,16 @@
  */
 
 #include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
 
 #include <getopt.h>
+#include <sched.h>
+#include <unistd.h>
 
 #include <beyond/platform/beyond_platform.h>
 #include <beyond/private/beyond_private.h>
@@ -25,10 +33,22 @@
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/builtin_op_data.h"
 #include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#if defined(BEYOND_TFLITE_XNNPACK)
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#endif
+#if defined(BEYOND_TFLITE_GPU)
+#include "tensorflow/lite/delegates/gpu/delegate.h"
+#endif
+#if defined(BEYOND_TFLITE_NNAPI)
+#include "tensorflow/lite/delegates/nnapi/nnapi_delegate.h"
+#endif
+
+#include <json/json.h>
 
 #include "runtime.h"
 
-Runtime *Runtime::Create(void)
+Runtime *Runtime::Create(bool outputView, int numThreads, Accelerator accelerator)
 {
     Runtime *runtime;
 
@@ -39,6 +59,18 @@ Runtime *Runtime::Create(void)
     }
 
     runtime->stop = false;
+    runtime->inputBinding = false;
+    runtime->outputView = outputView;
+    runtime->outputBinding = false;
+    runtime->boundView = nullptr;
+    runtime->viewGeneration = 0;
+    runtime->numThreads = numThreads;
+    runtime->accelerator = accelerator;
+    runtime->affinity = false;
+    runtime->delegate = nullptr;
+    runtime->delegateAccel = ACCEL_NONE;
+    runtime->pinning = false;
+    runtime->callerPinned = false;
 
     return runtime;
 }
@@ -58,6 +90,19 @@ void Runtime::Destroy(void)
     interpreter = nullptr;
     model = nullptr;
 
+    // NOTE:
+    // The delegate, the staging buffers and the views must outlive the interpreter which uses them
+    DeleteDelegate();
+    ReleaseInputBinding();
+    ReleaseOutputBinding();
+
+    // NOTE:
+    // The caller is not able to release the views after destroying the runtime
+    for (auto &it : heldViews) {
+        free(it.first);
+    }
+    heldViews.clear();
+
     if (inputTensorInfo != nullptr && inputTensorInfoSize > 0) {
         while (inputTensorInfoSize-- > 0) {
             free(inputTensorInfo[inputTensorInfoSize].dims);
@@ -76,16 +121,319 @@ void Runtime::Destroy(void)
         outputTensorInfo = nullptr;
     }
 
+    for (size_t i = 0; i < splitFiles.size(); i++) {
+        if (unlink(splitFiles[i].c_str()) < 0) {
+            ErrPrintCode(errno, "unlink");
+        }
+    }
+    splitFiles.clear();
+
     delete this;
 }
 
 int Runtime::Configure(const beyond_config *options)
 {
-    // TODO:
-    // nnapi, edgetpu and several kinds of delegators could be configured using this method
+    if (options == nullptr) {
+        return 0;
+    }
+
+    int ret = 0;
+    switch (options->type) {
+    case BEYOND_CONFIG_TYPE_JSON:
+        ret = ConfigureJSON(options->object);
+        break;
+    default:
+        // TODO:
+        // nnapi, edgetpu and several kinds of delegators could be configured using this method
+        break;
+    }
+
+    return ret;
+}
+
+int Runtime::ConfigureJSON(void *object)
+{
+    if (object == nullptr) {
+        ErrPrint("Invalid JSON configuration");
+        return -EINVAL;
+    }
+
+    Json::Value root;
+    std::string errors;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+
+    if (reader == nullptr) {
+        ErrPrint("Unable to create a json reader");
+        return -EFAULT;
+    }
+
+    const char *jsonStr = static_cast<char *>(object);
+    bool jsonParseStatus = reader->parse(jsonStr, jsonStr + strlen(jsonStr), &root, &errors);
+    if (jsonParseStatus == false) {
+        ErrPrint("Failed to parse the json string: %s", jsonStr);
+        return -EINVAL;
+    }
+
+    if (errors.empty() == false) {
+        ErrPrint("Failed to parse the JSON string: %s", errors.c_str());
+        return -EFAULT;
+    }
+
+    /*
+     * NOTE: Sample JSON configuration ("tflite")
+     *
+     * {
+     *    "tflite": {
+     *       "threads": 4,
+     *       "xnnpack": true,
+     *       "affinity": [ 4, 5, 6, 7 ]
+     *    }
+     * }
+     *
+     * The options are applied when the next model is loaded.
+     * "xnnpack": false turns the XNNPACK delegate off, the other accelerators are kept.
+     * An empty "affinity" array releases the interpreter threads from pinning, they are allowed to run on all CPUs.
+     */
+    const Json::Value &tflite = root["tflite"];
+    if (tflite.empty() == true) {
+        return 0;
+    }
+
+    int _numThreads = numThreads;
+    const Json::Value &threadsValue = tflite["threads"];
+    if (threadsValue.isNull() == false) {
+        if (threadsValue.isInt() == false || threadsValue.asInt() == 0 || threadsValue.asInt() < -1) {
+            ErrPrint("Invalid number of threads");
+            return -EINVAL;
+        }
+        _numThreads = threadsValue.asInt();
+    }
+
+    Accelerator _accelerator = accelerator;
+    const Json::Value &xnnpackValue = tflite["xnnpack"];
+    if (xnnpackValue.isNull() == false) {
+        if (xnnpackValue.isBool() == false) {
+            ErrPrint("Invalid xnnpack option");
+            return -EINVAL;
+        }
+
+        if (xnnpackValue.asBool() == true) {
+            _accelerator = ACCEL_XNNPACK;
+        } else if (_accelerator == ACCEL_XNNPACK) {
+            _accelerator = ACCEL_NONE;
+        }
+    }
+
+    const Json::Value &affinityValue = tflite["affinity"];
+    if (affinityValue.isNull() == false) {
+        if (affinityValue.isArray() == false) {
+            ErrPrint("Invalid affinity option");
+            return -EINVAL;
+        }
+
+#if defined(__APPLE__)
+        if (affinityValue.empty() == false) {
+            ErrPrint("CPU affinity is not supported");
+            return -ENOTSUP;
+        }
+#else
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (const Json::Value &cpuValue : affinityValue) {
+            if (cpuValue.isInt() == false || cpuValue.asInt() < 0 || cpuValue.asInt() >= CPU_SETSIZE) {
+                ErrPrint("Invalid CPU index in the affinity option");
+                return -EINVAL;
+            }
+            CPU_SET(cpuValue.asInt(), &mask);
+        }
+
+        if (CPU_COUNT(&mask) == 0) {
+            // NOTE:
+            // The threads which are already pinned do not get released by themselves,
+            // reset them to the full mask. The kernel drops the CPUs which are not allowed.
+            long count = sysconf(_SC_NPROCESSORS_CONF);
+            for (long i = 0; i < count && i < CPU_SETSIZE; i++) {
+                CPU_SET(i, &mask);
+            }
+        }
+
+        affinity = (CPU_COUNT(&mask) > 0);
+        affinityMask = mask;
+#endif
+    }
+
+    numThreads = _numThreads;
+    accelerator = _accelerator;
+
+    DbgPrint("threads: %d, accelerator: %d, affinity: %d", numThreads, static_cast<int>(accelerator), static_cast<int>(affinity));
+    return 0;
+}
+
+void Runtime::PinThread(void)
+{
+    // NOTE:
+    // The tflite (and the delegates) spawns its pool threads from the thread which builds the interpreter
+    // or invokes it, and those threads inherit the affinity of their creator.
+    // The LoadModel() pins the calling thread only while it builds and warms up the interpreter,
+    // and gives its own affinity back by the UnpinThread(), therefore the pool threads are the ones which keep the mask.
+    // The interpreter and its pools are rebuilt by the LoadModel(), a new mask never meets the threads of the old one.
+    if (pinning == false || callerPinned == true) {
+        return;
+    }
+
+#if !defined(__APPLE__)
+    // NOTE:
+    // The pid 0 refers the calling thread, not the whole process
+    if (sched_getaffinity(0, sizeof(callerMask), &callerMask) < 0) {
+        ErrPrintCode(errno, "sched_getaffinity");
+        return;
+    }
+
+    if (sched_setaffinity(0, sizeof(pinningMask), &pinningMask) < 0) {
+        ErrPrintCode(errno, "sched_setaffinity");
+        return;
+    }
+
+    callerPinned = true;
+#endif
+}
+
+void Runtime::UnpinThread(void)
+{
+    if (callerPinned == false) {
+        return;
+    }
+
+#if !defined(__APPLE__)
+    if (sched_setaffinity(0, sizeof(callerMask), &callerMask) < 0) {
+        ErrPrintCode(errno, "sched_setaffinity");
+    }
+#endif
+
+    callerPinned = false;
+}
+
+int Runtime::ApplyInterpreterOptions(void)
+{
+    TfLiteStatus status;
+
+    if (numThreads != -1) {
+        status = interpreter->SetNumThreads(numThreads);
+        if (status != kTfLiteOk) {
+            ErrPrint("Failed to set the number of threads: %d", static_cast<int>(status));
+            return -EFAULT;
+        }
+    }
+
+    int ret = CreateDelegate();
+    if (ret < 0 || delegate == nullptr) {
+        return ret;
+    }
+
+    status = interpreter->ModifyGraphWithDelegate(delegate);
+    if (status != kTfLiteOk) {
+        ErrPrint("Failed to apply the delegate(%d): %d", static_cast<int>(delegateAccel), static_cast<int>(status));
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int Runtime::CreateDelegate(void)
+{
+    switch (accelerator) {
+    case ACCEL_XNNPACK:
+#if defined(BEYOND_TFLITE_XNNPACK)
+    {
+        TfLiteXNNPackDelegateOptions xnnpackOptions = TfLiteXNNPackDelegateOptionsDefault();
+        if (numThreads > 0) {
+            xnnpackOptions.num_threads = numThreads;
+        }
+
+        delegate = TfLiteXNNPackDelegateCreate(&xnnpackOptions);
+        break;
+    }
+#else
+        // NOTE:
+        // The tensorflow-lite is built without the XNNPACK,
+        // keep going with the builtin kernels rather than failing to load the model.
+        InfoPrint("XNNPACK delegate is not supported, use the builtin kernels");
+        return 0;
+#endif
+    case ACCEL_GPU:
+#if defined(BEYOND_TFLITE_GPU)
+    {
+        TfLiteGpuDelegateOptionsV2 gpuOptions = TfLiteGpuDelegateOptionsV2Default();
+        delegate = TfLiteGpuDelegateV2Create(&gpuOptions);
+        break;
+    }
+#else
+        // NOTE:
+        // The accelerators which are not built in fall back to the CPU accelerator,
+        // the model is still able to be served by this runtime.
+        ErrPrint("GPU delegate is not supported, fall back to the CPU");
+        accelerator = ACCEL_XNNPACK;
+        return CreateDelegate();
+#endif
+    case ACCEL_NNAPI:
+#if defined(BEYOND_TFLITE_NNAPI)
+        try {
+            delegate = new tflite::StatefulNnApiDelegate();
+        } catch (std::exception &e) {
+            ErrPrint("new failed: %s", e.what());
+            return -ENOMEM;
+        }
+        break;
+#else
+        ErrPrint("NNAPI delegate is not supported, fall back to the CPU");
+        accelerator = ACCEL_XNNPACK;
+        return CreateDelegate();
+#endif
+    case ACCEL_NONE:
+    default:
+        return 0;
+    }
+
+    if (delegate == nullptr) {
+        ErrPrint("Failed to create the delegate(%d)", static_cast<int>(accelerator));
+        return -EFAULT;
+    }
+
+    delegateAccel = accelerator;
     return 0;
 }
 
+void Runtime::DeleteDelegate(void)
+{
+    if (delegate == nullptr) {
+        return;
+    }
+
+    switch (delegateAccel) {
+#if defined(BEYOND_TFLITE_XNNPACK)
+    case ACCEL_XNNPACK:
+        TfLiteXNNPackDelegateDelete(delegate);
+        break;
+#endif
+#if defined(BEYOND_TFLITE_GPU)
+    case ACCEL_GPU:
+        TfLiteGpuDelegateV2Delete(delegate);
+        break;
+#endif
+#if defined(BEYOND_TFLITE_NNAPI)
+    case ACCEL_NNAPI:
+        delete static_cast<tflite::StatefulNnApiDelegate *>(delegate);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    delegate = nullptr;
+    delegateAccel = ACCEL_NONE;
+}
+
 int Runtime::LoadModel(const char *model)
 {
     if (access(model, R_OK) < 0) {
@@ -99,14 +447,54 @@ int Runtime::LoadModel(const char *model)
         return -EIO;
     }
 
+    // NOTE:
+    // The delegate, the staging buffers and the views must outlive the interpreter which uses them,
+    // release the previous interpreter first.
+    // The views which are held by the caller are still valid, they are freed when they are released.
+    interpreter = nullptr;
+    DeleteDelegate();
+    ReleaseInputBinding();
+    ReleaseOutputBinding();
+
+    // NOTE:
+    // The new interpreter and its delegate spawn their threads with the current affinity option
+    pinning = affinity;
+#if !defined(__APPLE__)
+    pinningMask = affinityMask;
+#endif
+    PinThread();
+
+    int ret = BuildInterpreter();
+
+    UnpinThread();
+
+    if (ret < 0) {
+        interpreter = nullptr;
+        DeleteDelegate();
+        ReleaseInputBinding();
+        ReleaseOutputBinding();
+        this->model = nullptr;
+        return ret;
+    }
+
+    return 0;
+}
+
+int Runtime::BuildInterpreter(void)
+{
     TfLiteStatus status = tflite::InterpreterBuilder(*this->model, resolver)(&interpreter);
     if (status != kTfLiteOk) {
-        this->model = nullptr;
+        ErrPrint("Failed to build an interpreter: %d", static_cast<int>(status));
         return -EFAULT;
     }
 
     // interpreter->UseNNAPI(false);
 
+    int ret = ApplyInterpreterOptions();
+    if (ret < 0) {
+        return ret;
+    }
+
     // NOTE:
     // The tensor buffers should be allocated after loading a model,
     // or if there is a change on the input or the output tensor using Set{In|Out}putTensorInfo() method.
@@ -116,9 +504,266 @@ int Runtime::LoadModel(const char *model)
         return -EFAULT;
     }
 
+    ret = PrepareInputBinding();
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = PrepareOutputBinding();
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (inputBinding == true || outputBinding == true) {
+        // NOTE:
+        // The arena of the interpreter is planned again without the bound tensors.
+        // After that, the Invoke() only switches the bound buffers.
+        status = interpreter->AllocateTensors();
+        if (status != kTfLiteOk) {
+            ErrPrint("Failed to allocate tensors: %d", static_cast<int>(status));
+            return -EFAULT;
+        }
+    }
+
+    if (pinning == true) {
+        // NOTE:
+        // The builtin kernels spawn their pool threads on the first invocation.
+        // Invoke the interpreter once while the caller is pinned, so the pool threads inherit the mask
+        // and the Invoke() does not have to touch the affinity of the caller at all.
+        for (size_t i = 0; i < interpreter->inputs().size(); i++) {
+            TfLiteTensor *tensorPtr = interpreter->tensor(interpreter->inputs()[i]);
+            memset(tensorPtr->data.raw, 0, tensorPtr->bytes);
+        }
+
+        status = interpreter->Invoke();
+        if (status != kTfLiteOk) {
+            ErrPrint("Failed to warm up the interpreter: %d", static_cast<int>(status));
+            return -EFAULT;
+        }
+    }
+
     return 0;
 }
 
+int Runtime::PrepareInputBinding(void)
+{
+    inputBinding = false;
+
+#if defined(BEYOND_TFLITE_CUSTOM_ALLOCATION)
+    size_t count = interpreter->inputs().size();
+    for (size_t i = 0; i < count; i++) {
+        TfLiteTensor *tensorPtr = interpreter->tensor(interpreter->inputs()[i]);
+        if (tensorPtr->allocation_type != kTfLiteArenaRw) {
+            // NOTE:
+            // e.g. the dynamic tensors, they are copied on the Invoke()
+            DbgPrint("Input tensor[%zu] is not able to be bound: %d", i, static_cast<int>(tensorPtr->allocation_type));
+            return 0;
+        }
+    }
+
+    boundInputs.assign(count, nullptr);
+    stagingInputs.assign(count, nullptr);
+
+    // NOTE:
+    // The staging buffers are bound first, the LoadModel() plans the arena of the interpreter again after that.
+    for (size_t i = 0; i < count; i++) {
+        int tensorIdx = interpreter->inputs()[i];
+        TfLiteTensor *tensorPtr = interpreter->tensor(tensorIdx);
+
+        int status = posix_memalign(&stagingInputs[i], TENSOR_ALIGNMENT, tensorPtr->bytes > 0 ? tensorPtr->bytes : TENSOR_ALIGNMENT);
+        if (status != 0) {
+            ErrPrintCode(status, "posix_memalign");
+            stagingInputs[i] = nullptr;
+            return -status;
+        }
+
+        TfLiteCustomAllocation allocation = {
+            .data = stagingInputs[i],
+            .bytes = tensorPtr->bytes,
+        };
+        if (interpreter->SetCustomAllocationForTensor(tensorIdx, allocation) != kTfLiteOk) {
+            ErrPrint("Failed to bind the input tensor[%zu]", i);
+            return -EFAULT;
+        }
+
+        boundInputs[i] = stagingInputs[i];
+    }
+
+    inputBinding = true;
+#endif
+    return 0;
+}
+
+// NOTE:
+// The interpreter reads the buffer of the caller directly if it is aligned as the tflite requires.
+// The buffers which are allocated by the AllocateTensor() are always aligned.
+// The others are copied to the staging buffer of this runtime, and it is bound instead.
+// The caller keeps the input until the request is done, so the bound buffer is not changed while the interpreter uses it,
+// even if the requests are pipelined or run by the other workers which have their own interpreters.
+int Runtime::BindInput(int idx, const beyond_tensor &input)
+{
+#if defined(BEYOND_TFLITE_CUSTOM_ALLOCATION)
+    void *data = input.data;
+    if (reinterpret_cast<uintptr_t>(data) % TENSOR_ALIGNMENT != 0) {
+        memcpy(stagingInputs[idx], input.data, input.size);
+        data = stagingInputs[idx];
+    }
+
+    if (boundInputs[idx] == data) {
+        return 0;
+    }
+
+    TfLiteCustomAllocation allocation = {
+        .data = data,
+        .bytes = static_cast<size_t>(input.size),
+    };
+    if (interpreter->SetCustomAllocationForTensor(interpreter->inputs()[idx], allocation) != kTfLiteOk) {
+        ErrPrint("Failed to bind the input tensor[%d]", idx);
+        return -EFAULT;
+    }
+
+    boundInputs[idx] = data;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+void Runtime::ReleaseInputBinding(void)
+{
+    for (size_t i = 0; i < stagingInputs.size(); i++) {
+        free(stagingInputs[i]);
+    }
+
+    stagingInputs.clear();
+    boundInputs.clear();
+    inputBinding = false;
+}
+
+int Runtime::PrepareOutputBinding(void)
+{
+    outputBinding = false;
+
+    if (outputView == false) {
+        return 0;
+    }
+
+#if defined(BEYOND_TFLITE_CUSTOM_ALLOCATION)
+    for (size_t i = 0; i < interpreter->outputs().size(); i++) {
+        TfLiteTensor *tensorPtr = interpreter->tensor(interpreter->outputs()[i]);
+        if (tensorPtr->allocation_type != kTfLiteArenaRw) {
+            InfoPrint("Output tensor[%zu] is not able to be bound, the outputs are copied: %d", i, static_cast<int>(tensorPtr->allocation_type));
+            return 0;
+        }
+    }
+
+    int ret = BindOutputView();
+    if (ret < 0) {
+        return ret;
+    }
+
+    outputBinding = true;
+#else
+    InfoPrint("Custom allocation is not supported, the outputs are copied");
+#endif
+    return 0;
+}
+
+// NOTE:
+// If the bound view is handed out to the caller, another one is bound instead.
+// The view which is not handed out is overwritten by the next Invoke().
+int Runtime::BindOutputView(void)
+{
+#if defined(BEYOND_TFLITE_CUSTOM_ALLOCATION)
+    if (boundView != nullptr) {
+        return 0;
+    }
+
+    beyond_tensor *view;
+    if (viewPool.empty() == false) {
+        view = viewPool.back();
+        viewPool.pop_back();
+    } else {
+        int ret = AllocateView(view);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    for (size_t i = 0; i < interpreter->outputs().size(); i++) {
+        TfLiteCustomAllocation allocation = {
+            .data = view[i].data,
+            .bytes = static_cast<size_t>(view[i].size),
+        };
+        if (interpreter->SetCustomAllocationForTensor(interpreter->outputs()[i], allocation) != kTfLiteOk) {
+            ErrPrint("Failed to bind the output tensor[%zu]", i);
+            // NOTE:
+            // The tensors which are already switched keep referring this view, it should be kept alive.
+            boundView = view;
+            return -EFAULT;
+        }
+    }
+
+    boundView = view;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+int Runtime::AllocateView(beyond_tensor *&view)
+{
+    size_t count = interpreter->outputs().size();
+    size_t offset = (sizeof(beyond_tensor) * count + TENSOR_ALIGNMENT - 1) / TENSOR_ALIGNMENT * TENSOR_ALIGNMENT;
+    size_t total = offset;
+
+    for (size_t i = 0; i < count; i++) {
+        TfLiteTensor *tensorPtr = interpreter->tensor(interpreter->outputs()[i]);
+        total += (tensorPtr->bytes + TENSOR_ALIGNMENT - 1) / TENSOR_ALIGNMENT * TENSOR_ALIGNMENT;
+    }
+
+    void *block;
+    int status = posix_memalign(&block, TENSOR_ALIGNMENT, total);
+    if (status != 0) {
+        ErrPrintCode(status, "posix_memalign");
+        return -status;
+    }
+
+    beyond_tensor *_view = static_cast<beyond_tensor *>(block);
+    uint8_t *data = static_cast<uint8_t *>(block) + offset;
+    for (size_t i = 0; i < count; i++) {
+        TfLiteTensor *tensorPtr = interpreter->tensor(interpreter->outputs()[i]);
+
+        _view[i].type = ConvertType(tensorPtr->type);
+        if (_view[i].type == BEYOND_TENSOR_TYPE_UNSUPPORTED) {
+            ErrPrint("Unsupported output tensor[%zu] type: %d", i, static_cast<int>(tensorPtr->type));
+            free(block);
+            return -ENOTSUP;
+        }
+
+        _view[i].size = tensorPtr->bytes;
+        _view[i].data = data;
+        data += (tensorPtr->bytes + TENSOR_ALIGNMENT - 1) / TENSOR_ALIGNMENT * TENSOR_ALIGNMENT;
+    }
+
+    view = _view;
+    return 0;
+}
+
+void Runtime::ReleaseOutputBinding(void)
+{
+    free(boundView);
+    boundView = nullptr;
+
+    for (size_t i = 0; i < viewPool.size(); i++) {
+        free(viewPool[i]);
+    }
+    viewPool.clear();
+
+    outputBinding = false;
+    viewGeneration++;
+}
+
 beyond_tensor_type Runtime::ConvertType(int type)
 {
     switch (type) {
@@ -291,11 +936,6 @@ int Runtime::SetOutputTensorInfo(const beyond_tensor_info *info, int size)
 
 int Runtime::AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor)
 {
-    // NOTE:
-    // Unfortunately, there is no official way to allocate tensor buffer multiple times
-    // There is, however, a way to hack the allocated tensor buffer.
-    // But for the first implementation in a general way,
-    // we are going to use heap memory even we have to copy tensor to allocated tensor buffer of the tflite.
     beyond_tensor *_tensor = static_cast<beyond_tensor *>(malloc(sizeof(beyond_tensor) * size));
     if (_tensor == nullptr) {
         int ret = -errno;
@@ -303,13 +943,18 @@ int Runtime::AllocateTensor(const beyond_tensor_info *info, int size, beyond_ten
         return ret;
     }
 
+    // NOTE:
+    // Every input tensor has its own buffers which are aligned as the tflite requires,
+    // the Invoke() binds them to the interpreter instead of copying them.
+    // The interpreter has only one set of the input buffers, handing them out to the caller
+    // lets the next input (or the invocation on another worker) overwrite the one which is still in use.
     for (int i = 0; i < size; i++) {
         _tensor[i].type = info[i].type;
         _tensor[i].size = info[i].size;
-        _tensor[i].data = malloc(info[i].size);
-        if (_tensor[i].data == nullptr) {
-            int ret = -errno;
-            ErrPrintCode(errno, "malloc for tensor.data");
+        int status = posix_memalign(&_tensor[i].data, TENSOR_ALIGNMENT, info[i].size > 0 ? info[i].size : TENSOR_ALIGNMENT);
+        if (status != 0) {
+            int ret = -status;
+            ErrPrintCode(status, "posix_memalign for tensor.data");
             while (--i >= 0) {
                 free(_tensor[i].data);
                 _tensor[i].data = nullptr;
@@ -326,6 +971,26 @@ int Runtime::AllocateTensor(const beyond_tensor_info *info, int size, beyond_ten
 
 void Runtime::FreeTensor(beyond_tensor *&tensor, int size)
 {
+    auto it = heldViews.find(tensor);
+    if (it != heldViews.end()) {
+        bool reusable = (it->second == viewGeneration && outputBinding == true);
+        heldViews.erase(it);
+
+        if (reusable == true) {
+            try {
+                viewPool.push_back(tensor);
+                tensor = nullptr;
+                return;
+            } catch (std::exception &e) {
+                ErrPrint("push_back: %s", e.what());
+            }
+        }
+
+        free(tensor);
+        tensor = nullptr;
+        return;
+    }
+
     for (int i = 0; i < size; i++) {
         free(tensor[i].data);
         tensor[i].data = nullptr;
@@ -358,22 +1023,33 @@ int Runtime::Invoke(const beyond_tensor *input, int size, const void *context)
         return -EFAULT;
     }
 
-    // TODO:
-    // If the tensorflow-lite provides a public method to change the tensor data ptr,
-    // we are able to use our beyond_tensor data ptr directly,
-    // otherwise we have to hack the tensorPtr->data.raw ptr
     for (int i = 0; i < inputSize; i++) {
         int tensorIdx = interpreter->inputs()[i];
         TfLiteTensor *tensorPtr = interpreter->tensor(tensorIdx);
 
         if (tensorPtr->bytes != static_cast<size_t>(input[i].size)) {
             ErrPrint("Tensor size mismatched: %zu\n", tensorPtr->bytes);
-            break;
+            return -EINVAL;
+        }
+
+        if (inputBinding == true) {
+            int ret = BindInput(i, input[i]);
+            if (ret < 0) {
+                return ret;
+            }
+            continue;
         }
 
         memcpy(tensorPtr->data.raw, input[i].data, tensorPtr->bytes);
     }
 
+    if (outputBinding == true) {
+        int ret = BindOutputView();
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
     //    interpreter->SetCancellationFunction(static_cast<void *>(this), IsCancelled);
     status = interpreter->Invoke();
     if (status != kTfLiteOk) {
@@ -387,6 +1063,28 @@ int Runtime::Invoke(const beyond_tensor *input, int size, const void *context)
     return 0;
 }
 
+int Runtime::GetOutputView(beyond_tensor *&tensor, int &size)
+{
+    if (boundView == nullptr) {
+        ErrPrint("There is no output to be handed out");
+        return -ENOENT;
+    }
+
+    try {
+        heldViews[boundView] = viewGeneration;
+    } catch (std::exception &e) {
+        ErrPrint("heldViews: %s", e.what());
+        return -ENOMEM;
+    }
+
+    // NOTE:
+    // The interpreter keeps referring the view until the next Invoke() binds another one,
+    // but it does not write to the view without the invocation.
+    tensor = boundView;
+    boundView = nullptr;
+    return 0;
+}
+
 int Runtime::GetOutput(beyond_tensor *&tensor, int &size)
 {
     int ret = 0;
@@ -397,6 +1095,10 @@ int Runtime::GetOutput(beyond_tensor *&tensor, int &size)
         return -EFAULT;
     }
 
+    if (outputBinding == true) {
+        return GetOutputView(tensor, size);
+    }
+
     tensor = static_cast<beyond_tensor *>(malloc(sizeof(beyond_tensor) * size));
     if (tensor == nullptr) {
         ret = -errno;
@@ -454,6 +1156,346 @@ int Runtime::Stop(void)
     return 0;
 }
 
+int Runtime::GetElementSize(tflite::TensorType type)
+{
+    switch (type) {
+    case tflite::TensorType_UINT8:
+        FALLTHROUGH;
+    case tflite::TensorType_INT8:
+        FALLTHROUGH;
+    case tflite::TensorType_BOOL:
+        return 1;
+    case tflite::TensorType_INT16:
+        FALLTHROUGH;
+    case tflite::TensorType_FLOAT16:
+        return 2;
+    case tflite::TensorType_INT32:
+        FALLTHROUGH;
+    case tflite::TensorType_FLOAT32:
+        return 4;
+    case tflite::TensorType_INT64:
+        FALLTHROUGH;
+    case tflite::TensorType_FLOAT64:
+        FALLTHROUGH;
+    case tflite::TensorType_COMPLEX64:
+        return 8;
+    default:
+        break;
+    }
+
+    return -ENOTSUP;
+}
+
+int Runtime::ReadModelFile(const char *path, std::vector<uint8_t> &buffer)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "fopen");
+        return ret;
+    }
+
+    int ret = 0;
+    long size = -1;
+    if (fseek(fp, 0L, SEEK_END) < 0 || (size = ftell(fp)) < 0) {
+        ret = -errno;
+        ErrPrintCode(errno, "fseek");
+    } else if (size == 0) {
+        ErrPrint("Empty model: %s", path);
+        ret = -EINVAL;
+    } else {
+        rewind(fp);
+
+        try {
+            buffer.resize(static_cast<size_t>(size));
+        } catch (std::exception &e) {
+            ErrPrint("resize: %s", e.what());
+            ret = -ENOMEM;
+        }
+
+        if (ret == 0 && fread(buffer.data(), 1, buffer.size(), fp) != buffer.size()) {
+            ErrPrint("Unable to read the model: %s", path);
+            ret = -EIO;
+        }
+    }
+
+    if (fclose(fp) < 0) {
+        ErrPrintCode(errno, "fclose");
+    }
+
+    return ret;
+}
+
+// NOTE:
+// A boundary is the index of the first operator of the tail,
+// the operators of a tflite model are stored in the execution order, so the head is a prefix of them.
+// The model is split only where a single tensor crosses the boundary,
+// it becomes the output of the head and the input of the tail.
+// Therefore the tail does not consume the graph inputs, and the head does not produce the graph outputs.
+// The boundaries of the smallest intermediate tensors are chosen, they are given in the execution order.
+void Runtime::FindSplitBoundaries(const tflite::ModelT &model, std::vector<std::pair<int, int>> &boundaries)
+{
+    const tflite::SubGraphT &graph = *model.subgraphs[0];
+    int count = static_cast<int>(graph.operators.size());
+    int tensorCount = static_cast<int>(graph.tensors.size());
+
+    std::vector<int> producer(tensorCount, -1); // -1 for the graph inputs and the constants
+    std::vector<int> lastUse(tensorCount, -1);  // count for the graph outputs
+    std::vector<bool> isInput(tensorCount, false);
+    std::vector<bool> isOutput(tensorCount, false);
+
+    for (int i = 0; i < tensorCount; i++) {
+        if (graph.tensors[i]->is_variable == true) {
+            // NOTE:
+            // The state of the variable tensors cannot be shared by the head and the tail
+            InfoPrint("The model has variable tensors, it is not split");
+            return;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const tflite::OperatorT &op = *graph.operators[i];
+        for (int t : op.inputs) {
+            if (t >= 0 && t < tensorCount) {
+                lastUse[t] = i;
+            }
+        }
+        for (int t : op.outputs) {
+            if (t >= 0 && t < tensorCount) {
+                producer[t] = i;
+            }
+        }
+    }
+
+    for (int t : graph.inputs) {
+        if (t >= 0 && t < tensorCount) {
+            isInput[t] = true;
+        }
+    }
+
+    for (int t : graph.outputs) {
+        if (t >= 0 && t < tensorCount) {
+            isOutput[t] = true;
+            lastUse[t] = count;
+        }
+    }
+
+    std::vector<std::pair<long long, std::pair<int, int>>> found;
+    for (int boundary = 1; boundary < count; boundary++) {
+        int crossing = -1;
+        int crossingCount = 0;
+        for (int t = 0; t < tensorCount && crossingCount < 2; t++) {
+            bool available = isInput[t] == true || (producer[t] >= 0 && producer[t] < boundary);
+            if (available == true && lastUse[t] >= boundary) {
+                crossing = t;
+                crossingCount++;
+            }
+        }
+
+        if (crossingCount != 1 || isInput[crossing] == true || isOutput[crossing] == true) {
+            continue;
+        }
+
+        const tflite::TensorT &tensor = *graph.tensors[crossing];
+        long long bytes = GetElementSize(tensor.type);
+        for (int dim : tensor.shape) {
+            bytes *= dim;
+        }
+
+        if (bytes <= 0 || tensor.shape.empty() == true) {
+            // NOTE:
+            // Unknown type or dynamic shape
+            continue;
+        }
+
+        found.push_back(std::make_pair(bytes, std::make_pair(boundary, crossing)));
+    }
+
+    std::stable_sort(found.begin(), found.end(), [](const std::pair<long long, std::pair<int, int>> &a, const std::pair<long long, std::pair<int, int>> &b) -> bool {
+        return a.first < b.first;
+    });
+
+    for (size_t i = 0; i < found.size() && i < static_cast<size_t>(SPLIT_MAX_CANDIDATES); i++) {
+        DbgPrint("Boundary: operator %d, tensor %d (%lld bytes)", found[i].second.first, found[i].second.second, found[i].first);
+        boundaries.push_back(found[i].second);
+    }
+
+    std::sort(boundaries.begin(), boundaries.end());
+}
+
+int Runtime::WriteSplitModel(const std::vector<uint8_t> &buffer, int boundary, int tensor, bool head, std::string &path)
+{
+    std::unique_ptr<tflite::ModelT> source(tflite::GetModel(buffer.data())->UnPack());
+    if (source == nullptr) {
+        ErrPrint("Unable to unpack the model");
+        return -EFAULT;
+    }
+
+    tflite::SubGraphT &graph = *source->subgraphs[0];
+    if (head == true) {
+        graph.operators.erase(graph.operators.begin() + boundary, graph.operators.end());
+        graph.outputs.assign(1, tensor);
+    } else {
+        graph.operators.erase(graph.operators.begin(), graph.operators.begin() + boundary);
+        graph.inputs.assign(1, tensor);
+    }
+
+    // NOTE:
+    // The signatures refer the inputs and the outputs of the whole model
+    source->signature_defs.clear();
+
+    // NOTE:
+    // Drop the weights which are not used by this part, the tail is uploaded to the peer.
+    // The tensors of the other subgraphs (e.g. the bodies of the control flow operators) are kept.
+    std::vector<bool> used(source->buffers.size(), false);
+    std::vector<int> tensors(graph.inputs);
+    tensors.insert(tensors.end(), graph.outputs.begin(), graph.outputs.end());
+    for (size_t i = 0; i < graph.operators.size(); i++) {
+        const tflite::OperatorT &op = *graph.operators[i];
+        tensors.insert(tensors.end(), op.inputs.begin(), op.inputs.end());
+        tensors.insert(tensors.end(), op.outputs.begin(), op.outputs.end());
+        tensors.insert(tensors.end(), op.intermediates.begin(), op.intermediates.end());
+    }
+
+    for (int t : tensors) {
+        if (t >= 0 && t < static_cast<int>(graph.tensors.size()) && graph.tensors[t]->buffer < used.size()) {
+            used[graph.tensors[t]->buffer] = true;
+        }
+    }
+
+    for (size_t i = 1; i < source->subgraphs.size(); i++) {
+        for (const std::unique_ptr<tflite::TensorT> &t : source->subgraphs[i]->tensors) {
+            if (t->buffer < used.size()) {
+                used[t->buffer] = true;
+            }
+        }
+    }
+
+    for (const std::unique_ptr<tflite::MetadataT> &metadata : source->metadata) {
+        if (metadata->buffer < used.size()) {
+            used[metadata->buffer] = true;
+        }
+    }
+
+    for (int b : source->metadata_buffer) {
+        if (b >= 0 && b < static_cast<int>(used.size())) {
+            used[b] = true;
+        }
+    }
+
+    for (size_t i = 0; i < used.size(); i++) {
+        if (used[i] == false && source->buffers[i] != nullptr) {
+            source->buffers[i]->data.clear();
+        }
+    }
+
+    flatbuffers::FlatBufferBuilder builder;
+    tflite::FinishModelBuffer(builder, tflite::Model::Pack(builder, source.get()));
+
+    const char *dir = getenv("TMPDIR");
+    std::string _path = std::string(dir != nullptr ? dir : "/tmp") + (head == true ? "/beyond_head_XXXXXX.tflite" : "/beyond_tail_XXXXXX.tflite");
+    int fd = mkstemps(&_path[0], strlen(".tflite"));
+    if (fd < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "mkstemps");
+        return ret;
+    }
+
+    int ret = 0;
+    const uint8_t *ptr = builder.GetBufferPointer();
+    size_t remain = builder.GetSize();
+    while (remain > 0) {
+        ssize_t written = write(fd, ptr, remain);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            ret = -errno;
+            ErrPrintCode(errno, "write");
+            break;
+        }
+
+        ptr += written;
+        remain -= written;
+    }
+
+    if (close(fd) < 0) {
+        ErrPrintCode(errno, "close");
+    }
+
+    if (ret < 0) {
+        if (unlink(_path.c_str()) < 0) {
+            ErrPrintCode(errno, "unlink");
+        }
+        return ret;
+    }
+
+    path.swap(_path);
+    return 0;
+}
+
+int Runtime::SplitModel(const char *modelPath, std::vector<std::string> &models)
+{
+    if (modelPath == nullptr) {
+        ErrPrint("Invalid argument");
+        return -EINVAL;
+    }
+
+    std::vector<uint8_t> buffer;
+    int ret = ReadModelFile(modelPath, buffer);
+    if (ret < 0) {
+        return ret;
+    }
+
+    flatbuffers::Verifier verifier(buffer.data(), buffer.size());
+    if (tflite::VerifyModelBuffer(verifier) == false) {
+        ErrPrint("Invalid model: %s", modelPath);
+        return -EINVAL;
+    }
+
+    std::unique_ptr<tflite::ModelT> source(tflite::GetModel(buffer.data())->UnPack());
+    if (source == nullptr || source->subgraphs.empty() == true) {
+        ErrPrint("Invalid model: %s", modelPath);
+        return -EINVAL;
+    }
+
+    std::vector<std::pair<int, int>> boundaries;
+    FindSplitBoundaries(*source, boundaries);
+    if (boundaries.empty() == true) {
+        ErrPrint("There is no tensor boundary to split the model: %s", modelPath);
+        return -ENOENT;
+    }
+
+    std::vector<std::string> _models;
+    for (size_t i = 0; i < boundaries.size(); i++) {
+        std::string head;
+        std::string tail;
+
+        ret = WriteSplitModel(buffer, boundaries[i].first, boundaries[i].second, true, head);
+        if (ret == 0) {
+            _models.push_back(head);
+            ret = WriteSplitModel(buffer, boundaries[i].first, boundaries[i].second, false, tail);
+            if (ret == 0) {
+                _models.push_back(tail);
+            }
+        }
+
+        if (ret < 0) {
+            for (size_t j = 0; j < _models.size(); j++) {
+                if (unlink(_models[j].c_str()) < 0) {
+                    ErrPrintCode(errno, "unlink");
+                }
+            }
+            return ret;
+        }
+    }
+
+    splitFiles.insert(splitFiles.end(), _models.begin(), _models.end());
+    models.insert(models.end(), _models.begin(), _models.end());
+    return 0;
+}
+
 int Runtime::GetHandle(void) const
 {
     return -ENOTSUP;
@@ -508,31 +1550,86 @@ API void *_main(int argc, char *argv[])
             .flag = nullptr,
             .val = 'd',
         },
+        {
+            .name = "threads", // Number of the interpreter threads
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 't',
+        },
+        {
+            .name = "output-view", // GetOutput() returns the views of the output buffers instead of copying them
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 'v',
+        },
+        {
+            .name = nullptr,
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 0,
+        },
     };
 
     int c;
     int idx;
+    bool outputView = false;
+    Runtime::Accelerator accelerator = Runtime::ACCEL_NONE;
+    int numThreads = -1;
 
-    while ((c = getopt_long(argc, argv, "-:cgnd", opts, &idx)) != -1) {
+    while ((c = getopt_long(argc, argv, "-:cgndt:", opts, &idx)) != -1) {
         switch (c) {
         case 'c':
             // accelerator CPU
+            // NOTE:
+            // The XNNPACK delegate is the CPU accelerator of the tflite
+            accelerator = Runtime::ACCEL_XNNPACK;
             break;
         case 'g':
             // accelerator GPU
+#if defined(BEYOND_TFLITE_GPU)
+            accelerator = Runtime::ACCEL_GPU;
+#else
+            ErrPrint("GPU delegate is not supported, fall back to the CPU");
+            accelerator = Runtime::ACCEL_XNNPACK;
+#endif
             break;
         case 'n':
             // accelerator NPU
+#if defined(BEYOND_TFLITE_NNAPI)
+            accelerator = Runtime::ACCEL_NNAPI;
+#else
+            ErrPrint("NNAPI delegate is not supported, fall back to the CPU");
+            accelerator = Runtime::ACCEL_XNNPACK;
+#endif
             break;
         case 'd':
             // accelerator DSP
+            // NOTE:
+            // There is no dedicated DSP delegate in this runtime,
+            // the NNAPI dispatches the model to the DSP if the device has one.
+#if defined(BEYOND_TFLITE_NNAPI)
+            accelerator = Runtime::ACCEL_NNAPI;
+#else
+            ErrPrint("DSP is not supported, fall back to the CPU");
+            accelerator = Runtime::ACCEL_XNNPACK;
+#endif
+            break;
+        case 't':
+            numThreads = atoi(optarg);
+            if (numThreads == 0 || numThreads < -1) {
+                ErrPrint("Invalid number of threads: %s", optarg);
+                numThreads = -1;
+            }
+            break;
+        case 'v':
+            outputView = true;
             break;
         default:
             break;
         }
     }
 
-    Runtime *runtime = Runtime::Create();
+    Runtime *runtime = Runtime::Create(outputView, numThreads, accelerator);
     if (runtime == nullptr) {
         // TODO:
         // Unable to create a runtime module instance
@@ -190,19 +190,21 @@ struct beyond_input_config {
 // The remote machine must be able to access model files
 #define BEYOND_INFERENCE_MODE_REMOTE "remote"
 
-// TODO:
 // Pre-inference is going to be invoked on a local and
 // the post-inference is going to be invoked on a remote machine.
+// The models are given in pairs of the head (local) and the tail (remote) which are split at a tensor boundary.
+// BeyonD does not partition a model by itself, the pairs are prepared by the caller in advance.
+// With the BEYOND_INFERENCE_OPTION_AUTO_SPLIT, the best pair is chosen by measuring
+// the local compute time and the remote stage time (intermediate tensor transfer and the tail compute).
 // The remote machine must be able to access necessary model files
-// #define BEYOND_INFERENCE_MODE_EDGE "edge"
+#define BEYOND_INFERENCE_MODE_EDGE "edge"
 
-// TODO:
 // Inference requests can be forwarded between peers, so the inference request can be finished by
 // not the peer who gets the request at the first time.
 // Also the inference request can be spreaded to multiple remote machines simultaneously,
-// and then BeyonD will take the fastest one.
+// and then BeyonD will take the fastest one. (see BEYOND_INFERENCE_OPTION_FANOUT and BEYOND_INFERENCE_OPTION_HEDGE)
 // The remote machine must be able to access necessary model files
-// #define BEYOND_INFERENCE_MODE_DISTRIBUTE "distribute"
+#define BEYOND_INFERENCE_MODE_DISTRIBUTE "distribute"
 
 // remove option delimeters from the given option string
 #define BEYOND_GET_OPTION_NAME(option) (((char *)option) + 2)
@@ -217,6 +219,33 @@ struct beyond_input_config {
 // Select the inference framework (runtime) acceleration (default: gpu)
 #define BEYOND_INFERENCE_OPTION_FRAMEWORK_ACCEL "--acceleration"
 
+// Number of peers that an inference request is sent to at once (distribute mode)
+// e.g) --fanout 2
+// default: all peers if the hedging is not enabled, otherwise 1
+#define BEYOND_INFERENCE_OPTION_FANOUT "--fanout"
+
+// Hedge a request with the next peer when it is not completed in the given percentile of the measured latency (distribute mode)
+// e.g) --hedge 95
+// The first response is taken and the others are discarded.
+#define BEYOND_INFERENCE_OPTION_HEDGE "--hedge"
+
+// Balance the requests between the peers (remote mode)
+// e.g) --balance round-robin
+// default: latency, the requests are sent to the peer which has the best expected completion time.
+// Except the latency policy, every peer is prepared with the same model.
+#define BEYOND_INFERENCE_OPTION_BALANCE "--balance"
+#define BEYOND_INFERENCE_BALANCE_LATENCY "latency"
+#define BEYOND_INFERENCE_BALANCE_ROUND_ROBIN "round-robin"
+#define BEYOND_INFERENCE_BALANCE_LEAST_OUTSTANDING "least-outstanding"
+
+// Maximum number of in-flight requests per peer (remote mode)
+// e.g) --max-inflight 4
+// The requests over the limit are queued until a peer completes one. (default: 0, unlimited)
+#define BEYOND_INFERENCE_OPTION_MAX_INFLIGHT "--max-inflight"
+
+// Deliver the completions in the order of the submission (remote mode)
+#define BEYOND_INFERENCE_OPTION_ORDERED "--ordered"
+
 
 // runtime devices
 // The runtime option can be defined by runtime provider.
@@ -228,6 +257,17 @@ struct beyond_input_config {
 #define BEYOND_INFERENCE_RUNTIME_DEVICE_NPU "--npu"
 #define BEYOND_INFERENCE_RUNTIME_DEVICE_DSP "--dsp"
 
+// runtime options
+// These options are handled by BeyonD for the runtime which does not support the asynchronous mode.
+//
+// Number of the runtime instances, each instance runs the requests on its own thread
+// e.g) --workers 2 (default: 1)
+#define BEYOND_INFERENCE_RUNTIME_OPTION_WORKERS "--workers"
+
+// Maximum number of the in-flight requests, Invoke() returns -EBUSY over the limit
+// e.g) --queue-depth 4 (default: 0, unlimited)
+#define BEYOND_INFERENCE_RUNTIME_OPTION_QUEUE_DEPTH "--queue-depth"
+
 struct beyond_event_info {
     int type; // OR'd type of beyond_event_type in the same category
 
@@ -283,6 +323,17 @@ struct beyond_peer_info {
     //
     //     },
     // }
+
+    unsigned long long count_of_dropped;  // requests which are dropped by the flow control of the peer
+    unsigned long long count_of_canceled; // requests which are canceled by the remote device
+
+    // NOTE:
+    // The load of the peer which is published by the discovery, it is refreshed periodically by the peer.
+    // They are given before the peer is activated, so the peers can be ranked without asking them.
+    int queue_depth;       // requests which are waiting or running on the peer (0: idle or unknown)
+    unsigned int latency;  // recent median inference latency in usec (0: unknown)
+    int count_of_models;
+    char **models;         // digests (or their prefixes) of the models which are loaded on the peer
 };
 
 typedef void *beyond_inference_h;
@@ -27,6 +27,40 @@ public:
     struct EventData : public EventObjectInterface::EventData {
     };
 
+    // NOTE:
+    // The bulk crypto, an authenticated encryption (AEAD) of the large and frequent data, e.g. the tensors.
+    // It does not go through the event loop of the authenticator, the data is processed on the caller thread,
+    // and a cipher can be used by multiple threads at the same time.
+    class CipherInterface {
+    public:
+        static constexpr int IV_SIZE = 12;
+        static constexpr int TAG_SIZE = 16;
+
+        struct Stream;
+
+    public:
+        virtual void Destroy(void) = 0;
+
+        // NOTE:
+        // The output has the same size of the input, it can be the input itself (in-place).
+        // The aad is authenticated but it is not encrypted, it is optional (nullptr).
+        // The Decrypt() returns -EBADMSG if the data or the aad is not authentic.
+        virtual int Encrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, void *tag) = 0;
+        virtual int Decrypt(const void *iv, const void *aad, int aadSize, const void *in, int size, void *out, const void *tag) = 0;
+
+        // NOTE:
+        // The data can be given in chunks, Update() for each of them and End() for finishing it.
+        // The End() gives the tag for the encryption, and verifies the tag for the decryption.
+        // The stream is released by the End() whatever it returns.
+        virtual int Begin(bool encrypt, const void *iv, const void *aad, int aadSize, Stream *&stream) = 0;
+        virtual int Update(Stream *stream, const void *in, int size, void *out) = 0;
+        virtual int End(Stream *stream, void *tag) = 0;
+
+    protected:
+        CipherInterface(void) = default;
+        virtual ~CipherInterface(void) = default;
+    };
+
 public:
     virtual ~AuthenticatorInterface(void) = default;
 
@@ -42,6 +76,17 @@ public:
     virtual int GetResult(void *&outData, int &outSize) = 0;
     virtual int GetKey(beyond_authenticator_key_id id, void *&key, int &size) = 0;
 
+    // NOTE:
+    // The cipher is keyed by the secret key of the authenticator,
+    // or by the given key if there is (e.g. the session key which is exchanged with a peer).
+    // If the salt is given, the key of the cipher is derived from the key and the salt,
+    // so the ciphers which share the same key do not share the key of the cipher.
+    virtual int CreateCipher(CipherInterface *&cipher, const void *key = nullptr, int keySize = 0, const void *salt = nullptr, int saltSize = 0) = 0;
+
+    // NOTE:
+    // Fill the buffer with the cryptographically secure random bytes (e.g. the salt of the cipher)
+    virtual int GenerateRandom(void *buffer, int size) = 0;
+
     virtual int Deactivate(void) = 0;
 
     virtual int GenerateSignature(const unsigned char *data, int dataSize, unsigned char *&encoded, int &encodedSize) = 0;
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_PRIVATE_COMMAND_RING_OBJECT_H__
+#define __BEYOND_PRIVATE_COMMAND_RING_OBJECT_H__
+
+#include <beyond/private/event_object_base_interface_private.h>
+#include <beyond/private/command_object_interface_private.h>
+
+namespace beyond {
+
+// NOTE:
+// CommandObject compatible channel which does not allocate memory per command.
+// Commands are stored in a preallocated single-producer/single-consumer ring,
+// and the handle is a doorbell (eventfd) which stays readable while there are commands to receive.
+// The doorbell is written only when the consumer has been drained, so the burst of commands costs one wakeup.
+//
+// CreatePair() creates two connected endpoints. Each endpoint receives from its own ring,
+// and sends to the ring of the other endpoint, just like a socketpair.
+// Only one thread may send to and only one thread may receive from an endpoint at a time.
+class API CommandRingObject final : public CommandObjectInterface {
+public:
+    static constexpr int DEFAULT_CAPACITY = 256;
+
+    // NOTE:
+    // The capacity is rounded up to the power of two
+    static int CreatePair(CommandRingObject *&endpoint, CommandRingObject *&peerEndpoint, int capacity = DEFAULT_CAPACITY);
+    void Destroy(void);
+
+    int GetHandle(void) const override;
+
+    // NOTE:
+    // Send() waits for the free slot if the ring is full.
+    // Recv() blocks until a command is arrived.
+    int Send(int id, void *data = nullptr) override;
+    int Recv(int &id) override;
+    int Recv(int &id, void *&data) override;
+
+    // NOTE:
+    // Returns -EAGAIN if there is no more command.
+    // Event handlers should call this until it returns -EAGAIN to drain the ring in a batch.
+    int TryRecv(int &id, void *&data);
+
+private:
+    class Ring;
+
+    CommandRingObject(Ring *rx, Ring *tx);
+    virtual ~CommandRingObject(void);
+
+    Ring *rx;
+    Ring *tx;
+};
+
+} // namespace beyond
+
+#endif // __BEYOND_PRIVATE_COMMAND_RING_OBJECT_H__
@@ -28,11 +28,19 @@ public:
         char *name;
     };
 
+    // NOTE:
+    // The runtimes and the models are the strings which are published by the server (nullptr: not published),
+    // "runtime:device,device;runtime:device" and "digest,digest"
     struct client_event_data {
         char *name;
-        struct sockaddr address;
+        struct sockaddr_storage address; // AF_INET or AF_INET6
         uint16_t port;
         char uuid[BEYOND_UUID_LEN];
+        unsigned long long free_memory;
+        int queue_depth;
+        unsigned int latency;
+        char *runtimes;
+        char *models;
     };
 
     virtual ~RuntimeInterface(void) = default;
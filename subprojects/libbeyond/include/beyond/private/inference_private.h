@@ -53,6 +53,10 @@ protected:
 
 private:
     class impl;
+
+    // NOTE:
+    // The unit test reaches the internal utilities of the implementation through it
+    friend class InferenceImplTest;
 };
 
 } // namespace beyond
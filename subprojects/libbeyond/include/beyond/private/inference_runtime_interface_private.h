@@ -17,6 +17,10 @@
 #ifndef __BEYOND_PRIVATE_INFERENCE_RUNTIME_INTERFACE_H__
 #define __BEYOND_PRIVATE_INFERENCE_RUNTIME_INTERFACE_H__
 
+#include <cerrno>
+#include <string>
+#include <vector>
+
 #include <beyond/private/module_interface_private.h>
 #include <beyond/private/inference_interface_private.h>
 
@@ -26,6 +30,17 @@ class InferenceInterface::RuntimeInterface : public ModuleInterface, public Infe
 public:
     virtual ~RuntimeInterface(void) = default;
 
+    // NOTE:
+    // Partition the model at the tensor boundaries for the split inference (edge mode).
+    // The partitioned models are given in pairs of the head and the tail, e.g) { head_0, tail_0, head_1, tail_1 }
+    // The output of the head is the input of the tail, the head runs on the runtime and the tail runs on a peer.
+    // The runtime keeps the partitioned models until it is destroyed.
+    // A runtime which is not able to partition its models does not need to override this.
+    virtual int SplitModel(const char *model, std::vector<std::string> &models)
+    {
+        return -ENOTSUP;
+    }
+
 protected:
     RuntimeInterface(void) = default;
 };
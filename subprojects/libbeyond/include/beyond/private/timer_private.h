@@ -29,7 +29,9 @@ public:
     static Timer *Create(void);
 
     virtual void Destroy(void) = 0;
-    virtual int SetTimer(double timer) = 0;
+    // NOTE:
+    // A one-shot timer (repeat == false) is disarmed if the timer is not positive
+    virtual int SetTimer(double timer, bool repeat = true) = 0;
     virtual double GetTimer(void) const = 0;
 
 protected:
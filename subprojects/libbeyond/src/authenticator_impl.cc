@@ -183,6 +183,16 @@ int Authenticator::impl::GetKey(beyond_authenticator_key_id id, void *&key, int
     return module->GetKey(id, key, size);
 }
 
+int Authenticator::impl::CreateCipher(CipherInterface *&cipher, const void *key, int keySize, const void *salt, int saltSize)
+{
+    return module->CreateCipher(cipher, key, keySize, salt, saltSize);
+}
+
+int Authenticator::impl::GenerateRandom(void *buffer, int size)
+{
+    return module->GenerateRandom(buffer, size);
+}
+
 int Authenticator::impl::GenerateSignature(const unsigned char *data, int dataSize, unsigned char *&encoded, int &encodedSize)
 {
     return module->GenerateSignature(data, dataSize, encoded, encodedSize);
@@ -45,6 +45,8 @@ public: // AuthenticatorInterface interface
     int Decrypt(beyond_authenticator_key_id id, const void *data, int size, const void *iv = nullptr, int ivsize = 0) override;
     int GetResult(void *&outData, int &outSize) override;
     int GetKey(beyond_authenticator_key_id id, void *&key, int &size) override;
+    int CreateCipher(CipherInterface *&cipher, const void *key = nullptr, int keySize = 0, const void *salt = nullptr, int saltSize = 0) override;
+    int GenerateRandom(void *buffer, int size) override;
 
     int GenerateSignature(const unsigned char *data, int dataSize, unsigned char *&encoded, int &encodedSize) override;
     int VerifySignature(unsigned char *signedData, int signedDataSize, const unsigned char *original, int originalSize, bool &authentic) override;
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <exception>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+
+#if !defined(__APPLE__)
+#include <sys/eventfd.h>
+#endif
+
+#include "beyond/platform/beyond_platform.h"
+#include "beyond/common.h"
+#include "beyond/private/log_private.h"
+#include "beyond/private/event_object_base_interface_private.h"
+#include "beyond/private/command_object_interface_private.h"
+#include "beyond/private/command_ring_object_private.h"
+
+#define SEND_SPIN_COUNT 64
+#define SEND_BACKOFF_USEC 100
+
+namespace beyond {
+
+class CommandRingObject::Ring final {
+public:
+    static Ring *Create(int capacity);
+    void Ref(void);
+    void Unref(void);
+
+    int GetHandle(void) const;
+
+    // RUN_ON_THE_PRODUCER
+    int Push(int id, void *data);
+
+    // RUN_ON_THE_CONSUMER
+    int Pop(int &id, void *&data);
+    int Wait(void);
+
+private:
+    Ring(void);
+    ~Ring(void);
+
+    int OpenDoorbell(void);
+    void CloseDoorbell(void);
+    void Knock(void);
+    void Clear(void);
+
+    struct Slot {
+        int id;
+        void *data;
+    };
+
+    Slot *slots;
+    size_t mask;
+
+    // NOTE:
+    // head is updated by the consumer, tail is updated by the producer.
+    // Keep them in different cache lines to avoid false sharing.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+    // NOTE:
+    // The consumer sets "armed" when it finds the ring empty.
+    // The producer knocks the doorbell only if the consumer is armed,
+    // therefore a burst of commands wakes the consumer up only once.
+    alignas(64) std::atomic<bool> armed;
+    std::atomic<int> refcnt;
+
+    int doorbell[2]; // [0] for reading, [1] for writing. both are the same eventfd except on the apple platform
+};
+
+CommandRingObject::Ring *CommandRingObject::Ring::Create(int capacity)
+{
+    if (capacity <= 0) {
+        ErrPrint("Invalid capacity: %d", capacity);
+        return nullptr;
+    }
+
+    size_t size = 1;
+    while (size < static_cast<size_t>(capacity)) {
+        size <<= 1;
+    }
+
+    Ring *ring;
+    try {
+        ring = new Ring();
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        return nullptr;
+    }
+
+    ring->slots = static_cast<Slot *>(calloc(size, sizeof(Slot)));
+    if (ring->slots == nullptr) {
+        ErrPrintCode(errno, "calloc");
+        delete ring;
+        ring = nullptr;
+        return nullptr;
+    }
+    ring->mask = size - 1;
+
+    if (ring->OpenDoorbell() < 0) {
+        delete ring;
+        ring = nullptr;
+        return nullptr;
+    }
+
+    return ring;
+}
+
+CommandRingObject::Ring::Ring(void)
+    : slots(nullptr)
+    , mask(0)
+    , head(0)
+    , tail(0)
+    , armed(true)
+    , refcnt(1)
+    , doorbell{ -1, -1 }
+{
+}
+
+CommandRingObject::Ring::~Ring(void)
+{
+    CloseDoorbell();
+    free(slots);
+    slots = nullptr;
+}
+
+void CommandRingObject::Ring::Ref(void)
+{
+    refcnt.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CommandRingObject::Ring::Unref(void)
+{
+    if (refcnt.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+int CommandRingObject::Ring::GetHandle(void) const
+{
+    return doorbell[0];
+}
+
+#if defined(__APPLE__)
+int CommandRingObject::Ring::OpenDoorbell(void)
+{
+    if (pipe(doorbell) < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "pipe");
+        doorbell[0] = doorbell[1] = -1;
+        return ret;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (fcntl(doorbell[i], F_SETFD, FD_CLOEXEC) < 0 || fcntl(doorbell[i], F_SETFL, O_NONBLOCK) < 0) {
+            int ret = -errno;
+            ErrPrintCode(errno, "fcntl");
+            CloseDoorbell();
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+void CommandRingObject::Ring::CloseDoorbell(void)
+{
+    for (int i = 0; i < 2; i++) {
+        if (doorbell[i] >= 0 && close(doorbell[i]) < 0) {
+            ErrPrintCode(errno, "close");
+        }
+        doorbell[i] = -1;
+    }
+}
+
+void CommandRingObject::Ring::Knock(void)
+{
+    char ch = 0;
+    if (write(doorbell[1], &ch, sizeof(ch)) < 0 && errno != EAGAIN) {
+        ErrPrintCode(errno, "write");
+    }
+}
+
+void CommandRingObject::Ring::Clear(void)
+{
+    char buf[64];
+    while (read(doorbell[0], buf, sizeof(buf)) > 0) {
+        // Drain all pending knocks
+    }
+}
+#else
+int CommandRingObject::Ring::OpenDoorbell(void)
+{
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0) {
+        int ret = -errno;
+        ErrPrintCode(errno, "eventfd");
+        return ret;
+    }
+
+    doorbell[0] = doorbell[1] = fd;
+    return 0;
+}
+
+void CommandRingObject::Ring::CloseDoorbell(void)
+{
+    if (doorbell[0] >= 0 && close(doorbell[0]) < 0) {
+        ErrPrintCode(errno, "close");
+    }
+    doorbell[0] = doorbell[1] = -1;
+}
+
+void CommandRingObject::Ring::Knock(void)
+{
+    uint64_t value = 1;
+    if (write(doorbell[1], &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        ErrPrintCode(errno, "write");
+    }
+}
+
+void CommandRingObject::Ring::Clear(void)
+{
+    uint64_t value;
+    if (read(doorbell[0], &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        ErrPrintCode(errno, "read");
+    }
+}
+#endif
+
+int CommandRingObject::Ring::Push(int id, void *data)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) > mask) {
+        return -EAGAIN;
+    }
+
+    slots[t & mask].id = id;
+    slots[t & mask].data = data;
+    tail.store(t + 1, std::memory_order_release);
+
+    // NOTE:
+    // Pairs with the fence in the Pop().
+    // Either the consumer sees the new tail, or this sees the armed flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (armed.exchange(false, std::memory_order_acq_rel) == true) {
+        Knock();
+    }
+
+    return 0;
+}
+
+int CommandRingObject::Ring::Pop(int &id, void *&data)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+        // NOTE:
+        // The ring looks empty, clear the doorbell and arm it before sleeping.
+        // Check the tail again, the producer could push a command before it sees the armed flag.
+        Clear();
+        armed.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return -EAGAIN;
+        }
+
+        // NOTE:
+        // There are commands which are pushed without knocking,
+        // knock the doorbell by itself to keep it readable until the ring is drained.
+        if (armed.exchange(false, std::memory_order_acq_rel) == true) {
+            Knock();
+        }
+    }
+
+    id = slots[h & mask].id;
+    data = slots[h & mask].data;
+    head.store(h + 1, std::memory_order_release);
+    return 0;
+}
+
+int CommandRingObject::Ring::Wait(void)
+{
+    struct pollfd pfd = {
+        .fd = doorbell[0],
+        .events = POLLIN,
+        .revents = 0,
+    };
+
+    int ret = poll(&pfd, 1, -1);
+    if (ret < 0) {
+        ret = -errno;
+        if (ret != -EINTR) {
+            ErrPrintCode(errno, "poll");
+        }
+        return ret;
+    }
+
+    return 0;
+}
+
+int CommandRingObject::CreatePair(CommandRingObject *&endpoint, CommandRingObject *&peerEndpoint, int capacity)
+{
+    Ring *ring = Ring::Create(capacity);
+    if (ring == nullptr) {
+        return -ENOMEM;
+    }
+
+    Ring *peerRing = Ring::Create(capacity);
+    if (peerRing == nullptr) {
+        ring->Unref();
+        ring = nullptr;
+        return -ENOMEM;
+    }
+
+    CommandRingObject *_endpoint;
+    try {
+        _endpoint = new CommandRingObject(ring, peerRing);
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        ring->Unref();
+        peerRing->Unref();
+        return -ENOMEM;
+    }
+
+    CommandRingObject *_peerEndpoint;
+    try {
+        _peerEndpoint = new CommandRingObject(peerRing, ring);
+    } catch (std::exception &e) {
+        ErrPrint("new: %s", e.what());
+        _endpoint->Destroy();
+        ring->Unref();
+        peerRing->Unref();
+        return -ENOMEM;
+    }
+
+    // NOTE:
+    // Each ring is referred by both endpoints now, drop the creation reference.
+    ring->Unref();
+    peerRing->Unref();
+
+    endpoint = _endpoint;
+    peerEndpoint = _peerEndpoint;
+    return 0;
+}
+
+void CommandRingObject::Destroy(void)
+{
+    delete this;
+}
+
+CommandRingObject::CommandRingObject(Ring *_rx, Ring *_tx)
+    : rx(_rx)
+    , tx(_tx)
+{
+    rx->Ref();
+    tx->Ref();
+}
+
+CommandRingObject::~CommandRingObject(void)
+{
+    rx->Unref();
+    rx = nullptr;
+
+    tx->Unref();
+    tx = nullptr;
+}
+
+int CommandRingObject::GetHandle(void) const
+{
+    return rx->GetHandle();
+}
+
+int CommandRingObject::Send(int id, void *data)
+{
+    int spin = 0;
+    int ret;
+
+    while ((ret = tx->Push(id, data)) == -EAGAIN) {
+        // NOTE:
+        // The ring is full, give the consumer a chance to drain it.
+        if (spin < SEND_SPIN_COUNT) {
+            spin++;
+            sched_yield();
+        } else {
+            usleep(SEND_BACKOFF_USEC);
+        }
+    }
+
+    return ret;
+}
+
+int CommandRingObject::Recv(int &id)
+{
+    void *data;
+    return Recv(id, data);
+}
+
+int CommandRingObject::Recv(int &id, void *&data)
+{
+    int ret;
+
+    while ((ret = rx->Pop(id, data)) == -EAGAIN) {
+        ret = rx->Wait();
+        if (ret < 0 && ret != -EINTR) {
+            return ret;
+        }
+    }
+
+    return ret;
+}
+
+int CommandRingObject::TryRecv(int &id, void *&data)
+{
+    return rx->Pop(id, data);
+}
+
+} // namespace beyond
@@ -24,6 +24,8 @@
 #include <dlfcn.h>
 #include <getopt.h>
 #include <arpa/inet.h>
+#include <net/if.h>
+#include <netdb.h>
 
 #include "beyond/platform/beyond_platform.h"
 #include "beyond/private/log_private.h"
@@ -33,7 +35,9 @@
 
 #include "discovery_runtime_impl.h"
 
-#define HOST_LEN 32
+// NOTE:
+// The IPv6 address can have the scope, e.g. "fe80::1%eth0"
+#define HOST_LEN (INET6_ADDRSTRLEN + IF_NAMESIZE)
 // NOTE:
 // This implementation is going to help loading a discovery module
 // that is implemented using various kind of protocols such as
@@ -245,7 +249,6 @@ int Discovery::Runtime::impl::FetchEventData(EventObjectInterface::EventData *&d
         }
 
         auto event_data = static_cast<DiscoveryInterface::RuntimeInterface::client_event_data *>(sub_data->data);
-        auto addr_in = reinterpret_cast<struct sockaddr_in *>(&(event_data->address));
         try {
             info->host = new char[HOST_LEN];
         } catch (std::exception &e) {
@@ -266,9 +269,11 @@ int Discovery::Runtime::impl::FetchEventData(EventObjectInterface::EventData *&d
             break;
         }
 
-        if (inet_ntop(event_data->address.sa_family, &(addr_in->sin_addr), info->host, HOST_LEN) == nullptr) {
-            ret = -errno;
-            ErrPrintCode(errno, "inet_ntop");
+        socklen_t addrLen = event_data->address.ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        int status = getnameinfo(reinterpret_cast<struct sockaddr *>(&(event_data->address)), addrLen, info->host, HOST_LEN, nullptr, 0, NI_NUMERICHOST);
+        if (status != 0) {
+            ret = -EINVAL;
+            ErrPrint("getnameinfo: %s", gai_strerror(status));
             delete[] info->host;
             delete info;
             delete data;
@@ -277,6 +282,16 @@ int Discovery::Runtime::impl::FetchEventData(EventObjectInterface::EventData *&d
         }
         info->port[0] = event_data->port;
         snprintf(info->uuid, BEYOND_UUID_LEN, "%s", event_data->uuid);
+
+        info->free_memory = event_data->free_memory;
+        info->queue_depth = event_data->queue_depth;
+        info->latency = event_data->latency;
+        // NOTE:
+        // The peer is still usable without its load, it is going to be asked to the peer instead
+        if (ParseRuntimes(event_data->runtimes, info) < 0 || ParseModels(event_data->models, info) < 0) {
+            ErrPrint("Unable to get the runtimes and the models of the peer");
+            ResetLoad(info);
+        }
         data->data = info;
     } break;
     case BEYOND_EVENT_TYPE_DISCOVERY_REMOVED: {
@@ -336,6 +351,7 @@ int Discovery::Runtime::impl::DestroyEventData(EventObjectInterface::EventData *
     } break;
     case beyond_event_type::BEYOND_EVENT_TYPE_DISCOVERY_DISCOVERED: {
         auto info = static_cast<beyond_peer_info *>(data->data);
+        ResetLoad(info);
         free(info->name);
         delete[] info->host;
         delete info;
@@ -354,4 +370,164 @@ int Discovery::Runtime::impl::DestroyEventData(EventObjectInterface::EventData *
     return 0;
 }
 
+// NOTE:
+// "runtime:device,device;runtime:device", a runtime without the devices is allowed
+int Discovery::Runtime::impl::ParseRuntimes(const char *runtimes, beyond_peer_info *info)
+{
+    if (runtimes == nullptr || runtimes[0] == '\0') {
+        return 0;
+    }
+
+    std::vector<std::string> entries;
+    try {
+        std::string entry;
+        for (const char *ptr = runtimes;; ptr++) {
+            if (*ptr == ';' || *ptr == '\0') {
+                if (entry.empty() == false) {
+                    entries.push_back(entry);
+                }
+                entry.clear();
+                if (*ptr == '\0') {
+                    break;
+                }
+                continue;
+            }
+            entry += *ptr;
+        }
+    } catch (std::exception &e) {
+        ErrPrint("runtimes: %s", e.what());
+        return -ENOMEM;
+    }
+
+    if (entries.empty() == true) {
+        return 0;
+    }
+
+    info->runtimes = static_cast<beyond_peer_info_runtime *>(calloc(entries.size(), sizeof(beyond_peer_info_runtime)));
+    if (info->runtimes == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "calloc");
+        return ret;
+    }
+    info->count_of_runtimes = static_cast<int>(entries.size());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        beyond_peer_info_runtime &runtime = info->runtimes[i];
+        const std::string &entry = entries[i];
+        size_t colon = entry.find(':');
+
+        runtime.name = strdup(entry.substr(0, colon).c_str());
+        if (runtime.name == nullptr) {
+            int ret = -errno;
+            ErrPrintCode(errno, "strdup");
+            return ret;
+        }
+
+        if (colon == std::string::npos || colon + 1 >= entry.size()) {
+            continue;
+        }
+
+        std::string devices = entry.substr(colon + 1);
+        int count = 1;
+        for (char ch : devices) {
+            if (ch == ',') {
+                count++;
+            }
+        }
+
+        runtime.devices = static_cast<beyond_peer_info_device *>(calloc(count, sizeof(beyond_peer_info_device)));
+        if (runtime.devices == nullptr) {
+            int ret = -errno;
+            ErrPrintCode(errno, "calloc");
+            return ret;
+        }
+
+        size_t begin = 0;
+        while (begin <= devices.size()) {
+            size_t end = devices.find(',', begin);
+            if (end == std::string::npos) {
+                end = devices.size();
+            }
+
+            if (end > begin) {
+                char *name = strndup(devices.c_str() + begin, end - begin);
+                if (name == nullptr) {
+                    int ret = -errno;
+                    ErrPrintCode(errno, "strndup");
+                    return ret;
+                }
+                runtime.devices[runtime.count_of_devices++].name = name;
+            }
+
+            begin = end + 1;
+        }
+    }
+
+    return 0;
+}
+
+// NOTE:
+// "digest,digest"
+int Discovery::Runtime::impl::ParseModels(const char *models, beyond_peer_info *info)
+{
+    if (models == nullptr || models[0] == '\0') {
+        return 0;
+    }
+
+    int count = 1;
+    for (const char *ptr = models; *ptr != '\0'; ptr++) {
+        if (*ptr == ',') {
+            count++;
+        }
+    }
+
+    info->models = static_cast<char **>(calloc(count, sizeof(char *)));
+    if (info->models == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "calloc");
+        return ret;
+    }
+
+    const char *begin = models;
+    while (begin != nullptr) {
+        const char *end = strchr(begin, ',');
+        size_t length = end != nullptr ? static_cast<size_t>(end - begin) : strlen(begin);
+
+        if (length > 0) {
+            char *digest = strndup(begin, length);
+            if (digest == nullptr) {
+                int ret = -errno;
+                ErrPrintCode(errno, "strndup");
+                return ret;
+            }
+            info->models[info->count_of_models++] = digest;
+        }
+
+        begin = end != nullptr ? end + 1 : nullptr;
+    }
+
+    return 0;
+}
+
+void Discovery::Runtime::impl::ResetLoad(beyond_peer_info *info)
+{
+    for (int i = 0; info->runtimes != nullptr && i < info->count_of_runtimes; i++) {
+        for (int j = 0; info->runtimes[i].devices != nullptr && j < info->runtimes[i].count_of_devices; j++) {
+            free(info->runtimes[i].devices[j].name);
+        }
+        free(info->runtimes[i].devices);
+        free(info->runtimes[i].name);
+    }
+    free(info->runtimes);
+    info->runtimes = nullptr;
+    info->count_of_runtimes = 0;
+
+    for (int i = 0; info->models != nullptr && i < info->count_of_models; i++) {
+        free(info->models[i]);
+    }
+    free(info->models);
+    info->models = nullptr;
+    info->count_of_models = 0;
+}
+
 } // namespace beyond
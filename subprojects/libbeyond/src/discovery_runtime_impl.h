@@ -20,6 +20,9 @@
 #include "beyond/common.h"
 #include "beyond/private/discovery_runtime_private.h"
 
+#include <string>
+#include <vector>
+
 namespace beyond {
 
 class Discovery::Runtime::impl final : public Discovery::Runtime {
@@ -51,6 +54,13 @@ private:
     impl(void);
     virtual ~impl(void);
 
+    // NOTE:
+    // The load which is published by the discovery module is given to the peer info,
+    // the ResetLoad() releases what the ParseRuntimes() and the ParseModels() allocated.
+    static int ParseRuntimes(const char *runtimes, beyond_peer_info *info);
+    static int ParseModels(const char *models, beyond_peer_info *info);
+    static void ResetLoad(beyond_peer_info *info);
+
     void *dlHandle;
     DiscoveryInterface::RuntimeInterface *module;
 };
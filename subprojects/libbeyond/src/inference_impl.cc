@@ -18,6 +18,7 @@
 #include <cerrno>
 #include <exception>
 #include <cstring>
+#include <cstdlib>
 
 #include <unistd.h>
 #include <getopt.h>
@@ -84,47 +85,110 @@ int Inference::impl::ParseArguments(int argc, char *argv[])
             .flag = nullptr,
             .val = 's',
         },
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_OPTION_FANOUT), // Number of peers to send a request at once
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'f',
+        },
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_OPTION_HEDGE), // Latency percentile for the hedged requests
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'h',
+        },
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_OPTION_BALANCE), // Balancing policy of the requests between peers
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'b',
+        },
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_OPTION_MAX_INFLIGHT), // Maximum in-flight requests per peer
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'm',
+        },
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_OPTION_ORDERED), // Deliver completions in the submission order
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 'o',
+        },
+        {
+            .name = nullptr,
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 0,
+        },
     };
     int idx;
     int c;
     bool autoSplit = false;
+    int fanout = 0;
+    int hedge = 0;
+    const char *balance = BEYOND_INFERENCE_BALANCE_LATENCY;
+    int maxInflight = 0;
+    bool ordered = false;
 
     optind = 0;
     opterr = 0;
 
-    while ((c = getopt_long(argc, argv, "-:s", opts, &idx)) != -1) {
+    while ((c = getopt_long(argc, argv, "-:sf:h:b:m:o", opts, &idx)) != -1) {
         switch (c) {
         case 's': // split
             autoSplit = true;
             break;
+        case 'f': // fanout
+            fanout = atoi(optarg);
+            if (fanout < 0) {
+                ErrPrint("Invalid fanout: %s", optarg);
+                return -EINVAL;
+            }
+            break;
+        case 'h': // hedge
+            hedge = atoi(optarg);
+            if (hedge < 0 || hedge > 100) {
+                ErrPrint("Invalid hedge percentile: %s", optarg);
+                return -EINVAL;
+            }
+            break;
+        case 'b': // balance
+            balance = optarg;
+            break;
+        case 'm': // max-inflight
+            maxInflight = atoi(optarg);
+            if (maxInflight < 0) {
+                ErrPrint("Invalid max inflight: %s", optarg);
+                return -EINVAL;
+            }
+            break;
+        case 'o': // ordered
+            ordered = true;
+            break;
         default:
             break;
         }
     }
 
-    // TODO: Expand inference modes.
-    // if (strncmp(argv[0], BEYOND_INFERENCE_MODE_LOCAL, sizeof(BEYOND_INFERENCE_MODE_LOCAL)) == 0) {
-    //     instance = Inference::impl::local::Create(autoSplit);
-    // } else if (strncmp(argv[0], BEYOND_INFERENCE_MODE_REMOTE, sizeof(BEYOND_INFERENCE_MODE_REMOTE)) == 0) {
-    //     instance = Inference::impl::remote::Create(autoSplit);
-    // } else if (strncmp(argv[0], BEYOND_INFERENCE_MODE_EDGE, sizeof(BEYOND_INFERENCE_MODE_EDGE)) == 0) {
-    //     instance = Inference::impl::edge::Create(autoSplit);
-    // } else if (strncmp(argv[0], BEYOND_INFERENCE_MODE_DISTRIBUTE, sizeof(BEYOND_INFERENCE_MODE_DISTRIBUTE)) == 0) {
-    //     instance = Inference::impl::distribute::Create(autoSplit);
-    // } else {
-    //     ErrPrint("Unknown inference mode selected: <%s>", argv[0]);
-    //     return -EINVAL;
-    // }
-
     if (strncmp(argv[0], BEYOND_INFERENCE_MODE_LOCAL, sizeof(BEYOND_INFERENCE_MODE_LOCAL)) == 0) {
         instance = Inference::impl::local::Create(autoSplit);
     } else if (strncmp(argv[0], BEYOND_INFERENCE_MODE_REMOTE, sizeof(BEYOND_INFERENCE_MODE_REMOTE)) == 0) {
-        instance = Inference::impl::remote::Create(autoSplit);
+        instance = Inference::impl::remote::Create(autoSplit, balance, maxInflight, ordered);
+    } else if (strncmp(argv[0], BEYOND_INFERENCE_MODE_EDGE, sizeof(BEYOND_INFERENCE_MODE_EDGE)) == 0) {
+        instance = Inference::impl::edge::Create(autoSplit);
+    } else if (strncmp(argv[0], BEYOND_INFERENCE_MODE_DISTRIBUTE, sizeof(BEYOND_INFERENCE_MODE_DISTRIBUTE)) == 0) {
+        instance = Inference::impl::distribute::Create(autoSplit, fanout, hedge);
     } else {
         ErrPrint("Unknown inference mode selected: <%s>", argv[0]);
         return -EINVAL;
     }
 
+    if (instance == nullptr) {
+        ErrPrint("Unable to create the inference mode: <%s>", argv[0]);
+        return -EFAULT;
+    }
+
     return 0;
 }
 
@@ -27,6 +27,8 @@ namespace beyond {
 class Inference::impl : public Inference {
 public:
     class EventObject;
+    class LatencyEstimator;
+    class Fanout;
 
 private:
     class local;
@@ -83,6 +85,8 @@ protected:
 private:
     impl *instance;
     int ParseArguments(int argc, char *argv[]);
+
+    friend class InferenceImplTest;
 };
 
 } // namespace beyond
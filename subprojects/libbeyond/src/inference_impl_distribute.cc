@@ -14,8 +14,18 @@
  * limitations under the License.
  */
 
-#include "inference_impl_distribute.h"
-#include "inference_impl.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <cassert>
+#include <cfloat>
+
+#include <exception>
+#include <algorithm>
+
+#include <pthread.h>
 
 #include "beyond/platform/beyond_platform.h"
 #include "beyond/private/log_private.h"
@@ -23,129 +33,1317 @@
 
 #include "beyond/private/event_object_private.h"
 #include "beyond/private/inference_interface_private.h"
+#include "beyond/private/event_loop_private.h"
+#include "beyond/private/timer_private.h"
 
-#include <cerrno>
+#include "inference_impl.h"
+#include "inference_impl_distribute.h"
+#include "inference_impl_event_object.h"
+#include "inference_impl_latency.h"
+#include "inference_impl_fanout.h"
+
+// Minimum delay of the hedging timer in seconds, the overdue requests are hedged after this
+#define HEDGE_TIMER_RESOLUTION 0.001
+// Hedging delay until enough latency samples are collected
+#define HEDGE_DEFAULT_DELAY 0.1
+// Minimum number of samples for using the latency percentile as a hedging delay
+#define HEDGE_MIN_SAMPLES 8
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
+#define COND_BROADCAST(v)                                \
+    do {                                                 \
+        int ret = pthread_cond_broadcast(v);             \
+        if (ret != 0) {                                  \
+            ErrPrintCode(ret, "pthread_cond_broadcast"); \
+        }                                                \
+    } while (0)
 
 namespace beyond {
 
-Inference::impl::distribute *Inference::impl::distribute::Create(bool autoSplit)
+Inference::impl::distribute *Inference::impl::distribute::Create(bool autoSplit, int fanout, int hedgePercentile)
 {
-    return nullptr;
+    Inference::impl::distribute *impl;
+
+    if (fanout < 0 || hedgePercentile < 0 || hedgePercentile > 100) {
+        ErrPrint("Invalid argument: fanout(%d), hedge(%d)", fanout, hedgePercentile);
+        return nullptr;
+    }
+
+    try {
+        impl = new Inference::impl::distribute();
+    } catch (std::exception &e) {
+        ErrPrint("new inference impl distribute: %s", e.what());
+        return nullptr;
+    }
+
+    impl->eventObject = Inference::impl::EventObject::Create();
+    if (impl->eventObject == nullptr) {
+        impl->Destroy();
+        impl = nullptr;
+        return nullptr;
+    }
+
+    impl->autoSplit = autoSplit;
+    impl->fanout = fanout;
+    impl->hedgePercentile = hedgePercentile;
+
+    if (hedgePercentile == 0) {
+        return impl;
+    }
+
+    // NOTE:
+    // Hedged requests are issued by a timer which is running on its own thread,
+    // so they can be sent even if the caller's event loop is busy.
+    // The timer is armed only for the earliest hedging time of the requests, see ArmHedgeTimer().
+    impl->hedgeTimer = Timer::Create();
+    if (impl->hedgeTimer == nullptr) {
+        impl->Destroy();
+        impl = nullptr;
+        return nullptr;
+    }
+
+    impl->hedgeLoop = EventLoop::Create(true, false);
+    if (impl->hedgeLoop == nullptr) {
+        impl->Destroy();
+        impl = nullptr;
+        return nullptr;
+    }
+
+    impl->hedgeHandlerObject = impl->hedgeLoop->AddEventHandler(
+        static_cast<EventObjectBaseInterface *>(impl->hedgeTimer),
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        HedgeTimerHandler,
+        static_cast<void *>(impl));
+    if (impl->hedgeHandlerObject == nullptr) {
+        impl->Destroy();
+        impl = nullptr;
+        return nullptr;
+    }
+
+    int ret = impl->hedgeLoop->Run();
+    if (ret < 0) {
+        ErrPrint("Failed to run the event loop: %d", ret);
+        impl->Destroy();
+        impl = nullptr;
+        return nullptr;
+    }
+
+    return impl;
 }
 
 void Inference::impl::distribute::Destroy(void)
 {
+    // NOTE:
+    // The failed attempts are not retried with the remained peers anymore.
+    // The timer is detached with the lock, it is not armed by the other threads after this.
+    MUTEX_LOCK(&lock);
+    stopping = true;
+    Timer *timer = hedgeTimer;
+    hedgeTimer = nullptr;
+    MUTEX_UNLOCK(&lock);
+
+    if (hedgeLoop != nullptr) {
+        if (hedgeHandlerObject != nullptr) {
+            int ret = hedgeLoop->RemoveEventHandler(hedgeHandlerObject);
+            hedgeHandlerObject = nullptr;
+            if (ret < 0) {
+                DbgPrint("removeEventHandler: %d", ret);
+            }
+        }
+
+        // NOTE:
+        // The timer is destroyed together with the event loop which is using it.
+        hedgeLoop->SetStopHandler([](EventLoop *eventLoop, void *data) -> void {
+            DbgPrint("Hedge Event Loop is stopped");
+            eventLoop->Destroy();
+            if (data != nullptr) {
+                static_cast<Timer *>(data)->Destroy();
+            }
+        },
+                                  static_cast<void *>(timer));
+
+        int ret = hedgeLoop->Stop();
+        if (ret < 0) {
+            DbgPrint("Stop the event loop: %d", ret);
+        }
+
+        hedgeLoop = nullptr;
+    } else if (timer != nullptr) {
+        timer->Destroy();
+    }
+    timer = nullptr;
+
+    // NOTE:
+    // The peers are removed first, so no peer event can touch the requests while they are released.
+    while (peerVector.empty() == false) {
+        (void)RemovePeer(peerVector.back()->peer);
+    }
+
+    // NOTE:
+    // The requests could be referenced by the attempts which are being issued by the other threads (e.g. Invoke()),
+    // but the peers are removed after their calls are returned, so there is no such attempt anymore.
+
+    MUTEX_LOCK(&lock);
+    ReleaseAll();
+    MUTEX_UNLOCK(&lock);
+
+    if (eventObject != nullptr) {
+        eventObject->Destroy();
+        eventObject = nullptr;
+    }
+
+    delete this;
+}
+
+Inference::impl::distribute::distribute(void)
+    : eventObject(nullptr)
+    , autoSplit(false)
+    , fanout(0)
+    , hedgePercentile(0)
+    , hedgeLoop(nullptr)
+    , hedgeTimer(nullptr)
+    , hedgeHandlerObject(nullptr)
+    , lock(PTHREAD_MUTEX_INITIALIZER)
+    , callCond(PTHREAD_COND_INITIALIZER)
+    , hedgeArmedAt(DBL_MAX)
+    , nextAttemptId(1)
+    , stopping(false)
+{
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::distribute::ReleaseAll(void)
+{
+    std::map<uintptr_t, Attempt *>::iterator ait;
+    for (ait = attemptMap.begin(); ait != attemptMap.end(); ++ait) {
+        delete ait->second;
+    }
+    attemptMap.clear();
+
+    std::list<Request *>::iterator rit;
+    for (rit = requestList.begin(); rit != requestList.end(); ++rit) {
+        if ((*rit)->ownInput == true) {
+            FreeCopiedTensor(const_cast<beyond_tensor *>((*rit)->input), (*rit)->size);
+        }
+        delete *rit;
+    }
+    requestList.clear();
+
+    while (outputQueue.empty() == false) {
+        Output &output = outputQueue.front();
+        output.peer->FreeTensor(output.tensor, output.size);
+        outputQueue.pop();
+    }
+}
+
+Inference::impl::distribute::~distribute(void)
+{
+    int ret = pthread_cond_destroy(&callCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_destroy");
+    }
+
+    ret = pthread_mutex_destroy(&lock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
 }
 
 int Inference::impl::distribute::Configure(const beyond_config *options)
 {
-    return -ENOSYS;
+    // NOTE:
+    // The added peers are configured by caller already.
+    return 0;
 }
 
 int Inference::impl::distribute::LoadModel(const char *model)
 {
-    return -ENOSYS;
+    if (model == nullptr) {
+        ErrPrint("Invalid argument (%p)", model);
+        return -EINVAL;
+    }
+
+    return LoadModel(&model, 1);
+}
+
+Inference::impl::distribute::PeerContext *Inference::impl::distribute::GetReferencePeer(void) const
+{
+    std::vector<PeerContext *>::const_iterator it;
+    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+        if ((*it)->prepared == true) {
+            return *it;
+        }
+    }
+
+    return nullptr;
+}
+
+// NOTE:
+// Must be called with the lock
+// The peers are called without the lock, they are not removed until ReleasePeers() is called.
+void Inference::impl::distribute::HoldPeers(std::vector<PeerContext *> &held, bool preparedOnly)
+{
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+        if (preparedOnly == true && (*it)->prepared == false) {
+            continue;
+        }
+
+        (*it)->calls++;
+        held.push_back(*it);
+    }
+}
+
+void Inference::impl::distribute::ReleasePeers(const std::vector<PeerContext *> &held)
+{
+    if (held.empty() == true) {
+        return;
+    }
+
+    MUTEX_LOCK(&lock);
+    std::vector<PeerContext *>::const_iterator it;
+    for (it = held.begin(); it != held.end(); ++it) {
+        (*it)->calls--;
+    }
+    COND_BROADCAST(&callCond);
+    MUTEX_UNLOCK(&lock);
 }
 
 int Inference::impl::distribute::GetInputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
-    return -ENOSYS;
+    std::vector<PeerContext *> held;
+
+    MUTEX_LOCK(&lock);
+    PeerContext *peerCtx = GetReferencePeer();
+    if (peerCtx != nullptr) {
+        peerCtx->calls++;
+        held.push_back(peerCtx);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (peerCtx == nullptr) {
+        ErrPrint("Peer is not ready to use");
+        return -EINVAL;
+    }
+
+    int ret = peerCtx->peer->GetInputTensorInfo(info, size);
+    ReleasePeers(held);
+    return ret;
 }
 
 int Inference::impl::distribute::GetOutputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
-    return -ENOSYS;
+    std::vector<PeerContext *> held;
+
+    MUTEX_LOCK(&lock);
+    PeerContext *peerCtx = GetReferencePeer();
+    if (peerCtx != nullptr) {
+        peerCtx->calls++;
+        held.push_back(peerCtx);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (peerCtx == nullptr) {
+        ErrPrint("Peer is not ready to use");
+        return -EINVAL;
+    }
+
+    int ret = peerCtx->peer->GetOutputTensorInfo(info, size);
+    ReleasePeers(held);
+    return ret;
 }
 
 int Inference::impl::distribute::SetInputTensorInfo(const beyond_tensor_info *info, int size)
 {
-    return -ENOSYS;
+    int ret = -EINVAL;
+    std::vector<PeerContext *> held;
+
+    MUTEX_LOCK(&lock);
+    HoldPeers(held, true);
+    MUTEX_UNLOCK(&lock);
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = held.begin(); it != held.end(); ++it) {
+        ret = (*it)->peer->SetInputTensorInfo(info, size);
+        if (ret < 0) {
+            break;
+        }
+    }
+
+    ReleasePeers(held);
+
+    if (ret == -EINVAL) {
+        ErrPrint("Peer is not ready to use");
+    }
+
+    return ret;
 }
 
 int Inference::impl::distribute::SetOutputTensorInfo(const beyond_tensor_info *info, int size)
 {
-    return -ENOSYS;
+    int ret = -EINVAL;
+    std::vector<PeerContext *> held;
+
+    MUTEX_LOCK(&lock);
+    HoldPeers(held, true);
+    MUTEX_UNLOCK(&lock);
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = held.begin(); it != held.end(); ++it) {
+        ret = (*it)->peer->SetOutputTensorInfo(info, size);
+        if (ret < 0) {
+            break;
+        }
+    }
+
+    ReleasePeers(held);
+
+    if (ret == -EINVAL) {
+        ErrPrint("Peer is not ready to use");
+    }
+
+    return ret;
 }
 
 int Inference::impl::distribute::AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor)
 {
-    return -ENOSYS;
+    std::vector<PeerContext *> held;
+
+    MUTEX_LOCK(&lock);
+    PeerContext *peerCtx = GetReferencePeer();
+    if (peerCtx != nullptr) {
+        peerCtx->calls++;
+        held.push_back(peerCtx);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (peerCtx == nullptr) {
+        ErrPrint("Peer is not ready to use");
+        return -EINVAL;
+    }
+
+    int ret = peerCtx->peer->AllocateTensor(info, size, tensor);
+    ReleasePeers(held);
+    return ret;
 }
 
 void Inference::impl::distribute::FreeTensor(beyond_tensor *&tensor, int size)
 {
-    return;
+    InferenceInterface::PeerInterface *peer = nullptr;
+
+    MUTEX_LOCK(&lock);
+    // NOTE:
+    // Output tensors must be released by the peer who allocated them.
+    std::map<beyond_tensor *, InferenceInterface::PeerInterface *>::iterator it = outputOwner.find(tensor);
+    if (it != outputOwner.end()) {
+        peer = it->second;
+        outputOwner.erase(it);
+    } else {
+        PeerContext *peerCtx = GetReferencePeer();
+        if (peerCtx != nullptr) {
+            peer = peerCtx->peer;
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (peer == nullptr) {
+        ErrPrint("Peer is not ready to use");
+        return;
+    }
+
+    peer->FreeTensor(tensor, size);
 }
 
 int Inference::impl::distribute::Prepare(void)
 {
-    return -ENOSYS;
+    MUTEX_LOCK(&lock);
+    if (peerVector.empty() == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("There is not usable peer found");
+        return -EINVAL;
+    }
+
+    // NOTE:
+    // Every peer must be ready to take the same request.
+    // The peers which are failed to prepare are excluded from the distribution.
+    // The peers are activated and prepared concurrently, the model upload dominates the bring-up time.
+    // The lock is not held while preparing them, the prepared peers keep serving the requests.
+    int ret = -EINVAL;
+    int preparedCount = 0;
+    std::string model = modelFile;
+    std::vector<PeerContext *> pending;
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+        PeerContext *peerCtx = *it;
+
+        if (peerCtx->prepared == true) {
+            preparedCount++;
+            continue;
+        }
+
+        pending.push_back(peerCtx);
+        jobs.push_back([model, peerCtx](void) -> int {
+            if (peerCtx->activated == false) {
+                int ret = peerCtx->peer->Activate();
+                if (ret < 0) {
+                    ErrPrint("Unable to activate the peer: %d", ret);
+                    return ret;
+                }
+
+                peerCtx->activated = true;
+            }
+
+            if (model.empty() == false) {
+                int ret = peerCtx->peer->LoadModel(model.c_str());
+                if (ret < 0) {
+                    ErrPrint("Unable to load the model[%s]: %d", model.c_str(), ret);
+                    return ret;
+                }
+            }
+
+            int ret = peerCtx->peer->Prepare();
+            if (ret < 0) {
+                ErrPrint("Unable to prepare the peer: %d", ret);
+            }
+
+            return ret;
+        });
+    }
+
+    MUTEX_UNLOCK(&lock);
+
+    // NOTE:
+    // The peers are added and removed by the caller thread, they are not removed while preparing
+    std::vector<int> results;
+    Inference::impl::Fanout::Run(jobs, results);
+
+    MUTEX_LOCK(&lock);
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (results[i] < 0) {
+            ret = results[i];
+            continue;
+        }
+
+        pending[i]->prepared = true;
+        preparedCount++;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (preparedCount == 0) {
+        ErrPrint("There is no prepared peer");
+        return ret < 0 ? ret : -EINVAL;
+    }
+
+    DbgPrint("%d peers are prepared", preparedCount);
+    return 0;
+}
+
+void Inference::impl::distribute::GetSortedPeers(std::vector<PeerContext *> &sorted) const
+{
+    std::vector<PeerContext *>::const_iterator it;
+    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+        if ((*it)->prepared == true) {
+            sorted.push_back(*it);
+        }
+    }
+
+    // NOTE:
+    // The peer which has no latency sample comes first, so every peer gets a chance to be measured.
+    // The expected latency is scaled by the attempts which are waiting on the peer, as the remote mode does.
+    std::stable_sort(sorted.begin(), sorted.end(), [](const PeerContext *a, const PeerContext *b) -> bool {
+        return a->latency.GetAverage() * (a->inflight + 1) < b->latency.GetAverage() * (b->inflight + 1);
+    });
+}
+
+double Inference::impl::distribute::GetHedgeDelay(const PeerContext *peerCtx) const
+{
+    if (peerCtx == nullptr || peerCtx->latency.GetCount() < HEDGE_MIN_SAMPLES) {
+        return HEDGE_DEFAULT_DELAY;
+    }
+
+    return peerCtx->latency.GetPercentile(hedgePercentile);
+}
+
+// NOTE:
+// Must be called with the lock
+// The attempt is only registered here, the peer is invoked by IssueAttempts() without the lock.
+int Inference::impl::distribute::PickAttempt(Request *request, PeerContext *peerCtx, std::vector<Attempt> &picked)
+{
+    Attempt *attempt;
+
+    try {
+        attempt = new Attempt();
+    } catch (std::exception &e) {
+        ErrPrint("new attempt: %s", e.what());
+        return -ENOMEM;
+    }
+
+    attempt->id = nextAttemptId++;
+    attempt->request = request;
+    attempt->peerCtx = peerCtx;
+    attempt->startedAt = Inference::impl::LatencyEstimator::GetTimestamp();
+
+    try {
+        picked.push_back(*attempt);
+    } catch (std::exception &e) {
+        ErrPrint("push_back: %s", e.what());
+        delete attempt;
+        attempt = nullptr;
+        return -ENOMEM;
+    }
+
+    request->tried.push_back(peerCtx);
+    attemptMap[attempt->id] = attempt;
+
+    request->outstanding++;
+    request->issuing++;
+    peerCtx->inflight++;
+    peerCtx->calls++;
+
+    if (hedgePercentile > 0) {
+        request->hedgeAt = attempt->startedAt + GetHedgeDelay(peerCtx);
+    }
+
+    return 0;
+}
+
+// NOTE:
+// Must be called with the lock
+int Inference::impl::distribute::PickNextAttempt(Request *request, std::vector<Attempt> &picked)
+{
+    if (stopping == true) {
+        request->hedgeAt = DBL_MAX;
+        return -ECANCELED;
+    }
+
+    std::vector<PeerContext *> sorted;
+    GetSortedPeers(sorted);
+
+    int ret = -ENOENT;
+    std::vector<PeerContext *>::iterator it;
+    for (it = sorted.begin(); it != sorted.end(); ++it) {
+        if (std::find(request->tried.begin(), request->tried.end(), *it) != request->tried.end()) {
+            continue;
+        }
+
+        ret = PickAttempt(request, *it, picked);
+        if (ret == 0) {
+            break;
+        }
+    }
+
+    if (ret < 0) {
+        // There is no more peer to hedge
+        request->hedgeAt = DBL_MAX;
+    }
+
+    return ret;
+}
+
+// NOTE:
+// Must be called with the lock
+// A request which is never accepted by any peer is not notified, Invoke() returns the error instead.
+void Inference::impl::distribute::FailRequest(Request *request, int type)
+{
+    if (request->accepted == true) {
+        CompleteRequest(request, type);
+        return;
+    }
+
+    request->completed = true;
+    request->hedgeAt = DBL_MAX;
+}
+
+// NOTE:
+// Must be called without the lock
+// The peers are invoked without the lock, so a slow peer cannot block the responses and the other requests.
+// The picked attempts keep their peers and requests until they are sent.
+void Inference::impl::distribute::IssueAttempts(std::vector<Attempt> &picked)
+{
+    while (picked.empty() == false) {
+        Attempt attempt = picked.front();
+        picked.erase(picked.begin());
+
+        Request *request = attempt.request;
+        PeerContext *peerCtx = attempt.peerCtx;
+
+        int ret = peerCtx->peer->Invoke(request->input, request->size, reinterpret_cast<const void *>(attempt.id));
+
+        MUTEX_LOCK(&lock);
+        request->issuing--;
+        peerCtx->calls--;
+        COND_BROADCAST(&callCond);
+
+        if (ret < 0) {
+            ErrPrint("Failed to invoke the peer: %d", ret);
+            peerCtx->latency.Penalize();
+            request->error = ret;
+
+            std::map<uintptr_t, Attempt *>::iterator it = attemptMap.find(attempt.id);
+            if (it != attemptMap.end()) {
+                delete it->second;
+                attemptMap.erase(it);
+                request->outstanding--;
+                peerCtx->inflight--;
+            }
+
+            if (request->completed == false && request->outstanding == 0) {
+                if (PickNextAttempt(request, picked) < 0) {
+                    FailRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+                }
+            }
+        } else {
+            request->accepted = true;
+        }
+
+        if (IsReleasable(request) == true) {
+            ReleaseRequest(request);
+        }
+
+        ArmHedgeTimer();
+        MUTEX_UNLOCK(&lock);
+    }
 }
 
 int Inference::impl::distribute::Invoke(const beyond_tensor *input, int size, const void *context)
 {
-    return -ENOSYS;
+    if (input == nullptr || size <= 0) {
+        ErrPrint("Invalid argument: input(%p), size(%d)", input, size);
+        return -EINVAL;
+    }
+
+    Request *request;
+
+    try {
+        request = new Request();
+    } catch (std::exception &e) {
+        ErrPrint("new request: %s", e.what());
+        return -ENOMEM;
+    }
+
+    request->context = context;
+    request->input = input;
+    request->size = size;
+    request->ownInput = false;
+    request->hedgeAt = DBL_MAX;
+    request->outstanding = 0;
+    request->issuing = 0;
+    request->error = 0;
+    request->accepted = false;
+    request->completed = false;
+
+    MUTEX_LOCK(&lock);
+    std::vector<PeerContext *> sorted;
+    GetSortedPeers(sorted);
+    if (sorted.empty() == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("Peer is not ready to use");
+        delete request;
+        return -EINVAL;
+    }
+
+    int count = fanout;
+    if (count == 0) {
+        count = hedgePercentile > 0 ? 1 : static_cast<int>(sorted.size());
+    }
+
+    // NOTE:
+    // The caller releases the input as soon as the first response is delivered.
+    // If the request can be sent to more than one peer, keep a copy of the input
+    // until the stragglers are done with it.
+    if (count > 1 || hedgePercentile > 0) {
+        beyond_tensor *copied = nullptr;
+        int ret = CopyTensor(input, size, copied);
+        if (ret < 0) {
+            MUTEX_UNLOCK(&lock);
+            delete request;
+            return ret;
+        }
+
+        request->input = copied;
+        request->ownInput = true;
+    }
+
+    int ret = -EINVAL;
+    std::vector<Attempt> picked;
+    std::vector<PeerContext *>::iterator it;
+    for (it = sorted.begin(); it != sorted.end() && request->outstanding < count; ++it) {
+        ret = PickAttempt(request, *it, picked);
+    }
+
+    if (request->outstanding == 0) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("Unable to invoke any peer: %d", ret);
+        if (request->ownInput == true) {
+            FreeCopiedTensor(const_cast<beyond_tensor *>(request->input), request->size);
+        }
+        delete request;
+        return ret < 0 ? ret : -EFAULT;
+    }
+
+    // NOTE:
+    // The request is kept by this call until its attempts are sent,
+    // even if it is completed by a fast peer in the meantime.
+    request->issuing++;
+    requestList.push_back(request);
+    MUTEX_UNLOCK(&lock);
+
+    IssueAttempts(picked);
+
+    MUTEX_LOCK(&lock);
+    request->issuing--;
+    ret = 0;
+    if (request->accepted == false) {
+        ErrPrint("Unable to invoke any peer: %d", request->error);
+        ret = request->error < 0 ? request->error : -EFAULT;
+    }
+
+    if (IsReleasable(request) == true) {
+        ReleaseRequest(request);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    return ret;
 }
 
 int Inference::impl::distribute::GetOutput(beyond_tensor *&tensor, int &size)
 {
-    return -ENOSYS;
+    MUTEX_LOCK(&lock);
+    if (outputQueue.empty() == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("There is no output");
+        return -EAGAIN;
+    }
+
+    Output output = outputQueue.front();
+    outputQueue.pop();
+    outputOwner[output.tensor] = output.peer;
+    MUTEX_UNLOCK(&lock);
+
+    tensor = output.tensor;
+    size = output.size;
+    return 0;
 }
 
 int Inference::impl::distribute::Stop(void)
 {
-    return -ENOSYS;
+    int ret = -EINVAL;
+    std::vector<PeerContext *> held;
+
+    MUTEX_LOCK(&lock);
+    HoldPeers(held, true);
+    MUTEX_UNLOCK(&lock);
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = held.begin(); it != held.end(); ++it) {
+        int status = (*it)->peer->Stop();
+        if (status < 0) {
+            ErrPrint("Failed to stop the peer: %d", status);
+        }
+
+        if (ret == -EINVAL || status < 0) {
+            ret = status;
+        }
+    }
+
+    ReleasePeers(held);
+    return ret;
 }
 
 int Inference::impl::distribute::LoadModel(const char **model, int size)
 {
-    return -ENOSYS;
+    if (size <= 0 || model == nullptr || *model == nullptr) {
+        ErrPrint("invalid argument: size(%d), model(%p), model[0](%p)", size, model, model != nullptr ? *model : nullptr);
+        return -EINVAL;
+    }
+
+    if (size != 1) {
+        DbgPrint("TBD: handling the multiple model and multiple peers");
+        return -ENOTSUP;
+    }
+
+    // NOTE:
+    // Keep the model filename, it is going to be loaded on every peer in the prepare() stage
+    MUTEX_LOCK(&lock);
+    modelFile = std::string(model[0]);
+    MUTEX_UNLOCK(&lock);
+    return 0;
 }
 
 int Inference::impl::distribute::AddRuntime(InferenceInterface::RuntimeInterface *runtime)
 {
-    return -ENOSYS;
+    ErrPrint("Distribute inference does not require the runtime object");
+    return -EINVAL;
 }
 
 int Inference::impl::distribute::RemoveRuntime(InferenceInterface::RuntimeInterface *runtime)
 {
-    return -ENOSYS;
+    ErrPrint("Distribute inference does not require the runtime object");
+    return -EINVAL;
+}
+
+int Inference::impl::distribute::PublishEvent(int type, void *data)
+{
+    EventObjectInterface::EventData *eventData;
+
+    try {
+        eventData = new EventObjectInterface::EventData();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return -ENOMEM;
+    }
+
+    eventData->type = type;
+    eventData->data = data;
+
+    DbgPrint("Publish event data! (0x%.8X, %p)", eventData->type, eventData->data);
+    int ret = eventObject->PublishEventData(eventData);
+    if (ret < 0) {
+        assert(!"Failed to publish the event data");
+        DbgPrint("Failed to publish the event data");
+        delete eventData;
+        eventData = nullptr;
+    }
+
+    return ret;
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::distribute::CompleteRequest(Request *request, int type)
+{
+    request->completed = true;
+    request->hedgeAt = DBL_MAX;
+    (void)PublishEvent(type, const_cast<void *>(request->context));
 }
 
-// Add peer modules for invoke remote inference
+// NOTE:
+// Must be called with the lock
+void Inference::impl::distribute::ReleaseRequest(Request *request)
+{
+    requestList.remove(request);
+
+    if (request->ownInput == true) {
+        FreeCopiedTensor(const_cast<beyond_tensor *>(request->input), request->size);
+    }
+
+    delete request;
+}
+
+// NOTE:
+// Must be called with the lock
+bool Inference::impl::distribute::IsReleasable(const Request *request) const
+{
+    return request->completed == true && request->outstanding == 0 && request->issuing == 0;
+}
+
+// NOTE:
+// Must be called with the lock
+// The hedging timer is a one-shot timer which is armed for the earliest request to be hedged.
+// It is not fired at all while there is no request to hedge.
+void Inference::impl::distribute::ArmHedgeTimer(void)
+{
+    if (hedgeTimer == nullptr) {
+        return;
+    }
+
+    double earliest = DBL_MAX;
+    std::list<Request *>::iterator it;
+    for (it = requestList.begin(); it != requestList.end(); ++it) {
+        if ((*it)->completed == false && (*it)->hedgeAt < earliest) {
+            earliest = (*it)->hedgeAt;
+        }
+    }
+
+    if (stopping == true) {
+        earliest = DBL_MAX;
+    }
+
+    if (earliest == hedgeArmedAt) {
+        return;
+    }
+
+    double delay = 0.0;
+    if (earliest != DBL_MAX) {
+        delay = std::max(earliest - Inference::impl::LatencyEstimator::GetTimestamp(), HEDGE_TIMER_RESOLUTION);
+    }
+
+    int ret = hedgeTimer->SetTimer(delay, false);
+    if (ret < 0) {
+        ErrPrint("Failed to arm the hedging timer: %d", ret);
+        return;
+    }
+
+    hedgeArmedAt = earliest;
+}
+
+beyond_handler_return Inference::impl::distribute::PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data)
+{
+    if ((type & BEYOND_EVENT_TYPE_ERROR) == BEYOND_EVENT_TYPE_ERROR) {
+        DbgPrint("BeyonD Error Event");
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    PeerContext *peerCtx = static_cast<PeerContext *>(data);
+    distribute *impl = peerCtx->owner;
+
+    if (IsRequestEvent(eventInfo->type) == false || eventInfo->data == nullptr) {
+        // NOTE:
+        // Not a request event, deliver it as it is
+        (void)impl->PublishEvent(eventInfo->type, eventInfo->data);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    // NOTE:
+    // Every request event of the peer has the id of an attempt as its context,
+    // it is never delivered to the caller as it is.
+    uintptr_t id = reinterpret_cast<uintptr_t>(eventInfo->data);
+
+    // NOTE:
+    // The output must be drained from the peer even if the attempt is retired or the request is already completed by another peer,
+    // otherwise it is taken by the next response of the peer.
+    // It is fetched without the lock, the handler is the only one who takes the outputs of the peer.
+    beyond_tensor *tensor = nullptr;
+    int size = 0;
+    int ret = -EINVAL;
+    if ((eventInfo->type & BEYOND_EVENT_TYPE_INFERENCE_MASK) == BEYOND_EVENT_TYPE_INFERENCE_SUCCESS) {
+        ret = peerCtx->peer->GetOutput(tensor, size);
+        if (ret < 0) {
+            ErrPrint("Unable to get the output: %d", ret);
+        }
+    }
+
+    MUTEX_LOCK(&impl->lock);
+    std::map<uintptr_t, Attempt *>::iterator it = impl->attemptMap.find(id);
+    if (it == impl->attemptMap.end()) {
+        MUTEX_UNLOCK(&impl->lock);
+        DbgPrint("Drop the response of the retired attempt (%lu)", static_cast<unsigned long>(id));
+        if (ret == 0) {
+            peerCtx->peer->FreeTensor(tensor, size);
+        }
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    Attempt *attempt = it->second;
+    impl->attemptMap.erase(it);
+
+    Request *request = attempt->request;
+    double latency = Inference::impl::LatencyEstimator::GetTimestamp() - attempt->startedAt;
+
+    // NOTE:
+    // The response could arrive before the Invoke() of the peer is returned to IssueAttempts()
+    request->accepted = true;
+    request->outstanding--;
+    peerCtx->inflight--;
+
+    bool straggler = false;
+    std::vector<Attempt> picked;
+    if (ret == 0) {
+        peerCtx->latency.Update(latency);
+
+        if (request->completed == false) {
+            Output output = {
+                .tensor = tensor,
+                .size = size,
+                .peer = peerCtx->peer,
+            };
+            impl->outputQueue.push(output);
+            impl->CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS);
+        } else {
+            DbgPrint("Discard the straggler output (%lf sec)", latency);
+            straggler = true;
+        }
+    } else {
+        peerCtx->latency.Penalize();
+
+        if (request->completed == false && request->outstanding == 0) {
+            // NOTE:
+            // Every attempt is failed, try the peer which is not tried yet
+            if (impl->PickNextAttempt(request, picked) < 0) {
+                impl->CompleteRequest(request, eventInfo->type);
+            }
+        }
+    }
+
+    if (impl->IsReleasable(request) == true) {
+        impl->ReleaseRequest(request);
+    }
+
+    impl->ArmHedgeTimer();
+    MUTEX_UNLOCK(&impl->lock);
+
+    if (straggler == true) {
+        peerCtx->peer->FreeTensor(tensor, size);
+    }
+
+    impl->IssueAttempts(picked);
+
+    delete attempt;
+    attempt = nullptr;
+    return BEYOND_HANDLER_RETURN_RENEW;
+}
+
+bool Inference::impl::distribute::IsRequestEvent(int type)
+{
+    int inferenceType = type & BEYOND_EVENT_TYPE_INFERENCE_MASK;
+    return inferenceType == BEYOND_EVENT_TYPE_INFERENCE_SUCCESS ||
+           inferenceType == BEYOND_EVENT_TYPE_INFERENCE_ERROR ||
+           inferenceType == BEYOND_EVENT_TYPE_INFERENCE_CANCELED;
+}
+
+// RUN_ON_THE_THREAD
+beyond_handler_return Inference::impl::distribute::HedgeTimerHandler(EventObjectBaseInterface *obj, int type, void *data)
+{
+    if ((type & beyond_event_type::BEYOND_EVENT_TYPE_ERROR) == beyond_event_type::BEYOND_EVENT_TYPE_ERROR) {
+        ErrPrint("Error! 0x%.8x", type);
+        return beyond_handler_return::BEYOND_HANDLER_RETURN_CANCEL;
+    }
+
+    distribute *impl = static_cast<distribute *>(data);
+    Timer *timer = static_cast<Timer *>(obj);
+
+    EventObjectInterface::EventData *eventData = nullptr;
+    if (timer->FetchEventData(eventData) == 0) {
+        (void)timer->DestroyEventData(eventData);
+    }
+
+    MUTEX_LOCK(&impl->lock);
+    // NOTE:
+    // The one-shot timer is expired, it is armed again for the next request to be hedged
+    impl->hedgeArmedAt = DBL_MAX;
+
+    if (impl->stopping == true) {
+        MUTEX_UNLOCK(&impl->lock);
+        return beyond_handler_return::BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    std::vector<Attempt> picked;
+    double now = Inference::impl::LatencyEstimator::GetTimestamp();
+    std::list<Request *>::iterator it;
+    for (it = impl->requestList.begin(); it != impl->requestList.end(); ++it) {
+        Request *request = *it;
+
+        if (request->completed == true || request->hedgeAt > now) {
+            continue;
+        }
+
+        DbgPrint("Hedge the request (%p)", request->context);
+        (void)impl->PickNextAttempt(request, picked);
+    }
+
+    impl->ArmHedgeTimer();
+    MUTEX_UNLOCK(&impl->lock);
+
+    impl->IssueAttempts(picked);
+    return beyond_handler_return::BEYOND_HANDLER_RETURN_RENEW;
+}
+
+int Inference::impl::distribute::CopyTensor(const beyond_tensor *input, int size, beyond_tensor *&tensor)
+{
+    beyond_tensor *copied = static_cast<beyond_tensor *>(calloc(size, sizeof(beyond_tensor)));
+    if (copied == nullptr) {
+        int ret = -errno;
+        ErrPrintCode(errno, "calloc");
+        return ret;
+    }
+
+    for (int i = 0; i < size; i++) {
+        copied[i].type = input[i].type;
+        copied[i].size = input[i].size;
+        copied[i].data = malloc(input[i].size);
+        if (copied[i].data == nullptr) {
+            int ret = -errno;
+            ErrPrintCode(errno, "malloc");
+            FreeCopiedTensor(copied, i);
+            return ret;
+        }
+
+        memcpy(copied[i].data, input[i].data, input[i].size);
+    }
+
+    tensor = copied;
+    return 0;
+}
+
+void Inference::impl::distribute::FreeCopiedTensor(beyond_tensor *tensor, int size)
+{
+    for (int i = 0; i < size; i++) {
+        free(tensor[i].data);
+    }
+
+    free(tensor);
+}
+
+// Add peer modules for invoke distributed inference
 int Inference::impl::distribute::AddPeer(InferenceInterface::PeerInterface *peer)
 {
-    return -ENOSYS;
+    PeerContext *peerCtx;
+
+    try {
+        peerCtx = new PeerContext();
+    } catch (std::exception &e) {
+        ErrPrint("new peer context: %s", e.what());
+        return -ENOMEM;
+    }
+
+    peerCtx->owner = this;
+    peerCtx->peer = peer;
+    peerCtx->activated = false;
+    peerCtx->prepared = false;
+    peerCtx->inflight = 0;
+    peerCtx->calls = 0;
+
+    int ret = peer->AddHandler(
+        Inference::impl::distribute::PeerEventHandler,
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        static_cast<void *>(peerCtx));
+    if (ret < 0) {
+        ErrPrint("Failed to add event handler");
+        delete peerCtx;
+        return ret;
+    }
+
+    // NOTE:
+    // The peer is activated by the Prepare() with the others
+    MUTEX_LOCK(&lock);
+    peerVector.push_back(peerCtx);
+    MUTEX_UNLOCK(&lock);
+    return ret;
 }
 
 int Inference::impl::distribute::RemovePeer(InferenceInterface::PeerInterface *peer)
 {
-    return -ENOSYS;
+    MUTEX_LOCK(&lock);
+    std::vector<PeerContext *>::iterator it;
+    it = std::find_if(peerVector.begin(), peerVector.end(), [peer](const PeerContext *peerCtx) -> bool {
+        return peerCtx->peer == peer;
+    });
+    if (it == peerVector.end()) {
+        MUTEX_UNLOCK(&lock);
+        DbgPrint("Peer is not found");
+        return -ENOENT;
+    }
+
+    PeerContext *peerCtx = *it;
+    peerVector.erase(it);
+
+    // NOTE:
+    // The peer is not picked anymore, wait for the calls which are made to it without the lock
+    while (peerCtx->calls > 0) {
+        int status = pthread_cond_wait(&callCond, &lock);
+        if (status != 0) {
+            ErrPrintCode(status, "pthread_cond_wait");
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+
+    // NOTE:
+    // The handler is removed before retiring the attempts of the peer,
+    // there is no event of the peer which can touch them after this.
+    if (peerCtx->activated == true) {
+        peer->Deactivate();
+    }
+
+    int ret = peer->RemoveHandler(
+        Inference::impl::distribute::PeerEventHandler,
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        static_cast<void *>(peerCtx));
+
+    std::vector<Attempt> picked;
+    MUTEX_LOCK(&lock);
+    RetireAttempts(peerCtx, picked);
+    ArmHedgeTimer();
+    MUTEX_UNLOCK(&lock);
+
+    IssueAttempts(picked);
+
+    delete peerCtx;
+    return ret;
+}
+
+// NOTE:
+// Must be called with the lock
+// The attempts on the removed peer are never going to be completed.
+// Regard them as failed ones, so the requests can be retried with other peers.
+void Inference::impl::distribute::RetireAttempts(PeerContext *peerCtx, std::vector<Attempt> &picked)
+{
+    std::map<uintptr_t, Attempt *>::iterator ait = attemptMap.begin();
+    while (ait != attemptMap.end()) {
+        Attempt *attempt = ait->second;
+        if (attempt->peerCtx != peerCtx) {
+            ++ait;
+            continue;
+        }
+
+        ait = attemptMap.erase(ait);
+
+        Request *request = attempt->request;
+        request->outstanding--;
+        delete attempt;
+
+        if (request->completed == false && request->outstanding == 0) {
+            if (PickNextAttempt(request, picked) < 0) {
+                FailRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+            }
+        }
+
+        if (IsReleasable(request) == true) {
+            ReleaseRequest(request);
+        }
+    }
+
+    std::list<Request *>::iterator rit;
+    for (rit = requestList.begin(); rit != requestList.end(); ++rit) {
+        std::vector<PeerContext *> &tried = (*rit)->tried;
+        tried.erase(std::remove(tried.begin(), tried.end(), peerCtx), tried.end());
+    }
 }
 
 int Inference::impl::distribute::GetHandle(void) const
 {
-    return -1;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->GetHandle();
 }
 
 int Inference::impl::distribute::AddHandler(beyond_event_handler_t handler, int type, void *data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->AddHandler(handler, type, data);
 }
 
 int Inference::impl::distribute::RemoveHandler(beyond_event_handler_t handler, int type, void *data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->RemoveHandler(handler, type, data);
 }
 
 int Inference::impl::distribute::FetchEventData(EventObjectInterface::EventData *&data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->FetchEventData(data);
 }
 
 int Inference::impl::distribute::DestroyEventData(EventObjectInterface::EventData *&data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->DestroyEventData(data);
 }
 
 } // namespace beyond
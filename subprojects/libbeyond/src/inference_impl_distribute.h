@@ -17,19 +17,30 @@
 #ifndef __BEYOND_INTERNAL_INFERENCE_IMPL_DISTRIBUTE_H__
 #define __BEYOND_INTERNAL_INFERENCE_IMPL_DISTRIBUTE_H__
 
+#include <cstdint>
 #include <functional>
+#include <vector>
+#include <list>
+#include <queue>
+#include <map>
+#include <string>
+
+#include <pthread.h>
 
 #include <beyond/common.h>
 #include <beyond/private/event_object_private.h>
+#include <beyond/private/event_loop_private.h>
+#include <beyond/private/timer_private.h>
 #include <beyond/private/inference_private.h>
 
 #include "inference_impl.h"
+#include "inference_impl_latency.h"
 
 namespace beyond {
 
 class Inference::impl::distribute final : public Inference::impl {
 public: // Inference interface
-    static distribute *Create(bool autoSplit = false);
+    static distribute *Create(bool autoSplit = false, int fanout = 0, int hedgePercentile = 0);
 
     void Destroy(void) override;
 
@@ -69,8 +80,98 @@ public: // Implementation interface
     int RemovePeer(InferenceInterface::PeerInterface *peer) override;
 
 private:
-    distribute(void) = default;
-    ~distribute(void) = default;
+    struct PeerContext {
+        distribute *owner;
+        InferenceInterface::PeerInterface *peer;
+        Inference::impl::LatencyEstimator latency;
+        bool activated; // activated by the Prepare(), the peers are brought up concurrently
+        bool prepared;
+        int inflight; // attempts which are not responded yet, the expected latency is scaled by it
+        int calls; // calls to the peer which are made without the lock, the peer is not removed until they return
+    };
+
+    // NOTE:
+    // A request can be sent to multiple peers (fanout, hedging and failover).
+    // The first successful response completes the request, and the others are discarded.
+    struct Request {
+        const void *context;
+        const beyond_tensor *input;
+        int size;
+        bool ownInput; // The input is copied if the request could be outlived by its stragglers
+        double hedgeAt;
+        int outstanding;
+        int issuing; // attempts which are being sent to the peers without the lock, the request is kept until they are sent
+        bool accepted; // at least one peer accepted the request, otherwise Invoke() returns the error
+        int error; // the last error of the attempts, it is returned by Invoke() if the request is not accepted
+        bool completed;
+        std::vector<PeerContext *> tried;
+    };
+
+    // NOTE:
+    // The id of an attempt is delivered to the peer as the invoke context, ids are never reused.
+    // A response whose id is not in the attemptMap belongs to a retired attempt, it is dropped.
+    struct Attempt {
+        uintptr_t id;
+        Request *request;
+        PeerContext *peerCtx;
+        double startedAt;
+    };
+
+    struct Output {
+        beyond_tensor *tensor;
+        int size;
+        InferenceInterface::PeerInterface *peer;
+    };
+
+private:
+    distribute(void);
+    ~distribute(void);
+
+    static beyond_handler_return PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data);
+    static beyond_handler_return HedgeTimerHandler(EventObjectBaseInterface *obj, int type, void *data);
+
+    int PublishEvent(int type, void *data);
+    int PickAttempt(Request *request, PeerContext *peerCtx, std::vector<Attempt> &picked);
+    int PickNextAttempt(Request *request, std::vector<Attempt> &picked);
+    void IssueAttempts(std::vector<Attempt> &picked);
+    void CompleteRequest(Request *request, int type);
+    void FailRequest(Request *request, int type);
+    void ReleaseRequest(Request *request);
+    bool IsReleasable(const Request *request) const;
+    double GetHedgeDelay(const PeerContext *peerCtx) const;
+    void ArmHedgeTimer(void);
+    void GetSortedPeers(std::vector<PeerContext *> &sorted) const;
+    PeerContext *GetReferencePeer(void) const;
+    void HoldPeers(std::vector<PeerContext *> &held, bool preparedOnly);
+    void ReleasePeers(const std::vector<PeerContext *> &held);
+    void RetireAttempts(PeerContext *peerCtx, std::vector<Attempt> &picked);
+    void ReleaseAll(void);
+
+    static bool IsRequestEvent(int type);
+
+    static int CopyTensor(const beyond_tensor *input, int size, beyond_tensor *&tensor);
+    static void FreeCopiedTensor(beyond_tensor *tensor, int size);
+
+    Inference::impl::EventObject *eventObject;
+    bool autoSplit;
+    int fanout;
+    int hedgePercentile;
+
+    EventLoop *hedgeLoop;
+    Timer *hedgeTimer;
+    EventLoop::HandlerObject *hedgeHandlerObject;
+
+    pthread_mutex_t lock;
+    pthread_cond_t callCond; // signaled when the calls to a peer are returned
+    double hedgeArmedAt; // DBL_MAX if the hedging timer is not armed
+    std::vector<PeerContext *> peerVector;
+    std::list<Request *> requestList;
+    std::map<uintptr_t, Attempt *> attemptMap;
+    uintptr_t nextAttemptId;
+    bool stopping; // the instance is being destroyed, the failed requests are not retried
+    std::queue<Output> outputQueue;
+    std::map<beyond_tensor *, InferenceInterface::PeerInterface *> outputOwner;
+    std::string modelFile;
 };
 
 } // namespace beyond
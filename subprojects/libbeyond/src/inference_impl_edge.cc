@@ -14,8 +14,17 @@
  * limitations under the License.
  */
 
-#include "inference_impl_edge.h"
-#include "inference_impl.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+
+#include <exception>
+
+#include <pthread.h>
 
 #include "beyond/platform/beyond_platform.h"
 #include "beyond/private/log_private.h"
@@ -24,128 +33,1154 @@
 #include "beyond/private/event_object_private.h"
 #include "beyond/private/inference_interface_private.h"
 
-#include <cerrno>
+#include "inference_impl.h"
+#include "inference_impl_edge.h"
+#include "inference_impl_event_object.h"
+#include "inference_impl_latency.h"
+
+// Number of requests for measuring a split candidate
+#define EDGE_EXPLORE_SAMPLES 8
+// Number of requests until the candidates are estimated again, the link and the load are changing
+#define EDGE_EXPLORE_INTERVAL 1000
+// An inactive candidate is activated only if its estimation is shorter than this ratio of the active one,
+// activating a candidate uploads its tail to the peer.
+#define EDGE_SWITCH_THRESHOLD 0.9
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
 
 namespace beyond {
 
 Inference::impl::edge *Inference::impl::edge::Create(bool autoSplit)
 {
-    return nullptr;
+    Inference::impl::edge *impl;
+
+    try {
+        impl = new Inference::impl::edge();
+    } catch (std::exception &e) {
+        ErrPrint("new inference impl edge: %s", e.what());
+        return nullptr;
+    }
+
+    impl->eventObject = Inference::impl::EventObject::Create();
+    if (impl->eventObject == nullptr) {
+        impl->Destroy();
+        impl = nullptr;
+        return nullptr;
+    }
+
+    impl->autoSplit = autoSplit;
+    return impl;
 }
 
 void Inference::impl::edge::Destroy(void)
+{
+    // NOTE:
+    // The switch thread uses the runtime, the peer and the pending requests
+    WaitSwitch();
+
+    std::set<Request *>::iterator it;
+    for (it = requestSet.begin(); it != requestSet.end(); ++it) {
+        Request *request = *it;
+        free(request->intermediate);
+        delete request;
+    }
+    requestSet.clear();
+
+    while (pendingQueue.empty() == false) {
+        delete pendingQueue.front();
+        pendingQueue.pop();
+    }
+
+    if (peer != nullptr) {
+        while (outputQueue.empty() == false) {
+            peer->FreeTensor(outputQueue.front().first, outputQueue.front().second);
+            outputQueue.pop();
+        }
+
+        (void)RemovePeer(peer);
+    }
+
+    if (runtime != nullptr) {
+        (void)RemoveRuntime(runtime);
+    }
+
+    if (eventObject != nullptr) {
+        eventObject->Destroy();
+        eventObject = nullptr;
+    }
+
+    delete this;
+}
+
+Inference::impl::edge::edge(void)
+    : eventObject(nullptr)
+    , runtime(nullptr)
+    , peer(nullptr)
+    , autoSplit(false)
+    , current(-1)
+    , pendingSwitch(-1)
+    , switching(false)
+    , exploring(false)
+    , samples(0)
+    , inflight(0)
+    , switchCond(PTHREAD_COND_INITIALIZER)
+    , lock(PTHREAD_MUTEX_INITIALIZER)
 {
 }
 
+Inference::impl::edge::~edge(void)
+{
+    int ret = pthread_cond_destroy(&switchCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_destroy");
+    }
+
+    ret = pthread_mutex_destroy(&lock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
+}
+
 int Inference::impl::edge::Configure(const beyond_config *options)
 {
-    return -ENOSYS;
+    // NOTE:
+    // The added runtime and peer are configured by caller already.
+    return 0;
 }
 
 int Inference::impl::edge::LoadModel(const char *model)
 {
-    return -ENOSYS;
+    if (model == nullptr) {
+        ErrPrint("Invalid argument (%p)", model);
+        return -EINVAL;
+    }
+
+    return LoadModel(&model, 1);
 }
 
 int Inference::impl::edge::GetInputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
-    return -ENOSYS;
+    if (runtime == nullptr || current < 0) {
+        ErrPrint("Runtime is not ready to use");
+        return -EINVAL;
+    }
+    return runtime->GetInputTensorInfo(info, size);
 }
 
 int Inference::impl::edge::GetOutputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
-    return -ENOSYS;
+    if (peer == nullptr || current < 0) {
+        ErrPrint("Peer is not ready to use");
+        return -EINVAL;
+    }
+    return peer->GetOutputTensorInfo(info, size);
 }
 
 int Inference::impl::edge::SetInputTensorInfo(const beyond_tensor_info *info, int size)
 {
-    return -ENOSYS;
+    if (runtime == nullptr || current < 0) {
+        ErrPrint("Runtime is not ready to use");
+        return -EINVAL;
+    }
+    return runtime->SetInputTensorInfo(info, size);
 }
 
 int Inference::impl::edge::SetOutputTensorInfo(const beyond_tensor_info *info, int size)
 {
-    return -ENOSYS;
+    if (peer == nullptr || current < 0) {
+        ErrPrint("Peer is not ready to use");
+        return -EINVAL;
+    }
+    return peer->SetOutputTensorInfo(info, size);
 }
 
 int Inference::impl::edge::AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor)
 {
-    return -ENOSYS;
+    if (runtime == nullptr) {
+        ErrPrint("Runtime is not ready to use");
+        return -EINVAL;
+    }
+    return runtime->AllocateTensor(info, size, tensor);
 }
 
 void Inference::impl::edge::FreeTensor(beyond_tensor *&tensor, int size)
 {
-    return;
+    MUTEX_LOCK(&lock);
+    // NOTE:
+    // The output tensors are allocated by the peer (tail),
+    // and the input tensors are allocated by the runtime (head).
+    std::set<beyond_tensor *>::iterator it = outputSet.find(tensor);
+    bool isOutput = (it != outputSet.end());
+    if (isOutput == true) {
+        outputSet.erase(it);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (isOutput == true) {
+        if (peer == nullptr) {
+            ErrPrint("Peer is not ready to use");
+            return;
+        }
+
+        peer->FreeTensor(tensor, size);
+        return;
+    }
+
+    if (runtime == nullptr) {
+        ErrPrint("Runtime is not ready to use");
+        return;
+    }
+
+    runtime->FreeTensor(tensor, size);
+}
+
+// NOTE:
+// Must be called without the lock
+// Loading the models takes long time, the tail model is uploaded to the peer.
+// The caller guarantees that there is no in-flight request, so the runtime and the peer are not used by others.
+int Inference::impl::edge::Activate(const std::string &head, const std::string &tail)
+{
+    DbgPrint("Activate the split candidate: %s / %s", head.c_str(), tail.c_str());
+
+    int ret = runtime->LoadModel(head.c_str());
+    if (ret < 0) {
+        ErrPrint("Unable to load the head model[%s]: %d", head.c_str(), ret);
+        return ret;
+    }
+
+    ret = runtime->Prepare();
+    if (ret < 0) {
+        ErrPrint("Unable to prepare the runtime: %d", ret);
+        return ret;
+    }
+
+    ret = peer->LoadModel(tail.c_str());
+    if (ret < 0) {
+        ErrPrint("Unable to load the tail model[%s]: %d", tail.c_str(), ret);
+        return ret;
+    }
+
+    ret = peer->Prepare();
+    if (ret < 0) {
+        ErrPrint("Unable to prepare the peer: %d", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::edge::SetCurrent(int idx)
+{
+    if (exploring == true) {
+        // The old measurements are not valid anymore
+        candidates[idx].headLatency.Reset();
+        candidates[idx].remoteLatency.Reset();
+    }
+
+    current = idx;
+    samples = 0;
+}
+
+// NOTE:
+// Must be called with the lock
+// The expected latency of a candidate is the local compute time of the head
+// and the remote stage time which consists of the intermediate tensor transfer and the tail compute time.
+// The transfer time depends on the link bandwidth and the intermediate tensor size,
+// so a smaller intermediate tensor wins over the slow link even if it requires more local computation.
+int Inference::impl::edge::SelectCandidate(void) const
+{
+    int selected = current;
+    double selectedLatency = 0.0;
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Candidate &candidate = candidates[i];
+
+        if (candidate.failed == true || candidate.headLatency.GetCount() == 0 || candidate.remoteLatency.GetCount() == 0) {
+            continue;
+        }
+
+        double head = candidate.headLatency.GetAverage();
+        double remote = candidate.remoteLatency.GetAverage();
+        double throughput = remote > 0.0 ? static_cast<double>(candidate.bytes) / remote : 0.0;
+
+        InfoPrint("candidate[%zu] head: %lf sec, remote: %lf sec, intermediate: %lld bytes (%lf bytes/sec)", i, head, remote, candidate.bytes, throughput);
+
+        if (selected < 0 || selectedLatency == 0.0 || head + remote < selectedLatency) {
+            selected = static_cast<int>(i);
+            selectedLatency = head + remote;
+        }
+    }
+
+    return selected;
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::edge::RecordMeasurements(void)
+{
+    for (size_t i = 0; i < candidates.size(); i++) {
+        Candidate &candidate = candidates[i];
+        if (candidate.headLatency.GetCount() == 0 || candidate.remoteLatency.GetCount() == 0) {
+            continue;
+        }
+
+        candidate.measuredHead = candidate.headLatency.GetAverage();
+        candidate.measuredRemote = candidate.remoteLatency.GetAverage();
+    }
+}
+
+// NOTE:
+// Must be called with the lock
+// Only the active candidate is measured again, the others are not loaded for measuring them
+// because it reloads the head and uploads the tail to the peer.
+// The last measurements of the others are scaled by the change of the active one,
+// the head by the change of the local load, and the remote stage by the change of the link and the peer.
+void Inference::impl::edge::Reestimate(void)
+{
+    Candidate &active = candidates[current];
+    if (active.headLatency.GetCount() == 0 || active.remoteLatency.GetCount() == 0) {
+        return;
+    }
+
+    double head = active.headLatency.GetAverage();
+    double remote = active.remoteLatency.GetAverage();
+    if (active.measuredHead <= 0.0 || active.measuredRemote <= 0.0) {
+        active.measuredHead = head;
+        active.measuredRemote = remote;
+        return;
+    }
+
+    double headScale = head / active.measuredHead;
+    double remoteScale = remote / active.measuredRemote;
+    active.measuredHead = head;
+    active.measuredRemote = remote;
+
+    int selected = current;
+    double selectedLatency = head + remote;
+    double threshold = selectedLatency * EDGE_SWITCH_THRESHOLD;
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        Candidate &candidate = candidates[i];
+        if (static_cast<int>(i) == current || candidate.failed == true || candidate.measuredHead <= 0.0) {
+            continue;
+        }
+
+        candidate.measuredHead *= headScale;
+        candidate.measuredRemote *= remoteScale;
+
+        double expected = candidate.measuredHead + candidate.measuredRemote;
+        DbgPrint("candidate[%zu] is estimated: %lf sec (active: %lf sec)", i, expected, head + remote);
+        if (expected < threshold && expected < selectedLatency) {
+            selected = static_cast<int>(i);
+            selectedLatency = expected;
+        }
+    }
+
+    if (selected != current) {
+        InfoPrint("Split candidate[%d] is estimated faster than the active one[%d]", selected, current);
+        pendingSwitch = selected;
+    }
+}
+
+// NOTE:
+// Must be called with the lock
+// Every candidate is loaded and measured once after preparing,
+// and then only the active one is measured periodically to estimate the others.
+void Inference::impl::edge::UpdateExploration(void)
+{
+    samples++;
+
+    if (autoSplit == false || candidates.size() < 2 || current < 0) {
+        return;
+    }
+
+    if (exploring == false) {
+        if (samples == EDGE_EXPLORE_INTERVAL - EDGE_EXPLORE_SAMPLES) {
+            // NOTE:
+            // The active candidate is measured with the latest requests of this interval
+            candidates[current].headLatency.Reset();
+            candidates[current].remoteLatency.Reset();
+        } else if (samples >= EDGE_EXPLORE_INTERVAL && pendingSwitch < 0) {
+            samples = 0;
+            Reestimate();
+        }
+        return;
+    }
+
+    if (samples < EDGE_EXPLORE_SAMPLES || pendingSwitch >= 0) {
+        return;
+    }
+
+    for (size_t i = current + 1; i < candidates.size(); i++) {
+        if (candidates[i].failed == false) {
+            pendingSwitch = static_cast<int>(i);
+            return;
+        }
+    }
+
+    // Every candidate is measured
+    exploring = false;
+    samples = 0;
+    RecordMeasurements();
+
+    int selected = SelectCandidate();
+    InfoPrint("Split candidate[%d] is selected", selected);
+    if (selected != current) {
+        pendingSwitch = selected;
+    }
+}
+
+// NOTE:
+// Must be called with the lock
+int Inference::impl::edge::Dispatch(Request *request)
+{
+    request->candidate = current;
+    request->startedAt = Inference::impl::LatencyEstimator::GetTimestamp();
+    requestSet.insert(request);
+
+    int ret = runtime->Invoke(request->input, request->size, static_cast<const void *>(request));
+    if (ret < 0) {
+        ErrPrint("Unable to invoke the runtime: %d", ret);
+        requestSet.erase(request);
+        return ret;
+    }
+
+    inflight++;
+    return 0;
+}
+
+// NOTE:
+// Must be called with the lock
+// Models can be changed only if there is no in-flight request.
+// The models are loaded by a switch thread, the requests are queued until it is done.
+void Inference::impl::edge::SwitchCandidate(void)
+{
+    if (pendingSwitch < 0 || inflight > 0 || switching == true) {
+        return;
+    }
+
+    pthread_attr_t thattr;
+    pthread_t thid;
+    int ret = pthread_attr_init(&thattr);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_attr_init");
+        return;
+    }
+
+    ret = pthread_attr_setdetachstate(&thattr, PTHREAD_CREATE_DETACHED);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_attr_setdetachstate");
+    } else {
+        ret = pthread_create(&thid, &thattr, SwitchMain, static_cast<void *>(this));
+        if (ret != 0) {
+            ErrPrintCode(ret, "pthread_create");
+        }
+    }
+
+    int status = pthread_attr_destroy(&thattr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_attr_destroy");
+    }
+
+    if (ret != 0) {
+        // NOTE:
+        // Keep the current candidate, the queued requests are sent to it
+        ErrPrint("Unable to switch the split candidate");
+        pendingSwitch = -1;
+        exploring = false;
+        DispatchPending();
+        return;
+    }
+
+    switching = true;
+}
+
+void *Inference::impl::edge::SwitchMain(void *arg)
+{
+    Inference::impl::edge *edge = static_cast<Inference::impl::edge *>(arg);
+
+    MUTEX_LOCK(&edge->lock);
+    int previous = edge->current;
+    int idx = edge->pendingSwitch;
+    std::string head = edge->candidates[idx].head;
+    std::string tail = edge->candidates[idx].tail;
+    std::string previousHead;
+    std::string previousTail;
+    if (previous >= 0) {
+        previousHead = edge->candidates[previous].head;
+        previousTail = edge->candidates[previous].tail;
+    }
+    MUTEX_UNLOCK(&edge->lock);
+
+    int ret = edge->Activate(head, tail);
+    int rollback = -EINVAL;
+    if (ret < 0 && previous >= 0) {
+        ErrPrint("Unable to switch the split candidate, roll back to the previous one");
+        rollback = edge->Activate(previousHead, previousTail);
+    }
+
+    MUTEX_LOCK(&edge->lock);
+    edge->pendingSwitch = -1;
+    if (ret == 0) {
+        edge->SetCurrent(idx);
+    } else {
+        edge->candidates[idx].failed = true;
+        edge->exploring = false;
+        if (rollback == 0) {
+            edge->SetCurrent(previous);
+        } else {
+            ErrPrint("Unable to roll back to the previous candidate");
+            if (previous >= 0) {
+                edge->candidates[previous].failed = true;
+            }
+            edge->current = -1;
+        }
+    }
+
+    edge->switching = false;
+    edge->DispatchPending();
+
+    ret = pthread_cond_broadcast(&edge->switchCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_broadcast");
+    }
+    MUTEX_UNLOCK(&edge->lock);
+
+    return nullptr;
+}
+
+// NOTE:
+// Must be called with the lock
+// Send the requests which were queued while switching the candidate
+void Inference::impl::edge::DispatchPending(void)
+{
+    while (pendingQueue.empty() == false) {
+        Request *request = pendingQueue.front();
+        pendingQueue.pop();
+
+        if (current < 0 || Dispatch(request) < 0) {
+            (void)PublishEvent(BEYOND_EVENT_TYPE_INFERENCE_ERROR, const_cast<void *>(request->context));
+            delete request;
+        }
+    }
+}
+
+// NOTE:
+// Must be called without the lock
+void Inference::impl::edge::WaitSwitch(void)
+{
+    MUTEX_LOCK(&lock);
+    while (switching == true) {
+        int ret = pthread_cond_wait(&switchCond, &lock);
+        if (ret != 0) {
+            ErrPrintCode(ret, "pthread_cond_wait");
+            break;
+        }
+    }
+    MUTEX_UNLOCK(&lock);
 }
 
 int Inference::impl::edge::Prepare(void)
 {
-    return -ENOSYS;
+    if (runtime == nullptr || peer == nullptr) {
+        ErrPrint("Edge inference requires a runtime and a peer: runtime(%p), peer(%p)", runtime, peer);
+        return -EINVAL;
+    }
+
+    WaitSwitch();
+
+    MUTEX_LOCK(&lock);
+    std::string splitModel;
+    if (candidates.empty() == true) {
+        splitModel = model;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (splitModel.empty() == false) {
+        // NOTE:
+        // Partitioning reads and writes the model files, it is done without the lock
+        std::vector<Candidate> _candidates;
+        int ret = SplitModel(splitModel, _candidates);
+        if (ret < 0) {
+            return ret;
+        }
+
+        MUTEX_LOCK(&lock);
+        if (candidates.empty() == true && model == splitModel) {
+            candidates.swap(_candidates);
+        }
+        MUTEX_UNLOCK(&lock);
+    }
+
+    MUTEX_LOCK(&lock);
+    if (candidates.empty() == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("There is no split candidate");
+        return -EINVAL;
+    }
+
+    if (inflight > 0 || switching == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("Unable to prepare while the inference is in progress");
+        return -EBUSY;
+    }
+
+    exploring = (autoSplit == true && candidates.size() > 1);
+    std::vector<std::pair<std::string, std::string>> models;
+    std::vector<bool> skip;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        models.push_back(std::make_pair(candidates[i].head, candidates[i].tail));
+        skip.push_back(candidates[i].failed);
+    }
+
+    // NOTE:
+    // The models are loaded without the lock, the switch thread is not started until the first request.
+    switching = true;
+    MUTEX_UNLOCK(&lock);
+
+    int ret = -EINVAL;
+    size_t idx;
+    std::vector<size_t> failed;
+    for (idx = 0; idx < models.size(); idx++) {
+        if (skip[idx] == true) {
+            continue;
+        }
+
+        ret = Activate(models[idx].first, models[idx].second);
+        if (ret == 0) {
+            break;
+        }
+        failed.push_back(idx);
+    }
+
+    MUTEX_LOCK(&lock);
+    for (size_t i = 0; i < failed.size(); i++) {
+        candidates[failed[i]].failed = true;
+    }
+
+    if (ret == 0) {
+        SetCurrent(static_cast<int>(idx));
+    }
+
+    switching = false;
+    DispatchPending();
+
+    int status = pthread_cond_broadcast(&switchCond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_broadcast");
+    }
+    MUTEX_UNLOCK(&lock);
+
+    return ret;
 }
 
 int Inference::impl::edge::Invoke(const beyond_tensor *input, int size, const void *context)
 {
-    return -ENOSYS;
+    if (runtime == nullptr || peer == nullptr) {
+        ErrPrint("Edge inference is not ready to use");
+        return -EINVAL;
+    }
+
+    Request *request;
+
+    try {
+        request = new Request();
+    } catch (std::exception &e) {
+        ErrPrint("new request: %s", e.what());
+        return -ENOMEM;
+    }
+
+    request->context = context;
+    request->input = input;
+    request->size = size;
+    request->candidate = -1;
+    request->startedAt = 0.0;
+    request->headDoneAt = 0.0;
+    request->intermediate = nullptr;
+    request->intermediateSize = 0;
+
+    int ret = 0;
+    MUTEX_LOCK(&lock);
+    SwitchCandidate();
+
+    if (current < 0 && switching == false) {
+        ErrPrint("There is no active split candidate");
+        ret = -EINVAL;
+    } else if (pendingSwitch >= 0 || switching == true) {
+        // The request is going to be sent after switching the candidate
+        pendingQueue.push(request);
+    } else {
+        ret = Dispatch(request);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (ret < 0) {
+        delete request;
+        request = nullptr;
+    }
+
+    return ret;
 }
 
 int Inference::impl::edge::GetOutput(beyond_tensor *&tensor, int &size)
 {
-    return -ENOSYS;
+    MUTEX_LOCK(&lock);
+    if (outputQueue.empty() == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("There is no output");
+        return -EAGAIN;
+    }
+
+    tensor = outputQueue.front().first;
+    size = outputQueue.front().second;
+    outputQueue.pop();
+    outputSet.insert(tensor);
+    MUTEX_UNLOCK(&lock);
+    return 0;
 }
 
 int Inference::impl::edge::Stop(void)
 {
-    return -ENOSYS;
+    if (runtime == nullptr || peer == nullptr) {
+        ErrPrint("Edge inference is not ready to use");
+        return -EINVAL;
+    }
+
+    int ret = runtime->Stop();
+    if (ret < 0) {
+        ErrPrint("Unable to stop the runtime: %d", ret);
+    }
+
+    int status = peer->Stop();
+    if (status < 0) {
+        ErrPrint("Unable to stop the peer: %d", status);
+        ret = status;
+    }
+
+    MUTEX_LOCK(&lock);
+    while (pendingQueue.empty() == false) {
+        Request *request = pendingQueue.front();
+        pendingQueue.pop();
+        (void)PublishEvent(BEYOND_EVENT_TYPE_INFERENCE_CANCELED, const_cast<void *>(request->context));
+        delete request;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    return ret;
 }
 
+// NOTE:
+// The models are given in pairs of the head and the tail, each pair is a split candidate.
+// e.g) { "head_0.tflite", "tail_0.tflite", "head_1.tflite", "tail_1.tflite" }
+// A single model is partitioned by the runtime at the tensor boundaries when it is prepared,
+// the runtime decides the candidates.
+// Without the auto split option, the first candidate is used.
 int Inference::impl::edge::LoadModel(const char **model, int size)
 {
-    return -ENOSYS;
+    if (size <= 0 || model == nullptr || *model == nullptr) {
+        ErrPrint("invalid argument: size(%d), model(%p), model[0](%p)", size, model, model != nullptr ? *model : nullptr);
+        return -EINVAL;
+    }
+
+    if (size > 1 && size % 2 != 0) {
+        ErrPrint("Edge inference requires a single model or pairs of the head and the tail models: %d", size);
+        return -EINVAL;
+    }
+
+    std::string _model;
+    std::vector<Candidate> _candidates;
+    if (size == 1) {
+        _model = std::string(model[0]);
+    } else {
+        _candidates.resize(size / 2);
+    }
+
+    for (int i = 0; i + 1 < size; i += 2) {
+        if (model[i] == nullptr || model[i + 1] == nullptr) {
+            ErrPrint("invalid argument: model[%d](%p), model[%d](%p)", i, model[i], i + 1, model[i + 1]);
+            return -EINVAL;
+        }
+
+        Candidate &candidate = _candidates[i / 2];
+        candidate.head = std::string(model[i]);
+        candidate.tail = std::string(model[i + 1]);
+        candidate.bytes = 0;
+        candidate.measuredHead = 0.0;
+        candidate.measuredRemote = 0.0;
+        candidate.failed = false;
+    }
+
+    MUTEX_LOCK(&lock);
+    if (inflight > 0 || pendingQueue.empty() == false || switching == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("Unable to change the models while the inference is in progress");
+        return -EBUSY;
+    }
+
+    this->model.swap(_model);
+    candidates.swap(_candidates);
+    current = -1;
+    pendingSwitch = -1;
+    exploring = false;
+    samples = 0;
+    MUTEX_UNLOCK(&lock);
+    return 0;
+}
+
+// NOTE:
+// Must be called without the lock
+int Inference::impl::edge::SplitModel(const std::string &model, std::vector<Candidate> &_candidates)
+{
+    std::vector<std::string> models;
+
+    int ret = runtime->SplitModel(model.c_str(), models);
+    if (ret < 0) {
+        ErrPrint("Unable to split the model[%s]: %d", model.c_str(), ret);
+        return ret;
+    }
+
+    if (models.empty() == true || models.size() % 2 != 0) {
+        ErrPrint("Invalid split models: %zu", models.size());
+        return -EINVAL;
+    }
+
+    _candidates.resize(models.size() / 2);
+    for (size_t i = 0; i < models.size(); i += 2) {
+        Candidate &candidate = _candidates[i / 2];
+        candidate.head = models[i];
+        candidate.tail = models[i + 1];
+        candidate.bytes = 0;
+        candidate.measuredHead = 0.0;
+        candidate.measuredRemote = 0.0;
+        candidate.failed = false;
+    }
+
+    DbgPrint("The model[%s] is split into %zu candidates", model.c_str(), _candidates.size());
+    return 0;
+}
+
+// NOTE:
+// The tensor array and the buffers are allocated in a single block, so it is released by free()
+beyond_tensor *Inference::impl::edge::CopyTensor(const beyond_tensor *tensor, int size)
+{
+    size_t header = sizeof(beyond_tensor) * size;
+    size_t total = header;
+    for (int i = 0; i < size; i++) {
+        total += tensor[i].size;
+    }
+
+    beyond_tensor *copy = static_cast<beyond_tensor *>(malloc(total));
+    if (copy == nullptr) {
+        ErrPrintCode(errno, "malloc");
+        return nullptr;
+    }
+
+    uint8_t *data = reinterpret_cast<uint8_t *>(copy) + header;
+    for (int i = 0; i < size; i++) {
+        copy[i] = tensor[i];
+        copy[i].data = data;
+        memcpy(data, tensor[i].data, tensor[i].size);
+        data += tensor[i].size;
+    }
+
+    return copy;
+}
+
+int Inference::impl::edge::PublishEvent(int type, void *data)
+{
+    EventObjectInterface::EventData *eventData;
+
+    try {
+        eventData = new EventObjectInterface::EventData();
+    } catch (std::exception &e) {
+        ErrPrint("new failed: %s", e.what());
+        return -ENOMEM;
+    }
+
+    eventData->type = type;
+    eventData->data = data;
+
+    DbgPrint("Publish event data! (0x%.8X, %p)", eventData->type, eventData->data);
+    int ret = eventObject->PublishEventData(eventData);
+    if (ret < 0) {
+        assert(!"Failed to publish the event data");
+        DbgPrint("Failed to publish the event data");
+        delete eventData;
+        eventData = nullptr;
+    }
+
+    return ret;
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::edge::CompleteRequest(Request *request, int type)
+{
+    free(request->intermediate);
+    request->intermediate = nullptr;
+
+    requestSet.erase(request);
+    inflight--;
+
+    (void)PublishEvent(type, const_cast<void *>(request->context));
+    delete request;
+
+    if ((type & BEYOND_EVENT_TYPE_INFERENCE_MASK) == BEYOND_EVENT_TYPE_INFERENCE_SUCCESS) {
+        UpdateExploration();
+    }
+
+    SwitchCandidate();
+}
+
+beyond_handler_return Inference::impl::edge::RuntimeEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data)
+{
+    if ((type & BEYOND_EVENT_TYPE_ERROR) == BEYOND_EVENT_TYPE_ERROR) {
+        DbgPrint("BeyonD Error Event");
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    Inference::impl::edge *edge = static_cast<Inference::impl::edge *>(data);
+
+    MUTEX_LOCK(&edge->lock);
+    Request *request = static_cast<Request *>(eventInfo->data);
+    if (edge->requestSet.find(request) == edge->requestSet.end()) {
+        MUTEX_UNLOCK(&edge->lock);
+        // NOTE:
+        // Not a request event, deliver it as it is
+        (void)edge->PublishEvent(eventInfo->type, eventInfo->data);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    if ((eventInfo->type & BEYOND_EVENT_TYPE_INFERENCE_MASK) != BEYOND_EVENT_TYPE_INFERENCE_SUCCESS) {
+        edge->CompleteRequest(request, eventInfo->type);
+        MUTEX_UNLOCK(&edge->lock);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    // NOTE:
+    // The head is done, send the intermediate tensors to the peer which runs the tail
+    beyond_tensor *output = nullptr;
+    int outputSize = 0;
+    int ret = edge->runtime->GetOutput(output, outputSize);
+    if (ret < 0) {
+        ErrPrint("Unable to get the intermediate tensor: %d", ret);
+        edge->CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+        MUTEX_UNLOCK(&edge->lock);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    // NOTE:
+    // The intermediate tensors must be kept until the peer completes the request,
+    // because the peer sends them without copying.
+    // The output of the runtime could be a view of its buffers (e.g. runtime_tflite --output-view),
+    // the runtime binds another set of the buffers for every view which is not released yet.
+    // Copy it and give the buffers back to the runtime right away, rather than holding them for the requests in flight.
+    request->intermediate = CopyTensor(output, outputSize);
+    request->intermediateSize = outputSize;
+    edge->runtime->FreeTensor(output, outputSize);
+    if (request->intermediate == nullptr) {
+        edge->CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+        MUTEX_UNLOCK(&edge->lock);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    request->headDoneAt = Inference::impl::LatencyEstimator::GetTimestamp();
+
+    Candidate &candidate = edge->candidates[request->candidate];
+    candidate.headLatency.Update(request->headDoneAt - request->startedAt);
+
+    long long bytes = 0;
+    for (int i = 0; i < request->intermediateSize; i++) {
+        bytes += request->intermediate[i].size;
+    }
+    candidate.bytes = bytes;
+
+    ret = edge->peer->Invoke(request->intermediate, request->intermediateSize, static_cast<const void *>(request));
+    if (ret < 0) {
+        ErrPrint("Unable to invoke the peer: %d", ret);
+        edge->CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+    }
+    MUTEX_UNLOCK(&edge->lock);
+
+    return BEYOND_HANDLER_RETURN_RENEW;
+}
+
+beyond_handler_return Inference::impl::edge::PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data)
+{
+    if ((type & BEYOND_EVENT_TYPE_ERROR) == BEYOND_EVENT_TYPE_ERROR) {
+        DbgPrint("BeyonD Error Event");
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    Inference::impl::edge *edge = static_cast<Inference::impl::edge *>(data);
+
+    MUTEX_LOCK(&edge->lock);
+    Request *request = static_cast<Request *>(eventInfo->data);
+    if (edge->requestSet.find(request) == edge->requestSet.end()) {
+        MUTEX_UNLOCK(&edge->lock);
+        // NOTE:
+        // Not a request event, deliver it as it is
+        (void)edge->PublishEvent(eventInfo->type, eventInfo->data);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    int eventType = eventInfo->type;
+    if ((eventType & BEYOND_EVENT_TYPE_INFERENCE_MASK) == BEYOND_EVENT_TYPE_INFERENCE_SUCCESS) {
+        beyond_tensor *tensor = nullptr;
+        int size = 0;
+
+        int ret = edge->peer->GetOutput(tensor, size);
+        if (ret < 0) {
+            ErrPrint("Unable to get the output: %d", ret);
+            eventType = BEYOND_EVENT_TYPE_INFERENCE_ERROR;
+        } else {
+            double latency = Inference::impl::LatencyEstimator::GetTimestamp() - request->headDoneAt;
+            edge->candidates[request->candidate].remoteLatency.Update(latency);
+            edge->outputQueue.push(std::make_pair(tensor, size));
+        }
+    }
+
+    edge->CompleteRequest(request, eventType);
+    MUTEX_UNLOCK(&edge->lock);
+
+    return BEYOND_HANDLER_RETURN_RENEW;
 }
 
 int Inference::impl::edge::AddRuntime(InferenceInterface::RuntimeInterface *runtime)
 {
-    return -ENOSYS;
+    if (this->runtime != nullptr) {
+        DbgPrint("Not yet support multiple runtimes");
+        return -ENOTSUP;
+    }
+
+    // NOTE:
+    // The intermediate tensors are forwarded to the peer when the runtime notifies the completion,
+    // so the asynchronous mode of the runtime is mandatory.
+    int ret = runtime->AddHandler(
+        Inference::impl::edge::RuntimeEventHandler,
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        static_cast<void *>(this));
+    if (ret < 0) {
+        ErrPrint("Unable to add runtime event handler: %d", ret);
+        return ret;
+    }
+
+    this->runtime = runtime;
+    return 0;
 }
 
 int Inference::impl::edge::RemoveRuntime(InferenceInterface::RuntimeInterface *runtime)
 {
-    return -ENOSYS;
+    if (this->runtime != runtime) {
+        DbgPrint("Runtime is not found");
+        return -ENOENT;
+    }
+
+    int ret = runtime->RemoveHandler(
+        Inference::impl::edge::RuntimeEventHandler,
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        static_cast<void *>(this));
+    if (ret < 0) {
+        ErrPrint("Unable to remove runtime event handler");
+        return ret;
+    }
+
+    this->runtime = nullptr;
+    return 0;
 }
 
-// Add peer modules for invoke remote inference
+// Add peer modules for invoke the tail of the split model
 int Inference::impl::edge::AddPeer(InferenceInterface::PeerInterface *peer)
 {
-    return -ENOSYS;
+    if (this->peer != nullptr) {
+        DbgPrint("Not yet support multiple peers");
+        return -ENOTSUP;
+    }
+
+    int ret = peer->AddHandler(
+        Inference::impl::edge::PeerEventHandler,
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        static_cast<void *>(this));
+    if (ret < 0) {
+        ErrPrint("Failed to add event handler");
+        return ret;
+    }
+
+    ret = peer->Activate();
+    if (ret < 0) {
+        (void)peer->RemoveHandler(
+            Inference::impl::edge::PeerEventHandler,
+            beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+            static_cast<void *>(this));
+        return ret;
+    }
+
+    this->peer = peer;
+    return 0;
 }
 
 int Inference::impl::edge::RemovePeer(InferenceInterface::PeerInterface *peer)
 {
-    return -ENOSYS;
+    if (this->peer != peer) {
+        DbgPrint("Peer is not found");
+        return -ENOENT;
+    }
+
+    peer->Deactivate();
+
+    int ret = peer->RemoveHandler(
+        Inference::impl::edge::PeerEventHandler,
+        beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
+        static_cast<void *>(this));
+
+    this->peer = nullptr;
+    return ret;
 }
 
 int Inference::impl::edge::GetHandle(void) const
 {
-    return -1;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->GetHandle();
 }
 
 int Inference::impl::edge::AddHandler(beyond_event_handler_t handler, int type, void *data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->AddHandler(handler, type, data);
 }
 
 int Inference::impl::edge::RemoveHandler(beyond_event_handler_t handler, int type, void *data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->RemoveHandler(handler, type, data);
 }
 
 int Inference::impl::edge::FetchEventData(EventObjectInterface::EventData *&data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->FetchEventData(data);
 }
 
 int Inference::impl::edge::DestroyEventData(EventObjectInterface::EventData *&data)
 {
-    return -ENOSYS;
+    assert(eventObject != nullptr && "eventObject is nullptr");
+    return eventObject->DestroyEventData(data);
 }
 
 } // namespace beyond
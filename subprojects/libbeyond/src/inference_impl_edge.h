@@ -18,12 +18,20 @@
 #define __BEYOND_INTERNAL_INFERENCE_IMPL_EDGE_H__
 
 #include <functional>
+#include <vector>
+#include <string>
+#include <set>
+#include <queue>
+#include <utility>
+
+#include <pthread.h>
 
 #include <beyond/common.h>
 #include <beyond/private/event_object_private.h>
 #include <beyond/private/inference_private.h>
 
 #include "inference_impl.h"
+#include "inference_impl_latency.h"
 
 namespace beyond {
 
@@ -69,8 +77,74 @@ public: // Implementation interface
     int RemovePeer(InferenceInterface::PeerInterface *peer) override;
 
 private:
-    edge(void) = default;
-    ~edge(void) = default;
+    // NOTE:
+    // A split candidate is a pair of the head model (runs on the local runtime)
+    // and the tail model (runs on the peer) which are partitioned at a tensor boundary.
+    struct Candidate {
+        std::string head;
+        std::string tail;
+        Inference::impl::LatencyEstimator headLatency;   // Local compute time
+        Inference::impl::LatencyEstimator remoteLatency; // Intermediate tensor transfer + remote compute time
+        long long bytes;                                 // Size of the intermediate tensors
+        double measuredHead;                             // Averages of the last measurement, 0.0 if it is not measured yet
+        double measuredRemote;                           // They are scaled to estimate the candidate without loading it
+        bool failed;
+    };
+
+    struct Request {
+        const void *context;
+        const beyond_tensor *input;
+        int size;
+        int candidate;
+        double startedAt;
+        double headDoneAt;
+        beyond_tensor *intermediate; // A copy of the head output, it is a single block
+        int intermediateSize;
+    };
+
+private:
+    edge(void);
+    ~edge(void);
+
+    static beyond_handler_return RuntimeEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data);
+    static beyond_handler_return PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data);
+    static void *SwitchMain(void *arg);
+
+    int PublishEvent(int type, void *data);
+    int Activate(const std::string &head, const std::string &tail);
+    void SetCurrent(int idx);
+    void WaitSwitch(void);
+    static beyond_tensor *CopyTensor(const beyond_tensor *tensor, int size);
+    int SelectCandidate(void) const;
+    void RecordMeasurements(void);
+    void Reestimate(void);
+    void UpdateExploration(void);
+    int SplitModel(const std::string &model, std::vector<Candidate> &_candidates);
+    int Dispatch(Request *request);
+    void SwitchCandidate(void);
+    void DispatchPending(void);
+    void CompleteRequest(Request *request, int type);
+
+    Inference::impl::EventObject *eventObject;
+    InferenceInterface::RuntimeInterface *runtime;
+    InferenceInterface::PeerInterface *peer;
+    bool autoSplit;
+
+    std::string model; // A single model which is partitioned by the runtime when it is prepared
+    std::vector<Candidate> candidates;
+    int current;       // Active candidate
+    int pendingSwitch; // Candidate to be activated when the in-flight requests are drained
+    bool switching;    // A switch thread is loading the models of the pending candidate
+    bool exploring;
+    int samples;       // Completed requests of the active candidate in this phase
+
+    int inflight;
+    std::set<Request *> requestSet;
+    std::queue<Request *> pendingQueue; // Requests waiting for switching the candidate
+    std::queue<std::pair<beyond_tensor *, int>> outputQueue;
+    std::set<beyond_tensor *> outputSet;
+    pthread_cond_t switchCond; // Signaled when the switch thread is finished
+    pthread_mutex_t lock;
 };
 
 } // namespace beyond
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cerrno>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include <pthread.h>
+
+#include "beyond/platform/beyond_platform.h"
+#include "beyond/private/log_private.h"
+#include "beyond/common.h"
+
+#include "inference_impl.h"
+#include "inference_impl_fanout.h"
+
+namespace beyond {
+
+void *Inference::impl::Fanout::ThreadMain(void *arg)
+{
+    Job *job = static_cast<Job *>(arg);
+    job->result = (*job->function)();
+    return nullptr;
+}
+
+void Inference::impl::Fanout::Run(const std::vector<std::function<int(void)>> &jobs, std::vector<int> &results)
+{
+    results.assign(jobs.size(), -EINVAL);
+
+    if (jobs.empty() == true) {
+        return;
+    }
+
+    if (jobs.size() == 1) {
+        results[0] = jobs[0]();
+        return;
+    }
+
+    std::vector<Job> batch(std::min(jobs.size(), static_cast<size_t>(MAX_CONCURRENCY)));
+
+    for (size_t base = 0; base < jobs.size(); base += batch.size()) {
+        size_t count = std::min(batch.size(), jobs.size() - base);
+
+        for (size_t i = 0; i < count; i++) {
+            Job &job = batch[i];
+
+            job.function = &jobs[base + i];
+            job.result = -EINVAL;
+            job.started = false;
+
+            int status = pthread_create(&job.threadId, nullptr, ThreadMain, static_cast<void *>(&job));
+            if (status != 0) {
+                ErrPrintCode(status, "pthread_create");
+                job.result = (*job.function)();
+                continue;
+            }
+
+            job.started = true;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            Job &job = batch[i];
+
+            if (job.started == true) {
+                int status = pthread_join(job.threadId, nullptr);
+                if (status != 0) {
+                    ErrPrintCode(status, "pthread_join");
+                }
+            }
+
+            results[base + i] = job.result;
+        }
+    }
+}
+
+} // namespace beyond
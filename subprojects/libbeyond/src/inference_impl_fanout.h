@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_INTERNAL_INFERENCE_IMPL_FANOUT_H__
+#define __BEYOND_INTERNAL_INFERENCE_IMPL_FANOUT_H__
+
+#include <functional>
+#include <vector>
+
+#include <pthread.h>
+
+#include "inference_impl.h"
+
+namespace beyond {
+
+// NOTE:
+// Runs the blocking peer operations (activation, model upload, preparation) of many peers at once,
+// so bringing up N peers takes as long as the slowest one instead of the sum of them.
+// Every job must touch its own peer only.
+class Inference::impl::Fanout final {
+public:
+    static constexpr int MAX_CONCURRENCY = 16;
+
+public:
+    // NOTE:
+    // results[i] is the return value of the jobs[i].
+    // If a thread cannot be created, the job is run on the caller thread.
+    static void Run(const std::vector<std::function<int(void)>> &jobs, std::vector<int> &results);
+
+private:
+    struct Job {
+        const std::function<int(void)> *function;
+        int result;
+        pthread_t threadId;
+        bool started;
+    };
+
+private:
+    static void *ThreadMain(void *arg);
+};
+
+} // namespace beyond
+
+#endif // __BEYOND_INTERNAL_INFERENCE_IMPL_FANOUT_H__
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cerrno>
+#include <ctime>
+
+#include <algorithm>
+
+#include "beyond/platform/beyond_platform.h"
+#include "beyond/private/log_private.h"
+#include "beyond/common.h"
+
+#include "inference_impl.h"
+#include "inference_impl_latency.h"
+
+// Weight of the latest sample for the moving average
+#define LATENCY_SMOOTHING_FACTOR 0.2
+// A failed request is regarded as slow as twice of the current average
+#define LATENCY_PENALTY_FACTOR 2.0
+// A failed request of the peer which has no average yet is regarded as slow as this (seconds)
+#define LATENCY_PENALTY_FLOOR 1.0
+
+namespace beyond {
+
+Inference::impl::LatencyEstimator::LatencyEstimator(void)
+    : samples{}
+    , head(0)
+    , count(0)
+    , average(0.0)
+{
+}
+
+void Inference::impl::LatencyEstimator::Update(double latency)
+{
+    if (latency < 0.0) {
+        return;
+    }
+
+    samples[head] = latency;
+    head = (head + 1) % WINDOW_SIZE;
+    if (count < WINDOW_SIZE) {
+        count++;
+    }
+
+    if (count == 1) {
+        average = latency;
+    } else {
+        average = average + LATENCY_SMOOTHING_FACTOR * (latency - average);
+    }
+}
+
+void Inference::impl::LatencyEstimator::Penalize(void)
+{
+    // NOTE:
+    // Only the moving average is penalized.
+    // The samples are kept as they are for the percentile which is used for the hedging delay.
+    // The average of the peer which has never succeeded is 0.0, it is seeded by the floor,
+    // otherwise the peer would be ranked first forever.
+    if (average <= 0.0) {
+        average = LATENCY_PENALTY_FLOOR;
+        return;
+    }
+
+    average *= LATENCY_PENALTY_FACTOR;
+}
+
+void Inference::impl::LatencyEstimator::Reset(void)
+{
+    head = 0;
+    count = 0;
+    average = 0.0;
+}
+
+int Inference::impl::LatencyEstimator::GetCount(void) const
+{
+    return count;
+}
+
+double Inference::impl::LatencyEstimator::GetAverage(void) const
+{
+    return average;
+}
+
+double Inference::impl::LatencyEstimator::GetPercentile(int percentile) const
+{
+    if (count == 0) {
+        return 0.0;
+    }
+
+    if (percentile < 0) {
+        percentile = 0;
+    } else if (percentile > 100) {
+        percentile = 100;
+    }
+
+    double sorted[WINDOW_SIZE];
+    std::copy(samples, samples + count, sorted);
+
+    int idx = (count - 1) * percentile / 100;
+    std::nth_element(sorted, sorted + idx, sorted + count);
+    return sorted[idx];
+}
+
+double Inference::impl::LatencyEstimator::GetTimestamp(void)
+{
+    timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        ErrPrintCode(errno, "clock_gettime");
+        return 0.0;
+    }
+
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1000000000.0;
+}
+
+} // namespace beyond
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BEYOND_INTERNAL_INFERENCE_IMPL_LATENCY_H__
+#define __BEYOND_INTERNAL_INFERENCE_IMPL_LATENCY_H__
+
+#include "inference_impl.h"
+
+namespace beyond {
+
+// NOTE:
+// Keeps a small window of round-trip times (in seconds) measured by the co-inference modes.
+// The moving average is used for ranking peers and the percentile is used for the hedging delay.
+class Inference::impl::LatencyEstimator final {
+public:
+    static constexpr int WINDOW_SIZE = 64;
+
+public:
+    LatencyEstimator(void);
+    ~LatencyEstimator(void) = default;
+
+    void Update(double latency);
+    void Penalize(void);
+    void Reset(void);
+
+    int GetCount(void) const;
+    double GetAverage(void) const;
+    double GetPercentile(int percentile) const;
+
+    static double GetTimestamp(void);
+
+private:
+    double samples[WINDOW_SIZE];
+    int head;
+    int count;
+    double average;
+};
+
+} // namespace beyond
+
+#endif // __BEYOND_INTERNAL_INFERENCE_IMPL_LATENCY_H__
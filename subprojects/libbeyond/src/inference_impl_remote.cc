@@ -20,6 +20,9 @@
 #include <cassert>
 
 #include <exception>
+#include <algorithm>
+
+#include <pthread.h>
 
 #include "beyond/platform/beyond_platform.h"
 #include "beyond/private/log_private.h"
@@ -32,12 +35,52 @@
 #include "inference_impl.h"
 #include "inference_impl_remote.h"
 #include "inference_impl_event_object.h"
+#include "inference_impl_latency.h"
+#include "inference_impl_fanout.h"
+
+// Minimum number of samples for regarding the moving average as a stable one
+#define LATENCY_MIN_SAMPLES 8
+// A peer is regarded as degraded when its latency gets worse than this factor of its best
+#define LATENCY_DEGRADE_FACTOR 1.5
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
 
 namespace beyond {
 
-Inference::impl::remote *Inference::impl::remote::Create(bool autoSplit)
+Inference::impl::remote *Inference::impl::remote::Create(bool autoSplit, const char *balance, int maxInflight, bool ordered)
 {
     Inference::impl::remote *impl;
+    Balance policy;
+
+    if (balance == nullptr || strcmp(balance, BEYOND_INFERENCE_BALANCE_LATENCY) == 0) {
+        policy = Balance::Latency;
+    } else if (strcmp(balance, BEYOND_INFERENCE_BALANCE_ROUND_ROBIN) == 0) {
+        policy = Balance::RoundRobin;
+    } else if (strcmp(balance, BEYOND_INFERENCE_BALANCE_LEAST_OUTSTANDING) == 0) {
+        policy = Balance::LeastOutstanding;
+    } else {
+        ErrPrint("Unknown balancing policy: <%s>", balance);
+        return nullptr;
+    }
+
+    if (maxInflight < 0) {
+        ErrPrint("Invalid max inflight: %d", maxInflight);
+        return nullptr;
+    }
 
     try {
         impl = new Inference::impl::remote();
@@ -61,11 +104,50 @@ Inference::impl::remote *Inference::impl::remote::Create(bool autoSplit)
     }
 
     impl->autoSplit = autoSplit;
+    impl->balance = policy;
+    impl->maxInflight = maxInflight;
+    impl->ordered = ordered;
     return impl;
 }
 
 void Inference::impl::remote::Destroy(void)
 {
+    // NOTE:
+    // The migration thread touches the peers and the pending requests when it finishes
+    WaitMigration();
+
+    std::set<Request *>::iterator rit;
+    for (rit = requestSet.begin(); rit != requestSet.end(); ++rit) {
+        delete *rit;
+    }
+    requestSet.clear();
+
+    std::deque<Request *>::iterator pit;
+    for (pit = pendingQueue.begin(); pit != pendingQueue.end(); ++pit) {
+        delete *pit;
+    }
+    pendingQueue.clear();
+
+    std::map<unsigned long long, Request *>::iterator cit;
+    for (cit = completedMap.begin(); cit != completedMap.end(); ++cit) {
+        Request *request = cit->second;
+        if (request->hasOutput == true) {
+            request->output.peer->FreeTensor(request->output.tensor, request->output.size);
+        }
+        delete request;
+    }
+    completedMap.clear();
+
+    while (peerVector.empty() == false) {
+        (void)RemovePeer(peerVector.back()->peer);
+    }
+
+    while (outputQueue.empty() == false) {
+        Output &output = outputQueue.front();
+        output.peer->FreeTensor(output.tensor, output.size);
+        outputQueue.pop();
+    }
+
     if (eventObject != nullptr) {
         eventObject->Destroy();
         eventObject = nullptr;
@@ -78,9 +160,32 @@ Inference::impl::remote::remote(void)
     : eventObject(nullptr)
     , peer(nullptr)
     , autoSplit(false)
+    , balance(Balance::Latency)
+    , maxInflight(0)
+    , ordered(false)
+    , nextPeer(0)
+    , nextSequence(0)
+    , deliverSequence(0)
+    , migrating(false)
+    , preparing(false)
+    , migrateCond(PTHREAD_COND_INITIALIZER)
+    , lock(PTHREAD_MUTEX_INITIALIZER)
 {
 }
 
+Inference::impl::remote::~remote(void)
+{
+    int ret = pthread_cond_destroy(&migrateCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_destroy");
+    }
+
+    ret = pthread_mutex_destroy(&lock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
+}
+
 int Inference::impl::remote::Configure(const beyond_config *options)
 {
     // TODO:
@@ -101,29 +206,51 @@ int Inference::impl::remote::LoadModel(const char *model)
 
 int Inference::impl::remote::GetInputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
-    if (peer == nullptr) {
+    MUTEX_LOCK(&lock);
+    InferenceInterface::PeerInterface *selected = peer;
+    MUTEX_UNLOCK(&lock);
+
+    if (selected == nullptr) {
         ErrPrint("Peer is not ready to use");
         return -EINVAL;
     }
-    return peer->GetInputTensorInfo(info, size);
+    return selected->GetInputTensorInfo(info, size);
 }
 
 int Inference::impl::remote::GetOutputTensorInfo(const beyond_tensor_info *&info, int &size)
 {
-    if (peer == nullptr) {
+    MUTEX_LOCK(&lock);
+    InferenceInterface::PeerInterface *selected = peer;
+    MUTEX_UNLOCK(&lock);
+
+    if (selected == nullptr) {
         ErrPrint("Peer is not ready to use");
         return -EINVAL;
     }
-    return peer->GetOutputTensorInfo(info, size);
+    return selected->GetOutputTensorInfo(info, size);
 }
 
+// NOTE:
+// The tensor information is applied to the prepared peers only.
+// A peer which is prepared later by the migration is going to use the information from its model.
 int Inference::impl::remote::SetInputTensorInfo(const beyond_tensor_info *info, int size)
 {
+    int ret = 0;
+    MUTEX_LOCK(&lock);
     if (peer == nullptr) {
+        MUTEX_UNLOCK(&lock);
         ErrPrint("Peer is not ready to use");
         return -EINVAL;
     }
-    return peer->SetInputTensorInfo(info, size);
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end() && ret == 0; ++it) {
+        if ((*it)->prepared == true) {
+            ret = (*it)->peer->SetInputTensorInfo(info, size);
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+    return ret;
 }
 
 // TODO:
@@ -131,29 +258,471 @@ int Inference::impl::remote::SetInputTensorInfo(const beyond_tensor_info *info,
 // This is not what we want.
 int Inference::impl::remote::SetOutputTensorInfo(const beyond_tensor_info *info, int size)
 {
+    int ret = 0;
+    MUTEX_LOCK(&lock);
     if (peer == nullptr) {
+        MUTEX_UNLOCK(&lock);
         ErrPrint("Peer is not ready to use");
         return -EINVAL;
     }
-    return peer->SetOutputTensorInfo(info, size);
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end() && ret == 0; ++it) {
+        if ((*it)->prepared == true) {
+            ret = (*it)->peer->SetOutputTensorInfo(info, size);
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+    return ret;
 }
 
 int Inference::impl::remote::AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor)
 {
-    if (peer == nullptr) {
+    MUTEX_LOCK(&lock);
+    InferenceInterface::PeerInterface *selected = peer;
+    MUTEX_UNLOCK(&lock);
+
+    if (selected == nullptr) {
         ErrPrint("Peer is not ready to use");
         return -EINVAL;
     }
-    return peer->AllocateTensor(info, size, tensor);
+    return selected->AllocateTensor(info, size, tensor);
 }
 
 void Inference::impl::remote::FreeTensor(beyond_tensor *&tensor, int size)
 {
-    if (peer == nullptr) {
+    MUTEX_LOCK(&lock);
+    InferenceInterface::PeerInterface *owner = peer;
+    // NOTE:
+    // Output tensors must be released by the peer who allocated them.
+    std::map<beyond_tensor *, InferenceInterface::PeerInterface *>::iterator it = outputOwner.find(tensor);
+    if (it != outputOwner.end()) {
+        owner = it->second;
+        outputOwner.erase(it);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    if (owner == nullptr) {
         ErrPrint("Peer is not ready to use");
         return;
     }
-    return peer->FreeTensor(tensor, size);
+    return owner->FreeTensor(tensor, size);
+}
+
+// NOTE:
+// The peers are activated when they are probed or prepared instead of when they are added,
+// so the Fanout brings them up concurrently.
+// The lock is not required, only the preparing (or the migrating) thread activates the peer,
+// and RemovePeer() waits for it.
+int Inference::impl::remote::ActivatePeer(PeerContext *peerCtx)
+{
+    if (peerCtx->activated == true) {
+        return 0;
+    }
+
+    int ret = peerCtx->peer->Activate();
+    if (ret < 0) {
+        ErrPrint("Unable to activate the peer: %d", ret);
+        return ret;
+    }
+
+    peerCtx->activated = true;
+    return 0;
+}
+
+// NOTE:
+// The lock is not required, the peer context is not touched.
+// The caller applies the result to the peer context with the lock, see UpdateProbe().
+int Inference::impl::remote::ProbePeer(PeerContext *peerCtx, double &latency)
+{
+    const beyond_peer_info *info = nullptr;
+    double startedAt = Inference::impl::LatencyEstimator::GetTimestamp();
+
+    int ret = peerCtx->peer->GetInfo(info);
+    if (ret < 0 || info == nullptr) {
+        return ret < 0 ? ret : -EFAULT;
+    }
+
+    latency = Inference::impl::LatencyEstimator::GetTimestamp() - startedAt;
+
+    InfoPrint("name: %s, free memory: %llu, free storage: %llu, probe: %lf sec", info->name, info->free_memory, info->free_storage, latency);
+    return 0;
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::remote::UpdateProbe(PeerContext *peerCtx, int status, double latency)
+{
+    if (status < 0) {
+        peerCtx->probe.Penalize();
+        return;
+    }
+
+    peerCtx->probe.Update(latency);
+}
+
+// NOTE:
+// The lock is not required, it can take long time for uploading the model.
+// The caller marks the peer as prepared with the lock.
+int Inference::impl::remote::PreparePeer(PeerContext *peerCtx, const std::string &model)
+{
+    int ret = ActivatePeer(peerCtx);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (model.empty() == false) {
+        ret = peerCtx->peer->LoadModel(model.c_str());
+        if (ret < 0) {
+            ErrPrint("Unable to load the model[%s]", model.c_str());
+            return ret;
+        }
+    }
+
+    ret = peerCtx->peer->Prepare();
+    if (ret < 0) {
+        ErrPrint("Unable to prepare the peer: %d", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+// NOTE:
+// The expected completion time of a new request.
+// Until a peer has a measured inference latency, its probe latency is used instead,
+// and the load which is given by the discovery is used if the peer is not probed either.
+double Inference::impl::remote::GetExpectedCompletion(const PeerContext *peerCtx) const
+{
+    double estimate;
+    if (peerCtx->latency.GetCount() > 0) {
+        estimate = peerCtx->latency.GetAverage();
+    } else if (peerCtx->probe.GetCount() > 0) {
+        estimate = peerCtx->probe.GetAverage();
+    } else {
+        estimate = peerCtx->advertised;
+    }
+    return estimate * (peerCtx->inflight + 1);
+}
+
+// NOTE:
+// The median latency of the peer (usec) with its queue, the requests in the queue are served before a new one
+double Inference::impl::remote::GetAdvertisedCompletion(const beyond_peer_info *info)
+{
+    if (info->latency == 0) {
+        return 0.0;
+    }
+
+    int queueDepth = info->queue_depth > 0 ? info->queue_depth : 0;
+    return static_cast<double>(info->latency) / 1000000.0 * (queueDepth + 1);
+}
+
+// NOTE:
+// Must be called with the lock
+// Returns nullptr if every prepared peer has reached the in-flight limit.
+Inference::impl::remote::PeerContext *Inference::impl::remote::SelectPeer(void)
+{
+    PeerContext *selected = nullptr;
+    double selectedCompletion = 0.0;
+    size_t selectedIdx = 0;
+    size_t count = peerVector.size();
+
+    // NOTE:
+    // The peers are visited from the next one of the last selected,
+    // so the round-robin goes on and the ties are also spread over the peers.
+    for (size_t i = 0; i < count; i++) {
+        size_t idx = (nextPeer + i) % count;
+        PeerContext *peerCtx = peerVector[idx];
+
+        if (peerCtx->prepared == false) {
+            continue;
+        }
+
+        if (maxInflight > 0 && peerCtx->inflight >= maxInflight) {
+            continue;
+        }
+
+        if (balance == Balance::RoundRobin) {
+            selected = peerCtx;
+            selectedIdx = idx;
+            break;
+        }
+
+        double completion;
+        if (balance == Balance::LeastOutstanding) {
+            completion = static_cast<double>(peerCtx->inflight);
+        } else {
+            completion = GetExpectedCompletion(peerCtx);
+        }
+
+        if (selected == nullptr || completion < selectedCompletion) {
+            selected = peerCtx;
+            selectedCompletion = completion;
+            selectedIdx = idx;
+        }
+    }
+
+    if (selected != nullptr) {
+        nextPeer = selectedIdx + 1;
+    }
+
+    return selected;
+}
+
+// NOTE:
+// Must be called with the lock
+int Inference::impl::remote::Dispatch(Request *request, PeerContext *peerCtx)
+{
+    request->peerCtx = peerCtx;
+    request->startedAt = Inference::impl::LatencyEstimator::GetTimestamp();
+    requestSet.insert(request);
+
+    int ret = peerCtx->peer->Invoke(request->input, request->size, static_cast<const void *>(request));
+    if (ret < 0) {
+        ErrPrint("Failed to invoke the peer: %d", ret);
+        requestSet.erase(request);
+        UpdateLatency(peerCtx, 0.0, false);
+        return ret;
+    }
+
+    peerCtx->inflight++;
+    return 0;
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::remote::DispatchPending(void)
+{
+    while (pendingQueue.empty() == false) {
+        PeerContext *peerCtx = SelectPeer();
+        if (peerCtx == nullptr) {
+            break;
+        }
+
+        Request *request = pendingQueue.front();
+        pendingQueue.pop_front();
+
+        if (Dispatch(request, peerCtx) < 0) {
+            CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+        }
+    }
+}
+
+// NOTE:
+// Must be called with the lock
+// The ownership of the request is moved to here.
+void Inference::impl::remote::CompleteRequest(Request *request, int eventType)
+{
+    request->eventType = eventType;
+
+    if (ordered == false) {
+        if (request->hasOutput == true) {
+            outputQueue.push(request->output);
+        }
+
+        (void)PublishEvent(request->eventType, const_cast<void *>(request->context));
+        delete request;
+        return;
+    }
+
+    completedMap[request->sequence] = request;
+    FlushCompleted();
+}
+
+// NOTE:
+// Must be called with the lock
+// Deliver the completed requests until the one which is not completed yet.
+void Inference::impl::remote::FlushCompleted(void)
+{
+    std::map<unsigned long long, Request *>::iterator it = completedMap.begin();
+    while (it != completedMap.end() && it->first == deliverSequence) {
+        Request *request = it->second;
+
+        if (request->hasOutput == true) {
+            outputQueue.push(request->output);
+        }
+
+        (void)PublishEvent(request->eventType, const_cast<void *>(request->context));
+        delete request;
+
+        it = completedMap.erase(it);
+        deliverSequence++;
+    }
+}
+
+// NOTE:
+// Must be called with the lock
+void Inference::impl::remote::UpdateLatency(PeerContext *peerCtx, double latency, bool success)
+{
+    if (success == true) {
+        peerCtx->latency.Update(latency);
+    } else {
+        peerCtx->latency.Penalize();
+    }
+
+    if (peerCtx->latency.GetCount() < LATENCY_MIN_SAMPLES) {
+        return;
+    }
+
+    double average = peerCtx->latency.GetAverage();
+    if (peerCtx->baseline == 0.0 || average < peerCtx->baseline) {
+        peerCtx->baseline = average;
+        return;
+    }
+
+    if (average > peerCtx->baseline * LATENCY_DEGRADE_FACTOR) {
+        InfoPrint("Peer is degraded: %lf sec (baseline: %lf sec)", average, peerCtx->baseline);
+        Migrate(peerCtx);
+    }
+}
+
+// NOTE:
+// Must be called with the lock
+// The requests are routed to the peer which has the best expected completion time among the prepared peers.
+// If a peer gets degraded, the best one of the remained peers is prepared as well,
+// so the following requests can be moved to it.
+// Probing and preparing (including the model uploading) are done by a migration thread,
+// the event handler only starts it and the new peer takes the requests when it is prepared.
+void Inference::impl::remote::Migrate(PeerContext *degraded)
+{
+    // The current latency becomes the new baseline, to prevent the migration from being triggered repeatedly
+    degraded->baseline = degraded->latency.GetAverage();
+
+    if (migrating == true || preparing == true) {
+        DbgPrint("Migration or preparation is in progress");
+        return;
+    }
+
+    migrateVector.clear();
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+        if ((*it)->prepared == false) {
+            migrateVector.push_back(*it);
+        }
+    }
+
+    if (migrateVector.empty() == true) {
+        DbgPrint("There is no more peer to migrate");
+        return;
+    }
+
+    migrateModel = modelFile;
+
+    pthread_attr_t thattr;
+    pthread_t thid;
+    int ret = pthread_attr_init(&thattr);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_attr_init");
+        migrateVector.clear();
+        return;
+    }
+
+    ret = pthread_attr_setdetachstate(&thattr, PTHREAD_CREATE_DETACHED);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_attr_setdetachstate");
+    } else {
+        ret = pthread_create(&thid, &thattr, MigrateMain, static_cast<void *>(this));
+        if (ret != 0) {
+            ErrPrintCode(ret, "pthread_create");
+        }
+    }
+
+    int status = pthread_attr_destroy(&thattr);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_attr_destroy");
+    }
+
+    if (ret != 0) {
+        migrateVector.clear();
+        return;
+    }
+
+    migrating = true;
+}
+
+// NOTE:
+// The candidates are not prepared, so they are not touched by the others than this thread.
+// RemovePeer() and Destroy() wait for this thread before releasing them.
+void *Inference::impl::remote::MigrateMain(void *arg)
+{
+    Inference::impl::remote *remote = static_cast<Inference::impl::remote *>(arg);
+    PeerContext *candidate = nullptr;
+
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<int> status;
+    std::vector<double> latency(remote->migrateVector.size(), 0.0);
+    for (size_t i = 0; i < remote->migrateVector.size(); i++) {
+        PeerContext *peerCtx = remote->migrateVector[i];
+        double *slot = &latency[i];
+
+        jobs.push_back([peerCtx, slot](void) -> int {
+            int ret = ActivatePeer(peerCtx);
+            if (ret < 0) {
+                return ret;
+            }
+
+            return ProbePeer(peerCtx, *slot);
+        });
+    }
+    Inference::impl::Fanout::Run(jobs, status);
+
+    MUTEX_LOCK(&remote->lock);
+    for (size_t i = 0; i < remote->migrateVector.size(); i++) {
+        PeerContext *peerCtx = remote->migrateVector[i];
+
+        remote->UpdateProbe(peerCtx, status[i], latency[i]);
+        if (peerCtx->probe.GetCount() == 0) {
+            continue;
+        }
+
+        if (candidate == nullptr || peerCtx->probe.GetAverage() < candidate->probe.GetAverage()) {
+            candidate = peerCtx;
+        }
+    }
+    MUTEX_UNLOCK(&remote->lock);
+
+    int ret = -ENOENT;
+    if (candidate == nullptr) {
+        DbgPrint("There is no more peer to migrate");
+    } else {
+        ret = remote->PreparePeer(candidate, remote->migrateModel);
+        if (ret < 0) {
+            ErrPrint("Unable to migrate to the new peer");
+        }
+    }
+
+    MUTEX_LOCK(&remote->lock);
+    if (ret == 0) {
+        DbgPrint("New peer is prepared for the migration");
+        candidate->prepared = true;
+        // The new peer has free slots, send the pending requests
+        remote->DispatchPending();
+    }
+
+    remote->migrateVector.clear();
+    remote->migrating = false;
+    ret = pthread_cond_broadcast(&remote->migrateCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_broadcast");
+    }
+    MUTEX_UNLOCK(&remote->lock);
+
+    return nullptr;
+}
+
+// NOTE:
+// Must be called without the lock
+void Inference::impl::remote::WaitMigration(void)
+{
+    MUTEX_LOCK(&lock);
+    while (migrating == true || preparing == true) {
+        int ret = pthread_cond_wait(&migrateCond, &lock);
+        if (ret != 0) {
+            ErrPrintCode(ret, "pthread_cond_wait");
+            break;
+        }
+    }
+    MUTEX_UNLOCK(&lock);
 }
 
 // TODO:
@@ -162,99 +731,257 @@ void Inference::impl::remote::FreeTensor(beyond_tensor *&tensor, int size)
 // And the invocation chain must be managed by BeyonD properly.
 int Inference::impl::remote::Prepare(void)
 {
+    MUTEX_LOCK(&lock);
+    while (migrating == true || preparing == true) {
+        int status = pthread_cond_wait(&migrateCond, &lock);
+        if (status != 0) {
+            ErrPrintCode(status, "pthread_cond_wait");
+            break;
+        }
+    }
+
     if (peerVector.empty() == true) {
+        MUTEX_UNLOCK(&lock);
         ErrPrint("There is not usable peer found");
         return -EINVAL;
     }
 
     if (peer != nullptr) {
+        InferenceInterface::PeerInterface *selected = peer;
+        MUTEX_UNLOCK(&lock);
         DbgPrint("There is a peer already selected");
-        return peer->Prepare();
+        return selected->Prepare();
     }
 
-    struct Selected {
-        unsigned long long freeStorage;
-        unsigned long long freeMemory;
-        InferenceInterface::PeerInterface *peer;
-    } selected = {
-        .freeStorage = 0,
-        .freeMemory = 0,
-        .peer = nullptr,
-    };
-
     // NOTE:
-    // This implementation is based on the current peer information.
-    // Until we decide what factors could be used,
-    // the comparison conditions could be added or replaced.
-    std::vector<InferenceInterface::PeerInterface *>::iterator it;
-    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
-        InferenceInterface::PeerInterface *_peer = *it;
-        const beyond_peer_info *info = nullptr;
-
-        if (_peer->GetInfo(info) < 0 || info == nullptr) {
-            continue;
+    // The free memory does not tell how fast a peer can infer.
+    // If every peer has published its load via the discovery, the peers are ranked by it without asking them.
+    // Otherwise, until we measure the real inference latency, the round trip time of the peer information request is used.
+    // Every peer is probed and prepared concurrently without the lock, the responses of the other requests are not blocked.
+    // The peers are copied with the lock and the results are published with the lock,
+    // RemovePeer() and Migrate() wait until the preparation is finished.
+    std::vector<PeerContext *> peers = peerVector;
+    std::string model = modelFile;
+    preparing = true;
+
+    bool advertised = true;
+    std::vector<PeerContext *>::iterator it;
+    for (it = peers.begin(); it != peers.end(); ++it) {
+        if ((*it)->advertised <= 0.0) {
+            advertised = false;
+            break;
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<int> results;
+    std::vector<double> latency(peers.size(), 0.0);
+    if (advertised == false) {
+        for (size_t i = 0; i < peers.size(); i++) {
+            PeerContext *peerCtx = peers[i];
+            double *slot = &latency[i];
+
+            jobs.push_back([peerCtx, slot](void) -> int {
+                int ret = ActivatePeer(peerCtx);
+                if (ret < 0) {
+                    return ret;
+                }
+
+                return ProbePeer(peerCtx, *slot);
+            });
         }
+        Inference::impl::Fanout::Run(jobs, results);
+    }
 
-        InfoPrint("name: %s, free memory: %llu, free storage: %llu", info->name, info->free_memory, info->free_storage);
+    MUTEX_LOCK(&lock);
+    PeerContext *selected = nullptr;
+    double selectedCompletion = 0.0;
+    for (size_t i = 0; i < peers.size(); i++) {
+        PeerContext *peerCtx = peers[i];
+        double completion;
+
+        if (advertised == true) {
+            completion = peerCtx->advertised;
+        } else {
+            UpdateProbe(peerCtx, results[i], latency[i]);
+            if (peerCtx->probe.GetCount() == 0) {
+                continue;
+            }
+
+            completion = peerCtx->probe.GetAverage();
+        }
 
-        // We know memory and storage information
-        if (info->free_memory > selected.freeMemory) {
-            InfoPrint("%s is selected", info->name);
-            selected.peer = _peer;
-            selected.freeStorage = info->free_storage;
-            selected.freeMemory = info->free_memory;
-        } else if ((info->free_memory == selected.freeMemory) && (info->free_storage > selected.freeStorage)) {
-            InfoPrint("%s is selected", info->name);
-            selected.peer = _peer;
-            selected.freeStorage = info->free_storage;
-            selected.freeMemory = info->free_memory;
+        if (selected == nullptr || completion < selectedCompletion) {
+            selected = peerCtx;
+            selectedCompletion = completion;
         }
     }
 
-    if (selected.peer == nullptr) {
+    if (selected == nullptr) {
         ErrPrint("Unable to find the best peer, just select the first peer");
-        selected.peer = peerVector[0];
+        selected = peers[0];
     }
 
-    if (modelFile.empty() == false) {
-        int ret = selected.peer->LoadModel(modelFile.c_str());
-        if (ret < 0) {
-            ErrPrint("Unable to load the model[%s]", modelFile.c_str());
-            return ret;
+    // NOTE:
+    // For balancing the requests, every peer is prepared with the same model.
+    // The peers which are failed to prepare are excluded from the balancing.
+    std::vector<PeerContext *> pending;
+    for (it = peers.begin(); it != peers.end(); ++it) {
+        if ((*it)->prepared == true) {
+            continue;
+        }
+
+        if (balance == Balance::Latency && *it != selected) {
+            continue;
+        }
+
+        pending.push_back(*it);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    jobs.clear();
+    for (it = pending.begin(); it != pending.end(); ++it) {
+        PeerContext *peerCtx = *it;
+
+        jobs.push_back([this, peerCtx, model](void) -> int {
+            return PreparePeer(peerCtx, model);
+        });
+    }
+    Inference::impl::Fanout::Run(jobs, results);
+
+    MUTEX_LOCK(&lock);
+    int ret = selected->prepared == true ? 0 : -EINVAL;
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (results[i] == 0) {
+            pending[i]->prepared = true;
         }
 
-        modelFile.clear();
+        if (pending[i] == selected) {
+            ret = results[i];
+        } else if (results[i] < 0) {
+            ErrPrint("Peer is excluded from the balancing");
+        }
+    }
+
+    if (ret == 0) {
+        peer = selected->peer;
     }
 
-    peer = selected.peer;
-    return peer->Prepare();
+    preparing = false;
+    int status = pthread_cond_broadcast(&migrateCond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_broadcast");
+    }
+    MUTEX_UNLOCK(&lock);
+
+    return ret;
 }
 
 int Inference::impl::remote::Invoke(const beyond_tensor *input, int size, const void *context)
 {
+    Request *request;
+
+    try {
+        request = new Request();
+    } catch (std::exception &e) {
+        ErrPrint("new request: %s", e.what());
+        return -ENOMEM;
+    }
+
+    request->context = context;
+    request->input = input;
+    request->size = size;
+    request->peerCtx = nullptr;
+    request->startedAt = 0.0;
+    request->eventType = 0;
+    request->hasOutput = false;
+
+    MUTEX_LOCK(&lock);
     if (peer == nullptr) {
+        MUTEX_UNLOCK(&lock);
         ErrPrint("Peer is not ready to use");
+        delete request;
         return -EINVAL;
     }
-    return peer->Invoke(input, size, context);
+
+    int ret = 0;
+    PeerContext *peerCtx = nullptr;
+
+    // NOTE:
+    // The pending requests go first to keep the submission order.
+    if (pendingQueue.empty() == true) {
+        peerCtx = SelectPeer();
+    }
+
+    if (peerCtx == nullptr) {
+        // Every peer has reached the in-flight limit, the request is going to be sent when a slot is released.
+        pendingQueue.push_back(request);
+    } else {
+        ret = Dispatch(request, peerCtx);
+    }
+
+    if (ret < 0) {
+        delete request;
+        request = nullptr;
+    } else {
+        request->sequence = nextSequence++;
+    }
+    MUTEX_UNLOCK(&lock);
+
+    return ret;
 }
 
 int Inference::impl::remote::GetOutput(beyond_tensor *&tensor, int &size)
 {
-    if (peer == nullptr) {
-        ErrPrint("Peer is not ready to use");
-        return -EINVAL;
+    MUTEX_LOCK(&lock);
+    if (outputQueue.empty() == true) {
+        MUTEX_UNLOCK(&lock);
+        ErrPrint("There is no output");
+        return -EAGAIN;
     }
-    return peer->GetOutput(tensor, size);
+
+    Output output = outputQueue.front();
+    outputQueue.pop();
+    outputOwner[output.tensor] = output.peer;
+    MUTEX_UNLOCK(&lock);
+
+    tensor = output.tensor;
+    size = output.size;
+    return 0;
 }
 
 int Inference::impl::remote::Stop(void)
 {
+    int ret = 0;
+    MUTEX_LOCK(&lock);
     if (peer == nullptr) {
+        MUTEX_UNLOCK(&lock);
         ErrPrint("Peer is not ready to use");
         return -EINVAL;
     }
-    return peer->Stop();
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+        if ((*it)->prepared == false) {
+            continue;
+        }
+
+        int status = (*it)->peer->Stop();
+        if (status < 0) {
+            ErrPrint("Failed to stop the peer: %d", status);
+            ret = status;
+        }
+    }
+
+    while (pendingQueue.empty() == false) {
+        Request *request = pendingQueue.front();
+        pendingQueue.pop_front();
+        CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_CANCELED);
+    }
+    MUTEX_UNLOCK(&lock);
+
+    return ret;
 }
 
 int Inference::impl::remote::LoadModel(const char **model, int size)
@@ -269,14 +996,20 @@ int Inference::impl::remote::LoadModel(const char **model, int size)
         return -ENOTSUP;
     }
 
+    // NOTE:
+    // Keep the model filename until we choose the best peer (in the prepare() stage)
+    // It is also used for preparing a new peer when the requests are migrated.
     int ret = 0;
-    if (peer == nullptr) {
-        // NOTE:
-        // Keep the model filename until we choose the best peer (in the prepare() stage)
-        modelFile = std::string(model[0]);
-    } else {
-        ret = peer->LoadModel(model[0]);
+    MUTEX_LOCK(&lock);
+    modelFile = std::string(model[0]);
+
+    std::vector<PeerContext *>::iterator it;
+    for (it = peerVector.begin(); it != peerVector.end() && ret == 0; ++it) {
+        if ((*it)->prepared == true) {
+            ret = (*it)->peer->LoadModel(model[0]);
+        }
     }
+    MUTEX_UNLOCK(&lock);
 
     return ret;
 }
@@ -293,94 +1026,223 @@ int Inference::impl::remote::RemoveRuntime(InferenceInterface::RuntimeInterface
     return -EINVAL;
 }
 
-beyond_handler_return Inference::impl::remote::PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data)
+int Inference::impl::remote::PublishEvent(int type, void *data)
 {
-    if ((type & BEYOND_EVENT_TYPE_ERROR) == BEYOND_EVENT_TYPE_ERROR) {
-        DbgPrint("BeyonD Error Event");
-        return BEYOND_HANDLER_RETURN_RENEW;
-    }
-
-    Inference::impl::remote *remote = static_cast<Inference::impl::remote *>(data);
-
     EventObjectInterface::EventData *eventData;
 
     try {
         eventData = new EventObjectInterface::EventData();
     } catch (std::exception &e) {
         ErrPrint("new failed: %s", e.what());
-        return BEYOND_HANDLER_RETURN_CANCEL;
+        return -ENOMEM;
     }
 
-    eventData->type = eventInfo->type;
-    eventData->data = eventInfo->data;
+    eventData->type = type;
+    eventData->data = data;
 
     DbgPrint("Publish event data! (0x%.8X, %p)", eventData->type, eventData->data);
-    if (remote->eventObject->PublishEventData(eventData) < 0) {
+    int ret = eventObject->PublishEventData(eventData);
+    if (ret < 0) {
         assert(!"Failed to publish the event data");
         DbgPrint("Failed to publish the event data");
         delete eventData;
         eventData = nullptr;
     }
 
+    return ret;
+}
+
+beyond_handler_return Inference::impl::remote::PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data)
+{
+    if ((type & BEYOND_EVENT_TYPE_ERROR) == BEYOND_EVENT_TYPE_ERROR) {
+        DbgPrint("BeyonD Error Event");
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    PeerContext *peerCtx = static_cast<PeerContext *>(data);
+    Inference::impl::remote *remote = peerCtx->owner;
+
+    if ((eventInfo->type & BEYOND_EVENT_TYPE_PEER_MASK) == BEYOND_EVENT_TYPE_PEER_INFO_UPDATED) {
+        // NOTE:
+        // The discovery updates the load of the peer while it is running (TXT record),
+        // the peer is ranked by the latest one on the next preparing.
+        const beyond_peer_info *info = nullptr;
+        if (peerCtx->peer->GetInfo(info) == 0 && info != nullptr) {
+            MUTEX_LOCK(&remote->lock);
+            peerCtx->advertised = GetAdvertisedCompletion(info);
+            MUTEX_UNLOCK(&remote->lock);
+        }
+    }
+
+    MUTEX_LOCK(&remote->lock);
+    Request *request = static_cast<Request *>(eventInfo->data);
+    std::set<Request *>::iterator it = remote->requestSet.find(request);
+    if (it == remote->requestSet.end()) {
+        MUTEX_UNLOCK(&remote->lock);
+        // NOTE:
+        // Not a request event, deliver it as it is
+        (void)remote->PublishEvent(eventInfo->type, eventInfo->data);
+        return BEYOND_HANDLER_RETURN_RENEW;
+    }
+
+    remote->requestSet.erase(it);
+    peerCtx->inflight--;
+
+    double latency = Inference::impl::LatencyEstimator::GetTimestamp() - request->startedAt;
+    int eventType = eventInfo->type;
+
+    if ((eventType & BEYOND_EVENT_TYPE_INFERENCE_MASK) == BEYOND_EVENT_TYPE_INFERENCE_SUCCESS) {
+        beyond_tensor *tensor = nullptr;
+        int size = 0;
+
+        // NOTE:
+        // The output is fetched from the peer who made it,
+        // because the following requests can be routed to another peer.
+        int ret = peerCtx->peer->GetOutput(tensor, size);
+        if (ret < 0) {
+            ErrPrint("Unable to get the output: %d", ret);
+            eventType = BEYOND_EVENT_TYPE_INFERENCE_ERROR;
+        } else {
+            request->output.tensor = tensor;
+            request->output.size = size;
+            request->output.peer = peerCtx->peer;
+            request->hasOutput = true;
+        }
+    }
+
+    remote->UpdateLatency(peerCtx, latency, (eventType & BEYOND_EVENT_TYPE_INFERENCE_MASK) == BEYOND_EVENT_TYPE_INFERENCE_SUCCESS);
+    remote->CompleteRequest(request, eventType);
+    request = nullptr;
+
+    // A slot is released, send the pending requests
+    remote->DispatchPending();
+    MUTEX_UNLOCK(&remote->lock);
+
     return BEYOND_HANDLER_RETURN_RENEW;
 }
 
 // Add peer modules for invoke remote inference
 int Inference::impl::remote::AddPeer(InferenceInterface::PeerInterface *peer)
 {
+    PeerContext *peerCtx;
+
+    try {
+        peerCtx = new PeerContext();
+    } catch (std::exception &e) {
+        ErrPrint("new peer context: %s", e.what());
+        return -ENOMEM;
+    }
+
+    peerCtx->owner = this;
+    peerCtx->peer = peer;
+    peerCtx->advertised = 0.0;
+    peerCtx->baseline = 0.0;
+    peerCtx->activated = false;
+    peerCtx->prepared = false;
+    peerCtx->inflight = 0;
+
+    // NOTE:
+    // The peer is not activated yet, so its information is the one which is given by the discovery
+    const beyond_peer_info *info = nullptr;
+    if (peer->GetInfo(info) == 0 && info != nullptr) {
+        peerCtx->advertised = GetAdvertisedCompletion(info);
+    }
+
     int ret;
 
     ret = peer->AddHandler(
         Inference::impl::remote::PeerEventHandler,
         beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
-        static_cast<void *>(this));
+        static_cast<void *>(peerCtx));
     if (ret < 0) {
         ErrPrint("Failed to add event handler");
+        delete peerCtx;
         return ret;
     }
 
-    // TODO:
-    // The peer should be activated when the co-inference needs to use it.
-    // At least now, just activate each peer when it is added simply.
-    ret = peer->Activate();
-    if (ret < 0) {
-        (void)peer->RemoveHandler(
-            Inference::impl::remote::PeerEventHandler,
-            beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
-            static_cast<void *>(this));
-        return ret;
-    }
-
-    peerVector.push_back(peer);
+    // NOTE:
+    // The peer is activated when the Prepare() (or the migration) needs it, see ActivatePeer().
+    MUTEX_LOCK(&lock);
+    peerVector.push_back(peerCtx);
+    MUTEX_UNLOCK(&lock);
     return ret;
 }
 
 int Inference::impl::remote::RemovePeer(InferenceInterface::PeerInterface *peer)
 {
-    std::vector<InferenceInterface::PeerInterface *>::iterator it;
-    it = std::find(peerVector.begin(), peerVector.end(), peer);
+    MUTEX_LOCK(&lock);
+    // NOTE:
+    // The peer can be a candidate of the running migration or the preparation
+    while (migrating == true || preparing == true) {
+        int status = pthread_cond_wait(&migrateCond, &lock);
+        if (status != 0) {
+            ErrPrintCode(status, "pthread_cond_wait");
+            break;
+        }
+    }
+
+    std::vector<PeerContext *>::iterator it;
+    it = std::find_if(peerVector.begin(), peerVector.end(), [peer](const PeerContext *peerCtx) -> bool {
+        return peerCtx->peer == peer;
+    });
     if (it == peerVector.end()) {
+        MUTEX_UNLOCK(&lock);
         DbgPrint("Peer is not found");
         return -ENOENT;
     }
 
+    PeerContext *peerCtx = *it;
+    peerVector.erase(it);
+
+    // NOTE:
+    // The requests on the removed peer are never going to be completed.
+    std::set<Request *>::iterator rit = requestSet.begin();
+    while (rit != requestSet.end()) {
+        Request *request = *rit;
+        if (request->peerCtx != peerCtx) {
+            ++rit;
+            continue;
+        }
+
+        rit = requestSet.erase(rit);
+        CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+    }
+
+    if (this->peer == peer) {
+        this->peer = nullptr;
+
+        for (it = peerVector.begin(); it != peerVector.end(); ++it) {
+            if ((*it)->prepared == true) {
+                this->peer = (*it)->peer;
+                break;
+            }
+        }
+    }
+
+    if (this->peer == nullptr) {
+        // There is no peer to send the pending requests
+        while (pendingQueue.empty() == false) {
+            Request *request = pendingQueue.front();
+            pendingQueue.pop_front();
+            CompleteRequest(request, BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+        }
+    }
+    MUTEX_UNLOCK(&lock);
+
     // TODO:
     // Even not the removing case, the peer can be deactivated when the co-inference does not
     // need to use the peer anymore while doing inference operation.
     // For an example, the peer getting too slow (or a new one added faster than the old one)
-    peer->Deactivate();
+    if (peerCtx->activated == true) {
+        peer->Deactivate();
+    }
 
     int ret = peer->RemoveHandler(
         Inference::impl::remote::PeerEventHandler,
         beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR,
-        static_cast<void *>(this));
-
-    if (this->peer == peer) {
-        this->peer = nullptr;
-    }
-
-    peerVector.erase(it);
+        static_cast<void *>(peerCtx));
 
+    delete peerCtx;
     return ret;
 }
 
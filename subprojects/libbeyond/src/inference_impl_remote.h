@@ -20,6 +20,12 @@
 #include <vector>
 #include <functional>
 #include <string>
+#include <set>
+#include <map>
+#include <queue>
+#include <deque>
+
+#include <pthread.h>
 
 #include <beyond/common.h>
 #include <beyond/private/event_object_private.h>
@@ -27,12 +33,13 @@
 #include <beyond/private/inference_private.h>
 
 #include "inference_impl.h"
+#include "inference_impl_latency.h"
 
 namespace beyond {
 
 class Inference::impl::remote final : public Inference::impl {
 public: // Inference interface
-    static remote *Create(bool autoSplit = false);
+    static remote *Create(bool autoSplit = false, const char *balance = nullptr, int maxInflight = 0, bool ordered = false);
 
     void Destroy(void) override;
 
@@ -71,17 +78,93 @@ public: // Implementation interface
     int AddPeer(InferenceInterface::PeerInterface *peer) override;
     int RemovePeer(InferenceInterface::PeerInterface *peer) override;
 
+private:
+    struct PeerContext {
+        remote *owner;
+        InferenceInterface::PeerInterface *peer;
+        Inference::impl::LatencyEstimator latency; // Invoke() to output round trip
+        Inference::impl::LatencyEstimator probe;   // GetInfo() round trip
+        double advertised;                         // The expected completion by the load which is given by the discovery (0: unknown)
+        double baseline;                           // The best average latency observed
+        bool activated;                            // Activated by the thread which prepares (or probes) the peer
+        bool prepared;
+        int inflight;
+    };
+
+    enum class Balance {
+        Latency = 0,
+        RoundRobin = 1,
+        LeastOutstanding = 2,
+    };
+
+    struct Output {
+        beyond_tensor *tensor;
+        int size;
+        InferenceInterface::PeerInterface *peer;
+    };
+
+    // NOTE:
+    // A request is delivered to the peer as the invoke context,
+    // so the round trip time can be measured when the response comes.
+    struct Request {
+        const void *context;
+        const beyond_tensor *input;
+        int size;
+        unsigned long long sequence;
+        PeerContext *peerCtx;
+        double startedAt;
+        int eventType;
+        Output output;
+        bool hasOutput;
+    };
+
 private:
     remote(void);
-    ~remote(void) = default;
+    ~remote(void);
+
+    friend class InferenceImplTest;
 
     static beyond_handler_return PeerEventHandler(beyond_object_h obj, int type, beyond_event_info *eventInfo, void *data);
 
+    int PublishEvent(int type, void *data);
+    int PreparePeer(PeerContext *peerCtx, const std::string &model);
+    static int ActivatePeer(PeerContext *peerCtx);
+    static int ProbePeer(PeerContext *peerCtx, double &latency);
+    void UpdateProbe(PeerContext *peerCtx, int status, double latency);
+    static double GetAdvertisedCompletion(const beyond_peer_info *info);
+    double GetExpectedCompletion(const PeerContext *peerCtx) const;
+    PeerContext *SelectPeer(void);
+    int Dispatch(Request *request, PeerContext *peerCtx);
+    void DispatchPending(void);
+    void CompleteRequest(Request *request, int eventType);
+    void FlushCompleted(void);
+    void UpdateLatency(PeerContext *peerCtx, double latency, bool success);
+    void Migrate(PeerContext *degraded);
+    void WaitMigration(void);
+    static void *MigrateMain(void *arg);
+
     Inference::impl::remote::EventObject *eventObject;
-    InferenceInterface::PeerInterface *peer; // Selected Peer
+    InferenceInterface::PeerInterface *peer; // The first selected peer, it is used for the tensor information
     bool autoSplit;
-    std::vector<InferenceInterface::PeerInterface *> peerVector;
+    Balance balance;
+    int maxInflight; // Per peer, 0 means unlimited
+    bool ordered;    // Deliver the completions in the submission order
+    size_t nextPeer; // For the round-robin
+    unsigned long long nextSequence;
+    unsigned long long deliverSequence;
+    std::vector<PeerContext *> peerVector;
+    std::set<Request *> requestSet;
+    std::deque<Request *> pendingQueue;                   // Requests waiting for an in-flight slot
+    std::map<unsigned long long, Request *> completedMap; // Completed requests waiting for their turn
+    std::queue<Output> outputQueue;
+    std::map<beyond_tensor *, InferenceInterface::PeerInterface *> outputOwner;
     std::string modelFile;
+    bool migrating;                            // A migration thread is preparing a new peer
+    bool preparing;                            // Prepare() is probing and preparing the peers without the lock
+    std::vector<PeerContext *> migrateVector;  // Candidates of the running migration
+    std::string migrateModel;                  // The model which is going to be loaded on the candidate
+    pthread_cond_t migrateCond;                // Signaled when the migration or the preparation is finished
+    pthread_mutex_t lock;
 };
 
 } // namespace beyond
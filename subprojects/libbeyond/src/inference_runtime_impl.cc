@@ -19,6 +19,7 @@
 #include <cstdlib>
 #include <cerrno>
 #include <exception>
+#include <vector>
 
 #include <dlfcn.h>
 #include <getopt.h>
@@ -85,14 +86,118 @@ Inference::Runtime::impl *Inference::Runtime::impl::Create(const beyond_argument
         return nullptr;
     }
 
+    int workers = 1;
+    int queueDepth = 0;
+    if (ParseArguments(arg->argc, arg->argv, workers, queueDepth) < 0) {
+        delete impl;
+        impl = nullptr;
+        return nullptr;
+    }
+
+    impl->module = CreateModule(main, arg);
+    if (impl->module == nullptr) {
+        delete impl;
+        impl = nullptr;
+        return nullptr;
+    }
+
+    if (impl->module->GetHandle() == -ENOTSUP) {
+        DbgPrint("Runtime module does not support asynchornous mode, activate the async mode emulator");
+
+        // NOTE:
+        // Every worker of the async mode emulator needs its own runtime instance.
+        std::vector<InferenceInterface::RuntimeInterface *> modules;
+        try {
+            modules.push_back(impl->module);
+            for (int i = 1; i < workers; i++) {
+                InferenceInterface::RuntimeInterface *runtime = CreateModule(main, arg);
+                if (runtime == nullptr) {
+                    ErrPrint("Unable to create the runtime instance for the worker[%d]", i);
+                    break;
+                }
+
+                impl->workerModules.push_back(runtime);
+                modules.push_back(runtime);
+            }
+        } catch (std::exception &e) {
+            ErrPrint("push_back: %s", e.what());
+        }
+
+        impl->asyncEmulator = Inference::Runtime::impl::Async::Create(modules.data(), modules.size(), queueDepth);
+        impl->async = impl->asyncEmulator;
+        if (impl->async == nullptr) {
+            ErrPrint("Unable to activate the async mode emulator");
+        }
+    } else {
+        DbgPrint("Runtime module support async mode, do not activate the async mode emulator");
+        impl->async = impl->module;
+    }
+
+    return impl;
+}
+
+int Inference::Runtime::impl::ParseArguments(int argc, char **argv, int &workers, int &queueDepth)
+{
+    const option opts[] = {
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_RUNTIME_OPTION_WORKERS), // Number of the runtime instances
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'w',
+        },
+        {
+            .name = BEYOND_GET_OPTION_NAME(BEYOND_INFERENCE_RUNTIME_OPTION_QUEUE_DEPTH), // Maximum number of the in-flight requests
+            .has_arg = 1,
+            .flag = nullptr,
+            .val = 'q',
+        },
+        {
+            .name = nullptr,
+            .has_arg = 0,
+            .flag = nullptr,
+            .val = 0,
+        },
+    };
+    int idx;
+    int c;
+
+    optind = 0;
+    opterr = 0;
+
+    // NOTE:
+    // Do not give the short options, the runtime module may use them for its own options.
+    while ((c = getopt_long(argc, argv, "-:", opts, &idx)) != -1) {
+        switch (c) {
+        case 'w': // workers
+            workers = atoi(optarg);
+            if (workers < 1) {
+                ErrPrint("Invalid workers: %s", optarg);
+                return -EINVAL;
+            }
+            break;
+        case 'q': // queue-depth
+            queueDepth = atoi(optarg);
+            if (queueDepth < 0) {
+                ErrPrint("Invalid queue depth: %s", optarg);
+                return -EINVAL;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return 0;
+}
+
+InferenceInterface::RuntimeInterface *Inference::Runtime::impl::CreateModule(ModuleInterface::EntryPoint main, const beyond_argument *arg)
+{
     optind = 0;
     opterr = 0;
 
     InferenceInterface::RuntimeInterface *runtime = reinterpret_cast<InferenceInterface::RuntimeInterface *>(main(arg->argc, arg->argv));
     if (runtime == nullptr) {
         ErrPrint("Failed to create the runtime instance");
-        delete impl;
-        impl = nullptr;
         return nullptr;
     }
 
@@ -101,9 +206,6 @@ Inference::Runtime::impl *Inference::Runtime::impl::Create(const beyond_argument
         ErrPrint("Module type is nullptr");
         runtime->Destroy();
         runtime = nullptr;
-
-        delete impl;
-        impl = nullptr;
         return nullptr;
     }
 
@@ -111,27 +213,10 @@ Inference::Runtime::impl *Inference::Runtime::impl::Create(const beyond_argument
         ErrPrint("Invalid module type: %s\n", moduleType);
         runtime->Destroy();
         runtime = nullptr;
-
-        delete impl;
-        impl = nullptr;
         return nullptr;
     }
 
-    impl->module = runtime;
-
-    if (impl->module->GetHandle() == -ENOTSUP) {
-        DbgPrint("Runtime module does not support asynchornous mode, activate the async mode emulator");
-        impl->asyncEmulator = Inference::Runtime::impl::Async::Create(impl->module);
-        impl->async = impl->asyncEmulator;
-        if (impl->async == nullptr) {
-            ErrPrint("Unable to activate the async mode emulator");
-        }
-    } else {
-        DbgPrint("Runtime module support async mode, do not activate the async mode emulator");
-        impl->async = runtime;
-    }
-
-    return impl;
+    return runtime;
 }
 
 Inference::Runtime::impl::impl(void)
@@ -159,6 +244,11 @@ void Inference::Runtime::impl::Destroy(void)
         asyncEmulator = nullptr;
     }
 
+    for (auto &runtime : workerModules) {
+        runtime->Destroy();
+    }
+    workerModules.clear();
+
     module->Destroy();
 
     module = nullptr;
@@ -222,6 +312,13 @@ int Inference::Runtime::impl::Prepare(void)
     return async->Prepare();
 }
 
+// NOTE:
+// Partitioning does not touch the loaded model, it is not dispatched to the workers
+int Inference::Runtime::impl::SplitModel(const char *model, std::vector<std::string> &models)
+{
+    return module->SplitModel(model, models);
+}
+
 int Inference::Runtime::impl::Invoke(const beyond_tensor *input, int size, const void *context)
 {
     return async->Invoke(input, size, context);
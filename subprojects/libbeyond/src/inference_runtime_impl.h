@@ -17,6 +17,9 @@
 #ifndef __BEYOND_INTERNAL_INFERENCE_RUNTIME_IMPL_H__
 #define __BEYOND_INTERNAL_INFERENCE_RUNTIME_IMPL_H__
 
+#include <string>
+#include <vector>
+
 #include "beyond/private/module_interface_private.h"
 #include "beyond/private/inference_interface_private.h"
 #include "beyond/private/inference_runtime_private.h"
@@ -65,12 +68,19 @@ public: // InferenceInterface interface
 
     int Stop(void) override;
 
+public: // RuntimeInterface interface
+    int SplitModel(const char *model, std::vector<std::string> &models) override;
+
 private:
     impl(void);
     virtual ~impl(void);
 
+    static int ParseArguments(int argc, char **argv, int &workers, int &queueDepth);
+    static InferenceInterface::RuntimeInterface *CreateModule(ModuleInterface::EntryPoint main, const beyond_argument *arg);
+
     void *dlHandle;
     InferenceInterface::RuntimeInterface *module;
+    std::vector<InferenceInterface::RuntimeInterface *> workerModules; // Extra runtime instances for the async mode emulator workers
     Inference::Runtime::impl::Async *asyncEmulator;
 
     InferenceInterface *async;
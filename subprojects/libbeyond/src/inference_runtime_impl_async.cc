@@ -22,10 +22,11 @@
 #include <cerrno>
 #include <cstring>
 
+#include <exception>
+
 #include <sys/types.h>
-#include <sys/socket.h>
-#include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "beyond/platform/beyond_platform.h"
 #include "beyond/private/log_private.h"
@@ -34,7 +35,7 @@
 #include "beyond/private/event_object_interface_private.h"
 #include "beyond/private/event_object_private.h"
 #include "beyond/private/command_object_interface_private.h"
-#include "beyond/private/command_object_private.h"
+#include "beyond/private/command_ring_object_private.h"
 
 #include "beyond/private/module_interface_private.h"
 #include "beyond/private/inference_interface_private.h"
@@ -43,20 +44,41 @@
 #include "inference_runtime_impl.h"
 #include "inference_runtime_impl_async.h"
 
+// Maximum number of the idle command data kept for the Invoke()
+#define COMMAND_POOL_SIZE CommandRingObject::DEFAULT_CAPACITY
+// Number of the output tensors which can be queued before the caller takes them
+#define OUTPUT_QUEUE_CAPACITY 1024
+
+#define MUTEX_LOCK(v)                                \
+    do {                                             \
+        int ret = pthread_mutex_lock(v);             \
+        if (ret != 0) {                              \
+            ErrPrintCode(ret, "pthread_mutex_lock"); \
+        }                                            \
+    } while (0)
+
+#define MUTEX_UNLOCK(v)                                \
+    do {                                               \
+        int ret = pthread_mutex_unlock(v);             \
+        if (ret != 0) {                                \
+            ErrPrintCode(ret, "pthread_mutex_unlock"); \
+        }                                              \
+    } while (0)
+
 namespace beyond {
 
-int Inference::Runtime::impl::Async::CommandConfigureHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandConfigureHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    arg->ret.value = async->context.module->Configure(static_cast<beyond_config *>(arg->args.ptr));
+    arg->ret.value = worker->module->Configure(static_cast<beyond_config *>(arg->args.ptr));
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdConfigure, arg);
+    ret = worker->workerCommand->Send(Command::IdConfigure, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -65,18 +87,18 @@ int Inference::Runtime::impl::Async::CommandConfigureHandler(Inference::Runtime:
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandLoadModelHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandLoadModelHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    arg->ret.value = async->context.module->LoadModel(static_cast<char *>(arg->args.ptr));
+    arg->ret.value = worker->module->LoadModel(static_cast<char *>(arg->args.ptr));
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdLoadModel, arg);
+    ret = worker->workerCommand->Send(Command::IdLoadModel, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -85,9 +107,9 @@ int Inference::Runtime::impl::Async::CommandLoadModelHandler(Inference::Runtime:
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandGetInputTensorInfoHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandGetInputTensorInfoHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
@@ -95,13 +117,13 @@ int Inference::Runtime::impl::Async::CommandGetInputTensorInfoHandler(Inference:
     const beyond_tensor_info *info = nullptr;
     int size = 0;
 
-    arg->ret.value = async->context.module->GetInputTensorInfo(info, size);
+    arg->ret.value = worker->module->GetInputTensorInfo(info, size);
     arg->args.tensorInfo.info = const_cast<beyond_tensor_info *>(info);
     arg->args.tensorInfo.size = size;
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdGetInputTensorInfo, arg);
+    ret = worker->workerCommand->Send(Command::IdGetInputTensorInfo, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -110,9 +132,9 @@ int Inference::Runtime::impl::Async::CommandGetInputTensorInfoHandler(Inference:
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandGetOutputTensorInfoHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandGetOutputTensorInfoHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
@@ -120,13 +142,13 @@ int Inference::Runtime::impl::Async::CommandGetOutputTensorInfoHandler(Inference
     const beyond_tensor_info *info;
     int size;
 
-    arg->ret.value = async->context.module->GetOutputTensorInfo(info, size);
+    arg->ret.value = worker->module->GetOutputTensorInfo(info, size);
     arg->args.tensorInfo.info = const_cast<beyond_tensor_info *>(info);
     arg->args.tensorInfo.size = size;
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdGetOutputTensorInfo, arg);
+    ret = worker->workerCommand->Send(Command::IdGetOutputTensorInfo, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -135,18 +157,18 @@ int Inference::Runtime::impl::Async::CommandGetOutputTensorInfoHandler(Inference
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandSetInputTensorInfoHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandSetInputTensorInfoHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    arg->ret.value = async->context.module->SetInputTensorInfo(arg->args.tensorInfo.info, arg->args.tensorInfo.size);
+    arg->ret.value = worker->module->SetInputTensorInfo(arg->args.tensorInfo.info, arg->args.tensorInfo.size);
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdSetInputTensorInfo, arg);
+    ret = worker->workerCommand->Send(Command::IdSetInputTensorInfo, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -155,18 +177,18 @@ int Inference::Runtime::impl::Async::CommandSetInputTensorInfoHandler(Inference:
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandSetOutputTensorInfoHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandSetOutputTensorInfoHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    arg->ret.value = async->context.module->SetOutputTensorInfo(arg->args.tensorInfo.info, arg->args.tensorInfo.size);
+    arg->ret.value = worker->module->SetOutputTensorInfo(arg->args.tensorInfo.info, arg->args.tensorInfo.size);
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdSetOutputTensorInfo, arg);
+    ret = worker->workerCommand->Send(Command::IdSetOutputTensorInfo, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -175,20 +197,20 @@ int Inference::Runtime::impl::Async::CommandSetOutputTensorInfoHandler(Inference
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandAllocateTensorHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandAllocateTensorHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
     beyond_tensor *tensor = nullptr;
 
-    arg->ret.obj.value = async->context.module->AllocateTensor(arg->args.tensorInfo.info, arg->args.tensorInfo.size, tensor);
+    arg->ret.obj.value = worker->module->AllocateTensor(arg->args.tensorInfo.info, arg->args.tensorInfo.size, tensor);
     arg->ret.obj.ptr = tensor;
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdAllocateTensor, arg);
+    ret = worker->workerCommand->Send(Command::IdAllocateTensor, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -197,19 +219,19 @@ int Inference::Runtime::impl::Async::CommandAllocateTensorHandler(Inference::Run
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandFreeTensorHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandFreeTensorHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    async->context.module->FreeTensor(arg->args.tensor.tensor, arg->args.tensor.size);
+    worker->module->FreeTensor(arg->args.tensor.tensor, arg->args.tensor.size);
     arg->ret.value = 0;
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdFreeTensor, arg);
+    ret = worker->workerCommand->Send(Command::IdFreeTensor, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -218,18 +240,18 @@ int Inference::Runtime::impl::Async::CommandFreeTensorHandler(Inference::Runtime
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandPrepareHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandPrepareHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    arg->ret.value = async->context.module->Prepare();
+    arg->ret.value = worker->module->Prepare();
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdPrepare, arg);
+    ret = worker->workerCommand->Send(Command::IdPrepare, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -238,30 +260,64 @@ int Inference::Runtime::impl::Async::CommandPrepareHandler(Inference::Runtime::i
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandInvokeHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandInvokeHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
+    Async *async = worker->owner;
 
     EventData *eventData;
     try {
         eventData = new EventData();
     } catch (std::exception &e) {
         ErrPrint("new: %s", e.what());
+        async->ReleaseCommandData(arg);
+        worker->inflight--;
+        async->inflight--;
         return -ENOMEM;
     }
 
     eventData->data = arg->args.tensor.context;
 
-    int ret = async->context.module->Invoke(arg->args.tensor.tensor, arg->args.tensor.size, arg->args.tensor.context);
+    int ret = worker->module->Invoke(arg->args.tensor.tensor, arg->args.tensor.size, arg->args.tensor.context);
     if (ret < 0) {
         eventData->type = beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR;
     } else {
         eventData->type = beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_SUCCESS;
     }
 
-    if (async->context.module->GetOutput(arg->args.tensor.tensor, arg->args.tensor.size) < 0) {
+    bool hasOutput = (worker->module->GetOutput(arg->args.tensor.tensor, arg->args.tensor.size) == 0);
+    arg->worker = worker;
+
+    // NOTE:
+    // The request is done from the point of view of the runtime.
+    // Update the counters before publishing the event,
+    // so the event handler can invoke the next request right away.
+    worker->inflight--;
+    async->inflight--;
+
+    MUTEX_LOCK(&async->outputLock);
+    while (hasOutput == true && async->outputQueued >= OUTPUT_QUEUE_CAPACITY && async->closing == false) {
+        // NOTE:
+        // The caller does not take the outputs, wait for the free slot without holding the outputLock
+        int status = pthread_cond_wait(&async->outputCond, &async->outputLock);
+        if (status != 0) {
+            ErrPrintCode(status, "pthread_cond_wait");
+            break;
+        }
+    }
+
+    if (hasOutput == true && (async->outputQueued >= OUTPUT_QUEUE_CAPACITY || async->closing == true)) {
+        worker->module->FreeTensor(arg->args.tensor.tensor, arg->args.tensor.size);
+        hasOutput = false;
+    }
+
+    if (hasOutput == false) {
+        // NOTE:
+        // There is no output tensor to deliver, the "arg" is not going to be consumed by the GetOutput()
+        async->ReleaseCommandData(arg);
+
         // Rewrite the event type
         eventData->type = beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR;
     } else {
@@ -274,14 +330,16 @@ int Inference::Runtime::impl::Async::CommandInvokeHandler(Inference::Runtime::im
         // NOTE:
         // "arg" ownership transferred from Invoke()
         // The ownership of the "arg" will be moved to GetOutput()
-        ret = async->context.outputProducer->Send(Command::IdGetOutput, arg);
+        ret = async->outputProducer->Send(Command::IdGetOutput, arg);
         if (ret < 0) {
             ErrPrint("Unable to queue the output tensor: %d", ret);
-            delete arg;
-            arg = nullptr;
+            worker->module->FreeTensor(arg->args.tensor.tensor, arg->args.tensor.size);
+            async->ReleaseCommandData(arg);
 
             // Rewrite the event type
             eventData->type = beyond_event_type::BEYOND_EVENT_TYPE_INFERENCE_ERROR;
+        } else {
+            async->outputQueued++;
         }
     }
 
@@ -290,22 +348,23 @@ int Inference::Runtime::impl::Async::CommandInvokeHandler(Inference::Runtime::im
         delete eventData;
         eventData = nullptr;
     }
+    MUTEX_UNLOCK(&async->outputLock);
 
     return ret;
 }
 
-int Inference::Runtime::impl::Async::CommandStopHandler(Inference::Runtime::impl::Async *async, void *data)
+int Inference::Runtime::impl::Async::CommandStopHandler(Worker *worker, void *data)
 {
-    assert(async != nullptr && data != nullptr && "async and data must not be nullptr");
+    assert(worker != nullptr && data != nullptr && "worker and data must not be nullptr");
 
     CommandData *arg = static_cast<CommandData *>(data);
     int ret;
 
-    arg->ret.value = async->context.module->Stop();
+    arg->ret.value = worker->module->Stop();
 
     // WARN:
     // Do not access the "arg" after Send it
-    ret = async->context.command->Send(Command::IdStop, arg);
+    ret = worker->workerCommand->Send(Command::IdStop, arg);
     arg = nullptr; // for the safety.
     if (ret < 0) {
         ErrPrint("send failed: %d", ret);
@@ -313,239 +372,190 @@ int Inference::Runtime::impl::Async::CommandStopHandler(Inference::Runtime::impl
     return ret;
 }
 
-Inference::Runtime::impl::Async *Inference::Runtime::impl::Async::Create(InferenceInterface::RuntimeInterface *module)
+const Inference::Runtime::impl::Async::CommandHandler Inference::Runtime::impl::Async::cmdTable[Command::IdLast] = {
+    CommandConfigureHandler,
+    CommandLoadModelHandler,
+    CommandGetInputTensorInfoHandler,
+    CommandGetOutputTensorInfoHandler,
+    CommandSetInputTensorInfoHandler,
+    CommandSetOutputTensorInfoHandler,
+    CommandAllocateTensorHandler,
+    CommandFreeTensorHandler,
+    CommandPrepareHandler,
+    CommandInvokeHandler,
+    CommandStopHandler,
+};
+
+Inference::Runtime::impl::Async *Inference::Runtime::impl::Async::Create(InferenceInterface::RuntimeInterface **modules, int count, int queueDepth)
 {
+    if (modules == nullptr || count <= 0 || queueDepth < 0) {
+        ErrPrint("Invalid arguments: count(%d), queueDepth(%d)", count, queueDepth);
+        return nullptr;
+    }
+
     Inference::Runtime::impl::Async *async;
-    int spfd[2];
-    int pfd[2];
 
     try {
-        async = new Inference::Runtime::impl::Async(module);
+        async = new Inference::Runtime::impl::Async(queueDepth);
     } catch (std::exception &e) {
         ErrPrint("new: %s", e.what());
         return nullptr;
     }
 
-    if (socketpair(AF_UNIX, SOCK_STREAM, 0, spfd) < 0) {
-        ErrPrintCode(errno, "socketpair");
-        delete async;
-        async = nullptr;
-        return nullptr;
-    }
-
-    if (fcntl(spfd[0], F_SETFD, FD_CLOEXEC) < 0) {
-        ErrPrintCode(errno, "fcntl");
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+    // NOTE:
+    // Only the workers send to the output channel, and only the caller receives from it.
+    // The other direction is not used.
+    int ret = CommandRingObject::CreatePair(async->outputConsumer, async->outputProducer, OUTPUT_QUEUE_CAPACITY);
+    if (ret < 0) {
+        ErrPrint("Unable to create the output channel: %d", ret);
         delete async;
         async = nullptr;
         return nullptr;
     }
 
-    if (fcntl(spfd[1], F_SETFD, FD_CLOEXEC) < 0) {
-        ErrPrintCode(errno, "fcntl");
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+    // TODO: Inherit class required
+    async->eventObject = Inference::impl::EventObject::Create();
+    if (async->eventObject == nullptr) {
         delete async;
         async = nullptr;
         return nullptr;
     }
 
-    if (pipe(pfd) < 0) {
-        ErrPrintCode(errno, "pipe");
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
+    for (int i = 0; i < count; i++) {
+        ret = async->CreateWorker(modules[i]);
+        if (ret < 0) {
+            ErrPrint("Unable to create the worker[%d]: %d", i, ret);
+            async->Destroy();
+            async = nullptr;
+            return nullptr;
         }
-        delete async;
-        async = nullptr;
-        return nullptr;
     }
 
-    if (fcntl(pfd[0], F_SETFD, FD_CLOEXEC) < 0) {
-        ErrPrintCode(errno, "fcntl");
-        if (close(pfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(pfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        delete async;
-        async = nullptr;
-        return nullptr;
-    }
+    DbgPrint("%d worker(s) are ready, queue depth: %d", count, queueDepth);
+    return async;
+}
 
-    if (fcntl(pfd[1], F_SETFD, FD_CLOEXEC) < 0) {
-        ErrPrintCode(errno, "fcntl");
-        if (close(pfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(pfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        delete async;
-        async = nullptr;
-        return nullptr;
+int Inference::Runtime::impl::Async::CreateWorker(InferenceInterface::RuntimeInterface *module)
+{
+    if (module == nullptr) {
+        return -EINVAL;
     }
 
+    Worker *worker = nullptr;
     try {
-        async->command = new beyond::CommandObject(spfd[0]);
+        worker = new Worker();
+        workers.push_back(worker);
     } catch (std::exception &e) {
-        delete async;
-        async = nullptr;
-        if (close(pfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+        ErrPrint("new: %s", e.what());
+        delete worker;
+        worker = nullptr;
+        return -ENOMEM;
+    }
 
-        if (close(pfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+    worker->owner = this;
+    worker->module = module;
+    worker->lock = PTHREAD_MUTEX_INITIALIZER;
+    worker->inflight = 0;
 
-        if (close(spfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        return nullptr;
+    int ret = CommandRingObject::CreatePair(worker->command, worker->workerCommand);
+    if (ret < 0) {
+        ErrPrint("Unable to create the command channel: %d", ret);
+        return ret;
     }
 
-    try {
-        async->context.command = new beyond::CommandObject(spfd[1]);
-    } catch (std::exception &e) {
-        delete async;
-        async = nullptr;
-        if (close(pfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-
-        if (close(pfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+    worker->eventLoop = beyond::EventLoop::Create(true, false);
+    if (worker->eventLoop == nullptr) {
+        return -EFAULT;
+    }
 
-        if (close(spfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
-        return nullptr;
+    worker->handlerObject = worker->eventLoop->AddEventHandler(static_cast<EventObjectBaseInterface *>(worker->workerCommand), beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR, Main, static_cast<void *>(worker));
+    if (worker->handlerObject == nullptr) {
+        return -EFAULT;
     }
 
-    try {
-        async->context.outputProducer = new beyond::CommandObject(pfd[1]);
-    } catch (std::exception &e) {
-        delete async;
-        async = nullptr;
+    ret = worker->eventLoop->Run();
+    if (ret < 0) {
+        ErrPrint("Failed to run the event loop: %d", ret);
+        return ret;
+    }
 
-        if (close(pfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+    return 0;
+}
 
-        if (close(pfd[1]) < 0) {
-            ErrPrintCode(errno, "close");
+void Inference::Runtime::impl::Async::DestroyWorker(Worker *worker)
+{
+    if (worker->handlerObject != nullptr) {
+        int ret = worker->eventLoop->RemoveEventHandler(worker->handlerObject);
+        worker->handlerObject = nullptr;
+        if (ret < 0) {
+            DbgPrint("removeEventHandler: %d", ret);
         }
-
-        return nullptr;
     }
 
-    try {
-        async->outputConsumer = new beyond::CommandObject(pfd[0]);
-    } catch (std::exception &e) {
-        delete async;
-        async = nullptr;
-
-        if (close(pfd[0]) < 0) {
-            ErrPrintCode(errno, "close");
+    if (worker->eventLoop != nullptr) {
+        int ret = worker->eventLoop->Stop();
+        if (ret < 0) {
+            DbgPrint("Stop the event loop: %d", ret);
         }
 
-        return nullptr;
+        // NOTE:
+        // The worker thread could be running a command handler which was dispatched before removing the handler.
+        // Destroy() joins the worker thread, so it is safe to release the worker after this.
+        worker->eventLoop->Destroy();
+        worker->eventLoop = nullptr;
     }
 
-    // TODO: Inherit class required
-    async->eventObject = Inference::impl::EventObject::Create();
-    if (async->eventObject == nullptr) {
-        delete async;
-        async = nullptr;
-        return nullptr;
+    if (worker->workerCommand != nullptr) {
+        worker->workerCommand->Destroy();
+        worker->workerCommand = nullptr;
     }
 
-    async->context.eventLoop = beyond::EventLoop::Create(true, false);
-    if (async->context.eventLoop == nullptr) {
-        delete async;
-        async = nullptr;
-        return nullptr;
+    if (worker->command != nullptr) {
+        worker->command->Destroy();
+        worker->command = nullptr;
     }
 
-    async->handlerObject = async->context.eventLoop->AddEventHandler(static_cast<EventObjectBaseInterface *>(async->context.command), beyond_event_type::BEYOND_EVENT_TYPE_READ | beyond_event_type::BEYOND_EVENT_TYPE_ERROR, Main, static_cast<void *>(async));
-    if (async->handlerObject == nullptr) {
-        delete async;
-        async = nullptr;
-        return nullptr;
+    int ret = pthread_mutex_destroy(&worker->lock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
     }
 
-    int ret = async->context.eventLoop->Run();
-    if (ret < 0) {
-        ErrPrint("Failed to run the event loop: %d", ret);
-        delete async;
-        async = nullptr;
-        return nullptr;
-    }
-
-    return async;
+    delete worker;
 }
 
 // RUN_ON_THE_THREAD
 beyond_handler_return Inference::Runtime::impl::Async::Main(EventObjectBaseInterface *obj, int type, void *data)
 {
-    Async *async = static_cast<Async *>(data);
+    Worker *worker = static_cast<Worker *>(data);
 
     if ((type & beyond_event_type::BEYOND_EVENT_TYPE_ERROR) == beyond_event_type::BEYOND_EVENT_TYPE_ERROR) {
         ErrPrint("Error! 0x%.8x", type);
         return beyond_handler_return::BEYOND_HANDLER_RETURN_CANCEL;
     }
 
-    CommandObject *command = static_cast<CommandObject *>(obj);
+    CommandRingObject *command = static_cast<CommandRingObject *>(obj);
 
     int cmdId;
     void *cmdData;
     int ret;
 
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0) {
-        ErrPrint("Unable to recv command data");
-        return beyond_handler_return::BEYOND_HANDLER_RETURN_RENEW;
-    }
+    // NOTE:
+    // The doorbell is knocked once for a burst of commands,
+    // drain all commands which are queued until now.
+    while ((ret = command->TryRecv(cmdId, cmdData)) == 0) {
+        if (cmdId < 0 || cmdId >= Command::IdLast) {
+            ErrPrint("Invalid type: 0x%.8x", cmdId);
+            continue;
+        }
 
-    if (cmdId < 0 || cmdId >= Command::IdLast) {
-        ErrPrint("Invalid type: 0x%.8x", cmdId);
-        return beyond_handler_return::BEYOND_HANDLER_RETURN_RENEW;
+        ret = cmdTable[cmdId](worker, cmdData);
+        if (ret < 0) {
+            ErrPrint("Command returns %d", ret);
+        }
     }
 
-    ret = async->context.cmdTable[cmdId](async, cmdData);
-    if (ret < 0) {
-        ErrPrint("Command returns %d", ret);
-        return beyond_handler_return::BEYOND_HANDLER_RETURN_RENEW;
+    if (ret != -EAGAIN) {
+        ErrPrint("Unable to recv command data: %d", ret);
     }
 
     return beyond_handler_return::BEYOND_HANDLER_RETURN_RENEW;
@@ -553,105 +563,240 @@ beyond_handler_return Inference::Runtime::impl::Async::Main(EventObjectBaseInter
 
 void Inference::Runtime::impl::Async::Destroy(void)
 {
-    assert(handlerObject != nullptr && "handlerObject cannot be nullptr");
-    if (handlerObject != nullptr) {
-        int ret = context.eventLoop->RemoveEventHandler(handlerObject);
-        handlerObject = nullptr;
-        if (ret < 0) {
-            DbgPrint("removeEventHandler: %d", ret);
-        }
+    MUTEX_LOCK(&outputLock);
+    closing = true;
+    int status = pthread_cond_broadcast(&outputCond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_broadcast");
     }
+    MUTEX_UNLOCK(&outputLock);
 
-    assert(context.eventLoop != nullptr && "eventLoop cannot be nullptr");
-    if (context.eventLoop != nullptr) {
-        context.eventLoop->SetStopHandler([](EventLoop *eventLoop, void *data) -> void {
-            DbgPrint("Event Loop is stopped");
-            eventLoop->Destroy();
-        },
-                                          nullptr);
+    if (outputConsumer != nullptr) {
+        int cmdId;
+        void *cmdData;
 
-        int ret = context.eventLoop->Stop();
-        if (ret < 0) {
-            DbgPrint("Stop the event loop: %d", ret);
+        // NOTE:
+        // Release the outputs which are not taken by the GetOutput()
+        while (outputConsumer->TryRecv(cmdId, cmdData) == 0) {
+            CommandData *arg = static_cast<CommandData *>(cmdData);
+            arg->worker->module->FreeTensor(arg->args.tensor.tensor, arg->args.tensor.size);
+            ReleaseCommandData(arg);
         }
+    }
 
-        // The event loop will be destoryed when it is stopped.
-        context.eventLoop = nullptr;
+    // NOTE:
+    // The remaining requests of the workers are not going to be handled.
+    for (auto &worker : workers) {
+        DestroyWorker(worker);
     }
+    workers.clear();
 
     delete this;
 }
 
-Inference::Runtime::impl::Async::Async(InferenceInterface::RuntimeInterface *module)
-    : command(nullptr)
+Inference::Runtime::impl::Async::Async(int _queueDepth)
+    : nextWorker(0)
+    , outputProducer(nullptr)
     , outputConsumer(nullptr)
+    , outputLock(PTHREAD_MUTEX_INITIALIZER)
+    , outputCond(PTHREAD_COND_INITIALIZER)
+    , outputQueued(0)
+    , closing(false)
     , eventObject(nullptr)
-    , handlerObject(nullptr)
-    , context{
-        .command = nullptr,
-        .outputProducer = nullptr,
-        .eventLoop = nullptr,
-        .cmdTable = {
-            CommandConfigureHandler,
-            CommandLoadModelHandler,
-            CommandGetInputTensorInfoHandler,
-            CommandGetOutputTensorInfoHandler,
-            CommandSetInputTensorInfoHandler,
-            CommandSetOutputTensorInfoHandler,
-            CommandAllocateTensorHandler,
-            CommandFreeTensorHandler,
-            CommandPrepareHandler,
-            CommandInvokeHandler,
-            CommandStopHandler,
-        },
-        .module = module,
-    }
+    , queueDepth(_queueDepth)
+    , inflight(0)
+    , poolLock(PTHREAD_MUTEX_INITIALIZER)
 {
 }
 
 Inference::Runtime::impl::Async::~Async(void)
 {
-    if (context.command != nullptr) {
-        if (close(context.command->GetHandle()) < 0) {
-            ErrPrintCode(errno, "close");
-        }
+    if (outputConsumer != nullptr) {
+        outputConsumer->Destroy();
+        outputConsumer = nullptr;
+    }
 
-        delete context.command;
-        context.command = nullptr;
+    if (outputProducer != nullptr) {
+        outputProducer->Destroy();
+        outputProducer = nullptr;
     }
 
-    if (command != nullptr) {
-        if (close(command->GetHandle()) < 0) {
-            ErrPrintCode(errno, "close");
+    if (eventObject != nullptr) {
+        eventObject->Destroy();
+        eventObject = nullptr;
+    }
+
+    for (auto &arg : commandPool) {
+        delete arg;
+    }
+    commandPool.clear();
+
+    int ret = pthread_mutex_destroy(&poolLock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
+
+    ret = pthread_cond_destroy(&outputCond);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_cond_destroy");
+    }
+
+    ret = pthread_mutex_destroy(&outputLock);
+    if (ret != 0) {
+        ErrPrintCode(ret, "pthread_mutex_destroy");
+    }
+}
+
+int Inference::Runtime::impl::Async::Request(Worker *worker, int cmdId, CommandData *arg)
+{
+    MUTEX_LOCK(&worker->lock);
+    int ret = worker->command->Send(cmdId, arg);
+    if (ret < 0) {
+        MUTEX_UNLOCK(&worker->lock);
+        return ret;
+    }
+
+    int replyId = Command::IdLast;
+    void *replyData = nullptr;
+    ret = worker->command->Recv(replyId, replyData);
+    MUTEX_UNLOCK(&worker->lock);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (replyId != cmdId || replyData != arg) {
+        ErrPrint("Invalid reply: 0x%.8x (expected 0x%.8x)", replyId, cmdId);
+        assert(!"Invalid reply");
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int Inference::Runtime::impl::Async::Broadcast(int cmdId, CommandData *arg)
+{
+    if (workers.size() == 1) {
+        return Request(workers[0], cmdId, arg);
+    }
+
+    std::vector<CommandData> args;
+    try {
+        args.resize(workers.size(), *arg);
+    } catch (std::exception &e) {
+        ErrPrint("resize: %s", e.what());
+        return -ENOMEM;
+    }
+
+    // NOTE:
+    // Send the command to every worker first, and then collect the replies.
+    // So the workers run the command (e.g. LoadModel) concurrently.
+    for (auto &worker : workers) {
+        MUTEX_LOCK(&worker->lock);
+    }
+
+    int ret = 0;
+    size_t sent = 0;
+    for (; sent < workers.size(); sent++) {
+        ret = workers[sent]->command->Send(cmdId, &args[sent]);
+        if (ret < 0) {
+            ErrPrint("Unable to send a command to the worker[%zu]: %d", sent, ret);
+            break;
         }
-        delete command;
-        command = nullptr;
     }
 
-    if (context.outputProducer != nullptr) {
-        if (close(context.outputProducer->GetHandle()) < 0) {
-            ErrPrintCode(errno, "close");
+    for (size_t i = 0; i < sent; i++) {
+        int replyId = Command::IdLast;
+        void *replyData = nullptr;
+        int status = workers[i]->command->Recv(replyId, replyData);
+        if (status < 0) {
+            ret = status;
+        } else if (replyId != cmdId || replyData != &args[i]) {
+            ErrPrint("Invalid reply: 0x%.8x (expected 0x%.8x)", replyId, cmdId);
+            assert(!"Invalid reply");
+            ret = -EFAULT;
+        } else if (args[i].ret.value < 0 && arg->ret.value >= 0) {
+            // NOTE:
+            // Report the first failure of the workers
+            arg->ret = args[i].ret;
+        } else if (i == 0) {
+            arg->ret = args[i].ret;
         }
+    }
 
-        delete context.outputProducer;
-        context.outputProducer = nullptr;
+    for (auto &worker : workers) {
+        MUTEX_UNLOCK(&worker->lock);
     }
 
-    if (outputConsumer != nullptr) {
-        if (close(outputConsumer->GetHandle()) < 0) {
-            ErrPrintCode(errno, "close");
+    return ret;
+}
+
+Inference::Runtime::impl::Async::Worker *Inference::Runtime::impl::Async::SelectWorker(void)
+{
+    // NOTE:
+    // Pick the worker which has the least in-flight requests,
+    // start from the next one of the previous choice to spread the requests evenly.
+    size_t count = workers.size();
+    size_t start = nextWorker++ % count;
+    Worker *selected = workers[start];
+    int min = selected->inflight.load();
+
+    for (size_t i = 1; i < count && min > 0; i++) {
+        Worker *worker = workers[(start + i) % count];
+        int inflight = worker->inflight.load();
+        if (inflight < min) {
+            selected = worker;
+            min = inflight;
         }
+    }
 
-        delete outputConsumer;
-        outputConsumer = nullptr;
+    return selected;
+}
+
+Inference::Runtime::impl::Async::CommandData *Inference::Runtime::impl::Async::AllocCommandData(void)
+{
+    CommandData *arg = nullptr;
+
+    MUTEX_LOCK(&poolLock);
+    if (commandPool.empty() == false) {
+        arg = commandPool.back();
+        commandPool.pop_back();
     }
+    MUTEX_UNLOCK(&poolLock);
 
-    if (eventObject != nullptr) {
-        eventObject->Destroy();
-        eventObject = nullptr;
+    if (arg == nullptr) {
+        try {
+            arg = new CommandData();
+        } catch (std::exception &e) {
+            ErrPrint("new: %s", e.what());
+            return nullptr;
+        }
+    }
+
+    return arg;
+}
+
+void Inference::Runtime::impl::Async::ReleaseCommandData(CommandData *&arg)
+{
+    if (arg == nullptr) {
+        return;
     }
+
+    MUTEX_LOCK(&poolLock);
+    if (commandPool.size() < COMMAND_POOL_SIZE) {
+        try {
+            commandPool.push_back(arg);
+            arg = nullptr;
+        } catch (std::exception &e) {
+            ErrPrint("push_back: %s", e.what());
+        }
+    }
+    MUTEX_UNLOCK(&poolLock);
+
+    delete arg;
+    arg = nullptr;
 }
 
+
 int Inference::Runtime::impl::Async::Configure(const beyond_config *options)
 {
     int ret;
@@ -659,22 +804,12 @@ int Inference::Runtime::impl::Async::Configure(const beyond_config *options)
         .args = { .ptr = static_cast<void *>(const_cast<beyond_config *>(options)) }
     };
 
-    ret = command->Send(Command::IdConfigure, &arg);
+    ret = Broadcast(Command::IdConfigure, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdConfigure) {
-        return ret;
-    }
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::LoadModel(const char *model)
@@ -684,21 +819,12 @@ int Inference::Runtime::impl::Async::LoadModel(const char *model)
         .args = { .ptr = static_cast<void *>(const_cast<char *>(model)) },
     };
 
-    ret = command->Send(Command::IdLoadModel, &arg);
+    ret = Broadcast(Command::IdLoadModel, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdLoadModel) {
-        return ret;
-    }
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::GetInputTensorInfo(const beyond_tensor_info *&info, int &size)
@@ -716,27 +842,17 @@ int Inference::Runtime::impl::Async::GetInputTensorInfo(const beyond_tensor_info
         }
     };
 
-    ret = command->Send(Command::IdGetInputTensorInfo, &arg);
+    ret = Request(workers[0], Command::IdGetInputTensorInfo, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdGetInputTensorInfo) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    if (argPtr->ret.value == 0) {
-        info = argPtr->args.tensorInfo.info;
-        size = argPtr->args.tensorInfo.size;
+    if (arg.ret.value == 0) {
+        info = arg.args.tensorInfo.info;
+        size = arg.args.tensorInfo.size;
     }
 
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::GetOutputTensorInfo(const beyond_tensor_info *&info, int &size)
@@ -754,27 +870,17 @@ int Inference::Runtime::impl::Async::GetOutputTensorInfo(const beyond_tensor_inf
         }
     };
 
-    ret = command->Send(Command::IdGetOutputTensorInfo, &arg);
+    ret = Request(workers[0], Command::IdGetOutputTensorInfo, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdGetOutputTensorInfo) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    if (argPtr->ret.value == 0) {
-        info = argPtr->args.tensorInfo.info;
-        size = argPtr->args.tensorInfo.size;
+    if (arg.ret.value == 0) {
+        info = arg.args.tensorInfo.info;
+        size = arg.args.tensorInfo.size;
     }
 
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::SetInputTensorInfo(const beyond_tensor_info *info, int size)
@@ -790,22 +896,12 @@ int Inference::Runtime::impl::Async::SetInputTensorInfo(const beyond_tensor_info
         }
     };
 
-    int ret = command->Send(Command::IdSetInputTensorInfo, &arg);
+    int ret = Broadcast(Command::IdSetInputTensorInfo, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdSetInputTensorInfo) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::SetOutputTensorInfo(const beyond_tensor_info *info, int size)
@@ -821,22 +917,12 @@ int Inference::Runtime::impl::Async::SetOutputTensorInfo(const beyond_tensor_inf
         }
     };
 
-    int ret = command->Send(Command::IdSetOutputTensorInfo, &arg);
+    int ret = Broadcast(Command::IdSetOutputTensorInfo, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdSetOutputTensorInfo) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor)
@@ -848,27 +934,17 @@ int Inference::Runtime::impl::Async::AllocateTensor(const beyond_tensor_info *in
                 .size = size } },
     };
 
-    int ret = command->Send(Command::IdAllocateTensor, &arg);
+    int ret = Request(workers[0], Command::IdAllocateTensor, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdAllocateTensor) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    if (argPtr->ret.obj.value < 0) {
-        return argPtr->ret.obj.value;
+    if (arg.ret.obj.value < 0) {
+        return arg.ret.obj.value;
     }
 
-    tensor = static_cast<beyond_tensor *>(argPtr->ret.obj.ptr);
-    return argPtr->ret.obj.value;
+    tensor = static_cast<beyond_tensor *>(arg.ret.obj.ptr);
+    return arg.ret.obj.value;
 }
 
 void Inference::Runtime::impl::Async::FreeTensor(beyond_tensor *&tensor, int size)
@@ -880,26 +956,24 @@ void Inference::Runtime::impl::Async::FreeTensor(beyond_tensor *&tensor, int siz
                 .size = size } },
     };
 
-    int ret = command->Send(Command::IdFreeTensor, &arg);
-    if (ret < 0) {
-        ErrPrint("Unable to send a command: %d", ret);
-        return;
+    // NOTE:
+    // The output tensors have to be released by the worker which produced them.
+    Worker *worker = workers[0];
+    MUTEX_LOCK(&outputLock);
+    auto it = outputOwner.find(tensor);
+    if (it != outputOwner.end()) {
+        worker = it->second;
+        outputOwner.erase(it);
     }
+    MUTEX_UNLOCK(&outputLock);
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdFreeTensor) {
-        ErrPrint("Unable to recv a command: %d", ret);
+    int ret = Request(worker, Command::IdFreeTensor, &arg);
+    if (ret < 0) {
+        ErrPrint("Unable to request a command: %d", ret);
         return;
     }
 
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    if (argPtr != nullptr) {
-        DbgPrint("Waiting result: %d", argPtr->ret.value);
-    }
+    DbgPrint("Waiting result: %d", arg.ret.value);
 }
 
 int Inference::Runtime::impl::Async::Prepare(void)
@@ -909,46 +983,49 @@ int Inference::Runtime::impl::Async::Prepare(void)
             .ptr = nullptr },
     };
 
-    int ret = command->Send(Command::IdPrepare, &arg);
+    int ret = Broadcast(Command::IdPrepare, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdPrepare) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::Invoke(const beyond_tensor *input, int size, const void *context)
 {
-    CommandData *arg;
+    if (queueDepth > 0 && inflight.fetch_add(1) >= queueDepth) {
+        inflight--;
+        DbgPrint("Queue is full: %d", queueDepth);
+        return -EBUSY;
+    } else if (queueDepth == 0) {
+        inflight++;
+    }
 
-    try {
-        arg = new CommandData();
-    } catch (std::exception &e) {
-        ErrPrint("new: %s", e.what());
+    CommandData *arg = AllocCommandData();
+    if (arg == nullptr) {
+        inflight--;
         return -ENOMEM;
     }
 
     arg->args.tensor.tensor = const_cast<beyond_tensor *>(input);
     arg->args.tensor.size = size;
     arg->args.tensor.context = const_cast<void *>(context);
+    arg->ret.value = 0;
+    arg->worker = nullptr;
+
+    Worker *worker = SelectWorker();
+    worker->inflight++;
 
     // NOTE:
     // The ownership of the "arg" will be moved to the InvokeHandler
-    int ret = command->Send(Command::IdInvoke, arg);
+    MUTEX_LOCK(&worker->lock);
+    int ret = worker->command->Send(Command::IdInvoke, arg);
+    MUTEX_UNLOCK(&worker->lock);
     if (ret < 0) {
         ErrPrint("Unable to send a command: %d", ret);
-        delete arg;
-        arg = nullptr;
+        ReleaseCommandData(arg);
+        worker->inflight--;
+        inflight--;
     }
 
     // NOTE:
@@ -971,19 +1048,33 @@ int Inference::Runtime::impl::Async::GetOutput(beyond_tensor *&tensor, int &size
     assert(cmdData != nullptr);
     CommandData *arg = static_cast<CommandData *>(cmdData);
 
-    if (arg->ret.value < 0) {
-        return arg->ret.value;
+    // NOTE:
+    // The ownership of the "arg" is here.
+    // Now, give it back to the pool and clean up the resource.
+    ret = arg->ret.value;
+
+    MUTEX_LOCK(&outputLock);
+    outputQueued--;
+    int status = pthread_cond_signal(&outputCond);
+    if (status != 0) {
+        ErrPrintCode(status, "pthread_cond_signal");
     }
 
-    tensor = arg->args.tensor.tensor;
-    size = arg->args.tensor.size;
-    ret = arg->ret.value;
+    if (ret >= 0) {
+        tensor = arg->args.tensor.tensor;
+        size = arg->args.tensor.size;
 
-    // NOTE:
-    // The ownership of the "arg" is here.
-    // Now, delete it and clean up the resource.
-    delete arg;
-    arg = nullptr;
+        if (workers.size() > 1) {
+            try {
+                outputOwner[tensor] = arg->worker;
+            } catch (std::exception &e) {
+                ErrPrint("map: %s", e.what());
+            }
+        }
+    }
+    MUTEX_UNLOCK(&outputLock);
+
+    ReleaseCommandData(arg);
 
     return ret;
 }
@@ -991,22 +1082,12 @@ int Inference::Runtime::impl::Async::GetOutput(beyond_tensor *&tensor, int &size
 int Inference::Runtime::impl::Async::Stop(void)
 {
     CommandData arg = {};
-    int ret = command->Send(Command::IdStop, &arg);
+    int ret = Broadcast(Command::IdStop, &arg);
     if (ret < 0) {
         return ret;
     }
 
-    int cmdId = Command::IdLast;
-    void *cmdData = nullptr;
-    ret = command->Recv(cmdId, cmdData);
-    if (ret < 0 || cmdId != Command::IdStop) {
-        return ret;
-    }
-
-    assert(cmdData == &arg && "Invalid argument pointer");
-
-    CommandData *argPtr = static_cast<CommandData *>(cmdData);
-    return argPtr->ret.value;
+    return arg.ret.value;
 }
 
 int Inference::Runtime::impl::Async::GetHandle(void) const
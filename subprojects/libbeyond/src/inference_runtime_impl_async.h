@@ -17,13 +17,19 @@
 #ifndef __BEYOND_INTERNAL_RUNTIME_IMPL_ASYNC_H__
 #define __BEYOND_INTERNAL_RUNTIME_IMPL_ASYNC_H__
 
+#include <pthread.h>
+
+#include <atomic>
+#include <map>
+#include <vector>
+
 #include <beyond/common.h>
 
 #include <beyond/private/event_object_base_interface_private.h>
 #include <beyond/private/event_object_interface_private.h>
 #include <beyond/private/event_object_private.h>
 #include <beyond/private/event_loop_private.h>
-#include <beyond/private/command_object_private.h>
+#include <beyond/private/command_ring_object_private.h>
 #include <beyond/private/inference_interface_private.h>
 #include <beyond/private/inference_runtime_interface_private.h>
 
@@ -36,13 +42,22 @@ namespace beyond {
 // This class is going to emulate the asynchronous mode if the runtime does not support async mode.
 // Otherwise, it will just call the runtime method transparently.
 //
+// Each runtime instance is driven by its own worker thread.
+// If there are multiple instances, the Invoke() requests are spread over the workers,
+// so the input copy, the inference and the output extraction of consecutive requests can be overlapped.
+// Completions are delivered in the order of their completion, use the context to match them.
+//
 class Inference::Runtime::impl::Async : public InferenceInterface {
 public:
-    static Async *Create(InferenceInterface::RuntimeInterface *module);
+    // NOTE:
+    // Every module must be loaded from the same runtime module.
+    // The first module is used for the tensor information and the tensor allocation.
+    // queueDepth limits the number of the in-flight Invoke() requests, 0 means unlimited.
+    static Async *Create(InferenceInterface::RuntimeInterface **modules, int count, int queueDepth = 0);
     virtual void Destroy(void);
 
 private:
-    explicit Async(InferenceInterface::RuntimeInterface *module);
+    explicit Async(int queueDepth);
     virtual ~Async(void);
 
 private:
@@ -62,19 +77,23 @@ private:
 
         IdGetOutput = 0x0C,
     };
-    typedef int (*CommandHandler)(Async *moduleAsync, void *data);
-
-    static int CommandConfigureHandler(Async *moduleAsync, void *data);
-    static int CommandLoadModelHandler(Async *moduleAsync, void *data);
-    static int CommandGetInputTensorInfoHandler(Async *moduleAsync, void *data);
-    static int CommandGetOutputTensorInfoHandler(Async *moduleAsync, void *data);
-    static int CommandSetInputTensorInfoHandler(Async *moduleAsync, void *data);
-    static int CommandSetOutputTensorInfoHandler(Async *moduleAsync, void *data);
-    static int CommandAllocateTensorHandler(Async *moduleAsync, void *data);
-    static int CommandFreeTensorHandler(Async *moduleAsync, void *data);
-    static int CommandPrepareHandler(Async *moduleAsync, void *data);
-    static int CommandInvokeHandler(Async *moduleAsync, void *data);
-    static int CommandStopHandler(Async *moduleAsync, void *data);
+
+    struct Worker;
+    typedef int (*CommandHandler)(Worker *worker, void *data);
+
+    static int CommandConfigureHandler(Worker *worker, void *data);
+    static int CommandLoadModelHandler(Worker *worker, void *data);
+    static int CommandGetInputTensorInfoHandler(Worker *worker, void *data);
+    static int CommandGetOutputTensorInfoHandler(Worker *worker, void *data);
+    static int CommandSetInputTensorInfoHandler(Worker *worker, void *data);
+    static int CommandSetOutputTensorInfoHandler(Worker *worker, void *data);
+    static int CommandAllocateTensorHandler(Worker *worker, void *data);
+    static int CommandFreeTensorHandler(Worker *worker, void *data);
+    static int CommandPrepareHandler(Worker *worker, void *data);
+    static int CommandInvokeHandler(Worker *worker, void *data);
+    static int CommandStopHandler(Worker *worker, void *data);
+
+    static const CommandHandler cmdTable[Command::IdLast];
 
     static beyond_handler_return Main(EventObjectBaseInterface *obj, int type, void *data);
 
@@ -108,11 +127,6 @@ public: // EventObject interface
     int DestroyEventData(EventObjectInterface::EventData *&data) override;
 
 private:
-    CommandObject *command;
-    CommandObject *outputConsumer;
-    Inference::impl::EventObject *eventObject;
-    EventLoop::HandlerObject *handlerObject;
-
     struct CommandData {
         union Arguments {
             struct TensorInfo {
@@ -135,15 +149,58 @@ private:
                 void *ptr;
             } obj;
         } ret;
+
+        Worker *worker; // The worker which produced the output tensor
     };
 
-    struct Context {
-        CommandObject *command;
-        CommandObject *outputProducer;
-        EventLoop *eventLoop;
-        CommandHandler cmdTable[Command::IdLast];
+    struct Worker {
+        Async *owner;
         InferenceInterface::RuntimeInterface *module;
-    } context;
+        CommandRingObject *command;       // Caller side endpoint
+        CommandRingObject *workerCommand; // Worker side endpoint
+        EventLoop *eventLoop;
+        EventLoop::HandlerObject *handlerObject;
+        pthread_mutex_t lock; // The command channel is a single-producer ring, serialize the callers
+        std::atomic<int> inflight;
+    };
+
+    int CreateWorker(InferenceInterface::RuntimeInterface *module);
+    void DestroyWorker(Worker *worker);
+
+    int Request(Worker *worker, int cmdId, CommandData *arg);
+    int Broadcast(int cmdId, CommandData *arg);
+    Worker *SelectWorker(void);
+
+    // NOTE:
+    // The Invoke() does not wait for the reply, so its argument cannot live on the stack.
+    // Recycle them instead of allocating a new one for every invocation.
+    CommandData *AllocCommandData(void);
+    void ReleaseCommandData(CommandData *&arg);
+
+    std::vector<Worker *> workers;
+    unsigned int nextWorker;
+
+    // NOTE:
+    // Every worker produces the output tensors.
+    // Queueing the output and publishing its event are done under the outputLock,
+    // so the order of the events always matches the order of the queued outputs.
+    // A worker waits on the outputCond (releasing the outputLock) while the queue is full,
+    // so the output is always queued without waiting for the free slot.
+    CommandRingObject *outputProducer;
+    CommandRingObject *outputConsumer;
+    pthread_mutex_t outputLock;
+    pthread_cond_t outputCond;
+    int outputQueued; // Outputs which are not taken by the GetOutput() yet
+    bool closing;     // Destroy() is in progress, the waiting workers give up their outputs
+    std::map<beyond_tensor *, Worker *> outputOwner;
+
+    Inference::impl::EventObject *eventObject;
+
+    int queueDepth;
+    std::atomic<int> inflight;
+
+    std::vector<CommandData *> commandPool;
+    pthread_mutex_t poolLock;
 
     struct EventData : public EventObjectInterface::EventData {
     };
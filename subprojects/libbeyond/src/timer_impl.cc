@@ -79,12 +79,25 @@ Timer::impl::impl(int fd)
 {
 }
 
-int Timer::impl::SetTimer(double timer)
+int Timer::impl::SetTimer(double timer, bool repeat)
 {
     struct itimerspec spec;
 
-    spec.it_interval.tv_sec = (time_t)timer;
-    spec.it_interval.tv_nsec = (timer - spec.it_interval.tv_sec) * 1000000000;
+    if (repeat == false && timer <= 0.0) {
+        memset(&spec, 0, sizeof(spec));
+        if (timerfd_settime(GetHandle(), 0, &spec, nullptr) < 0) {
+            int ret = -errno;
+            ErrPrintCode(errno, "timerfd_settime");
+            return ret;
+        }
+
+        registeredTime = 0.0;
+        return 0;
+    }
+
+    struct timespec offset;
+    offset.tv_sec = (time_t)timer;
+    offset.tv_nsec = (timer - offset.tv_sec) * 1000000000;
 
     if (clock_gettime(CLOCK_MONOTONIC, &spec.it_value) < 0) {
         int ret = -errno;
@@ -92,8 +105,19 @@ int Timer::impl::SetTimer(double timer)
         return ret;
     }
 
-    spec.it_value.tv_sec += spec.it_interval.tv_sec;
-    spec.it_value.tv_nsec += spec.it_interval.tv_nsec;
+    spec.it_value.tv_sec += offset.tv_sec;
+    spec.it_value.tv_nsec += offset.tv_nsec;
+    if (spec.it_value.tv_nsec >= 1000000000) {
+        spec.it_value.tv_sec++;
+        spec.it_value.tv_nsec -= 1000000000;
+    }
+
+    if (repeat == true) {
+        spec.it_interval = offset;
+    } else {
+        spec.it_interval.tv_sec = 0;
+        spec.it_interval.tv_nsec = 0;
+    }
 
     if (timerfd_settime(GetHandle(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
         int ret = -errno;
@@ -102,7 +126,7 @@ int Timer::impl::SetTimer(double timer)
     }
 
     registeredTime = timer;
-    DbgPrint("Armed interval: %lu.%.9lu", spec.it_interval.tv_sec, spec.it_interval.tv_nsec);
+    DbgPrint("Armed timer: %lu.%.9lu (repeat: %d)", offset.tv_sec, offset.tv_nsec, repeat);
     return 0;
 }
 
@@ -66,9 +66,9 @@ Timer::impl::impl(int fd)
 {
 }
 
-int Timer::impl::SetTimer(double timer)
+int Timer::impl::SetTimer(double timer, bool repeat)
 {
-    DbgPrint("Armed interval: %lf", timer);
+    DbgPrint("Armed interval: %lf (repeat: %d)", timer, repeat);
     registeredTime = timer;
     return 0;
 }
@@ -29,7 +29,7 @@ public:
     static impl *Create(void);
 
     void Destroy(void) override;
-    int SetTimer(double timer) override;
+    int SetTimer(double timer, bool repeat = true) override;
     double GetTimer(void) const override;
 
 public:
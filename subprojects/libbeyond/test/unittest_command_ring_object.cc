@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+#include <beyond/private/command_ring_object_private.h>
+#include <cerrno>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define COMMAND_COUNT 100000
+
+static bool IsReadable(int fd)
+{
+    struct pollfd pfd = {
+        .fd = fd,
+        .events = POLLIN,
+        .revents = 0,
+    };
+
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN) == POLLIN;
+}
+
+TEST(CommandRingObject, NegativeCreatePair_Anytime)
+{
+    beyond::CommandRingObject *endpoint = nullptr;
+    beyond::CommandRingObject *peerEndpoint = nullptr;
+
+    EXPECT_LT(beyond::CommandRingObject::CreatePair(endpoint, peerEndpoint, 0), 0);
+    EXPECT_EQ(endpoint, nullptr);
+    EXPECT_EQ(peerEndpoint, nullptr);
+}
+
+TEST(CommandRingObject, PositiveSendRecv_Anytime)
+{
+    beyond::CommandRingObject *endpoint = nullptr;
+    beyond::CommandRingObject *peerEndpoint = nullptr;
+
+    ASSERT_EQ(beyond::CommandRingObject::CreatePair(endpoint, peerEndpoint), 0);
+    EXPECT_GE(endpoint->GetHandle(), 0);
+    EXPECT_NE(endpoint->GetHandle(), peerEndpoint->GetHandle());
+
+    int id = 0;
+    void *data = nullptr;
+    int value = 0;
+
+    // NOTE:
+    // Each endpoint receives what the other one sends
+    EXPECT_EQ(endpoint->Send(1, &value), 0);
+    EXPECT_EQ(endpoint->TryRecv(id, data), -EAGAIN);
+    EXPECT_EQ(peerEndpoint->Recv(id, data), 0);
+    EXPECT_EQ(id, 1);
+    EXPECT_EQ(data, &value);
+
+    EXPECT_EQ(peerEndpoint->Send(2), 0);
+    EXPECT_EQ(endpoint->Recv(id), 0);
+    EXPECT_EQ(id, 2);
+
+    endpoint->Destroy();
+    peerEndpoint->Destroy();
+}
+
+TEST(CommandRingObject, PositiveDoorbell_Anytime)
+{
+    beyond::CommandRingObject *endpoint = nullptr;
+    beyond::CommandRingObject *peerEndpoint = nullptr;
+
+    ASSERT_EQ(beyond::CommandRingObject::CreatePair(endpoint, peerEndpoint), 0);
+    EXPECT_FALSE(IsReadable(peerEndpoint->GetHandle()));
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(endpoint->Send(i), 0);
+    }
+
+    // NOTE:
+    // The doorbell stays readable until the ring is drained
+    int id;
+    void *data;
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(IsReadable(peerEndpoint->GetHandle()));
+        EXPECT_EQ(peerEndpoint->TryRecv(id, data), 0);
+        EXPECT_EQ(id, i);
+    }
+
+    EXPECT_EQ(peerEndpoint->TryRecv(id, data), -EAGAIN);
+    EXPECT_FALSE(IsReadable(peerEndpoint->GetHandle()));
+
+    endpoint->Destroy();
+    peerEndpoint->Destroy();
+}
+
+TEST(CommandRingObject, PositiveWrapAround_Anytime)
+{
+    beyond::CommandRingObject *endpoint = nullptr;
+    beyond::CommandRingObject *peerEndpoint = nullptr;
+
+    // NOTE:
+    // The capacity is rounded up to 4
+    ASSERT_EQ(beyond::CommandRingObject::CreatePair(endpoint, peerEndpoint, 3), 0);
+
+    int id;
+    void *data;
+    int next = 0;
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(endpoint->Send(next + i, reinterpret_cast<void *>(static_cast<intptr_t>(next + i))), 0);
+        }
+
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(peerEndpoint->TryRecv(id, data), 0);
+            EXPECT_EQ(id, next + i);
+            EXPECT_EQ(reinterpret_cast<intptr_t>(data), next + i);
+        }
+
+        EXPECT_EQ(peerEndpoint->TryRecv(id, data), -EAGAIN);
+        next += 4;
+    }
+
+    endpoint->Destroy();
+    peerEndpoint->Destroy();
+}
+
+static void *ProducerMain(void *arg)
+{
+    beyond::CommandRingObject *endpoint = static_cast<beyond::CommandRingObject *>(arg);
+    long failed = 0;
+
+    // NOTE:
+    // The ring is much smaller than the number of commands, Send() waits for the free slot
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        if (endpoint->Send(i, reinterpret_cast<void *>(static_cast<intptr_t>(i))) < 0) {
+            failed++;
+        }
+    }
+
+    return reinterpret_cast<void *>(failed);
+}
+
+TEST(CommandRingObject, PositiveProducerConsumer_Anytime)
+{
+    beyond::CommandRingObject *endpoint = nullptr;
+    beyond::CommandRingObject *peerEndpoint = nullptr;
+
+    ASSERT_EQ(beyond::CommandRingObject::CreatePair(endpoint, peerEndpoint, 8), 0);
+
+    pthread_t producer;
+    ASSERT_EQ(pthread_create(&producer, nullptr, ProducerMain, static_cast<void *>(endpoint)), 0);
+
+    int mismatched = 0;
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        int id = -1;
+        void *data = nullptr;
+
+        ASSERT_EQ(peerEndpoint->Recv(id, data), 0);
+        if (id != i || reinterpret_cast<intptr_t>(data) != i) {
+            mismatched++;
+        }
+    }
+
+    void *failed = nullptr;
+    EXPECT_EQ(pthread_join(producer, &failed), 0);
+    EXPECT_EQ(failed, nullptr);
+    EXPECT_EQ(mismatched, 0);
+
+    int id;
+    void *data;
+    EXPECT_EQ(peerEndpoint->TryRecv(id, data), -EAGAIN);
+
+    endpoint->Destroy();
+    peerEndpoint->Destroy();
+}
@@ -0,0 +1,634 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// NOTE:
+// The fake peer keeps the contexts of the invoked requests,
+// the test responds to them in the order it wants.
+class FakePeer : public beyond::InferenceInterface::PeerInterface {
+public:
+    explicit FakePeer(int tag)
+        : tag(tag)
+        , invokeResult(0)
+        , activateResult(0)
+        , activatedCount(0)
+        , freedCount(0)
+        , handler(nullptr)
+        , handlerData(nullptr)
+    {
+        pthread_mutex_init(&lock, nullptr);
+    }
+
+    ~FakePeer(void) override
+    {
+        pthread_mutex_destroy(&lock);
+    }
+
+public: // ModuleInterface
+    void Destroy(void) override
+    {
+        delete this;
+    }
+
+    const char *GetModuleName(void) const override
+    {
+        return "fake";
+    }
+
+    const char *GetModuleType(void) const override
+    {
+        return "peer";
+    }
+
+public: // PeerInterface
+    int Activate(void) override
+    {
+        pthread_mutex_lock(&lock);
+        activatedCount++;
+        int ret = activateResult;
+        pthread_mutex_unlock(&lock);
+        return ret;
+    }
+
+    int Deactivate(void) override
+    {
+        return 0;
+    }
+
+    int GetInfo(const beyond_peer_info *&info) override
+    {
+        return -ENOTSUP;
+    }
+
+    int SetInfo(beyond_peer_info *info) override
+    {
+        return -ENOTSUP;
+    }
+
+public: // InferenceInterface
+    int Configure(const beyond_config *options) override
+    {
+        return 0;
+    }
+
+    int LoadModel(const char *model) override
+    {
+        return 0;
+    }
+
+    int GetInputTensorInfo(const beyond_tensor_info *&info, int &size) override
+    {
+        return -ENOTSUP;
+    }
+
+    int GetOutputTensorInfo(const beyond_tensor_info *&info, int &size) override
+    {
+        return -ENOTSUP;
+    }
+
+    int SetInputTensorInfo(const beyond_tensor_info *info, int size) override
+    {
+        return 0;
+    }
+
+    int SetOutputTensorInfo(const beyond_tensor_info *info, int size) override
+    {
+        return 0;
+    }
+
+    int AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor) override
+    {
+        return -ENOTSUP;
+    }
+
+    void FreeTensor(beyond_tensor *&tensor, int size) override
+    {
+        pthread_mutex_lock(&lock);
+        freedCount++;
+        pthread_mutex_unlock(&lock);
+
+        free(tensor->data);
+        free(tensor);
+        tensor = nullptr;
+    }
+
+    int Prepare(void) override
+    {
+        return 0;
+    }
+
+    int Invoke(const beyond_tensor *input, int size, const void *context) override
+    {
+        pthread_mutex_lock(&lock);
+        int ret = invokeResult;
+        if (ret == 0) {
+            contexts.push_back(context);
+        }
+        pthread_mutex_unlock(&lock);
+        return ret;
+    }
+
+    int GetOutput(beyond_tensor *&tensor, int &size) override
+    {
+        pthread_mutex_lock(&lock);
+        if (outputs.empty() == true) {
+            pthread_mutex_unlock(&lock);
+            return -EAGAIN;
+        }
+
+        tensor = outputs.front();
+        outputs.erase(outputs.begin());
+        pthread_mutex_unlock(&lock);
+
+        size = 1;
+        return 0;
+    }
+
+    int Stop(void) override
+    {
+        return 0;
+    }
+
+public: // EventObjectInterface
+    int GetHandle(void) const override
+    {
+        return -1;
+    }
+
+    int AddHandler(beyond_event_handler_t handler, int type, void *data) override
+    {
+        this->handler = handler;
+        handlerData = data;
+        return 0;
+    }
+
+    int RemoveHandler(beyond_event_handler_t handler, int type, void *data) override
+    {
+        this->handler = nullptr;
+        handlerData = nullptr;
+        return 0;
+    }
+
+    int FetchEventData(EventObjectInterface::EventData *&data) override
+    {
+        return -ENOTSUP;
+    }
+
+    int DestroyEventData(EventObjectInterface::EventData *&data) override
+    {
+        return -ENOTSUP;
+    }
+
+public: // Test interface
+    void SetInvokeResult(int result)
+    {
+        pthread_mutex_lock(&lock);
+        invokeResult = result;
+        pthread_mutex_unlock(&lock);
+    }
+
+    void SetActivateResult(int result)
+    {
+        pthread_mutex_lock(&lock);
+        activateResult = result;
+        pthread_mutex_unlock(&lock);
+    }
+
+    int GetActivatedCount(void)
+    {
+        pthread_mutex_lock(&lock);
+        int count = activatedCount;
+        pthread_mutex_unlock(&lock);
+        return count;
+    }
+
+    int GetInvokeCount(void)
+    {
+        pthread_mutex_lock(&lock);
+        int count = static_cast<int>(contexts.size());
+        pthread_mutex_unlock(&lock);
+        return count;
+    }
+
+    int GetFreedCount(void)
+    {
+        pthread_mutex_lock(&lock);
+        int count = freedCount;
+        pthread_mutex_unlock(&lock);
+        return count;
+    }
+
+    // Respond to the idx-th invoked request of this peer
+    void Respond(int idx, bool success)
+    {
+        pthread_mutex_lock(&lock);
+        const void *context = contexts[idx];
+        if (success == true) {
+            beyond_tensor *tensor = static_cast<beyond_tensor *>(calloc(1, sizeof(beyond_tensor)));
+            tensor->type = BEYOND_TENSOR_TYPE_INT32;
+            tensor->size = sizeof(int);
+            tensor->data = malloc(sizeof(int));
+            *static_cast<int *>(tensor->data) = tag;
+            outputs.push_back(tensor);
+        }
+        pthread_mutex_unlock(&lock);
+
+        beyond_event_info eventInfo = {
+            .type = static_cast<int>(success == true ? BEYOND_EVENT_TYPE_INFERENCE_SUCCESS : BEYOND_EVENT_TYPE_INFERENCE_ERROR),
+            .data = const_cast<void *>(context),
+        };
+        handler(static_cast<beyond_object_h>(this), BEYOND_EVENT_TYPE_READ, &eventInfo, handlerData);
+    }
+
+private:
+    int tag;
+    int invokeResult;
+    int activateResult;
+    int activatedCount;
+    int freedCount;
+    pthread_mutex_t lock;
+    std::vector<const void *> contexts;
+    std::vector<beyond_tensor *> outputs;
+    beyond_event_handler_t handler;
+    void *handlerData;
+};
+
+static beyond::Inference *CreateDistribute(std::vector<const char *> options, std::vector<FakePeer *> &peers, int count)
+{
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(BEYOND_INFERENCE_MODE_DISTRIBUTE));
+    for (const char *option : options) {
+        argv.push_back(const_cast<char *>(option));
+    }
+    argv.push_back(nullptr);
+
+    beyond_argument arg = {
+        .argc = static_cast<int>(argv.size()) - 1,
+        .argv = argv.data(),
+    };
+
+    beyond::Inference *inference = beyond::Inference::Create(&arg);
+    if (inference == nullptr) {
+        return nullptr;
+    }
+
+    for (int i = 0; i < count; i++) {
+        FakePeer *peer = new FakePeer(i);
+        peers.push_back(peer);
+        if (inference->AddPeer(peer) < 0) {
+            inference->Destroy();
+            return nullptr;
+        }
+    }
+
+    if (inference->Prepare() < 0) {
+        inference->Destroy();
+        return nullptr;
+    }
+
+    return inference;
+}
+
+static void DestroyDistribute(beyond::Inference *inference, std::vector<FakePeer *> &peers)
+{
+    inference->Destroy();
+    for (FakePeer *peer : peers) {
+        peer->Destroy();
+    }
+    peers.clear();
+}
+
+static bool HasEvent(beyond::Inference *inference, int timeout)
+{
+    struct pollfd pfd = {
+        .fd = inference->GetHandle(),
+        .events = POLLIN,
+        .revents = 0,
+    };
+
+    return poll(&pfd, 1, timeout) == 1;
+}
+
+// Fetch the completion event and the output, returns the tag of the peer which made the output
+static int FetchCompletion(beyond::Inference *inference, const void *context, int expectedType)
+{
+    if (HasEvent(inference, 1000) == false) {
+        return -ETIMEDOUT;
+    }
+
+    beyond::EventObjectInterface::EventData *eventData = nullptr;
+    int ret = inference->FetchEventData(eventData);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int type = eventData->type & BEYOND_EVENT_TYPE_INFERENCE_MASK;
+    void *data = eventData->data;
+    inference->DestroyEventData(eventData);
+
+    if (type != expectedType || data != context) {
+        return -EINVAL;
+    }
+
+    if (type != BEYOND_EVENT_TYPE_INFERENCE_SUCCESS) {
+        return 0;
+    }
+
+    beyond_tensor *output = nullptr;
+    int size = 0;
+    ret = inference->GetOutput(output, size);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int tag = *static_cast<int *>(output->data);
+    inference->FreeTensor(output, size);
+    return tag;
+}
+
+static int WaitInvokeCount(FakePeer *peer, int count, int timeout)
+{
+    while (peer->GetInvokeCount() < count && timeout > 0) {
+        usleep(10000);
+        timeout -= 10;
+    }
+
+    return peer->GetInvokeCount();
+}
+
+TEST(InferenceDistribute, PositiveFanout_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_FANOUT, "2" }, peers, 3);
+    ASSERT_NE(inference, nullptr);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+
+    EXPECT_EQ(peers[0]->GetInvokeCount(), 1);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 1);
+    EXPECT_EQ(peers[2]->GetInvokeCount(), 0);
+
+    peers[1]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 1);
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, PositiveActivateOnPrepare_Anytime)
+{
+    const char *argv[] = { BEYOND_INFERENCE_MODE_DISTRIBUTE, BEYOND_INFERENCE_OPTION_FANOUT, "2", nullptr };
+    beyond_argument arg = {
+        .argc = 3,
+        .argv = const_cast<char **>(argv),
+    };
+
+    beyond::Inference *inference = beyond::Inference::Create(&arg);
+    ASSERT_NE(inference, nullptr);
+
+    std::vector<FakePeer *> peers;
+    for (int i = 0; i < 3; i++) {
+        FakePeer *peer = new FakePeer(i);
+        peers.push_back(peer);
+        ASSERT_EQ(inference->AddPeer(peer), 0);
+    }
+    peers[1]->SetActivateResult(-ECONNREFUSED);
+
+    // NOTE:
+    // The peers are activated by the Prepare() concurrently, not one by one when they are added
+    for (FakePeer *peer : peers) {
+        EXPECT_EQ(peer->GetActivatedCount(), 0);
+    }
+
+    ASSERT_EQ(inference->Prepare(), 0);
+    for (FakePeer *peer : peers) {
+        EXPECT_EQ(peer->GetActivatedCount(), 1);
+    }
+
+    // NOTE:
+    // The peer which is failed to activate is excluded
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    ASSERT_EQ(inference->Invoke(&input, 1, &value), 0);
+    EXPECT_EQ(peers[0]->GetInvokeCount(), 1);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 0);
+    EXPECT_EQ(peers[2]->GetInvokeCount(), 1);
+
+    peers[2]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 2);
+
+    // NOTE:
+    // It is activated again when it is prepared again
+    peers[1]->SetActivateResult(0);
+    ASSERT_EQ(inference->Prepare(), 0);
+    EXPECT_EQ(peers[0]->GetActivatedCount(), 1);
+    EXPECT_EQ(peers[1]->GetActivatedCount(), 2);
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, PositiveStragglerDiscard_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_FANOUT, "2" }, peers, 2);
+    ASSERT_NE(inference, nullptr);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+
+    peers[0]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 0);
+
+    // NOTE:
+    // The straggler output is drained from the peer and released without any event
+    peers[1]->Respond(0, true);
+    EXPECT_EQ(peers[1]->GetFreedCount(), 1);
+    EXPECT_FALSE(HasEvent(inference, 100));
+
+    beyond_tensor *output = nullptr;
+    int size = 0;
+    EXPECT_EQ(inference->GetOutput(output, size), -EAGAIN);
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, PositiveRetry_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_FANOUT, "1" }, peers, 2);
+    ASSERT_NE(inference, nullptr);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+
+    EXPECT_EQ(peers[0]->GetInvokeCount(), 1);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 0);
+
+    // NOTE:
+    // The failed request is retried with the peer which is not tried yet
+    peers[0]->Respond(0, false);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 1);
+    EXPECT_FALSE(HasEvent(inference, 0));
+
+    peers[1]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 1);
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, PositiveRetryInvokeFailure_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_FANOUT, "1" }, peers, 2);
+    ASSERT_NE(inference, nullptr);
+
+    peers[0]->SetInvokeResult(-EIO);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 1);
+
+    peers[1]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 1);
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, NegativeRetryExhausted_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_FANOUT, "1" }, peers, 2);
+    ASSERT_NE(inference, nullptr);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+
+    peers[0]->Respond(0, false);
+    peers[1]->Respond(0, false);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_ERROR), 0);
+
+    // NOTE:
+    // The request which is not accepted by any peer is failed synchronously without any event
+    peers[0]->SetInvokeResult(-EIO);
+    peers[1]->SetInvokeResult(-EIO);
+    ret = inference->Invoke(&input, 1, &value);
+    EXPECT_EQ(ret, -EIO);
+    EXPECT_FALSE(HasEvent(inference, 100));
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, PositiveHedge_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_HEDGE, "50" }, peers, 2);
+    ASSERT_NE(inference, nullptr);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+
+    EXPECT_EQ(peers[0]->GetInvokeCount(), 1);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 0);
+
+    // NOTE:
+    // The slow request is hedged to the other peer by the timer
+    EXPECT_EQ(WaitInvokeCount(peers[1], 1, 2000), 1);
+
+    peers[1]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 1);
+
+    peers[0]->Respond(0, true);
+    EXPECT_EQ(peers[0]->GetFreedCount(), 1);
+    EXPECT_FALSE(HasEvent(inference, 100));
+
+    DestroyDistribute(inference, peers);
+}
+
+TEST(InferenceDistribute, PositiveHedgeNotFired_Anytime)
+{
+    std::vector<FakePeer *> peers;
+    beyond::Inference *inference = CreateDistribute({ BEYOND_INFERENCE_OPTION_HEDGE, "50" }, peers, 2);
+    ASSERT_NE(inference, nullptr);
+
+    int value = 0;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+    int ret = inference->Invoke(&input, 1, &value);
+    ASSERT_EQ(ret, 0);
+
+    // NOTE:
+    // The request which is completed in time is never hedged
+    peers[0]->Respond(0, true);
+    EXPECT_EQ(FetchCompletion(inference, &value, BEYOND_EVENT_TYPE_INFERENCE_SUCCESS), 0);
+
+    usleep(300000);
+    EXPECT_EQ(peers[1]->GetInvokeCount(), 0);
+
+    DestroyDistribute(inference, peers);
+}
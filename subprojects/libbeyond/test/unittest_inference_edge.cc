@@ -0,0 +1,527 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// NOTE:
+// They follow the exploration of the edge mode (inference_impl_edge.cc)
+#define EDGE_EXPLORE_SAMPLES 8
+#define EDGE_EXPLORE_INTERVAL 1000
+
+// NOTE:
+// The fake module keeps the loaded models and the contexts of the invoked requests,
+// the test completes the requests in the order it wants.
+template <typename Interface>
+class EdgeFakeModule : public Interface {
+public:
+    explicit EdgeFakeModule(int tag)
+        : tag(tag)
+        , handler(nullptr)
+        , handlerData(nullptr)
+    {
+        pthread_mutex_init(&lock, nullptr);
+    }
+
+    ~EdgeFakeModule(void) override
+    {
+        pthread_mutex_destroy(&lock);
+    }
+
+public: // ModuleInterface
+    void Destroy(void) override
+    {
+        delete this;
+    }
+
+    const char *GetModuleName(void) const override
+    {
+        return "fake";
+    }
+
+public: // InferenceInterface
+    int Configure(const beyond_config *options) override
+    {
+        return 0;
+    }
+
+    int LoadModel(const char *model) override
+    {
+        pthread_mutex_lock(&lock);
+        loaded.push_back(std::string(model));
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    int GetInputTensorInfo(const beyond_tensor_info *&info, int &size) override
+    {
+        return -ENOTSUP;
+    }
+
+    int GetOutputTensorInfo(const beyond_tensor_info *&info, int &size) override
+    {
+        return -ENOTSUP;
+    }
+
+    int SetInputTensorInfo(const beyond_tensor_info *info, int size) override
+    {
+        return 0;
+    }
+
+    int SetOutputTensorInfo(const beyond_tensor_info *info, int size) override
+    {
+        return 0;
+    }
+
+    int AllocateTensor(const beyond_tensor_info *info, int size, beyond_tensor *&tensor) override
+    {
+        return -ENOTSUP;
+    }
+
+    void FreeTensor(beyond_tensor *&tensor, int size) override
+    {
+        free(tensor->data);
+        free(tensor);
+        tensor = nullptr;
+    }
+
+    int Prepare(void) override
+    {
+        return 0;
+    }
+
+    int Invoke(const beyond_tensor *input, int size, const void *context) override
+    {
+        pthread_mutex_lock(&lock);
+        contexts.push_back(context);
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    int GetOutput(beyond_tensor *&tensor, int &size) override
+    {
+        pthread_mutex_lock(&lock);
+        if (outputs.empty() == true) {
+            pthread_mutex_unlock(&lock);
+            return -EAGAIN;
+        }
+
+        tensor = outputs.front();
+        outputs.erase(outputs.begin());
+        pthread_mutex_unlock(&lock);
+
+        size = 1;
+        return 0;
+    }
+
+    int Stop(void) override
+    {
+        return 0;
+    }
+
+public: // EventObjectInterface
+    int GetHandle(void) const override
+    {
+        return -1;
+    }
+
+    int AddHandler(beyond_event_handler_t handler, int type, void *data) override
+    {
+        this->handler = handler;
+        handlerData = data;
+        return 0;
+    }
+
+    int RemoveHandler(beyond_event_handler_t handler, int type, void *data) override
+    {
+        this->handler = nullptr;
+        handlerData = nullptr;
+        return 0;
+    }
+
+    int FetchEventData(beyond::EventObjectInterface::EventData *&data) override
+    {
+        return -ENOTSUP;
+    }
+
+    int DestroyEventData(beyond::EventObjectInterface::EventData *&data) override
+    {
+        return -ENOTSUP;
+    }
+
+public: // Test interface
+    int GetInvokeCount(void)
+    {
+        pthread_mutex_lock(&lock);
+        int count = static_cast<int>(contexts.size());
+        pthread_mutex_unlock(&lock);
+        return count;
+    }
+
+    std::vector<std::string> GetLoaded(void)
+    {
+        pthread_mutex_lock(&lock);
+        std::vector<std::string> _loaded = loaded;
+        pthread_mutex_unlock(&lock);
+        return _loaded;
+    }
+
+    // Complete the idx-th invoked request of this module
+    void Respond(int idx)
+    {
+        pthread_mutex_lock(&lock);
+        const void *context = contexts[idx];
+        beyond_tensor *tensor = static_cast<beyond_tensor *>(calloc(1, sizeof(beyond_tensor)));
+        tensor->type = BEYOND_TENSOR_TYPE_INT32;
+        tensor->size = sizeof(int);
+        tensor->data = malloc(sizeof(int));
+        *static_cast<int *>(tensor->data) = tag;
+        outputs.push_back(tensor);
+        pthread_mutex_unlock(&lock);
+
+        beyond_event_info eventInfo = {
+            .type = static_cast<int>(BEYOND_EVENT_TYPE_INFERENCE_SUCCESS),
+            .data = const_cast<void *>(context),
+        };
+        handler(static_cast<beyond_object_h>(this), BEYOND_EVENT_TYPE_READ, &eventInfo, handlerData);
+    }
+
+private:
+    int tag;
+    pthread_mutex_t lock;
+    std::vector<std::string> loaded;
+    std::vector<const void *> contexts;
+    std::vector<beyond_tensor *> outputs;
+    beyond_event_handler_t handler;
+    void *handlerData;
+};
+
+class EdgeFakeRuntime : public EdgeFakeModule<beyond::InferenceInterface::RuntimeInterface> {
+public:
+    EdgeFakeRuntime(void)
+        : EdgeFakeModule(0)
+        , splitResult(0)
+    {
+    }
+
+    const char *GetModuleType(void) const override
+    {
+        return beyond::ModuleInterface::TYPE_RUNTIME;
+    }
+
+    int SplitModel(const char *model, std::vector<std::string> &models) override
+    {
+        if (splitResult < 0) {
+            return splitResult;
+        }
+
+        models.push_back(std::string("head_0_") + model);
+        models.push_back(std::string("tail_0_") + model);
+        models.push_back(std::string("head_1_") + model);
+        models.push_back(std::string("tail_1_") + model);
+        return 0;
+    }
+
+    int splitResult;
+};
+
+class EdgeFakePeer : public EdgeFakeModule<beyond::InferenceInterface::PeerInterface> {
+public:
+    EdgeFakePeer(void)
+        : EdgeFakeModule(1)
+    {
+    }
+
+    const char *GetModuleType(void) const override
+    {
+        return "peer";
+    }
+
+    int Activate(void) override
+    {
+        return 0;
+    }
+
+    int Deactivate(void) override
+    {
+        return 0;
+    }
+
+    int GetInfo(const beyond_peer_info *&info) override
+    {
+        return -ENOTSUP;
+    }
+
+    int SetInfo(beyond_peer_info *info) override
+    {
+        return -ENOTSUP;
+    }
+};
+
+static beyond::Inference *CreateEdge(bool autoSplit, EdgeFakeRuntime *runtime, EdgeFakePeer *peer)
+{
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(BEYOND_INFERENCE_MODE_EDGE));
+    if (autoSplit == true) {
+        argv.push_back(const_cast<char *>(BEYOND_INFERENCE_OPTION_AUTO_SPLIT));
+    }
+    argv.push_back(nullptr);
+
+    beyond_argument arg = {
+        .argc = static_cast<int>(argv.size()) - 1,
+        .argv = argv.data(),
+    };
+
+    beyond::Inference *inference = beyond::Inference::Create(&arg);
+    if (inference == nullptr) {
+        return nullptr;
+    }
+
+    if (inference->AddRuntime(runtime) < 0 || inference->AddPeer(peer) < 0) {
+        inference->Destroy();
+        return nullptr;
+    }
+
+    return inference;
+}
+
+static int WaitInvokeCount(EdgeFakeRuntime *runtime, int count, int timeout)
+{
+    while (runtime->GetInvokeCount() < count && timeout > 0) {
+        usleep(1000);
+        timeout -= 1;
+    }
+
+    return runtime->GetInvokeCount();
+}
+
+// Run a request through the head and the tail, the delays are the latencies of the stages in milliseconds.
+// Returns the tag of the module which made the output.
+static int RunRequest(beyond::Inference *inference, EdgeFakeRuntime *runtime, EdgeFakePeer *peer, int idx, int headDelay, int tailDelay)
+{
+    int value = idx;
+    beyond_tensor input = {
+        .type = BEYOND_TENSOR_TYPE_INT32,
+        .size = sizeof(value),
+        .data = &value,
+    };
+
+    int ret = inference->Invoke(&input, 1, &value);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // NOTE:
+    // The request is queued while the edge mode is switching the candidate
+    if (WaitInvokeCount(runtime, idx + 1, 1000) != idx + 1) {
+        return -ETIMEDOUT;
+    }
+
+    usleep(headDelay * 1000);
+    runtime->Respond(idx);
+
+    if (peer->GetInvokeCount() != idx + 1) {
+        return -EFAULT;
+    }
+
+    usleep(tailDelay * 1000);
+    peer->Respond(idx);
+
+    struct pollfd pfd = {
+        .fd = inference->GetHandle(),
+        .events = POLLIN,
+        .revents = 0,
+    };
+    if (poll(&pfd, 1, 1000) != 1) {
+        return -ETIMEDOUT;
+    }
+
+    beyond::EventObjectInterface::EventData *eventData = nullptr;
+    ret = inference->FetchEventData(eventData);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int type = eventData->type & BEYOND_EVENT_TYPE_INFERENCE_MASK;
+    void *data = eventData->data;
+    inference->DestroyEventData(eventData);
+    if (type != BEYOND_EVENT_TYPE_INFERENCE_SUCCESS || data != &value) {
+        return -EINVAL;
+    }
+
+    beyond_tensor *output = nullptr;
+    int size = 0;
+    ret = inference->GetOutput(output, size);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int tag = *static_cast<int *>(output->data);
+    inference->FreeTensor(output, size);
+    return tag;
+}
+
+TEST(InferenceEdge, PositiveSplitModel_Anytime)
+{
+    EdgeFakeRuntime *runtime = new EdgeFakeRuntime();
+    EdgeFakePeer *peer = new EdgeFakePeer();
+    beyond::Inference *inference = CreateEdge(false, runtime, peer);
+    ASSERT_NE(inference, nullptr);
+
+    const char *model = "model.tflite";
+    ASSERT_EQ(inference->LoadModel(&model, 1), 0);
+    ASSERT_EQ(inference->Prepare(), 0);
+
+    // NOTE:
+    // Without the auto split option, the first candidate is used
+    ASSERT_EQ(runtime->GetLoaded().size(), 1u);
+    EXPECT_EQ(runtime->GetLoaded()[0], "head_0_model.tflite");
+    ASSERT_EQ(peer->GetLoaded().size(), 1u);
+    EXPECT_EQ(peer->GetLoaded()[0], "tail_0_model.tflite");
+
+    EXPECT_EQ(RunRequest(inference, runtime, peer, 0, 0, 0), 1);
+
+    inference->Destroy();
+    runtime->Destroy();
+    peer->Destroy();
+}
+
+TEST(InferenceEdge, NegativeSplitModel_Anytime)
+{
+    EdgeFakeRuntime *runtime = new EdgeFakeRuntime();
+    EdgeFakePeer *peer = new EdgeFakePeer();
+    beyond::Inference *inference = CreateEdge(true, runtime, peer);
+    ASSERT_NE(inference, nullptr);
+
+    runtime->splitResult = -ENOTSUP;
+    const char *model = "model.tflite";
+    ASSERT_EQ(inference->LoadModel(&model, 1), 0);
+    EXPECT_EQ(inference->Prepare(), -ENOTSUP);
+    EXPECT_TRUE(runtime->GetLoaded().empty());
+    EXPECT_TRUE(peer->GetLoaded().empty());
+
+    inference->Destroy();
+    runtime->Destroy();
+    peer->Destroy();
+}
+
+TEST(InferenceEdge, NegativeLoadModel_Anytime)
+{
+    EdgeFakeRuntime *runtime = new EdgeFakeRuntime();
+    EdgeFakePeer *peer = new EdgeFakePeer();
+    beyond::Inference *inference = CreateEdge(true, runtime, peer);
+    ASSERT_NE(inference, nullptr);
+
+    const char *models[] = { "head_0.tflite", "tail_0.tflite", "head_1.tflite" };
+    EXPECT_EQ(inference->LoadModel(models, 3), -EINVAL);
+
+    inference->Destroy();
+    runtime->Destroy();
+    peer->Destroy();
+}
+
+// NOTE:
+// Every candidate is loaded once for measuring it,
+// and the periodic measurement does not load the inactive candidates again.
+TEST(InferenceEdge, PositiveExploreOnce_Anytime)
+{
+    EdgeFakeRuntime *runtime = new EdgeFakeRuntime();
+    EdgeFakePeer *peer = new EdgeFakePeer();
+    beyond::Inference *inference = CreateEdge(true, runtime, peer);
+    ASSERT_NE(inference, nullptr);
+
+    const char *models[] = { "head_0.tflite", "tail_0.tflite", "head_1.tflite", "tail_1.tflite" };
+    ASSERT_EQ(inference->LoadModel(models, 4), 0);
+    ASSERT_EQ(inference->Prepare(), 0);
+
+    // The candidate 0 sends a large intermediate tensor over a slow link
+    int idx = 0;
+    for (; idx < EDGE_EXPLORE_SAMPLES * 2; idx++) {
+        bool first = (idx < EDGE_EXPLORE_SAMPLES);
+        ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 0, first == true ? 20 : 0), 1);
+    }
+
+    for (; idx < EDGE_EXPLORE_SAMPLES * 2 + EDGE_EXPLORE_INTERVAL * 2; idx++) {
+        ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 0, 0), 1);
+    }
+
+    std::vector<std::string> loaded = runtime->GetLoaded();
+    ASSERT_EQ(loaded.size(), 2u);
+    EXPECT_EQ(loaded[0], "head_0.tflite");
+    EXPECT_EQ(loaded[1], "head_1.tflite");
+    EXPECT_EQ(peer->GetLoaded().size(), 2u);
+
+    inference->Destroy();
+    runtime->Destroy();
+    peer->Destroy();
+}
+
+// NOTE:
+// The local load is increased, the head of the active candidate gets slower.
+// The inactive candidate which runs the smaller head is estimated faster, it is activated again.
+TEST(InferenceEdge, PositiveReestimate_Anytime)
+{
+    EdgeFakeRuntime *runtime = new EdgeFakeRuntime();
+    EdgeFakePeer *peer = new EdgeFakePeer();
+    beyond::Inference *inference = CreateEdge(true, runtime, peer);
+    ASSERT_NE(inference, nullptr);
+
+    const char *models[] = { "head_0.tflite", "tail_0.tflite", "head_1.tflite", "tail_1.tflite" };
+    ASSERT_EQ(inference->LoadModel(models, 4), 0);
+    ASSERT_EQ(inference->Prepare(), 0);
+
+    int idx = 0;
+    for (; idx < EDGE_EXPLORE_SAMPLES; idx++) {
+        ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 0, 20), 1);
+    }
+
+    for (; idx < EDGE_EXPLORE_SAMPLES * 2; idx++) {
+        ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 10, 5), 1);
+    }
+
+    // The candidate 1 is selected, the latest requests of the interval are measured
+    int measuring = EDGE_EXPLORE_SAMPLES * 2 + EDGE_EXPLORE_INTERVAL - EDGE_EXPLORE_SAMPLES * 2;
+    for (; idx < measuring; idx++) {
+        ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 0, 0), 1);
+    }
+
+    for (; idx < EDGE_EXPLORE_SAMPLES * 2 + EDGE_EXPLORE_INTERVAL; idx++) {
+        ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 40, 5), 1);
+    }
+    EXPECT_EQ(runtime->GetLoaded().size(), 2u);
+
+    // The next request is sent after switching the candidate
+    ASSERT_EQ(RunRequest(inference, runtime, peer, idx, 0, 0), 1);
+
+    std::vector<std::string> loaded = runtime->GetLoaded();
+    ASSERT_EQ(loaded.size(), 3u);
+    EXPECT_EQ(loaded[2], "head_0.tflite");
+    ASSERT_EQ(peer->GetLoaded().size(), 3u);
+    EXPECT_EQ(peer->GetLoaded()[2], "tail_0.tflite");
+
+    inference->Destroy();
+    runtime->Destroy();
+    peer->Destroy();
+}
@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2021 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <beyond/platform/beyond_platform.h>
+#include <beyond/private/beyond_private.h>
+#include <cerrno>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "inference_impl.h"
+#include "inference_impl_latency.h"
+#include "inference_impl_fanout.h"
+#include "inference_impl_remote.h"
+
+namespace beyond {
+
+// NOTE:
+// The implementation classes are nested in the private Inference::impl,
+// the test reaches them through this hook which is a friend of them.
+class InferenceImplTest {
+public:
+    using LatencyEstimator = Inference::impl::LatencyEstimator;
+    using Fanout = Inference::impl::Fanout;
+    using Remote = Inference::impl::remote;
+    using PeerContext = Inference::impl::remote::PeerContext;
+    using Request = Inference::impl::remote::Request;
+
+    static PeerContext *AddPeerContext(Remote *remote, bool prepared)
+    {
+        PeerContext *peerCtx = new PeerContext();
+
+        peerCtx->owner = remote;
+        peerCtx->peer = nullptr;
+        peerCtx->advertised = 0.0;
+        peerCtx->baseline = 0.0;
+        peerCtx->prepared = prepared;
+        peerCtx->inflight = 0;
+
+        remote->peerVector.push_back(peerCtx);
+        return peerCtx;
+    }
+
+    static void DestroyRemote(Remote *remote)
+    {
+        // NOTE:
+        // The contexts have no peer object, they are not removed by Destroy()
+        for (PeerContext *peerCtx : remote->peerVector) {
+            delete peerCtx;
+        }
+        remote->peerVector.clear();
+        remote->Destroy();
+    }
+
+    static PeerContext *SelectPeer(Remote *remote)
+    {
+        return remote->SelectPeer();
+    }
+
+    static double GetExpectedCompletion(Remote *remote, const PeerContext *peerCtx)
+    {
+        return remote->GetExpectedCompletion(peerCtx);
+    }
+
+    static double GetAdvertisedCompletion(const beyond_peer_info *info)
+    {
+        return Remote::GetAdvertisedCompletion(info);
+    }
+
+    static void CompleteRequest(Remote *remote, Request *request, int eventType)
+    {
+        remote->CompleteRequest(request, eventType);
+    }
+
+    static size_t GetCompletedCount(Remote *remote)
+    {
+        return remote->completedMap.size();
+    }
+
+    static unsigned long long GetDeliverSequence(Remote *remote)
+    {
+        return remote->deliverSequence;
+    }
+};
+
+} // namespace beyond
+
+using LatencyEstimator = beyond::InferenceImplTest::LatencyEstimator;
+using Fanout = beyond::InferenceImplTest::Fanout;
+using Remote = beyond::InferenceImplTest::Remote;
+using PeerContext = beyond::InferenceImplTest::PeerContext;
+using Request = beyond::InferenceImplTest::Request;
+using InferenceImplTest = beyond::InferenceImplTest;
+
+TEST(LatencyEstimator, PositiveUpdate_Anytime)
+{
+    LatencyEstimator latency;
+
+    EXPECT_EQ(latency.GetCount(), 0);
+    EXPECT_DOUBLE_EQ(latency.GetAverage(), 0.0);
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(50), 0.0);
+
+    latency.Update(0.1);
+    EXPECT_EQ(latency.GetCount(), 1);
+    EXPECT_DOUBLE_EQ(latency.GetAverage(), 0.1);
+
+    latency.Update(0.2);
+    EXPECT_EQ(latency.GetCount(), 2);
+    EXPECT_GT(latency.GetAverage(), 0.1);
+    EXPECT_LT(latency.GetAverage(), 0.2);
+}
+
+TEST(LatencyEstimator, NegativeUpdate_Anytime)
+{
+    LatencyEstimator latency;
+
+    latency.Update(-1.0);
+    EXPECT_EQ(latency.GetCount(), 0);
+    EXPECT_DOUBLE_EQ(latency.GetAverage(), 0.0);
+}
+
+TEST(LatencyEstimator, PositivePercentile_Anytime)
+{
+    LatencyEstimator latency;
+
+    for (int i = 1; i <= 10; i++) {
+        latency.Update(static_cast<double>(i));
+    }
+
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(0), 1.0);
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(50), 5.0);
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(100), 10.0);
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(200), 10.0);
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(-1), 1.0);
+}
+
+TEST(LatencyEstimator, PositivePercentileWindow_Anytime)
+{
+    LatencyEstimator latency;
+
+    for (int i = 0; i < LatencyEstimator::WINDOW_SIZE; i++) {
+        latency.Update(100.0);
+    }
+
+    // NOTE:
+    // The old samples are replaced by the new ones
+    for (int i = 0; i < LatencyEstimator::WINDOW_SIZE; i++) {
+        latency.Update(1.0);
+    }
+
+    EXPECT_EQ(latency.GetCount(), LatencyEstimator::WINDOW_SIZE);
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(100), 1.0);
+}
+
+TEST(LatencyEstimator, PositivePenalize_Anytime)
+{
+    LatencyEstimator latency;
+
+    latency.Update(0.1);
+    latency.Penalize();
+    EXPECT_DOUBLE_EQ(latency.GetAverage(), 0.2);
+
+    // NOTE:
+    // The samples are not penalized
+    EXPECT_DOUBLE_EQ(latency.GetPercentile(100), 0.1);
+}
+
+TEST(LatencyEstimator, PositivePenalizeWithoutSample_Anytime)
+{
+    LatencyEstimator failed;
+    LatencyEstimator measured;
+
+    // NOTE:
+    // The peer which has never succeeded must not be ranked before the measured one
+    failed.Penalize();
+    measured.Update(0.05);
+    EXPECT_GT(failed.GetAverage(), measured.GetAverage());
+
+    double average = failed.GetAverage();
+    failed.Penalize();
+    EXPECT_GT(failed.GetAverage(), average);
+
+    // NOTE:
+    // The first successful sample replaces the penalty
+    failed.Update(0.01);
+    EXPECT_DOUBLE_EQ(failed.GetAverage(), 0.01);
+}
+
+TEST(LatencyEstimator, PositiveReset_Anytime)
+{
+    LatencyEstimator latency;
+
+    latency.Update(0.1);
+    latency.Penalize();
+    latency.Reset();
+    EXPECT_EQ(latency.GetCount(), 0);
+    EXPECT_DOUBLE_EQ(latency.GetAverage(), 0.0);
+}
+
+TEST(LatencyEstimator, PositiveTimestamp_Anytime)
+{
+    double before = LatencyEstimator::GetTimestamp();
+    usleep(1000);
+    double after = LatencyEstimator::GetTimestamp();
+
+    EXPECT_GT(before, 0.0);
+    EXPECT_GT(after, before);
+}
+
+TEST(Fanout, PositiveRunEmpty_Anytime)
+{
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<int> results;
+
+    Fanout::Run(jobs, results);
+    EXPECT_TRUE(results.empty());
+}
+
+TEST(Fanout, PositiveRunResults_Anytime)
+{
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<int> results;
+
+    // NOTE:
+    // More jobs than the MAX_CONCURRENCY, they are run by batches
+    int count = Fanout::MAX_CONCURRENCY * 2 + 3;
+    for (int i = 0; i < count; i++) {
+        jobs.push_back([i](void) -> int {
+            return i % 2 == 0 ? i : -i;
+        });
+    }
+
+    Fanout::Run(jobs, results);
+    ASSERT_EQ(results.size(), static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(results[i], i % 2 == 0 ? i : -i);
+    }
+}
+
+TEST(Fanout, PositiveRunConcurrently_Anytime)
+{
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<int> results;
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+    pthread_t caller = pthread_self();
+    std::atomic<int> onCaller(0);
+
+    for (int i = 0; i < 4; i++) {
+        jobs.push_back([&](void) -> int {
+            if (pthread_equal(pthread_self(), caller) != 0) {
+                onCaller++;
+            }
+
+            int now = ++running;
+            int prev = peak.load();
+            while (now > prev && peak.compare_exchange_weak(prev, now) == false) {
+            }
+
+            usleep(50000);
+            running--;
+            return 0;
+        });
+    }
+
+    double startedAt = LatencyEstimator::GetTimestamp();
+    Fanout::Run(jobs, results);
+    double elapsed = LatencyEstimator::GetTimestamp() - startedAt;
+
+    EXPECT_EQ(onCaller.load(), 0);
+    EXPECT_GT(peak.load(), 1);
+    // NOTE:
+    // As long as the slowest one, not the sum of them
+    EXPECT_LT(elapsed, 0.05 * 4);
+    for (int result : results) {
+        EXPECT_EQ(result, 0);
+    }
+}
+
+TEST(Fanout, PositiveRunSingleOnCaller_Anytime)
+{
+    std::vector<std::function<int(void)>> jobs;
+    std::vector<int> results;
+    pthread_t caller = pthread_self();
+
+    jobs.push_back([caller](void) -> int {
+        return pthread_equal(pthread_self(), caller) != 0 ? 0 : -EINVAL;
+    });
+
+    Fanout::Run(jobs, results);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0], 0);
+}
+
+TEST(Remote, NegativeCreate_Anytime)
+{
+    EXPECT_EQ(Remote::Create(false, "unknown"), nullptr);
+    EXPECT_EQ(Remote::Create(false, nullptr, -1), nullptr);
+}
+
+TEST(Remote, PositiveSelectPeerRoundRobin_Anytime)
+{
+    Remote *remote = Remote::Create(false, BEYOND_INFERENCE_BALANCE_ROUND_ROBIN);
+    ASSERT_NE(remote, nullptr);
+
+    PeerContext *first = InferenceImplTest::AddPeerContext(remote, true);
+    (void)InferenceImplTest::AddPeerContext(remote, false);
+    PeerContext *third = InferenceImplTest::AddPeerContext(remote, true);
+
+    // NOTE:
+    // The unprepared peer is skipped
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), first);
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), third);
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), first);
+
+    InferenceImplTest::DestroyRemote(remote);
+}
+
+TEST(Remote, PositiveSelectPeerLatency_Anytime)
+{
+    Remote *remote = Remote::Create(false, BEYOND_INFERENCE_BALANCE_LATENCY);
+    ASSERT_NE(remote, nullptr);
+
+    PeerContext *fast = InferenceImplTest::AddPeerContext(remote, true);
+    PeerContext *slow = InferenceImplTest::AddPeerContext(remote, true);
+
+    fast->latency.Update(0.01);
+    slow->latency.Update(0.03);
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), fast);
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), fast);
+
+    // NOTE:
+    // The queued requests on the fast peer make the slow one better
+    fast->inflight = 3;
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), slow);
+
+    InferenceImplTest::DestroyRemote(remote);
+}
+
+TEST(Remote, PositiveSelectPeerProbeAndAdvertised_Anytime)
+{
+    Remote *remote = Remote::Create(false, BEYOND_INFERENCE_BALANCE_LATENCY);
+    ASSERT_NE(remote, nullptr);
+
+    PeerContext *measured = InferenceImplTest::AddPeerContext(remote, true);
+    PeerContext *probed = InferenceImplTest::AddPeerContext(remote, true);
+    PeerContext *advertised = InferenceImplTest::AddPeerContext(remote, true);
+
+    measured->latency.Update(0.05);
+    probed->probe.Update(0.03);
+    advertised->advertised = 0.02;
+
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetExpectedCompletion(remote, measured), 0.05);
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetExpectedCompletion(remote, probed), 0.03);
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetExpectedCompletion(remote, advertised), 0.02);
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), advertised);
+
+    InferenceImplTest::DestroyRemote(remote);
+}
+
+TEST(Remote, PositiveSelectPeerLeastOutstanding_Anytime)
+{
+    Remote *remote = Remote::Create(false, BEYOND_INFERENCE_BALANCE_LEAST_OUTSTANDING);
+    ASSERT_NE(remote, nullptr);
+
+    PeerContext *busy = InferenceImplTest::AddPeerContext(remote, true);
+    PeerContext *idle = InferenceImplTest::AddPeerContext(remote, true);
+
+    busy->latency.Update(0.001);
+    busy->inflight = 2;
+    idle->latency.Update(1.0);
+    idle->inflight = 1;
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), idle);
+
+    InferenceImplTest::DestroyRemote(remote);
+}
+
+TEST(Remote, PositiveSelectPeerInflightLimit_Anytime)
+{
+    Remote *remote = Remote::Create(false, BEYOND_INFERENCE_BALANCE_ROUND_ROBIN, 2);
+    ASSERT_NE(remote, nullptr);
+
+    PeerContext *first = InferenceImplTest::AddPeerContext(remote, true);
+    PeerContext *second = InferenceImplTest::AddPeerContext(remote, true);
+
+    first->inflight = 2;
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), second);
+
+    second->inflight = 2;
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), nullptr);
+
+    first->inflight = 1;
+    EXPECT_EQ(InferenceImplTest::SelectPeer(remote), first);
+
+    InferenceImplTest::DestroyRemote(remote);
+}
+
+TEST(Remote, PositiveAdvertisedCompletion_Anytime)
+{
+    beyond_peer_info info = {};
+
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetAdvertisedCompletion(&info), 0.0);
+
+    info.latency = 20000;
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetAdvertisedCompletion(&info), 0.02);
+
+    info.queue_depth = 4;
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetAdvertisedCompletion(&info), 0.1);
+
+    info.queue_depth = -1;
+    EXPECT_DOUBLE_EQ(InferenceImplTest::GetAdvertisedCompletion(&info), 0.02);
+}
+
+TEST(Remote, PositiveOrderedCompletion_Anytime)
+{
+    Remote *remote = Remote::Create(false, nullptr, 0, true);
+    ASSERT_NE(remote, nullptr);
+
+    int contexts[3] = { 0, 1, 2 };
+    Request *requests[3];
+    for (int i = 0; i < 3; i++) {
+        requests[i] = new Request();
+        requests[i]->context = &contexts[i];
+        requests[i]->sequence = i;
+        requests[i]->hasOutput = false;
+    }
+
+    // NOTE:
+    // The later requests are held until the first one is completed
+    InferenceImplTest::CompleteRequest(remote, requests[2], BEYOND_EVENT_TYPE_INFERENCE_SUCCESS);
+    InferenceImplTest::CompleteRequest(remote, requests[1], BEYOND_EVENT_TYPE_INFERENCE_ERROR);
+    EXPECT_EQ(InferenceImplTest::GetCompletedCount(remote), 2u);
+    EXPECT_EQ(InferenceImplTest::GetDeliverSequence(remote), 0u);
+
+    InferenceImplTest::CompleteRequest(remote, requests[0], BEYOND_EVENT_TYPE_INFERENCE_SUCCESS);
+    EXPECT_EQ(InferenceImplTest::GetCompletedCount(remote), 0u);
+    EXPECT_EQ(InferenceImplTest::GetDeliverSequence(remote), 3u);
+
+    int types[3] = {
+        BEYOND_EVENT_TYPE_INFERENCE_SUCCESS,
+        BEYOND_EVENT_TYPE_INFERENCE_ERROR,
+        BEYOND_EVENT_TYPE_INFERENCE_SUCCESS,
+    };
+    for (int i = 0; i < 3; i++) {
+        beyond::EventObjectInterface::EventData *eventData = nullptr;
+        ASSERT_EQ(remote->FetchEventData(eventData), 0);
+        ASSERT_NE(eventData, nullptr);
+        EXPECT_EQ(eventData->data, &contexts[i]);
+        EXPECT_EQ(eventData->type & BEYOND_EVENT_TYPE_INFERENCE_MASK, types[i]);
+        remote->DestroyEventData(eventData);
+    }
+
+    InferenceImplTest::DestroyRemote(remote);
+}